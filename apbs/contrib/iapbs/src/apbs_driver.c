@@ -7,12 +7,12 @@
  *
  *
  */
-  
-#include "apbs.h"  
+
+#include "apbs.h"
 #include "routines.h"
-#include "generic/nosh.h"  
-#include "generic/mgparm.h"  
-#include "generic/pbeparm.h"  
+#include "generic/nosh.h"
+#include "generic/mgparm.h"
+#include "generic/pbeparm.h"
 #include "generic/femparm.h"
 #include "generic/vhal.h"
 
@@ -26,6 +26,434 @@
 
 VEMBED(rcsid="$Id: apbs_driver.c rok $")
 
+/**
+ * @brief  Output arrays supplied by the caller of apbsdrv_ or apbssolve_
+ */
+typedef struct {
+    double *esEnergy;  /**< Electrostatic energy */
+    double *npEnergy;  /**< Non-polar energy */
+    double *tot[3];  /**< Total electrostatic force per atom */
+    double *qf[3];  /**< Fixed charge force */
+    double *ib[3];  /**< Ionic boundary force */
+    double *np[3];  /**< Non-polar force */
+    double *db[3];  /**< Dielectric boundary force */
+    double *grid_meta;  /**< Grid meta data (see apbsdrv_) */
+    double **grid;  /**< Grid data sets */
+    int grid2file;  /**< 1 if grid data goes to files, 0 to grid */
+} iAPBSout;
+
+/**
+ * @brief  Persistent iAPBS calculation (see apbsinit_)
+ */
+struct sAPBSctx {
+    Vcom *com;  /**< Communications object */
+    Vmem *mem;  /**< Memory for the force arrays */
+    NOsh *nosh;  /**< Calculations parsed from the input string */
+    Valist *alist[NOSH_MAXMOL];  /**< Molecule, updated in place */
+    Vgrid *dielXMap[NOSH_MAXMOL];  /**< Dielectric maps */
+    Vgrid *dielYMap[NOSH_MAXMOL];  /**< Dielectric maps */
+    Vgrid *dielZMap[NOSH_MAXMOL];  /**< Dielectric maps */
+    Vgrid *kappaMap[NOSH_MAXMOL];  /**< Kappa maps */
+    Vgrid *potMap[NOSH_MAXMOL];  /**< Potential maps */
+    Vgrid *chargeMap[NOSH_MAXMOL];  /**< Charge maps */
+    Vpbe *pbe[NOSH_MAXCALC];  /**< PBE objects, kept for every level */
+    Vpmgp *pmgp[NOSH_MAXCALC];  /**< MG parameters, kept for every level */
+    Vpmg *pmg[NOSH_MAXCALC];  /**< MG objects, kept for every level */
+    double *oldpos;  /**< 3*natom positions of the last cell list update */
+    int natom;  /**< Number of atoms */
+    int debug;  /**< Debug verbosity flag */
+};
+
+/**
+ * @brief  Compute the bounding box, center and charge of the molecule
+ */
+VPRIVATE void apbsBounds(Valist *alist)
+{
+    int i, j;
+    double *pos;
+    Vatom *atom;
+
+    for (j=0; j<3; j++) {
+	alist->maxcrd[j] = -VLARGE;
+	alist->mincrd[j] = VLARGE;
+    }
+    alist->maxrad = 0.;
+    alist->charge = 0.;
+
+    for (i=0; i<alist->number; i++) {
+	atom = &(alist->atoms)[i];
+	pos = Vatom_getPosition(atom);
+	for (j=0; j<3; j++) {
+	    if (pos[j] < alist->mincrd[j]) alist->mincrd[j] = pos[j];
+	    if (pos[j] > alist->maxcrd[j]) alist->maxcrd[j] = pos[j];
+	}
+	if (Vatom_getRadius(atom) > alist->maxrad)
+	    alist->maxrad = Vatom_getRadius(atom);
+	alist->charge = alist->charge + Vatom_getCharge(atom);
+    }
+
+    for (j=0; j<3; j++) {
+	alist->center[j] = 0.5*(alist->maxcrd[j] + alist->mincrd[j]);
+    }
+}
+
+/**
+ * @brief  Parse the input string, build the molecule from the caller's
+ *         arrays, set up the calculations and load the maps
+ * @return  1 if successful, 0 otherwise
+ */
+VPRIVATE int apbsSetup(NOsh *nosh, int *nat, double x[NATOMS],
+	double y[NATOMS], double z[NATOMS], double radius[NATOMS],
+	double charge[NATOMS], double r_param[9], int i_param[25],
+	double grid[3], int dime[3], int pdime[3], double glen[3],
+	double center[3], double cglen[3], double fglen[3],
+	double ccenter[3], double fcenter[3], double *ofrac, int debug,
+	double ionq[MAXION], double ionc[MAXION], double ionr[MAXION],
+	Valist *alist[NOSH_MAXMOL], Vgrid *dielXMap[NOSH_MAXMOL],
+	Vgrid *dielYMap[NOSH_MAXMOL], Vgrid *dielZMap[NOSH_MAXMOL],
+	Vgrid *kappaMap[NOSH_MAXMOL], Vgrid *potMap[NOSH_MAXMOL],
+	Vgrid *chargeMap[NOSH_MAXMOL])
+{
+    int i;
+    int bufsize = MAX_BUF_SIZE;
+    double coord[3];
+    char *inputString;
+    Vio *sock = VNULL;
+
+    /* *************** PARSE INPUT FILE ******************* */
+//    sock = Vio_ctor("FILE", "ASC", VNULL, input_path, "r");
+//    Vnm_tprint( 1, "Parsing input file %s...\n", input_path);
+
+    VASSERT( bufsize <= VMAX_BUFSIZE );
+    sock = Vio_ctor("BUFF","ASC",VNULL,"0","r");
+
+    /* generate input string */
+    inputString = VNULL;
+    inputString = setupString(r_param, i_param, grid, dime, ionq, ionc,
+		  ionr, glen, center, cglen, fglen, ccenter, fcenter, ofrac,
+		  pdime, debug);
+    if(debug>2) Vnm_tprint(1, "debug: Input string:\n%s\n", inputString);
+    Vio_bufTake(sock, inputString, bufsize);
+
+    if (!NOsh_parseInput(nosh, sock)) {
+	Vnm_tprint( 2, "Error while parsing input string.\n");
+	sock->VIObuffer = VNULL;
+	Vio_dtor(&sock);
+	return 0;
+    } else if(debug>1) Vnm_tprint( 1, "Parsed input string.\n");
+
+    sock->VIObuffer = VNULL;
+    Vio_dtor(&sock);
+
+
+    /* *************** LOAD PARAMETERS AND MOLECULES ******************* */
+    //nosh->gotparm = 0; // not using param file for now
+
+    /* alist fills nosh */
+    alist[0] = Valist_ctor();
+    alist[0]->number = *nat;
+    /* Allocate the necessary space for the atom array */
+    alist[0]->atoms = Vmem_malloc(alist[0]->vmem, alist[0]->number,
+	    (sizeof(Vatom)));
+    VASSERT(alist[0]->atoms != VNULL);
+
+    for (i=0; i<alist[0]->number; i++) {
+	/* Fill atoms in the atom list */
+	coord[0] = x[i];
+	coord[1] = y[i];
+	coord[2] = z[i];
+	Vatom_setPosition(&(alist[0]->atoms)[i], coord);
+	Vatom_setCharge(&(alist[0]->atoms)[i], charge[i]);
+	Vatom_setRadius(&(alist[0]->atoms)[i], radius[i]);
+	Vatom_setAtomID(&(alist[0]->atoms)[i], i);
+    }
+    apbsBounds(alist[0]);
+
+    /* *************** SETUP CALCULATIONS *************** */
+    if (NOsh_setupElecCalc(nosh, alist) != 1) {
+	Vnm_tprint(2, "Error setting up ELEC calculations\n");
+	return 0;
+    }
+
+    if (NOsh_setupApolCalc(nosh, alist) == ACD_ERROR) {
+	Vnm_tprint(2, "Error setting up APOL calculations\n");
+	return 0;
+    }
+
+    /* The NOsh tables grow as needed, but this driver keeps fixed arrays */
+    if ((nosh->ncalc > NOSH_MAXCALC) || (nosh->nmol > NOSH_MAXMOL) ||
+      (nosh->ndiel > NOSH_MAXMOL) || (nosh->nkappa > NOSH_MAXMOL) ||
+      (nosh->npot > NOSH_MAXMOL) || (nosh->ncharge > NOSH_MAXMOL)) {
+	Vnm_tprint(2, "iAPBS supports at most %d calculations and %d \
+molecules or maps of each type!\n", NOSH_MAXCALC, NOSH_MAXMOL);
+	return 0;
+    }
+
+    /* *************** LOAD MAPS ******************* */
+    if (loadDielMaps(nosh, dielXMap, dielYMap, dielZMap) != 1) {
+	Vnm_tprint(2, "Error reading dielectric maps!\n");
+	return 0;
+    }
+    if (loadKappaMaps(nosh, kappaMap) != 1) {
+	Vnm_tprint(2, "Error reading kappa maps!\n");
+	return 0;
+    }
+    if (loadPotMaps(nosh, potMap) != 1) {
+      Vnm_tprint(2, "Error reading potential maps!\n");
+      return 0;
+    }
+    if (loadChargeMaps(nosh, chargeMap) != 1) {
+	Vnm_tprint(2, "Error reading charge maps!\n");
+	return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief  Collect the caller's output arrays and zero the forces if any
+ *         calculation computes them
+ */
+VPRIVATE void apbsOutputs(iAPBSout *out, NOsh *nosh, int natom,
+	double esEnergy[1], double npEnergy[1],
+	double apbsdx[NATOMS], double apbsdy[NATOMS], double apbsdz[NATOMS],
+	double apbsqfx[NATOMS], double apbsqfy[NATOMS], double apbsqfz[NATOMS],
+	double apbsibx[NATOMS], double apbsiby[NATOMS], double apbsibz[NATOMS],
+	double apbsnpx[NATOMS], double apbsnpy[NATOMS], double apbsnpz[NATOMS],
+	double apbsdbx[NATOMS], double apbsdby[NATOMS], double apbsdbz[NATOMS],
+	double apbsgrid_meta[13], double *apbsgrid[])
+{
+    int i, j;
+
+    out->esEnergy = esEnergy;
+    out->npEnergy = npEnergy;
+    out->tot[0] = apbsdx; out->tot[1] = apbsdy; out->tot[2] = apbsdz;
+    out->qf[0] = apbsqfx; out->qf[1] = apbsqfy; out->qf[2] = apbsqfz;
+    out->ib[0] = apbsibx; out->ib[1] = apbsiby; out->ib[2] = apbsibz;
+    out->np[0] = apbsnpx; out->np[1] = apbsnpy; out->np[2] = apbsnpz;
+    out->db[0] = apbsdbx; out->db[1] = apbsdby; out->db[2] = apbsdbz;
+    out->grid_meta = apbsgrid_meta;
+    out->grid = apbsgrid;
+
+    // 1 if grid data to be written to files (traditional), 0 to return via apbsgrid**.
+    out->grid2file = 1;
+
+    // Memory must be allocated for the outputs if they are to be returned in-memory.
+    if( apbsgrid_meta[0] > 0 ) {
+        out->grid2file = 0;
+        VASSERT( apbsgrid != VNULL );
+        for(i=0; i<apbsgrid_meta[0]; i++) {
+            VASSERT( apbsgrid[i] != VNULL );
+        }
+    }
+
+    // Do this initialization only if calcforce is requested.
+    for (i=0; i<nosh->ncalc; i++){
+        if(nosh->calc[i]->pbeparm->calcforce >0) {
+            for (i=0; i < natom; i++) {
+                for (j=0; j<3; j++) {
+                    out->tot[j][i] = 0.0;
+                    out->qf[j][i] = 0.0;
+                    out->ib[j][i] = 0.0;
+                    out->db[j][i] = 0.0;
+                    out->np[j][i] = 0.0;
+                }
+            }
+            // once is enough
+            break;
+        }
+    }
+}
+
+/**
+ * @brief  Return the forces and grid data of a solved MG calculation
+ */
+VPRIVATE void apbsOutputMG(int rank, NOsh *nosh, PBEparm *pbeparm, Vpmg *pmg,
+	AtomForce *atomForce, int natom, iAPBSout *out)
+{
+    int j, k, nout;
+    double scale;
+
+    scale = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na;
+    if (pbeparm->calcforce == PCF_TOTAL) nout = 1;
+    else if (pbeparm->calcforce == PCF_COMPS) nout = natom;
+    else nout = 0;
+    for (j=0; j < nout; j++) {
+	for (k=0; k<3; k++) {
+	    out->tot[k][j] = scale * (atomForce[j].qfForce[k] +
+		    atomForce[j].ibForce[k] + atomForce[j].dbForce[k]);
+	    /* individual components */
+	    out->qf[k][j] = scale * atomForce[j].qfForce[k];
+	    out->ib[k][j] = scale * atomForce[j].ibForce[k];
+	    out->db[k][j] = scale * atomForce[j].dbForce[k];
+	}
+    }
+
+    /* Write grid-dimensioned data to file if that's what user wants*/
+    if( out->grid2file ) {
+      writedataMG(rank, nosh, pbeparm, pmg);
+    }
+    /* Return in-memeory instead */
+    else {
+      for( k=0; k<pbeparm->numwrite; k++ ) {
+	int nx = pmg->pmgp->nx;
+	int ny = pmg->pmgp->ny;
+	int nz = pmg->pmgp->nz;
+	double hx = pmg->pmgp->hx;
+	double hy = pmg->pmgp->hy;
+	double hz = pmg->pmgp->hzed;
+	double centx = pmg->pmgp->xcent;
+	double centy = pmg->pmgp->ycent;
+	double centz = pmg->pmgp->zcent;
+	double parm;
+	Vdata_Type data_type = pbeparm->writetype[k];
+	switch(data_type) {
+	case VDT_SMOL:
+	  parm = pbeparm->srad;
+	  break;
+	case VDT_SSPL:
+	  parm = pbeparm->swin;
+	  break;
+	case VDT_IVDW:
+	  parm = pmg->pbe->maxIonRadius;
+	  break;
+	case VDT_DIELX:
+	  centx +=0.5*hz;
+	  parm = 0;
+	  break;
+	case VDT_DIELY:
+	  centy +=0.5*hz;
+	  parm = 0;
+	  break;
+	case VDT_DIELZ:
+	  centz +=0.5*hz;
+	  parm = 0;
+	  break;
+	case VDT_CHARGE:
+	case VDT_POT:
+	case VDT_VDW:
+	case VDT_LAP:
+	case VDT_EDENS:
+	case VDT_NDENS:
+	case VDT_QDENS:
+	case VDT_KAPPA:
+	case VDT_ATOMPOT:
+	  parm = 0;
+	  break;
+	default:
+	  Vnm_print(2, "Warning!  Skipping invalid data type for writing: %d\n", k);
+	  continue;
+	}
+
+	out->grid_meta[1] = nx;
+	out->grid_meta[2] = ny;
+	out->grid_meta[3] = nz;
+	out->grid_meta[4] = hx;
+	out->grid_meta[5] = hy;
+	out->grid_meta[6] = hz;
+	out->grid_meta[7] = centx;
+	out->grid_meta[8] = centy;
+	out->grid_meta[9] = centz;
+	out->grid_meta[10] = centx - 0.5*(nx-1)*hx;
+	out->grid_meta[11] = centy - 0.5*(ny-1)*hy;
+	out->grid_meta[12] = centz - 0.5*(nz-1)*hz;
+
+	Vpmg_fillArray(pmg, out->grid[k], data_type, parm,
+		       pbeparm->pbetype, pbeparm);
+      }
+    }
+    /* Write matrix */
+    writematMG(rank, nosh, pbeparm, pmg);
+}
+
+/**
+ * @brief  Run an apolar calculation and return its energy and forces
+ * @return  1 if successful, 0 otherwise
+ */
+VPRIVATE int apbsApol(NOsh *nosh, Vmem *mem, int icalc, int *nforce,
+	AtomForce **atomForce, Valist *alist[NOSH_MAXMOL], int natom,
+	int debug, iAPBSout *out)
+{
+    int j, k;
+    APOLparm *apolparm = VNULL;
+    Vparam *param = VNULL;
+
+    /* See the note at the top of the MG case of apbsdrv_ about this
+       loop. */
+    for (k=0; k<nosh->napol; k++) {
+	if (nosh->apol2calc[k] >= icalc) {
+	    break;
+	}
+    }
+
+    if (Vstring_strcasecmp(nosh->apolname[k], "") == 0) {
+	if(debug>1) Vnm_tprint( 1, "CALCULATION #%d: APOLAR\n", icalc+1);
+    } else {
+	if(debug>1) Vnm_tprint( 1, "CALCULATION #%d (%s): APOLAR\n",
+		icalc+1, nosh->apolname[k]);
+    }
+
+    apolparm = nosh->calc[icalc]->apolparm;
+    if (initAPOL(nosh, mem, param, apolparm, nforce, atomForce,
+	    alist[(apolparm->molid)-1]) == 0) {
+	Vnm_tprint(2, "Error calculating apolar solvation quantities!\n");
+	return 0;
+    }
+
+    if(debug>3) printf("energyAPOL: %1.12E\n", apolparm->gamma*apolparm->sasa);
+    out->npEnergy[0] = 0.0;
+    out->npEnergy[0] = apolparm->gamma*apolparm->sasa;
+
+    if (apolparm->calcforce == ACF_COMPS) {
+	for (j=0; j < natom; j++) {
+	  out->np[0][j] = ((*atomForce)[j]).sasaForce[0];
+	  out->np[1][j] = ((*atomForce)[j]).sasaForce[1];
+	  out->np[2][j] = ((*atomForce)[j]).sasaForce[2];
+	}
+    }
+    //if(debug>3) printApolEnergy(nosh, icalc);
+    //if(debug>3) printApolForce(com, nosh, nforce, atomForce, icalc);
+
+    return 1;
+}
+
+/**
+ * @brief  Handle the PRINT statements of the input string
+ */
+VPRIVATE void apbsPrint(Vcom *com, NOsh *nosh, double totEnergy[NOSH_MAXCALC],
+	int nforce[NOSH_MAXCALC], AtomForce *atomForce[NOSH_MAXCALC],
+	int debug)
+{
+    int i;
+
+    if (nosh->nprint > 0) {
+	Vnm_tprint( 1, "----------------------------------------\n");
+	Vnm_tprint( 1, "PRINT STATEMENTS\n");
+    }
+    for (i=0; i<nosh->nprint; i++) {
+	/* Print energy */
+	if (nosh->printwhat[i] == NPT_ENERGY) {
+	    printEnergy(com, nosh, totEnergy, i);
+	    /* Print force */
+	} else if (nosh->printwhat[i] == NPT_FORCE) {
+	    if(debug>6) printForce(com, nosh, nforce, atomForce, i);
+	} else if (nosh->printwhat[i] == NPT_ELECENERGY) {
+	    if(debug>3) printElecEnergy(com, nosh, totEnergy, i);
+	    //esEnergy[0] = getElecEnergy(com, nosh, totEnergy, i);
+	} else if (nosh->printwhat[i] == NPT_ELECFORCE) {
+	    if(debug>6) printElecForce(com, nosh, nforce, atomForce, i);
+	} else if (nosh->printwhat[i] == NPT_APOLENERGY) {
+	    if(debug>3) printApolEnergy(nosh, i);
+	} else if (nosh->printwhat[i] == NPT_APOLFORCE) {
+	    if(debug>6) printApolForce(com, nosh, nforce, atomForce, i);
+	} else {
+	    Vnm_tprint( 2, "Undefined PRINT keyword!\n");
+	    break;
+	}
+    }
+    if(debug>1) Vnm_tprint( 1, "----------------------------------------\n");
+}
+
 /**
  * @brief  Wrapper iAPBS function
  * @author Robert Konecny
@@ -35,7 +463,7 @@ int apbsdrv_(
 	     int *nat,
 	     double x[NATOMS],
 	     double y[NATOMS],
-	     double z[NATOMS], 
+	     double z[NATOMS],
 	     double radius[NATOMS],
 	     double charge[NATOMS],
 	     double r_param[9],
@@ -46,9 +474,9 @@ int apbsdrv_(
 	     double glen[3],
 	     double center[3],
 	     double cglen[3],
-	     double fglen[3], 
+	     double fglen[3],
 	     double ccenter[3],
-	     double fcenter[3], 
+	     double fcenter[3],
 	     double *ofrac,
 	     int *dbg,
 	     double ionq[MAXION],
@@ -65,31 +493,17 @@ int apbsdrv_(
 	     double *apbsgrid[]
 	     )
 {
-    int i,k,j;
-
-    // 1 if grid data to be written to files (traditional), 0 to return via apbsgrid**.
-    int is_grid2file = 1;
-
-    // Memory must be allocated for the outputs if they are to be returned in-memory.
-    if( apbsgrid_meta[0] > 0 ) {
-        is_grid2file = 0;
-        VASSERT( apbsgrid != VNULL );
-        for(i=0; i<apbsgrid_meta[0]; i++) {
-            VASSERT( apbsgrid[i] != VNULL );
-        }
-    }
+    int i,k;
 
     NOsh *nosh = VNULL;
 
     MGparm *mgparm = VNULL;
     FEMparm *feparm = VNULL;
     PBEparm *pbeparm = VNULL;
-    APOLparm *apolparm = VNULL;
     Vparam *param = VNULL;
 
     Vmem *mem = VNULL;
     Vcom *com = VNULL;
-    Vio *sock = VNULL;
 #ifdef HAVE_MC_H
     Vfetk *fetk[NOSH_MAXCALC];
     Gem *gm[NOSH_MAXMOL];
@@ -111,11 +525,7 @@ int apbsdrv_(
     //    unsigned long int bytesTotal, highWater;
     size_t bytesTotal, highWater;
     Voutput_Format outputformat;
-
-    int bufsize = MAX_BUF_SIZE;
-    int rc = 0;
-    double coord[3];
-    char *inputString;
+    iAPBSout out;
 
     /* These variables require some explaining... The energy double arrays
      * store energies from the various calculations.  The energy int array
@@ -138,11 +548,11 @@ int apbsdrv_(
 
     /* ************** CHECK PARALLEL STATUS *************** */
     // init is done by the calling program
-    //    VASSERT(Vcom_init(&argc, &argv)); 
+    //    VASSERT(Vcom_init(&argc, &argv));
     com = Vcom_ctor(1);
     rank = Vcom_rank(com);
     size = Vcom_size(com);
-    startVio(); 
+    startVio();
     Vnm_setIoTag(rank, size);
     Vnm_tprint( 0, "Hello world from PE %d\n", rank);
 
@@ -172,106 +582,16 @@ int apbsdrv_(
     }
 
 
-    /* *************** PARSE INPUT FILE ******************* */
+    /* *************** PARSE INPUT, SETUP CALCULATIONS ******************* */
     nosh = NOsh_ctor(rank, size);
-
-//    sock = Vio_ctor("FILE", "ASC", VNULL, input_path, "r");
-//    Vnm_tprint( 1, "Parsing input file %s...\n", input_path);
-    
-    VASSERT( bufsize <= VMAX_BUFSIZE );
-    sock = Vio_ctor("BUFF","ASC",VNULL,"0","r");
-
     debug = *dbg;
-
-    /* generate input string */
-    inputString = VNULL;
-    inputString = setupString(r_param, i_param, grid, dime, ionq, ionc, 
-		  ionr, glen, center, cglen, fglen, ccenter, fcenter, ofrac, 
-		  pdime, debug);
-    if(debug>2) Vnm_tprint(1, "debug: Input string:\n%s\n", inputString);
-    Vio_bufTake(sock, inputString, bufsize);
-
-    if (!NOsh_parseInput(nosh, sock)) {
-	Vnm_tprint( 2, "Error while parsing input string.\n");
-	VJMPERR1(0);
-    } else if(debug>1) Vnm_tprint( 1, "Parsed input string.\n");
-    
-    sock->VIObuffer = VNULL;
-    Vio_dtor(&sock);
-
-
-    /* *************** LOAD PARAMETERS AND MOLECULES ******************* */
-    //nosh->gotparm = 0; // not using param file for now
-/*    
- * 
-      param = loadParameter(nosh);
-      if (loadMolecules(nosh, param, alist) != 1) {
-	Vnm_tprint(2, "Error reading molecules!\n");
+    if (!apbsSetup(nosh, nat, x, y, z, radius, charge, r_param, i_param,
+	    grid, dime, pdime, glen, center, cglen, fglen, ccenter, fcenter,
+	    ofrac, debug, ionq, ionc, ionr, alist, dielXMap, dielYMap,
+	    dielZMap, kappaMap, potMap, chargeMap)) {
 	VJMPERR1(0);
     }
-*/
-
-    /* alist fills nosh */
-    alist[0] = Valist_ctor();
-
-    alist[0]->center[0] = 0.;
-    alist[0]->center[1] = 0.;
-    alist[0]->center[2] = 0.;
-    alist[0]->maxcrd[0] = -VLARGE;
-    alist[0]->maxcrd[1] = -VLARGE;
-    alist[0]->maxcrd[2] = -VLARGE;
-    alist[0]->mincrd[0] = VLARGE;
-    alist[0]->mincrd[1] = VLARGE;
-    alist[0]->mincrd[2] = VLARGE;
-    alist[0]->maxrad = 0.;
-    alist[0]->charge = 0.;
-
-    alist[0]->number = *nat;
     natom =  alist[0]->number;
-    /* Allocate the necessary space for the atom array */
-    alist[0]->atoms = Vmem_malloc(alist[0]->vmem, alist[0]->number,
-	    (sizeof(Vatom)));
-    VASSERT(alist[0]->atoms != VNULL);
-
-
-    for (i=0; i<alist[0]->number; i++) {
-	/* Fill atoms in the atom list */
-
-	/* atom[i]->partID = 1; FIXME */
-
-	if (x[i] < alist[0]->mincrd[0]) alist[0]->mincrd[0] = x[i];
-	if (y[i] < alist[0]->mincrd[1]) alist[0]->mincrd[1] = y[i];
-	if (z[i] < alist[0]->mincrd[2]) alist[0]->mincrd[2] = z[i];
-	if (x[i] > alist[0]->maxcrd[0]) alist[0]->maxcrd[0] = x[i];
-	if (y[i] > alist[0]->maxcrd[1]) alist[0]->maxcrd[1] = y[i];
-	if (z[i] > alist[0]->maxcrd[2]) alist[0]->maxcrd[2] = z[i];
-	if (radius[i] > alist[0]->maxrad) alist[0]->maxrad = radius[i];
-	alist[0]->charge = alist[0]->charge + charge[i];
-
-	coord[0] = x[i];
-	coord[1] = y[i];
-	coord[2] = z[i];
-	Vatom_setPosition(&(alist[0]->atoms)[i], coord);
-	Vatom_setCharge(&(alist[0]->atoms)[i], charge[i]);
-	Vatom_setRadius(&(alist[0]->atoms)[i], radius[i]);
-	Vatom_setAtomID(&(alist[0]->atoms)[i], i);
-	// not necessary? Vatom_setPartID(&(alist[0]->atoms)[i, );
-    }
-
-    alist[0]->center[0] = 0.5*(alist[0]->maxcrd[0] + alist[0]->mincrd[0]);
-    alist[0]->center[1] = 0.5*(alist[0]->maxcrd[1] + alist[0]->mincrd[1]);
-    alist[0]->center[2] = 0.5*(alist[0]->maxcrd[2] + alist[0]->mincrd[2]);
-
-    /* *************** SETUP CALCULATIONS *************** */
-    if (NOsh_setupElecCalc(nosh, alist) != 1) {
-	Vnm_tprint(2, "Error setting up ELEC calculations\n");
-	VJMPERR1(0);
-    }
-
-    if ((rc = NOsh_setupApolCalc(nosh, alist)) == ACD_ERROR) {
-	Vnm_tprint(2, "Error setting up APOL calculations\n");
-	VJMPERR1(0);
-    }
 
     /* ******************* CHECK APOL********************** */
     //if((nosh->gotparm == 0) && (rc == ACD_YES)){
@@ -280,50 +600,11 @@ int apbsdrv_(
     //	VJMPERR1(0);
     //}
 
-    /* *************** LOAD MAPS ******************* */
-    if (loadDielMaps(nosh, dielXMap, dielYMap, dielZMap) != 1) {
-	Vnm_tprint(2, "Error reading dielectric maps!\n");
-	VJMPERR1(0);
-    }
-    if (loadKappaMaps(nosh, kappaMap) != 1) {
-	Vnm_tprint(2, "Error reading kappa maps!\n");
-	VJMPERR1(0);
-    }
-    if (loadPotMaps(nosh, potMap) != 1) {
-      Vnm_tprint(2, "Error reading potential maps!\n");
-      VJMPERR1(0);
-    }
-    if (loadChargeMaps(nosh, chargeMap) != 1) {
-	Vnm_tprint(2, "Error reading charge maps!\n");
-	VJMPERR1(0);
-    }
-
     /* *************** Initialization ******************* */
-    // Do this initialization only if calcforce is requested.
-    for (i=0; i<nosh->ncalc; i++){
-        pbeparm = nosh->calc[i]->pbeparm;
-        if(pbeparm->calcforce >0) {
-            for (i=0; i < natom; i++) {
-                apbsdx[i] = 0.0;
-                apbsdy[i] = 0.0;
-                apbsdz[i] = 0.0;
-                apbsqfx[i] = 0.0;
-                apbsqfy[i] = 0.0;
-                apbsqfz[i] = 0.0;
-                apbsibx[i] = 0.0;
-                apbsiby[i] = 0.0;
-                apbsibz[i] = 0.0;
-                apbsdbx[i] = 0.0;
-                apbsdby[i] = 0.0;
-                apbsdbz[i] = 0.0;
-                apbsnpx[i] = 0.0;
-                apbsnpy[i] = 0.0;
-                apbsnpz[i] = 0.0;
-            }
-            // once is enough
-            break;
-        }
-    }
+    apbsOutputs(&out, nosh, natom, esenergy, npenergy,
+	    apbsdx, apbsdy, apbsdz, apbsqfx, apbsqfy, apbsqfz,
+	    apbsibx, apbsiby, apbsibz, apbsnpx, apbsnpy, apbsnpz,
+	    apbsdbx, apbsdby, apbsdbz, apbsgrid_meta, apbsgrid);
 
     /* *************** DO THE CALCULATIONS ******************* */
     if(debug>1) Vnm_tprint( 1, "Preparing to run %d PBE calculations.\n",
@@ -331,9 +612,9 @@ int apbsdrv_(
     for (i=0; i<nosh->ncalc; i++) {
 	if(debug>1) Vnm_tprint( 1, "----------------------------------------\n");
 
-	switch (nosh->calc[i]->calctype) {  
+	switch (nosh->calc[i]->calctype) {
 	    case NCT_MG:
-		/* What is this?  This seems like a very awkward way to find 
+		/* What is this?  This seems like a very awkward way to find
 		   the right ELEC statement... */
 		for (k=0; k<nosh->nelec; k++) {
 		    if (nosh->elec2calc[k] >= i) {
@@ -343,7 +624,7 @@ int apbsdrv_(
 		if (Vstring_strcasecmp(nosh->elecname[k], "") == 0) {
 		    if(debug>1) Vnm_tprint( 1, "CALCULATION #%d: MULTIGRID\n", i+1);
 		} else {
-		    if(debug>1) Vnm_tprint( 1, "CALCULATION #%d (%s): MULTIGRID\n", 
+		    if(debug>1) Vnm_tprint( 1, "CALCULATION #%d (%s): MULTIGRID\n",
 			    i+1, nosh->elecname[k]);
 		}
 		/* Useful local variables */
@@ -353,8 +634,8 @@ int apbsdrv_(
 
 		/* Set up problem */
 		if(debug>1) Vnm_tprint( 1, "  Setting up problem...\n");
-		if (!initMG(i, nosh, mgparm, pbeparm, realCenter, pbe, 
-			    alist, dielXMap, dielYMap, dielZMap, kappaMap, chargeMap, 
+		if (!initMG(i, nosh, mgparm, pbeparm, realCenter, pbe,
+			    alist, dielXMap, dielYMap, dielZMap, kappaMap, chargeMap,
 			    pmgp, pmg, potMap)) {
 		    Vnm_tprint( 2, "Error setting up MG calculation!\n");
 		    VJMPERR1(0);
@@ -377,174 +658,23 @@ int apbsdrv_(
 		}
 
 		/* Write out energies */
-		energyMG(nosh, i, pmg[i], 
-			&(nenergy[i]), &(totEnergy[i]), &(qfEnergy[i]), 
+		energyMG(nosh, i, pmg[i],
+			&(nenergy[i]), &(totEnergy[i]), &(qfEnergy[i]),
 			&(qmEnergy[i]), &(dielEnergy[i]));
 		esenergy[0] = 0.0;
 		esenergy[0] = getElecEnergy(com, nosh, totEnergy, i);
-		
+
 		//		if(debug>3) printElecEnergy(com, nosh, totEnergy, i);
 
 		/* Write out forces */
-		forceMG(mem, nosh, pbeparm, mgparm, pmg[i], &(nforce[i]), 
+		forceMG(mem, nosh, pbeparm, mgparm, pmg[i], &(nforce[i]),
 			&(atomForce[i]), alist);
-		
-		//if (pbeparm->calcforce > 0 && i == nosh->ncalc-1) {
-		if (pbeparm->calcforce == PCF_TOTAL) {
-		  //		  Vnm_tprint(2, "pcf_total\n");
-		  apbsdx[0] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-		    (atomForce[i][0].qfForce[0] +
-		     atomForce[i][0].ibForce[0] +
-		     atomForce[i][0].dbForce[0]);
-		  apbsdy[0] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-		    (atomForce[i][0].qfForce[1] +
-		     atomForce[i][0].ibForce[1] +
-		     atomForce[i][0].dbForce[1]);
-		  apbsdz[0] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-		    (atomForce[i][0].qfForce[2] +
-		     atomForce[i][0].ibForce[2] +
-		     atomForce[i][0].dbForce[2]);
-
-		  apbsqfx[0] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-		    atomForce[i][0].qfForce[0];
-		  apbsqfy[0] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-		    atomForce[i][0].qfForce[1];
-		  apbsqfz[0] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-		    atomForce[i][0].qfForce[2];
-
-		  apbsibx[0] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-		    atomForce[i][0].ibForce[0];
-		  apbsiby[0] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-		    atomForce[i][0].ibForce[1];
-		  apbsibz[0] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-		    atomForce[i][0].ibForce[2];
-
-		  apbsdbx[0] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-		    atomForce[i][0].dbForce[0];
-		  apbsdby[0] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-		    atomForce[i][0].dbForce[1];
-		  apbsdbz[0] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-		    atomForce[i][0].dbForce[2];
-		}
-
-		if (pbeparm->calcforce == PCF_COMPS) {
-		  //		  Vnm_tprint(2, "pcf_comps\n");
-		    for (j=0; j < natom; j++) {
-
-			apbsdx[j] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-			    (atomForce[i][j].qfForce[0] +
-			     atomForce[i][j].ibForce[0] +
-			     atomForce[i][j].dbForce[0]);
-			apbsdy[j] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-			    (atomForce[i][j].qfForce[1] +
-			     atomForce[i][j].ibForce[1] +
-			     atomForce[i][j].dbForce[1]);
-			apbsdz[j] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-			    (atomForce[i][j].qfForce[2] +
-			     atomForce[i][j].ibForce[2] +
-			     atomForce[i][j].dbForce[2]);
-
-			/* individual components */
-			apbsqfx[j] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-			    atomForce[i][j].qfForce[0];
-			apbsqfy[j] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-			    atomForce[i][j].qfForce[1];
-			apbsqfz[j] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-			    atomForce[i][j].qfForce[2];
-
-			apbsibx[j] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-			    atomForce[i][j].ibForce[0];
-			apbsiby[j] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-			    atomForce[i][j].ibForce[1];
-			apbsibz[j] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-			    atomForce[i][j].ibForce[2];
-
-			apbsdbx[j] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-			    atomForce[i][j].dbForce[0];
-			apbsdby[j] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-			    atomForce[i][j].dbForce[1];
-			apbsdbz[j] = Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na *
-			    atomForce[i][j].dbForce[2];
-		    }
-		    //		    if(debug>3) printElecForce(com, nosh, nforce, atomForce, i);
-		}
-		/* Write grid-dimensioned data to file if that's what user wants*/
-		if( is_grid2file ) {
-		  writedataMG(rank, nosh, pbeparm, pmg[i]);
-		}
-		/* Return in-memeory instead */
-		else {		
-		  for( k=0; k<pbeparm->numwrite; k++ ) {
-		    int nx = pmg[i]->pmgp->nx;
-		    int ny = pmg[i]->pmgp->ny;
-		    int nz = pmg[i]->pmgp->nz;
-		    double hx = pmg[i]->pmgp->hx;
-		    double hy = pmg[i]->pmgp->hy;
-		    double hz = pmg[i]->pmgp->hzed;
-		    double centx = pmg[i]->pmgp->xcent;
-		    double centy = pmg[i]->pmgp->ycent;
-		    double centz = pmg[i]->pmgp->zcent;
-		    double parm;
-		    Vdata_Type data_type = pbeparm->writetype[k];
-		    switch(data_type) {
-		    case VDT_SMOL:
-		      parm = pbeparm->srad;
-		      break;
-		    case VDT_SSPL:
-		      parm = pbeparm->swin;
-		      break;
-		    case VDT_IVDW:
-		      parm = pmg[i]->pbe->maxIonRadius;
-		      break;
-		    case VDT_DIELX:
-		      centx +=0.5*hz;
-		      parm = 0;
-		      break;
-		    case VDT_DIELY:
-		      centy +=0.5*hz;
-		      parm = 0;
-		      break;
-		    case VDT_DIELZ:
-		      centz +=0.5*hz;
-		      parm = 0;
-		      break;
-		    case VDT_CHARGE:
-		    case VDT_POT:
-		    case VDT_VDW:
-		    case VDT_LAP:
-		    case VDT_EDENS:
-		    case VDT_NDENS:
-		    case VDT_QDENS:
-		    case VDT_KAPPA:
-		    case VDT_ATOMPOT:
-		      parm = 0;
-		      break;
-		    default:
-		      Vnm_print(2, "Warning!  Skipping invalid data type for writing: %d\n", k);
-		      continue;
-		    }
 
-		    apbsgrid_meta[1] = nx;
-		    apbsgrid_meta[2] = ny;
-		    apbsgrid_meta[3] = nz;
-		    apbsgrid_meta[4] = hx;
-		    apbsgrid_meta[5] = hy;
-		    apbsgrid_meta[6] = hz;
-		    apbsgrid_meta[7] = centx;
-		    apbsgrid_meta[8] = centy;
-		    apbsgrid_meta[9] = centz;
-		    apbsgrid_meta[10] = centx - 0.5*(nx-1)*hx;
-		    apbsgrid_meta[11] = centy - 0.5*(ny-1)*hy;
-		    apbsgrid_meta[12] = centz - 0.5*(nz-1)*hz;
-
-		    Vpmg_fillArray(pmg[i], apbsgrid[k], data_type, parm,
-				   pbeparm->pbetype, pbeparm);
-		  }
-		}
-		/* Write matrix */
-		writematMG(rank, nosh, pbeparm, pmg[i]);
+		/* Return forces and grid data */
+		apbsOutputMG(rank, nosh, pbeparm, pmg[i], atomForce[i], natom,
+			&out);
 
-		/* If needed, cache atom energies */				
+		/* If needed, cache atom energies */
 		nenergy[i] = 0;
 		if ((pbeparm->calcenergy == PCE_COMPS) && (outputformat != OUTPUT_NULL)){
 		    storeAtomEnergy(pmg[i], i, &(atomEnergy[i]), &(nenergy[i]));
@@ -613,8 +743,8 @@ int apbsdrv_(
 			Vnm_tprint(2, "ERROR SOLVING EQUATION!\n");
 			VJMPERR1(0);
 		    }
-		    if (!energyFE(nosh, i, fetk, &(nenergy[i]), 
-				&(totEnergy[i]), &(qfEnergy[i]), 
+		    if (!energyFE(nosh, i, fetk, &(nenergy[i]),
+				&(totEnergy[i]), &(qfEnergy[i]),
 				&(qmEnergy[i]), &(dielEnergy[i]))) {
 			Vnm_tprint(2, "ERROR SOLVING EQUATION!\n");
 			VJMPERR1(0);
@@ -626,9 +756,9 @@ int apbsdrv_(
 		    }
 		    bytesTotal = Vmem_bytesTotal();
 		    highWater = Vmem_highWaterTotal();
-		    Vnm_tprint(1, "      Currently memory use:  %g MB\n", 
+		    Vnm_tprint(1, "      Currently memory use:  %g MB\n",
 			    ((double)bytesTotal/(1024.)/(1024.)));
-		    Vnm_tprint(1, "      High-water memory use:  %g MB\n", 
+		    Vnm_tprint(1, "      High-water memory use:  %g MB\n",
 			    ((double)highWater/(1024.)/(1024.)));
 		}
 
@@ -644,48 +774,13 @@ int apbsdrv_(
 
 		/* Do an apolar calculation */
 	    case NCT_APOL:
-		/* Copied from NCT_MG. See the note above (top of loop) for
-		   information about this loop.
-		   */
-		for (k=0; k<nosh->napol; k++) {
-		    if (nosh->apol2calc[k] >= i) {
-			break;
-		    }
-		}
-
-		if (Vstring_strcasecmp(nosh->apolname[k], "") == 0) {
-		    if(debug>1) Vnm_tprint( 1, "CALCULATION #%d: APOLAR\n", i+1);
-		} else {
-		    if(debug>1) Vnm_tprint( 1, "CALCULATION #%d (%s): APOLAR\n", 
-			    i+1, nosh->apolname[k]);
-		}
-
-		apolparm = nosh->calc[i]->apolparm;
-		rc = initAPOL(nosh, mem, param, apolparm, &(nforce[i]), &(atomForce[i]), 
-			alist[(apolparm->molid)-1]);
-		if(rc == 0) {
-		    Vnm_tprint(2, "Error calculating apolar solvation quantities!\n");
+		if (!apbsApol(nosh, mem, i, &(nforce[i]), &(atomForce[i]),
+			alist, natom, debug, &out)) {
 		    VJMPERR1(0);
 		}
-
-		if(debug>3) printf("energyAPOL: %1.12E\n", apolparm->gamma*apolparm->sasa);
-		npenergy[0] = 0.0;
-		npenergy[0] = apolparm->gamma*apolparm->sasa;
-
-		//if (pbeparm->calcforce > 0 && i == nosh->ncalc-1) {
-		//		if (pbeparm->calcforce > 1) {
-		if (apolparm->calcforce == ACF_COMPS) {
-		    for (j=0; j < natom; j++) {
-		      apbsnpx[j] = (atomForce[i][j]).sasaForce[0];
-		      apbsnpy[j] = (atomForce[i][j]).sasaForce[1];
-		      apbsnpz[j] = (atomForce[i][j]).sasaForce[2];
-		    }
-		}
-		//if(debug>3) printApolEnergy(nosh, i);
-		//if(debug>3) printApolForce(com, nosh, nforce, atomForce, i); 
 		break;
 	    default:
-		Vnm_tprint(2, "  Unknown calculation type (%d)!\n", 
+		Vnm_tprint(2, "  Unknown calculation type (%d)!\n",
 			   nosh->calc[i]->calctype);
 		exit(2);
 	}
@@ -695,32 +790,7 @@ int apbsdrv_(
     if(param != VNULL) Vparam_dtor(&param);
 
     /* *************** HANDLE PRINT STATEMENTS ******************* */
-    if (nosh->nprint > 0) {
-	Vnm_tprint( 1, "----------------------------------------\n");
-	Vnm_tprint( 1, "PRINT STATEMENTS\n");
-    }
-    for (i=0; i<nosh->nprint; i++) {
-	/* Print energy */
-	if (nosh->printwhat[i] == NPT_ENERGY) {
-	    printEnergy(com, nosh, totEnergy, i);
-	    /* Print force */
-	} else if (nosh->printwhat[i] == NPT_FORCE) {
-	    if(debug>6) printForce(com, nosh, nforce, atomForce, i);
-	} else if (nosh->printwhat[i] == NPT_ELECENERGY) {
-	    if(debug>3) printElecEnergy(com, nosh, totEnergy, i);
-	    //esEnergy[0] = getElecEnergy(com, nosh, totEnergy, i);
-	} else if (nosh->printwhat[i] == NPT_ELECFORCE) {
-	    if(debug>6) printElecForce(com, nosh, nforce, atomForce, i);
-	} else if (nosh->printwhat[i] == NPT_APOLENERGY) {
-	    if(debug>3) printApolEnergy(nosh, i);
-	} else if (nosh->printwhat[i] == NPT_APOLFORCE) {
-	    if(debug>6) printApolForce(com, nosh, nforce, atomForce, i);
-	} else {
-	    Vnm_tprint( 2, "Undefined PRINT keyword!\n");
-	    break;
-	}
-    } 
-    if(debug>1) Vnm_tprint( 1, "----------------------------------------\n");
+    apbsPrint(com, nosh, totEnergy, nforce, atomForce, debug);
 
     /* *************** HANDLE LOGGING *********************** */
 
@@ -734,7 +804,7 @@ int apbsdrv_(
 
     for (i=0; i<nosh->ncalc; i++) {
 	if (nenergy[i] > 0) Vmem_free(mem, nenergy[i], sizeof(double),
-		(void **)&(atomEnergy[i]));    
+		(void **)&(atomEnergy[i]));
     }
 
     /* *************** GARBAGE COLLECTION ******************* */
@@ -756,8 +826,8 @@ int apbsdrv_(
     /* Memory statistics */
     bytesTotal = Vmem_bytesTotal();
     highWater = Vmem_highWaterTotal();
-    if(debug>1) Vnm_tprint( 1, "Final memory usage:  %4.3f MB total, %4.3f MB high water\n", 
-	    (double)(bytesTotal)/(1024.*1024.), 
+    if(debug>1) Vnm_tprint( 1, "Final memory usage:  %4.3f MB total, %4.3f MB high water\n",
+	    (double)(bytesTotal)/(1024.*1024.),
 	    (double)(highWater)/(1024.*1024.));
 
     /* Clean up MALOC structures */
@@ -783,6 +853,356 @@ VERROR1:
     return APBSRC;
 }
 
+int apbsinit_(
+	      int *nat,
+	      double x[NATOMS],
+	      double y[NATOMS],
+	      double z[NATOMS],
+	      double radius[NATOMS],
+	      double charge[NATOMS],
+	      double r_param[9],
+	      int i_param[25],
+	      double grid[3],
+	      int dime[3],
+	      int pdime[3],
+	      double glen[3],
+	      double center[3],
+	      double cglen[3],
+	      double fglen[3],
+	      double ccenter[3],
+	      double fcenter[3],
+	      double *ofrac,
+	      int *dbg,
+	      double ionq[MAXION],
+	      double ionc[MAXION],
+	      double ionr[MAXION],
+	      APBSctx **ctx
+	      )
+{
+    int i, rank, size;
+    APBSctx *thee = VNULL;
+
+    *ctx = VNULL;
+    thee = (APBSctx *)Vmem_malloc(VNULL, 1, sizeof(APBSctx));
+    VASSERT(thee != VNULL);
+
+    thee->com = Vcom_ctor(1);
+    rank = Vcom_rank(thee->com);
+    size = Vcom_size(thee->com);
+    startVio();
+    Vnm_setIoTag(rank, size);
+
+    thee->mem = Vmem_ctor("MAIN");
+    thee->nosh = VNULL;
+    thee->oldpos = VNULL;
+    for (i=0; i<NOSH_MAXCALC; i++) {
+	thee->pmg[i] = VNULL;
+	thee->pmgp[i] = VNULL;
+	thee->pbe[i] = VNULL;
+    }
+    for (i=0; i<NOSH_MAXMOL; i++) {
+	thee->alist[i] = VNULL;
+	thee->dielXMap[i] = VNULL;
+	thee->dielYMap[i] = VNULL;
+	thee->dielZMap[i] = VNULL;
+	thee->kappaMap[i] = VNULL;
+	thee->potMap[i] = VNULL;
+	thee->chargeMap[i] = VNULL;
+    }
+    thee->debug = *dbg;
+
+    thee->nosh = NOsh_ctor(rank, size);
+    if (!apbsSetup(thee->nosh, nat, x, y, z, radius, charge, r_param,
+	    i_param, grid, dime, pdime, glen, center, cglen, fglen, ccenter,
+	    fcenter, ofrac, thee->debug, ionq, ionc, ionr, thee->alist,
+	    thee->dielXMap, thee->dielYMap, thee->dielZMap, thee->kappaMap,
+	    thee->potMap, thee->chargeMap)) {
+	VJMPERR1(0);
+    }
+    for (i=0; i<thee->nosh->ncalc; i++) {
+	if (thee->nosh->calc[i]->calctype == NCT_FEM) {
+	    Vnm_tprint(2, "apbsinit_:  only MG and APOL calculations can be \
+kept between solves!\n");
+	    VJMPERR1(0);
+	}
+    }
+
+    thee->natom = thee->alist[0]->number;
+    thee->oldpos = (double *)Vmem_malloc(thee->mem, 3*thee->natom,
+	    sizeof(double));
+    VASSERT(thee->oldpos != VNULL);
+
+    *ctx = thee;
+    return 0;
+
+VERROR1:
+    apbsfree_(&thee);
+    return APBSRC;
+}
+
+int apbsupdate_(
+		APBSctx **ctx,
+		double x[NATOMS],
+		double y[NATOMS],
+		double z[NATOMS],
+		double charge[NATOMS]
+		)
+{
+    int i, j;
+    double coord[3], cent[3], len[3], *pos;
+    APBSctx *thee = *ctx;
+    Vatom *atom;
+    Vpmgp *pmgp;
+
+    VASSERT(thee != VNULL);
+
+    /* Move the atoms in place, remembering where the cell lists put them */
+    for (i=0; i<thee->natom; i++) {
+	atom = &(thee->alist[0]->atoms)[i];
+	pos = Vatom_getPosition(atom);
+	for (j=0; j<3; j++) thee->oldpos[3*i+j] = pos[j];
+	coord[0] = x[i];
+	coord[1] = y[i];
+	coord[2] = z[i];
+	Vatom_setPosition(atom, coord);
+	Vatom_setCharge(atom, charge[i]);
+    }
+    apbsBounds(thee->alist[0]);
+    Valist_touch(thee->alist[0]);
+
+    for (i=0; i<thee->nosh->ncalc; i++) {
+	if (thee->pbe[i] == VNULL) continue;
+	if (!Vpbe_updateAtoms(thee->pbe[i], thee->oldpos)) {
+	    Vnm_tprint(2, "apbsupdate_:  failed to update calculation #%d!\n",
+		    i+1);
+	    return APBSRC;
+	}
+
+	/* The grids stay where apbsinit_ put them */
+	pmgp = thee->pmgp[i];
+	if (thee->nosh->calc[i]->mgparm->type == MCT_PARALLEL) continue;
+	cent[0] = pmgp->xcent; cent[1] = pmgp->ycent; cent[2] = pmgp->zcent;
+	len[0] = pmgp->xlen; len[1] = pmgp->ylen; len[2] = pmgp->zlen;
+	for (j=0; j<3; j++) {
+	    if ((thee->alist[0]->mincrd[j] < cent[j] - 0.5*len[j]) ||
+		(thee->alist[0]->maxcrd[j] > cent[j] + 0.5*len[j])) {
+		break;
+	    }
+	}
+	if ((j < 3) && (thee->debug > 0)) {
+	    Vnm_tprint(2, "apbsupdate_:  atoms have left the grid of \
+calculation #%d!\n", i+1);
+	}
+    }
+
+    return 0;
+}
+
+int apbssolve_(
+	       APBSctx **ctx,
+	       double esenergy[1],
+	       double npenergy[1],
+	       double apbsdx[NATOMS], double apbsdy[NATOMS], double apbsdz[NATOMS],
+	       double apbsqfx[NATOMS], double apbsqfy[NATOMS], double apbsqfz[NATOMS],
+	       double apbsibx[NATOMS], double apbsiby[NATOMS], double apbsibz[NATOMS],
+	       double apbsnpx[NATOMS], double apbsnpy[NATOMS], double apbsnpz[NATOMS],
+	       double apbsdbx[NATOMS], double apbsdby[NATOMS], double apbsdbz[NATOMS],
+	       double apbsgrid_meta[13],
+	       double *apbsgrid[]
+	       )
+{
+    int i, focus, rank, debug, rc;
+    APBSctx *thee = *ctx;
+    NOsh *nosh;
+    MGparm *mgparm = VNULL;
+    PBEparm *pbeparm = VNULL;
+    Vpbe *pbe[NOSH_MAXCALC];
+    Vpmgp *pmgp[NOSH_MAXCALC];
+    Vpmg *pmg[NOSH_MAXCALC];
+    double qfEnergy[NOSH_MAXCALC], qmEnergy[NOSH_MAXCALC];
+    double dielEnergy[NOSH_MAXCALC], totEnergy[NOSH_MAXCALC];
+    AtomForce *atomForce[NOSH_MAXCALC];
+    int nenergy[NOSH_MAXCALC], nforce[NOSH_MAXCALC];
+    double realCenter[3];
+    iAPBSout out;
+
+    VASSERT(thee != VNULL);
+    nosh = thee->nosh;
+    rank = Vcom_rank(thee->com);
+    debug = thee->debug;
+    rc = 0;
+
+    for (i=0; i<NOSH_MAXCALC; i++) {
+	pbe[i] = VNULL;
+	pmgp[i] = VNULL;
+	pmg[i] = VNULL;
+	qfEnergy[i] = 0;
+	qmEnergy[i] = 0;
+	dielEnergy[i] = 0;
+	totEnergy[i] = 0;
+	atomForce[i] = VNULL;
+	nenergy[i] = 0;
+	nforce[i] = 0;
+    }
+
+    apbsOutputs(&out, nosh, thee->natom, esenergy, npenergy,
+	    apbsdx, apbsdy, apbsdz, apbsqfx, apbsqfy, apbsqfz,
+	    apbsibx, apbsiby, apbsibz, apbsnpx, apbsnpy, apbsnpz,
+	    apbsdbx, apbsdby, apbsdbz, apbsgrid_meta, apbsgrid);
+
+    for (i=0; i<nosh->ncalc; i++) {
+	if(debug>1) Vnm_tprint( 1, "----------------------------------------\n");
+
+	switch (nosh->calc[i]->calctype) {
+	    case NCT_MG:
+		mgparm = nosh->calc[i]->mgparm;
+		pbeparm = nosh->calc[i]->pbeparm;
+		focus = (pbeparm->bcfl == BCFL_FOCUS);
+		if(debug>1) Vnm_tprint( 1, "CALCULATION #%d: MULTIGRID\n", i+1);
+
+		if (thee->pmg[i] == VNULL) {
+		    /* First solve: set the level up in scratch tables, since
+		     * initMG destroys the previous level, which is kept
+		     * here */
+		    if(debug>1) Vnm_tprint( 1, "  Setting up problem...\n");
+		    if (focus && (i > 0)) {
+			pmg[i-1] = thee->pmg[i-1];
+			pmg[i-1]->pinned = 1;
+		    }
+		    if (!initMG(i, nosh, mgparm, pbeparm, realCenter, pbe,
+			    thee->alist, thee->dielXMap, thee->dielYMap,
+			    thee->dielZMap, thee->kappaMap, thee->chargeMap,
+			    pmgp, pmg, thee->potMap)) {
+			Vnm_tprint( 2, "Error setting up MG calculation!\n");
+			if (focus && (i > 0)) thee->pmg[i-1]->pinned = 0;
+			VJMPERR1(0);
+		    }
+		    if (focus && (i > 0)) thee->pmg[i-1]->pinned = 0;
+		    thee->pbe[i] = pbe[i];
+		    thee->pmgp[i] = pmgp[i];
+		    thee->pmg[i] = pmg[i];
+		    pbe[i] = VNULL;
+		    pmgp[i] = VNULL;
+		    pmg[i] = VNULL;
+		    if (i > 0) pmg[i-1] = VNULL;
+
+		    if(debug>0) printMGPARM(mgparm, realCenter);
+		    if(debug>0) printPBEPARM(pbeparm);
+		} else {
+		    /* Keep the grid, refill the coefficients and start from
+		     * the last potential */
+		    if (!Vpmg_update(thee->pmg[i],
+			    (focus && (i > 0)) ? thee->pmg[i-1] : VNULL,
+			    mgparm, pbeparm->calcenergy)) {
+			Vnm_tprint( 2, "Error updating MG calculation!\n");
+			VJMPERR1(0);
+		    }
+		}
+
+		/* Solve PDE */
+		if (solveMG(nosh, thee->pmg[i], mgparm->type) != 1) {
+		    Vnm_tprint(2, "Error solving PDE!\n");
+		    VJMPERR1(0);
+		}
+
+		/* Set partition information for observables and I/O */
+		if (setPartMG(nosh, mgparm, thee->pmg[i]) != 1) {
+		    Vnm_tprint(2, "Error setting partition info!\n");
+		    VJMPERR1(0);
+		}
+
+		/* Write out energies */
+		energyMG(nosh, i, thee->pmg[i],
+			&(nenergy[i]), &(totEnergy[i]), &(qfEnergy[i]),
+			&(qmEnergy[i]), &(dielEnergy[i]));
+		esenergy[0] = 0.0;
+		esenergy[0] = getElecEnergy(thee->com, nosh, totEnergy, i);
+
+		/* Write out forces */
+		forceMG(thee->mem, nosh, pbeparm, mgparm, thee->pmg[i],
+			&(nforce[i]), &(atomForce[i]), thee->alist);
+
+		/* Return forces and grid data */
+		apbsOutputMG(rank, nosh, pbeparm, thee->pmg[i], atomForce[i],
+			thee->natom, &out);
+		break;
+
+		/* Do an apolar calculation */
+	    case NCT_APOL:
+		if (!apbsApol(nosh, thee->mem, i, &(nforce[i]), &(atomForce[i]),
+			thee->alist, thee->natom, debug, &out)) {
+		    VJMPERR1(0);
+		}
+		break;
+	    default:
+		Vnm_tprint(2, "  Unknown calculation type (%d)!\n",
+			   nosh->calc[i]->calctype);
+		VJMPERR1(0);
+	}
+    }
+
+    /* *************** HANDLE PRINT STATEMENTS ******************* */
+    apbsPrint(thee->com, nosh, totEnergy, nforce, atomForce, debug);
+
+    /* The scratch tables only hold a level that failed to set up */
+    killForce(thee->mem, nosh, nforce, atomForce);
+    for (i=0; i<NOSH_MAXCALC; i++) {
+	Vpmg_dtor(&(pmg[i]));
+	Vpmgp_dtor(&(pmgp[i]));
+	Vpbe_dtor(&(pbe[i]));
+    }
+    Vnm_flush(1);
+    Vnm_flush(2);
+    fflush(NULL);
+    return rc;
+
+VERROR1:
+    rc = APBSRC;
+    for (i=0; i<NOSH_MAXCALC; i++) {
+	if (nforce[i] > 0) Vmem_free(thee->mem, nforce[i], sizeof(AtomForce),
+		(void **)&(atomForce[i]));
+	Vpmg_dtor(&(pmg[i]));
+	Vpmgp_dtor(&(pmgp[i]));
+	Vpbe_dtor(&(pbe[i]));
+    }
+    return rc;
+}
+
+int apbsfree_(APBSctx **ctx)
+{
+    int i;
+    APBSctx *thee = *ctx;
+
+    if (thee == VNULL) return 0;
+
+    /* Release the Vpmg objects before their Vpmgp objects (see killMG) */
+    for (i=0; i<NOSH_MAXCALC; i++) Vpmg_dtor(&(thee->pmg[i]));
+    for (i=0; i<NOSH_MAXCALC; i++) {
+	Vpmgp_dtor(&(thee->pmgp[i]));
+	Vpbe_dtor(&(thee->pbe[i]));
+    }
+    for (i=0; i<NOSH_MAXMOL; i++) {
+	Vgrid_dtor(&(thee->dielXMap[i]));
+	Vgrid_dtor(&(thee->dielYMap[i]));
+	Vgrid_dtor(&(thee->dielZMap[i]));
+	Vgrid_dtor(&(thee->kappaMap[i]));
+	Vgrid_dtor(&(thee->potMap[i]));
+	Vgrid_dtor(&(thee->chargeMap[i]));
+	Valist_dtor(&(thee->alist[i]));
+    }
+    if (thee->oldpos != VNULL) {
+	Vmem_free(thee->mem, 3*thee->natom, sizeof(double),
+		(void **)&(thee->oldpos));
+    }
+    if (thee->nosh != VNULL) NOsh_dtor(&(thee->nosh));
+
+    Vcom_dtor(&(thee->com));
+    Vmem_dtor(&(thee->mem));
+    Vmem_free(VNULL, 1, sizeof(APBSctx), (void **)ctx);
+    *ctx = VNULL;
+
+    return 0;
+}
 
 /**
 * @brief Creates APBS input string
@@ -1037,6 +1457,20 @@ double getElecEnergy(Vcom *com, NOsh *nosh,
     int iarg, calcid;
     double ltenergy, gtenergy, scalar;
     
+    /* Without a matching PRINT statement, report the first ELEC calculation */
+    if (iprint >= nosh->nprint) {
+	calcid = nosh->elec2calc[0];
+	if (nosh->calc[calcid]->pbeparm->calcenergy == PCE_NO) {
+	    Vnm_tprint( 2, "  Didn't calculate energy in Calculation \
+#%d\n", calcid+1);
+	    return 0;
+	}
+	ltenergy = Vunit_kb * (1e-3) * Vunit_Na *
+	    nosh->calc[calcid]->pbeparm->temp * totEnergy[calcid];
+	Vcom_reduce(com, &ltenergy, &gtenergy, 1, 2, 0);
+	return gtenergy;
+    }
+
     calcid = nosh->elec2calc[nosh->printcalc[iprint][0]];
     if (nosh->calc[calcid]->pbeparm->calcenergy != PCE_NO) {
 	ltenergy = Vunit_kb * (1e-3) * Vunit_Na *
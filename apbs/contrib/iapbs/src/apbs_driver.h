@@ -190,6 +190,103 @@ VEXTERNC int apbsdrv_(int *nat,
 		      double apbsgrid_meta[13],
 		      double * apbsgrid[]);
 
+/**
+ * @brief  Persistent iAPBS calculation for repeated solves (see apbsinit_)
+ */
+typedef struct sAPBSctx APBSctx;
+
+/**
+ * @brief  Set up a persistent iAPBS calculation
+ *
+ * Parses the input and builds the molecule once.  The grids, surfaces and
+ * solver work arrays are built by the first apbssolve_ and reused by the
+ * following ones, so molecular dynamics codes can call apbsupdate_ and
+ * apbssolve_ every step instead of apbsdrv_.  The grids do not move with
+ * the atoms; only MG and APOL calculations are supported.
+ *
+ * @param nat ... ionr  As for apbsdrv_
+ * @param (out) ctx  The new calculation
+ * @return  0 if successful, APBSRC otherwise
+ */
+VEXTERNC int apbsinit_(int *nat,
+		       double x[NATOMS],
+		       double y[NATOMS],
+		       double z[NATOMS],
+		       double radius[NATOMS],
+		       double charge[NATOMS],
+		       double r_param[9],
+		       int i_param[25],
+		       double grid[3],
+		       int dime[3],
+		       int pdime[3],
+		       double glen[3],
+		       double center[3],
+		       double cglen[3],
+		       double fglen[3],
+		       double ccenter[3],
+		       double fcenter[3],
+		       double *ofrac,
+		       int *dbg,
+		       double ionq[MAXION],
+		       double ionc[MAXION],
+		       double ionr[MAXION],
+		       APBSctx **ctx);
+
+/**
+ * @brief  Move the atoms and change the charges of a persistent calculation
+ *
+ * Only the cell list entries of atoms that changed cells are rebinned.
+ *
+ * @param ctx  Calculation from apbsinit_
+ * @param x  New atomic coordinates (x)
+ * @param y  New atomic coordinates (y)
+ * @param z  New atomic coordinates (z)
+ * @param charge  New atomic charges
+ * @return  0 if successful, APBSRC otherwise
+ */
+VEXTERNC int apbsupdate_(APBSctx **ctx,
+			 double x[NATOMS],
+			 double y[NATOMS],
+			 double z[NATOMS],
+			 double charge[NATOMS]);
+
+/**
+ * @brief  Solve a persistent calculation for the current atoms
+ *
+ * After the first call, each level starts from its previous potential.
+ *
+ * @param ctx  Calculation from apbsinit_
+ * @param esEnergy ... apbsgrid  As for apbsdrv_
+ * @return  0 if successful, APBSRC otherwise
+ */
+VEXTERNC int apbssolve_(APBSctx **ctx,
+			double esEnergy[1],
+			double npEnergy[1],
+			double apbsdx[NATOMS],
+			double apbsdy[NATOMS],
+			double apbsdz[NATOMS],
+			double apbsqfx[NATOMS],
+			double apbsqfy[NATOMS],
+			double apbsqfz[NATOMS],
+			double apbsibx[NATOMS],
+			double apbsiby[NATOMS],
+			double apbsibz[NATOMS],
+			double apbsnpx[NATOMS],
+			double apbsnpy[NATOMS],
+			double apbsnpz[NATOMS],
+			double apbsdbx[NATOMS],
+			double apbsdby[NATOMS],
+			double apbsdbz[NATOMS],
+			double apbsgrid_meta[13],
+			double * apbsgrid[]);
+
+/**
+ * @brief  Destroy a persistent calculation
+ * @param ctx  Calculation from apbsinit_, set to VNULL
+ * @return  0
+ */
+VEXTERNC int apbsfree_(APBSctx **ctx);
+
 /**
  * @brief  Calculate forces from MG solution
  * @author Robert Konecny (based on forceMG)
@@ -10,6 +10,8 @@ c reads in a file and performs single APBS calculation
 c
       implicit none
       integer rc, apbsdrv, natom, i, j, loop
+      integer apbsinit, apbsupdate, apbssolve, apbsfree, context
+      integer*8 ctx
       character*80 rcsid, finput, pqr
       data rcsid /'$Id: wrapper.f rok $'/
 
@@ -52,7 +54,7 @@ c local
      + cmeth, ccmeth, fcmeth, ionq, ionc, ionrr, 
      + calcenergy, calcforce, calcnpenergy, calcnpforce, apbs_debug, 
      + wpot, wchg, wsmol, ispara, pqr, loop, smvolume, smsize,
-     + wkappa, wdiel, rchg, rkappa, rdiel, watompot, rpot
+     + wkappa, wdiel, rchg, rkappa, rdiel, watompot, rpot, context
 
       integer dummyi
       character dummyc
@@ -133,6 +135,7 @@ c     defaults
 
       apbs_debug = 1
       loop = 1
+      context = 0
 
 c     read in APBS parameters (from a file specified as cmd line param)
       call getarg(1, finput)
@@ -305,6 +308,41 @@ c more intialization
       esenergy = 0.0
       npenergy = 0.0
 
+c with context = 1 the calculation is set up once and solved loop times
+c for the same atoms, as a molecular dynamics code would every step
+      if (context == 1) then
+      rc = apbsinit(natom,x,y,z,radius,charge,r_param,i_param,grid,dime,
+     +     pdime, glen, center, cglen, fglen,
+     +     ccenter, fcenter, ofrac, apbs_debug,
+     +     ionq, ionc, ionrr, ctx)
+      if (rc /= 0) then
+         print *, "main.f: apbsinit return code: ", rc
+         stop 1
+      end if
+
+      do j = 1, loop
+      rc = apbsupdate(ctx, x, y, z, charge)
+      if (rc == 0) rc = apbssolve(ctx, esenergy, npenergy,
+     +     apbsdx, apbsdy, apbsdz,
+     +     apbsqfx, apbsqfy, apbsqfz,
+     +     apbsibx, apbsiby, apbsibz,
+     +     apbsnpx, apbsnpy, apbsnpz,
+     +     apbsdbx, apbsdby, apbsdbz,
+     +     apbsgrid_meta, apbsgrid)
+
+      print *, "main.f: apbs return code: ", rc
+
+      write(*, '(a, f14.8)'), 'esenergy (kJ/mol): ', esenergy(1)
+      write(*, '(a, f14.8)'), 'npenergy (kJ/mol): ', npenergy(1)
+      write(*, '(a, f14.8)'), 'esenergy (kcal/mol): ', esenergy(1)/4.184
+      write(*, '(a, f14.8)'), 'npenergy (kcal/mol): ', npenergy(1)/4.184
+
+      end do
+
+      rc = apbsfree(ctx)
+
+      else
+
 c OK, now we are ready to call the apbs_driver and start the show
       do j = 1, loop
       rc = apbsdrv(natom,x,y,z,radius,charge,r_param,i_param,grid,dime,
@@ -327,6 +365,7 @@ c OK, now we are ready to call the apbs_driver and start the show
       write(*, '(a, f14.8)'), 'npenergy (kcal/mol): ', npenergy(1)/4.184
 
       end do
+      end if
 
       apbsnp(1) = 0.0
       apbsnp(2) = 0.0
@@ -19,7 +19,7 @@ if [ "$1" = "single" ] ; then
     exit
 fi
 
-files="apbs apbs.d9 mol1-auto mol1-manual mol1-manual-loop \
+files="apbs apbs.d9 mol1-auto mol1-manual mol1-manual-loop mol1-context \
  smpbe-ion smpbe-2ala apbs-forces apbs-forces-tot"
 
 for i in $files
@@ -0,0 +1,38 @@
+#!/bin/python
+
+"""
+Create the merged potential map for the mergedx2 test
+
+Each partition of apbs-pot-para.in is run on its own, as the processors of a
+parallel run would, and the partition maps are merged by ownership with
+mergedx2 -p at the spacing of the partitions.
+"""
+
+import subprocess
+
+PROCS = 4
+
+with open("apbs-pot-para.in", "r") as temp:
+    TEMPLATE_TEXT = temp.read()
+
+for rank in range(PROCS):
+    input_txt = TEMPLATE_TEXT.replace("pdime 2 2 1",
+                                      "pdime 2 2 1\n    async %d" % rank)
+    file_name = "apbs-pot-para-PE%d.in" % rank
+    print("Running partition now:", file_name)
+    with open(file_name, "w") as temp:
+        temp.write(input_txt)
+    subprocess.call(["apbs", file_name])
+
+spacing = []
+with open("pot-PE0.dx", "r") as temp:
+    for line in temp:
+        if line.startswith("delta"):
+            spacing.append(line.split()[len(spacing) + 1])
+        elif line.startswith("object 2"):
+            break
+
+part_names = ["pot-PE%d.dx" % rank for rank in range(PROCS)]
+print("Merging partitions now:", " ".join(part_names))
+subprocess.call(["mergedx2", "-p", "-r"] + spacing + ["-o", "merged.dx"] +
+                part_names)
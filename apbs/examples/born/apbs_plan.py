@@ -0,0 +1,41 @@
+#!/bin/python
+
+"""
+Check the messages of the grid planner for the SPACE and GMEMCEIL tests
+
+apbs-mol-reject.in plans a grid that does not fit in its GMEMCEIL, so apbs
+must reject it while setting up the ELEC statements and suggest an mg-para
+processor array.  apbs-mol-gmemceil.in asks for a DIME that does not fit,
+which must be reduced with a warning.  A failed check fails the test.
+"""
+
+import subprocess
+import sys
+
+CHECKS = [
+    ("apbs-mol-reject.in", False,
+     ["SPACE 0.19 needs dime 65 65 65",
+      "more than GMEMCEIL 64 MB!",
+      "Use mg-para with pdime",
+      "Error setting up ELEC calculations"]),
+    ("apbs-mol-gmemceil.in", True,
+     ["Reduced DIME from 129 129 129 to 65 65 65 to fit GMEMCEIL 128 MB."]),
+]
+
+failed = 0
+for (input_file, succeeds, messages) in CHECKS:
+    print("Running now:", input_file)
+    proc = subprocess.run(["apbs", input_file], stdout=subprocess.PIPE,
+                          stderr=subprocess.STDOUT, universal_newlines=True)
+    if (proc.returncode == 0) != succeeds:
+        print("%s: unexpected exit status %d" % (input_file, proc.returncode))
+        failed += 1
+    if not succeeds and "CALCULATION #" in proc.stdout:
+        print("%s: started a calculation" % input_file)
+        failed += 1
+    for message in messages:
+        if message not in proc.stdout:
+            print("%s: missing message: %s" % (input_file, message))
+            failed += 1
+
+sys.exit(1 if failed else 0)
@@ -0,0 +1,16 @@
+#!/bin/python
+
+"""
+Create the streamed potential map for the Vslab test
+
+The coarse potential of apbs-pot-lossy-write.in is passed plane by plane
+through dxmath (see dxmath-slab.txt), which must write it back unchanged.
+"""
+
+import subprocess
+
+print("Running now: apbs-pot-lossy-write.in")
+subprocess.call(["apbs", "apbs-pot-lossy-write.in"])
+
+print("Running now: dxmath dxmath-slab.txt")
+subprocess.call(["dxmath", "dxmath-slab.txt"])
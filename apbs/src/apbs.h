@@ -92,6 +92,8 @@
 #include "mg/vopot.h"
 #include "mg/vpmg.h"
 #include "mg/vpmgp.h"
+#include "mg/vslab.h"
+#include "mg/vwriter.h"
 
 /* FEM headers */
 #if defined(FETK_ENABLED)
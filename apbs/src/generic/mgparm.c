@@ -154,6 +154,8 @@ VPUBLIC Vrc_Codes MGparm_ctor2(MGparm *thee, MGparm_CalcType type) {
     thee->setfglen = 0;
     thee->setcgcent = 0;
     thee->setfgcent = 0;
+    thee->setspace = 0;
+    thee->setgmemceil = 0;
 
     /* *** TYPE 2 PARAMETERS *** */
     thee->setpdime = 0;
@@ -162,6 +164,12 @@ VPUBLIC Vrc_Codes MGparm_ctor2(MGparm *thee, MGparm_CalcType type) {
     thee->setofrac = 0;
     for (i=0; i<6; i++) thee->partDisjOwnSide[i] = 0;
     thee->setasync = 0;
+    thee->threaded = 0;
+    thee->setthreaded = 0;
+    thee->ipart = 0;
+    thee->npart = 1;
+    thee->halo = 0;
+    thee->sethalo = 0;
 
     /* *** Default parameters for TINKER *** */
     thee->chgs = VCM_CHARGE;
@@ -198,11 +206,29 @@ VPUBLIC Vrc_Codes MGparm_check(MGparm *thee) {
         return VRC_FAILURE;
     }
 
-    /* Check generic settings */
-    if (!thee->setdime) {
+    /* Check generic settings; automatic focusing can plan DIME from SPACE */
+    if (!thee->setdime && !thee->setspace) {
         Vnm_print(2, "MGparm_check:  DIME not set!\n");
         rc = VRC_FAILURE;
     }
+    if (thee->setdime && thee->setspace) {
+        Vnm_print(2, "MGparm_check:  Both DIME and SPACE set!\n");
+        rc = VRC_FAILURE;
+    }
+    if ((thee->setspace || thee->setgmemceil) &&
+        (thee->type != MCT_AUTO) && (thee->type != MCT_PARALLEL)) {
+        Vnm_print(2, "MGparm_check:  SPACE and GMEMCEIL are only used by \
+mg-auto and mg-para!\n");
+        rc = VRC_FAILURE;
+    }
+    if (thee->setthreaded && (thee->type != MCT_PARALLEL)) {
+        Vnm_print(2, "MGparm_check:  THREADED is only used by mg-para!\n");
+        rc = VRC_FAILURE;
+    }
+    if (thee->sethalo && !thee->setthreaded) {
+        Vnm_print(2, "MGparm_check:  HALO is only used with THREADED!\n");
+        rc = VRC_FAILURE;
+    }
     if (!thee->setchgm) {
         Vnm_print(2, "MGparm_check: CHGM not set!\n");
         return VRC_FAILURE;
@@ -247,7 +273,8 @@ VPUBLIC Vrc_Codes MGparm_check(MGparm *thee) {
 
     /* Check parallel automatic focusing settings */
     if (thee->type == MCT_PARALLEL) {
-        if (!thee->setpdime) {
+        if (!thee->setpdime &&
+            (!thee->setspace || thee->setasync || thee->setthreaded)) {
             Vnm_print(2, "MGparm_check:  PDIME not set!\n");
             rc = VRC_FAILURE;
         }
@@ -263,10 +290,15 @@ VPUBLIC Vrc_Codes MGparm_check(MGparm *thee) {
             Vnm_print(2, "MGparm_check:  OFRAC not set!\n");
             rc = VRC_FAILURE;
         }
+        if (thee->setasync && thee->setthreaded) {
+            Vnm_print(2, "MGparm_check:  Both ASYNC and THREADED set!\n");
+            rc = VRC_FAILURE;
+        }
     }
 
-    /* Perform a sanity check on nlev and dime, resetting values as necessary */
-    if (rc == 1) {
+    /* Perform a sanity check on nlev and dime, resetting values as necessary;
+     * planned dimensions are valid by construction (see NOsh_setupCalcMGAUTO) */
+    if ((rc == 1) && thee->setdime) {
     /* Calculate the actual number of grid points and nlev to satisfy the
      * formula:  n = c * 2^(l+1) + 1, where n is the number of grid points,
      * c is an integer, and l is the number of levels */
@@ -383,6 +415,10 @@ VPUBLIC void MGparm_copy(MGparm *thee, MGparm *parm) {
     for (i=0; i<3; i++) thee->fcenter[i] = parm->fcenter[i];
     thee->setfgcent = parm->setfgcent;
     thee->fcentmol = parm->fcentmol;
+    thee->space = parm->space;
+    thee->setspace = parm->setspace;
+    thee->gmemceil = parm->gmemceil;
+    thee->setgmemceil = parm->setgmemceil;
 
     /* *** TYPE 2 PARMS *** */
     for (i=0; i<3; i++)
@@ -401,6 +437,12 @@ VPUBLIC void MGparm_copy(MGparm *thee, MGparm *parm) {
     thee->setofrac = parm->setofrac;
     thee->setasync = parm->setasync;
     thee->async = parm->async;
+    thee->threaded = parm->threaded;
+    thee->setthreaded = parm->setthreaded;
+    thee->ipart = parm->ipart;
+    thee->npart = parm->npart;
+    thee->halo = parm->halo;
+    thee->sethalo = parm->sethalo;
 
     thee->nonlintype = parm->nonlintype;
     thee->setnonlintype = parm->setnonlintype;
@@ -727,6 +769,46 @@ keyword!\n", tok);
         return VRC_WARNING;
 }
 
+VPRIVATE Vrc_Codes MGparm_parseSPACE(MGparm *thee, Vio *sock) {
+
+    char tok[VMAX_BUFSIZE];
+    double tf;
+
+    VJMPERR1(Vio_scanf(sock, "%s", tok) == 1);
+    if ((sscanf(tok, "%lf", &tf) == 0) || (tf <= 0.0)) {
+        Vnm_print(2, "NOsh:  Read invalid spacing (%s) while parsing SPACE \
+keyword!\n", tok);
+        return VRC_WARNING;
+    }
+    thee->space = tf;
+    thee->setspace = 1;
+    return VRC_SUCCESS;
+
+    VERROR1:
+        Vnm_print(2, "parseMG:  ran out of tokens!\n");
+        return VRC_WARNING;
+}
+
+VPRIVATE Vrc_Codes MGparm_parseGMEMCEIL(MGparm *thee, Vio *sock) {
+
+    char tok[VMAX_BUFSIZE];
+    double tf;
+
+    VJMPERR1(Vio_scanf(sock, "%s", tok) == 1);
+    if ((sscanf(tok, "%lf", &tf) == 0) || (tf <= 0.0)) {
+        Vnm_print(2, "NOsh:  Read invalid memory size (%s) while parsing \
+GMEMCEIL keyword!\n", tok);
+        return VRC_WARNING;
+    }
+    thee->gmemceil = tf;
+    thee->setgmemceil = 1;
+    return VRC_SUCCESS;
+
+    VERROR1:
+        Vnm_print(2, "parseMG:  ran out of tokens!\n");
+        return VRC_WARNING;
+}
+
 VPRIVATE Vrc_Codes MGparm_parseCGCENT(MGparm *thee, Vio *sock) {
 
     char tok[VMAX_BUFSIZE];
@@ -909,6 +991,36 @@ keyword!\n", tok);
         return VRC_WARNING;
 }
 
+VPRIVATE Vrc_Codes MGparm_parseTHREADED(MGparm *thee, Vio *sock) {
+    thee->threaded = 1;
+    thee->setthreaded = 1;
+    return VRC_SUCCESS;
+}
+
+VPRIVATE Vrc_Codes MGparm_parseHALO(MGparm *thee, Vio *sock) {
+
+    char tok[VMAX_BUFSIZE];
+    int ti;
+
+    VJMPERR1(Vio_scanf(sock, "%s", tok) == 1);
+    if (sscanf(tok, "%i", &ti) == 0) {
+        Vnm_print(2, "NOsh:  Read non-integer (%s) while parsing HALO \
+keyword!\n", tok);
+        return VRC_WARNING;
+    } else if (ti < 0) {
+        Vnm_print(2, "NOsh:  Read negative integer (%d) while parsing HALO \
+keyword!\n", ti);
+        return VRC_WARNING;
+    }
+    thee->halo = ti;
+    thee->sethalo = 1;
+    return VRC_SUCCESS;
+
+    VERROR1:
+        Vnm_print(2, "parseMG:  ran out of tokens!\n");
+        return VRC_WARNING;
+}
+
 VPRIVATE Vrc_Codes MGparm_parseUSEAQUA(MGparm *thee, Vio *sock) {
     Vnm_print(0, "NOsh: parsed useaqua\n");
     thee->useAqua = 1;
@@ -954,12 +1066,20 @@ VPUBLIC Vrc_Codes MGparm_parseToken(MGparm *thee, char tok[VMAX_BUFSIZE],
         return MGparm_parseCGCENT(thee, sock);
     } else if (Vstring_strcasecmp(tok, "fgcent") == 0) {
         return MGparm_parseFGCENT(thee, sock);
+    } else if (Vstring_strcasecmp(tok, "space") == 0) {
+        return MGparm_parseSPACE(thee, sock);
+    } else if (Vstring_strcasecmp(tok, "gmemceil") == 0) {
+        return MGparm_parseGMEMCEIL(thee, sock);
     } else if (Vstring_strcasecmp(tok, "pdime") == 0) {
         return MGparm_parsePDIME(thee, sock);
     } else if (Vstring_strcasecmp(tok, "ofrac") == 0) {
         return MGparm_parseOFRAC(thee, sock);
     } else if (Vstring_strcasecmp(tok, "async") == 0) {
         return MGparm_parseASYNC(thee, sock);
+    } else if (Vstring_strcasecmp(tok, "threaded") == 0) {
+        return MGparm_parseTHREADED(thee, sock);
+    } else if (Vstring_strcasecmp(tok, "halo") == 0) {
+        return MGparm_parseHALO(thee, sock);
     } else if (Vstring_strcasecmp(tok, "gamma") == 0) {
         return MGparm_parseGAMMA(thee, sock);
     } else if (Vstring_strcasecmp(tok, "useaqua") == 0) {
@@ -165,6 +165,12 @@ struct sMGparm {
         This should be the appropriate index in an array of molecules, not the
         positive definite integer specified by the user. */
     int setfgcent;  /**< Flag, @see fcmeth */
+    double space;  /**< Target fine grid spacing; dime (and, for parallel
+                    * focusing, pdime) is planned from it when dime is
+                    * not given */
+    int setspace;  /**< Flag, @see space */
+    double gmemceil;  /**< Grid memory budget per processor (in MB) */
+    int setgmemceil;  /**< Flag, @see gmemceil */
 
 
     /* ********* TYPE 2 PARAMETERS (PARALLEL AUTO-FOCUS) ******** */
@@ -185,6 +191,16 @@ struct sMGparm {
     int setofrac;  /**< Flag, @see ofrac */
     int async; /**< Processor ID for asynchronous calculation */
     int setasync; /**< Flag, @see asynch */
+    int threaded;  /**< Run every partition in this process, sharing the
+                    * coarsest focusing level */
+    int setthreaded;  /**< Flag, @see threaded */
+    int ipart;  /**< Partition of a threaded level; -1 for the shared
+                 * coarsest level (set up by NOsh) */
+    int npart;  /**< Number of partitions of a threaded calculation (set up
+                 * by NOsh) */
+    int halo;  /**< Most boundary exchanges between the finest levels of
+                * threaded partitions */
+    int sethalo;  /**< Flag, @see halo */
 
     int nonlintype; /**< Linearity Type Method to be used */
     int setnonlintype; /**< Flag, @see nonlintype */
@@ -140,6 +140,17 @@ VPRIVATE int NOsh_setupCalcMGPARA(
                                   NOsh_calc *elec
                                   );
 
+VPRIVATE double NOsh_mgMemory(
+                              int dime[3],
+                              int nlev,
+                              Vhal_PBEType pbetype
+                              );
+
+VPRIVATE int NOsh_planMG(
+                         NOsh *thee,
+                         NOsh_calc *elec
+                         );
+
 VPRIVATE int NOsh_setupCalcFEM(
                                NOsh *thee,
                                NOsh_calc *elec
@@ -305,6 +316,236 @@ VPUBLIC int NOsh_printCalc(NOsh *thee, int iprint, int iarg) {
     return thee->printcalc[iprint][iarg];
 }
 
+VPUBLIC int NOsh_print2calc(NOsh *thee, int iprint, int iarg) {
+
+    int id;
+
+    VASSERT(thee != VNULL);
+    VASSERT(iprint < thee->nprint);
+    VASSERT(iarg < thee->printnarg[iprint]);
+
+    id = thee->printcalc[iprint][iarg];
+    switch (thee->printwhat[iprint]) {
+        case NPT_APOLENERGY:
+        case NPT_APOLFORCE:
+            if ((id < 0) || (id >= thee->napol)) return -1;
+            return thee->apol2calc[id];
+        default:
+            if ((id < 0) || (id >= thee->nelec)) return -1;
+            return thee->elec2calc[id];
+    }
+}
+
+VPUBLIC int NOsh_focusParent(NOsh *thee, int icalc) {
+
+    NOsh_calc *calc;
+
+    VASSERT(thee != VNULL);
+    VASSERT(icalc < thee->ncalc);
+
+    if (icalc < 1) return -1;
+    calc = thee->calc[icalc];
+    if ((calc->calctype != NCT_MG) || (calc->pbeparm == VNULL) ||
+        (calc->pbeparm->bcfl != BCFL_FOCUS)) return -1;
+
+    /* The first level of each partition of a threaded parallel calculation
+        focuses from the coarsest level they share */
+    if (calc->mgparm->threaded && (calc->mgparm->ipart >= 0) &&
+        (thee->calc[icalc-1]->mgparm->ipart != calc->mgparm->ipart)) {
+        for (icalc--; icalc>0; icalc--) {
+            if (thee->calc[icalc]->mgparm->ipart == -1) break;
+        }
+        return icalc;
+    }
+    return icalc-1;
+}
+
+VPUBLIC double NOsh_calcMemory(NOsh *thee, int icalc) {
+
+    NOsh_calc *calc;
+
+    VASSERT(thee != VNULL);
+    VASSERT(icalc < thee->ncalc);
+
+    calc = thee->calc[icalc];
+    if ((calc->calctype != NCT_MG) || (calc->pbeparm == VNULL)) return 0.0;
+    return NOsh_mgMemory(calc->mgparm->dime, calc->mgparm->nlev,
+                         calc->pbeparm->pbetype);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  NOsh_growTable
+//
+// Purpose:  Resize a table of num entries of the given size to newnum
+//           entries, keeping its contents and zeroing the new entries
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void NOsh_growTable(void **table, int num, int newnum, size_t size) {
+
+    void *newtable = VNULL;
+
+    newtable = Vmem_malloc(VNULL, newnum, size);
+    VASSERT(newtable != VNULL);
+    memset(newtable, 0, newnum*size);
+    if (*table != VNULL) {
+        memcpy(newtable, *table, num*size);
+        Vmem_free(VNULL, num, size, table);
+    }
+    *table = newtable;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  NOsh_freeTable
+//
+// Purpose:  Release a table allocated by NOsh_growTable
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void NOsh_freeTable(void **table, int num, size_t size) {
+    if (*table != VNULL) Vmem_free(VNULL, num, size, table);
+    *table = VNULL;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  NOsh_newSize
+//
+// Purpose:  Return the size a table of max entries has to grow to for entry
+//           i to be valid, or 0 if it is already large enough.  One spare
+//           (zeroed) entry is always kept past the last valid index.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int NOsh_newSize(int i, int max, int init) {
+    if ((i+1) < max) return 0;
+    return VMAX2(VMAX2(2*max, init), i+2);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  NOsh_growCalc, NOsh_growElec, NOsh_growApol, NOsh_growMol,
+//           NOsh_growDiel, NOsh_growKappa, NOsh_growPot, NOsh_growCharge,
+//           NOsh_growMesh, NOsh_growPrint, NOsh_growPop
+//
+// Purpose:  Make entry i of the corresponding group of tables valid
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void NOsh_growCalc(NOsh *thee, int i) {
+    int newmax = NOsh_newSize(i, thee->maxcalc, NOSH_MAXCALC);
+    if (newmax == 0) return;
+    NOsh_growTable((void **)&(thee->calc), thee->maxcalc, newmax,
+                   sizeof(NOsh_calc *));
+    thee->maxcalc = newmax;
+}
+
+VPRIVATE void NOsh_growElec(NOsh *thee, int i) {
+    int newmax = NOsh_newSize(i, thee->maxelec, NOSH_MAXCALC);
+    if (newmax == 0) return;
+    NOsh_growTable((void **)&(thee->elec), thee->maxelec, newmax,
+                   sizeof(NOsh_calc *));
+    NOsh_growTable((void **)&(thee->elec2calc), thee->maxelec, newmax,
+                   sizeof(int));
+    NOsh_growTable((void **)&(thee->elecname), thee->maxelec, newmax,
+                   sizeof(*(thee->elecname)));
+    thee->maxelec = newmax;
+}
+
+VPRIVATE void NOsh_growApol(NOsh *thee, int i) {
+    int newmax = NOsh_newSize(i, thee->maxapol, NOSH_MAXCALC);
+    if (newmax == 0) return;
+    NOsh_growTable((void **)&(thee->apol), thee->maxapol, newmax,
+                   sizeof(NOsh_calc *));
+    NOsh_growTable((void **)&(thee->apol2calc), thee->maxapol, newmax,
+                   sizeof(int));
+    NOsh_growTable((void **)&(thee->apolname), thee->maxapol, newmax,
+                   sizeof(*(thee->apolname)));
+    thee->maxapol = newmax;
+}
+
+VPRIVATE void NOsh_growMol(NOsh *thee, int i) {
+    int newmax = NOsh_newSize(i, thee->maxmol, NOSH_MAXMOL);
+    if (newmax == 0) return;
+    NOsh_growTable((void **)&(thee->molpath), thee->maxmol, newmax,
+                   sizeof(*(thee->molpath)));
+    NOsh_growTable((void **)&(thee->molfmt), thee->maxmol, newmax,
+                   sizeof(NOsh_MolFormat));
+    NOsh_growTable((void **)&(thee->alist), thee->maxmol, newmax,
+                   sizeof(Valist *));
+    thee->maxmol = newmax;
+}
+
+VPRIVATE void NOsh_growDiel(NOsh *thee, int i) {
+    int newmax = NOsh_newSize(i, thee->maxdiel, NOSH_MAXMOL);
+    if (newmax == 0) return;
+    NOsh_growTable((void **)&(thee->dielXpath), thee->maxdiel, newmax,
+                   sizeof(*(thee->dielXpath)));
+    NOsh_growTable((void **)&(thee->dielYpath), thee->maxdiel, newmax,
+                   sizeof(*(thee->dielYpath)));
+    NOsh_growTable((void **)&(thee->dielZpath), thee->maxdiel, newmax,
+                   sizeof(*(thee->dielZpath)));
+    NOsh_growTable((void **)&(thee->dielfmt), thee->maxdiel, newmax,
+                   sizeof(Vdata_Format));
+    thee->maxdiel = newmax;
+}
+
+VPRIVATE void NOsh_growKappa(NOsh *thee, int i) {
+    int newmax = NOsh_newSize(i, thee->maxkappa, NOSH_MAXMOL);
+    if (newmax == 0) return;
+    NOsh_growTable((void **)&(thee->kappapath), thee->maxkappa, newmax,
+                   sizeof(*(thee->kappapath)));
+    NOsh_growTable((void **)&(thee->kappafmt), thee->maxkappa, newmax,
+                   sizeof(Vdata_Format));
+    thee->maxkappa = newmax;
+}
+
+VPRIVATE void NOsh_growPot(NOsh *thee, int i) {
+    int newmax = NOsh_newSize(i, thee->maxpot, NOSH_MAXMOL);
+    if (newmax == 0) return;
+    NOsh_growTable((void **)&(thee->potpath), thee->maxpot, newmax,
+                   sizeof(*(thee->potpath)));
+    NOsh_growTable((void **)&(thee->potfmt), thee->maxpot, newmax,
+                   sizeof(Vdata_Format));
+    thee->maxpot = newmax;
+}
+
+VPRIVATE void NOsh_growCharge(NOsh *thee, int i) {
+    int newmax = NOsh_newSize(i, thee->maxcharge, NOSH_MAXMOL);
+    if (newmax == 0) return;
+    NOsh_growTable((void **)&(thee->chargepath), thee->maxcharge, newmax,
+                   sizeof(*(thee->chargepath)));
+    NOsh_growTable((void **)&(thee->chargefmt), thee->maxcharge, newmax,
+                   sizeof(Vdata_Format));
+    thee->maxcharge = newmax;
+}
+
+VPRIVATE void NOsh_growMesh(NOsh *thee, int i) {
+    int newmax = NOsh_newSize(i, thee->maxmesh, NOSH_MAXMOL);
+    if (newmax == 0) return;
+    NOsh_growTable((void **)&(thee->meshpath), thee->maxmesh, newmax,
+                   sizeof(*(thee->meshpath)));
+    NOsh_growTable((void **)&(thee->meshfmt), thee->maxmesh, newmax,
+                   sizeof(Vdata_Format));
+    thee->maxmesh = newmax;
+}
+
+VPRIVATE void NOsh_growPrint(NOsh *thee, int i) {
+    int newmax = NOsh_newSize(i, thee->maxprint, NOSH_MAXPRINT);
+    if (newmax == 0) return;
+    NOsh_growTable((void **)&(thee->printwhat), thee->maxprint, newmax,
+                   sizeof(NOsh_PrintType));
+    NOsh_growTable((void **)&(thee->printnarg), thee->maxprint, newmax,
+                   sizeof(int));
+    NOsh_growTable((void **)&(thee->maxpop), thee->maxprint, newmax,
+                   sizeof(int));
+    NOsh_growTable((void **)&(thee->printcalc), thee->maxprint, newmax,
+                   sizeof(int *));
+    NOsh_growTable((void **)&(thee->printop), thee->maxprint, newmax,
+                   sizeof(int *));
+    thee->maxprint = newmax;
+}
+
+VPRIVATE void NOsh_growPop(NOsh *thee, int iprint, int i) {
+    int newmax = NOsh_newSize(i, thee->maxpop[iprint], NOSH_MAXPOP);
+    if (newmax == 0) return;
+    NOsh_growTable((void **)&(thee->printcalc[iprint]), thee->maxpop[iprint],
+                   newmax, sizeof(int));
+    NOsh_growTable((void **)&(thee->printop[iprint]), thee->maxpop[iprint],
+                   newmax, sizeof(int));
+    thee->maxpop[iprint] = newmax;
+}
+
 VPUBLIC NOsh* NOsh_ctor(int rank, int size) {
 
     /* Set up the structure */
@@ -318,8 +559,6 @@ VPUBLIC NOsh* NOsh_ctor(int rank, int size) {
 
 VPUBLIC int NOsh_ctor2(NOsh *thee, int rank, int size) {
 
-    int i;
-
     if (thee == VNULL) return 0;
 
     thee->proc_rank = rank;
@@ -335,19 +574,57 @@ VPUBLIC int NOsh_ctor2(NOsh *thee, int rank, int size) {
     thee->nkappa = 0;
     thee->npot = 0;
     thee->nprint = 0;
-
-    for (i=0; i<NOSH_MAXCALC; i++) {
-        thee->calc[i] = VNULL;
-        thee->elec[i] = VNULL;
-        thee->apol[i] = VNULL;
-    }
-    for (i=0; i<NOSH_MAXMOL; i++) {
-        thee->alist[i] = VNULL;
-    }
+    thee->nmesh = 0;
     thee->ncalc = 0;
     thee->nelec = 0;
     thee->napol = 0;
 
+    /* The tables start empty and grow as the input file is parsed */
+    thee->maxcalc = 0;
+    thee->calc = VNULL;
+    thee->maxelec = 0;
+    thee->elec = VNULL;
+    thee->elec2calc = VNULL;
+    thee->elecname = VNULL;
+    thee->maxapol = 0;
+    thee->apol = VNULL;
+    thee->apol2calc = VNULL;
+    thee->apolname = VNULL;
+    thee->maxmol = 0;
+    thee->molpath = VNULL;
+    thee->molfmt = VNULL;
+    thee->alist = VNULL;
+    thee->maxdiel = 0;
+    thee->dielXpath = VNULL;
+    thee->dielYpath = VNULL;
+    thee->dielZpath = VNULL;
+    thee->dielfmt = VNULL;
+    thee->maxkappa = 0;
+    thee->kappapath = VNULL;
+    thee->kappafmt = VNULL;
+    thee->maxpot = 0;
+    thee->potpath = VNULL;
+    thee->potfmt = VNULL;
+    thee->maxcharge = 0;
+    thee->chargepath = VNULL;
+    thee->chargefmt = VNULL;
+    thee->maxmesh = 0;
+    thee->meshpath = VNULL;
+    thee->meshfmt = VNULL;
+    thee->maxprint = 0;
+    thee->printwhat = VNULL;
+    thee->printnarg = VNULL;
+    thee->maxpop = VNULL;
+    thee->printcalc = VNULL;
+    thee->printop = VNULL;
+
+    /* Make sure the first entry of each table is valid */
+    NOsh_growCalc(thee, 0);
+    NOsh_growElec(thee, 0);
+    NOsh_growApol(thee, 0);
+    NOsh_growMol(thee, 0);
+    NOsh_growPrint(thee, 0);
+
     return 1;
 }
 
@@ -367,6 +644,77 @@ VPUBLIC void NOsh_dtor2(NOsh *thee) {
         for (i=0; i<(thee->ncalc); i++) NOsh_calc_dtor(&(thee->calc[i]));
         for (i=0; i<(thee->nelec); i++) NOsh_calc_dtor(&(thee->elec[i]));
         for (i=0; i<(thee->napol); i++) NOsh_calc_dtor(&(thee->apol[i]));
+
+        for (i=0; i<(thee->maxprint); i++) {
+            NOsh_freeTable((void **)&(thee->printcalc[i]), thee->maxpop[i],
+                           sizeof(int));
+            NOsh_freeTable((void **)&(thee->printop[i]), thee->maxpop[i],
+                           sizeof(int));
+        }
+        NOsh_freeTable((void **)&(thee->printwhat), thee->maxprint,
+                       sizeof(NOsh_PrintType));
+        NOsh_freeTable((void **)&(thee->printnarg), thee->maxprint,
+                       sizeof(int));
+        NOsh_freeTable((void **)&(thee->maxpop), thee->maxprint, sizeof(int));
+        NOsh_freeTable((void **)&(thee->printcalc), thee->maxprint,
+                       sizeof(int *));
+        NOsh_freeTable((void **)&(thee->printop), thee->maxprint,
+                       sizeof(int *));
+        thee->maxprint = 0;
+
+        NOsh_freeTable((void **)&(thee->calc), thee->maxcalc,
+                       sizeof(NOsh_calc *));
+        thee->maxcalc = 0;
+        NOsh_freeTable((void **)&(thee->elec), thee->maxelec,
+                       sizeof(NOsh_calc *));
+        NOsh_freeTable((void **)&(thee->elec2calc), thee->maxelec,
+                       sizeof(int));
+        NOsh_freeTable((void **)&(thee->elecname), thee->maxelec,
+                       sizeof(*(thee->elecname)));
+        thee->maxelec = 0;
+        NOsh_freeTable((void **)&(thee->apol), thee->maxapol,
+                       sizeof(NOsh_calc *));
+        NOsh_freeTable((void **)&(thee->apol2calc), thee->maxapol,
+                       sizeof(int));
+        NOsh_freeTable((void **)&(thee->apolname), thee->maxapol,
+                       sizeof(*(thee->apolname)));
+        thee->maxapol = 0;
+        NOsh_freeTable((void **)&(thee->molpath), thee->maxmol,
+                       sizeof(*(thee->molpath)));
+        NOsh_freeTable((void **)&(thee->molfmt), thee->maxmol,
+                       sizeof(NOsh_MolFormat));
+        NOsh_freeTable((void **)&(thee->alist), thee->maxmol,
+                       sizeof(Valist *));
+        thee->maxmol = 0;
+        NOsh_freeTable((void **)&(thee->dielXpath), thee->maxdiel,
+                       sizeof(*(thee->dielXpath)));
+        NOsh_freeTable((void **)&(thee->dielYpath), thee->maxdiel,
+                       sizeof(*(thee->dielYpath)));
+        NOsh_freeTable((void **)&(thee->dielZpath), thee->maxdiel,
+                       sizeof(*(thee->dielZpath)));
+        NOsh_freeTable((void **)&(thee->dielfmt), thee->maxdiel,
+                       sizeof(Vdata_Format));
+        thee->maxdiel = 0;
+        NOsh_freeTable((void **)&(thee->kappapath), thee->maxkappa,
+                       sizeof(*(thee->kappapath)));
+        NOsh_freeTable((void **)&(thee->kappafmt), thee->maxkappa,
+                       sizeof(Vdata_Format));
+        thee->maxkappa = 0;
+        NOsh_freeTable((void **)&(thee->potpath), thee->maxpot,
+                       sizeof(*(thee->potpath)));
+        NOsh_freeTable((void **)&(thee->potfmt), thee->maxpot,
+                       sizeof(Vdata_Format));
+        thee->maxpot = 0;
+        NOsh_freeTable((void **)&(thee->chargepath), thee->maxcharge,
+                       sizeof(*(thee->chargepath)));
+        NOsh_freeTable((void **)&(thee->chargefmt), thee->maxcharge,
+                       sizeof(Vdata_Format));
+        thee->maxcharge = 0;
+        NOsh_freeTable((void **)&(thee->meshpath), thee->maxmesh,
+                       sizeof(*(thee->meshpath)));
+        NOsh_freeTable((void **)&(thee->meshfmt), thee->maxmesh,
+                       sizeof(Vdata_Format));
+        thee->maxmesh = 0;
     }
 
 }
@@ -617,6 +965,7 @@ VPRIVATE int NOsh_parseREAD_MOL(NOsh *thee, Vio *sock) {
         }
         Vnm_print(0, "NOsh: Storing molecule %d path %s\n",
                   thee->nmol, tok);
+        NOsh_growMol(thee, thee->nmol);
         thee->molfmt[thee->nmol] = molfmt;
         strncpy(thee->molpath[thee->nmol], tok, VMAX_ARGLEN);
         (thee->nmol)++;
@@ -636,6 +985,7 @@ VPRIVATE int NOsh_parseREAD_MOL(NOsh *thee, Vio *sock) {
         }
         Vnm_print(0, "NOsh: Storing molecule %d path %s\n",
                   thee->nmol, tok);
+        NOsh_growMol(thee, thee->nmol);
         thee->molfmt[thee->nmol] = molfmt;
         strncpy(thee->molpath[thee->nmol], tok, VMAX_ARGLEN);
         (thee->nmol)++;
@@ -655,6 +1005,27 @@ VPRIVATE int NOsh_parseREAD_MOL(NOsh *thee, Vio *sock) {
         }
         Vnm_print(0, "NOsh: Storing molecule %d path %s\n",
                   thee->nmol, tok);
+        NOsh_growMol(thee, thee->nmol);
+        thee->molfmt[thee->nmol] = molfmt;
+        strncpy(thee->molpath[thee->nmol], tok, VMAX_ARGLEN);
+        (thee->nmol)++;
+    } else if (Vstring_strcasecmp(tok, "bin") == 0) {
+        molfmt = NMF_BIN;
+        VJMPERR1(Vio_scanf(sock, "%s", tok) == 1);
+        if (tok[0]=='"') {
+            strcpy(strnew, "");
+            while (tok[strlen(tok)-1] != '"') {
+                strcat(str, tok);
+                strcat(str, " ");
+                VJMPERR1(Vio_scanf(sock, "%s", tok) == 1);
+            }
+            strcat(str, tok);
+            strncpy(strnew, str+1, strlen(str)-2);
+            strcpy(tok, strnew);
+        }
+        Vnm_print(0, "NOsh: Storing molecule %d path %s\n",
+                  thee->nmol, tok);
+        NOsh_growMol(thee, thee->nmol);
         thee->molfmt[thee->nmol] = molfmt;
         strncpy(thee->molpath[thee->nmol], tok, VMAX_ARGLEN);
         (thee->nmol)++;
@@ -749,6 +1120,8 @@ VPRIVATE int NOsh_parseREAD_DIEL(NOsh *thee, Vio *sock) {
     	dielfmt = VDF_DXBIN;
     }else if (Vstring_strcasecmp(tok, "gz") == 0) {
         dielfmt = VDF_GZ;
+    } else if (Vstring_strcasecmp(tok, "raw") == 0) {
+        dielfmt = VDF_RAW;
     } else {
         Vnm_print(2, "NOsh_parseREAD:  Ignoring undefined format \
                   %s!\n", tok);
@@ -767,6 +1140,7 @@ VPRIVATE int NOsh_parseREAD_DIEL(NOsh *thee, Vio *sock) {
         strncpy(strnew, str+1, strlen(str)-2);
         strcpy(tok, strnew);
     }
+    NOsh_growDiel(thee, thee->ndiel);
     Vnm_print(0, "NOsh: Storing x-shifted dielectric map %d path \
               %s\n", thee->ndiel, tok);
     strncpy(thee->dielXpath[thee->ndiel], tok, VMAX_ARGLEN);
@@ -802,6 +1176,8 @@ VPRIVATE int NOsh_parseREAD_KAPPA(NOsh *thee, Vio *sock) {
         kappafmt = VDF_GZ;
     } else if (Vstring_strcasecmp(tok,"dxbin") == 0) {
     	kappafmt = VDF_DXBIN;
+    } else if (Vstring_strcasecmp(tok, "raw") == 0) {
+        kappafmt = VDF_RAW;
     } else {
 
         Vnm_print(2, "NOsh_parseREAD:  Ignoring undefined format \
@@ -823,6 +1199,7 @@ VPRIVATE int NOsh_parseREAD_KAPPA(NOsh *thee, Vio *sock) {
     }
     Vnm_print(0, "NOsh: Storing kappa map %d path %s\n",
               thee->nkappa, tok);
+    NOsh_growKappa(thee, thee->nkappa);
     thee->kappafmt[thee->nkappa] = kappafmt;
     strncpy(thee->kappapath[thee->nkappa], tok, VMAX_ARGLEN);
     (thee->nkappa)++;
@@ -848,6 +1225,10 @@ VPRIVATE int NOsh_parseREAD_POTENTIAL(NOsh *thee, Vio *sock) {
         potfmt = VDF_GZ;
     } else if(Vstring_strcasecmp(tok, "dxbin") == 0){
     	potfmt = VDF_DXBIN;
+    } else if (Vstring_strcasecmp(tok, "raw") == 0) {
+        potfmt = VDF_RAW;
+    } else if (Vstring_strcasecmp(tok, "lossy") == 0) {
+        potfmt = VDF_LOSSY;
     } else {
         Vnm_print(2, "NOsh_parseREAD:  Ignoring undefined format \
                   %s!\n", tok);
@@ -868,6 +1249,7 @@ VPRIVATE int NOsh_parseREAD_POTENTIAL(NOsh *thee, Vio *sock) {
     }
     Vnm_print(0, "NOsh: Storing potential map %d path %s\n",
               thee->npot, tok);
+    NOsh_growPot(thee, thee->npot);
     thee->potfmt[thee->npot] = potfmt;
     strncpy(thee->potpath[thee->npot], tok, VMAX_ARGLEN);
     (thee->npot)++;
@@ -894,6 +1276,8 @@ VPRIVATE int NOsh_parseREAD_CHARGE(NOsh *thee, Vio *sock) {
     	chargefmt = VDF_DXBIN;
     }else if (Vstring_strcasecmp(tok, "gz") == 0) {
         chargefmt = VDF_GZ;
+    } else if (Vstring_strcasecmp(tok, "raw") == 0) {
+        chargefmt = VDF_RAW;
     } else {
         Vnm_print(2, "NOsh_parseREAD:  Ignoring undefined format \
                   %s!\n", tok);
@@ -914,6 +1298,7 @@ VPRIVATE int NOsh_parseREAD_CHARGE(NOsh *thee, Vio *sock) {
     }
     Vnm_print(0, "NOsh: Storing charge map %d path %s\n",
               thee->ncharge, tok);
+    NOsh_growCharge(thee, thee->ncharge);
     thee->chargefmt[thee->ncharge] = chargefmt;
     strncpy(thee->chargepath[thee->ncharge], tok, VMAX_ARGLEN);
     (thee->ncharge)++;
@@ -949,6 +1334,7 @@ VPRIVATE int NOsh_parseREAD_MESH(NOsh *thee, Vio *sock) {
         }
         Vnm_print(0, "NOsh: Storing mesh %d path %s\n",
                   thee->nmesh, tok);
+        NOsh_growMesh(thee, thee->nmesh);
         thee->meshfmt[thee->nmesh] = meshfmt;
         strncpy(thee->meshpath[thee->nmesh], tok, VMAX_ARGLEN);
         (thee->nmesh)++;
@@ -1040,12 +1426,7 @@ VPRIVATE int NOsh_parsePRINT(NOsh *thee, Vio *sock) {
     }
 
     idx = thee->nprint;
-    if (thee->nprint >= NOSH_MAXPRINT) {
-        Vnm_print(2, "NOsh_parsePRINT:  Exceeded max number (%d) of PRINT \
-sections\n",
-                  NOSH_MAXPRINT);
-        return 0;
-    }
+    NOsh_growPrint(thee, idx);
 
 
     /* The first thing we read is the thing we want to print */
@@ -1096,6 +1477,7 @@ PRINT section!\n", tok);
             if ((sscanf(tok, "%d", &ti) == 1) &&
                 (Vstring_isdigit(tok) == 1)) {
                 if (expect == 0) {
+                    NOsh_growPop(thee, idx, thee->printnarg[idx]);
                     thee->printcalc[idx][thee->printnarg[idx]] = ti-1;
                     expect = 1;
                 } else {
@@ -1109,12 +1491,6 @@ section while reading %s!\n", tok);
                     thee->printop[idx][thee->printnarg[idx]] = 0;
                     (thee->printnarg[idx])++;
                     expect = 0;
-                    if (thee->printnarg[idx] >= NOSH_MAXPOP) {
-                        Vnm_print(2, "NOsh_parsePRINT:  Exceeded max number \
-(%d) of arguments for PRINT section!\n",
-                                  NOSH_MAXPOP);
-                        return 0;
-                    }
                 } else {
                     Vnm_print(2, "NOsh_parsePRINT:  Syntax error in PRINT \
 section while reading %s!\n", tok);
@@ -1126,12 +1502,6 @@ section while reading %s!\n", tok);
                     thee->printop[idx][thee->printnarg[idx]] = 1;
                     (thee->printnarg[idx])++;
                     expect = 0;
-                    if (thee->printnarg[idx] >= NOSH_MAXPOP) {
-                        Vnm_print(2, "NOsh_parseREAD:  Exceeded max number \
-(%d) of arguments for PRINT section!\n",
-                                  NOSH_MAXPOP);
-                        return 0;
-                    }
                 } else {
                     Vnm_print(2, "NOsh_parsePRINT:  Syntax error in PRINT \
 section while reading %s!\n", tok);
@@ -1140,6 +1510,7 @@ section while reading %s!\n", tok);
                 /* Grab a calculation name from elec ID */
             } else if (sscanf(tok, "%s", name) == 1) {
                 if (expect == 0) {
+                    NOsh_growPop(thee, idx, thee->printnarg[idx]);
                     for (ielec=0; ielec<thee->nelec; ielec++) {
                         if (Vstring_strcasecmp(thee->elecname[ielec], name) == 0) {
                             thee->printcalc[idx][thee->printnarg[idx]] = ielec;
@@ -1205,15 +1576,8 @@ VPRIVATE int NOsh_parseELEC(NOsh *thee, Vio *sock) {
         return 0;
     }
 
-    /* Get a pointer to the latest ELEC calc object and update the ELEC
-        statement number */
-    if (thee->nelec >= NOSH_MAXCALC) {
-        Vnm_print(2, "NOsh:  Too many electrostatics calculations in this \
-run!\n");
-        Vnm_print(2, "NOsh:  Current max is %d; ignoring this calculation\n",
-                  NOSH_MAXCALC);
-        return 1;
-    }
+    /* Make room for the next ELEC statement */
+    NOsh_growElec(thee, thee->nelec);
 
     /* The next token HAS to be the method OR "name" */
     if (Vio_scanf(sock, "%s", tok) == 1) {
@@ -1331,15 +1695,8 @@ VPRIVATE int NOsh_parseAPOLAR(NOsh *thee, Vio *sock) {
         return 0;
     }
 
-    /* Get a pointer to the latest ELEC calc object and update the ELEC
-        statement number */
-    if (thee->napol >= NOSH_MAXCALC) {
-        Vnm_print(2, "NOsh:  Too many non-polar calculations in this \
-run!\n");
-        Vnm_print(2, "NOsh:  Current max is %d; ignoring this calculation\n",
-                  NOSH_MAXCALC);
-        return 1;
-    }
+    /* Make room for the next APOLAR statement */
+    NOsh_growApol(thee, thee->napol);
 
     /* The next token HAS to be the method OR "name" */
     if (Vio_scanf(sock, "%s", tok) == 1) {
@@ -1431,7 +1788,7 @@ map is used!\n");
                         mgparm->ccenter[i] = mymol->center[i];
                     }
                 }
-                NOsh_setupCalcMG(thee, elec);
+                if (!NOsh_setupCalcMG(thee, elec)) return 0;
                 break;
             case NCT_FEM:
                 NOsh_setupCalcFEM(thee, elec);
@@ -1788,15 +2145,8 @@ set up?\n");
         mgparm->glen[2] = mgparm->grid[2]*((double)(mgparm->dime[2]-1));
     }
 
-    /* Check to see if he have any room left for this type of calculation, if
-        so: set the calculation type, update the number of calculations of this type,
-        and parse the rest of the section */
-    if (thee->ncalc >= NOSH_MAXCALC) {
-        Vnm_print(2, "NOsh:  Too many calculations in this run!\n");
-        Vnm_print(2, "NOsh:  Current max is %d; ignoring this calculation\n",
-                  NOSH_MAXCALC);
-        return 0;
-    }
+    /* Make room for this calculation in the calc table */
+    NOsh_growCalc(thee, thee->ncalc);
 
     /* Get the next calculation object and increment the number of calculations */
     thee->calc[thee->ncalc] = NOsh_calc_ctor(NCT_MG);
@@ -1812,6 +2162,263 @@ set up?\n");
     return 1;
 }
 
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  NOsh_mgLevels
+//
+// Purpose:  Return the number of multigrid levels MGparm_check picks for the
+//           given grid dimensions
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int NOsh_mgLevels(int dime[3]) {
+
+    int i, ti, tnlev, nlev = -1;
+
+    for (i=0; i<3; i++) {
+        ti = dime[i] - 1;
+        tnlev = 0;
+        while (VEVEN(ti)) {
+            tnlev++;
+            ti = ti/2;
+        }
+        tnlev--;
+        if ((nlev < 0) || (tnlev < nlev)) nlev = tnlev;
+    }
+
+    return nlev;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  NOsh_mgMemory
+//
+// Purpose:  Return the number of bytes Vpmg_ctor2 allocates for one
+//           multigrid level:  the solver workspace sized as in Vpmgp_size
+//           (banded coarse-grid solve for the LPBE, Newton storage for the
+//           NPBE), the coefficient and solution arrays, the partition vector
+//           and the boundary arrays.  The molecule, surface and map objects
+//           are not counted.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE double NOsh_mgMemory(int dime[3], int nlev, Vhal_PBEType pbetype) {
+
+    double nx, ny, nz, nf, narr, narrc, nrwk, niwk;
+    int nxc, nyc, nzc, level;
+
+    nx = (double)dime[0];
+    ny = (double)dime[1];
+    nz = (double)dime[2];
+    nf = nx*ny*nz;
+    narr = nf;
+    nxc = dime[0];
+    nyc = dime[1];
+    nzc = dime[2];
+    for (level=2; level<=nlev; level++) {
+        nxc = (nxc - 1)/2 + 1;
+        nyc = (nyc - 1)/2 + 1;
+        nzc = (nzc - 1)/2 + 1;
+        narr += (double)nxc*(double)nyc*(double)nzc;
+    }
+    narrc = narr - nf;
+
+    /* Box discretization with Galerkin coarsening */
+    nrwk = 2.0*narr + 4.0*nf + 41.0*narrc + 100.0*(nlev + 1);
+    if (pbetype == PBE_NPBE) {
+        nrwk += 2.0*nf;
+    } else {
+        nrwk += (double)(nxc-2)*(double)(nyc-2)*(double)(nzc-2)
+            *(2.0 + (double)(nxc-2)*(double)(nyc-2) + (double)(nxc-2));
+    }
+    niwk = 150.0*(nlev + 1);
+
+    return sizeof(double)*(nrwk + 13.0*narr + nf
+                           + 10.0*(ny*nz + nx*nz + nx*ny)
+                           + 5.0*(nx + ny + nz) + 100.0)
+        + sizeof(int)*(niwk + 100.0);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  NOsh_mgFitDime
+//
+// Purpose:  Return the smallest number of grid points (32c+1) that gives a
+//           fine grid spacing no larger than space along an axis of length
+//           len split over np processors, or -1 if no reasonable number does
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int NOsh_mgFitDime(double len, int np, double ofrac, double space) {
+
+    double h;
+    int dime, disj;
+
+    for (dime=33; dime<=NOSH_MGMAXDIME; dime+=32) {
+        if (np < 2) {
+            h = len/((double)(dime - 1));
+        } else {
+            disj = (int)VFLOOR(dime/(1 + 2*ofrac) + 0.5);
+            h = len/((double)(np*disj - 1));
+        }
+        if (h <= space) return dime;
+    }
+
+    return -1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  NOsh_mgDecompose
+//
+// Purpose:  Find the processor grid for nproc processors that reaches the
+//           requested spacing with the fewest grid points per processor,
+//           given the overlap fraction ofrac.
+//           Sets np and dime and returns the memory of one level (see
+//           NOsh_mgMemory), or -1 if the spacing can't be reached.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE double NOsh_mgDecompose(MGparm *mgparm, Vhal_PBEType pbetype,
+                                 int nproc, double ofrac, int np[3],
+                                 int dime[3]) {
+
+    double mem,
+           best = -1.0;
+    int tnp[3], tdime[3], i, j, k;
+
+    for (i=1; i<=nproc; i++) {
+        if ((nproc % i) != 0) continue;
+        for (j=1; j<=(nproc/i); j++) {
+            if (((nproc/i) % j) != 0) continue;
+            tnp[0] = i;
+            tnp[1] = j;
+            tnp[2] = nproc/(i*j);
+            for (k=0; k<3; k++) {
+                tdime[k] = NOsh_mgFitDime(mgparm->fglen[k], tnp[k], ofrac,
+                                          mgparm->space);
+                if (tdime[k] < 0) break;
+            }
+            if (k < 3) continue;
+            mem = NOsh_mgMemory(tdime, NOsh_mgLevels(tdime), pbetype);
+            if ((best < 0) || (mem < best)) {
+                best = mem;
+                for (k=0; k<3; k++) {
+                    np[k] = tnp[k];
+                    dime[k] = tdime[k];
+                }
+            }
+        }
+    }
+
+    return best;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  NOsh_planMG
+//
+// Purpose:  Size the grids of an mg-auto or mg-para ELEC statement before
+//           anything is allocated.  With SPACE, pick dime (and, for mg-para
+//           without PDIME, the processor grid); with GMEMCEIL, make sure the
+//           two levels a focusing step holds fit in the budget, shrinking a
+//           user-given dime or rejecting the statement with a suggestion.
+//           The focusing depth is left to NOsh_setupCalcMGAUTO, which
+//           takes it from cglen/fglen alone.  Returns 1 if successful, 0
+//           otherwise.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int NOsh_planMG(NOsh *thee, NOsh_calc *elec) {
+
+    MGparm *mgparm = VNULL;
+    Vhal_PBEType pbetype;
+    double budget, mem, tmem;
+    int np[3], tnp[3], dime[3], tdime[3];
+    int nlev, para, nproc, j, k;
+
+    mgparm = elec->mgparm;
+    pbetype = elec->pbeparm->pbetype;
+    if (!mgparm->setspace && !mgparm->setgmemceil) return 1;
+
+    para = (mgparm->type == MCT_PARALLEL);
+    if (mgparm->setgmemceil) budget = mgparm->gmemceil*1024.0*1024.0;
+    else budget = -1.0;
+    for (j=0; j<3; j++) {
+        if (para && mgparm->setpdime) np[j] = mgparm->pdime[j];
+        else np[j] = 1;
+        dime[j] = mgparm->dime[j];
+    }
+    nlev = mgparm->nlev;
+
+    /* Pick the grid (and processor grid) from the target spacing */
+    if (mgparm->setspace) {
+        if (para && !mgparm->setpdime) {
+            if (NOsh_mgDecompose(mgparm, pbetype, thee->proc_size,
+                                 mgparm->ofrac, np, dime) < 0) {
+                Vnm_print(2, "NOsh:  SPACE %g is too fine for %d \
+processors!\n", mgparm->space, thee->proc_size);
+                return 0;
+            }
+            for (j=0; j<3; j++) mgparm->pdime[j] = np[j];
+            mgparm->setpdime = 1;
+        } else {
+            for (j=0; j<3; j++) {
+                dime[j] = NOsh_mgFitDime(mgparm->fglen[j], np[j],
+                                         mgparm->ofrac, mgparm->space);
+                if (dime[j] < 0) {
+                    Vnm_print(2, "NOsh:  SPACE %g is too fine for FGLEN \
+%g!\n", mgparm->space, mgparm->fglen[j]);
+                    return 0;
+                }
+            }
+        }
+        nlev = NOsh_mgLevels(dime);
+    }
+
+    /* Focusing holds the coarser level while the finer one is set up */
+    mem = 2.0*NOsh_mgMemory(dime, nlev, pbetype);
+    if ((budget > 0) && (mem > budget)) {
+        if (mgparm->setspace) {
+            Vnm_print(2, "NOsh:  SPACE %g needs dime %d %d %d and %.1f MB \
+per processor, more than GMEMCEIL %g MB!\n", mgparm->space, dime[0], dime[1],
+                      dime[2], mem/(1024.0*1024.0), mgparm->gmemceil);
+            if (para) {
+                Vnm_print(2, "NOsh:  Use more processors or a coarser \
+SPACE.\n");
+                return 0;
+            }
+            for (nproc=2; nproc<=NOSH_MGMAXPROC; nproc++) {
+                tmem = NOsh_mgDecompose(mgparm, pbetype, nproc, 0.1, tnp,
+                                        tdime);
+                if ((tmem > 0) && (2.0*tmem <= budget)) break;
+            }
+            if (nproc <= NOSH_MGMAXPROC) {
+                Vnm_print(2, "NOsh:  Use mg-para with pdime %d %d %d and \
+ofrac 0.1 (dime %d %d %d) or a coarser SPACE.\n", tnp[0], tnp[1], tnp[2],
+                          tdime[0], tdime[1], tdime[2]);
+            } else {
+                Vnm_print(2, "NOsh:  Use a coarser SPACE.\n");
+            }
+            return 0;
+        }
+        while (mem > budget) {
+            k = 0;
+            for (j=1; j<3; j++) if (dime[j] > dime[k]) k = j;
+            if (dime[k] - 32 < 33) break;
+            dime[k] -= 32;
+            nlev = NOsh_mgLevels(dime);
+            mem = 2.0*NOsh_mgMemory(dime, nlev, pbetype);
+        }
+        if (mem > budget) {
+            Vnm_print(2, "NOsh:  DIME %d %d %d does not fit in GMEMCEIL %g \
+MB!\n", mgparm->dime[0], mgparm->dime[1], mgparm->dime[2], mgparm->gmemceil);
+            return 0;
+        }
+        Vnm_print(2, "NOsh:  Reduced DIME from %d %d %d to %d %d %d to fit \
+GMEMCEIL %g MB.\n", mgparm->dime[0], mgparm->dime[1], mgparm->dime[2], dime[0],
+                  dime[1], dime[2], mgparm->gmemceil);
+    }
+
+    for (j=0; j<3; j++) mgparm->dime[j] = dime[j];
+    mgparm->setdime = 1;
+    mgparm->nlev = nlev;
+
+    Vnm_print(1, "NOsh:  Planned dime %d %d %d (nlev %d)", dime[0], dime[1],
+              dime[2], nlev);
+    if (para) {
+        Vnm_print(1, " on a %d x %d x %d processor grid", np[0], np[1], np[2]);
+    }
+    Vnm_print(1, ", %.1f MB per processor.\n", mem/(1024.0*1024.0));
+
+    return 1;
+}
+
 VPUBLIC int NOsh_setupCalcMGAUTO(
                                  NOsh *thee,
                                  NOsh_calc *elec
@@ -1850,6 +2457,9 @@ VPUBLIC int NOsh_setupCalcMGAUTO(
         Vnm_print(2, "NOsh_setupCalcMGAUTO:  Got NULL pbeparm!\n");
         return 0;
     }
+    if ((elec->mgparm->type == MCT_AUTO) && !NOsh_planMG(thee, elec)) {
+        return 0;
+    }
 
     Vnm_print(0, "NOsh_setupCalcMGAUTO(%s, %d):  coarse grid center = %g %g %g\n",
               __FILE__, __LINE__,
@@ -1896,11 +2506,7 @@ coarse grids = %g, %g, %g\n", __FILE__, __LINE__, d[0], d[1], d[2]);
 
     /* Now that we know how many focusing levels to use, we're ready to set up
         the parameter objects */
-    if (nfocus > (NOSH_MAXCALC-(thee->ncalc))) {
-        Vnm_print(2, "NOsh:  Require more calculations than max (%d)!\n",
-                  NOSH_MAXCALC);
-        return 0;
-    }
+    NOsh_growCalc(thee, thee->ncalc+nfocus-1);
 
     for (ifocus=0; ifocus<nfocus; ifocus++) {
 
@@ -2086,20 +2692,19 @@ fixing mesh max violation (%g in %d-direction).\n", __FILE__, __LINE__, ifocus,
     return 1;
 }
 
-/* Author:   Nathan Baker and Todd Dolinsky */
-VPUBLIC int NOsh_setupCalcMGPARA(
-                                 NOsh *thee,
-                                 NOsh_calc *elec
-                                 ) {
-
-    /* NEW (25-Jul-2006):  This code should produce modify the ELEC statement
-    and pass it on to MGAUTO for further processing. */
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  NOsh_setupMGPART
+//
+// Purpose:  Set up the fine grid of partition rank of a parallel focusing
+//           calculation:  shrink fglen and move fcenter to the overlapping
+//           partition and record the disjoint partition it owns
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void NOsh_setupMGPART(NOsh *thee, MGparm *mgparm, int rank) {
 
-    MGparm *mgparm = VNULL;
     double ofrac;
     double hx, hy, hzed;
     double xofrac, yofrac, zofrac;
-    int rank, size, npx, npy, npz, nproc, ip, jp, kp;
+    int npx, npy, npz, ip, jp, kp;
     int xeffGlob, yeffGlob, zeffGlob, xDisj, yDisj, zDisj;
     int xigminDisj, xigmaxDisj, yigminDisj, yigmaxDisj, zigminDisj, zigmaxDisj;
     int xigminOlap, xigmaxOlap, yigminOlap, yigmaxOlap, zigminOlap, zigmaxOlap;
@@ -2112,78 +2717,10 @@ VPUBLIC int NOsh_setupCalcMGPARA(
     double xminDisj, xmaxDisj, yminDisj, ymaxDisj, zminDisj, zmaxDisj;
     double xcent, ycent, zcent;
 
-    /* Grab some useful variables */
-    VASSERT(thee != VNULL);
-    VASSERT(elec != VNULL);
-    mgparm = elec->mgparm;
-    VASSERT(mgparm != VNULL);
-
-    /* Grab some useful variables */
     ofrac = mgparm->ofrac;
     npx = mgparm->pdime[0];
     npy = mgparm->pdime[1];
     npz = mgparm->pdime[2];
-    nproc = npx*npy*npz;
-
-    /* If this is not an asynchronous calculation, then we need to make sure we
-        have all the necessary MPI information */
-    if (mgparm->setasync == 0) {
-
-#ifndef HAVE_MPI_H
-
-        Vnm_tprint(2, "NOsh_setupCalcMGPARA:  Oops!  You're trying to perform \
-an 'mg-para' (parallel) calculation\n");
-        Vnm_tprint(2, "NOsh_setupCalcMGPARA:  with a version of APBS that wasn't \
-compiled with MPI!\n");
-        Vnm_tprint(2, "NOsh_setupCalcMGPARA:  Perhaps you meant to use the \
-'async' flag?\n");
-        Vnm_tprint(2, "NOsh_setupCalcMGPARA:  Bailing out!\n");
-
-        return 0;
-
-#endif
-
-        rank = thee->proc_rank;
-        size = thee->proc_size;
-        Vnm_print(0, "NOsh_setupCalcMGPARA:  Hello from processor %d of %d\n", rank,
-                  size);
-
-        /* Check to see if we have too many processors.  If so, then simply set
-            this processor to duplicating the work of processor 0. */
-        if (rank > (nproc-1)) {
-            Vnm_print(2, "NOsh_setupMGPARA:  There are more processors available than\
-the %d you requested.\n", nproc);
-            Vnm_print(2, "NOsh_setupMGPARA:  Eliminating processor %d\n", rank);
-            thee->bogus = 1;
-            rank = 0;
-        }
-
-        /* Check to see if we have too few processors.  If so, this is a fatal
-            error. */
-        if (size < nproc) {
-            Vnm_print(2, "NOsh_setupMGPARA:  There are too few processors (%d) to \
-satisfy requirements (%d)\n", size, nproc);
-            return 0;
-        }
-
-        Vnm_print(0, "NOsh_setupMGPARA:  Hello (again) from processor %d of %d\n",
-                  rank, size);
-
-    } else { /* Setting up for an asynchronous calculation. */
-
-        rank = mgparm->async;
-
-        thee->ispara = 1;
-        thee->proc_rank = rank;
-
-        /* Check to see if the async id is greater than the number of
-        * processors.  If so, this is a fatal error. */
-        if (rank > (nproc-1)) {
-            Vnm_print(2, "NOsh_setupMGPARA:  The processor id you requested (%d) \
-is not within the range of processors available (0-%d)\n", rank, (nproc-1));
-            return 0;
-        }
-    }
 
     /* Calculate the processor's coordinates in the processor grid */
     kp = (int)floor(rank/(npx*npy));
@@ -2375,7 +2912,127 @@ in  NOsh_setupMGAUTO\n", __FILE__, __LINE__);
               mgparm->fcenter[0],
               mgparm->fcenter[1],
               mgparm->fcenter[2]);
+}
 
+/* Author:   Nathan Baker and Todd Dolinsky */
+VPUBLIC int NOsh_setupCalcMGPARA(
+                                 NOsh *thee,
+                                 NOsh_calc *elec
+                                 ) {
+
+    /* NEW (25-Jul-2006):  This code should produce modify the ELEC statement
+    and pass it on to MGAUTO for further processing. */
+
+    MGparm *mgparm = VNULL;
+    NOsh_calc *part = VNULL;
+    int rank, size, npx, npy, npz, nproc, ip, icalc, j;
+
+    /* Grab some useful variables */
+    VASSERT(thee != VNULL);
+    VASSERT(elec != VNULL);
+    mgparm = elec->mgparm;
+    VASSERT(mgparm != VNULL);
+    if (!NOsh_planMG(thee, elec)) return 0;
+
+    /* Grab some useful variables */
+    npx = mgparm->pdime[0];
+    npy = mgparm->pdime[1];
+    npz = mgparm->pdime[2];
+    nproc = npx*npy*npz;
+
+    /* A threaded calculation sets up every partition in this process.  The
+        coarsest focusing level is the same for all of them, so only the
+        first partition keeps it and the others focus from it as well. */
+    if (mgparm->setthreaded) {
+        for (ip=0; ip<nproc; ip++) {
+            part = NOsh_calc_ctor(NCT_MG);
+            NOsh_calc_copy(part, elec);
+            part->mgparm->ipart = ip;
+            part->mgparm->npart = nproc;
+            NOsh_setupMGPART(thee, part->mgparm, ip);
+            icalc = thee->ncalc;
+            if (!NOsh_setupCalcMGAUTO(thee, part)) {
+                NOsh_calc_dtor(&part);
+                return 0;
+            }
+            NOsh_calc_dtor(&part);
+            if (ip == 0) {
+                thee->calc[icalc]->mgparm->ipart = -1;
+            } else {
+                NOsh_calc_dtor(&(thee->calc[icalc]));
+                for (j=icalc; j<(thee->ncalc-1); j++) {
+                    thee->calc[j] = thee->calc[j+1];
+                }
+                (thee->ncalc)--;
+                thee->calc[thee->ncalc] = VNULL;
+            }
+        }
+        Vnm_print(0, "NOsh_setupCalcMGPARA:  Set up %d partitions in this \
+process\n", nproc);
+        return 1;
+    }
+
+    /* If this is not an asynchronous calculation, then we need to make sure we
+        have all the necessary MPI information */
+    if (mgparm->setasync == 0) {
+
+#ifndef HAVE_MPI_H
+
+        Vnm_tprint(2, "NOsh_setupCalcMGPARA:  Oops!  You're trying to perform \
+an 'mg-para' (parallel) calculation\n");
+        Vnm_tprint(2, "NOsh_setupCalcMGPARA:  with a version of APBS that wasn't \
+compiled with MPI!\n");
+        Vnm_tprint(2, "NOsh_setupCalcMGPARA:  Perhaps you meant to use the \
+'async' flag?\n");
+        Vnm_tprint(2, "NOsh_setupCalcMGPARA:  Bailing out!\n");
+
+        return 0;
+
+#endif
+
+        rank = thee->proc_rank;
+        size = thee->proc_size;
+        Vnm_print(0, "NOsh_setupCalcMGPARA:  Hello from processor %d of %d\n", rank,
+                  size);
+
+        /* Check to see if we have too many processors.  If so, then simply set
+            this processor to duplicating the work of processor 0. */
+        if (rank > (nproc-1)) {
+            Vnm_print(2, "NOsh_setupMGPARA:  There are more processors available than\
+the %d you requested.\n", nproc);
+            Vnm_print(2, "NOsh_setupMGPARA:  Eliminating processor %d\n", rank);
+            thee->bogus = 1;
+            rank = 0;
+        }
+
+        /* Check to see if we have too few processors.  If so, this is a fatal
+            error. */
+        if (size < nproc) {
+            Vnm_print(2, "NOsh_setupMGPARA:  There are too few processors (%d) to \
+satisfy requirements (%d)\n", size, nproc);
+            return 0;
+        }
+
+        Vnm_print(0, "NOsh_setupMGPARA:  Hello (again) from processor %d of %d\n",
+                  rank, size);
+
+    } else { /* Setting up for an asynchronous calculation. */
+
+        rank = mgparm->async;
+
+        thee->ispara = 1;
+        thee->proc_rank = rank;
+
+        /* Check to see if the async id is greater than the number of
+        * processors.  If so, this is a fatal error. */
+        if (rank > (nproc-1)) {
+            Vnm_print(2, "NOsh_setupMGPARA:  The processor id you requested (%d) \
+is not within the range of processors available (0-%d)\n", rank, (nproc-1));
+            return 0;
+        }
+    }
+
+    NOsh_setupMGPART(thee, mgparm, rank);
 
     /* Setup the automatic focusing calculations associated with this processor */
     return NOsh_setupCalcMGAUTO(thee, elec);
@@ -2484,16 +3141,8 @@ VPRIVATE int NOsh_setupCalcFEMANUAL(
     pbeparm = elec->pbeparm;
     VASSERT(pbeparm);
 
-    /* Check to see if he have any room left for this type of
-     * calculation, if so: set the calculation type, update the number
-     * of calculations of this type, and parse the rest of the section
-     */
-    if (thee->ncalc >= NOSH_MAXCALC) {
-        Vnm_print(2, "NOsh:  Too many calculations in this run!\n");
-        Vnm_print(2, "NOsh:  Current max is %d; ignoring this calculation\n",
-                  NOSH_MAXCALC);
-        return 0;
-    }
+    /* Make room for this calculation in the calc table */
+    NOsh_growCalc(thee, thee->ncalc);
     thee->calc[thee->ncalc] = NOsh_calc_ctor(NCT_FEM);
     calc = thee->calc[thee->ncalc];
     (thee->ncalc)++;
@@ -2588,16 +3237,8 @@ VPRIVATE int NOsh_setupCalcAPOL(
     VASSERT(thee != VNULL);
     VASSERT(apol != VNULL);
 
-    /* Check to see if he have any room left for this type of
-        * calculation, if so: set the calculation type, update the number
-        * of calculations of this type, and parse the rest of the section
-        */
-    if (thee->ncalc >= NOSH_MAXCALC) {
-        Vnm_print(2, "NOsh:  Too many calculations in this run!\n");
-        Vnm_print(2, "NOsh:  Current max is %d; ignoring this calculation\n",
-                  NOSH_MAXCALC);
-        return 0;
-    }
+    /* Make room for this calculation in the calc table */
+    NOsh_growCalc(thee, thee->ncalc);
     thee->calc[thee->ncalc] = NOsh_calc_ctor(NCT_APOL);
     calc = thee->calc[thee->ncalc];
     (thee->ncalc)++;
@@ -2652,15 +3293,8 @@ set up?\n");
         bemparm->mac=0.8;
     }
 
-    /* Check to see if he have any room left for this type of calculation, if
-        so: set the calculation type, update the number of calculations of this type,
-        and parse the rest of the section */
-    if (thee->ncalc >= NOSH_MAXCALC) {
-        Vnm_print(2, "NOsh:  Too many calculations in this run!\n");
-        Vnm_print(2, "NOsh:  Current max is %d; ignoring this calculation\n",
-                  NOSH_MAXCALC);
-        return 0;
-    }
+    /* Make room for this calculation in the calc table */
+    NOsh_growCalc(thee, thee->ncalc);
 
     /* Get the next calculation object and increment the number of calculations */
     thee->calc[thee->ncalc] = NOsh_calc_ctor(NCT_BEM);
@@ -2711,15 +3345,8 @@ set up?\n");
         return 0;
     }
 
-    /* Check to see if he have any room left for this type of calculation, if
-        so: set the calculation type, update the number of calculations of this type,
-        and parse the rest of the section */
-    if (thee->ncalc >= NOSH_MAXCALC) {
-        Vnm_print(2, "NOsh:  Too many calculations in this run!\n");
-        Vnm_print(2, "NOsh:  Current max is %d; ignoring this calculation\n",
-                  NOSH_MAXCALC);
-        return 0;
-    }
+    /* Make room for this calculation in the calc table */
+    NOsh_growCalc(thee, thee->ncalc);
 
     /* Get the next calculation object and increment the number of calculations */
     thee->calc[thee->ncalc] = NOsh_calc_ctor(NCT_GEOFLOW);
@@ -2762,15 +3389,8 @@ set up?\n");
         return 0;
     }
 
-    /* Check to see if he have any room left for this type of calculation, if
-        so: set the calculation type, update the number of calculations of this type,
-        and parse the rest of the section */
-    if (thee->ncalc >= NOSH_MAXCALC) {
-        Vnm_print(2, "NOsh:  Too many calculations in this run!\n");
-        Vnm_print(2, "NOsh:  Current max is %d; ignoring this calculation\n",
-                  NOSH_MAXCALC);
-        return 0;
-    }
+    /* Make room for this calculation in the calc table */
+    NOsh_growCalc(thee, thee->ncalc);
 
     /* Get the next calculation object and increment the number of calculations */
     thee->calc[thee->ncalc] = NOsh_calc_ctor(NCT_PBAM);
@@ -2820,15 +3440,8 @@ set up?\n");
         return 0;
     }
 
-    /* Check to see if he have any room left for this type of calculation, if
-        so: set the calculation type, update the number of calculations of this type,
-        and parse the rest of the section */
-    if (thee->ncalc >= NOSH_MAXCALC) {
-        Vnm_print(2, "NOsh:  Too many calculations in this run!\n");
-        Vnm_print(2, "NOsh:  Current max is %d; ignoring this calculation\n",
-                  NOSH_MAXCALC);
-        return 0;
-    }
+    /* Make room for this calculation in the calc table */
+    NOsh_growCalc(thee, thee->ncalc);
 
     /* Get the next calculation object and increment the number of calculations */
     thee->calc[thee->ncalc] = NOsh_calc_ctor(NCT_PBSAM);
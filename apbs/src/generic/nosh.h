@@ -78,22 +78,35 @@
 #include "generic/pbamparm.h" 
 #include "generic/pbsamparm.h" //path might change
 
-/** @brief Maximum number of molecules in a run
+/** @brief Initial size of the molecule and map tables; they grow as needed
+*  @note  Callers that still keep fixed arrays of this size must check
+*         sNOsh::nmol against it
 *  @ingroup NOsh */
 #define NOSH_MAXMOL 20
 
-/** @brief Maximum number of calculations in a run
+/** @brief Initial size of the calculation tables; they grow as needed
+*  @note  Callers that still keep fixed arrays of this size must check
+*         sNOsh::ncalc against it
 *  @ingroup NOsh */
 #define NOSH_MAXCALC 20
 
-/** @brief Maximum number of PRINT statements in a run
+/** @brief Initial size of the PRINT statement tables; they grow as needed
 *  @ingroup NOsh */
 #define NOSH_MAXPRINT 20
 
-/** @brief Maximum number of operations in a PRINT statement
+/** @brief Initial number of operations per PRINT statement; grows as needed
 *  @ingroup NOsh */
 #define NOSH_MAXPOP 20
 
+/** @brief Largest number of grid points per axis planned from SPACE
+*  @ingroup NOsh */
+#define NOSH_MGMAXDIME 4097
+
+/** @brief Largest number of processors suggested when a grid planned from
+*         SPACE does not fit in GMEMCEIL
+*  @ingroup NOsh */
+#define NOSH_MGMAXPROC 1024
+
 /**
 * @brief  Molecule file format types
  * @ingroup NOsh
@@ -101,7 +114,8 @@
 enum eNOsh_MolFormat {
     NMF_PQR=0,  /**< PQR format */
     NMF_PDB=1,  /**< PDB format */
-    NMF_XML=2   /**< XML format */
+    NMF_XML=2,  /**< XML format */
+    NMF_BIN=3   /**< Binary molecule format (Valist_writeBinary) */
 };
 
 /**
@@ -194,22 +208,27 @@ typedef struct sNOsh_calc NOsh_calc;
 */
 struct sNOsh {
 
-    NOsh_calc *calc[NOSH_MAXCALC];  /**< The array of calculation objects
+    NOsh_calc **calc;  /**< The array of calculation objects
         corresponding to actual calculations performed by the code.  Compare to
         sNOsh::elec */
     int ncalc;  /**< The number of calculations in the calc array */
+    int maxcalc;  /**< Allocated size of the calc array */
 
-    NOsh_calc *elec[NOSH_MAXCALC];  /**< The array of calculation objects
+    NOsh_calc **elec;  /**< The array of calculation objects
         corresponding to ELEC statements read in the input file.  Compare to
         sNOsh::calc */
     int nelec;  /**< The number of elec statements in the input file and in the
         elec array */
+    int maxelec;  /**< Allocated size of the elec, elec2calc and elecname
+        arrays */
 
-    NOsh_calc *apol[NOSH_MAXCALC];  /**< The array of calculation objects
+    NOsh_calc **apol;  /**< The array of calculation objects
         corresponding to APOLAR statements read in the input file.  Compare to
         sNOsh::calc */
     int napol;  /**< The number of apolar statements in the input file and in the
         apolar array */
+    int maxapol;  /**< Allocated size of the apol, apol2calc and apolname
+        arrays */
 
     int ispara;  /**< 1 => is a parallel calculation, 0 => is not */
     int proc_rank;  /**< Processor rank in parallel calculation */
@@ -218,7 +237,7 @@ struct sNOsh {
         NOsh is broken -- useful for parallel focusing calculations where the
         user gave us too many processors (1 => ignore this NOsh; 0 => this NOsh
                                           is OK) */
-    int elec2calc[NOSH_MAXCALC];  /**< A mapping between ELEC statements which
+    int *elec2calc;  /**< A mapping between ELEC statements which
         appear in the input file and calc objects stored above.  Since we allow
         both normal and focused  multigrid, there isn't a 1-to-1 correspondence
         between ELEC statements and actual calcualtions.  This can really
@@ -226,47 +245,55 @@ struct sNOsh {
         road (like PRINT).  Therefore this array is the initial point of entry
         for any calculation-specific operation.  It points to a specific entry
         in the calc array. */
-    int apol2calc[NOSH_MAXCALC];  /**< (see elec2calc) */
+    int *apol2calc;  /**< (see elec2calc) */
 
     int nmol;  /**< Number of molecules */
-    char molpath[NOSH_MAXMOL][VMAX_ARGLEN];   /**< Paths to mol files */
-    NOsh_MolFormat molfmt[NOSH_MAXMOL];  /**< Mol files formats */
-    Valist *alist[NOSH_MAXMOL];  /**<  Molecules for calculation (can be used in
+    int maxmol;  /**< Allocated size of the molecule arrays */
+    char (*molpath)[VMAX_ARGLEN];   /**< Paths to mol files */
+    NOsh_MolFormat *molfmt;  /**< Mol files formats */
+    Valist **alist;  /**<  Molecules for calculation (can be used in
         setting mesh centers */
     int gotparm;  /**< Either have (1) or don't have (0) parm */
     char parmpath[VMAX_ARGLEN];   /**< Paths to parm file */
     NOsh_ParmFormat parmfmt;  /**< Parm file format */
     int ndiel;  /**< Number of dielectric maps */
-    char dielXpath[NOSH_MAXMOL][VMAX_ARGLEN];  /**< Paths to x-shifted
+    int maxdiel;  /**< Allocated size of the dielectric map arrays */
+    char (*dielXpath)[VMAX_ARGLEN];  /**< Paths to x-shifted
         dielectric map files */
-    char dielYpath[NOSH_MAXMOL][VMAX_ARGLEN];  /**< Paths to y-shifted
+    char (*dielYpath)[VMAX_ARGLEN];  /**< Paths to y-shifted
         dielectric map files */
-    char dielZpath[NOSH_MAXMOL][VMAX_ARGLEN];  /**< Paths to z-shifted
+    char (*dielZpath)[VMAX_ARGLEN];  /**< Paths to z-shifted
         dielectric map files */
-    Vdata_Format dielfmt[NOSH_MAXMOL];  /**< Dielectric maps file formats */
+    Vdata_Format *dielfmt;  /**< Dielectric maps file formats */
     int nkappa;  /**< Number of kappa maps */
-    char kappapath[NOSH_MAXMOL][VMAX_ARGLEN]; /**< Paths to kappa map files */
-    Vdata_Format kappafmt[NOSH_MAXMOL];  /**< Kappa maps file formats */
+    int maxkappa;  /**< Allocated size of the kappa map arrays */
+    char (*kappapath)[VMAX_ARGLEN]; /**< Paths to kappa map files */
+    Vdata_Format *kappafmt;  /**< Kappa maps file formats */
     int npot;  /**< Number of potential maps */
-    char potpath[NOSH_MAXMOL][VMAX_ARGLEN]; /**< Paths to potential map files */
-    Vdata_Format potfmt[NOSH_MAXMOL];  /**< Potential maps file formats */
+    int maxpot;  /**< Allocated size of the potential map arrays */
+    char (*potpath)[VMAX_ARGLEN]; /**< Paths to potential map files */
+    Vdata_Format *potfmt;  /**< Potential maps file formats */
     int ncharge;  /**< Number of charge maps */
-    char chargepath[NOSH_MAXMOL][VMAX_ARGLEN];   /**< Paths to charge map files */
-    Vdata_Format chargefmt[NOSH_MAXMOL];  /**< Charge maps fileformats */
+    int maxcharge;  /**< Allocated size of the charge map arrays */
+    char (*chargepath)[VMAX_ARGLEN];   /**< Paths to charge map files */
+    Vdata_Format *chargefmt;  /**< Charge maps fileformats */
     int nmesh;  /**< Number of meshes */
-    char meshpath[NOSH_MAXMOL][VMAX_ARGLEN];   /**< Paths to mesh files */
-    Vdata_Format meshfmt[NOSH_MAXMOL];  /**< Mesh fileformats */
+    int maxmesh;  /**< Allocated size of the mesh arrays */
+    char (*meshpath)[VMAX_ARGLEN];   /**< Paths to mesh files */
+    Vdata_Format *meshfmt;  /**< Mesh fileformats */
     int nprint;  /**< How many print sections? */
-    NOsh_PrintType printwhat[NOSH_MAXPRINT];  /**< What do we print:  \li 0 =
+    int maxprint;  /**< Allocated size of the PRINT arrays */
+    NOsh_PrintType *printwhat;  /**< What do we print:  \li 0 =
         energy, \li 1 = force */
-    int printnarg[NOSH_MAXPRINT];  /**< How many arguments in energy list */
-    int printcalc[NOSH_MAXPRINT][NOSH_MAXPOP]; /**< ELEC id (see elec2calc) */
-    int printop[NOSH_MAXPRINT][NOSH_MAXPOP];  /**< Operation id (0 = add, 1 =
+    int *printnarg;  /**< How many arguments in energy list */
+    int *maxpop;  /**< Allocated size of each printcalc/printop row */
+    int **printcalc; /**< ELEC id (see elec2calc) */
+    int **printop;  /**< Operation id (0 = add, 1 =
         subtract) */
     int parsed;  /**< Have we parsed an input file yet? */
-    char elecname[NOSH_MAXCALC][VMAX_ARGLEN]; /**< Optional user-specified name
+    char (*elecname)[VMAX_ARGLEN]; /**< Optional user-specified name
         for ELEC statement */
-    char apolname[NOSH_MAXCALC][VMAX_ARGLEN]; /**< Optional user-specified name
+    char (*apolname)[VMAX_ARGLEN]; /**< Optional user-specified name
         for APOLAR statement */
 };
 
@@ -479,6 +506,43 @@ VEXTERNC int NOsh_printOp(NOsh *thee, int iprint, int iarg);
 */
 VEXTERNC int NOsh_printCalc(NOsh *thee, int iprint, int iarg);
 
+/** @brief   Return the calculation (index into sNOsh::calc) whose results an
+*           argument of a PRINT statement uses
+*  @ingroup NOsh
+*  @param   thee NOsh object to use
+*  @param   iprint ID of PRINT statement
+*  @param   iarg ID of operation in PRINT statement
+*  @returns Calculation ID (through sNOsh::elec2calc or sNOsh::apol2calc,
+*           depending on what is printed), or -1 if the argument does not name
+*           an existing ELEC or APOLAR statement
+*/
+VEXTERNC int NOsh_print2calc(NOsh *thee, int iprint, int iarg);
+
+/** @brief   Return the calculation a calculation focuses from
+*  @ingroup NOsh
+*  @param   thee NOsh object to use
+*  @param   icalc Calculation ID
+*  @returns icalc-1 if calculation icalc is a multigrid calculation that
+*           takes its boundary conditions from the previous one (focusing),
+*           -1 otherwise.  These are the only dependencies between
+*           calculations; runs of them form independent focusing chains.
+*           The first level of each partition of a threaded mg-para
+*           calculation focuses from the shared coarsest level instead
+*           (MGparm::ipart).
+*/
+VEXTERNC int NOsh_focusParent(NOsh *thee, int icalc);
+
+/** @brief   Return the memory a calculation's multigrid level needs
+*  @ingroup NOsh
+*  @param   thee NOsh object to use
+*  @param   icalc Calculation ID
+*  @returns Number of bytes Vpmg_ctor2 allocates for the calculation's grid
+*           and solver workspace (0 for calculations that are not
+*           multigrid).  A focused calculation also holds the level it
+*           focuses from while it is set up.
+*/
+VEXTERNC double NOsh_calcMemory(NOsh *thee, int icalc);
+
 /** @brief   Construct NOsh
 *  @ingroup NOsh
 *  @author  Nathan Baker
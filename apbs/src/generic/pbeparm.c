@@ -141,6 +141,7 @@ VPUBLIC int PBEparm_ctor2(PBEparm *thee) {
     thee->setsdens = 0;
     thee->numwrite = 0;
     thee->setwritemat = 0;
+    thee->setcoefcache = 0;
     thee->nion = 0;
     thee->sdens = 0;
     thee->swin = 0;
@@ -347,6 +348,7 @@ VPUBLIC void PBEparm_copy(PBEparm *thee, PBEparm *parm) {
     for (i=0; i<PBEPARM_MAXWRITE; i++) {
         thee->writetype[i] = parm->writetype[i];
         thee->writefmt[i] = parm->writefmt[i];
+        thee->writetol[i] = parm->writetol[i];
         for (j=0; j<VMAX_ARGLEN; j++)
           thee->writestem[i][j] = parm->writestem[i][j];
     }
@@ -354,6 +356,8 @@ VPUBLIC void PBEparm_copy(PBEparm *thee, PBEparm *parm) {
     thee->setwritemat = parm->setwritemat;
     for (i=0; i<VMAX_ARGLEN; i++) thee->writematstem[i] = parm->writematstem[i];
     thee->writematflag = parm->writematflag;
+    thee->setcoefcache = parm->setcoefcache;
+    for (i=0; i<VMAX_ARGLEN; i++) thee->coefcache[i] = parm->coefcache[i];
 
     thee->smsize = parm->smsize;
     thee->smvolume = parm->smvolume;
@@ -1085,6 +1089,7 @@ VPRIVATE int PBEparm_parseWRITE(PBEparm *thee, Vio *sock) {
     char tok[VMAX_BUFSIZE], str[VMAX_BUFSIZE]="", strnew[VMAX_BUFSIZE]="";
     Vdata_Type writetype;
     Vdata_Format writefmt;
+    double writetol = 0.0;
 
     VJMPERR1(Vio_scanf(sock, "%s", tok) == 1);
     if (Vstring_strcasecmp(tok, "pot") == 0) {
@@ -1142,6 +1147,21 @@ VPRIVATE int PBEparm_parseWRITE(PBEparm *thee, Vio *sock) {
         writefmt = VDF_GZ;
     } else if (Vstring_strcasecmp(tok, "flat") == 0) {
         writefmt = VDF_FLAT;
+    } else if (Vstring_strcasecmp(tok, "raw") == 0) {
+        writefmt = VDF_RAW;
+    } else if (Vstring_strcasecmp(tok, "lossy") == 0) {
+        writefmt = VDF_LOSSY;
+        VJMPERR1(Vio_scanf(sock, "%s", tok) == 1);
+        if (sscanf(tok, "%lf", &writetol) == 0) {
+            Vnm_print(2, "PBEparm_parse:  Read non-float (%s) while parsing \
+lossy WRITE error bound!\n", tok);
+            return -1;
+        }
+        if (writetol <= 0.0) {
+            Vnm_print(2, "PBEparm_parse:  Lossy WRITE error bound must be \
+positive (got %g)!\n", writetol);
+            return -1;
+        }
     } else {
         Vnm_print(2, "PBEparm_parse:  Invalid data format (%s) to write!\n",
            tok);
@@ -1163,6 +1183,7 @@ VPRIVATE int PBEparm_parseWRITE(PBEparm *thee, Vio *sock) {
         strncpy(thee->writestem[thee->numwrite], tok, VMAX_ARGLEN);
         thee->writetype[thee->numwrite] = writetype;
         thee->writefmt[thee->numwrite] = writefmt;
+        thee->writetol[thee->numwrite] = writetol;
         (thee->numwrite)++;
     } else {
         Vnm_print(2, "PBEparm_parse:  You have exceeded the maximum number of write statements!\n");
@@ -1212,6 +1233,20 @@ WRITEMAT keyword!\n", tok);
 
 }
 
+VPRIVATE int PBEparm_parseCOEFCACHE(PBEparm *thee, Vio *sock) {
+    char tok[VMAX_BUFSIZE];
+
+    VJMPERR1(Vio_scanf(sock, "%s", tok) == 1);
+    strncpy(thee->coefcache, tok, VMAX_ARGLEN-1);
+    thee->coefcache[VMAX_ARGLEN-1] = '\0';
+    thee->setcoefcache = 1;
+    return 1;
+
+    VERROR1:
+        Vnm_print(2, "parsePBE:  ran out of tokens!\n");
+        return -1;
+}
+
 VPUBLIC int PBEparm_parseToken(PBEparm *thee, char tok[VMAX_BUFSIZE],
   Vio *sock) {
 
@@ -1266,6 +1301,8 @@ VPUBLIC int PBEparm_parseToken(PBEparm *thee, char tok[VMAX_BUFSIZE],
         return PBEparm_parseWRITE(thee, sock);
     } else if (Vstring_strcasecmp(tok, "writemat") == 0) {
         return PBEparm_parseWRITEMAT(thee, sock);
+    } else if (Vstring_strcasecmp(tok, "coefcache") == 0) {
+        return PBEparm_parseCOEFCACHE(thee, sock);
 
     /*----------------------------------------------------------*/
     /* Added by Michael Grabe                                   */
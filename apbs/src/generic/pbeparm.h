@@ -188,6 +188,8 @@ struct sPBEparm {
     Vdata_Type writetype[PBEPARM_MAXWRITE];  /**< What data to write */
     Vdata_Format writefmt[PBEPARM_MAXWRITE];  /**< File format to write data
                                                * in */
+    double writetol[PBEPARM_MAXWRITE];  /**< Absolute error bound for
+                                         * lossy (VDF_LOSSY) output */
     int writemat;  /**< Write out the operator matrix?
                     * \li 0 => no
                     * \li 1 => yes */
@@ -197,6 +199,10 @@ struct sPBEparm {
                         * \li 0 => Poisson (differential operator)
                         * \li 1 => Poisson-Boltzmann operator linearized around
                         * solution (if applicable) */
+    int setcoefcache;  /**< Flag, @see coefcache */
+    char coefcache[VMAX_ARGLEN];  /**< Directory for the binary cache of
+                                   * coefficient maps (see
+                                   * Vpmg_setCoefCache) */
 
 	/*Added for issue 482*/
 	char pbam_3dmapstem[VMAX_ARGLEN];
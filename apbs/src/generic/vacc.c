@@ -58,6 +58,14 @@
 
 VEMBED(rcsid="$Id$")
 
+/** @brief Minimum number of points used to sample a circle of intersection
+ *         in the analytic SASA derivative */
+#define VACC_MINARC 16
+
+/** @brief Default integration point density (pts/A) for the solvent
+ *         accessible volume */
+#define VACC_VOLDENSITY 2.0
+
 #if !defined(VINLINE_VACC)
 
 VPUBLIC unsigned long int Vacc_memChk(Vacc *thee) {
@@ -231,6 +239,10 @@ VPUBLIC int Vacc_ctor2(Vacc *thee,
 
     /* Setup and check probe */
     thee->surf = VNULL;
+    thee->wcaEnergy = VNULL;
+    thee->wcaForce = VNULL;
+    thee->wcaNatoms = 0;
+    thee->wcaGeneration = 0;
 
     /* Allocate space */
     if (!Vacc_allocate(thee)) {
@@ -270,10 +282,32 @@ VPUBLIC void Vacc_dtor2(Vacc *thee) {
                 (void **)&(thee->surf));
         thee->surf = VNULL;
     }
+    if (thee->wcaEnergy != VNULL) {
+        Vmem_free(thee->mem, thee->wcaNatoms, sizeof(double),
+                (void **)&(thee->wcaEnergy));
+        Vmem_free(thee->mem, 3*thee->wcaNatoms, sizeof(double),
+                (void **)&(thee->wcaForce));
+    }
 
     Vmem_dtor(&(thee->mem));
 }
 
+VPUBLIC void Vacc_resetCache(Vacc *thee) {
+
+    int i,
+        natoms;
+
+    natoms = Valist_getNumberAtoms(thee->alist);
+    if (thee->surf != VNULL) {
+        for (i=0; i<natoms; i++) VaccSurf_dtor(&(thee->surf[i]));
+        Vmem_free(thee->mem, natoms, sizeof(VaccSurf *),
+                (void **)&(thee->surf));
+        thee->surf = VNULL;
+    }
+    /* The WCA arrays are kept and refilled on the next Vacc_wcaAtoms call */
+    thee->wcaGeneration = 0;
+}
+
 VPUBLIC double Vacc_vdwAcc(Vacc *thee,
                            double center[3]
                            ) {
@@ -496,7 +530,8 @@ VPRIVATE double splineAcc(
                                     * evaluated */
         double win,  /** Spline window */
         double infrad,  /** Radius to inflate atomic radius */
-        VclistCell *cell  /** Cell of atom objects */
+        VclistCell *cell,  /** Cell of atom objects */
+        int *atomFlags  /** Per-atom scratch flags, cleared for the cell */
         ) {
 
     int atomID, iatom;
@@ -512,9 +547,9 @@ VPRIVATE double splineAcc(
         atomID = atom->id;
 
         /* Check to see if we've counted this atom already */
-        if ( !(thee->atomFlags[atomID]) ) {
+        if ( !(atomFlags[atomID]) ) {
 
-            thee->atomFlags[atomID] = 1;
+            atomFlags[atomID] = 1;
             value *= Vacc_splineAccAtom(thee, center, win, infrad, atom);
 
             if (value < VSMALL) return value;
@@ -528,6 +563,12 @@ VPRIVATE double splineAcc(
 VPUBLIC double Vacc_splineAcc(Vacc *thee, double center[VAPBS_DIM], double win,
   double infrad) {
 
+    return Vacc_splineAccMarks(thee, center, win, infrad, thee->atomFlags);
+}
+
+VPUBLIC double Vacc_splineAccMarks(Vacc *thee, double center[VAPBS_DIM],
+  double win, double infrad, int *marks) {
+
     VclistCell *cell;
     Vatom *atom;
     int iatom, atomID;
@@ -552,10 +593,10 @@ VPUBLIC double Vacc_splineAcc(Vacc *thee, double center[VAPBS_DIM], double win,
     for (iatom=0; iatom<cell->natoms; iatom++) {
         atom = cell->atoms[iatom];
         atomID = atom->id;
-        thee->atomFlags[atomID] = 0;
+        marks[atomID] = 0;
     }
 
-    return splineAcc(thee, center, win, infrad, cell);
+    return splineAcc(thee, center, win, infrad, cell, marks);
 }
 
 VPUBLIC void Vacc_splineAccGrad(Vacc *thee, double center[VAPBS_DIM],
@@ -592,7 +633,7 @@ VPUBLIC void Vacc_splineAccGrad(Vacc *thee, double center[VAPBS_DIM],
     }
 
     /* Get the local accessibility */
-    acc = splineAcc(thee, center, win, infrad, cell);
+    acc = splineAcc(thee, center, win, infrad, cell, thee->atomFlags);
 
     /* Accumulate the gradient of all local atoms */
     if (acc > VSMALL) {
@@ -1245,73 +1286,190 @@ VPUBLIC void Vacc_atomdSAV(Vacc *thee,
 
 }
 
-/* Note: This is purely test code to make certain that the dSASA code is
-         behaving properly. This function should NEVER be called by anyone
-         other than an APBS developer at Wash U.
-*/
-VPRIVATE double Vacc_SASAPos(Vacc *thee, double radius) {
+/**
+ * @brief  Determines if a point is outside the inflated van der Waals spheres
+ *         of all atoms except the two specified atoms.  Used to test whether a
+ *         point on the circle of intersection of two inflated spheres is part
+ *         of the solvent accessible surface.
+ * @returns 1 if accessible, 0 otherwise
+ */
+VPRIVATE int ivdwAccExclusPair(
+                               Vacc *thee,  /** Accessibility object */
+                               double center[3],  /** Position to test */
+                               double radius,  /** Radius of probe */
+                               int atomID1,  /** ID of first atom to ignore */
+                               int atomID2  /** ID of second atom to ignore */
+                               ) {
 
-    int i, natom;
-    double area;
+    int iatom;
+    double dist2,
+           *apos;
     Vatom *atom;
-    VaccSurf *asurf;
-
-    natom = Valist_getNumberAtoms(thee->alist);
+    VclistCell *cell;
 
-    /* Calculate the area */
-    area = 0.0;
-    for (i=0; i<natom; i++) {
-        atom = Valist_getAtom(thee->alist, i);
-        asurf = thee->surf[i];
+    cell = Vclist_getCell(thee->clist, center);
+    if (cell == VNULL) return 1;
 
-        VaccSurf_dtor2(asurf);
-        thee->surf[i] = Vacc_atomSurf(thee, atom, thee->refSphere, radius);
-        asurf = thee->surf[i];
-        area += (asurf->area);
+    for (iatom=0; iatom<cell->natoms; iatom++) {
+        atom = cell->atoms[iatom];
+        if ((atom->id == atomID1) || (atom->id == atomID2)) continue;
+        apos = atom->position;
+        dist2 = VSQR(center[0]-apos[0]) + VSQR(center[1]-apos[1])
+                        + VSQR(center[2]-apos[2]);
+        if (dist2 < VSQR(atom->radius+radius)) return 0;
     }
 
-    return area;
-
+    return 1;
 }
 
-VPRIVATE double Vacc_atomSASAPos(Vacc *thee,
-                                 double radius,
-                                 Vatom *atom, /* The atom being manipulated */
-                                 int mode
+/**
+ * @brief  Accumulate the analytic SASA derivatives for a single atom from the
+ *         exposed arcs of its circles of intersection with its neighbors.
+ *
+ * For inflated spheres k and j (radii Rk, Rj, separation d) the exposed
+ * portion of their circle of intersection gives
+ *    dA_k/dx_k =  (Rk/d) \oint (p - x_j) dphi
+ *    dA_j/dx_k = -(Rj/d) \oint (p - x_k) dphi
+ * where p runs over the exposed arc.  The arc is sampled with a density
+ * consistent with the Vacc surface point density.
+ *
+ * @param  marks  Scratch array of length natoms, used to avoid visiting a
+ *                neighbor twice; entries must not equal katom+1 on entry
+ * @param  dSelf  Set to the derivative of this atom's SASA with respect to
+ *                its position (can be VNULL)
+ * @param  dTotal Set to the derivative of the total SASA with respect to this
+ *                atom's position (can be VNULL)
+ */
+VPRIVATE void Vacc_atomdSASAArcs(Vacc *thee,
+                                 double srad,
+                                 int katom,
+                                 int *marks,
+                                 double *dSelf,
+                                 double *dTotal
                                 ) {
 
-    VaccSurf *asurf;
-    int id;
-    static int warned = 0;
+    int i, j, k, ui, ia, m, narc, jid,
+        imin[VAPBS_DIM],
+        imax[VAPBS_DIM];
+    double *kpos, *jpos, kRad, jRad, d, a, rc, phi, dphi, norm,
+           e[VAPBS_DIM], u[VAPBS_DIM], v[VAPBS_DIM], c[VAPBS_DIM],
+           p[VAPBS_DIM], sumj[VAPBS_DIM], sumk[VAPBS_DIM];
+    Vatom *katomp, *jatom;
+    Vclist *clist;
+    VclistCell *cell;
 
-    if ((thee->surf == VNULL) || (mode == 1)){
-        if(!warned){
-            Vnm_print(2, "WARNING: Recalculating entire surface!!!!\n");
-            warned = 1;
-        }
-        Vacc_SASAPos(thee, radius); // reinitialize before we can do anything about doing a calculation on a repositioned atom
+    for (i=0; i<VAPBS_DIM; i++) {
+        if (dSelf != VNULL) dSelf[i] = 0.0;
+        if (dTotal != VNULL) dTotal[i] = 0.0;
     }
 
-    id = Vatom_getAtomID(atom);
-    asurf = thee->surf[id];
-
-    VaccSurf_dtor(&asurf);
-    thee->surf[id] = Vacc_atomSurf(thee, atom, thee->refSphere, radius);
-    asurf = thee->surf[id];
+    clist = thee->clist;
+    katomp = Valist_getAtom(thee->alist, katom);
+    kpos = Vatom_getPosition(katomp);
+    kRad = Vatom_getRadius(katomp) + srad;
+
+    /* Any neighbor whose inflated sphere intersects this one is registered
+     * in a cell touched by this atom's inflated sphere */
+    for (i=0; i<VAPBS_DIM; i++) {
+        imin[i] = (int)floor((kpos[i] - kRad - clist->lower_corner[i])
+                             /clist->spacs[i]);
+        imax[i] = (int)floor((kpos[i] + kRad - clist->lower_corner[i])
+                             /clist->spacs[i]);
+        imin[i] = VMAX2(imin[i], 0);
+        imax[i] = VMIN2(imax[i], clist->npts[i]-1);
+    }
 
-    //printf("%s: Time elapsed: %f\n", __func__, ((double)clock() - ts) / CLOCKS_PER_SEC);
+    for (i=imin[0]; i<=imax[0]; i++) {
+    for (j=imin[1]; j<=imax[1]; j++) {
+    for (k=imin[2]; k<=imax[2]; k++) {
+        ui = (clist->npts[2])*(clist->npts[1])*i + (clist->npts[2])*j + k;
+        cell = &(clist->cells[ui]);
+        for (ia=0; ia<cell->natoms; ia++) {
+            jatom = cell->atoms[ia];
+            jid = jatom->id;
+            if ((jid == katom) || (marks[jid] == katom+1)) continue;
+            marks[jid] = katom + 1;
+
+            jpos = Vatom_getPosition(jatom);
+            jRad = Vatom_getRadius(jatom) + srad;
+            d = VSQRT(VSQR(jpos[0]-kpos[0]) + VSQR(jpos[1]-kpos[1])
+                      + VSQR(jpos[2]-kpos[2]));
+
+            /* Skip disjoint and nested spheres; neither has a circle of
+             * intersection */
+            if ((d >= kRad + jRad) || (d <= VABS(kRad - jRad))) continue;
+
+            /* Circle of intersection: center c, radius rc, normal e */
+            for (m=0; m<VAPBS_DIM; m++) e[m] = (jpos[m] - kpos[m])/d;
+            a = (d*d + kRad*kRad - jRad*jRad)/(2.0*d);
+            rc = VSQRT(VMAX2(kRad*kRad - a*a, 0.0));
+            for (m=0; m<VAPBS_DIM; m++) c[m] = kpos[m] + a*e[m];
+
+            /* Orthonormal basis (u, v) for the plane of the circle */
+            if (VABS(e[0]) < 0.9) {
+                u[0] = 0.0; u[1] = e[2]; u[2] = -e[1];
+            } else {
+                u[0] = -e[2]; u[1] = 0.0; u[2] = e[0];
+            }
+            norm = VSQRT(VSQR(u[0]) + VSQR(u[1]) + VSQR(u[2]));
+            for (m=0; m<VAPBS_DIM; m++) u[m] /= norm;
+            v[0] = e[1]*u[2] - e[2]*u[1];
+            v[1] = e[2]*u[0] - e[0]*u[2];
+            v[2] = e[0]*u[1] - e[1]*u[0];
+
+            narc = (int)ceil(2.0*VPI*rc*VSQRT(thee->surf_density));
+            narc = VMAX2(narc, VACC_MINARC);
+            dphi = 2.0*VPI/((double)narc);
+
+            for (m=0; m<VAPBS_DIM; m++) {
+                sumj[m] = 0.0;
+                sumk[m] = 0.0;
+            }
+            for (m=0; m<narc; m++) {
+                phi = dphi*((double)m);
+                p[0] = c[0] + rc*(VCOS(phi)*u[0] + VSIN(phi)*v[0]);
+                p[1] = c[1] + rc*(VCOS(phi)*u[1] + VSIN(phi)*v[1]);
+                p[2] = c[2] + rc*(VCOS(phi)*u[2] + VSIN(phi)*v[2]);
+                if (ivdwAccExclusPair(thee, p, srad, katom, jid)) {
+                    sumj[0] += p[0] - jpos[0];
+                    sumj[1] += p[1] - jpos[1];
+                    sumj[2] += p[2] - jpos[2];
+                    sumk[0] += p[0] - kpos[0];
+                    sumk[1] += p[1] - kpos[1];
+                    sumk[2] += p[2] - kpos[2];
+                }
+            }
 
-    return asurf->area;
+            /* Zero-radius atoms carry no surface of their own (see
+             * Vacc_atomSurf) but still occlude their neighbors */
+            for (m=0; m<VAPBS_DIM; m++) {
+                if (Vatom_getRadius(katomp) >= VSMALL) {
+                    if (dSelf != VNULL) dSelf[m] += kRad*sumj[m]*dphi/d;
+                    if (dTotal != VNULL) dTotal[m] += kRad*sumj[m]*dphi/d;
+                }
+                if ((Vatom_getRadius(jatom) >= VSMALL) && (dTotal != VNULL)) {
+                    dTotal[m] -= jRad*sumk[m]*dphi/d;
+                }
+            }
+        }
+    }
+    }
+    }
 }
 
 /* ///////////////////////////////////////////////////////////////////////////
    // Routine:  Vacc_atomdSASA
    //
-   // Purpose:  Calculates the derivative of surface area with respect to atomic
-   //           displacement using finite difference methods.
+   // Purpose:  Calculates the derivative of the atomic surface area with
+   //           respect to atomic displacement.  The derivative is evaluated
+   //           analytically as a line integral over the exposed arcs of the
+   //           atom's circles of intersection with its neighbors; the atom
+   //           is never moved.
    //
-   // Args:     radius  The radius of the solvent probe in Angstroms
-   //           iatom   Index of the atom in thee->alist
+   // Args:     dpos    Unused; retained for compatibility with the former
+   //                   finite difference implementation
+   //           radius  The radius of the solvent probe in Angstroms
+   //           atom    The atom of interest
    //
    // Author:   Jason Wagoner
    //			David Gohara
@@ -1324,204 +1482,165 @@ VPUBLIC void Vacc_atomdSASA(Vacc *thee,
                             double *dSA
                            ) {
 
-    double *temp_Pos,
-           tPos[3],
-           axb1,
-           axt1,
-           ayb1,
-           ayt1,
-           azb1,
-           azt1;
-    VaccSurf *ref;
+    int natom, *marks;
 
-    //printf("%s: entering\n", __func__);
-    time_t ts;
-    ts = clock();
+    natom = Valist_getNumberAtoms(thee->alist);
+    marks = (int*)calloc(natom, sizeof(int));
+    VASSERT(marks != VNULL);
 
-    /* Get the atom information */
-    ref = thee->refSphere;
-    temp_Pos = Vatom_getPosition(atom); // Get a pointer to the position object.  You actually manipulate the atom doing this...
-
-    tPos[0] = temp_Pos[0];
-    tPos[1] = temp_Pos[1];
-    tPos[2] = temp_Pos[2];
-
-    /* Shift by pos -/+ on x */
-    temp_Pos[0] -= dpos;
-    axb1 = Vacc_atomSASAPos(thee, srad, atom,0);
-    temp_Pos[0] = tPos[0];
-
-    temp_Pos[0] += dpos;
-    axt1 = Vacc_atomSASAPos(thee, srad, atom,0);
-    temp_Pos[0] = tPos[0];
-
-    /* Shift by pos -/+ on y */
-    temp_Pos[1] -= dpos;
-    ayb1 = Vacc_atomSASAPos(thee, srad, atom,0);
-    temp_Pos[1] = tPos[1];
-
-    temp_Pos[1] += dpos;
-    ayt1 = Vacc_atomSASAPos(thee, srad, atom,0);
-    temp_Pos[1] = tPos[1];
-
-    /* Shift by pos -/+ on z */
-    temp_Pos[2] -= dpos;
-    azb1 = Vacc_atomSASAPos(thee, srad, atom,0);
-    temp_Pos[2] = tPos[2];
-
-    temp_Pos[2] += dpos;
-    azt1 = Vacc_atomSASAPos(thee, srad, atom,0);
-    temp_Pos[2] = tPos[2];
-
-    /* Reset the atom SASA to zero displacement */
-    Vacc_atomSASAPos(thee, srad, atom,0);
-
-    /* Calculate the final value */
-    dSA[0] = (axt1-axb1)/(2.0 * dpos);
-    dSA[1] = (ayt1-ayb1)/(2.0 * dpos);
-    dSA[2] = (azt1-azb1)/(2.0 * dpos);
+    Vacc_atomdSASAArcs(thee, srad, Vatom_getAtomID(atom), marks, dSA, VNULL);
+
+    free(marks);
 }
 
-/* Note: This is purely test code to make certain that the dSASA code is
-         behaving properly. This function should NEVER be called by anyone
-         other than an APBS developer at Wash U.
-*/
+/* ///////////////////////////////////////////////////////////////////////////
+   // Routine:  Vacc_totalAtomdSASA
+   //
+   // Purpose:  Calculates the derivative of the total surface area with
+   //           respect to the displacement of a single atom, including the
+   //           change in the exposed area of its neighbors.
+   //
+   // Author:   David Gohara
+   //           Nathan Baker
+   /////////////////////////////////////////////////////////////////////////// */
 VPUBLIC void Vacc_totalAtomdSASA(Vacc *thee, double dpos, double srad, Vatom *atom, double *dSA) {
 
-    int iatom;
-    double *temp_Pos, tRad;
-    double tPos[3];
-    double axb1,axt1,ayb1,ayt1,azb1,azt1;
-    VaccSurf *ref;
+    int natom, *marks;
 
-    /* Get the atom information */
-    ref = thee->refSphere;
-    temp_Pos = Vatom_getPosition(atom);
-    tRad = Vatom_getRadius(atom);
-    iatom = Vatom_getAtomID(atom);
+    natom = Valist_getNumberAtoms(thee->alist);
+    marks = (int*)calloc(natom, sizeof(int));
+    VASSERT(marks != VNULL);
 
-    dSA[0] = 0.0;
-    dSA[1] = 0.0;
-    dSA[2] = 0.0;
+    Vacc_atomdSASAArcs(thee, srad, Vatom_getAtomID(atom), marks, VNULL, dSA);
 
-    tPos[0] = temp_Pos[0];
-    tPos[1] = temp_Pos[1];
-    tPos[2] = temp_Pos[2];
-
-    /* Shift by pos -/+ on x */
-    temp_Pos[0] -= dpos;
-    axb1 = Vacc_atomSASAPos(thee, srad, atom, 1);
-    temp_Pos[0] = tPos[0];
-
-    temp_Pos[0] += dpos;
-    axt1 = Vacc_atomSASAPos(thee, srad, atom, 1);
-    temp_Pos[0] = tPos[0];
-
-    /* Shift by pos -/+ on y */
-    temp_Pos[1] -= dpos;
-    ayb1 = Vacc_atomSASAPos(thee, srad, atom, 1);
-    temp_Pos[1] = tPos[1];
-
-    temp_Pos[1] += dpos;
-    ayt1 = Vacc_atomSASAPos(thee, srad, atom, 1);
-    temp_Pos[1] = tPos[1];
-
-    /* Shift by pos -/+ on z */
-    temp_Pos[2] -= dpos;
-    azb1 = Vacc_atomSASAPos(thee, srad, atom, 1);
-    temp_Pos[2] = tPos[2];
-
-    temp_Pos[2] += dpos;
-    azt1 = Vacc_atomSASAPos(thee, srad, atom, 1);
-    temp_Pos[2] = tPos[2];
-
-    /* Calculate the final value */
-    dSA[0] = (axt1-axb1)/(2.0 * dpos);
-    dSA[1] = (ayt1-ayb1)/(2.0 * dpos);
-    dSA[2] = (azt1-azb1)/(2.0 * dpos);
+    free(marks);
 }
 
-/* Note: This is purely test code to make certain that the dSASA code is
-         behaving properly. This function should NEVER be called by anyone
-         other than an APBS developer at Wash U.
-*/
+/* ///////////////////////////////////////////////////////////////////////////
+   // Routine:  Vacc_totalAtomdSAV
+   //
+   // Purpose:  Calculates the derivative of the total solvent accessible
+   //           volume with respect to the displacement of a single atom.
+   //           Moving an atom only changes the volume through its exposed
+   //           surface, so this is the surface integral of the outward
+   //           normal over the atom's accessible points (see Vacc_atomdSAV);
+   //           no volume integrations are performed.
+   //
+   // Author:   David Gohara
+   //           Nathan Baker
+   /////////////////////////////////////////////////////////////////////////// */
 VPUBLIC void Vacc_totalAtomdSAV(Vacc *thee, double dpos, double srad, Vatom *atom, double *dSA, Vclist *clist) {
 
-    int iatom;
-    double *temp_Pos, tRad;
-    double tPos[3];
-    double axb1,axt1,ayb1,ayt1,azb1,azt1;
-    VaccSurf *ref;
+    Vacc_atomdSAV(thee, srad, atom, dSA);
 
-    /* Get the atom information */
-    ref = thee->refSphere;
-    temp_Pos = Vatom_getPosition(atom);
-    tRad = Vatom_getRadius(atom);
-    iatom = Vatom_getAtomID(atom);
+}
 
-    dSA[0] = 0.0;
-    dSA[1] = 0.0;
-    dSA[2] = 0.0;
+VPUBLIC int Vacc_allAtomdSASA(Vacc *thee,
+                              double srad,
+                              double *dSASA,
+                              double *dSASAtotal
+                             ) {
+
+    int i, natom;
+
+    VASSERT(thee != VNULL);
+    if ((dSASA == VNULL) && (dSASAtotal == VNULL)) return VRC_SUCCESS;
+
+    natom = Valist_getNumberAtoms(thee->alist);
+
+#pragma omp parallel default(shared) private(i)
+    {
+        int *marks = (int*)calloc(natom, sizeof(int));
+        VASSERT(marks != VNULL);
+#pragma omp for schedule(dynamic, 64)
+        for (i=0; i<natom; i++) {
+            Vacc_atomdSASAArcs(thee, srad, i, marks,
+                (dSASA == VNULL) ? VNULL : &(dSASA[VAPBS_DIM*i]),
+                (dSASAtotal == VNULL) ? VNULL : &(dSASAtotal[VAPBS_DIM*i]));
+        }
+        free(marks);
+    }
+
+    return VRC_SUCCESS;
+}
+
+VPUBLIC int Vacc_allAtomdSAV(Vacc *thee,
+                             double srad,
+                             double *dSAV
+                            ) {
+
+    int i, natom;
+
+    VASSERT(thee != VNULL);
+    if (dSAV == VNULL) return VRC_SUCCESS;
+
+    natom = Valist_getNumberAtoms(thee->alist);
+
+#pragma omp parallel for default(shared) private(i) schedule(dynamic, 64)
+    for (i=0; i<natom; i++) {
+        Vacc_atomdSAV(thee, srad, Valist_getAtom(thee->alist, i),
+                      &(dSAV[VAPBS_DIM*i]));
+    }
+
+    return VRC_SUCCESS;
+}
+
+/**
+ * @brief  Set up the nodes and trapezoid-rule weights for one dimension of
+ *         an apolar integration grid
+ *
+ * The nodes are generated by the same repeated addition the serial loops
+ * used so that the parallel integrations visit exactly the same points.
+ *
+ * @returns Number of nodes
+ */
+VPRIVATE int Vacc_gridNodes(double lower,  /** Lower bound */
+                            double upper,  /** Upper bound */
+                            double spac,  /** Grid spacing */
+                            double **nodes,  /** Set to array of nodes */
+                            double **weights  /** Set to array of weights */
+                            ) {
+
+    int i, n;
+    double x;
+
+    n = 0;
+    for (x=lower; x<=upper; x=x+spac) n++;
+
+    *nodes = (double *)Vmem_malloc(VNULL, VMAX2(n, 1), sizeof(double));
+    *weights = (double *)Vmem_malloc(VNULL, VMAX2(n, 1), sizeof(double));
+
+    i = 0;
+    for (x=lower; x<=upper; x=x+spac) {
+        (*nodes)[i] = x;
+        if ( VABS(x - lower) < VSMALL) {
+            (*weights)[i] = 0.5;
+        } else if ( VABS(x - upper) < VSMALL) {
+            (*weights)[i] = 0.5;
+        } else {
+            (*weights)[i] = 1.0;
+        }
+        i++;
+    }
 
-    tPos[0] = temp_Pos[0];
-    tPos[1] = temp_Pos[1];
-    tPos[2] = temp_Pos[2];
-
-    /* Shift by pos -/+ on x */
-    temp_Pos[0] -= dpos;
-    axb1 = Vacc_totalSAV(thee,clist, VNULL, srad);
-    temp_Pos[0] = tPos[0];
-
-    temp_Pos[0] += dpos;
-    axt1 = Vacc_totalSAV(thee,clist, VNULL, srad);
-    temp_Pos[0] = tPos[0];
-
-    /* Shift by pos -/+ on y */
-    temp_Pos[1] -= dpos;
-    ayb1 = Vacc_totalSAV(thee,clist, VNULL, srad);
-    temp_Pos[1] = tPos[1];
-
-    temp_Pos[1] += dpos;
-    ayt1 = Vacc_totalSAV(thee,clist, VNULL, srad);
-    temp_Pos[1] = tPos[1];
-
-    /* Shift by pos -/+ on z */
-    temp_Pos[2] -= dpos;
-    azb1 = Vacc_totalSAV(thee,clist, VNULL, srad);
-    temp_Pos[2] = tPos[2];
-
-    temp_Pos[2] += dpos;
-    azt1 = Vacc_totalSAV(thee,clist, VNULL, srad);
-    temp_Pos[2] = tPos[2];
-
-    /* Calculate the final value */
-    dSA[0] = (axt1-axb1)/(2.0 * dpos);
-    dSA[1] = (ayt1-ayb1)/(2.0 * dpos);
-    dSA[2] = (azt1-azb1)/(2.0 * dpos);
+    return n;
 }
 
 VPUBLIC double Vacc_totalSAV(Vacc *thee, Vclist *clist, APOLparm *apolparm, double radius) {
 
-    int i;
-    int npts[3];
+    int i, ix, iy, iz, npts[3];
 
     double spacs[3], vec[3];
-    double w, wx, wy, wz, len, fn, x, y, z, vol;
-    double vol_density,sav;
+    double w, len, sum, sav;
     double *lower_corner, *upper_corner;
-
-    sav = 0.0;
-    vol = 1.0;
-    vol_density = 2.0;
+    double *nodes[3], *weights[3], *partial;
 
     lower_corner = clist->lower_corner;
     upper_corner = clist->upper_corner;
 
     for (i=0; i<3; i++) {
         len = upper_corner[i] - lower_corner[i];
-        vol *= len;
-        fn = len*vol_density + 1;
-        npts[i] = (int)ceil(fn);
+        npts[i] = (int)ceil(len*VACC_VOLDENSITY + 1);
         spacs[i] = len/((double)(npts[i])-1.0);
         if (apolparm != VNULL) {
             if (apolparm->setgrid) {
@@ -1533,91 +1652,87 @@ VPUBLIC double Vacc_totalSAV(Vacc *thee, Vclist *clist, APOLparm *apolparm, doub
 
             }
         }
+        npts[i] = Vacc_gridNodes(lower_corner[i], upper_corner[i], spacs[i],
+                                 &(nodes[i]), &(weights[i]));
     }
 
-    for (x=lower_corner[0]; x<=upper_corner[0]; x=x+spacs[0]) {
-        if ( VABS(x - lower_corner[0]) < VSMALL) {
-            wx = 0.5;
-        } else if ( VABS(x - upper_corner[0]) < VSMALL) {
-            wx = 0.5;
-        } else {
-            wx = 1.0;
-        }
-        vec[0] = x;
-        for (y=lower_corner[1]; y<=upper_corner[1]; y=y+spacs[1]) {
-            if ( VABS(y - lower_corner[1]) < VSMALL) {
-                wy = 0.5;
-            } else if ( VABS(y - upper_corner[1]) < VSMALL) {
-                wy = 0.5;
-            } else {
-                wy = 1.0;
-            }
-            vec[1] = y;
-            for (z=lower_corner[2]; z<=upper_corner[2]; z=z+spacs[2]) {
-                if ( VABS(z - lower_corner[2]) < VSMALL) {
-                    wz = 0.5;
-                } else if ( VABS(z - upper_corner[2]) < VSMALL) {
-                    wz = 0.5;
-                } else {
-                    wz = 1.0;
-                }
-                vec[2] = z;
-
-                w = wx*wy*wz;
-
-                sav += (w*(1.0-Vacc_ivdwAcc(thee, vec, radius)));
-
+    /* Each thread integrates whole x-planes; the plane sums are combined in
+     * order afterwards so the result does not depend on the thread count */
+    partial = (double *)Vmem_malloc(VNULL, VMAX2(npts[0], 1), sizeof(double));
+
+#pragma omp parallel for default(shared) private(ix,iy,iz,vec,w,sum) schedule(dynamic,1)
+    for (ix=0; ix<npts[0]; ix++) {
+        vec[0] = nodes[0][ix];
+        sum = 0.0;
+        for (iy=0; iy<npts[1]; iy++) {
+            vec[1] = nodes[1][iy];
+            for (iz=0; iz<npts[2]; iz++) {
+                vec[2] = nodes[2][iz];
+                w = weights[0][ix]*weights[1][iy]*weights[2][iz];
+                sum += (w*(1.0-Vacc_ivdwAcc(thee, vec, radius)));
             } /* z loop */
         } /* y loop */
+        partial[ix] = sum;
     } /* x loop */
 
+    sav = 0.0;
+    for (ix=0; ix<npts[0]; ix++) sav += partial[ix];
+
     w  = spacs[0]*spacs[1]*spacs[2];
     sav *= w;
 
+    Vmem_free(VNULL, VMAX2(npts[0], 1), sizeof(double), (void **)&partial);
+    for (i=0; i<3; i++) {
+        Vmem_free(VNULL, VMAX2(npts[i], 1), sizeof(double),
+                  (void **)&(nodes[i]));
+        Vmem_free(VNULL, VMAX2(npts[i], 1), sizeof(double),
+                  (void **)&(weights[i]));
+    }
+
     return sav;
 }
 
-int Vacc_wcaEnergyAtom(Vacc *thee, APOLparm *apolparm, Valist *alist,
-                                 Vclist *clist, int iatom, double *value) {
+/**
+ * @brief  Integrate the WCA dispersion energy and force for a single atom
+ *
+ * The energy and force integrands share the same accessibility values, so
+ * both are accumulated in one pass over the atom's integration box.
+ *
+ * @returns Success enumeration
+ */
+VPRIVATE int Vacc_wcaIntegrateAtom(Vacc *thee,  /** Accessibility object */
+                                   APOLparm *apolparm,  /** Apolar parameters */
+                                   Vclist *clist,  /** Cell list */
+                                   Vatom *atom,  /** Atom of interest */
+                                   double *value,  /** Set to energy (can be
+                                                    * VNULL) */
+                                   double *force  /** Set to force (can be
+                                                   * VNULL) */
+                                   ) {
 
     int i;
-    int npts[3];
     int pad = 14;
 
-        int xmin, ymin, zmin;
-        int xmax, ymax, zmax;
+    int xmin, ymin, zmin;
+    int xmax, ymax, zmax;
 
-        double sigma6, sigma12;
+    double sigma6, sigma12;
 
-    double spacs[3], vec[3];
-    double w, wx, wy, wz, len, fn, x, y, z, vol;
-    double x2,y2,z2,r;
-    double vol_density, energy, rho, srad;
+    double spacs[3], vec[3], fpt[3], tforce[3];
+    double w, wx, wy, wz, x, y, z;
+    double x2, y2, z2, r;
+    double energy, rho, srad, fo;
     double psig, epsilon, watepsilon, sigma, watsigma, eni, chi;
 
     double *pos;
-    double *lower_corner, *upper_corner;
 
-    Vatom *atom = VNULL;
     VASSERT(apolparm != VNULL);
 
     energy = 0.0;
-    vol = 1.0;
-    vol_density = 2.0;
+    for (i=0; i<3; i++) tforce[i] = 0.0;
 
-    lower_corner = clist->lower_corner;
-    upper_corner = clist->upper_corner;
-
-    atom = Valist_getAtom(alist, iatom);
     pos = Vatom_getPosition(atom);
 
-    /* Note:  these are the original temporary water parameters... they have been
-        replaced by entries in a parameter file:
-    watsigma = 1.7683;
-    watepsilon =  0.1521;
-    watepsilon = watepsilon*4.184;
-    */
-
     srad = apolparm->srad;
     rho = apolparm->bconc;
     watsigma = apolparm->watsigma;
@@ -1640,10 +1755,6 @@ int Vacc_wcaEnergyAtom(Vacc *thee, APOLparm *apolparm, Valist *alist,
     zmax = pos[2] + pad;
 
     for (i=0; i<3; i++) {
-        len = (upper_corner[i] + pad) - (lower_corner[i] - pad);
-        vol *= len;
-        fn = len*vol_density + 1;
-        npts[i] = (int)ceil(fn);
         spacs[i] = 0.5;
         if (apolparm->setgrid) {
             if (apolparm->grid[i] > spacs[i]) {
@@ -1686,6 +1797,9 @@ int Vacc_wcaEnergyAtom(Vacc *thee, APOLparm *apolparm, Valist *alist,
 
                 chi = Vacc_ivdwAcc(thee, vec, srad);
 
+                eni = 0.0;
+                for (i=0; i<3; i++) fpt[i] = 0.0;
+
                 if (VABS(chi) > VSMALL) {
 
                     x2 = VSQR(vec[0]-pos[0]);
@@ -1695,25 +1809,147 @@ int Vacc_wcaEnergyAtom(Vacc *thee, APOLparm *apolparm, Valist *alist,
 
                     if (r <= 14 && r >= sigma) {
                         eni = chi*rho*epsilon*(-2.0*sigma6/VPOW(r,6)+sigma12/VPOW(r,12));
-                    }else if (r <= 14){
+
+                        if (force != VNULL) {
+                            fo = 12.0*chi*rho*epsilon*(sigma6/VPOW(r,7)-sigma12/VPOW(r,13));
+
+                            fpt[0] = -1.0*(pos[0]-vec[0])*fo/r;
+                            fpt[1] = -1.0*(pos[1]-vec[1])*fo/r;
+                            fpt[2] = -1.0*(pos[2]-vec[2])*fo/r;
+                        }
+                    } else if (r <= 14) {
                         eni = -1.0*epsilon*chi*rho;
-                    }else{
-                        eni = 0.0;
                     }
-                }else{
-                    eni = 0.0;
                 }
 
                 energy += eni*w;
+                for (i=0; i<3; i++) tforce[i] += (w*fpt[i]);
 
             } /* z loop */
         } /* y loop */
     } /* x loop */
 
     w  = spacs[0]*spacs[1]*spacs[2];
-    energy *= w;
+    if (value != VNULL) *value = energy*w;
+    if (force != VNULL) {
+        for (i=0; i<3; i++) force[i] = tforce[i]*w;
+    }
+
+    return VRC_SUCCESS;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vacc_wcaKey
+//
+// Purpose:  Collect the APOLparm values the WCA integrals depend on, so the
+//           cached integrals are matched on values rather than on the
+//           address of the parameter object
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void Vacc_wcaKey(APOLparm *apolparm, double key[8]) {
+
+    key[0] = apolparm->srad;
+    key[1] = apolparm->bconc;
+    key[2] = apolparm->watsigma;
+    key[3] = apolparm->watepsilon;
+    key[4] = (double)apolparm->setgrid;
+    key[5] = apolparm->setgrid ? apolparm->grid[0] : 0.0;
+    key[6] = apolparm->setgrid ? apolparm->grid[1] : 0.0;
+    key[7] = apolparm->setgrid ? apolparm->grid[2] : 0.0;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vacc_wcaCached
+//
+// Purpose:  Whether the cached WCA integrals were computed for these
+//           parameters and exactly these atoms
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vacc_wcaCached(Vacc *thee, APOLparm *apolparm, Valist *alist) {
+
+    double key[8];
+    int i;
+
+    if ((thee->wcaEnergy == VNULL) || (thee->wcaGeneration == 0) ||
+            (thee->wcaGeneration != alist->generation) ||
+            (thee->wcaNatoms != Valist_getNumberAtoms(alist))) return 0;
+    Vacc_wcaKey(apolparm, key);
+    for (i=0; i<8; i++) {
+        if (key[i] != thee->wcaParm[i]) return 0;
+    }
+
+    return 1;
+}
+
+int Vacc_wcaEnergyAtom(Vacc *thee, APOLparm *apolparm, Valist *alist,
+                                 Vclist *clist, int iatom, double *value) {
+
+    VASSERT(apolparm != VNULL);
+
+    /* Use the values from Vacc_wcaAtoms if they are available */
+    if (Vacc_wcaCached(thee, apolparm, alist)) {
+        *value = thee->wcaEnergy[iatom];
+        return VRC_SUCCESS;
+    }
+
+    return Vacc_wcaIntegrateAtom(thee, apolparm, clist,
+                                 Valist_getAtom(alist, iatom), value, VNULL);
+}
+
+VPUBLIC int Vacc_wcaAtoms(Vacc *thee,
+                          APOLparm *apolparm,
+                          Valist *alist,
+                          Vclist *clist,
+                          double **energy,
+                          double **force
+                          ) {
+
+    int iatom, natoms, rc;
+
+    VASSERT(apolparm != VNULL);
+
+    if(apolparm->setwat == 0){
+        Vnm_print(2,"Vacc_wcaAtoms: Error. No value was set for watsigma and watepsilon.\n");
+        return VRC_FAILURE;
+    }
+
+    natoms = Valist_getNumberAtoms(alist);
+
+    /* Recompute only if the cached values belong to other parameters or
+     * other atoms, or the atoms have changed since */
+    if (!Vacc_wcaCached(thee, apolparm, alist)) {
 
-    *value = energy;
+        thee->wcaGeneration = 0;
+        if ((thee->wcaEnergy != VNULL) && (thee->wcaNatoms != natoms)) {
+            Vmem_free(thee->mem, thee->wcaNatoms, sizeof(double),
+                    (void **)&(thee->wcaEnergy));
+            Vmem_free(thee->mem, 3*thee->wcaNatoms, sizeof(double),
+                    (void **)&(thee->wcaForce));
+        }
+        if (thee->wcaEnergy == VNULL) {
+            thee->wcaEnergy = (double *)Vmem_malloc(thee->mem, natoms,
+                                                    sizeof(double));
+            thee->wcaForce = (double *)Vmem_malloc(thee->mem, 3*natoms,
+                                                   sizeof(double));
+            thee->wcaNatoms = natoms;
+        }
+
+        rc = VRC_SUCCESS;
+#pragma omp parallel for default(shared) private(iatom) schedule(dynamic,1)
+        for (iatom=0; iatom<natoms; iatom++) {
+            if (Vacc_wcaIntegrateAtom(thee, apolparm, clist,
+                    Valist_getAtom(alist, iatom), &(thee->wcaEnergy[iatom]),
+                    &(thee->wcaForce[3*iatom])) != VRC_SUCCESS) {
+#pragma omp critical
+                rc = VRC_FAILURE;
+            }
+        }
+        if (rc != VRC_SUCCESS) return VRC_FAILURE;
+
+        Vacc_wcaKey(apolparm, thee->wcaParm);
+        thee->wcaGeneration = alist->generation;
+    }
+
+    if (energy != VNULL) *energy = thee->wcaEnergy;
+    if (force != VNULL) *force = thee->wcaForce;
 
     return VRC_SUCCESS;
 }
@@ -1722,9 +1958,8 @@ VPUBLIC int Vacc_wcaEnergy(Vacc *acc, APOLparm *apolparm, Valist *alist,
                              Vclist *clist){
 
     int iatom;
-    int rc = 0;
 
-    double energy = 0.0;
+    double *energy = VNULL;
     double tenergy = 0.0;
     double rho = apolparm->bconc;
 
@@ -1740,11 +1975,14 @@ VPUBLIC int Vacc_wcaEnergy(Vacc *acc, APOLparm *apolparm, Valist *alist,
         return 1;
     }
 
-    for (iatom=0; iatom<Valist_getNumberAtoms(alist); iatom++){
-        rc = Vacc_wcaEnergyAtom(acc, apolparm, alist, clist, iatom, &energy);
-        if(rc == 0) return 0;
+    if (Vacc_wcaAtoms(acc, apolparm, alist, clist, &energy, VNULL)
+            != VRC_SUCCESS) {
+        return 0;
+    }
 
-        tenergy += energy;
+    /* Sum in atom order so the total does not depend on the thread count */
+    for (iatom=0; iatom<Valist_getNumberAtoms(alist); iatom++){
+        tenergy += energy[iatom];
     }
 
     apolparm->wcaEnergy = tenergy;
@@ -1759,53 +1997,8 @@ VPUBLIC int Vacc_wcaForceAtom(Vacc *thee,
                               Vatom *atom,
                               double *force
                              ){
-    int i,
-        si,
-        npts[3],
-        pad = 14,
-        xmin,
-        ymin,
-        zmin,
-        xmax,
-        ymax,
-        zmax;
-
-    double sigma6,
-           sigma12,
-           spacs[3],
-           vec[3],
-           fpt[3],
-           w,
-           wx,
-           wy,
-           wz,
-           len,
-           fn,
-           x,
-           y,
-           z,
-           vol,
-           x2,
-           y2,
-           z2,
-           r,
-           vol_density,
-           fo,
-           rho,
-           srad,
-           psig,
-           epsilon,
-           watepsilon,
-           sigma,
-           watsigma,
-           chi,
-           *pos,
-           *lower_corner,
-           *upper_corner;
-
-    /* Allocate needed variables now that we've asserted required conditions. */
-    time_t ts;
-    ts = clock();
+
+    int i, iatom;
 
     VASSERT(apolparm != VNULL);
 
@@ -1816,116 +2009,13 @@ VPUBLIC int Vacc_wcaForceAtom(Vacc *thee,
         return VRC_FAILURE;
     }
 
-    vol = 1.0;
-    vol_density = 2.0;
-
-    lower_corner = clist->lower_corner;
-    upper_corner = clist->upper_corner;
-
-    pos = Vatom_getPosition(atom);
-
-    srad = apolparm->srad;
-    rho = apolparm->bconc;
-    watsigma = apolparm->watsigma;
-    watepsilon = apolparm->watepsilon;
-
-    psig = atom->radius;
-    epsilon = atom->epsilon;
-    sigma = psig + watsigma;
-    epsilon = VSQRT((epsilon * watepsilon));
-
-    /* parameters */
-    sigma6 = VPOW(sigma,6);
-    sigma12 = VPOW(sigma,12);
-    /* OPLS-style radius:  double sigmar = sigma*VPOW(2, (1.0/6.0));  */
-
-    for (i=0; i<3; i++) {
-        len = (upper_corner[i] + pad) - (lower_corner[i] - pad);
-        vol *= len;
-        fn = len*vol_density + 1;
-        npts[i] = (int)ceil(fn);
-        spacs[i] = 0.5;
-        force[i] = 0.0;
-        if (apolparm->setgrid) {
-            if (apolparm->grid[i] > spacs[i]) {
-                Vnm_print(2, "Vacc_totalSAV:  Warning, your GRID value (%g) is larger than the recommended value (%g)!\n",
-                    apolparm->grid[i], spacs[i]);
-            }
-            spacs[i] = apolparm->grid[i];
-        }
+    /* Use the values from Vacc_wcaAtoms if they are available */
+    iatom = Vatom_getAtomID(atom);
+    if (Vacc_wcaCached(thee, apolparm, thee->alist)
+            && (Valist_getAtom(thee->alist, iatom) == atom)) {
+        for (i=0; i<3; i++) force[i] = thee->wcaForce[3*iatom+i];
+        return VRC_SUCCESS;
     }
 
-    xmin = pos[0] - pad;
-    xmax = pos[0] + pad;
-    ymin = pos[1] - pad;
-    ymax = pos[1] + pad;
-    zmin = pos[2] - pad;
-    zmax = pos[2] + pad;
-
-    for (x=xmin; x<=xmax; x=x+spacs[0]) {
-        if ( VABS(x - xmin) < VSMALL) {
-            wx = 0.5;
-        } else if ( VABS(x - xmax) < VSMALL) {
-            wx = 0.5;
-        } else {
-            wx = 1.0;
-        }
-        vec[0] = x;
-        for (y=ymin; y<=ymax; y=y+spacs[1]) {
-            if ( VABS(y - ymin) < VSMALL) {
-                wy = 0.5;
-            } else if ( VABS(y - ymax) < VSMALL) {
-                wy = 0.5;
-            } else {
-                wy = 1.0;
-            }
-            vec[1] = y;
-            for (z=zmin; z<=zmax; z=z+spacs[2]) {
-                if ( VABS(z - zmin) < VSMALL) {
-                    wz = 0.5;
-                } else if ( VABS(z - zmax) < VSMALL) {
-                    wz = 0.5;
-                } else {
-                    wz = 1.0;
-                }
-                vec[2] = z;
-
-                w = wx*wy*wz;
-
-                chi = Vacc_ivdwAcc(thee, vec, srad);
-
-                if (chi != 0.0) {
-
-                    x2 = VSQR(vec[0]-pos[0]);
-                    y2 = VSQR(vec[1]-pos[1]);
-                    z2 = VSQR(vec[2]-pos[2]);
-                    r = VSQRT(x2+y2+z2);
-
-                    if (r <= 14 && r >= sigma){
-
-                        fo = 12.0*chi*rho*epsilon*(sigma6/VPOW(r,7)-sigma12/VPOW(r,13));
-
-                        fpt[0] = -1.0*(pos[0]-vec[0])*fo/r;
-                        fpt[1] = -1.0*(pos[1]-vec[1])*fo/r;
-                        fpt[2] = -1.0*(pos[2]-vec[2])*fo/r;
-
-                    }else {
-                        for (si=0; si < 3; si++) fpt[si] = 0.0;
-                    }
-                }else {
-                    for (si=0; si < 3; si++) fpt[si] = 0.0;
-                }
-
-                for(i=0;i<3;i++){
-                    force[i] += (w*fpt[i]);
-                }
-
-            } /* z loop */
-        } /* y loop */
-    } /* x loop */
-
-    w  = spacs[0]*spacs[1]*spacs[2];
-    for(i=0;i<3;i++) force[i] *= w;
-
-    return VRC_SUCCESS;
+    return Vacc_wcaIntegrateAtom(thee, apolparm, clist, atom, VNULL, force);
 }
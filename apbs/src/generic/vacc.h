@@ -121,6 +121,18 @@ struct sVacc {
               * with length equal to the number of vertices in the mesh */
   double surf_density;  /**< Minimum solvent accessible surface point density
                          * (in pts/A^2) */
+  double *wcaEnergy;  /**< Array of per-atom WCA energies; is not initialized
+                       * until needed (see Vacc_wcaAtoms) */
+  double *wcaForce;  /**< Array of 3*natoms per-atom WCA forces; initialized
+                      * together with thee->wcaEnergy */
+  int wcaNatoms;  /**< Number of atoms thee->wcaEnergy and thee->wcaForce
+                  * were allocated for */
+  int wcaGeneration;  /**< Valist::generation of the atoms thee->wcaEnergy
+                       * and thee->wcaForce were computed for, or 0 if they
+                       * hold no valid values */
+  double wcaParm[8];  /**< The APOLparm values the WCA integrals depend on
+                       * (srad, bconc, watsigma, watepsilon, setgrid and
+                       * grid) when thee->wcaEnergy was computed */
 
 };
 
@@ -267,6 +279,16 @@ VEXTERNC void Vacc_dtor2(
         Vacc *thee /**< Pointer to object */
         );
 
+/** @brief   Drop the per-atom surfaces and energies cached from the current
+ *           atom positions
+ *  @ingroup Vacc
+ *  @note    Call this after the atoms of the molecule have moved; the cell
+ *           list must already be up to date (see Vclist_moveAtom).
+ */
+VEXTERNC void Vacc_resetCache(
+        Vacc *thee /**< Accessibility object */
+        );
+
 /** @brief   Report van der Waals accessibility
  *
  *  Determines if a point is within the union of the atomic spheres (with
@@ -361,6 +383,24 @@ VEXTERNC double Vacc_splineAcc(
         double infrad  /**< Inflation radius (&Aring;) for ion access. */
         );
 
+/** @brief   Report spline-based accessibility using caller-owned scratch
+ *
+ *  Same as Vacc_splineAcc, but the per-atom flags used to avoid counting an
+ *  atom twice are supplied by the caller, so several threads can evaluate
+ *  points concurrently, each with its own array.
+ *
+ *  @ingroup Vacc
+ *  @returns Characteristic function value between 1.0 (accessible) and 0.0
+ *          (inaccessible)
+ */
+VEXTERNC double Vacc_splineAccMarks(
+        Vacc *thee, /**< Accessibility object */
+        double center[VAPBS_DIM], /**< Probe center coordinates */
+        double win, /**< Spline window (&Aring;) */
+        double infrad,  /**< Inflation radius (&Aring;) for ion access. */
+        int *marks  /**< Scratch array with one entry per atom */
+        );
+
 /** @brief   Report gradient of spline-based accessibility.
  *
  *  @ingroup Vacc
@@ -529,45 +569,89 @@ VEXTERNC void Vacc_atomdSAV(
                             );
 
 /**
-* @brief  Get the derivatve of solvent accessible area
+* @brief  Get the derivatve of the atom's solvent accessible area with
+ *         respect to its position
+ *
+ * The derivative is evaluated analytically as a line integral over the
+ * exposed arcs of the atom's circles of intersection with its neighbors.
+ * Neither the atom nor the cached surface is modified.
+ *
  * @ingroup  Vacc
  * @author  Jason Wagoner, David Gohara, Nathan Baker
  */
 VEXTERNC void Vacc_atomdSASA(
                             Vacc *thee, /**< Acessibility object */
-                            double dpos, /**< Atom position offset */
+                            double dpos, /**< Unused; retained for
+                                          * compatibility with the former
+                                          * finite difference method */
                             double radius, /**< Probe radius (&Aring;) */
                             Vatom *atom, /**< Atom of interest */
                             double *dSA /**< Array holding answers of calc */
                             );
 
 /**
-* @brief  Testing purposes only
+* @brief  Get the derivative of the total solvent accessible area with
+ *         respect to the position of one atom
  * @ingroup  Vacc
  * @author  David Gohara, Nathan Baker
  */
 VEXTERNC void Vacc_totalAtomdSASA(
                              Vacc *thee, /**< Acessibility object */
-                             double dpos, /**< Atom position offset */
+                             double dpos, /**< Unused */
                              double radius, /**< Probe radius (&Aring;) */
                              Vatom *atom, /**< Atom of interest */
                              double *dSA /**< Array holding answers of calc */
                              );
 
 /**
-* @brief  Total solvent accessible volume
+* @brief  Get the derivative of the total solvent accessible volume with
+ *         respect to the position of one atom
+ * @note   Equivalent to Vacc_atomdSAV; the volume only changes through the
+ *         atom's exposed surface
  * @ingroup  Vacc
  * @author  David Gohara, Nathan Baker
  */
 VEXTERNC void Vacc_totalAtomdSAV(
                                  Vacc *thee, /**< Acessibility object */
-                                 double dpos, /**< Atom position offset */
+                                 double dpos, /**< Unused */
                                  double radius, /**< Probe radius (&Aring;) */
                                  Vatom *atom, /**< Atom of interest */
                                  double *dSA, /**< Array holding answers of calc */
                                  Vclist *clist /**< clist for this calculation */
                                  );
 
+/**
+ * @brief  Get the solvent accessible area derivatives for every atom in a
+ *         single (OpenMP parallel) sweep
+ * @ingroup  Vacc
+ * @return  Success enumeration
+ */
+VEXTERNC int Vacc_allAtomdSASA(
+        Vacc *thee, /**< Acessibility object */
+        double radius, /**< Probe radius (&Aring;) */
+        double *dSASA, /**< Array of length 3*natoms set to the derivative of
+                        * each atom's area with respect to its position (as
+                        * Vacc_atomdSASA); can be VNULL */
+        double *dSASAtotal /**< Array of length 3*natoms set to the
+                            * derivative of the total area with respect to
+                            * each atom's position (as Vacc_totalAtomdSASA);
+                            * can be VNULL */
+        );
+
+/**
+ * @brief  Get the solvent accessible volume derivatives for every atom in a
+ *         single (OpenMP parallel) sweep
+ * @ingroup  Vacc
+ * @return  Success enumeration
+ */
+VEXTERNC int Vacc_allAtomdSAV(
+        Vacc *thee, /**< Acessibility object */
+        double radius, /**< Probe radius (&Aring;) */
+        double *dSAV /**< Array of length 3*natoms set to the derivative of
+                      * the volume with respect to each atom's position (as
+                      * Vacc_atomdSAV) */
+        );
+
 /**
  * @brief  Return the total solvent accessible volume (SAV)
  * @ingroup  Vacc
@@ -595,6 +679,29 @@ VEXTERNC int Vacc_wcaEnergy(
                              Valist *alist, /**< Alist for acc object */
                              Vclist *clist /**< Clist for acc object */
                              );
+/**
+ * @brief  Calculate the WCA energies and forces for all atoms
+ *
+ * The atoms are integrated in parallel and the energy and force integrands
+ * share a single accessibility evaluation per point.  The results are cached
+ * in the accessibility object and reused by Vacc_wcaEnergy,
+ * Vacc_wcaEnergyAtom and Vacc_wcaForceAtom for the same parameters until
+ * the atoms change (see Valist_touch).
+ *
+ * @ingroup  Vacc
+ * @return Success enumeration
+ */
+VEXTERNC int Vacc_wcaAtoms(
+        Vacc *thee,  /**< Accessibility object */
+        APOLparm *apolparm,  /**< Apolar calculation parameters */
+        Valist *alist,  /**< Alist for acc object */
+        Vclist *clist,  /**< Clist for acc object */
+        double **energy,  /**< Set to the array of natoms per-atom energies
+                           * owned by thee (can be VNULL) */
+        double **force  /**< Set to the array of 3*natoms per-atom forces
+                         * owned by thee (can be VNULL) */
+        );
+
 /**
  * @brief  Return the WCA integral force
  * @ingroup  Vacc
@@ -54,6 +54,7 @@
  */
 
 #include "valist.h"
+#include <stddef.h>
 
 VEMBED(rcsid="$Id$")
 
@@ -152,10 +153,30 @@ VPUBLIC Valist* Valist_ctor() {
     return thee;
 }
 
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Valist_nextGeneration
+//
+// Purpose:  Hand out Valist::generation values; every call returns a new
+//           one, whichever list it is for
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Valist_nextGeneration(void) {
+
+    static int last = 0;
+    int gen;
+
+#pragma omp atomic capture
+    gen = ++last;
+
+    return gen;
+}
+
 VPUBLIC Vrc_Codes Valist_ctor2(Valist *thee) {
 
     thee->atoms = VNULL;
     thee->number = 0;
+    thee->mapbase = VNULL;
+    thee->mapsize = 0;
+    thee->generation = Valist_nextGeneration();
 
     /* Initialize the memory management object */
     thee->vmem = Vmem_ctor("APBS:VALIST");
@@ -175,13 +196,57 @@ VPUBLIC void Valist_dtor(Valist **thee)
 
 VPUBLIC void Valist_dtor2(Valist *thee) {
 
-    Vmem_free(thee->vmem, thee->number, sizeof(Vatom), (void **)&(thee->atoms));
+    if (thee->mapbase != VNULL) {
+        Vstring_unmapFile((char *)(thee->mapbase), thee->mapsize);
+        thee->mapbase = VNULL;
+        thee->mapsize = 0;
+    } else {
+        Vmem_free(thee->vmem, thee->number, sizeof(Vatom),
+          (void **)&(thee->atoms));
+    }
     thee->atoms = VNULL;
     thee->number = 0;
 
     Vmem_dtor(&(thee->vmem));
 }
 
+VPUBLIC Valist* Valist_clone(Valist *thee) {
+
+    Valist *copy = VNULL;
+    int i;
+
+    VASSERT(thee != VNULL);
+
+    /* See Valist_readRecordFile */
+#pragma omp critical(apbs_vmem)
+    {
+        copy = Valist_ctor();
+        if (thee->number > 0) {
+            copy->atoms = (Vatom *)Vmem_malloc(copy->vmem, thee->number,
+                                               sizeof(Vatom));
+            if (copy->atoms == VNULL) Valist_dtor(&copy);
+        }
+    }
+    if (copy == VNULL) {
+        Vnm_print(2, "Valist_clone:  Failed to allocate %d atoms!\n",
+                  thee->number);
+        return VNULL;
+    }
+    if (thee->number > 0) {
+        memcpy(copy->atoms, thee->atoms, thee->number*sizeof(Vatom));
+    }
+    copy->number = thee->number;
+    for (i=0; i<3; i++) {
+        copy->center[i] = thee->center[i];
+        copy->mincrd[i] = thee->mincrd[i];
+        copy->maxcrd[i] = thee->maxcrd[i];
+    }
+    copy->maxrad = thee->maxrad;
+    copy->charge = thee->charge;
+
+    return copy;
+}
+
 /* Read serial number from PDB ATOM/HETATM field */
 VPRIVATE Vrc_Codes Valist_readPDBSerial(Valist *thee, Vio *sock, int *serial) {
 
@@ -865,6 +930,823 @@ reading radius!\n", tok);
 
 }
 
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Valist_isWhite
+//
+// Purpose:  Character test matching Valist_whiteChars (xml = 0) or
+//           Valist_xmlwhiteChars (xml = 1) without a strchr per character
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Valist_isWhite(char c, int xml) {
+
+    if ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n')) return 1;
+    return (xml && ((c == '<') || (c == '>')));
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Valist_isDigit
+//
+// Purpose:  Locale-free decimal digit test
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Valist_isDigit(char c) {
+
+    return ((c >= '0') && (c <= '9'));
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Valist_foldCase
+//
+// Purpose:  Locale-free ASCII lower-casing for keyword comparisons
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE char Valist_foldCase(char c) {
+
+    return ((c >= 'A') && (c <= 'Z')) ? (char)(c - 'A' + 'a') : c;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Valist_nextToken
+//
+// Purpose:  Return the next token before end, skipping whitespace and
+//           treating a Valist_commChars character at the start of a token
+//           as running to the end of the line, as Vio_scanf does.  The
+//           token is not copied; its length is returned in len.
+//
+// Returns:  Pointer to the token or VNULL when none is left
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE const char *Valist_nextToken(const char **pos, const char *end,
+  int xml, int *len) {
+
+    const char *p, *tok;
+
+    p = *pos;
+    while (p < end) {
+        if (Valist_isWhite(*p, xml)) p++;
+        else if ((*p == '#') || (*p == '%')) {
+            while ((p < end) && (*p != '\n')) p++;
+        } else break;
+    }
+    if (p >= end) {
+        *pos = end;
+        return VNULL;
+    }
+    tok = p;
+    while ((p < end) && !Valist_isWhite(*p, xml)) p++;
+    *len = (int)(p - tok);
+    *pos = p;
+    return tok;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Valist_isToken
+//
+// Purpose:  Case-insensitive comparison of an uncopied token with a word
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Valist_isToken(const char *tok, int len, const char *word) {
+
+    int i;
+
+    for (i=0; i<len; i++) {
+        if (word[i] == '\0') return 0;
+        if (Valist_foldCase(tok[i]) != Valist_foldCase(word[i])) return 0;
+    }
+    return (word[len] == '\0');
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Valist_isRecord
+//
+// Purpose:  Is the uncopied token an ATOM/HETATM record keyword?
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Valist_isRecord(const char *tok, int len) {
+
+    if (len == 4) return Valist_isToken(tok, len, "ATOM");
+    if (len == 6) return Valist_isToken(tok, len, "HETATM");
+    return 0;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Valist_scanInt
+//
+// Purpose:  Parse an uncopied token as sscanf("%d") would, without copying
+//           it unless the token is too long for the fast path
+//
+// Returns:  1 if an integer was parsed, 0 otherwise
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Valist_scanInt(const char *tok, int len, int *val) {
+
+    char buf[VMAX_BUFSIZE];
+    int i, nd, neg, ti;
+
+    i = 0;
+    neg = 0;
+    if ((i < len) && ((tok[i] == '+') || (tok[i] == '-'))) {
+        neg = (tok[i] == '-');
+        i++;
+    }
+    ti = 0;
+    for (nd=0; (i < len) && Valist_isDigit(tok[i]); nd++, i++) {
+        if (nd == 9) break;
+        ti = 10*ti + (tok[i] - '0');
+    }
+    if ((nd > 0) && ((i == len) || !Valist_isDigit(tok[i]))) {
+        *val = neg ? -ti : ti;
+        return 1;
+    }
+    if ((nd == 0) || (len >= VMAX_BUFSIZE)) return 0;
+
+    /* Too many digits for the fast path */
+    memcpy(buf, tok, (size_t)len);
+    buf[len] = '\0';
+    return (sscanf(buf, "%d", val) == 1);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Valist_scanReal
+//
+// Purpose:  Parse an uncopied token as sscanf("%lf") would.  Plain decimal
+//           tokens whose significand fits in 53 bits and whose decimal
+//           exponent is at most 22 are converted with a single correctly
+//           rounded multiply or divide, which gives the same double as
+//           strtod; everything else is copied and handed to sscanf.
+//
+// Returns:  1 if a number was parsed, 0 otherwise
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Valist_scanReal(const char *tok, int len, double *val) {
+
+    static const double tens[23] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+        1e22
+    };
+    char buf[VMAX_BUFSIZE];
+    unsigned long long mant;
+    int i, j, nd, neg, eneg, ex, frac, fast;
+
+    i = 0;
+    neg = 0;
+    fast = 1;
+    if ((i < len) && ((tok[i] == '+') || (tok[i] == '-'))) {
+        neg = (tok[i] == '-');
+        i++;
+    }
+    mant = 0;
+    nd = 0;
+    frac = 0;
+    for (; (i < len) && Valist_isDigit(tok[i]); i++, nd++) {
+        if (mant > (9007199254740992ULL - 9)/10) fast = 0;
+        else mant = 10*mant + (unsigned long long)(tok[i] - '0');
+    }
+    if ((i < len) && (tok[i] == '.')) {
+        for (i++; (i < len) && Valist_isDigit(tok[i]); i++, nd++) {
+            if (mant > (9007199254740992ULL - 9)/10) fast = 0;
+            else mant = 10*mant + (unsigned long long)(tok[i] - '0');
+            frac++;
+        }
+    }
+    ex = 0;
+    if ((nd > 0) && (i < len) && ((tok[i] == 'e') || (tok[i] == 'E'))) {
+        j = i + 1;
+        eneg = 0;
+        if ((j < len) && ((tok[j] == '+') || (tok[j] == '-'))) {
+            eneg = (tok[j] == '-');
+            j++;
+        }
+        if ((j < len) && Valist_isDigit(tok[j])) {
+            for (; (j < len) && Valist_isDigit(tok[j]); j++) {
+                if (ex < 1000) ex = 10*ex + (tok[j] - '0');
+            }
+            if (eneg) ex = -ex;
+            i = j;
+        }
+    }
+    ex = ex - frac;
+
+    if (fast && (nd > 0) && (i == len) && (ex >= -22) && (ex <= 22)) {
+        if (ex < 0) *val = (double)mant/tens[-ex];
+        else *val = (double)mant*tens[ex];
+        if (neg) *val = -(*val);
+        return 1;
+    }
+    if (len >= VMAX_BUFSIZE) return 0;
+
+    /* Exotic or over-long token:  let the C library decide */
+    memcpy(buf, tok, (size_t)len);
+    buf[len] = '\0';
+    return (sscanf(buf, "%lf", val) == 1);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Valist_scanLine
+//
+// Purpose:  Scan the line starting at pos for Valist_readPDB_throughXYZ and
+//           Valist_readPDBChargeRadius fields.  A record must start its line
+//           and hold all of its fields; anything the fast loader cannot
+//           reproduce exactly (a record keyword in the middle of a line, a
+//           field that would run onto the next line or one of the
+//           malformed-field errors) makes it return VRC_WARNING so the
+//           caller can hand the whole file to the token reader instead.
+//
+// Returns:  VRC_SUCCESS for a parsed record, VRC_FAILURE for a line with no
+//           record and VRC_WARNING as above.  pos is left at the start of
+//           the next line.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE Vrc_Codes Valist_scanLine(const char **pos, const char *end,
+  int pqr, int parse, char atomName[VMAX_ARGLEN],
+  char resName[VMAX_ARGLEN], double *val) {
+
+    const char *p, *eol, *tok;
+    int i, len, ti, isrec;
+
+    p = *pos;
+    eol = (const char *)memchr(p, '\n', (size_t)(end - p));
+    if (eol == VNULL) eol = end;
+    *pos = (eol < end) ? eol + 1 : end;
+
+    tok = Valist_nextToken(&p, eol, 0, &len);
+    if (tok == VNULL) return VRC_FAILURE;
+    isrec = Valist_isRecord(tok, len);
+
+    if (isrec && parse) {
+        /* Serial */
+        tok = Valist_nextToken(&p, eol, 0, &len);
+        if ((tok == VNULL) || !Valist_scanInt(tok, len, &ti))
+          return VRC_WARNING;
+        /* Atom name */
+        tok = Valist_nextToken(&p, eol, 0, &len);
+        if ((tok == VNULL) || (len >= VMAX_ARGLEN)) return VRC_WARNING;
+        memcpy(atomName, tok, (size_t)len);
+        atomName[len] = '\0';
+        /* Residue name */
+        tok = Valist_nextToken(&p, eol, 0, &len);
+        if ((tok == VNULL) || (len >= VMAX_ARGLEN)) return VRC_WARNING;
+        memcpy(resName, tok, (size_t)len);
+        resName[len] = '\0';
+        /* Residue number, possibly after or merged with a chain ID */
+        tok = Valist_nextToken(&p, eol, 0, &len);
+        if (tok == VNULL) return VRC_WARNING;
+        if (!Valist_scanInt(tok, len, &ti)) {
+            if (len == 1) {
+                tok = Valist_nextToken(&p, eol, 0, &len);
+                if ((tok == VNULL) || !Valist_scanInt(tok, len, &ti))
+                  return VRC_WARNING;
+            } else if (!Valist_scanInt(tok+1, len-1, &ti)) return VRC_WARNING;
+        }
+        /* Coordinates, allowing one junk field before x */
+        for (i=0; i<2; i++) {
+            tok = Valist_nextToken(&p, eol, 0, &len);
+            if (tok == VNULL) return VRC_WARNING;
+            if (Valist_scanReal(tok, len, &(val[0]))) break;
+        }
+        if (i == 2) return VRC_WARNING;
+        for (i=1; i<(pqr ? 5 : 3); i++) {
+            tok = Valist_nextToken(&p, eol, 0, &len);
+            if ((tok == VNULL) || !Valist_scanReal(tok, len, &(val[i])))
+              return VRC_WARNING;
+        }
+    }
+
+    /* The token reader would start a record at any keyword it meets */
+    while ((tok = Valist_nextToken(&p, eol, 0, &len))
+      != VNULL) {
+        if (Valist_isRecord(tok, len)) return VRC_WARNING;
+    }
+
+    return (isrec ? VRC_SUCCESS : VRC_FAILURE);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Valist_readRecordFile
+//
+// Purpose:  Chunked reader behind Valist_readPQRFile and Valist_readPDBFile.
+//           The mapped file is cut into chunks on line boundaries; one
+//           threaded pass counts the records in each chunk so the atom
+//           array can be allocated exactly, and a second fills each
+//           chunk's slice of it.
+//
+// Returns:  VRC_SUCCESS, VRC_FAILURE or VRC_WARNING if the file has to go
+//           through the token reader
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE Vrc_Codes Valist_readRecordFile(Valist *thee, Vparam *params,
+  const char *path, int pqr) {
+
+    const char *start[VALIST_MAXCHUNKS+1];
+    const char *p;
+    char *buf;
+    char *caller;
+    int count[VALIST_MAXCHUNKS], offset[VALIST_MAXCHUNKS];
+    int status[VALIST_MAXCHUNKS], badatom[VALIST_MAXCHUNKS];
+    int c, nchunk, natoms, redo, first;
+    size_t size;
+    Vrc_Codes rc;
+
+    caller = pqr ? "Valist_readPQR" : "Valist_readPDB";
+
+    buf = Vstring_mapFile(path, &size, 0);
+    if (buf == VNULL) return VRC_WARNING;
+
+    /* Cut the file into chunks that start on a new line */
+    nchunk = (int)(size/VALIST_CHUNKSIZE) + 1;
+    if (nchunk > VALIST_MAXCHUNKS) nchunk = VALIST_MAXCHUNKS;
+    start[0] = buf;
+    for (c=1; c<nchunk; c++) {
+        p = buf + (size*(size_t)c)/(size_t)nchunk;
+        if (p < start[c-1]) p = start[c-1];
+        while ((p > buf) && (p < buf + size) && (p[-1] != '\n')) p++;
+        start[c] = p;
+    }
+    start[nchunk] = buf + size;
+
+    /* Count the records */
+#pragma omp parallel for schedule(dynamic,1) private(p, rc) if(nchunk > 1)
+    for (c=0; c<nchunk; c++) {
+        count[c] = 0;
+        status[c] = VRC_SUCCESS;
+        p = start[c];
+        while (p < start[c+1]) {
+            rc = Valist_scanLine(&p, start[c+1], pqr, 0, VNULL, VNULL, VNULL);
+            if (rc == VRC_SUCCESS) count[c]++;
+            else if (rc == VRC_WARNING) {
+                status[c] = VRC_WARNING;
+                break;
+            }
+        }
+    }
+    natoms = 0;
+    for (c=0; c<nchunk; c++) {
+        if (status[c] != VRC_SUCCESS) {
+            Vstring_unmapFile(buf, size);
+            return VRC_WARNING;
+        }
+        offset[c] = natoms;
+        natoms += count[c];
+    }
+
+    Vnm_print(0, "%s: Counted %d atoms\n", caller, natoms);
+    fflush(stdout);
+    if (natoms == 0) {
+        Vstring_unmapFile(buf, size);
+        return Valist_getStatistics(thee);
+    }
+
+    /* Allocate exactly; the Vmem bookkeeping is not thread-safe, so every
+     * Vmem call that can run concurrently goes through apbs_vmem */
+#pragma omp critical(apbs_vmem)
+    thee->atoms = (Vatom*)Vmem_malloc(thee->vmem, natoms, sizeof(Vatom));
+    if (thee->atoms == VNULL) {
+        Vnm_print(2, "%s:  Unable to allocate space for %d (Vatom)s!\n",
+          caller, natoms);
+        Vstring_unmapFile(buf, size);
+        return VRC_FAILURE;
+    }
+    thee->number = natoms;
+
+    /* Parse the records into each chunk's slice of the array */
+#pragma omp parallel for schedule(dynamic,1) private(p, rc) if(nchunk > 1)
+    for (c=0; c<nchunk; c++) {
+        Vparam_AtomData *atomData;
+        Vatom *atom;
+        char atomName[VMAX_ARGLEN], resName[VMAX_ARGLEN];
+        double val[5];
+        int iatom;
+
+        iatom = offset[c];
+        status[c] = VRC_SUCCESS;
+        val[3] = 0.0;
+        val[4] = 0.0;
+        p = start[c];
+        while (p < start[c+1]) {
+            rc = Valist_scanLine(&p, start[c+1], pqr, 1, atomName, resName,
+              val);
+            if (rc == VRC_FAILURE) continue;
+            if (rc == VRC_WARNING) {
+                status[c] = VRC_WARNING;
+                break;
+            }
+            atom = &(thee->atoms[iatom]);
+            Vatom_setPosition(atom, val);
+            Vatom_setCharge(atom, val[3]);
+            Vatom_setRadius(atom, val[4]);
+            Vatom_setEpsilon(atom, 0.0);
+            Vatom_setAtomID(atom, iatom);
+            Vatom_setResName(atom, resName);
+            Vatom_setAtomName(atom, atomName);
+            if (params != VNULL) {
+                atomData = Vparam_getAtomData(params, resName, atomName);
+                if (atomData == VNULL) {
+                    status[c] = VRC_FAILURE;
+                    badatom[c] = iatom;
+                    break;
+                }
+                Vatom_setCharge(atom, atomData->charge);
+                Vatom_setRadius(atom, atomData->radius);
+                Vatom_setEpsilon(atom, atomData->epsilon);
+            }
+            iatom++;
+        }
+    }
+    Vstring_unmapFile(buf, size);
+
+    /* The token reader would stop at the first missing parameter, so only
+     * a chunk it has to redo before that point sends the file back to it */
+    redo = 0;
+    first = -1;
+    for (c=0; c<nchunk; c++) {
+        if (status[c] == VRC_WARNING) {
+            redo = 1;
+            break;
+        }
+        if (status[c] == VRC_FAILURE) {
+            first = c;
+            break;
+        }
+    }
+    if (redo) {
+#pragma omp critical(apbs_vmem)
+        Vmem_free(thee->vmem, thee->number, sizeof(Vatom),
+          (void **)&(thee->atoms));
+        thee->atoms = VNULL;
+        thee->number = 0;
+        return VRC_WARNING;
+    }
+    if (first >= 0) {
+        Vnm_print(2, "Valist_readPDB:  Couldn't find parameters for \
+atom = %s, residue = %s\n", thee->atoms[badatom[first]].atomName,
+          thee->atoms[badatom[first]].resName);
+        return VRC_FAILURE;
+    }
+
+    return Valist_getStatistics(thee);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Valist_scanXMLValue
+//
+// Purpose:  Parse the token following an x/y/z/charge/radius tag of an XML
+//           molecule file, with the Valist_readXML error message
+//
+// Returns:  1 on success, 0 otherwise
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Valist_scanXMLValue(const char **pos, const char *end,
+  const char *tag, int taglen, const char *name, int report, double *val) {
+
+    const char *tok;
+    int len;
+
+    tok = Valist_nextToken(pos, end, 1, &len);
+    /* Vio_scanf leaves the tag in the buffer when it runs dry */
+    if (tok == VNULL) {
+        tok = tag;
+        len = taglen;
+    }
+    if (!Valist_scanReal(tok, len, val)) {
+        if (report) {
+            Vnm_print(2, "Valist_readXML:  Unexpected token (%.*s) while \
+reading %s!\n", len, tok, name);
+        }
+        return 0;
+    }
+    return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Valist_scanXML
+//
+// Purpose:  Walk a mapped XML molecule file the way Valist_readXML walks its
+//           socket.  Without fill the atoms are only counted; with it they
+//           are stored in the (exactly sized) array.
+//
+// Returns:  VRC_SUCCESS or VRC_FAILURE
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE Vrc_Codes Valist_scanXML(Valist *thee, const char *buf,
+  size_t size, int fill, int *pnatoms) {
+
+    const char *p, *end, *tok, *first;
+    Vatom *atom;
+    int i, len, flen, natoms, isend;
+    int xset, yset, zset, chgset, radset;
+    double pos[3], charge, radius, dtmp;
+
+    p = buf;
+    end = buf + size;
+    first = VNULL;
+    flen = 0;
+    natoms = 0;
+    xset = 0;
+    yset = 0;
+    zset = 0;
+    chgset = 0;
+    radset = 0;
+    charge = 0.0;
+    radius = 0.0;
+    dtmp = 0.0;
+
+    while ((tok = Valist_nextToken(&p, end, 1, &len))
+      != VNULL) {
+
+        /* The first tag taken is the start tag - save it to detect end */
+        if (first == VNULL) {
+            first = tok;
+            flen = len;
+        }
+
+        if (Valist_isToken(tok, len, "x")) {
+            if (!Valist_scanXMLValue(&p, end, tok, len, "x", fill, &dtmp)) {
+                if (fill) return VRC_FAILURE;
+            }
+            pos[0] = dtmp;
+            xset = 1;
+        } else if (Valist_isToken(tok, len, "y")) {
+            if (!Valist_scanXMLValue(&p, end, tok, len, "y", fill, &dtmp)) {
+                if (fill) return VRC_FAILURE;
+            }
+            pos[1] = dtmp;
+            yset = 1;
+        } else if (Valist_isToken(tok, len, "z")) {
+            if (!Valist_scanXMLValue(&p, end, tok, len, "z", fill, &dtmp)) {
+                if (fill) return VRC_FAILURE;
+            }
+            pos[2] = dtmp;
+            zset = 1;
+        } else if (Valist_isToken(tok, len, "charge")) {
+            if (!Valist_scanXMLValue(&p, end, tok, len, "charge", fill,
+              &dtmp)) {
+                if (fill) return VRC_FAILURE;
+            }
+            charge = dtmp;
+            chgset = 1;
+        } else if (Valist_isToken(tok, len, "radius")) {
+            if (!Valist_scanXMLValue(&p, end, tok, len, "radius", fill,
+              &dtmp)) {
+                if (fill) return VRC_FAILURE;
+            }
+            radius = dtmp;
+            radset = 1;
+        } else if (Valist_isToken(tok, len, "/atom")) {
+            natoms++;
+            if (!fill) continue;
+            if (xset && yset && zset && chgset && radset) {
+                atom = &(thee->atoms[natoms-1]);
+                Vatom_setPosition(atom, pos);
+                Vatom_setCharge(atom, charge);
+                Vatom_setRadius(atom, radius);
+                Vatom_setAtomID(atom, natoms-1);
+                xset = 0;
+                yset = 0;
+                zset = 0;
+                chgset = 0;
+                radset = 0;
+            } else {
+                Vnm_print(2,  "Valist_readXML:  Missing field(s) in atom tag:\n");
+                if (!xset) Vnm_print(2,"\tx value not set!\n");
+                if (!yset) Vnm_print(2,"\ty value not set!\n");
+                if (!zset) Vnm_print(2,"\tz value not set!\n");
+                if (!chgset) Vnm_print(2,"\tcharge value not set!\n");
+                if (!radset) Vnm_print(2,"\tradius value not set!\n");
+                return VRC_FAILURE;
+            }
+        } else if ((len == flen + 1) && (tok[0] == '/')) {
+            isend = 1;
+            for (i=0; i<flen; i++) {
+                if (Valist_foldCase(tok[i+1]) != Valist_foldCase(first[i]))
+                  isend = 0;
+            }
+            if (isend) break;
+        }
+    }
+
+    *pnatoms = natoms;
+    return VRC_SUCCESS;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Valist_readTokenFile
+//
+// Purpose:  Open path as a Vio socket and read it with one of the token
+//           readers.  Vio sockets are only opened by one thread at a time.
+//
+// Returns:  The reader's return code, or VRC_FAILURE if the socket fails
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE Vrc_Codes Valist_readTokenFile(Valist *thee, Vparam *params,
+  const char *path, Vrc_Codes (*reader)(Valist *, Vparam *, Vio *)) {
+
+    Vio *sock = VNULL;
+    Vrc_Codes rc = VRC_FAILURE;
+
+#pragma omp critical(apbs_vmem)
+    {
+        sock = Vio_ctor("FILE", "ASC", VNULL, path, "r");
+        if (sock == VNULL) {
+            Vnm_print(2, "Problem opening virtual socket %s!\n", path);
+        } else if (Vio_accept(sock, 0) < 0) {
+            Vnm_print(2, "Problem accepting virtual socket %s!\n", path);
+            Vio_dtor(&sock);
+        } else {
+            rc = reader(thee, params, sock);
+            Vio_acceptFree(sock);
+            Vio_dtor(&sock);
+        }
+    }
+
+    return rc;
+}
+
+VPUBLIC Vrc_Codes Valist_readPQRFile(Valist *thee, Vparam *params,
+  const char *path) {
+
+    Vrc_Codes rc;
+
+    if (thee == VNULL) {
+        Vnm_print(2, "Valist_readPQRFile:  Got NULL pointer when reading PQR file!\n");
+        VASSERT(0);
+    }
+    thee->number = 0;
+
+    rc = Valist_readRecordFile(thee, params, path, 1);
+    if (rc != VRC_WARNING) return rc;
+
+    Vnm_print(0, "Valist_readPQRFile:  Using token reader for %s\n", path);
+    return Valist_readTokenFile(thee, params, path, Valist_readPQR);
+}
+
+VPUBLIC Vrc_Codes Valist_readPDBFile(Valist *thee, Vparam *params,
+  const char *path) {
+
+    Vrc_Codes rc;
+
+    if (thee == VNULL) {
+        Vnm_print(2, "Valist_readPDBFile:  Got NULL pointer when reading PDB file!\n");
+        VASSERT(0);
+    }
+    thee->number = 0;
+
+    rc = Valist_readRecordFile(thee, params, path, 0);
+    if (rc != VRC_WARNING) return rc;
+
+    Vnm_print(0, "Valist_readPDBFile:  Using token reader for %s\n", path);
+    return Valist_readTokenFile(thee, params, path, Valist_readPDB);
+}
+
+VPUBLIC Vrc_Codes Valist_readXMLFile(Valist *thee, Vparam *params,
+  const char *path) {
+
+    char *buf;
+    int natoms;
+    size_t size;
+
+    if (thee == VNULL) {
+        Vnm_print(2, "Valist_readXMLFile:  Got NULL pointer when reading XML file!\n");
+        VASSERT(0);
+    }
+    thee->number = 0;
+
+    buf = Vstring_mapFile(path, &size, 0);
+    if (buf == VNULL) {
+        Vnm_print(0, "Valist_readXMLFile:  Using token reader for %s\n", path);
+        return Valist_readTokenFile(thee, params, path, Valist_readXML);
+    }
+
+    if(params == VNULL){
+        Vnm_print(1,"\nValist_readXML: Warning Warning Warning Warning Warning\n");
+        Vnm_print(1,"Valist_readXML: The use of XML input files with parameter\n");
+        Vnm_print(1,"Valist_readXML: files is currently not supported.\n");
+        Vnm_print(1,"Valist_readXML: Warning Warning Warning Warning Warning\n\n");
+    }
+
+    /* Count the atoms, then allocate exactly and read them */
+    Valist_scanXML(thee, buf, size, 0, &natoms);
+    Vnm_print(0, "Valist_readXML: Counted %d atoms\n", natoms);
+    fflush(stdout);
+    if (natoms == 0) {
+        Vstring_unmapFile(buf, size);
+        return Valist_getStatistics(thee);
+    }
+
+#pragma omp critical(apbs_vmem)
+    thee->atoms = (Vatom*)Vmem_malloc(thee->vmem, natoms, sizeof(Vatom));
+    if (thee->atoms == VNULL) {
+        Vnm_print(2, "Valist_readXML:  unable to store atoms!\n");
+        Vstring_unmapFile(buf, size);
+        return VRC_FAILURE;
+    }
+    thee->number = natoms;
+
+    if (Valist_scanXML(thee, buf, size, 1, &natoms) != VRC_SUCCESS) {
+        Vstring_unmapFile(buf, size);
+        return VRC_FAILURE;
+    }
+    Vstring_unmapFile(buf, size);
+
+    return Valist_getStatistics(thee);
+}
+
+VPUBLIC Vrc_Codes Valist_writeBinary(Valist *thee, const char *path) {
+
+    Valist_BinHeader header;
+    char block[VALIST_BINHEADER];
+    FILE *fp;
+
+    if (thee == VNULL) {
+        Vnm_print(2, "Valist_writeBinary:  Got NULL pointer when writing binary file!\n");
+        VASSERT(0);
+    }
+
+    memset(&header, 0, sizeof(Valist_BinHeader));
+    strncpy(header.magic, VALIST_BINMAGIC, sizeof(header.magic));
+    header.version = VALIST_BINVERSION;
+    header.atomSize = (int)sizeof(Vatom);
+    header.nameOffset = (int)offsetof(Vatom, resName);
+    header.number = thee->number;
+    header.byteOrder = 1.0;
+    memcpy(header.center, thee->center, sizeof(header.center));
+    memcpy(header.mincrd, thee->mincrd, sizeof(header.mincrd));
+    memcpy(header.maxcrd, thee->maxcrd, sizeof(header.maxcrd));
+    header.maxrad = thee->maxrad;
+    header.charge = thee->charge;
+    memset(block, 0, VALIST_BINHEADER);
+    memcpy(block, &header, sizeof(Valist_BinHeader));
+
+    fp = fopen(path, "wb");
+    if (fp == VNULL) {
+        Vnm_print(2, "Valist_writeBinary:  Unable to open %s!\n", path);
+        return VRC_FAILURE;
+    }
+    if ((fwrite(block, 1, VALIST_BINHEADER, fp) != VALIST_BINHEADER) ||
+      ((thee->number > 0) && (fwrite(thee->atoms, sizeof(Vatom),
+      (size_t)(thee->number), fp) != (size_t)(thee->number)))) {
+        Vnm_print(2, "Valist_writeBinary:  Error writing %s!\n", path);
+        fclose(fp);
+        return VRC_FAILURE;
+    }
+    if (fclose(fp) != 0) {
+        Vnm_print(2, "Valist_writeBinary:  Error writing %s!\n", path);
+        return VRC_FAILURE;
+    }
+
+    return VRC_SUCCESS;
+}
+
+VPUBLIC Vrc_Codes Valist_readBinary(Valist *thee, const char *path) {
+
+    Valist_BinHeader header;
+    char *buf;
+    size_t size;
+
+    if (thee == VNULL) {
+        Vnm_print(2, "Valist_readBinary:  Got NULL pointer when reading binary file!\n");
+        VASSERT(0);
+    }
+    thee->number = 0;
+
+    buf = Vstring_mapFile(path, &size, 1);
+    if (buf == VNULL) {
+        Vnm_print(2, "Valist_readBinary:  Unable to read %s!\n", path);
+        return VRC_FAILURE;
+    }
+
+    /* Check the header against this build's Vatom layout */
+    if (size < VALIST_BINHEADER) {
+        Vnm_print(2, "Valist_readBinary:  %s is too short!\n", path);
+        Vstring_unmapFile(buf, size);
+        return VRC_FAILURE;
+    }
+    memcpy(&header, buf, sizeof(Valist_BinHeader));
+    if ((strncmp(header.magic, VALIST_BINMAGIC, sizeof(header.magic)) != 0) ||
+      (header.version != VALIST_BINVERSION)) {
+        Vnm_print(2, "Valist_readBinary:  %s is not a version %d binary \
+molecule file!\n", path, VALIST_BINVERSION);
+        Vstring_unmapFile(buf, size);
+        return VRC_FAILURE;
+    }
+    if ((header.byteOrder != 1.0) ||
+      (header.atomSize != (int)sizeof(Vatom)) ||
+      (header.nameOffset != (int)offsetof(Vatom, resName))) {
+        Vnm_print(2, "Valist_readBinary:  %s was written by a build with a \
+different atom layout or byte order; regenerate it!\n", path);
+        Vstring_unmapFile(buf, size);
+        return VRC_FAILURE;
+    }
+    if ((header.number < 0) || ((size - VALIST_BINHEADER)/sizeof(Vatom) <
+      (size_t)(header.number))) {
+        Vnm_print(2, "Valist_readBinary:  %s is truncated!\n", path);
+        Vstring_unmapFile(buf, size);
+        return VRC_FAILURE;
+    }
+
+    thee->mapbase = buf;
+    thee->mapsize = size;
+    thee->atoms = (Vatom*)(buf + VALIST_BINHEADER);
+    thee->number = header.number;
+    memcpy(thee->center, header.center, sizeof(thee->center));
+    memcpy(thee->mincrd, header.mincrd, sizeof(thee->mincrd));
+    memcpy(thee->maxcrd, header.maxcrd, sizeof(thee->maxcrd));
+    thee->maxrad = header.maxrad;
+    thee->charge = header.charge;
+
+    Vnm_print(0, "Valist_readBinary: Mapped %d atoms\n", thee->number);
+
+    if (thee->number == 0) return VRC_FAILURE;
+    return VRC_SUCCESS;
+}
+
 /* Load up Valist with various statistics */
 VPUBLIC Vrc_Codes Valist_getStatistics(Valist *thee) {
 
@@ -918,3 +1800,10 @@ VPUBLIC Vrc_Codes Valist_getStatistics(Valist *thee) {
 
     return VRC_SUCCESS;
 }
+
+VPUBLIC void Valist_touch(Valist *thee) {
+
+    VASSERT(thee != VNULL);
+    thee->generation = Valist_nextGeneration();
+
+}
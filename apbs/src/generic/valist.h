@@ -70,6 +70,27 @@
 #include "generic/vatom.h"
 #include "generic/vparam.h"
 
+/** @brief Target size (bytes) of the chunks a molecule file is parsed in
+ *  @ingroup Valist */
+#define VALIST_CHUNKSIZE (1<<20)
+
+/** @brief Maximum number of chunks a molecule file is parsed in
+ *  @ingroup Valist */
+#define VALIST_MAXCHUNKS 256
+
+/** @brief Magic string at the start of a binary molecule file
+ *  @ingroup Valist */
+#define VALIST_BINMAGIC "APBSMOL"
+
+/** @brief Version of the binary molecule file layout
+ *  @ingroup Valist */
+#define VALIST_BINVERSION 1
+
+/** @brief Size (bytes) of the binary molecule file header; the Vatom
+ *         records start at this offset
+ *  @ingroup Valist */
+#define VALIST_BINHEADER 256
+
 /**
  *  @ingroup Valist
  *  @author  Nathan Baker
@@ -85,6 +106,12 @@ struct sValist {
   double charge;      /**< Net charge */
   Vatom *atoms;       /**< Atom list */
   Vmem *vmem;         /**< Memory management object */
+  void *mapbase;      /**< Binary molecule file mapping that atoms points
+                       * into, or VNULL if atoms was allocated */
+  size_t mapsize;     /**< Size of mapbase in bytes */
+  int generation;     /**< Renewed by Valist_touch whenever the atoms
+                       * change in place; unique among all the atom lists
+                       * of the process, so it also tells lists apart */
 
 };
 
@@ -94,6 +121,36 @@ struct sValist {
  */
 typedef struct sValist Valist;
 
+/**
+ *  @ingroup Valist
+ *  @brief   Header of a binary molecule file, padded to ::VALIST_BINHEADER
+ *           bytes.  The header is followed by number Vatom records exactly
+ *           as they are laid out in memory, so the file is only valid for
+ *           builds with the same Vatom layout and byte order.
+ */
+struct sValist_BinHeader {
+
+  char magic[8];      /**< ::VALIST_BINMAGIC */
+  int version;        /**< ::VALIST_BINVERSION */
+  int atomSize;       /**< sizeof(Vatom) of the writer */
+  int nameOffset;     /**< Offset of Vatom::resName in the writer */
+  int number;         /**< Number of atoms */
+  double byteOrder;   /**< 1.0 in the writer's byte order */
+  double center[3];   /**< Valist::center */
+  double mincrd[3];   /**< Valist::mincrd */
+  double maxcrd[3];   /**< Valist::maxcrd */
+  double maxrad;      /**< Valist::maxrad */
+  double charge;      /**< Valist::charge */
+
+};
+
+/**
+ *  @ingroup Valist
+ *  @brief Declaration of the Valist_BinHeader class as the
+ *         sValist_BinHeader structure
+ */
+typedef struct sValist_BinHeader Valist_BinHeader;
+
 #if !defined(VINLINE_VATOM)
 
 /**
@@ -203,6 +260,18 @@ VEXTERNC void Valist_dtor2(
         Valist *thee /**< Pointer to atom list object */
         );
 
+/** @brief   Construct a private copy of an atom list
+ *  @ingroup Valist
+ *  @note    The copy owns its atom array, so calculations that set
+ *           per-atom flags (such as Vatom::partID) on it leave the
+ *           original alone.
+ *  @returns Newly allocated copy, or VNULL if the atoms could not be
+ *           allocated
+ */
+VEXTERNC Valist* Valist_clone(
+        Valist *thee /**< Atom list to copy */
+        );
+
 /**
  * @brief  Fill atom list with information from a PQR file
  * @ingroup Valist
@@ -250,6 +319,77 @@ VEXTERNC Vrc_Codes Valist_readXML(
         Vio *sock /**< Socket reading for reading PQR file */
         );
 
+/**
+ * @brief  Fill atom list from a PQR file read through a memory map
+ * @ingroup Valist
+ * @returns	Success enumeration
+ * @note  \li The file is split into chunks of about ::VALIST_CHUNKSIZE bytes
+ *            on line boundaries.  One threaded pass counts the ATOM/HETATM
+ *            records so the atom array is allocated exactly; a second
+ *            parses each chunk into its slice of the array.
+ *        \li Fields are parsed in place with the same rules as
+ *            Valist_readPQR, which is used instead when a record does not
+ *            start its line, runs onto the next line or cannot be parsed,
+ *            and when the file cannot be mapped.
+ *        \li Safe to call for different atom lists from several threads.
+ */
+VEXTERNC Vrc_Codes Valist_readPQRFile(
+        Valist *thee, /**< Atom list object */
+        Vparam *param, /**< A pre-initialized parameter object or VNULL */
+        const char *path /**< Path of the PQR file */
+        );
+
+/**
+ * @brief  Fill atom list from a PDB file read through a memory map
+ * @ingroup Valist
+ * @returns	Success enumeration
+ * @note  Same scheme as Valist_readPQRFile, falling back to Valist_readPDB.
+ */
+VEXTERNC Vrc_Codes Valist_readPDBFile(
+        Valist *thee, /**< Atom list object */
+        Vparam *param, /**< A pre-initialized parameter object */
+        const char *path /**< Path of the PDB file */
+        );
+
+/**
+ * @brief  Fill atom list from an XML file read through a memory map
+ * @ingroup Valist
+ * @returns	Success enumeration
+ * @note  The mapped file is scanned twice with the Valist_readXML rules,
+ *        once to count the atoms and once to store them, on one thread.
+ */
+VEXTERNC Vrc_Codes Valist_readXMLFile(
+        Valist *thee, /**< Atom list object */
+        Vparam *param, /**< A pre-initialized parameter object */
+        const char *path /**< Path of the XML file */
+        );
+
+/**
+ * @brief  Write the atom list and its statistics as a binary molecule file
+ * @ingroup Valist
+ * @returns	Success enumeration
+ * @note  See Valist_BinHeader for the layout.  Charges, radii and epsilons
+ *        are written as assigned, including any parameter file values.
+ */
+VEXTERNC Vrc_Codes Valist_writeBinary(
+        Valist *thee, /**< Atom list object */
+        const char *path /**< Path of the binary molecule file */
+        );
+
+/**
+ * @brief  Fill atom list from a binary molecule file
+ * @ingroup Valist
+ * @returns	Success enumeration
+ * @note  The file is mapped private copy-on-write and the atom array points
+ *        straight into the mapping; the statistics are taken from the
+ *        header rather than recomputed.  Files written by a build with a
+ *        different Vatom layout or byte order are rejected.
+ */
+VEXTERNC Vrc_Codes Valist_readBinary(
+        Valist *thee, /**< Atom list object */
+        const char *path /**< Path of the binary molecule file */
+        );
+
 /**
  * @brief   Load up Valist with various statistics
  * @ingroup Valist
@@ -258,5 +398,16 @@ VEXTERNC Vrc_Codes Valist_readXML(
  */
 VEXTERNC Vrc_Codes Valist_getStatistics(Valist *thee);
 
+/**
+ * @brief   Note that atoms were moved, recharged or resized in place
+ * @ingroup Valist
+ * @note    Objects that cache results computed from the atoms (such as the
+ *          WCA terms in Vacc) compare Valist::generation against the value
+ *          they were computed for.  Generations are never reused, so a
+ *          list freed and allocated again at the same address does not
+ *          match the old value.
+ */
+VEXTERNC void Valist_touch(Valist *thee);
+
 
 #endif /* ifndef _VALIST_H_ */
@@ -227,21 +227,19 @@ VPRIVATE Vrc_Codes Vclist_storeParms(Vclist *thee, Valist *alist,
     return VRC_SUCCESS;
 }
 
-/* Calculate the gridpoints an atom spans */
+/* Calculate the gridpoints an atom at the given position spans */
 VPRIVATE void Vclist_gridSpan(Vclist *thee,
-        Vatom *atom, /* Atom */
+        double coord[VAPBS_DIM], /* Atom position */
+        double radius, /* Atom radius */
         int imin[VAPBS_DIM], /* Set to min grid indices */
         int imax[VAPBS_DIM]  /* Set to max grid indices */
         ) {
 
     int i;
-    double *coord, dc, idc, rtot;
-
-    /* Get the position in the grid's frame of reference */
-    coord = Vatom_getPosition(atom);
+    double dc, idc, rtot;
 
     /* Get the range the atom radius + probe radius spans */
-    rtot = Vatom_getRadius(atom) + thee->max_radius;
+    rtot = radius + thee->max_radius;
 
     /* Calculate the range of grid points the inflated atom spans in the x
      * direction. */
@@ -282,7 +280,8 @@ VPRIVATE Vrc_Codes Vclist_assignAtoms(Vclist *thee) {
 
         /* Get grid span for atom */
         atom = Valist_getAtom(thee->alist, iatom);
-        Vclist_gridSpan(thee, atom, imin, imax);
+        Vclist_gridSpan(thee, Vatom_getPosition(atom), Vatom_getRadius(atom),
+                imin, imax);
 
         /* Now find and assign the grid points */
         VASSERT(VAPBS_DIM == 3);
@@ -317,7 +316,8 @@ VPRIVATE Vrc_Codes Vclist_assignAtoms(Vclist *thee) {
 
         /* Get grid span for atom */
         atom = Valist_getAtom(thee->alist, iatom);
-        Vclist_gridSpan(thee, atom, imin, imax);
+        Vclist_gridSpan(thee, Vatom_getPosition(atom), Vatom_getRadius(atom),
+                imin, imax);
 
         /* Now find and assign the grid points */
         for (i = imin[0]; i <= imax[0]; i++) {
@@ -449,6 +449,113 @@ VPUBLIC VclistCell* Vclist_getCell(Vclist *thee,
 
 }
 
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  VclistCell_addAtom
+//
+// Purpose:  Append an atom to a cell, growing its array by one
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE Vrc_Codes VclistCell_addAtom(VclistCell *thee, Vatom *atom) {
+
+    Vatom **atoms;
+    int i;
+
+    atoms = (Vatom**)Vmem_malloc(VNULL, thee->natoms+1, sizeof(Vatom *));
+    if (atoms == VNULL) return VRC_FAILURE;
+    for (i=0; i<thee->natoms; i++) atoms[i] = thee->atoms[i];
+    atoms[thee->natoms] = atom;
+    VclistCell_dtor2(thee);
+    thee->atoms = atoms;
+    (thee->natoms)++;
+
+    return VRC_SUCCESS;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  VclistCell_removeAtom
+//
+// Purpose:  Drop an atom from a cell, shrinking its array by one
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE Vrc_Codes VclistCell_removeAtom(VclistCell *thee, Vatom *atom) {
+
+    Vatom **atoms = VNULL;
+    int i, j;
+
+    for (i=0; i<thee->natoms; i++) {
+        if (thee->atoms[i] == atom) break;
+    }
+    if (i == thee->natoms) return VRC_FAILURE;
+
+    if (thee->natoms > 1) {
+        atoms = (Vatom**)Vmem_malloc(VNULL, thee->natoms-1, sizeof(Vatom *));
+        if (atoms == VNULL) return VRC_FAILURE;
+        for (i=0, j=0; i<thee->natoms; i++) {
+            if (thee->atoms[i] != atom) atoms[j++] = thee->atoms[i];
+        }
+    }
+    VclistCell_dtor2(thee);
+    thee->atoms = atoms;
+    (thee->natoms)--;
+
+    return VRC_SUCCESS;
+}
+
+VPUBLIC Vrc_Codes Vclist_moveAtom(Vclist *thee, Vatom *atom,
+        double oldpos[VAPBS_DIM]) {
+
+    int i, j, k, d, ui, inOld, inNew;
+    int omin[VAPBS_DIM], omax[VAPBS_DIM], nmin[VAPBS_DIM], nmax[VAPBS_DIM];
+    double *pos, rtot;
+
+    pos = Vatom_getPosition(atom);
+    rtot = Vatom_getRadius(atom) + thee->max_radius;
+
+    /* The clamped span is only complete while the inflated atom stays inside
+     * the table */
+    for (d=0; d<VAPBS_DIM; d++) {
+        if (((pos[d] - rtot) < thee->lower_corner[d]) ||
+            ((pos[d] + rtot) > thee->upper_corner[d])) return VRC_FAILURE;
+    }
+
+    Vclist_gridSpan(thee, oldpos, Vatom_getRadius(atom), omin, omax);
+    Vclist_gridSpan(thee, pos, Vatom_getRadius(atom), nmin, nmax);
+    for (d=0; d<VAPBS_DIM; d++) {
+        if ((omin[d] != nmin[d]) || (omax[d] != nmax[d])) break;
+    }
+    if (d == VAPBS_DIM) return VRC_SUCCESS;
+
+    /* Only the cells in one span but not the other change */
+    for (i=VMIN2(omin[0], nmin[0]); i<=VMAX2(omax[0], nmax[0]); i++) {
+        for (j=VMIN2(omin[1], nmin[1]); j<=VMAX2(omax[1], nmax[1]); j++) {
+            for (k=VMIN2(omin[2], nmin[2]); k<=VMAX2(omax[2], nmax[2]); k++) {
+                inOld = (i >= omin[0]) && (i <= omax[0]) &&
+                        (j >= omin[1]) && (j <= omax[1]) &&
+                        (k >= omin[2]) && (k <= omax[2]);
+                inNew = (i >= nmin[0]) && (i <= nmax[0]) &&
+                        (j >= nmin[1]) && (j <= nmax[1]) &&
+                        (k >= nmin[2]) && (k <= nmax[2]);
+                if (inOld == inNew) continue;
+                ui = Vclist_arrayIndex(thee, i, j, k);
+                if (inOld) {
+                    if (VclistCell_removeAtom(&(thee->cells[ui]), atom)
+                            == VRC_FAILURE) {
+                        Vnm_print(2, "Vclist_moveAtom:  atom not in cell %d!\n",
+                                ui);
+                        return VRC_FAILURE;
+                    }
+                } else {
+                    if (VclistCell_addAtom(&(thee->cells[ui]), atom)
+                            == VRC_FAILURE) {
+                        Vnm_print(2, "Vclist_moveAtom:  cell error!\n");
+                        return VRC_FAILURE;
+                    }
+                }
+            }
+        }
+    }
+
+    return VRC_SUCCESS;
+}
+
 VPUBLIC VclistCell* VclistCell_ctor(int natoms) {
 
     VclistCell *thee = VNULL;
@@ -233,6 +233,21 @@ VEXTERNC VclistCell* Vclist_getCell(
         double position[VAPBS_DIM] /**< Position to evaluate */
         );
 
+/**
+ * @brief  Move an atom to the cells its current position spans
+ * @ingroup Vclist
+ * @note  Only the cells the atom enters or leaves are touched, so this is
+ *        cheap for the small moves of a dynamics step.  The table itself is
+ *        not resized: nothing is changed and VRC_FAILURE is returned if
+ *        the inflated atom no longer fits inside it.
+ * @returns Success enumeration
+ */
+VEXTERNC Vrc_Codes Vclist_moveAtom(
+        Vclist *thee, /**< Pointer to Vclist cell list */
+        Vatom *atom, /**< Atom of the list, already at its new position */
+        double oldpos[VAPBS_DIM] /**< Position the atom was binned at */
+        );
+
 /**
  * @brief  Allocate and construct a cell list cell object
  * @ingroup Vclist
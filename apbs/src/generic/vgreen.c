@@ -56,56 +56,35 @@
 
 #include "vgreen.h"
 
-/* Define wrappers for F77 treecode routines */
-#ifdef HAVE_TREE
-#  define F77TREEPEFORCE VF77_MANGLE(treepeforce, TREEPEFORCE)
-#  define F77DIRECT_ENG_FORCE VF77_MANGLE(direct_eng_force, DIRECT_ENG_FORCE)
-#  define F77CLEANUP VF77_MANGLE(mycleanup, MYCLEANUP)
-#  define F77TREE_COMPP VF77_MANGLE(mytree_compp, MYTREE_COMP)
-#  define F77TREE_COMPFP VF77_MANGLE(mytree_compfp, MYTREE_COMPFP)
-#  define F77CREATE_TREE VF77_MANGLE(mycreate_tree, MYCREATE_TREE)
-#  define F77INITLEVELS VF77_MANGLE(myinitlevels, MYINITLEVELS)
-#  define F77SETUP VF77_MANGLE(mysetup, MYSETUP)
-#endif  /* ifdef HAVE_TREE */
-
 /* Some constants associated with the tree code */
-#ifdef HAVE_TREE
-    /**
-     * @brief  Lower distance cutoff for electrostatic interactions
-     * @ingroup  Vgreen */
-#   define FMM_DIST_TOL VSMALL
-    /**
-     * @brief  Flag for energy and force evaluation:
-     *         \li 1 =>  evaluate energy only
-     *         \li 2 =>  evaluate energy and force
-     * @ingroup  Vgreen */
-#   define FMM_IFLAG 2
-    /**
-     * @brief  Order of multipole expansion
-     * @ingroup  Vgreen */
-#   define FMM_ORDER 4
-    /**
-     * @brief  Multipole acceptance criterion
-     * @ingroup  Vgreen */
-#   define FMM_THETA 0.5
-    /**
-     * @brief  Maximum number of particles per node
-     * @ingroup  Vgreen */
-#   define FMM_MAXPARNODE 150
-    /**
-     * @brief  Switch for oct-tree construction
-     * @ingroup  Vgreen */
-#   define FMM_SHRINK 1
-    /**
-     * @brief  Minimum treecode level
-     * @ingroup  Vgreen */
-#   define FMM_MINLEVEL 50000
-    /**
-     * @brief  Maximum treecode level
-     * @ingroup  Vgreen */
-#   define FMM_MAXLEVEL 0
-#endif  /* ifdef HAVE_TREE */
-
+/**
+ * @brief  Default order of multipole expansion
+ * @ingroup  Vgreen */
+#define FMM_ORDER 6
+/**
+ * @brief  Maximum supported order of multipole expansion
+ * @ingroup  Vgreen */
+#define FMM_MAXORDER 10
+/**
+ * @brief  Default multipole acceptance criterion
+ * @ingroup  Vgreen */
+#define FMM_THETA 0.5
+/**
+ * @brief  Default maximum number of particles per leaf
+ * @ingroup  Vgreen */
+#define FMM_MAXPARNODE 64
+/**
+ * @brief  Maximum depth of the octree (deeper cells become leaves)
+ * @ingroup  Vgreen */
+#define FMM_MAXDEPTH 48
+/**
+ * @brief  Leading dimension of the kernel coefficient arrays
+ * @ingroup  Vgreen */
+#define FMM_DIM (FMM_MAXORDER+2)
+/**
+ * @brief  Index into the kernel coefficient arrays
+ * @ingroup  Vgreen */
+#define FMM_IDX(i,j,k) (((i)*FMM_DIM + (j))*FMM_DIM + (k))
 
 /*
  * @brief  Setup treecode internal structures
@@ -126,16 +105,31 @@ VPRIVATE int treesetup(Vgreen *thee);
 VPRIVATE int treecleanup(Vgreen *thee);
 
 /*
- * @brief  Calculate forces or potential
+ * @brief  Build the octree cells and their multipole moments from the
+ *         particle arrays
+ * @ingroup  Vgreen
+ * @param  thee  Vgreen object
+ * @return  1 if successful, 0 otherwise
+ */
+VPRIVATE int treebuild(Vgreen *thee);
+
+/*
+ * @brief  Calculate potential (and optionally the field) at a set of points
  * @ingroup  Vgreen
  * @author  Nathan Baker
  * @param  thee  Vgreen object
+ * @param  npos  Number of points
+ * @param  x, y, z  Point coordinates
+ * @param  pot  Potential at each point (unscaled); may be VNULL
+ * @param  gradx, grady, gradz  Field at each point (unscaled); VNULL to skip
+ * @param  bound  Far-field error bound at each point (unscaled); VNULL to
+ *         skip
+ * @param  kappa  Inverse screening length (0 for Coulomb)
  * @return  1 if successful, 0 otherwise
  */
-VPRIVATE int treecalc(Vgreen *thee, double *xtar, double *ytar, double *ztar,
-        double *qtar, int numtars, double *tpengtar, double *x, double *y,
-        double *z, double *q, int numpars, double *fx, double *fy, double *fz,
-        int iflag, int farrdim, int arrdim);
+VPRIVATE int treecalc(Vgreen *thee, int npos, double *x, double *y,
+        double *z, double *pot, double *gradx, double *grady, double *gradz,
+        double *bound, double kappa);
 
 #if !defined(VINLINE_VGREEN)
 
@@ -178,13 +172,14 @@ VPUBLIC int Vgreen_ctor2(Vgreen *thee, Valist *alist) {
 
     thee->alist = alist;
 
-    /* Setup FMM tree (if applicable) */
-#ifdef HAVE_TREE
+    /* Setup FMM tree */
+    thee->order = FMM_ORDER;
+    thee->theta = FMM_THETA;
+    thee->maxparnode = FMM_MAXPARNODE;
     if (!treesetup(thee)) {
         Vnm_print(2, "Vgreen_ctor2:  Error setting up FMM tree!\n");
         return 0;
     }
-#endif /* ifdef HAVE_TREE */
 
     return 1;
 }
@@ -199,26 +194,169 @@ VPUBLIC void Vgreen_dtor(Vgreen **thee) {
 
 VPUBLIC void Vgreen_dtor2(Vgreen *thee) {
 
-#ifdef HAVE_TREE
     treecleanup(thee);
-#endif
     Vmem_dtor(&(thee->vmem));
 
 }
 
+VPUBLIC int Vgreen_setTreeParams(Vgreen *thee, int order, double theta,
+  int maxparnode) {
+
+    if (thee == VNULL) {
+        Vnm_print(2, "Vgreen_setTreeParams:  Got NULL thee!\n");
+        return 0;
+    }
+    if ((order < 0) || (order > FMM_MAXORDER)) {
+        Vnm_print(2, "Vgreen_setTreeParams:  Order %d outside [0, %d]!\n",
+          order, FMM_MAXORDER);
+        return 0;
+    }
+    if ((theta <= 0.0) || (theta >= 1.0)) {
+        Vnm_print(2, "Vgreen_setTreeParams:  Theta %g outside (0, 1)!\n",
+          theta);
+        return 0;
+    }
+    if (maxparnode < 1) {
+        Vnm_print(2, "Vgreen_setTreeParams:  Invalid leaf size %d!\n",
+          maxparnode);
+        return 0;
+    }
+
+    treecleanup(thee);
+    thee->order = order;
+    thee->theta = theta;
+    thee->maxparnode = maxparnode;
+
+    return treesetup(thee);
+}
+
+VPUBLIC int Vgreen_helmholtz_direct(Vgreen *thee, int npos, double *x,
+  double *y, double *z, double *val, double kappa) {
+
+    Vatom *atom;
+    double *apos, charge, dist, dx, dy, dz, scale;
+    int iatom, ipos;
+
+    if (thee == VNULL) {
+        Vnm_print(2, "Vgreen_helmholtz:  Got NULL thee!\n");
+        return 0;
+    }
+
+    for (ipos=0; ipos<npos; ipos++) val[ipos] = 0.0;
+
+    for (iatom=0; iatom<Valist_getNumberAtoms(thee->alist); iatom++) {
+        atom = Valist_getAtom(thee->alist, iatom);
+        apos = Vatom_getPosition(atom);
+        charge = Vatom_getCharge(atom);
+        for (ipos=0; ipos<npos; ipos++) {
+            dx = apos[0] - x[ipos];
+            dy = apos[1] - y[ipos];
+            dz = apos[2] - z[ipos];
+            dist = VSQRT(VSQR(dx) + VSQR(dy) + VSQR(dz));
+            if (dist > VSMALL) val[ipos] += (charge*exp(-kappa*dist)/dist);
+        }
+    }
+
+    scale = Vunit_ec/(4*Vunit_pi*Vunit_eps0*1.0e-10);
+    for (ipos=0; ipos<npos; ipos++) val[ipos] = val[ipos]*scale;
+
+    return 1;
+}
+
 VPUBLIC int Vgreen_helmholtz(Vgreen *thee, int npos, double *x, double *y,
   double *z, double *val, double kappa) {
 
-    Vnm_print(2, "Error -- Vgreen_helmholtz not implemented yet!\n");
-    return 0;
+    double scale;
+    int ipos;
+
+    if (thee == VNULL) {
+        Vnm_print(2, "Vgreen_helmholtz:  Got NULL thee!\n");
+        return 0;
+    }
+
+    if (!treecalc(thee, npos, x, y, z, val, VNULL, VNULL, VNULL, VNULL,
+      kappa)) {
+        return 0;
+    }
+
+    scale = Vunit_ec/(4*Vunit_pi*Vunit_eps0*1.0e-10);
+    for (ipos=0; ipos<npos; ipos++) val[ipos] = val[ipos]*scale;
+
+    return 1;
+}
+
+VPUBLIC int Vgreen_helmholtzD_direct(Vgreen *thee, int npos, double *x,
+  double *y, double *z, double *gradx, double *grady, double *gradz,
+  double kappa) {
+
+    Vatom *atom;
+    double *apos, charge, dist, dist2, dx, dy, dz, scale, fac;
+    int iatom, ipos;
+
+    if (thee == VNULL) {
+        Vnm_print(2, "Vgreen_helmholtzD:  Got VNULL thee!\n");
+        return 0;
+    }
+
+    for (ipos=0; ipos<npos; ipos++) {
+        gradx[ipos] = 0.0;
+        grady[ipos] = 0.0;
+        gradz[ipos] = 0.0;
+    }
+
+    for (iatom=0; iatom<Valist_getNumberAtoms(thee->alist); iatom++) {
+        atom = Valist_getAtom(thee->alist, iatom);
+        apos = Vatom_getPosition(atom);
+        charge = Vatom_getCharge(atom);
+        for (ipos=0; ipos<npos; ipos++) {
+            dx = apos[0] - x[ipos];
+            dy = apos[1] - y[ipos];
+            dz = apos[2] - z[ipos];
+            dist2 = VSQR(dx) + VSQR(dy) + VSQR(dz);
+            dist = VSQRT(dist2);
+            if (dist > VSMALL) {
+                fac = charge*exp(-kappa*dist)*(1.0 + kappa*dist)/(dist*dist2);
+                gradx[ipos] -= (fac*dx);
+                grady[ipos] -= (fac*dy);
+                gradz[ipos] -= (fac*dz);
+            }
+        }
+    }
+
+    scale = Vunit_ec/(4*VPI*Vunit_eps0*(1.0e-10));
+    for (ipos=0; ipos<npos; ipos++) {
+        gradx[ipos] = gradx[ipos]*scale;
+        grady[ipos] = grady[ipos]*scale;
+        gradz[ipos] = gradz[ipos]*scale;
+    }
+
+    return 1;
 }
 
 VPUBLIC int Vgreen_helmholtzD(Vgreen *thee, int npos, double *x, double *y,
   double *z, double *gradx, double *grady, double *gradz, double kappa) {
 
-    Vnm_print(2, "Error -- Vgreen_helmholtzD not implemented yet!\n");
-    return 0;
+    double scale;
+    int ipos;
 
+    if (thee == VNULL) {
+        Vnm_print(2, "Vgreen_helmholtzD:  Got VNULL thee!\n");
+        return 0;
+    }
+
+    if (!treecalc(thee, npos, x, y, z, VNULL, gradx, grady, gradz, VNULL,
+      kappa)) {
+        return 0;
+    }
+
+    scale = Vunit_ec/(4*VPI*Vunit_eps0*(1.0e-10));
+    for (ipos=0; ipos<npos; ipos++) {
+        gradx[ipos] = gradx[ipos]*scale;
+        grady[ipos] = grady[ipos]*scale;
+        gradz[ipos] = gradz[ipos]*scale;
+    }
+
+    return 1;
 }
 
 VPUBLIC int Vgreen_coulomb_direct(Vgreen *thee, int npos, double *x,
@@ -226,7 +364,6 @@ VPUBLIC int Vgreen_coulomb_direct(Vgreen *thee, int npos, double *x,
 
     Vatom *atom;
     double *apos, charge, dist, dx, dy, dz, scale;
-    double *q, qtemp, fx, fy, fz;
     int iatom, ipos;
 
     if (thee == VNULL) {
@@ -258,53 +395,51 @@ VPUBLIC int Vgreen_coulomb_direct(Vgreen *thee, int npos, double *x,
 VPUBLIC int Vgreen_coulomb(Vgreen *thee, int npos, double *x, double *y,
   double *z, double *val) {
 
-    Vatom *atom;
-    double *apos, charge, dist, dx, dy, dz, scale;
-    double *q, qtemp, fx, fy, fz;
-    int iatom, ipos;
+    double scale;
+    int ipos;
 
     if (thee == VNULL) {
         Vnm_print(2, "Vgreen_coulomb:  Got NULL thee!\n");
         return 0;
     }
 
-    for (ipos=0; ipos<npos; ipos++) val[ipos] = 0.0;
-
-#ifdef HAVE_TREE
-
-    /* Allocate charge array (if necessary) */
-    if (Valist_getNumberAtoms(thee->alist) > 1) {
-        if (npos > 1) {
-            q = VNULL;
-            q = Vmem_malloc(thee->vmem, npos, sizeof(double));
-            if (q == VNULL) {
-                Vnm_print(2, "Vgreen_coulomb:  Error allocating charge array!\n");
-                return 0;
-            }
-        } else {
-            q = &(qtemp);
-        }
-        for (ipos=0; ipos<npos; ipos++) q[ipos] = 1.0;
-
-        /* Calculate */
-        treecalc(thee, x, y, z, q, npos, val, thee->xp, thee->yp, thee->zp,
-          thee->qp, thee->np, &fx, &fy, &fz, 1, 1, thee->np);
-    } else return Vgreen_coulomb_direct(thee, npos, x, y, z, val);
+    /* A single cell has no far field; the direct sum is cheaper */
+    if (thee->nnode < 2) return Vgreen_coulomb_direct(thee, npos, x, y, z, val);
 
-    /* De-allocate charge array (if necessary) */
-    if (npos > 1) Vmem_free(thee->vmem, npos, sizeof(double), (void **)&q);
+    if (!treecalc(thee, npos, x, y, z, val, VNULL, VNULL, VNULL, VNULL,
+      0.0)) {
+        return 0;
+    }
 
     scale = Vunit_ec/(4*Vunit_pi*Vunit_eps0*1.0e-10);
     for (ipos=0; ipos<npos; ipos++) val[ipos] = val[ipos]*scale;
 
     return 1;
+}
 
-#else /* ifdef HAVE_TREE */
+VPUBLIC int Vgreen_coulombBound(Vgreen *thee, int npos, double *x,
+        double *y, double *z, double *val, double *bound) {
 
-    return Vgreen_coulomb_direct(thee, npos, x, y, z, val);
+    double scale;
+    int ipos;
 
-#endif
+    if (thee == VNULL) {
+        Vnm_print(2, "Vgreen_coulombBound:  Got NULL thee!\n");
+        return 0;
+    }
 
+    if (!treecalc(thee, npos, x, y, z, val, VNULL, VNULL, VNULL, bound,
+      0.0)) {
+        return 0;
+    }
+
+    scale = Vunit_ec/(4*Vunit_pi*Vunit_eps0*1.0e-10);
+    for (ipos=0; ipos<npos; ipos++) {
+        val[ipos] = val[ipos]*scale;
+        bound[ipos] = bound[ipos]*scale;
+    }
+
+    return 1;
 }
 
 VPUBLIC int Vgreen_coulombD_direct(Vgreen *thee, int npos,
@@ -313,7 +448,6 @@ VPUBLIC int Vgreen_coulombD_direct(Vgreen *thee, int npos,
 
     Vatom *atom;
     double *apos, charge, dist, dist2, idist3, dy, dz, dx, scale;
-    double *q, qtemp;
     int iatom, ipos;
 
     if (thee == VNULL) {
@@ -362,46 +496,22 @@ VPUBLIC int Vgreen_coulombD_direct(Vgreen *thee, int npos,
 VPUBLIC int Vgreen_coulombD(Vgreen *thee, int npos, double *x, double *y,
         double *z, double *pot, double *gradx, double *grady, double *gradz) {
 
-    Vatom *atom;
-    double *apos, charge, dist, dist2, idist3, dy, dz, dx, scale;
-    double *q, qtemp;
-    int iatom, ipos;
+    double scale;
+    int ipos;
 
     if (thee == VNULL) {
         Vnm_print(2, "Vgreen_coulombD:  Got VNULL thee!\n");
         return 0;
     }
 
-    for (ipos=0; ipos<npos; ipos++) {
-        pot[ipos] = 0.0;
-        gradx[ipos] = 0.0;
-        grady[ipos] = 0.0;
-        gradz[ipos] = 0.0;
-    }
-
-#ifdef HAVE_TREE
-
-    if (Valist_getNumberAtoms(thee->alist) > 1) {
-        if (npos > 1) {
-            q = VNULL;
-            q = Vmem_malloc(thee->vmem, npos, sizeof(double));
-            if (q == VNULL) {
-                Vnm_print(2, "Vgreen_coulomb:  Error allocating charge array!\n");
-                return 0;
-            }
-        } else {
-            q = &(qtemp);
-        }
-        for (ipos=0; ipos<npos; ipos++) q[ipos] = 1.0;
-
-        /* Calculate */
-        treecalc(thee, x, y, z, q, npos, pot, thee->xp, thee->yp, thee->zp,
-                thee->qp, thee->np, gradx, grady, gradz, 2, npos, thee->np);
+    /* A single cell has no far field; the direct sum is cheaper */
+    if (thee->nnode < 2) return Vgreen_coulombD_direct(thee, npos, x, y, z,
+            pot, gradx, grady, gradz);
 
-        /* De-allocate charge array (if necessary) */
-        if (npos > 1) Vmem_free(thee->vmem, npos, sizeof(double), (void **)&q);
-    } else return Vgreen_coulombD_direct(thee, npos, x, y, z, pot,
-            gradx, grady, gradz);
+    if (!treecalc(thee, npos, x, y, z, pot, gradx, grady, gradz, VNULL,
+      0.0)) {
+        return 0;
+    }
 
     scale = Vunit_ec/(4*VPI*Vunit_eps0*(1.0e-10));
     for (ipos=0; ipos<npos; ipos++) {
@@ -412,141 +522,411 @@ VPUBLIC int Vgreen_coulombD(Vgreen *thee, int npos, double *x, double *y,
     }
 
     return 1;
-
-#else /* ifdef HAVE_TREE */
-
-    return Vgreen_coulombD_direct(thee, npos, x, y, z, pot,
-            gradx, grady, gradz);
-
-#endif
-
 }
 
 VPRIVATE int treesetup(Vgreen *thee) {
 
-#ifdef HAVE_TREE
-
-    double dist_tol = FMM_DIST_TOL;
-    int iflag = FMM_IFLAG;
-    double order = FMM_ORDER;
-    int theta = FMM_THETA;
-    int shrink = FMM_SHRINK;
-    int maxparnode = FMM_MAXPARNODE;
-    int minlevel = FMM_MINLEVEL;
-    int maxlevel = FMM_MAXLEVEL;
-    int level = 0;
-    int one = 1;
     Vatom *atom;
-    double xyzminmax[6], *pos;
-    int i;
+    double *pos, charge;
+    int i, natoms;
 
-    /* Set up particle arrays with atomic coordinates and charges */
-    Vnm_print(0, "treesetup:  Initializing FMM particle arrays...\n");
-    thee->np = Valist_getNumberAtoms(thee->alist);
     thee->xp = VNULL;
-    thee->xp = (double *)Vmem_malloc(thee->vmem, thee->np, sizeof(double));
-    if (thee->xp == VNULL) {
-        Vnm_print(2, "Vgreen_ctor2:  Failed to allocate %d*sizeof(double)!\n",
-          thee->np);
-        return 0;
-    }
     thee->yp = VNULL;
-    thee->yp = (double *)Vmem_malloc(thee->vmem, thee->np, sizeof(double));
-    if (thee->yp == VNULL) {
-        Vnm_print(2, "Vgreen_ctor2:  Failed to allocate %d*sizeof(double)!\n",
-          thee->np);
-        return 0;
-    }
     thee->zp = VNULL;
-    thee->zp = (double *)Vmem_malloc(thee->vmem, thee->np, sizeof(double));
-    if (thee->zp == VNULL) {
-        Vnm_print(2, "Vgreen_ctor2:  Failed to allocate %d*sizeof(double)!\n",
-          thee->np);
-        return 0;
-    }
     thee->qp = VNULL;
+    thee->node = VNULL;
+    thee->moment = VNULL;
+    thee->np = 0;
+    thee->nnode = 0;
+    thee->maxnode = 0;
+    thee->nmoment = 0;
+    if (thee->alist == VNULL) return 1;
+
+    /* Set up particle arrays with atomic coordinates and charges; uncharged
+     * atoms contribute nothing and are left out of the tree */
+    Vnm_print(0, "treesetup:  Initializing FMM particle arrays...\n");
+    natoms = Valist_getNumberAtoms(thee->alist);
+    for (i=0; i<natoms; i++) {
+        atom = Valist_getAtom(thee->alist, i);
+        if (VABS(Vatom_getCharge(atom)) > 0.0) thee->np++;
+    }
+    if (thee->np == 0) return 1;
+    thee->xp = (double *)Vmem_malloc(thee->vmem, thee->np, sizeof(double));
+    thee->yp = (double *)Vmem_malloc(thee->vmem, thee->np, sizeof(double));
+    thee->zp = (double *)Vmem_malloc(thee->vmem, thee->np, sizeof(double));
     thee->qp = (double *)Vmem_malloc(thee->vmem, thee->np, sizeof(double));
-    if (thee->qp == VNULL) {
-        Vnm_print(2, "Vgreen_ctor2:  Failed to allocate %d*sizeof(double)!\n",
+    if ((thee->xp == VNULL) || (thee->yp == VNULL) || (thee->zp == VNULL) ||
+      (thee->qp == VNULL)) {
+        Vnm_print(2, "Vgreen_ctor2:  Failed to allocate 4*%d*sizeof(double)!\n",
           thee->np);
         return 0;
     }
-    for (i=0; i<thee->np; i++) {
+    thee->np = 0;
+    for (i=0; i<natoms; i++) {
         atom = Valist_getAtom(thee->alist, i);
-        pos = Vatom_getPosition(atom);
-        thee->xp[i] = pos[0];
-        thee->yp[i] = pos[1];
-        thee->zp[i] = pos[2];
-        thee->qp[i] = Vatom_getCharge(atom);
+        charge = Vatom_getCharge(atom);
+        if (VABS(charge) > 0.0) {
+            pos = Vatom_getPosition(atom);
+            thee->xp[thee->np] = pos[0];
+            thee->yp[thee->np] = pos[1];
+            thee->zp[thee->np] = pos[2];
+            thee->qp[thee->np] = charge;
+            thee->np++;
+        }
     }
 
-    Vnm_print(0, "treesetup:  Setting things up...\n");
-    F77SETUP(thee->xp, thee->yp, thee->zp, &(thee->np), &order, &theta, &iflag,
-            &dist_tol, xyzminmax, &(thee->np));
-
-
-    Vnm_print(0, "treesetup:  Initializing levels...\n");
-    F77INITLEVELS(&minlevel, &maxlevel);
-
     Vnm_print(0, "treesetup:  Creating tree...\n");
-    F77CREATE_TREE(&one, &(thee->np), thee->xp, thee->yp, thee->zp, thee->qp,
-      &shrink, &maxparnode, xyzminmax, &level, &(thee->np));
-
-    return 1;
+    return treebuild(thee);
+}
 
-#else /* ifdef HAVE_TREE */
+VPRIVATE int treecleanup(Vgreen *thee) {
 
-    Vnm_print(2, "treesetup:  Error!  APBS not linked with treecode!\n");
-    return 0;
+    if (thee->np > 0) {
+        Vmem_free(thee->vmem, thee->np, sizeof(double), (void **)&(thee->xp));
+        Vmem_free(thee->vmem, thee->np, sizeof(double), (void **)&(thee->yp));
+        Vmem_free(thee->vmem, thee->np, sizeof(double), (void **)&(thee->zp));
+        Vmem_free(thee->vmem, thee->np, sizeof(double), (void **)&(thee->qp));
+    }
+    if (thee->node != VNULL) {
+        Vmem_free(thee->vmem, thee->maxnode, sizeof(VgreenNode),
+          (void **)&(thee->node));
+    }
+    if (thee->moment != VNULL) {
+        Vmem_free(thee->vmem, thee->nnode*thee->nmoment, sizeof(double),
+          (void **)&(thee->moment));
+    }
+    thee->np = 0;
+    thee->nnode = 0;
+    thee->maxnode = 0;
 
-#endif /* ifdef HAVE_TREE */
+    return 1;
 }
 
-VPRIVATE int treecleanup(Vgreen *thee) {
+VPRIVATE int treebuild(Vgreen *thee) {
+
+    VgreenNode *node, *child;
+    double lower[3], upper[3], mid[3], dx, dy, dz, dist2, rad2;
+    double *tmp, *m, px[FMM_MAXORDER+1], py[FMM_MAXORDER+1];
+    double pz[FMM_MAXORDER+1], qxy;
+    int *depth, *octant, count[8], start[8], fill[8];
+    int inode, i, j, k, c, ip, np, order, oct;
+
+    np = thee->np;
+    order = thee->order;
+
+    /* Every internal cell has at least two non-empty children, so the tree
+     * has at most 2*np-1 cells */
+    thee->maxnode = 2*np;
+    thee->node = (VgreenNode *)Vmem_malloc(thee->vmem, thee->maxnode,
+      sizeof(VgreenNode));
+    tmp = (double *)Vmem_malloc(thee->vmem, np, sizeof(double));
+    octant = (int *)Vmem_malloc(thee->vmem, np, sizeof(int));
+    depth = (int *)Vmem_malloc(thee->vmem, thee->maxnode, sizeof(int));
+    if ((thee->node == VNULL) || (tmp == VNULL) || (octant == VNULL) ||
+      (depth == VNULL)) {
+        Vnm_print(2, "treebuild:  Failed to allocate octree for %d particles!\n",
+          np);
+        return 0;
+    }
 
-#ifdef HAVE_TREE
+    /* Cells are created breadth-first; the node array doubles as the work
+     * queue.  Particles are permuted so every cell owns a contiguous range. */
+    thee->node[0].ibeg = 0;
+    thee->node[0].iend = np;
+    depth[0] = 0;
+    thee->nnode = 1;
+    for (inode=0; inode<thee->nnode; inode++) {
+        node = &(thee->node[inode]);
+        node->nchild = 0;
+
+        /* Tight bounding box */
+        for (i=0; i<3; i++) {
+            lower[i] = VLARGE;
+            upper[i] = -VLARGE;
+        }
+        for (ip=node->ibeg; ip<node->iend; ip++) {
+            lower[0] = VMIN2(lower[0], thee->xp[ip]);
+            lower[1] = VMIN2(lower[1], thee->yp[ip]);
+            lower[2] = VMIN2(lower[2], thee->zp[ip]);
+            upper[0] = VMAX2(upper[0], thee->xp[ip]);
+            upper[1] = VMAX2(upper[1], thee->yp[ip]);
+            upper[2] = VMAX2(upper[2], thee->zp[ip]);
+        }
+        rad2 = 0.0;
+        for (i=0; i<3; i++) mid[i] = 0.5*(lower[i] + upper[i]);
+        for (ip=node->ibeg; ip<node->iend; ip++) {
+            dx = thee->xp[ip] - mid[0];
+            dy = thee->yp[ip] - mid[1];
+            dz = thee->zp[ip] - mid[2];
+            dist2 = VSQR(dx) + VSQR(dy) + VSQR(dz);
+            if (dist2 > rad2) rad2 = dist2;
+        }
+        for (i=0; i<3; i++) node->center[i] = mid[i];
+        node->radius = VSQRT(rad2);
+
+        if (((node->iend - node->ibeg) <= thee->maxparnode) ||
+          (node->radius < VSMALL) || (depth[inode] >= FMM_MAXDEPTH)) continue;
+
+        /* Split at the box center into octants */
+        for (oct=0; oct<8; oct++) count[oct] = 0;
+        for (ip=node->ibeg; ip<node->iend; ip++) {
+            oct = ((thee->xp[ip] >= mid[0]) ? 4 : 0) +
+                  ((thee->yp[ip] >= mid[1]) ? 2 : 0) +
+                  ((thee->zp[ip] >= mid[2]) ? 1 : 0);
+            octant[ip] = oct;
+            count[oct]++;
+        }
+        start[0] = node->ibeg;
+        for (oct=1; oct<8; oct++) start[oct] = start[oct-1] + count[oct-1];
+        for (c=0; c<4; c++) {
+            m = (c == 0) ? thee->xp : ((c == 1) ? thee->yp :
+              ((c == 2) ? thee->zp : thee->qp));
+            for (oct=0; oct<8; oct++) fill[oct] = start[oct];
+            for (ip=node->ibeg; ip<node->iend; ip++) {
+                tmp[fill[octant[ip]]++] = m[ip];
+            }
+            for (ip=node->ibeg; ip<node->iend; ip++) m[ip] = tmp[ip];
+        }
+        for (oct=0; oct<8; oct++) {
+            if (count[oct] == 0) continue;
+            child = &(thee->node[thee->nnode]);
+            child->ibeg = start[oct];
+            child->iend = start[oct] + count[oct];
+            depth[thee->nnode] = depth[inode] + 1;
+            node->child[node->nchild] = thee->nnode;
+            node->nchild++;
+            thee->nnode++;
+        }
+    }
+
+    Vmem_free(thee->vmem, np, sizeof(double), (void **)&tmp);
+    Vmem_free(thee->vmem, np, sizeof(int), (void **)&octant);
+    Vmem_free(thee->vmem, thee->maxnode, sizeof(int), (void **)&depth);
+
+    /* Multipole moments m_k = sum_j q_j (y_j - c)^k for |k| <= order */
+    thee->nmoment = (order+1)*(order+2)*(order+3)/6;
+    thee->moment = (double *)Vmem_malloc(thee->vmem,
+      thee->nnode*thee->nmoment, sizeof(double));
+    if (thee->moment == VNULL) {
+        Vnm_print(2, "treebuild:  Failed to allocate %d*%d moments!\n",
+          thee->nnode, thee->nmoment);
+        return 0;
+    }
+#pragma omp parallel for default(shared) private(inode,node,m,ip,i,j,k,c,px,py,pz,qxy) schedule(dynamic,16)
+    for (inode=0; inode<thee->nnode; inode++) {
+        node = &(thee->node[inode]);
+        m = &(thee->moment[inode*thee->nmoment]);
+        for (c=0; c<thee->nmoment; c++) m[c] = 0.0;
+        node->absq = 0.0;
+        for (ip=node->ibeg; ip<node->iend; ip++) {
+            node->absq += VABS(thee->qp[ip]);
+            px[0] = 1.0; py[0] = 1.0; pz[0] = 1.0;
+            for (i=1; i<=order; i++) {
+                px[i] = px[i-1]*(thee->xp[ip] - node->center[0]);
+                py[i] = py[i-1]*(thee->yp[ip] - node->center[1]);
+                pz[i] = pz[i-1]*(thee->zp[ip] - node->center[2]);
+            }
+            c = 0;
+            for (i=0; i<=order; i++) {
+                for (j=0; j<=order-i; j++) {
+                    qxy = thee->qp[ip]*px[i]*py[j];
+                    for (k=0; k<=order-i-j; k++) {
+                        m[c] += qxy*pz[k];
+                        c++;
+                    }
+                }
+            }
+        }
+    }
 
-    Vmem_free(thee->vmem, thee->np, sizeof(double), (void **)&(thee->xp));
-    Vmem_free(thee->vmem, thee->np, sizeof(double), (void **)&(thee->yp));
-    Vmem_free(thee->vmem, thee->np, sizeof(double), (void **)&(thee->zp));
-    Vmem_free(thee->vmem, thee->np, sizeof(double), (void **)&(thee->qp));
-    F77CLEANUP();
+    Vnm_print(0, "treebuild:  %d particles in %d cells (order %d, theta %g)\n",
+      np, thee->nnode, order, thee->theta);
 
     return 1;
+}
 
-#else /* ifdef HAVE_TREE */
+/*
+ * @brief  Taylor coefficients of the screened Coulomb kernel
+ * @ingroup  Vgreen
+ * @note  Computes a_k = (1/k!) D_y^k [exp(-kappa |x-y|)/|x-y|] at y = c for
+ *        all |k| <= order using the recurrence of Li, Johnston and Krasny
+ *        (J. Comput. Phys. 228, 2009); b_k are the coefficients of
+ *        exp(-kappa |x-y|).  With kappa = 0 this is the Coulomb recurrence.
+ * @param  r  x - c
+ * @param  kappa  Inverse screening length
+ * @param  order  Highest total order required
+ * @param  a  Kernel coefficients (FMM_DIM^3 array, indexed by FMM_IDX)
+ * @param  b  Scratch (FMM_DIM^3 array)
+ */
+VPRIVATE void treecoef(double r[3], double kappa, int order, double *a,
+        double *b) {
+
+    double dist2, dist, ra, aa, rb, bb;
+    int i, j, k, n;
+
+    dist2 = VSQR(r[0]) + VSQR(r[1]) + VSQR(r[2]);
+    dist = VSQRT(dist2);
+    b[FMM_IDX(0,0,0)] = exp(-kappa*dist);
+    a[FMM_IDX(0,0,0)] = b[FMM_IDX(0,0,0)]/dist;
+
+    for (n=1; n<=order; n++) {
+        for (i=0; i<=n; i++) {
+            for (j=0; j<=n-i; j++) {
+                k = n - i - j;
+                ra = 0.0; aa = 0.0; rb = 0.0; bb = 0.0;
+                if (i > 0) {
+                    ra += r[0]*a[FMM_IDX(i-1,j,k)];
+                    rb += r[0]*b[FMM_IDX(i-1,j,k)];
+                }
+                if (j > 0) {
+                    ra += r[1]*a[FMM_IDX(i,j-1,k)];
+                    rb += r[1]*b[FMM_IDX(i,j-1,k)];
+                }
+                if (k > 0) {
+                    ra += r[2]*a[FMM_IDX(i,j,k-1)];
+                    rb += r[2]*b[FMM_IDX(i,j,k-1)];
+                }
+                if (i > 1) {
+                    aa += a[FMM_IDX(i-2,j,k)];
+                    bb += b[FMM_IDX(i-2,j,k)];
+                }
+                if (j > 1) {
+                    aa += a[FMM_IDX(i,j-2,k)];
+                    bb += b[FMM_IDX(i,j-2,k)];
+                }
+                if (k > 1) {
+                    aa += a[FMM_IDX(i,j,k-2)];
+                    bb += b[FMM_IDX(i,j,k-2)];
+                }
+                a[FMM_IDX(i,j,k)] = ((2*n - 1)*ra - (n - 1)*aa +
+                  kappa*(rb - bb))/(n*dist2);
+                b[FMM_IDX(i,j,k)] = kappa*(ra - aa)/n;
+            }
+        }
+    }
+}
 
-    Vnm_print(2, "treecleanup:  Error!  APBS not linked with treecode!\n");
-    return 0;
+/*
+ * @brief  Evaluate the potential and field of the tree at one point
+ * @ingroup  Vgreen
+ * @param  thee  Vgreen object
+ * @param  pt  Observation point
+ * @param  kappa  Inverse screening length
+ * @param  dograd  Whether to compute the field
+ * @param  pot  Set to the (unscaled) potential
+ * @param  grad  Set to the (unscaled) field, -grad(pot)
+ * @param  bound  Set to the (unscaled) bound on the potential truncation
+ *         error for the Coulomb kernel
+ */
+VPRIVATE void treeeval(Vgreen *thee, double pt[3], double kappa, int dograd,
+        double *pot, double grad[3], double *bound) {
+
+    VgreenNode *node;
+    double a[FMM_DIM*FMM_DIM*FMM_DIM], b[FMM_DIM*FMM_DIM*FMM_DIM];
+    double r[3], *m, dx, dy, dz, dist2, dist, fac, val, theta2;
+    int stack[8*FMM_MAXDEPTH+8], nstack, inode, ip, i, j, k, c, order;
+
+    order = thee->order;
+    theta2 = VSQR(thee->theta);
+    *pot = 0.0;
+    *bound = 0.0;
+    grad[0] = 0.0; grad[1] = 0.0; grad[2] = 0.0;
+
+    nstack = 0;
+    stack[nstack++] = 0;
+    while (nstack > 0) {
+        inode = stack[--nstack];
+        node = &(thee->node[inode]);
+        for (i=0; i<3; i++) r[i] = pt[i] - node->center[i];
+        dist2 = VSQR(r[0]) + VSQR(r[1]) + VSQR(r[2]);
+
+        if (VSQR(node->radius) < theta2*dist2) {
+            /* Far field:  use the expansion unless the cell is so small that
+             * summing it directly is cheaper */
+            if ((node->iend - node->ibeg) > thee->nmoment) {
+                treecoef(r, kappa, order + dograd, a, b);
+                dist = VSQRT(dist2);
+                *bound += node->absq*pow(node->radius/dist, order + 1)/
+                  (dist - node->radius);
+                m = &(thee->moment[inode*thee->nmoment]);
+                c = 0;
+                for (i=0; i<=order; i++) {
+                    for (j=0; j<=order-i; j++) {
+                        for (k=0; k<=order-i-j; k++) {
+                            *pot += a[FMM_IDX(i,j,k)]*m[c];
+                            if (dograd) {
+                                grad[0] += (i+1)*a[FMM_IDX(i+1,j,k)]*m[c];
+                                grad[1] += (j+1)*a[FMM_IDX(i,j+1,k)]*m[c];
+                                grad[2] += (k+1)*a[FMM_IDX(i,j,k+1)]*m[c];
+                            }
+                            c++;
+                        }
+                    }
+                }
+                continue;
+            }
+        } else if (node->nchild > 0) {
+            for (i=0; i<node->nchild; i++) stack[nstack++] = node->child[i];
+            continue;
+        }
 
-#endif /* ifdef HAVE_TREE */
+        /* Near field (or small far cell):  direct summation */
+        for (ip=node->ibeg; ip<node->iend; ip++) {
+            dx = thee->xp[ip] - pt[0];
+            dy = thee->yp[ip] - pt[1];
+            dz = thee->zp[ip] - pt[2];
+            dist2 = VSQR(dx) + VSQR(dy) + VSQR(dz);
+            dist = VSQRT(dist2);
+            if (dist > VSMALL) {
+                val = thee->qp[ip]/dist;
+                if (kappa > 0.0) val *= exp(-kappa*dist);
+                *pot += val;
+                if (dograd) {
+                    fac = val*(1.0 + kappa*dist)/dist2;
+                    grad[0] -= fac*dx;
+                    grad[1] -= fac*dy;
+                    grad[2] -= fac*dz;
+                }
+            }
+        }
+    }
 }
 
-VPRIVATE int treecalc(Vgreen *thee, double *xtar, double *ytar, double *ztar,
-        double *qtar, int numtars, double *tpengtar, double *x, double *y,
-        double *z, double *q, int numpars, double *fx, double *fy, double *fz,
-        int iflag, int farrdim, int arrdim) {
-
-#ifdef HAVE_TREE
-    int i, level, err, maxlevel, minlevel, one;
-    double xyzminmax[6];
+VPRIVATE int treecalc(Vgreen *thee, int npos, double *x, double *y,
+        double *z, double *pot, double *gradx, double *grady, double *gradz,
+        double *bound, double kappa) {
 
+    double pt[3], val, err, grad[3];
+    int ipos, dograd;
 
-    if (iflag != 1) {
-        F77TREE_COMPFP(xtar, ytar, ztar, qtar, &numtars, tpengtar, x, y, z, q,
-                fx, fy, fz, &numpars, &farrdim, &arrdim);
-    } else {
-        F77TREE_COMPP(xtar, ytar, ztar, qtar, &numtars, tpengtar, &farrdim, x,
-                y, z, q, &numpars, &arrdim);
+    dograd = (gradx != VNULL);
+    if (thee->nnode == 0) {
+        for (ipos=0; ipos<npos; ipos++) {
+            if (pot != VNULL) pot[ipos] = 0.0;
+            if (bound != VNULL) bound[ipos] = 0.0;
+            if (dograd) {
+                gradx[ipos] = 0.0;
+                grady[ipos] = 0.0;
+                gradz[ipos] = 0.0;
+            }
+        }
+        return 1;
     }
 
+#pragma omp parallel for default(shared) private(ipos,pt,val,err,grad) schedule(dynamic,16) if(npos > 16)
+    for (ipos=0; ipos<npos; ipos++) {
+        pt[0] = x[ipos];
+        pt[1] = y[ipos];
+        pt[2] = z[ipos];
+        treeeval(thee, pt, kappa, dograd, &val, grad, &err);
+        if (pot != VNULL) pot[ipos] = val;
+        if (bound != VNULL) bound[ipos] = err;
+        if (dograd) {
+            gradx[ipos] = grad[0];
+            grady[ipos] = grad[1];
+            gradz[ipos] = grad[2];
+        }
+    }
 
     return 1;
-
-#else /* ifdef HAVE_TREE */
-
-    Vnm_print(2, "treecalc:  Error!  APBS not linked with treecode!\n");
-    return 0;
-
-#endif /* ifdef HAVE_TREE */
 }
@@ -1,8 +1,11 @@
 /** @defgroup Vgreen Vgreen class
  *  @brief    Provides capabilities for pointwise evaluation of free space
  *            Green's function for point charges in a uniform dielectric.
- *  @note     Right now, these are very slow methods without any fast multipole
- *            acceleration.
+ *  @note     Sums over more than a handful of charges are evaluated with a
+ *            native Cartesian treecode (octree with multipole acceptance
+ *            criterion and Taylor expansions of the Coulomb and screened
+ *            Coulomb kernels); the *_direct methods provide reference
+ *            O(N*M) summations.
  *
  *  @attention
  *  @verbatim
@@ -74,6 +77,26 @@
 #include "generic/vatom.h"
 #include "generic/valist.h"
 
+/**
+ *  @ingroup Vgreen
+ *  @brief   Octree cell used by the Vgreen treecode
+ */
+struct sVgreenNode {
+  int ibeg;  /**< Index of first particle (in tree order) in this cell */
+  int iend;  /**< One past the index of the last particle in this cell */
+  int nchild;  /**< Number of non-empty children (0 for leaves) */
+  int child[8];  /**< Indices of the children in the node array */
+  double center[3];  /**< Expansion center (center of the bounding box) */
+  double radius;  /**< Distance from the center to the farthest particle */
+  double absq;  /**< Sum of the absolute values of the cell's charges */
+};
+
+/**
+ *  @ingroup Vgreen
+ *  @brief   Declaration of the VgreenNode class as the sVgreenNode structure
+ */
+typedef struct sVgreenNode VgreenNode;
+
 /**
  *  @ingroup Vgreen
  *  @author  Nathan Baker
@@ -83,15 +106,24 @@ struct sVgreen {
 
   Valist *alist;  /**< Atom (charge) list for Green's function */
   Vmem *vmem;  /**< Memory management object */
-  double *xp;  /**< Array of particle x-coordinates for use with
-                * treecode routines */
-  double *yp;  /**< Array of particle y-coordinates for use with
-                * treecode routines */
-  double *zp;  /**< Array of particle z-coordinates for use with
-                * treecode routines */
-  double *qp;  /**< Array of particle charges for use with
+  double *xp;  /**< Array of particle x-coordinates (in tree order) for use
+                * with treecode routines */
+  double *yp;  /**< Array of particle y-coordinates (in tree order) for use
+                * with treecode routines */
+  double *zp;  /**< Array of particle z-coordinates (in tree order) for use
+                * with treecode routines */
+  double *qp;  /**< Array of particle charges (in tree order) for use with
                 * treecode routines */
   int np;  /**< Set to size of above arrays */
+  int order;  /**< Order of the Cartesian multipole expansions */
+  double theta;  /**< Multipole acceptance criterion:  a cell of radius r is
+                  * approximated at distance R if r < theta*R */
+  int maxparnode;  /**< Maximum number of particles in a leaf cell */
+  VgreenNode *node;  /**< Octree cells; node[0] is the root */
+  int nnode;  /**< Number of cells in the octree */
+  int maxnode;  /**< Allocated length of the node array */
+  double *moment;  /**< Multipole moments, nmoment per cell */
+  int nmoment;  /**< Number of moments per cell */
 };
 
 /**
@@ -164,6 +196,63 @@ VEXTERNC void Vgreen_dtor(Vgreen **thee);
  */
 VEXTERNC void Vgreen_dtor2(Vgreen *thee);
 
+/** @brief   Set the treecode parameters and rebuild the octree
+ *
+ *           The relative error of each far-field interaction is bounded by
+ *           roughly \f$\theta^{p+1}\f$, where \f$p\f$ is the expansion
+ *           order.  The defaults are order 6, \f$\theta = 0.5\f$ and 64
+ *           particles per leaf.
+ *
+ *  @ingroup Vgreen
+ *  @param   thee  Vgreen object
+ *  @param   order  Order of the Cartesian multipole expansions (0 to 10)
+ *  @param   theta  Multipole acceptance criterion (0 < theta < 1)
+ *  @param   maxparnode  Maximum number of particles in a leaf cell
+ *  @return  1 if successful, 0 otherwise
+ */
+VEXTERNC int Vgreen_setTreeParams(Vgreen *thee, int order, double theta,
+  int maxparnode);
+
+/** @brief   Get the Green's function for Helmholtz's equation integrated over
+ *           the atomic point charges using direct summation
+ *
+ *           Returns the potential \f$\phi\f$ defined by
+ *           \f[ \phi(r) = \sum_i \frac{q_i e^{-\kappa r_i}}{r_i} \f]
+ *           (see Vgreen_helmholtz).  The potential is scaled to units of V.
+ *
+ *  @ingroup Vgreen
+ *  @param   thee  Vgreen object
+ *  @param   npos  Number of positions to evaluate
+ *  @param   x  The npos x-coordinates
+ *  @param   y  The npos y-coordinates
+ *  @param   z  The npos z-coordinates
+ *  @param   val  The npos values
+ *  @param   kappa The inverse screening length (in 1/&Aring;)
+ *  @return  1 if successful, 0 otherwise
+ */
+VEXTERNC int Vgreen_helmholtz_direct(Vgreen *thee, int npos, double *x,
+  double *y, double *z, double *val, double kappa);
+
+/** @brief   Get the gradient of Green's function for Helmholtz's equation
+ *           integrated over the atomic point charges using direct summation
+ *
+ *  @ingroup Vgreen
+ *  @note    Same conventions and units as Vgreen_helmholtzD
+ *  @param   thee  Vgreen object
+ *  @param   npos  The number of positions to evaluate
+ *  @param   x  The npos x-coordinates
+ *  @param   y  The npos y-coordinates
+ *  @param   z  The npos z-coordinates
+ *  @param   gradx  The npos gradient x-components
+ *  @param   grady  The npos gradient y-components
+ *  @param   gradz  The npos gradient z-components
+ *  @param   kappa The inverse screening length (in 1/&Aring;)
+ *  @return  1 if successful, 0 otherwise
+ */
+VEXTERNC int Vgreen_helmholtzD_direct(Vgreen *thee, int npos, double *x,
+  double *y, double *z, double *gradx, double *grady, double *gradz,
+  double kappa);
+
 /** @brief   Get the Green's function for Helmholtz's equation integrated over
  *           the atomic point charges
  *
@@ -177,8 +266,7 @@ VEXTERNC void Vgreen_dtor2(Vgreen *thee);
  *
  *  @ingroup Vgreen
  *  @author  Nathan Baker
- *  @bug     Not implemented yet
- *  @note    Not implemented yet
+ *  @note    Evaluated with the treecode; see Vgreen_setTreeParams
  *  @param   thee  Vgreen object
  *  @param   npos  Number of positions to evaluate
  *  @param   x  The npos x-coordinates
@@ -205,8 +293,9 @@ VEXTERNC int Vgreen_helmholtz(Vgreen *thee, int npos, double *x, double *y,
  *
  *  @ingroup Vgreen
  *  @author  Nathan Baker
- *  @bug     Not implemented yet
- *  @note    Not implemented yet
+ *  @note    The sign convention matches Vgreen_coulombD (the returned
+ *           components are \f$-\nabla \phi\f$, the field).  Evaluated with
+ *           the treecode; see Vgreen_setTreeParams
  *  @param   thee  Vgreen object
  *  @param   npos  The number of positions to evaluate
  *  @param   x  The npos x-coordinates
@@ -246,7 +335,7 @@ VEXTERNC int Vgreen_coulomb_direct(Vgreen *thee, int npos, double *x,
 
 /** @brief   Get the Coulomb's Law Green's function (solution to Laplace's
  *           equation) integrated over the atomic point charges using direct
- *           summation or H. E. Johnston, R. Krasny FMM library (if available)
+ *           summation or the treecode (for more than a handful of charges)
  *
  *           Returns the potential \f$\phi\f$ defined by
  *           \f[ \phi(r) = \sum_i \frac{q_i}{r_i} \f]
@@ -267,6 +356,30 @@ VEXTERNC int Vgreen_coulomb_direct(Vgreen *thee, int npos, double *x,
 VEXTERNC int Vgreen_coulomb(Vgreen *thee, int npos, double *x, double *y,
   double *z, double *val);
 
+/** @brief   Get the Coulomb's Law Green's function integrated over the
+ *           atomic point charges along with a bound on the treecode error
+ *
+ *           Same as Vgreen_coulomb, but also returns for each point a
+ *           rigorous bound on the far-field truncation error.  For a cell
+ *           of radius \f$r\f$ approximated at distance \f$R\f$ with
+ *           expansion order \f$p\f$ the bound is
+ *           \f[ \frac{\sum_j |q_j|}{R - r} \left(\frac{r}{R}\right)^{p+1}
+ *           \f]
+ *           summed over all approximated cells.
+ *
+ *  @ingroup Vgreen
+ *  @param   thee Vgreen object
+ *  @param   npos  The number of positions to evaluate
+ *  @param   x  The npos x-coordinates
+ *  @param   y  The npos y-coordinates
+ *  @param   z  The npos z-coordinates
+ *  @param   val  The npos values (V)
+ *  @param   bound  The npos error bounds (V)
+ *  @return  1 if successful, 0 otherwise
+ */
+VEXTERNC int Vgreen_coulombBound(Vgreen *thee, int npos, double *x,
+        double *y, double *z, double *val, double *bound);
+
 /** @brief   Get gradient of the Coulomb's Law Green's function (solution to
  *           Laplace's equation) integrated over the atomic point charges using
  *           direct summation
@@ -296,8 +409,8 @@ VEXTERNC int Vgreen_coulombD_direct(Vgreen *thee, int npos, double *x,
 
 /** @brief   Get gradient of the Coulomb's Law Green's function (solution to
  *           Laplace's equation) integrated over the atomic point charges using
- *           either direct summation or H. E. Johnston/R. Krasny FMM library
- *           (if available)
+ *           either direct summation or the treecode (for more than a handful
+ *           of charges)
  *
  *           Returns the field \f$\nabla \phi\f$ defined by
  *           \f[ \nabla \phi(r) = \sum_i \frac{q_i}{r_i} \f]
@@ -313,7 +313,9 @@ enum eVdata_Format {
     VDF_MCSF=3,  /**< FEtk MC Simplex Format (MCSF) */
     VDF_GZ=4,    /**< Binary file (GZip) */
     VDF_FLAT=5,  /**< Write flat file */
-	VDF_DXBIN=6 /**< OpendDX (Data Explorer) binary format */
+	VDF_DXBIN=6, /**< OpendDX (Data Explorer) binary format */
+    VDF_RAW=7,  /**< Raw binary grid (see Vgrid_writeRaw) */
+    VDF_LOSSY=8  /**< Error-bounded lossy grid (see Vgrid_writeLossy) */
 };
 
 /** @typedef Vdata_Format
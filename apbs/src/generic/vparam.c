@@ -96,6 +96,21 @@ VPRIVATE int readFlatFileLine(Vio *sock, Vparam_AtomData *atom);
  */
 VPRIVATE int readXMLFileAtom(Vio *sock, Vparam_AtomData *atom);
 
+/**
+ * @brief  Release the residue/atom name index
+ * @ingroup  Vparam
+ * @param  thee  Vparam object
+ */
+VPRIVATE void Vparam_clearIndex(Vparam *thee);
+
+/**
+ * @brief  Build the residue/atom name index over the loaded residues
+ * @ingroup  Vparam
+ * @param  thee  Vparam object
+ * @returns 1 if successful, 0 otherwise
+ */
+VPRIVATE int Vparam_buildIndex(Vparam *thee);
+
 
 #if !defined(VINLINE_VPARAM)
 
@@ -206,6 +221,10 @@ VPUBLIC int Vparam_ctor2(Vparam *thee) {
 
     thee->nResData = 0;
     thee->resData = VNULL;
+    thee->nResHash = 0;
+    thee->resHash = VNULL;
+    thee->nAtomHash = 0;
+    thee->atomHash = VNULL;
 
     return 1;
 }
@@ -226,6 +245,8 @@ VPUBLIC void Vparam_dtor2(Vparam *thee) {
 
     if (thee == VNULL) return;
 
+    Vparam_clearIndex(thee);
+
     /* Destroy the residue data */
     for (i=0; i<thee->nResData; i++) Vparam_ResData_dtor2(&(thee->resData[i]));
     if (thee->nResData > 0) Vmem_free(thee->vmem, thee->nResData,
@@ -238,69 +259,219 @@ VPUBLIC void Vparam_dtor2(Vparam *thee) {
 
 }
 
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vparam_hashName
+//
+// Purpose:  FNV-1a hash of a name folded the way Vstring_strcasecmp folds
+//           it.  Only ASCII letters are folded and other bytes above 0x7f
+//           are skipped, so names that compare equal always hash equal.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE unsigned int Vparam_hashName(const char *name, unsigned int seed) {
+
+    unsigned int hash;
+    unsigned char c;
+
+    hash = 2166136261u ^ seed;
+    for (; *name != '\0'; name++) {
+        c = (unsigned char)(*name);
+        if (c > 0x7f) continue;
+        if ((c >= 'A') && (c <= 'Z')) c = (unsigned char)(c - 'A' + 'a');
+        hash = (hash ^ c)*16777619u;
+    }
+    return hash;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vparam_findRes
+//
+// Purpose:  Index of the first residue called resName (case-insensitive)
+//
+// Returns:  Residue index or -1
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vparam_findRes(Vparam *thee, const char *resName) {
+
+    unsigned int slot, mask;
+    int ires;
+
+    if (thee->nResHash == 0) {
+        for (ires=0; ires<thee->nResData; ires++) {
+            if (Vstring_strcasecmp(resName, thee->resData[ires].name) == 0)
+              return ires;
+        }
+        return -1;
+    }
+
+    mask = (unsigned int)(thee->nResHash - 1);
+    slot = Vparam_hashName(resName, 0) & mask;
+    while ((ires = thee->resHash[slot]) >= 0) {
+        if (Vstring_strcasecmp(resName, thee->resData[ires].name) == 0)
+          return ires;
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vparam_findAtom
+//
+// Purpose:  Index of the first atom called atomName (case-insensitive) in
+//           residue ires
+//
+// Returns:  Atom index or -1
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vparam_findAtom(Vparam *thee, int ires, const char *atomName) {
+
+    Vparam_ResData *res;
+    unsigned int slot, mask;
+    int iatom;
+
+    res = &(thee->resData[ires]);
+    if (thee->nAtomHash == 0) {
+        for (iatom=0; iatom<res->nAtomData; iatom++) {
+            if (Vstring_strcasecmp(atomName, res->atomData[iatom].atomName)
+              == 0) return iatom;
+        }
+        return -1;
+    }
+
+    mask = (unsigned int)(thee->nAtomHash - 1);
+    slot = Vparam_hashName(atomName, (unsigned int)ires*2654435761u) & mask;
+    while (thee->atomHash[2*slot] >= 0) {
+        iatom = thee->atomHash[2*slot+1];
+        if ((thee->atomHash[2*slot] == ires) && (Vstring_strcasecmp(atomName,
+          res->atomData[iatom].atomName) == 0)) return iatom;
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vparam_clearIndex
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void Vparam_clearIndex(Vparam *thee) {
+
+    if (thee->nResHash > 0) {
+        Vmem_free(thee->vmem, thee->nResHash, sizeof(int),
+          (void **)&(thee->resHash));
+    }
+    if (thee->nAtomHash > 0) {
+        Vmem_free(thee->vmem, 2*thee->nAtomHash, sizeof(int),
+          (void **)&(thee->atomHash));
+    }
+    thee->nResHash = 0;
+    thee->resHash = VNULL;
+    thee->nAtomHash = 0;
+    thee->atomHash = VNULL;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vparam_buildIndex
+//
+// Purpose:  Hash every residue name to its first residue, and every atom
+//           name of those residues to its first atom, so that lookups
+//           return what the old front-to-back scans returned.  Tables are
+//           kept at most half full.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vparam_buildIndex(Vparam *thee) {
+
+    Vparam_ResData *res;
+    unsigned int slot, mask;
+    int i, ires, iatom, natoms, nslot;
+
+    Vparam_clearIndex(thee);
+    if (thee->nResData == 0) return 1;
+
+    natoms = 0;
+    for (ires=0; ires<thee->nResData; ires++) {
+        natoms += thee->resData[ires].nAtomData;
+    }
+
+    /* Residues; a repeated name keeps pointing at its first residue */
+    for (nslot=2; nslot<2*thee->nResData; nslot*=2);
+    thee->resHash = (int*)Vmem_malloc(thee->vmem, nslot, sizeof(int));
+    if (thee->resHash == VNULL) return 0;
+    thee->nResHash = nslot;
+    for (i=0; i<nslot; i++) thee->resHash[i] = -1;
+    mask = (unsigned int)(nslot - 1);
+    for (ires=0; ires<thee->nResData; ires++) {
+        if (Vparam_findRes(thee, thee->resData[ires].name) >= 0) continue;
+        slot = Vparam_hashName(thee->resData[ires].name, 0) & mask;
+        while (thee->resHash[slot] >= 0) slot = (slot + 1) & mask;
+        thee->resHash[slot] = ires;
+    }
+
+    /* Atoms of the residues a lookup can reach */
+    for (nslot=2; nslot<2*natoms; nslot*=2);
+    thee->atomHash = (int*)Vmem_malloc(thee->vmem, 2*nslot, sizeof(int));
+    if (thee->atomHash == VNULL) {
+        Vparam_clearIndex(thee);
+        return 0;
+    }
+    thee->nAtomHash = nslot;
+    for (i=0; i<2*nslot; i++) thee->atomHash[i] = -1;
+    mask = (unsigned int)(nslot - 1);
+    for (ires=0; ires<thee->nResData; ires++) {
+        res = &(thee->resData[ires]);
+        if (Vparam_findRes(thee, res->name) != ires) continue;
+        for (iatom=0; iatom<res->nAtomData; iatom++) {
+            if (Vparam_findAtom(thee, ires, res->atomData[iatom].atomName)
+              >= 0) continue;
+            slot = Vparam_hashName(res->atomData[iatom].atomName,
+              (unsigned int)ires*2654435761u) & mask;
+            while (thee->atomHash[2*slot] >= 0) slot = (slot + 1) & mask;
+            thee->atomHash[2*slot] = ires;
+            thee->atomHash[2*slot+1] = iatom;
+        }
+    }
+
+    return 1;
+}
+
 VPUBLIC Vparam_ResData* Vparam_getResData(Vparam *thee,
   char resName[VMAX_ARGLEN]) {
 
-    int i;
-    Vparam_ResData *res = VNULL;
+    int ires;
 
     VASSERT(thee != VNULL);
 
     if ((thee->nResData == 0) || (thee->resData == VNULL)) {
-        res = VNULL;
-        return res;
+        return VNULL;
     }
 
     /* Look for the matching residue */
-    for (i=0; i<thee->nResData; i++) {
-        res = &(thee->resData[i]);
-        if (Vstring_strcasecmp(resName, res->name) == 0) return res;
-
-    }
+    ires = Vparam_findRes(thee, resName);
+    if (ires >= 0) return &(thee->resData[ires]);
 
     /* Didn't find a matching residue */
-    res = VNULL;
     Vnm_print(2, "Vparam_getResData:  unable to find res=%s\n", resName);
-    return res;
+    return VNULL;
 }
 
 VPUBLIC Vparam_AtomData* Vparam_getAtomData(Vparam *thee,
   char resName[VMAX_ARGLEN], char atomName[VMAX_ARGLEN]) {
 
-    int i;
+    int iatom;
     Vparam_ResData *res = VNULL;
-    Vparam_AtomData *atom = VNULL;
 
     VASSERT(thee != VNULL);
 
     if ((thee->nResData == 0) || (thee->resData == VNULL)) {
-        atom = VNULL;
-        return atom;
+        return VNULL;
     }
 
     /* Look for the matching residue */
     res = Vparam_getResData(thee, resName);
     if (res == VNULL) {
-        atom = VNULL;
         Vnm_print(2, "Vparam_getAtomData:  Unable to find residue %s!\n", resName);
-        return atom;
-    }
-    for (i=0; i<res->nAtomData; i++) {
-        atom = &(res->atomData[i]);
-        if (atom == VNULL) {
-            Vnm_print(2, "Vparam_getAtomData:  got NULL atom!\n");
-            return VNULL;
-        }
-        if (Vstring_strcasecmp(atomName, atom->atomName) == 0) {
-            return atom;
-        }
+        return VNULL;
     }
+    iatom = Vparam_findAtom(thee, (int)(res - thee->resData), atomName);
+    if (iatom >= 0) return &(res->atomData[iatom]);
 
     /* Didn't find a matching atom/residue */
-    atom = VNULL;
     Vnm_print(2, "Vparam_getAtomData:  unable to find atom '%s', res '%s'\n",
       atomName, resName);
-    return atom;
+    return VNULL;
 }
 
 VPUBLIC int Vparam_readXMLFile(Vparam *thee, const char *iodev,
@@ -336,6 +507,7 @@ VPUBLIC int Vparam_readXMLFile(Vparam *thee, const char *iodev,
     Vio_setCommChars(sock, MCcommChars);
 
     /* Clear existing parameters */
+    Vparam_clearIndex(thee);
     if (thee->nResData > 0) {
         Vnm_print(2, "WARNING -- CLEARING PARAMETER DATABASE!\n");
         for (i=0; i<thee->nResData; i++) {
@@ -434,6 +606,12 @@ VPUBLIC int Vparam_readXMLFile(Vparam *thee, const char *iodev,
     Vio_acceptFree(sock);
     Vio_dtor(&sock);
 
+    /* Index the residue and atom names for Vparam_getAtomData */
+    if (!Vparam_buildIndex(thee)) {
+        Vnm_print(2, "Vparam_readXMLFile: Unable to index parameters!\n");
+        return 0;
+    }
+
     return 1;
 
 VERROR1:
@@ -471,6 +649,7 @@ VPUBLIC int Vparam_readFlatFile(Vparam *thee, const char *iodev,
     Vio_setCommChars(sock, MCcommChars);
 
     /* Clear existing parameters */
+    Vparam_clearIndex(thee);
     if (thee->nResData > 0) {
         Vnm_print(2, "WARNING -- CLEARING PARAMETER DATABASE!\n");
         for (i=0; i<thee->nResData; i++) {
@@ -564,6 +743,12 @@ VPUBLIC int Vparam_readFlatFile(Vparam *thee, const char *iodev,
     /* Destroy temporary atom space */
     Vmem_free(thee->vmem, nalloc, sizeof(Vparam_AtomData), (void **)&(atoms));
 
+    /* Index the residue and atom names for Vparam_getAtomData */
+    if (!Vparam_buildIndex(thee)) {
+        Vnm_print(2, "Vparam_readFlatFile: Unable to index parameters!\n");
+        return 0;
+    }
+
     return 1;
 
 }
@@ -138,6 +138,15 @@ struct Vparam {
   int nResData;  /**< Number of Vparam_ResData objects associated with
                   * this object */
   Vparam_ResData *resData;  /**< Array of nResData Vparam_ResData objects */
+  int nResHash;  /**< Number of slots in resHash (a power of 2, or 0 when
+                  * there is no index) */
+  int *resHash;  /**< Case-insensitive open-addressed hash of residue names;
+                  * each slot holds the index of the first residue with that
+                  * name, or -1 */
+  int nAtomHash;  /**< Number of slots in atomHash (a power of 2, or 0) */
+  int *atomHash;  /**< Case-insensitive open-addressed hash of (residue
+                   * index, atom name) pairs; each slot holds the residue and
+                   * atom indices, or -1 and -1 */
 };
 
 /** @typedef Vparam
@@ -299,7 +308,10 @@ VEXTERNC Vparam_ResData* Vparam_getResData(Vparam *thee,
  *  @returns  Pointer to the desired atom object or VNULL if residue not
  *  found
  *  @note  Some method to initialize the database must be called before this
- *  method (e.g., @see Vparam_readFlatFile)
+ *  method (e.g., @see Vparam_readFlatFile).  The readers build a
+ *  case-insensitive hash index over residue and atom names, so the lookup
+ *  takes constant time; as before, the first residue with a matching name
+ *  is searched.
  */
 VEXTERNC Vparam_AtomData* Vparam_getAtomData(Vparam *thee,
   char resName[VMAX_ARGLEN], char atomName[VMAX_ARGLEN]);
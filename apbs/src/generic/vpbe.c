@@ -243,58 +243,19 @@ VPUBLIC double Vpbe_getmemv(Vpbe *thee) {
 // Class Vpbe: Non-inlineable methods
 /////////////////////////////////////////////////////////////////////////// */
 
-VPUBLIC Vpbe* Vpbe_ctor(Valist *alist, int ionNum, double *ionConc,
-                        double *ionRadii, double *ionQ, double T,
-                        double soluteDiel, double solventDiel,
-                        double solventRadius, int focusFlag, double sdens,
-                        double z_mem, double L, double membraneDiel, double V ) {
-
-    /* Set up the structure */
-    Vpbe *thee = VNULL;
-    thee = (Vpbe*)Vmem_malloc(VNULL, 1, sizeof(Vpbe) );
-    VASSERT( thee != VNULL);
-    VASSERT( Vpbe_ctor2(thee, alist, ionNum, ionConc, ionRadii, ionQ,
-                        T, soluteDiel, solventDiel, solventRadius, focusFlag, sdens,
-                        z_mem, L, membraneDiel, V) );
-
-    return thee;
-}
-
-
-VPUBLIC int Vpbe_ctor2(Vpbe *thee, Valist *alist, int ionNum,
-                       double *ionConc, double *ionRadii,
-                       double *ionQ, double T, double soluteDiel,
-                       double solventDiel, double solventRadius, int focusFlag,
-                       double sdens, double z_mem, double L, double membraneDiel,
-                       double V) {
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vpbe_setSolute
+//
+// Purpose:  Compute the solute center, extent and charge from the atom list
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void Vpbe_setSolute(Vpbe *thee) {
 
-    int i, iatom, inhash[3];
+    int iatom;
     double atomRadius;
     Vatom *atom;
     double center[3] = {0.0, 0.0, 0.0};
-    double lower_corner[3] = {0.0, 0.0, 0.0};
-    double upper_corner[3] = {0.0, 0.0, 0.0};
     double disp[3], dist, radius, charge, xmin, xmax, ymin, ymax, zmin, zmax;
-    double x, y, z, netCharge;
-    double nhash[3];
-    const double N_A = 6.022045000e+23;
-    const double e_c = 4.803242384e-10;
-    const double k_B = 1.380662000e-16;
-    const double pi  = 4. * VATAN(1.);
-
-    /* Set up memory management object */
-    thee->vmem = Vmem_ctor("APBS::VPBE");
-
-    VASSERT(thee != VNULL);
-    if (alist == VNULL) {
-        Vnm_print(2, "Vpbe_ctor2: Got null pointer to Valist object!\n");
-        return 0;
-    }
-
-    /* **** STUFF THAT GETS DONE FOR EVERYONE **** */
-    /* Set pointers */
-    thee->alist = alist;
-    thee->paramFlag = 0;
+    double x, y, z;
 
     /* Determine solute center */
     center[0] = thee->alist->center[0];
@@ -343,6 +304,98 @@ VPUBLIC int Vpbe_ctor2(Vpbe *thee, Valist *alist, int ionNum,
             thee->soluteXlen, thee->soluteYlen, thee->soluteZlen);
     thee->soluteCharge = charge;
     Vnm_print(0, "Vpbe_ctor2:  solute charge = %g\n", charge);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vpbe_setAccess
+//
+// Purpose:  Build the cell list and accessibility objects for the solute
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vpbe_setAccess(Vpbe *thee, double sdens) {
+
+    int i, inhash[3];
+    double lower_corner[3] = {0.0, 0.0, 0.0};
+    double upper_corner[3] = {0.0, 0.0, 0.0};
+    double radius, nhash[3];
+
+    /* Compute accessibility objects:
+     *   - Allow for extra room in the case of spline windowing
+     *   - Place some limits on the size of the hash table in the case of very
+     *     large molecules
+     */
+    if (thee->maxIonRadius > thee->solventRadius)
+        radius = thee->maxIonRadius + MAX_SPLINE_WINDOW;
+    else radius = thee->solventRadius + MAX_SPLINE_WINDOW;
+
+    nhash[0] = (thee->soluteXlen)/0.5;
+    nhash[1] = (thee->soluteYlen)/0.5;
+    nhash[2] = (thee->soluteZlen)/0.5;
+    for (i=0; i<3; i++) inhash[i] = (int)(nhash[i]);
+
+    for (i=0;i<3;i++){
+        if (inhash[i] < 3) inhash[i] = 3;
+        if (inhash[i] > MAX_HASH_DIM) inhash[i] = MAX_HASH_DIM;
+    }
+    Vnm_print(0, "Vpbe_ctor2:  Constructing Vclist with %d x %d x %d table\n",
+            inhash[0], inhash[1], inhash[2]);
+
+    thee->clist = Vclist_ctor(thee->alist, radius, inhash,
+            CLIST_AUTO_DOMAIN, lower_corner, upper_corner);
+
+    if (thee->clist == VNULL) return 0;
+    thee->acc = Vacc_ctor(thee->alist, thee->clist, sdens);
+    if (thee->acc == VNULL) return 0;
+
+    return 1;
+}
+
+VPUBLIC Vpbe* Vpbe_ctor(Valist *alist, int ionNum, double *ionConc,
+                        double *ionRadii, double *ionQ, double T,
+                        double soluteDiel, double solventDiel,
+                        double solventRadius, int focusFlag, double sdens,
+                        double z_mem, double L, double membraneDiel, double V ) {
+
+    /* Set up the structure */
+    Vpbe *thee = VNULL;
+    thee = (Vpbe*)Vmem_malloc(VNULL, 1, sizeof(Vpbe) );
+    VASSERT( thee != VNULL);
+    VASSERT( Vpbe_ctor2(thee, alist, ionNum, ionConc, ionRadii, ionQ,
+                        T, soluteDiel, solventDiel, solventRadius, focusFlag, sdens,
+                        z_mem, L, membraneDiel, V) );
+
+    return thee;
+}
+
+
+VPUBLIC int Vpbe_ctor2(Vpbe *thee, Valist *alist, int ionNum,
+                       double *ionConc, double *ionRadii,
+                       double *ionQ, double T, double soluteDiel,
+                       double solventDiel, double solventRadius, int focusFlag,
+                       double sdens, double z_mem, double L, double membraneDiel,
+                       double V) {
+
+    int i;
+    double netCharge;
+    const double N_A = 6.022045000e+23;
+    const double e_c = 4.803242384e-10;
+    const double k_B = 1.380662000e-16;
+    const double pi  = 4. * VATAN(1.);
+
+    /* Set up memory management object */
+    thee->vmem = Vmem_ctor("APBS::VPBE");
+
+    VASSERT(thee != VNULL);
+    if (alist == VNULL) {
+        Vnm_print(2, "Vpbe_ctor2: Got null pointer to Valist object!\n");
+        return 0;
+    }
+
+    /* **** STUFF THAT GETS DONE FOR EVERYONE **** */
+    /* Set pointers */
+    thee->alist = alist;
+    thee->paramFlag = 0;
+
+    Vpbe_setSolute(thee);
 
     /* Set parameters */
     thee->numIon = ionNum;
@@ -411,34 +464,7 @@ function\n", thee->maxIonRadius);
     thee->zmagic  = ((4.0 * pi * e_c*e_c) / (k_B * thee->T)) * 1.0e+8;
     Vnm_print(0, "Vpbe_ctor2:  zmagic = %g\n", thee->zmagic);
 
-    /* Compute accessibility objects:
-     *   - Allow for extra room in the case of spline windowing
-     *   - Place some limits on the size of the hash table in the case of very
-     *     large molecules
-     */
-    if (thee->maxIonRadius > thee->solventRadius)
-        radius = thee->maxIonRadius + MAX_SPLINE_WINDOW;
-    else radius = thee->solventRadius + MAX_SPLINE_WINDOW;
-
-    nhash[0] = (thee->soluteXlen)/0.5;
-    nhash[1] = (thee->soluteYlen)/0.5;
-    nhash[2] = (thee->soluteZlen)/0.5;
-    for (i=0; i<3; i++) inhash[i] = (int)(nhash[i]);
-
-    for (i=0;i<3;i++){
-        if (inhash[i] < 3) inhash[i] = 3;
-        if (inhash[i] > MAX_HASH_DIM) inhash[i] = MAX_HASH_DIM;
-    }
-    Vnm_print(0, "Vpbe_ctor2:  Constructing Vclist with %d x %d x %d table\n",
-            inhash[0], inhash[1], inhash[2]);
-
-    thee->clist = Vclist_ctor(thee->alist, radius, inhash,
-            CLIST_AUTO_DOMAIN, lower_corner, upper_corner);
-
-    VASSERT(thee->clist != VNULL);
-    thee->acc = Vacc_ctor(thee->alist, thee->clist, sdens);
-
-    VASSERT(thee->acc != VNULL);
+    if (!Vpbe_setAccess(thee, sdens)) return 0;
 
     /* SMPBE Added */
     thee->smsize = 0.0;
@@ -478,46 +504,118 @@ VPUBLIC void Vpbe_dtor2(Vpbe *thee) {
     Vmem_dtor(&(thee->vmem));
 }
 
+VPUBLIC int Vpbe_updateAtoms(Vpbe *thee, double *oldpos) {
+
+    int iatom, i;
+    double sdens, *pos;
+    Vatom *atom;
+
+    VASSERT(thee != VNULL);
+
+    Vpbe_setSolute(thee);
+
+    /* Rebin the atoms that moved; an atom leaving the cell list table means
+     * the table has to be rebuilt around the new positions */
+    for (iatom=0; iatom<Valist_getNumberAtoms(thee->alist); iatom++) {
+        atom = Valist_getAtom(thee->alist, iatom);
+        pos = Vatom_getPosition(atom);
+        for (i=0; i<VAPBS_DIM; i++) {
+            if (pos[i] != oldpos[VAPBS_DIM*iatom+i]) break;
+        }
+        if (i == VAPBS_DIM) continue;
+        if (Vclist_moveAtom(thee->clist, atom, &(oldpos[VAPBS_DIM*iatom]))
+                == VRC_FAILURE) break;
+    }
+    if (iatom < Valist_getNumberAtoms(thee->alist)) {
+        Vnm_print(0, "Vpbe_updateAtoms:  rebuilding cell list for atom %d\n",
+                iatom);
+        sdens = thee->acc->surf_density;
+        Vacc_dtor(&(thee->acc));
+        Vclist_dtor(&(thee->clist));
+        return Vpbe_setAccess(thee, sdens);
+    }
+
+    Vacc_resetCache(thee->acc);
+
+    return 1;
+}
+
 VPUBLIC double Vpbe_getCoulombEnergy1(Vpbe *thee) {
 
-    int i, j, k, natoms;
+    double energy, error;
 
-    double dist, *ipos, *jpos, icharge, jcharge;
-    double energy = 0.0;
-    double eps, T;
-    Vatom *iatom, *jatom;
+    if (!Vpbe_getCoulombEnergyComps(thee, &energy, VNULL, &error)) {
+        Vnm_print(2, "Vpbe_getCoulombEnergy1:  Coulomb sum failed!\n");
+        return 0.0;
+    }
+    Vnm_print(0, "Vpbe_getCoulombEnergy1:  %g kT (error bound %g kT)\n",
+      energy, error);
+
+    return energy;
+}
+
+VPUBLIC int Vpbe_getCoulombEnergyComps(Vpbe *thee, double *energy,
+        double *atomEnergy, double *errBound) {
+
+    int i, natoms, rc;
+
+    double *pos, *x, *y, *z, *pot, *bound, charge;
+    double error = 0.0;
+    double eps, T, scale;
+    Vatom *atom;
     Valist *alist;
+    Vgreen *green;
 
     VASSERT(thee != VNULL);
     alist = Vpbe_getValist(thee);
     VASSERT(alist != VNULL);
     natoms = Valist_getNumberAtoms(alist);
-
-    /* Do the sum */
+    *energy = 0.0;
+    if (errBound != VNULL) *errBound = 0.0;
+    if (natoms == 0) return 1;
+
+    x = (double *)Vmem_malloc(thee->vmem, natoms, sizeof(double));
+    y = (double *)Vmem_malloc(thee->vmem, natoms, sizeof(double));
+    z = (double *)Vmem_malloc(thee->vmem, natoms, sizeof(double));
+    pot = (double *)Vmem_malloc(thee->vmem, natoms, sizeof(double));
+    bound = (double *)Vmem_malloc(thee->vmem, natoms, sizeof(double));
     for (i=0; i<natoms; i++) {
-        iatom = Valist_getAtom(alist,i);
-        icharge = Vatom_getCharge(iatom);
-        ipos = Vatom_getPosition(iatom);
-        for (j=i+1; j<natoms; j++) {
-            jatom = Valist_getAtom(alist,j);
-            jcharge = Vatom_getCharge(jatom);
-            jpos = Vatom_getPosition(jatom);
-            dist = 0;
-            for (k=0; k<3; k++) dist += ((ipos[k]-jpos[k])*(ipos[k]-jpos[k]));
-            dist = VSQRT(dist);
-            energy = energy + icharge*jcharge/dist;
-        }
+        atom = Valist_getAtom(alist, i);
+        pos = Vatom_getPosition(atom);
+        x[i] = pos[0];
+        y[i] = pos[1];
+        z[i] = pos[2];
     }
 
-    /* Convert the result to J */
-    T = Vpbe_getTemperature(thee);
-    eps = Vpbe_getSoluteDiel(thee);
-    energy = energy*Vunit_ec*Vunit_ec/(4*Vunit_pi*Vunit_eps0*eps*(1.0e-10));
+    /* Potential of all other charges at each atom (V) */
+    green = Vgreen_ctor(alist);
+    rc = Vgreen_coulombBound(green, natoms, x, y, z, pot, bound);
+    Vgreen_dtor(&green);
+    if (rc) {
+        /* Convert e*V to k_B T in the solute dielectric; each pair is
+         * counted once from each end */
+        T = Vpbe_getTemperature(thee);
+        eps = Vpbe_getSoluteDiel(thee);
+        scale = 0.5*Vunit_ec/(eps*Vunit_kb*T);
+        for (i=0; i<natoms; i++) {
+            charge = Vatom_getCharge(Valist_getAtom(alist, i));
+            pot[i] = scale*charge*pot[i];
+            if (atomEnergy != VNULL) atomEnergy[i] = pot[i];
+            *energy += pot[i];
+            error += scale*VABS(charge)*bound[i];
+        }
+        if (errBound != VNULL) *errBound = error;
+    } else {
+        Vnm_print(2, "Vpbe_getCoulombEnergyComps:  Coulomb sum failed!\n");
+    }
 
-    /* Scale by Boltzmann energy */
-    energy = energy/(Vunit_kb*T);
+    Vmem_free(thee->vmem, natoms, sizeof(double), (void **)&x);
+    Vmem_free(thee->vmem, natoms, sizeof(double), (void **)&y);
+    Vmem_free(thee->vmem, natoms, sizeof(double), (void **)&z);
+    Vmem_free(thee->vmem, natoms, sizeof(double), (void **)&pot);
+    Vmem_free(thee->vmem, natoms, sizeof(double), (void **)&bound);
 
-    return energy;
+    return rc;
 }
 
 VPUBLIC unsigned long int Vpbe_memChk(Vpbe *thee) {
@@ -75,6 +75,7 @@
 #include "generic/vatom.h"
 #include "generic/vacc.h"
 #include "generic/vclist.h"
+#include "generic/vgreen.h"
 
 /**
 *  @ingroup Vpbe
@@ -480,22 +481,57 @@ VEXTERNC void    Vpbe_dtor(Vpbe **thee);
 */
 VEXTERNC void    Vpbe_dtor2(Vpbe *thee);
 
+/** @brief  Bring the solute properties, cell list and accessibility object up
+*           to date after the atoms of the molecule have moved
+*
+*           Only the atoms whose position changed are rebinned in the cell
+*           list; the list is rebuilt if one of them left its table.  The
+*           ionic parameters are kept.
+*
+*  @ingroup Vpbe
+*  @param   thee   Vpbe object
+*  @param   oldpos Array of 3*natoms positions the atoms had when the cell
+*                  list was last updated
+*  @return  1 if successful, 0 otherwise
+*/
+VEXTERNC int     Vpbe_updateAtoms(Vpbe *thee, double *oldpos);
+
 /** @brief  Calculate coulombic energy of set of charges
 *
-*           Perform an inefficient double sum to calculate the Coulombic
-*           energy of a set of charges in a homogeneous dielectric (with
-                                                                    *           permittivity equal to the protein interior) and zero ionic
-*           strength.  Result is returned in units of k_B T.  The sum can be
-*           restriction to charges present in simplices of specified color
-*           (pcolor); if (color == -1) no restrictions are used.
+*           Calculate the Coulombic energy of a set of charges in a
+*           homogeneous dielectric (with permittivity equal to the protein
+*           interior) and zero ionic strength.  Result is returned in units
+*           of k_B T.  The pair sum is evaluated with the Vgreen treecode;
+*           see Vpbe_getCoulombEnergyComps.
 *
 *  @ingroup Vpbe
 *  @author  Nathan Baker
 *  @param   thee Vpbe object
-*  @return  Coulombic energy in units of \f$k_B T\f$.
+*  @return  Coulombic energy in units of \f$k_B T\f$ (0 if the sum failed)
 */
 VEXTERNC double  Vpbe_getCoulombEnergy1(Vpbe *thee);
 
+/** @brief  Calculate per-atom coulombic energies of set of charges
+*
+*           Same energy as Vpbe_getCoulombEnergy1, decomposed as
+*           \f$E_i = \frac{1}{2} q_i \phi_i\f$ where \f$\phi_i\f$ is the
+*           potential of all other charges at atom \f$i\f$.  Near-field
+*           pairs are summed directly within the octree leaf cells and
+*           distant cells are represented by multipole expansions; atoms are
+*           processed in parallel.
+*
+*  @ingroup Vpbe
+*  @param   thee Vpbe object
+*  @param   energy  Set to the Coulombic energy (units of \f$k_B T\f$)
+*  @param   atomEnergy  If not VNULL, set to the per-atom energies (one per
+*                       atom in the Valist, units of \f$k_B T\f$)
+*  @param   errBound  If not VNULL, set to a rigorous bound on the absolute
+*                     error of the total energy (units of \f$k_B T\f$)
+*  @return  1 if successful, 0 otherwise
+*/
+VEXTERNC int     Vpbe_getCoulombEnergyComps(Vpbe *thee, double *energy,
+        double *atomEnergy, double *errBound);
+
 /** @brief   Return the memory used by this structure (and its contents)
 *           in bytes
 *  @ingroup Vpbe
@@ -56,6 +56,14 @@
 
 #include "vstring.h"
 
+#ifdef HAVE_MMAP
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
 /* ///////////////////////////////////////////////////////////////////////////
 // Routine:  Vstring_strcasecmp
 //
@@ -235,3 +243,78 @@ char* Vstring_wrappedtext(const char* str, int right_margin, int left_padding)
 
     return wrap_str;
 }
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vstring_mapFile
+//
+// Purpose:  Map an entire file into memory.  The mapping is read-only, or
+//           private copy-on-write with writable so the caller may modify it
+//           without touching the file.  Without mmap the file is read into
+//           a heap buffer instead.
+//
+// Returns:  Pointer to the file contents or VNULL on failure
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC char *Vstring_mapFile(const char *fname, size_t *size, int writable) {
+
+#ifdef HAVE_MMAP
+    struct stat st;
+    void *map;
+    int fd;
+
+    fd = open(fname, O_RDONLY);
+    if (fd < 0) return VNULL;
+    if ((fstat(fd, &st) != 0) || (st.st_size <= 0)) {
+        close(fd);
+        return VNULL;
+    }
+    *size = (size_t)st.st_size;
+    map = mmap(VNULL, *size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+      MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return VNULL;
+#  ifdef MADV_SEQUENTIAL
+    if (!writable) madvise(map, *size, MADV_SEQUENTIAL);
+#  endif
+    return (char *)map;
+#else
+    FILE *fp;
+    char *buf;
+    long len;
+
+    fp = fopen(fname, "rb");
+    if (fp == VNULL) return VNULL;
+    if ((fseek(fp, 0, SEEK_END) != 0) || ((len = ftell(fp)) <= 0) ||
+      (fseek(fp, 0, SEEK_SET) != 0)) {
+        fclose(fp);
+        return VNULL;
+    }
+    buf = (char *)Vmem_malloc(VNULL, (size_t)len, sizeof(char));
+    if (buf == VNULL) {
+        fclose(fp);
+        return VNULL;
+    }
+    if (fread(buf, 1, (size_t)len, fp) != (size_t)len) {
+        Vmem_free(VNULL, (size_t)len, sizeof(char), (void **)&buf);
+        fclose(fp);
+        return VNULL;
+    }
+    fclose(fp);
+    *size = (size_t)len;
+    return buf;
+#endif
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vstring_unmapFile
+//
+// Purpose:  Release a buffer obtained from Vstring_mapFile
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC void Vstring_unmapFile(char *buf, size_t size) {
+
+    if (buf == VNULL) return;
+#ifdef HAVE_MMAP
+    munmap(buf, size);
+#else
+    Vmem_free(VNULL, size, sizeof(char), (void **)&buf);
+#endif
+}
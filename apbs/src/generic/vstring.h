@@ -117,4 +117,25 @@ VEXTERNC char* Vstring_wrappedtext(
         int left_padding  /**< The number of characters in the left indent  */
         );
 
+/** @brief   Map an entire file into memory
+ *  @ingroup Vstring
+ *  @note    The mapping is read-only, or private copy-on-write if writable
+ *           is set so the caller may modify the contents without touching
+ *           the file.  Without mmap the file is read into a heap buffer.
+ *           Release the buffer with Vstring_unmapFile.
+ *  @param   fname     File to map
+ *  @param   size      Set to the size of the file in bytes
+ *  @param   writable  Whether the caller may write to the buffer
+ *  @return  Pointer to the file contents or VNULL on failure (including an
+ *           empty file)
+ */
+VEXTERNC char* Vstring_mapFile(const char *fname, size_t *size, int writable);
+
+/** @brief   Release a buffer obtained from Vstring_mapFile
+ *  @ingroup Vstring
+ *  @param   buf   Buffer to release (VNULL is ignored)
+ *  @param   size  Size returned by Vstring_mapFile
+ */
+VEXTERNC void Vstring_unmapFile(char *buf, size_t size);
+
 #endif    /* ifndef _VSTRING_H_ */
@@ -69,8 +69,831 @@
 
 #include "routines.h"
 
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
 VEMBED(rcsid="$Id$")
 
+/**
+ * @brief  Release the per-atom force results of a calculation
+ * @ingroup  Frontend
+ */
+VPRIVATE void releaseResults(
+                             Vmem *mem,  /**< Memory manager */
+                             int icalc,  /**< Calculation index */
+                             int nforce[],  /**< Number of forces per calc */
+                             AtomForce *atomForce[]  /**< Forces per calc */
+                             ) {
+
+    if (nforce[icalc] > 0) {
+        Vmem_free(mem, nforce[icalc], sizeof(AtomForce),
+                  (void **)&(atomForce[icalc]));
+        nforce[icalc] = 0;
+    }
+}
+
+/**
+ * @brief  Run the pending PRINT statements whose calculations are done
+ * @ingroup  Frontend
+ * @note  Statements run in input order from *iprint, stopping at the first
+ *        one that needs a calculation after icalc.  Statements using a failed
+ *        calculation are skipped, and per-atom results are released after
+ *        the last statement that uses them.
+ * @returns Number of PRINT statements skipped
+ */
+VPRIVATE int runPrints(
+                       Vcom *com,  /**< Communications object */
+                       Vmem *mem,  /**< Memory manager */
+                       NOsh *nosh,  /**< Parsed input file */
+                       int icalc,  /**< Last calculation done */
+                       int *iprint,  /**< Next PRINT statement to run */
+                       int lastPrint[],  /**< Last PRINT using each calc */
+                       int calcFailed[],  /**< Failed calculations */
+                       double totEnergy[],  /**< Energies per calc */
+                       int nforce[],  /**< Number of forces per calc */
+                       AtomForce *atomForce[]  /**< Forces per calc */
+                       ) {
+
+    int i,
+        iarg,
+        jcalc,
+        failed,
+        nskip = 0,
+        header = 0;
+
+    while (*iprint < nosh->nprint) {
+        i = *iprint;
+        failed = 0;
+        for (iarg=0; iarg<nosh->printnarg[i]; iarg++) {
+            jcalc = NOsh_print2calc(nosh, i, iarg);
+            if (jcalc > icalc) return nskip;
+            if ((jcalc >= 0) && calcFailed[jcalc]) failed = jcalc+1;
+        }
+
+        if (!header) {
+            Vnm_tprint( 1, "----------------------------------------\n");
+            Vnm_tprint( 1, "PRINT STATEMENTS\n");
+            header = 1;
+        }
+        (*iprint)++;
+
+        if (failed) {
+            Vnm_tprint( 2, "Skipping PRINT statement #%d; calculation #%d \
+failed!\n", i+1, failed);
+            nskip++;
+        /* Print energy */
+        } else if (nosh->printwhat[i] == NPT_ENERGY) {
+            printEnergy(com, nosh, totEnergy, i);
+            /* Print force */
+        } else if (nosh->printwhat[i] == NPT_FORCE) {
+            printForce(com, nosh, nforce, atomForce, i);
+        } else if (nosh->printwhat[i] == NPT_ELECENERGY) {
+            printElecEnergy(com, nosh, totEnergy, i);
+        } else if (nosh->printwhat[i] == NPT_ELECFORCE) {
+            printElecForce(com, nosh, nforce, atomForce, i);
+        } else if (nosh->printwhat[i] == NPT_APOLENERGY) {
+            printApolEnergy(nosh, i);
+        } else if (nosh->printwhat[i] == NPT_APOLFORCE) {
+            printApolForce(com, nosh, nforce, atomForce, i);
+        } else {
+            Vnm_tprint( 2, "Undefined PRINT keyword!\n");
+            *iprint = nosh->nprint;
+            break;
+        }
+
+        for (iarg=0; iarg<nosh->printnarg[i]; iarg++) {
+            jcalc = NOsh_print2calc(nosh, i, iarg);
+            if ((jcalc >= 0) && (lastPrint[jcalc] == i)) {
+                releaseResults(mem, jcalc, nforce, atomForce);
+            }
+        }
+    }
+
+    return nskip;
+}
+
+/**
+ * @brief  Set up a multigrid calculation and print its parameters
+ * @ingroup  Frontend
+ * @note  Calculation icalc takes over (and releases) the objects that
+ *        calculation icalc-1 left in pbe, pmgp and pmg, so focusing chains
+ *        that run side by side each need tables of their own.
+ * @returns 1 if successful, 0 otherwise
+ */
+VPRIVATE int setupRunMG(
+                        NOsh *nosh,  /**< Parsed input file */
+                        int icalc,  /**< Calculation index */
+                        Vpbe *pbe[],  /**< PBE objects per calc */
+                        Valist *alist[],  /**< Molecules */
+                        Vgrid *dielXMap[],  /**< x-shifted dielectric maps */
+                        Vgrid *dielYMap[],  /**< y-shifted dielectric maps */
+                        Vgrid *dielZMap[],  /**< z-shifted dielectric maps */
+                        Vgrid *kappaMap[],  /**< Kappa maps */
+                        Vgrid *chargeMap[],  /**< Charge maps */
+                        Vgrid *potMap[],  /**< Potential maps */
+                        Vpmgp *pmgp[],  /**< Multigrid parameters per calc */
+                        Vpmg *pmg[]  /**< Multigrid objects per calc */
+                        ) {
+
+    int k;
+    double realCenter[3];
+    MGparm *mgparm = nosh->calc[icalc]->mgparm;
+    PBEparm *pbeparm = nosh->calc[icalc]->pbeparm;
+
+    /* What is this?  This seems like a very awkward way to find
+    the right ELEC statement... */
+    for (k=0; k<nosh->nelec; k++) {
+        if (nosh->elec2calc[k] >= icalc) {
+            break;
+        }
+    }
+    if (Vstring_strcasecmp(nosh->elecname[k], "") == 0) {
+        Vnm_tprint( 1, "CALCULATION #%d: MULTIGRID\n", icalc+1);
+    } else {
+        Vnm_tprint( 1, "CALCULATION #%d (%s): MULTIGRID\n",
+                    icalc+1, nosh->elecname[k]);
+    }
+
+    /* Set up problem */
+    Vnm_tprint( 1, "  Setting up problem...\n");
+
+    if (!initMG(icalc, nosh, mgparm, pbeparm, realCenter, pbe,
+                alist, dielXMap, dielYMap, dielZMap, kappaMap,
+                chargeMap, pmgp, pmg, potMap)) {
+        Vnm_tprint( 2, "Error setting up MG calculation!\n");
+        return 0;
+    }
+
+    /* Print problem parameters */
+    printMGPARM(mgparm, realCenter);
+    printPBEPARM(pbeparm);
+
+    return 1;
+}
+
+/**
+ * @brief  Compute the observables of a solved multigrid calculation and
+ *         write its outputs
+ * @ingroup  Frontend
+ * @returns 1 if successful, 0 otherwise
+ */
+VPRIVATE int finishRunMG(
+                         int rank,  /**< Processor rank */
+                         NOsh *nosh,  /**< Parsed input file */
+                         int icalc,  /**< Calculation index */
+                         Vmem *mem,  /**< Memory manager */
+                         Voutput_Format outputformat,  /**< Output format */
+                         Vpmg *pmg,  /**< Solved multigrid object */
+                         Valist *alist[],  /**< Molecules */
+                         int nenergy[],  /**< Number of atom energies */
+                         double totEnergy[],  /**< Energies per calc */
+                         double qfEnergy[],  /**< Fixed charge energies */
+                         double qmEnergy[],  /**< Mobile charge energies */
+                         double dielEnergy[],  /**< Polarization energies */
+                         double *atomEnergy[],  /**< Atom energies per calc */
+                         int nforce[],  /**< Number of forces per calc */
+                         AtomForce *atomForce[],  /**< Forces per calc */
+                         Vwriter *writer,  /**< Queue for WRITE outputs */
+                         int write  /**< Write WRITE and WRITEMAT outputs */
+                         ) {
+
+    MGparm *mgparm = nosh->calc[icalc]->mgparm;
+    PBEparm *pbeparm = nosh->calc[icalc]->pbeparm;
+
+    /* Set partition information for observables and I/O */
+    if (setPartMG(nosh, mgparm, pmg) != 1) {
+        Vnm_tprint(2, "Error setting partition info!\n");
+        return 0;
+    }
+
+    /* Write out energies */
+    energyMG(nosh, icalc, pmg,
+            &(nenergy[icalc]), &(totEnergy[icalc]), &(qfEnergy[icalc]),
+            &(qmEnergy[icalc]), &(dielEnergy[icalc]));
+
+    /* Write out forces */
+    forceMG(mem, nosh, pbeparm, mgparm, pmg, &(nforce[icalc]),
+            &(atomForce[icalc]), alist);
+
+    if (write) {
+        /* Write out data folks might want */
+        writedataMGAsync(rank, nosh, pbeparm, pmg, writer);
+
+        /* Write matrix */
+        writematMG(rank, nosh, pbeparm, pmg);
+    }
+
+    /* If needed, cache atom energies */
+    nenergy[icalc] = 0;
+    if ((pbeparm->calcenergy == PCE_COMPS) && (outputformat != OUTPUT_NULL)){
+        storeAtomEnergy(pmg, icalc, &(atomEnergy[icalc]), &(nenergy[icalc]));
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+
+    return 1;
+}
+
+/**
+ * @brief  Set up, solve and analyze a multigrid calculation
+ * @ingroup  Frontend
+ * @note  See setupRunMG for the objects the calculation takes over.  The
+ *        Vmem bookkeeping of maloc is not thread-safe, so setting up and
+ *        analyzing run in the apbs_vmem critical section, which guards every
+ *        Vmem allocation of concurrent calculations; only the solves, which
+ *        don't allocate, overlap, with each other and with the queued
+ *        writes (see Vwriter_open).
+ * @returns 1 if successful, 0 otherwise
+ */
+VPRIVATE int runMG(
+                   int rank,  /**< Processor rank */
+                   NOsh *nosh,  /**< Parsed input file */
+                   int icalc,  /**< Calculation index */
+                   Vmem *mem,  /**< Memory manager */
+                   Voutput_Format outputformat,  /**< Output file format */
+                   Vpbe *pbe[],  /**< PBE objects per calc */
+                   Valist *alist[],  /**< Molecules */
+                   Vgrid *dielXMap[],  /**< x-shifted dielectric maps */
+                   Vgrid *dielYMap[],  /**< y-shifted dielectric maps */
+                   Vgrid *dielZMap[],  /**< z-shifted dielectric maps */
+                   Vgrid *kappaMap[],  /**< Kappa maps */
+                   Vgrid *chargeMap[],  /**< Charge maps */
+                   Vgrid *potMap[],  /**< Potential maps */
+                   Vpmgp *pmgp[],  /**< Multigrid parameters per calc */
+                   Vpmg *pmg[],  /**< Multigrid objects per calc */
+                   int nenergy[],  /**< Number of atom energies per calc */
+                   double totEnergy[],  /**< Energies per calc */
+                   double qfEnergy[],  /**< Fixed charge energies per calc */
+                   double qmEnergy[],  /**< Mobile charge energies per calc */
+                   double dielEnergy[],  /**< Polarization energies per calc */
+                   double *atomEnergy[],  /**< Atom energies per calc */
+                   int nforce[],  /**< Number of forces per calc */
+                   AtomForce *atomForce[],  /**< Forces per calc */
+                   Vwriter *writer  /**< Queue for WRITE outputs */
+                   ) {
+
+    int rc;
+
+#pragma omp critical (apbs_vmem)
+    rc = setupRunMG(nosh, icalc, pbe, alist, dielXMap, dielYMap, dielZMap,
+                    kappaMap, chargeMap, potMap, pmgp, pmg);
+    if (!rc) return 0;
+
+    /* Solve PDE */
+    Vwriter_open(writer);
+    rc = solveMG(nosh, pmg[icalc], nosh->calc[icalc]->mgparm->type);
+    Vwriter_close(writer);
+    if (rc != 1) {
+        Vnm_tprint(2, "Error solving PDE!\n");
+        return 0;
+    }
+
+#pragma omp critical (apbs_vmem)
+    rc = finishRunMG(rank, nosh, icalc, mem, outputformat, pmg[icalc],
+                     alist, nenergy, totEnergy, qfEnergy, qmEnergy,
+                     dielEnergy, atomEnergy, nforce, atomForce, writer, 1);
+
+    return rc;
+}
+
+/**
+ * @brief  Group the independent multigrid calculations starting at a
+ *         calculation into focusing chains that can run side by side
+ * @ingroup  Frontend
+ * @note  A chain is a calculation and the levels that focus from it
+ *        (NOsh_focusParent); it holds at most two levels at a time.  Chains
+ *        are taken in input order until a calculation that is not multigrid
+ *        (or is a threaded mg-para one, see runParaMG) or until their
+ *        combined peak memory (NOsh_calcMemory) would exceed the budget; the
+ *        first chain is always taken.
+ * @returns Number of chains; chain k runs calculations head[k] to
+ *          head[k+1]-1
+ */
+VPRIVATE int planChains(
+                        NOsh *nosh,  /**< Parsed input file */
+                        int icalc,  /**< First calculation, not focused */
+                        double budget,  /**< Memory budget in bytes */
+                        int head[]  /**< Set to the chain starts (ncalc+1) */
+                        ) {
+
+    int i,
+        j,
+        nchain = 0;
+    double peak,
+           total = 0.0;
+
+    i = icalc;
+    while ((i < nosh->ncalc) && (nosh->calc[i]->calctype == NCT_MG) &&
+           !nosh->calc[i]->mgparm->threaded) {
+        peak = NOsh_calcMemory(nosh, i);
+        for (j=i+1; (j<nosh->ncalc) && (NOsh_focusParent(nosh, j) >= 0); j++) {
+            peak = VMAX2(peak,
+                         NOsh_calcMemory(nosh, j-1) + NOsh_calcMemory(nosh, j));
+        }
+        if ((nchain > 0) && (total + peak > budget)) break;
+        total += peak;
+        head[nchain++] = i;
+        i = j;
+    }
+    head[nchain] = i;
+
+    return nchain;
+}
+
+/**
+ * @brief  Run a focusing chain of multigrid calculations with object tables
+ *         of its own
+ * @ingroup  Frontend
+ * @note  A failed calculation is marked 1 in calcFailed and the rest of the
+ *        chain, which focuses from it, 2.  Everything the chain set up is
+ *        released before returning.
+ */
+VPRIVATE void runChainMG(
+                         int rank,  /**< Processor rank */
+                         NOsh *nosh,  /**< Parsed input file */
+                         int istart,  /**< First calculation of the chain */
+                         int iend,  /**< One past the last calculation */
+                         Vmem *mem,  /**< Memory manager */
+                         Voutput_Format outputformat,  /**< Output format */
+                         Valist *alist[],  /**< Molecules for this chain */
+                         Vgrid *dielXMap[],  /**< x-shifted dielectric maps */
+                         Vgrid *dielYMap[],  /**< y-shifted dielectric maps */
+                         Vgrid *dielZMap[],  /**< z-shifted dielectric maps */
+                         Vgrid *kappaMap[],  /**< Kappa maps */
+                         Vgrid *chargeMap[],  /**< Charge maps */
+                         Vgrid *potMap[],  /**< Potential maps */
+                         int nenergy[],  /**< Number of atom energies */
+                         double totEnergy[],  /**< Energies per calc */
+                         double qfEnergy[],  /**< Fixed charge energies */
+                         double qmEnergy[],  /**< Mobile charge energies */
+                         double dielEnergy[],  /**< Polarization energies */
+                         double *atomEnergy[],  /**< Atom energies per calc */
+                         int nforce[],  /**< Number of forces per calc */
+                         AtomForce *atomForce[],  /**< Forces per calc */
+                         Vwriter *writer,  /**< Queue for WRITE outputs */
+                         int calcFailed[]  /**< Failed calculations */
+                         ) {
+
+    int i,
+        rc,
+        ncalc = nosh->ncalc;
+    Vpbe **pbe = VNULL;
+    Vpmgp **pmgp = VNULL;
+    Vpmg **pmg = VNULL;
+
+#pragma omp critical (apbs_vmem)
+    {
+        pbe = (Vpbe **)Vmem_malloc(VNULL, ncalc, sizeof(Vpbe *));
+        pmgp = (Vpmgp **)Vmem_malloc(VNULL, ncalc, sizeof(Vpmgp *));
+        pmg = (Vpmg **)Vmem_malloc(VNULL, ncalc, sizeof(Vpmg *));
+    }
+    for (i=0; i<ncalc; i++) {
+        pbe[i] = VNULL;
+        pmgp[i] = VNULL;
+        pmg[i] = VNULL;
+    }
+
+    for (i=istart; i<iend; i++) {
+        Vnm_tprint( 1, "----------------------------------------\n");
+        rc = runMG(rank, nosh, i, mem, outputformat, pbe, alist, dielXMap,
+                   dielYMap, dielZMap, kappaMap, chargeMap, potMap, pmgp, pmg,
+                   nenergy, totEnergy, qfEnergy, qmEnergy, dielEnergy,
+                   atomEnergy, nforce, atomForce, writer);
+        /* A focused Vpmg destroys the one it focuses from */
+        if ((i > istart) && (pmg[i] != VNULL)) pmg[i-1] = VNULL;
+        if (!rc) {
+            calcFailed[i] = 1;
+            for (i++; i<iend; i++) calcFailed[i] = 2;
+            break;
+        }
+    }
+
+    /* Release the Vpmg objects before the Vpmgp ones (see killMG) */
+#pragma omp critical (apbs_vmem)
+    {
+        for (i=istart; i<iend; i++) Vpmg_dtor(&(pmg[i]));
+        for (i=istart; i<iend; i++) {
+            Vpmgp_dtor(&(pmgp[i]));
+            Vpbe_dtor(&(pbe[i]));
+        }
+        Vmem_free(VNULL, ncalc, sizeof(Vpbe *), (void **)&pbe);
+        Vmem_free(VNULL, ncalc, sizeof(Vpmgp *), (void **)&pmgp);
+        Vmem_free(VNULL, ncalc, sizeof(Vpmg *), (void **)&pmg);
+    }
+}
+
+/**
+ * @brief  Run independent focusing chains side by side
+ * @ingroup  Frontend
+ * @note  Up to nrun chains run at once, each with an equal share of the
+ *        OpenMP threads for its own loops.  Setting up a calculation marks
+ *        the atoms of its molecule (Vatom::partID), so a chain that shares a
+ *        molecule with an earlier chain of the stage works on a copy of it.
+ *        Chains allocate only in the apbs_vmem critical section (see runMG).
+ *        Console output of the chains interleaves.
+ */
+VPRIVATE void runChains(
+                        int rank,  /**< Processor rank */
+                        NOsh *nosh,  /**< Parsed input file */
+                        int nchain,  /**< Number of chains */
+                        int head[],  /**< Chain starts (see planChains) */
+                        int nrun,  /**< Chains to run at once */
+                        Vmem *mem,  /**< Memory manager */
+                        Voutput_Format outputformat,  /**< Output format */
+                        Valist *alist[],  /**< Molecules */
+                        Vgrid *dielXMap[],  /**< x-shifted dielectric maps */
+                        Vgrid *dielYMap[],  /**< y-shifted dielectric maps */
+                        Vgrid *dielZMap[],  /**< z-shifted dielectric maps */
+                        Vgrid *kappaMap[],  /**< Kappa maps */
+                        Vgrid *chargeMap[],  /**< Charge maps */
+                        Vgrid *potMap[],  /**< Potential maps */
+                        int nenergy[],  /**< Number of atom energies */
+                        double totEnergy[],  /**< Energies per calc */
+                        double qfEnergy[],  /**< Fixed charge energies */
+                        double qmEnergy[],  /**< Mobile charge energies */
+                        double dielEnergy[],  /**< Polarization energies */
+                        double *atomEnergy[],  /**< Atom energies per calc */
+                        int nforce[],  /**< Number of forces per calc */
+                        AtomForce *atomForce[],  /**< Forces per calc */
+                        Vwriter *writer,  /**< Queue for WRITE outputs */
+                        int calcFailed[]  /**< Failed calculations */
+                        ) {
+
+    int i,
+        j,
+        k,
+        imol,
+        nmol = VMAX2(nosh->nmol, 1),
+        nthreads = 1,
+        nlevels = 1;
+    Valist ***chainlist = VNULL;
+
+    /* Give each chain its own view of the molecules */
+    chainlist = (Valist ***)Vmem_malloc(VNULL, nchain, sizeof(Valist **));
+    for (k=0; k<nchain; k++) {
+        chainlist[k] = (Valist **)Vmem_malloc(VNULL, nmol, sizeof(Valist *));
+        for (imol=0; imol<nmol; imol++) chainlist[k][imol] = alist[imol];
+        for (i=head[k]; i<head[k+1]; i++) {
+            imol = nosh->calc[i]->pbeparm->molid - 1;
+            if ((imol < 0) || (imol >= nosh->nmol)) continue;
+            if (chainlist[k][imol] != alist[imol]) continue;
+            for (j=head[0]; j<head[k]; j++) {
+                if (nosh->calc[j]->pbeparm->molid - 1 == imol) break;
+            }
+            if (j == head[k]) continue;
+            chainlist[k][imol] = Valist_clone(alist[imol]);
+            if (chainlist[k][imol] == VNULL) {
+                chainlist[k][imol] = alist[imol];
+                Vnm_tprint(2, "Error copying molecule %d for calculation \
+#%d!\n", imol+1, head[k]+1);
+                for (j=head[k]; j<head[k+1]; j++) {
+                    calcFailed[j] = (j == head[k]) ? 1 : 2;
+                }
+                break;
+            }
+        }
+    }
+
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+    nlevels = omp_get_max_active_levels();
+    omp_set_max_active_levels(2);
+#endif
+    nrun = VMIN2(nrun, nchain);
+
+    /* The chains use Vmem only in the apbs_vmem critical section */
+    Vwriter_open(writer);
+#pragma omp parallel for default(shared) private(k) schedule(dynamic, 1) \
+    num_threads(nrun)
+    for (k=0; k<nchain; k++) {
+#ifdef _OPENMP
+        omp_set_num_threads(VMAX2(nthreads/nrun, 1));
+#endif
+        if (calcFailed[head[k]]) continue;
+        runChainMG(rank, nosh, head[k], head[k+1], mem, outputformat,
+                   chainlist[k], dielXMap, dielYMap, dielZMap, kappaMap,
+                   chargeMap, potMap, nenergy, totEnergy, qfEnergy, qmEnergy,
+                   dielEnergy, atomEnergy, nforce, atomForce, writer,
+                   calcFailed);
+    }
+    Vwriter_close(writer);
+
+#ifdef _OPENMP
+    omp_set_max_active_levels(nlevels);
+#endif
+
+    for (k=0; k<nchain; k++) {
+        for (imol=0; imol<nmol; imol++) {
+            if (chainlist[k][imol] != alist[imol]) {
+                Valist_dtor(&(chainlist[k][imol]));
+            }
+        }
+        Vmem_free(VNULL, nmol, sizeof(Valist *), (void **)&(chainlist[k]));
+    }
+    Vmem_free(VNULL, nchain, sizeof(Valist **), (void **)&chainlist);
+}
+
+/**
+ * @brief  Run the partitions of a threaded parallel focusing calculation
+ *         side by side
+ * @ingroup  Frontend
+ * @note  Calculation istart is the coarsest level the partitions share; it
+ *        is solved once with the calling tables and pinned until the first
+ *        level of every partition has focused from it.  Each partition then
+ *        runs its own levels with tables of its own.  Setting up a level and
+ *        computing its observables mark the atoms of the shared molecule
+ *        (Vatom::partID) and the pinned level, so they run in the
+ *        apbs_vmem critical section (see runMG) and only the solves of the
+ *        partitions overlap.  The finest levels are written as merged maps
+ *        and their energies and forces are summed into calculation iend-1,
+ *        as Vcom_reduce does for partitions in separate processes.  With
+ *        MGparm::halo, the finest levels first exchange boundary values
+ *        (Vpmg_exchangeBound) and are solved again until they agree.  Failed
+ *        calculations are marked as in runChainMG.
+ */
+VPRIVATE void runParaMG(
+                        int rank,  /**< Processor rank */
+                        NOsh *nosh,  /**< Parsed input file */
+                        int istart,  /**< Shared coarsest level */
+                        int iend,  /**< One past the last partition level */
+                        int nrun,  /**< Partitions to run at once */
+                        Vmem *mem,  /**< Memory manager */
+                        Voutput_Format outputformat,  /**< Output format */
+                        Vpbe *pbe[],  /**< PBE objects per calc */
+                        Valist *alist[],  /**< Molecules */
+                        Vgrid *dielXMap[],  /**< x-shifted dielectric maps */
+                        Vgrid *dielYMap[],  /**< y-shifted dielectric maps */
+                        Vgrid *dielZMap[],  /**< z-shifted dielectric maps */
+                        Vgrid *kappaMap[],  /**< Kappa maps */
+                        Vgrid *chargeMap[],  /**< Charge maps */
+                        Vgrid *potMap[],  /**< Potential maps */
+                        Vpmgp *pmgp[],  /**< Multigrid parameters per calc */
+                        Vpmg *pmg[],  /**< Multigrid objects per calc */
+                        int nenergy[],  /**< Number of atom energies */
+                        double totEnergy[],  /**< Energies per calc */
+                        double qfEnergy[],  /**< Fixed charge energies */
+                        double qmEnergy[],  /**< Mobile charge energies */
+                        double dielEnergy[],  /**< Polarization energies */
+                        double *atomEnergy[],  /**< Atom energies per calc */
+                        int nforce[],  /**< Number of forces per calc */
+                        AtomForce *atomForce[],  /**< Forces per calc */
+                        Vwriter *writer,  /**< Queue for WRITE outputs */
+                        int calcFailed[]  /**< Failed calculations */
+                        ) {
+
+    int i,
+        j,
+        k,
+        ip,
+        rc,
+        isweep,
+        halo = nosh->calc[iend-1]->mgparm->halo,
+        nfocus = 0,
+        nfail = 0,
+        npart = 0,
+        ncalc = nosh->ncalc,
+        nthreads = 1,
+        nlevels = 1,
+        *head = VNULL;
+    Vpbe ***ppbe = VNULL;
+    Vpmgp ***ppmgp = VNULL;
+    Vpmg ***ppmg = VNULL;
+    Vpmg **finest = VNULL;
+    double change,
+           dchange;
+    PBEparm *pbeparm = nosh->calc[iend-1]->pbeparm;
+
+    Vnm_tprint( 1, "----------------------------------------\n");
+    if (!runMG(rank, nosh, istart, mem, outputformat, pbe, alist, dielXMap,
+               dielYMap, dielZMap, kappaMap, chargeMap, potMap, pmgp, pmg,
+               nenergy, totEnergy, qfEnergy, qmEnergy, dielEnergy,
+               atomEnergy, nforce, atomForce, writer)) {
+        calcFailed[istart] = 1;
+        for (i=istart+1; i<iend; i++) calcFailed[i] = 2;
+        return;
+    }
+    pmg[istart]->pinned = 1;
+
+    /* Partition ip runs calculations head[ip] to head[ip+1]-1 */
+    head = (int *)Vmem_malloc(VNULL, iend-istart+1, sizeof(int));
+    for (i=istart+1; i<iend; i++) {
+        if ((i == istart+1) || (nosh->calc[i]->mgparm->ipart !=
+                                nosh->calc[i-1]->mgparm->ipart)) {
+            head[npart++] = i;
+        }
+    }
+    head[npart] = iend;
+
+    ppbe = (Vpbe ***)Vmem_malloc(VNULL, npart, sizeof(Vpbe **));
+    ppmgp = (Vpmgp ***)Vmem_malloc(VNULL, npart, sizeof(Vpmgp **));
+    ppmg = (Vpmg ***)Vmem_malloc(VNULL, npart, sizeof(Vpmg **));
+    finest = (Vpmg **)Vmem_malloc(VNULL, npart, sizeof(Vpmg *));
+    for (ip=0; ip<npart; ip++) {
+        ppbe[ip] = (Vpbe **)Vmem_malloc(VNULL, ncalc, sizeof(Vpbe *));
+        ppmgp[ip] = (Vpmgp **)Vmem_malloc(VNULL, ncalc, sizeof(Vpmgp *));
+        ppmg[ip] = (Vpmg **)Vmem_malloc(VNULL, ncalc, sizeof(Vpmg *));
+        for (i=0; i<ncalc; i++) {
+            ppbe[ip][i] = VNULL;
+            ppmgp[ip][i] = VNULL;
+            ppmg[ip][i] = VNULL;
+        }
+        /* The first level focuses from the shared one, whose parameter and
+         * PBE objects stay with the calling tables */
+        ppmg[ip][head[ip]-1] = pmg[istart];
+        finest[ip] = VNULL;
+    }
+
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+    nlevels = omp_get_max_active_levels();
+    omp_set_max_active_levels(2);
+#endif
+    nrun = VMAX2(VMIN2(nrun, npart), 1);
+
+    /* The partitions use Vmem only in the apbs_vmem critical section */
+    Vwriter_open(writer);
+#pragma omp parallel for default(shared) private(ip, i, j, rc) \
+    schedule(dynamic, 1) num_threads(nrun)
+    for (ip=0; ip<npart; ip++) {
+#ifdef _OPENMP
+        omp_set_num_threads(VMAX2(nthreads/nrun, 1));
+#endif
+        for (i=head[ip]; i<head[ip+1]; i++) {
+#pragma omp critical (apbs_vmem)
+            {
+                Vnm_tprint( 1, "----------------------------------------\n");
+                rc = setupRunMG(nosh, i, ppbe[ip], alist, dielXMap, dielYMap,
+                                dielZMap, kappaMap, chargeMap, potMap,
+                                ppmgp[ip], ppmg[ip]);
+                /* A focused Vpmg destroys the one it focuses from, except
+                 * for the shared level, which goes once every partition has
+                 * focused from it */
+                if (i == head[ip]) {
+                    ppmg[ip][i-1] = VNULL;
+                    if (++nfocus == npart) {
+                        pmg[istart]->pinned = 0;
+                        Vpmg_dtor(&(pmg[istart]));
+                        Vpmgp_dtor(&(pmgp[istart]));
+                        Vpbe_dtor(&(pbe[istart]));
+                    }
+                } else if (ppmg[ip][i] != VNULL) {
+                    ppmg[ip][i-1] = VNULL;
+                }
+            }
+
+            if (rc && (solveMG(nosh, ppmg[ip][i],
+                               nosh->calc[i]->mgparm->type) != 1)) {
+                Vnm_tprint(2, "Error solving PDE!\n");
+                rc = 0;
+            }
+
+            /* With halo exchanges the finest levels are finished once
+             * they agree with each other */
+            if (rc && ((halo == 0) || (i < head[ip+1]-1))) {
+#pragma omp critical (apbs_vmem)
+                rc = finishRunMG(rank, nosh, i, mem, outputformat,
+                                 ppmg[ip][i], alist, nenergy, totEnergy,
+                                 qfEnergy, qmEnergy, dielEnergy, atomEnergy,
+                                 nforce, atomForce, writer, 0);
+            }
+
+            if (!rc) {
+                calcFailed[i] = 1;
+                for (j=i+1; j<head[ip+1]; j++) calcFailed[j] = 2;
+#pragma omp atomic
+                nfail++;
+                break;
+            }
+        }
+        if (calcFailed[head[ip+1]-1] == 0) finest[ip] = ppmg[ip][head[ip+1]-1];
+    }
+    Vwriter_close(writer);
+
+    /* Additive Schwarz sweeps: every finest level takes the boundary values
+     * it shares with its neighbours from their solutions and is solved
+     * again, until the boundaries stop changing.  There is no coarse-grid
+     * correction; the outer boundary keeps its focused values. */
+    for (isweep=1; (nfail == 0) && (isweep<=halo); isweep++) {
+        change = 0.0;
+        for (ip=0; ip<npart; ip++) {
+            dchange = Vpmg_exchangeBound(finest[ip], npart, finest);
+            change = VMAX2(change, dchange);
+        }
+        Vnm_tprint( 1, "  Halo exchange %d:  largest boundary change = \
+%1.3E\n", isweep, change);
+        if (change <= finest[0]->pmgp->errtol) break;
+        Vwriter_open(writer);
+#pragma omp parallel for default(shared) private(ip, i, j) \
+    schedule(dynamic, 1) num_threads(nrun)
+        for (ip=0; ip<npart; ip++) {
+#ifdef _OPENMP
+            omp_set_num_threads(VMAX2(nthreads/nrun, 1));
+#endif
+            i = head[ip+1]-1;
+            if (solveMG(nosh, finest[ip], nosh->calc[i]->mgparm->type) != 1) {
+                Vnm_tprint(2, "Error solving PDE!\n");
+                calcFailed[i] = 1;
+#pragma omp atomic
+                nfail++;
+            }
+        }
+        Vwriter_close(writer);
+    }
+    if ((nfail == 0) && (halo > 0)) {
+        if (isweep > halo) {
+            Vnm_tprint(2, "  Partition boundaries still changing after %d \
+halo exchanges!\n", halo);
+        }
+        for (ip=0; ip<npart; ip++) {
+            Vnm_tprint( 1, "----------------------------------------\n");
+            i = head[ip+1]-1;
+            Vnm_tprint( 1, "CALCULATION #%d: PARTITION %d OF %d\n", i+1, ip,
+                        npart);
+            if (!finishRunMG(rank, nosh, i, mem, outputformat, finest[ip],
+                             alist, nenergy, totEnergy, qfEnergy, qmEnergy,
+                             dielEnergy, atomEnergy, nforce, atomForce,
+                             writer, 0)) {
+                calcFailed[i] = 1;
+                nfail++;
+            }
+        }
+    }
+
+#ifdef _OPENMP
+    omp_set_max_active_levels(nlevels);
+#endif
+
+    /* The results of the partitions add up to those of the calculation; a
+     * failed partition fails it */
+    if (nfail > 0) {
+        calcFailed[iend-1] = 1;
+    } else {
+        Vnm_tprint( 1, "----------------------------------------\n");
+        Vnm_tprint( 1, "CALCULATION #%d-#%d: %d PARTITIONS\n", istart+1, iend,
+                    npart);
+        if (pbeparm->writemat == 1) {
+            Vnm_tprint(2, "  Operator matrices of threaded partitions aren't \
+written!\n");
+        }
+        if (!writedataMGPart(rank, nosh, pbeparm, npart, finest, writer)) {
+            Vnm_tprint(2, "  Error writing merged partition data!\n");
+        }
+        for (ip=0; ip<npart-1; ip++) {
+            i = head[ip+1]-1;
+            totEnergy[iend-1] += totEnergy[i];
+            qfEnergy[iend-1] += qfEnergy[i];
+            qmEnergy[iend-1] += qmEnergy[i];
+            dielEnergy[iend-1] += dielEnergy[i];
+            if (nforce[i] == nforce[iend-1]) {
+                for (j=0; j<nforce[i]; j++) {
+                    for (k=0; k<3; k++) {
+                        atomForce[iend-1][j].qfForce[k] +=
+                            atomForce[i][j].qfForce[k];
+                        atomForce[iend-1][j].ibForce[k] +=
+                            atomForce[i][j].ibForce[k];
+                        atomForce[iend-1][j].dbForce[k] +=
+                            atomForce[i][j].dbForce[k];
+                    }
+                }
+            }
+            if (nenergy[i] == nenergy[iend-1]) {
+                for (j=0; j<nenergy[i]; j++) {
+                    atomEnergy[iend-1][j] += atomEnergy[i][j];
+                }
+            }
+        }
+        if (pbeparm->calcenergy != PCE_NO) {
+            Vnm_tprint( 1, "  Total electrostatic energy of the partitions = \
+%1.12E kJ/mol\n", Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na*totEnergy[iend-1]);
+        }
+    }
+
+    /* Release the Vpmg objects before the Vpmgp ones (see killMG) */
+    if (pmg[istart] != VNULL) pmg[istart]->pinned = 0;
+    Vpmg_dtor(&(pmg[istart]));
+    for (ip=0; ip<npart; ip++) {
+        for (i=head[ip]; i<head[ip+1]; i++) Vpmg_dtor(&(ppmg[ip][i]));
+    }
+    Vpmgp_dtor(&(pmgp[istart]));
+    Vpbe_dtor(&(pbe[istart]));
+    for (ip=0; ip<npart; ip++) {
+        for (i=head[ip]; i<head[ip+1]; i++) {
+            Vpmgp_dtor(&(ppmgp[ip][i]));
+            Vpbe_dtor(&(ppbe[ip][i]));
+        }
+        Vmem_free(VNULL, ncalc, sizeof(Vpbe *), (void **)&(ppbe[ip]));
+        Vmem_free(VNULL, ncalc, sizeof(Vpmgp *), (void **)&(ppmgp[ip]));
+        Vmem_free(VNULL, ncalc, sizeof(Vpmg *), (void **)&(ppmg[ip]));
+    }
+    Vmem_free(VNULL, npart, sizeof(Vpbe **), (void **)&ppbe);
+    Vmem_free(VNULL, npart, sizeof(Vpmgp **), (void **)&ppmgp);
+    Vmem_free(VNULL, npart, sizeof(Vpmg **), (void **)&ppmg);
+    Vmem_free(VNULL, npart, sizeof(Vpmg *), (void **)&finest);
+    Vmem_free(VNULL, iend-istart+1, sizeof(int), (void **)&head);
+}
+
 /**
  * @brief The main APBS function
  * @ingroup  Frontend
@@ -88,13 +911,15 @@ int main(
 
     NOsh *nosh = VNULL;
 
-    MGparm *mgparm = VNULL;
     FEMparm *feparm = VNULL;
 #ifdef ENABLE_BEM
     BEMparm *bemparm = VNULL;
 #endif
     GEOFLOWparm *geoflowparm = VNULL;
+#if defined(HAVE_MC_H) || defined(ENABLE_BEM) || defined(ENABLE_GEOFLOW) || \
+    defined(ENABLE_PBAM) || defined(ENABLE_PBSAM)
     PBEparm *pbeparm = VNULL;
+#endif
     APOLparm *apolparm = VNULL;
     Vparam *param = VNULL;
 #if defined(ENABLE_PBAM) || defined(ENABLE_PBSAM)
@@ -108,54 +933,78 @@ int main(
     Vmem *mem = VNULL;
     Vcom *com = VNULL;
     Vio *sock = VNULL;
+    Vwriter *writer = VNULL;
+    /* The driver tables below are sized from the parsed input file */
 #ifdef HAVE_MC_H
-    Vfetk *fetk[NOSH_MAXCALC];
-    Gem *gm[NOSH_MAXMOL];
+    Vfetk **fetk = VNULL;
+    Gem **gm = VNULL;
     int isolve;
 #else
-    void *fetk[NOSH_MAXCALC];
-    void *gm[NOSH_MAXMOL];
+    void **fetk = VNULL;
+    void **gm = VNULL;
 #endif
-    Vpmg *pmg[NOSH_MAXCALC];
-    Vpmgp *pmgp[NOSH_MAXCALC];
-    Vpbe *pbe[NOSH_MAXCALC];
-    Valist *alist[NOSH_MAXMOL];
-    Vgrid *dielXMap[NOSH_MAXMOL],
-          *dielYMap[NOSH_MAXMOL],
-          *dielZMap[NOSH_MAXMOL],
-          *kappaMap[NOSH_MAXMOL],
-          *potMap[NOSH_MAXMOL],
-          *chargeMap[NOSH_MAXMOL];
+    Vpmg **pmg = VNULL;
+    Vpmgp **pmgp = VNULL;
+    Vpbe **pbe = VNULL;
+    Valist **alist = VNULL;
+    Vgrid **dielXMap = VNULL,
+          **dielYMap = VNULL,
+          **dielZMap = VNULL,
+          **kappaMap = VNULL,
+          **potMap = VNULL,
+          **chargeMap = VNULL;
     char *input_path = VNULL,
-         *output_path = VNULL;
+         *output_path = VNULL,
+         *server_path = VNULL;  // socket for --server mode
     int i,
         rank,   // proc id
         size,   // total num of procs
-        k;
+        k,
+        icalc,
+        iend,
+        nmol = 0,   // allocated size of the molecule tables
+        nmap = 0,   // allocated size of the map tables
+        nmesh = 0,  // allocated size of the mesh table
+        ncalc = 0;  // allocated size of the calculation tables
     size_t bytesTotal,
            highWater;
     Voutput_Format outputformat;
+    int nwriters = VWRITER_NTHREADS,
+        writemb = VWRITER_MAXMB,
+        nwriteerr = 0;
+    int njobs = 0,     // concurrent inputs in --server mode (0: one per core)
+        ncache = 16;   // molecule snapshots the server keeps
+    int nrun = 1,      // focusing chains run at once (0: one per thread)
+        calcmb = 4096, // memory budget of the chains running at once
+        nchain = 0,
+        *chainHead = VNULL; // chain starts of the current stage
 
     int rc = 0;
 
+    /* Batch mode: PRINT statements run as soon as their calculations are done
+     * and a failed calculation does not stop the rest of the run */
+    int batch = 0,
+        iprint = 0,   // next PRINT statement to run
+        nfail = 0;    // failed calculations and skipped PRINT statements
+    int *lastPrint = VNULL, /* Last PRINT statement that uses each
+                             * calculation (-1 if none) */
+        *calcFailed = VNULL;
+
     /* The energy double arrays below store energies from various calculations. */
-    double qfEnergy[NOSH_MAXCALC],
-           qmEnergy[NOSH_MAXCALC];
-    double dielEnergy[NOSH_MAXCALC],
-           totEnergy[NOSH_MAXCALC];
-    double *atomEnergy[NOSH_MAXCALC];
-    AtomForce *atomForce[NOSH_MAXCALC]; /* Stores forces from various calculations. */
-    int nenergy[NOSH_MAXCALC], /* Stores either a flag (0,1) displaying whether
-                                * energies were calculated, or, if PCE_COMPS
-                                * was used, the number of atom energies stored
-                                * for the given calculation. */
-        nforce[NOSH_MAXCALC]; /* Stores an integer which either says no
-                               * calculation was performed (0) or gives the
-                               * number of entries in the force array for each
-                               * calculation. */
-
-    /* The real partition centers */
-    double realCenter[3];
+    double *qfEnergy = VNULL,
+           *qmEnergy = VNULL;
+    double *dielEnergy = VNULL,
+           *totEnergy = VNULL;
+    double **atomEnergy = VNULL;
+    AtomForce **atomForce = VNULL; /* Stores forces from various calculations. */
+    int *nenergy = VNULL, /* Stores either a flag (0,1) displaying whether
+                           * energies were calculated, or, if PCE_COMPS
+                           * was used, the number of atom energies stored
+                           * for the given calculation. */
+        *nforce = VNULL; /* Stores an integer which either says no
+                          * calculation was performed (0) or gives the
+                          * number of entries in the force array for each
+                          * calculation. */
 
     /* Instructions: */
     char header[] = {"\n\n\
@@ -236,6 +1085,30 @@ int main(
     format is --output-format is not used.\n\
 --output-format=<type>   Specifies format for logging.  Options\n\
     for type are either \"xml\" or \"flat\".\n\
+--write-threads=<n>      Number of background threads writing\n\
+    WRITE outputs while later calculations\n\
+    run (default 2; 0 writes synchronously).\n\
+--write-memory=<MB>      Cap on memory held by outputs waiting\n\
+    to be written (default 1024).\n\
+--batch                  Run the input as a batch of independent\n\
+    jobs: PRINT statements run as soon as\n\
+    their calculations finish, and a failed\n\
+    calculation only skips what depends on it.\n\
+--calc-threads=<n>       Number of independent multigrid\n\
+    calculations (with their focusing\n\
+    levels) run at once (default 1, which\n\
+    runs them in order; 0 runs one per\n\
+    OpenMP thread).\n\
+--calc-memory=<MB>       Cap on the estimated memory of the\n\
+    calculations running at once\n\
+    (default 4096).\n\
+--server=<socket>        Run as a persistent server that accepts\n\
+    input files on the local Unix-domain\n\
+    socket <socket> instead of running one.\n\
+--server-jobs=<n>        Number of inputs the server runs at once\n\
+    (default: one per core).\n\
+--server-cache=<n>       Number of molecules the server keeps as\n\
+    binary snapshots (default 16).\n\
 --help                   Display this help information.\n\
 --version                Display the current APBS version.\n\
 ----------------------------------------------------------------------\n\n"};
@@ -249,30 +1122,7 @@ int main(
     Vnm_setIoTag(rank, size);
     Vnm_tprint( 0, "Hello world from PE %d\n", rank);
 
-    /* A bit of array/pointer initialization */
     mem = Vmem_ctor("MAIN");
-    for (i=0; i<NOSH_MAXCALC; i++) {
-        pmg[i] = VNULL;
-        pmgp[i] = VNULL;
-        fetk[i] = VNULL;
-        pbe[i] = VNULL;
-        qfEnergy[i] = 0;
-        qmEnergy[i] = 0;
-        dielEnergy[i] = 0;
-        totEnergy[i] = 0;
-        atomForce[i] = VNULL;
-        nenergy[i] = 0;
-        nforce[i] = 0;
-    }
-    for (i=0; i<NOSH_MAXMOL; i++) {
-        alist[i] = VNULL;
-        dielXMap[i] = VNULL;
-        dielYMap[i] = VNULL;
-        dielZMap[i] = VNULL;
-        kappaMap[i] = VNULL;
-        potMap[i] = VNULL;
-        chargeMap[i] = VNULL;
-    }
 
     /* ********* CHECK INVOCATION AND OPTIONS ************* */
     Vnm_tstart(APBS_TIMER_WALL_CLOCK, "APBS WALL CLOCK");
@@ -321,6 +1171,42 @@ int main(
                 output_path = strstr(argv[i], "=");
                 ++output_path;
                 if (outputformat == OUTPUT_NULL) outputformat = OUTPUT_FLAT;
+            } else if (strncmp(argv[i], "--write-threads=", 16) == 0){
+                if ((sscanf(argv[i]+16, "%d", &nwriters) != 1)
+                    || (nwriters < 0)) {
+                    Vnm_tprint(2, "Invalid write-threads value!\n");
+                    VJMPERR1(0);
+                }
+            } else if (Vstring_strcasecmp("--batch", argv[i]) == 0){
+                batch = 1;
+            } else if (strncmp(argv[i], "--calc-threads=", 15) == 0){
+                if ((sscanf(argv[i]+15, "%d", &nrun) != 1) || (nrun < 0)) {
+                    Vnm_tprint(2, "Invalid calc-threads value!\n");
+                    VJMPERR1(0);
+                }
+            } else if (strncmp(argv[i], "--calc-memory=", 14) == 0){
+                if ((sscanf(argv[i]+14, "%d", &calcmb) != 1) || (calcmb < 0)) {
+                    Vnm_tprint(2, "Invalid calc-memory value!\n");
+                    VJMPERR1(0);
+                }
+            } else if (strncmp(argv[i], "--server=", 9) == 0){
+                server_path = argv[i]+9;
+            } else if (strncmp(argv[i], "--server-jobs=", 14) == 0){
+                if ((sscanf(argv[i]+14, "%d", &njobs) != 1) || (njobs < 0)) {
+                    Vnm_tprint(2, "Invalid server-jobs value!\n");
+                    VJMPERR1(0);
+                }
+            } else if (strncmp(argv[i], "--server-cache=", 15) == 0){
+                if ((sscanf(argv[i]+15, "%d", &ncache) != 1) || (ncache < 0)) {
+                    Vnm_tprint(2, "Invalid server-cache value!\n");
+                    VJMPERR1(0);
+                }
+            } else if (strncmp(argv[i], "--write-memory=", 15) == 0){
+                if ((sscanf(argv[i]+15, "%d", &writemb) != 1)
+                    || (writemb < 0)) {
+                    Vnm_tprint(2, "Invalid write-memory value!\n");
+                    VJMPERR1(0);
+                }
             } else {
                 Vnm_tprint(2, "UNRECOGNIZED COMMAND LINE OPTION %s!\n", argv[i]);
                 Vnm_tprint(2, "%s\n", usage);
@@ -347,8 +1233,14 @@ int main(
         VJMPERR1(0);
     }
 
+    /* The server reads its input files from the socket */
+    if ((server_path != VNULL) && (input_path != VNULL)) {
+        Vnm_tprint(2, "ERROR -- --server does not take an input file!\n");
+        VJMPERR1(0);
+    }
+
     /* If we failed to specify an input file, error. */
-    if (input_path == NULL) {
+    if ((input_path == NULL) && (server_path == VNULL)) {
         Vnm_tprint(2, "ERROR -- APBS input file not specified!\n", argc);
         Vnm_tprint(2, "%s\n", usage);
         VJMPERR1(0);
@@ -358,6 +1250,25 @@ int main(
     if ((size > 1) && (output_path != NULL))
         printf(output_path, "%s_%d", output_path, rank);
 
+    /* *************** SERVE INPUT FILES ******************* */
+    if (server_path != VNULL) {
+        if (size > 1) {
+            Vnm_tprint(2, "ERROR -- --server runs on a single process!\n");
+            VJMPERR1(0);
+        }
+        rc = serveInputs(server_path, njobs, ncache, &input_path);
+        if (rc < 0) VJMPERR1(0);
+        if (rc == 0) {
+            Vcom_finalize();
+            Vcom_dtor(&com);
+            Vmem_dtor(&mem);
+            return 0;
+        }
+        /* This is a forked process that runs one request; finishInput
+         * sends the reply */
+        Vnm_tstart(APBS_TIMER_WALL_CLOCK, "APBS WALL CLOCK");
+    }
+
     /* *************** PARSE INPUT FILE ******************* */
     nosh = NOsh_ctor(rank, size);
     Vnm_tprint( 1, "Parsing input file %s...\n", input_path);
@@ -375,6 +1286,31 @@ int main(
         Vnm_tprint( 1, "Parsed input file.\n");
     Vio_dtor(&sock);
 
+    /* A bit of array/pointer initialization */
+    nmol = VMAX2(nosh->nmol, 1);
+    nmap = VMAX2(VMAX2(nosh->ndiel, nosh->nkappa),
+                 VMAX2(nosh->npot, nosh->ncharge));
+    nmap = VMAX2(nmap, 1);
+    nmesh = VMAX2(nosh->nmesh, 1);
+    alist = (Valist **)Vmem_malloc(mem, nmol, sizeof(Valist *));
+    dielXMap = (Vgrid **)Vmem_malloc(mem, nmap, sizeof(Vgrid *));
+    dielYMap = (Vgrid **)Vmem_malloc(mem, nmap, sizeof(Vgrid *));
+    dielZMap = (Vgrid **)Vmem_malloc(mem, nmap, sizeof(Vgrid *));
+    kappaMap = (Vgrid **)Vmem_malloc(mem, nmap, sizeof(Vgrid *));
+    potMap = (Vgrid **)Vmem_malloc(mem, nmap, sizeof(Vgrid *));
+    chargeMap = (Vgrid **)Vmem_malloc(mem, nmap, sizeof(Vgrid *));
+    gm = Vmem_malloc(mem, nmesh, sizeof(*gm));
+    for (i=0; i<nmol; i++) alist[i] = VNULL;
+    for (i=0; i<nmap; i++) {
+        dielXMap[i] = VNULL;
+        dielYMap[i] = VNULL;
+        dielZMap[i] = VNULL;
+        kappaMap[i] = VNULL;
+        potMap[i] = VNULL;
+        chargeMap[i] = VNULL;
+    }
+    for (i=0; i<nmesh; i++) gm[i] = VNULL;
+
     /* *************** LOAD PARAMETERS AND MOLECULES ******************* */
     param = loadParameter(nosh);
     if (loadMolecules(nosh, param, alist) != 1) {
@@ -393,6 +1329,53 @@ int main(
         VJMPERR1(0);
     }
 
+    /* Now that the focusing levels are known, size the calculation tables */
+    ncalc = VMAX2(nosh->ncalc, 1);
+    pmg = (Vpmg **)Vmem_malloc(mem, ncalc, sizeof(Vpmg *));
+    pmgp = (Vpmgp **)Vmem_malloc(mem, ncalc, sizeof(Vpmgp *));
+    pbe = (Vpbe **)Vmem_malloc(mem, ncalc, sizeof(Vpbe *));
+    fetk = Vmem_malloc(mem, ncalc, sizeof(*fetk));
+    qfEnergy = (double *)Vmem_malloc(mem, ncalc, sizeof(double));
+    qmEnergy = (double *)Vmem_malloc(mem, ncalc, sizeof(double));
+    dielEnergy = (double *)Vmem_malloc(mem, ncalc, sizeof(double));
+    totEnergy = (double *)Vmem_malloc(mem, ncalc, sizeof(double));
+    atomEnergy = (double **)Vmem_malloc(mem, ncalc, sizeof(double *));
+    atomForce = (AtomForce **)Vmem_malloc(mem, ncalc, sizeof(AtomForce *));
+    nenergy = (int *)Vmem_malloc(mem, ncalc, sizeof(int));
+    nforce = (int *)Vmem_malloc(mem, ncalc, sizeof(int));
+    lastPrint = (int *)Vmem_malloc(mem, ncalc, sizeof(int));
+    calcFailed = (int *)Vmem_malloc(mem, ncalc, sizeof(int));
+    chainHead = (int *)Vmem_malloc(mem, ncalc+1, sizeof(int));
+    for (i=0; i<ncalc; i++) {
+        pmg[i] = VNULL;
+        pmgp[i] = VNULL;
+        fetk[i] = VNULL;
+        pbe[i] = VNULL;
+        qfEnergy[i] = 0;
+        qmEnergy[i] = 0;
+        dielEnergy[i] = 0;
+        totEnergy[i] = 0;
+        atomEnergy[i] = VNULL;
+        atomForce[i] = VNULL;
+        nenergy[i] = 0;
+        nforce[i] = 0;
+        lastPrint[i] = -1;
+        calcFailed[i] = 0;
+    }
+
+    /* Per-atom results are released after the last PRINT statement that
+     * uses them; the output file needs all of them at the end */
+    if (outputformat == OUTPUT_NULL) {
+        for (i=0; i<nosh->nprint; i++) {
+            for (k=0; k<nosh->printnarg[i]; k++) {
+                icalc = NOsh_print2calc(nosh, i, k);
+                if (icalc >= 0) lastPrint[icalc] = i;
+            }
+        }
+    } else {
+        for (i=0; i<ncalc; i++) lastPrint[i] = nosh->nprint;
+    }
+
     /* ******************* CHECK APOL********************** */
     /* if((nosh->gotparm == 0) && (rc == ACD_YES)){
         Vnm_print(1,"\nError you must provide a parameter file if you\n" \
@@ -444,81 +1427,106 @@ int main(
     }
 
     /* *************** DO THE CALCULATIONS ******************* */
+    /* WRITE outputs are queued here so the next calculation can start while
+     * they are formatted and written */
+    writer = Vwriter_ctor(nwriters, (size_t)writemb*1024*1024);
+
     Vnm_tprint( 1, "Preparing to run %d PBE calculations.\n",
                 nosh->ncalc);
+#ifdef _OPENMP
+    if (nrun == 0) nrun = omp_get_max_threads();
+#else
+    nrun = 1;
+#endif
     for (i=0; i<nosh->ncalc; i++) {
-        Vnm_tprint( 1, "----------------------------------------\n");
 
-        switch (nosh->calc[i]->calctype) {
-            /* Multigrid */
-            case NCT_MG:
-                /* What is this?  This seems like a very awkward way to find
-                the right ELEC statement... */
-                for (k=0; k<nosh->nelec; k++) {
-                    if (nosh->elec2calc[k] >= i) {
-                        break;
-                    }
-                }
-                if (Vstring_strcasecmp(nosh->elecname[k], "") == 0) {
-                    Vnm_tprint( 1, "CALCULATION #%d: MULTIGRID\n", i+1);
-                } else {
-                    Vnm_tprint( 1, "CALCULATION #%d (%s): MULTIGRID\n",
-                                i+1, nosh->elecname[k]);
-                }
-                /* Useful local variables */
-                mgparm = nosh->calc[i]->mgparm;
-                pbeparm = nosh->calc[i]->pbeparm;
-
-                /* Set up problem */
-                Vnm_tprint( 1, "  Setting up problem...\n");
-
-                if (!initMG(i, nosh, mgparm, pbeparm, realCenter, pbe,
-                            alist, dielXMap, dielYMap, dielZMap, kappaMap,
-                            chargeMap, pmgp, pmg, potMap)) {
-                    Vnm_tprint( 2, "Error setting up MG calculation!\n");
-                    VJMPERR1(0);
+        /* The partitions of a threaded parallel calculation run side by
+         * side once the coarsest level they share is solved */
+        iend = i;
+        if ((nosh->calc[i]->calctype == NCT_MG) &&
+            nosh->calc[i]->mgparm->threaded) {
+            for (iend=i+1; iend<nosh->ncalc; iend++) {
+                if ((nosh->calc[iend]->calctype != NCT_MG) ||
+                    !nosh->calc[iend]->mgparm->threaded ||
+                    (nosh->calc[iend]->mgparm->ipart < 0)) break;
+            }
+            if (i > 0) {
+                Vpmg_dtor(&(pmg[i-1]));
+                Vpmgp_dtor(&(pmgp[i-1]));
+                Vpbe_dtor(&(pbe[i-1]));
+            }
+            runParaMG(rank, nosh, i, iend, nrun, mem, outputformat, pbe,
+                      alist, dielXMap, dielYMap, dielZMap, kappaMap,
+                      chargeMap, potMap, pmgp, pmg, nenergy, totEnergy,
+                      qfEnergy, qmEnergy, dielEnergy, atomEnergy, nforce,
+                      atomForce, writer, calcFailed);
+
+        /* Focusing chains only depend on themselves, so consecutive
+         * multigrid chains run side by side as far as memory allows */
+        } else if ((nrun > 1) && (NOsh_focusParent(nosh, i) < 0)) {
+            nchain = planChains(nosh, i, (double)calcmb*1024.*1024.,
+                                chainHead);
+            if (nchain > 1) {
+                Vnm_tprint( 1, "----------------------------------------\n");
+                Vnm_tprint( 1, "Running calculations #%d-#%d as %d \
+independent chains.\n", i+1, chainHead[nchain], nchain);
+                if (i > 0) {
+                    Vpmg_dtor(&(pmg[i-1]));
+                    Vpmgp_dtor(&(pmgp[i-1]));
+                    Vpbe_dtor(&(pbe[i-1]));
                 }
+                runChains(rank, nosh, nchain, chainHead, nrun, mem,
+                          outputformat, alist, dielXMap, dielYMap, dielZMap,
+                          kappaMap, chargeMap, potMap, nenergy, totEnergy,
+                          qfEnergy, qmEnergy, dielEnergy, atomEnergy, nforce,
+                          atomForce, writer, calcFailed);
+                iend = chainHead[nchain];
+            }
+        }
 
-                /* Print problem parameters */
-                printMGPARM(mgparm, realCenter);
-                printPBEPARM(pbeparm);
-
-                /* Solve PDE */
-                if (solveMG(nosh, pmg[i], mgparm->type) != 1) {
-                    Vnm_tprint(2, "Error solving PDE!\n");
-                    VJMPERR1(0);
+        /* Handle the results in input order, as if run one by one */
+        if (iend > i) {
+            for (icalc=i; icalc<iend; icalc++) {
+                if (calcFailed[icalc] == 2) {
+                    Vnm_tprint(2, "CALCULATION #%d: skipped, it focuses from \
+failed calculation #%d!\n", icalc+1, NOsh_focusParent(nosh, icalc)+1);
                 }
-
-                /* Set partition information for observables and I/O */
-                if (setPartMG(nosh, mgparm, pmg[i]) != 1) {
-                    Vnm_tprint(2, "Error setting partition info!\n");
-                    VJMPERR1(0);
+                if (calcFailed[icalc]) {
+                    VJMPERR1(batch);
+                    Vnm_tprint(2, "CALCULATION #%d FAILED; continuing with \
+the batch.\n", icalc+1);
+                    nfail++;
+                    releaseResults(mem, icalc, nforce, atomForce);
+                } else if (lastPrint[icalc] < 0) {
+                    releaseResults(mem, icalc, nforce, atomForce);
                 }
+                if (batch) nfail += runPrints(com, mem, nosh, icalc, &iprint,
+                                              lastPrint, calcFailed,
+                                              totEnergy, nforce, atomForce);
+            }
+            i = iend - 1;
+            continue;
+        }
 
-                /* Write out energies */
-                energyMG(nosh, i, pmg[i],
-                        &(nenergy[i]), &(totEnergy[i]), &(qfEnergy[i]),
-                        &(qmEnergy[i]), &(dielEnergy[i]));
-
-                /* Write out forces */
-                forceMG(mem, nosh, pbeparm, mgparm, pmg[i], &(nforce[i]),
-                        &(atomForce[i]), alist);
-
-                /* Write out data folks might want */
-                writedataMG(rank, nosh, pbeparm, pmg[i]);
+        Vnm_tprint( 1, "----------------------------------------\n");
 
-                /* Write matrix */
-                writematMG(rank, nosh, pbeparm, pmg[i]);
+        /* A focused calculation can't run without the one it focuses from */
+        if ((NOsh_focusParent(nosh, i) >= 0) && calcFailed[i-1]) {
+            Vnm_tprint(2, "CALCULATION #%d: skipped, it focuses from failed \
+calculation #%d!\n", i+1, i);
+            VJMPERR2(0);
+        }
 
-                /* If needed, cache atom energies */
-                nenergy[i] = 0;
-                if ((pbeparm->calcenergy == PCE_COMPS) && (outputformat != OUTPUT_NULL)){
-                    storeAtomEnergy(pmg[i], i, &(atomEnergy[i]), &(nenergy[i]));
+        switch (nosh->calc[i]->calctype) {
+            /* Multigrid */
+            case NCT_MG:
+                if (!runMG(rank, nosh, i, mem, outputformat, pbe, alist,
+                           dielXMap, dielYMap, dielZMap, kappaMap, chargeMap,
+                           potMap, pmgp, pmg, nenergy, totEnergy, qfEnergy,
+                           qmEnergy, dielEnergy, atomEnergy, nforce,
+                           atomForce, writer)) {
+                    VJMPERR2(0);
                 }
-
-                fflush(stdout);
-                fflush(stderr);
-
                 break;
 
                 /* ***** Do FEM calculation ***** */
@@ -550,7 +1558,7 @@ int main(
                  * either be loaded from an external source or generated from scratch. */
                 if (initFE(i, nosh, feparm, pbeparm, pbe, alist, fetk) != VRC_SUCCESS) {
                     Vnm_tprint( 2, "Error setting up FE calculation!\n");
-                    VJMPERR1(0);
+                    VJMPERR2(0);
                 }
 
                     /* Print problem parameters */
@@ -565,7 +1573,7 @@ int main(
                  * below. */
                 if (!preRefineFE(i, feparm, fetk)) {
                     Vnm_tprint( 2, "Error pre-refining mesh!\n");
-                    VJMPERR1(0);
+                    VJMPERR2(0);
                 }
 
                 /* Solve-estimate-refine */
@@ -582,7 +1590,7 @@ int main(
                     /* Attempt to solve the mesh by using one of MC's solver types. */
                     if (!solveFE(i, pbeparm, feparm, fetk)) {
                         Vnm_tprint(2, "ERROR SOLVING EQUATION!\n");
-                        VJMPERR1(0);
+                        VJMPERR2(0);
                     }
 
                     /* Calculate the total electrostatic energy. */
@@ -590,7 +1598,7 @@ int main(
                                   &(totEnergy[i]), &(qfEnergy[i]),
                                   &(qmEnergy[i]), &(dielEnergy[i]))) {
                         Vnm_tprint(2, "ERROR SOLVING EQUATION!\n");
-                        VJMPERR1(0);
+                        VJMPERR2(0);
                     }
 
                     /* We're not going to refine if we've hit the max number
@@ -647,7 +1655,7 @@ int main(
                 Vnm_print(0, "initAPOL: Time elapsed: %f\n", ((double)clock() - ts) / CLOCKS_PER_SEC);
                 if(rc == 0) {
                     Vnm_tprint(2, "Error calculating apolar solvation quantities!\n");
-                    VJMPERR1(0);
+                    VJMPERR2(0);
                 }
                 break;
 
@@ -676,7 +1684,7 @@ int main(
 
                 if (!initBEM(i,nosh, bemparm, pbeparm, pbe)) {
                     Vnm_tprint( 2, "Error setting up BEM calculation!\n");
-                    VJMPERR1(0);
+                    VJMPERR2(0);
                 }
 
                 /* Print problem parameters */
@@ -686,7 +1694,7 @@ int main(
                 /* Solve PDE */
                 if (solveBEM(alist, nosh, pbeparm, bemparm, bemparm->type) != 1) {
                     Vnm_tprint(2, "Error solving PDE!\n");
-                    VJMPERR1(0);
+                    VJMPERR2(0);
                 }
 
                 /* Write out energies */
@@ -746,7 +1754,7 @@ int main(
                 /* Solve PDE */
                 if (solveGeometricFlow(alist, nosh, pbeparm, apolparm, geoflowparm) != 1) {
                     Vnm_tprint(2, "Error solving GEOFLOW!\n");
-                    VJMPERR1(0);
+                    VJMPERR2(0);
                 }
 
                 fflush(stdout);
@@ -784,7 +1792,7 @@ int main(
                 /* Solve LPBE with PBAM method */
 				if (solvePBAM(alist, nosh, pbeparm, pbamparm) != 1) {
                     Vnm_tprint(2, "Error solving PBAM!\n");
-                    VJMPERR1(0);
+                    VJMPERR2(0);
                 }
 
                 fflush(stdout);
@@ -821,7 +1829,7 @@ int main(
                 /* Solve LPBE with PBSAM method */
                 if (solvePBSAM(alist, nosh, pbeparm, pbamparm, pbsamparm) != 1) {
                     Vnm_tprint(2, "Error solving PBSAM!\n");
-                    VJMPERR1(0);
+                    VJMPERR2(0);
                 }
 
                 fflush(stdout);
@@ -838,37 +1846,39 @@ int main(
                 break;
             }
 
+        /* Per-atom results no PRINT statement uses can go right away; in
+         * batch mode so can the PRINT statements this calculation completes */
+        if (lastPrint[i] < 0) releaseResults(mem, i, nforce, atomForce);
+        if (batch) nfail += runPrints(com, mem, nosh, i, &iprint, lastPrint,
+                                      calcFailed, totEnergy, nforce, atomForce);
+        continue;
+
+        /* In batch mode a failed calculation is reported and the run goes on
+         * with everything that doesn't depend on it */
+        VERROR2:
+        VJMPERR1(batch);
+        Vnm_tprint(2, "CALCULATION #%d FAILED; continuing with the batch.\n",
+                   i+1);
+        calcFailed[i] = 1;
+        nfail++;
+        Vpmg_dtor(&(pmg[i]));
+        releaseResults(mem, i, nforce, atomForce);
+        nfail += runPrints(com, mem, nosh, i, &iprint, lastPrint, calcFailed,
+                           totEnergy, nforce, atomForce);
     }
 
     //Clear out the parameter file memory
     if(param != VNULL) Vparam_dtor(&param);
 
     /* *************** HANDLE PRINT STATEMENTS ******************* */
-    if (nosh->nprint > 0) {
-        Vnm_tprint( 1, "----------------------------------------\n");
-        Vnm_tprint( 1, "PRINT STATEMENTS\n");
-    }
-    for (i=0; i<nosh->nprint; i++) {
-        /* Print energy */
-        if (nosh->printwhat[i] == NPT_ENERGY) {
-            printEnergy(com, nosh, totEnergy, i);
-            /* Print force */
-        } else if (nosh->printwhat[i] == NPT_FORCE) {
-            printForce(com, nosh, nforce, atomForce, i);
-        } else if (nosh->printwhat[i] == NPT_ELECENERGY) {
-            printElecEnergy(com, nosh, totEnergy, i);
-        } else if (nosh->printwhat[i] == NPT_ELECFORCE) {
-            printElecForce(com, nosh, nforce, atomForce, i);
-        } else if (nosh->printwhat[i] == NPT_APOLENERGY) {
-            printApolEnergy(nosh, i);
-        } else if (nosh->printwhat[i] == NPT_APOLFORCE) {
-            printApolForce(com, nosh, nforce, atomForce, i);
-        } else {
-            Vnm_tprint( 2, "Undefined PRINT keyword!\n");
-            break;
-        }
-    }
+    /* Whatever batch mode hasn't printed yet (all of them otherwise) */
+    nfail += runPrints(com, mem, nosh, nosh->ncalc, &iprint, lastPrint,
+                       calcFailed, totEnergy, nforce, atomForce);
     Vnm_tprint( 1, "----------------------------------------\n");
+    if (nfail > 0) {
+        Vnm_tprint(2, "%d calculation(s) or PRINT statement(s) failed!\n",
+                   nfail);
+    }
 
     /* *************** HANDLE LOGGING *********************** */
 
@@ -885,6 +1895,14 @@ int main(
                                       (void **)&(atomEnergy[i]));
     }
 
+    /* *************** WAIT FOR OUTPUT FILES ***************** */
+
+    nwriteerr = Vwriter_flush(writer);
+    Vwriter_dtor(&writer);
+    if (nwriteerr > 0) {
+        Vnm_tprint(2, "Error writing %d output file(s)!\n", nwriteerr);
+    }
+
     /* *************** GARBAGE COLLECTION ******************* */
 
     Vnm_tprint( 1, "CLEANING UP AND SHUTTING DOWN...\n");
@@ -899,6 +1917,32 @@ int main(
     killKappaMaps(nosh, kappaMap);
     killDielMaps(nosh, dielXMap, dielYMap, dielZMap);
     killMolecules(nosh, alist);
+
+    /* Release the driver tables */
+    Vmem_free(mem, nmol, sizeof(Valist *), (void **)&alist);
+    Vmem_free(mem, nmap, sizeof(Vgrid *), (void **)&dielXMap);
+    Vmem_free(mem, nmap, sizeof(Vgrid *), (void **)&dielYMap);
+    Vmem_free(mem, nmap, sizeof(Vgrid *), (void **)&dielZMap);
+    Vmem_free(mem, nmap, sizeof(Vgrid *), (void **)&kappaMap);
+    Vmem_free(mem, nmap, sizeof(Vgrid *), (void **)&potMap);
+    Vmem_free(mem, nmap, sizeof(Vgrid *), (void **)&chargeMap);
+    Vmem_free(mem, nmesh, sizeof(*gm), (void **)&gm);
+    Vmem_free(mem, ncalc, sizeof(Vpmg *), (void **)&pmg);
+    Vmem_free(mem, ncalc, sizeof(Vpmgp *), (void **)&pmgp);
+    Vmem_free(mem, ncalc, sizeof(Vpbe *), (void **)&pbe);
+    Vmem_free(mem, ncalc, sizeof(*fetk), (void **)&fetk);
+    Vmem_free(mem, ncalc, sizeof(double), (void **)&qfEnergy);
+    Vmem_free(mem, ncalc, sizeof(double), (void **)&qmEnergy);
+    Vmem_free(mem, ncalc, sizeof(double), (void **)&dielEnergy);
+    Vmem_free(mem, ncalc, sizeof(double), (void **)&totEnergy);
+    Vmem_free(mem, ncalc, sizeof(double *), (void **)&atomEnergy);
+    Vmem_free(mem, ncalc, sizeof(AtomForce *), (void **)&atomForce);
+    Vmem_free(mem, ncalc, sizeof(int), (void **)&nenergy);
+    Vmem_free(mem, ncalc, sizeof(int), (void **)&nforce);
+    Vmem_free(mem, ncalc, sizeof(int), (void **)&lastPrint);
+    Vmem_free(mem, ncalc, sizeof(int), (void **)&calcFailed);
+    Vmem_free(mem, ncalc+1, sizeof(int), (void **)&chainHead);
+
     NOsh_dtor(&nosh);
 
     /* Memory statistics */
@@ -931,11 +1975,14 @@ int main(
 
     fflush(NULL);
 
-    return 0;
+    if (nwriteerr > 0) return finishInput(APBSRC);
+    if (nfail > 0) return finishInput(APBSRC);
+    return finishInput(0);
 
     VERROR1:
+    Vwriter_dtor(&writer);
     Vcom_finalize();
     Vcom_dtor(&com);
     Vmem_dtor(&mem);
-    return APBSRC;
+    return finishInput(APBSRC);
 }
@@ -79,6 +79,28 @@ VPRIVATE char *MCcommChars  = "#%";
 VPRIVATE double Vcompare;
 VPRIVATE char Vprecision[26];
 
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_freeData
+//
+// Purpose:  Release the grid data:  unmap it if it lives in a file mapping,
+//           free it if it was read from a file and just forget it if it
+//           belongs to the caller
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void Vgrid_freeData(Vgrid *thee) {
+
+    if (thee->mapbase != VNULL) {
+        Vstring_unmapFile((char *)(thee->mapbase), thee->mapsize);
+        thee->mapbase = VNULL;
+        thee->mapsize = 0;
+        thee->data = VNULL;
+    } else if (thee->readdata) {
+        Vmem_free(thee->mem, (thee->nx*thee->ny*thee->nz), sizeof(double),
+          (void **)&(thee->data));
+    } else {
+        thee->data = VNULL;
+    }
+}
+
 /* ///////////////////////////////////////////////////////////////////////////
 // Routine:  Vgrid_ctor
 // Author:   Nathan Baker
@@ -127,6 +149,8 @@ VPUBLIC int Vgrid_ctor2(Vgrid *thee, int nx, int ny, int nz,
     thee->ymax = ymin + (ny-1)*hy;
     thee->zmin = zmin;
     thee->zmax = zmin + (nz-1)*hzed;
+    thee->mapbase = VNULL;
+    thee->mapsize = 0;
     if (data == VNULL) {
         thee->ctordata = 0;
         thee->readdata = 0;
@@ -138,9 +162,13 @@ VPUBLIC int Vgrid_ctor2(Vgrid *thee, int nx, int ny, int nz,
 
     thee->mem = Vmem_ctor("APBS:VGRID");
 
-    Vcompare = pow(10,-1*(VGRID_DIGITS - 2));
-    sprintf(Vprecision,"%%12.%de %%12.%de %%12.%de", VGRID_DIGITS,
-            VGRID_DIGITS, VGRID_DIGITS);
+    /* Set once, so that grids being written on other threads never see
+     * the format change under them */
+    if (Vprecision[0] == '\0') {
+        Vcompare = pow(10,-1*(VGRID_DIGITS - 2));
+        sprintf(Vprecision,"%%12.%de %%12.%de %%12.%de", VGRID_DIGITS,
+                VGRID_DIGITS, VGRID_DIGITS);
+    }
 
     return 1;
 }
@@ -164,10 +192,7 @@ VPUBLIC void Vgrid_dtor(Vgrid **thee) {
 /////////////////////////////////////////////////////////////////////////// */
 VPUBLIC void Vgrid_dtor2(Vgrid *thee) {
 
-    if (thee->readdata) {
-        Vmem_free(thee->mem, (thee->nx*thee->ny*thee->nz), sizeof(double),
-          (void **)&(thee->data));
-    }
+    if (thee->readdata) Vgrid_freeData(thee);
     Vmem_dtor(&(thee->mem));
 
 }
@@ -225,10 +250,10 @@ VPUBLIC int Vgrid_value(Vgrid *thee, double pt[3], double *value) {
     if (VABS(pt[1] - ymax) < Vcompare) jhi = ny-1;
     if (VABS(pt[2] - zmax) < Vcompare) khi = nz-1;
 
-    /* See if we're on the mesh */
-    /*the condions starting with ilo>=0 seem unnecessary since they are of type size_t*/
-    if ((ihi<nx) && (jhi<ny) && (khi<nz) /*&&
-        (ilo>=0) && (jlo>=0) && (klo>=0)*/) {
+    /* See if we're on the mesh; a negative floor wraps around to a huge
+     * size_t, so it fails the upper bound test */
+    if ((ihi<nx) && (jhi<ny) && (khi<nz) &&
+        (ilo<nx) && (jlo<ny) && (klo<nz)) {
 
         dx = ifloat - (double)(ilo);
         dy = jfloat - (double)(jlo);
@@ -450,179 +475,694 @@ VPUBLIC int Vgrid_gradient(Vgrid *thee, double pt[3], double grad[3]) {
 
 }
 
+/** @brief  Edge (in cells) of the bricks that batch queries are grouped by
+ *  @ingroup  Vgrid */
+#define VGRID_BRICK 8
+
 /* ///////////////////////////////////////////////////////////////////////////
- // Routine:  Vgrid_readGZ
- //
- // Author:   David Gohara
- /////////////////////////////////////////////////////////////////////////// */
-#ifdef HAVE_ZLIB
-#define off_t long
-#include "zlib.h"
-#endif
-VPUBLIC int Vgrid_readGZ(Vgrid *thee, const char *fname) {
+// Routine:  Vgrid_interp
+//
+// Purpose:  Vgrid_value without the argument checks and NaN diagnostics;
+//           the arithmetic is identical, so the results are too
+//
+// Returns:  1 if the point is on the mesh, 0 otherwise
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vgrid_interp(Vgrid *thee, const double pt[3], double *value) {
 
-#ifdef HAVE_ZLIB
-    size_t i, j, k, u;
-    size_t len; // Temporary counter variable for loop conditionals
-    size_t header, incr;
-    double *temp;
-    double dtmp1, dtmp2, dtmp3;
-    gzFile infile;
-    char line[VMAX_ARGLEN];
+    int nx, ny, nz, ihi, jhi, khi, ilo, jlo, klo;
+    double ifloat, jfloat, kfloat, dx, dy, dz;
+    size_t ll, s1, sx, sy, sz;
+    const double *data;
 
-    header = 0;
+    nx = thee->nx;
+    ny = thee->ny;
+    nz = thee->nz;
 
-    /* Check to see if the existing data is null and, if not, clear it out */
-    if (thee->data != VNULL) {
-        Vnm_print(1, "%s:  destroying existing data!\n", __func__);
-        Vmem_free(thee->mem, thee->nx * thee->ny * thee->nz, sizeof(double),
-                  (void **)&(thee->data));
+    ifloat = (pt[0] - thee->xmin)/thee->hx;
+    jfloat = (pt[1] - thee->ymin)/thee->hy;
+    kfloat = (pt[2] - thee->zmin)/thee->hzed;
+    if (!((ifloat > -1.0) && (ifloat < nx) && (jfloat > -1.0) &&
+      (jfloat < ny) && (kfloat > -1.0) && (kfloat < nz))) {
+        *value = 0;
+        return 0;
+    }
+
+    ihi = (int)ceil(ifloat);
+    jhi = (int)ceil(jfloat);
+    khi = (int)ceil(kfloat);
+    ilo = (int)floor(ifloat);
+    jlo = (int)floor(jfloat);
+    klo = (int)floor(kfloat);
+    if (VABS(pt[0] - thee->xmin) < Vcompare) ilo = 0;
+    if (VABS(pt[1] - thee->ymin) < Vcompare) jlo = 0;
+    if (VABS(pt[2] - thee->zmin) < Vcompare) klo = 0;
+    if (VABS(pt[0] - thee->xmax) < Vcompare) ihi = nx-1;
+    if (VABS(pt[1] - thee->ymax) < Vcompare) jhi = ny-1;
+    if (VABS(pt[2] - thee->zmax) < Vcompare) khi = nz-1;
+    if ((ilo < 0) || (jlo < 0) || (klo < 0) ||
+      (ihi >= nx) || (jhi >= ny) || (khi >= nz)) {
+        *value = 0;
+        return 0;
+    }
+
+    /* Corner offsets relative to (ilo, jlo, klo) */
+    data = thee->data;
+    ll = ((size_t)klo*ny + jlo)*nx + ilo;
+    sx = (size_t)(ihi - ilo);
+    sy = (size_t)(jhi - jlo)*nx;
+    sz = (size_t)(khi - klo)*nx*ny;
+    s1 = sx + sy;
+
+    dx = ifloat - (double)(ilo);
+    dy = jfloat - (double)(jlo);
+    dz = kfloat - (double)(klo);
+    *value = dx      *dy      *dz      *(data[ll+s1+sz])
+           + dx      *(1.0-dy)*dz      *(data[ll+sx+sz])
+           + dx      *dy      *(1.0-dz)*(data[ll+s1])
+           + dx      *(1.0-dy)*(1.0-dz)*(data[ll+sx])
+           + (1.0-dx)*dy      *dz      *(data[ll+sy+sz])
+           + (1.0-dx)*(1.0-dy)*dz      *(data[ll+sz])
+           + (1.0-dx)*dy      *(1.0-dz)*(data[ll+sy])
+           + (1.0-dx)*(1.0-dy)*(1.0-dz)*(data[ll]);
+    return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_interpGradient
+//
+// Purpose:  Vgrid_gradient on top of Vgrid_interp
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vgrid_interpGradient(Vgrid *thee, const double pt[3],
+        double umid, double grad[3]) {
+
+    double h[3], uleft, uright, testpt[3];
+    int i, haveleft, haveright;
+
+    h[0] = thee->hx;
+    h[1] = thee->hy;
+    h[2] = thee->hzed;
+    for (i=0; i<3; i++) {
+        testpt[0] = pt[0];
+        testpt[1] = pt[1];
+        testpt[2] = pt[2];
+        testpt[i] = pt[i] - h[i];
+        haveleft = Vgrid_interp(thee, testpt, &uleft);
+        testpt[i] = pt[i] + h[i];
+        haveright = Vgrid_interp(thee, testpt, &uright);
+        if (haveright && haveleft) grad[i] = (uright - uleft)/(2*h[i]);
+        else if (haveright) grad[i] = (uright - umid)/h[i];
+        else if (haveleft) grad[i] = (umid - uleft)/h[i];
+        else return 0;
+    }
+    return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_batchOrder
+//
+// Purpose:  Counting sort of the points by VGRID_BRICK^3 brick of the mesh
+//           (off-mesh points last), so that queries which share corner
+//           values are evaluated together
+//
+// Returns:  A newly allocated permutation of the npts points (to be freed
+//           with Vmem_free on thee->mem), or VNULL if the points are already
+//           in mesh or brick order
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int *Vgrid_batchOrder(Vgrid *thee, int npts, double *pts) {
+
+    int i, *brick, *order, *count, nbx, nby, nbz, nbrick, cellsorted, sorted;
+    size_t cell, lastcell;
+    double ifloat, jfloat, kfloat;
+
+    nbx = (thee->nx + VGRID_BRICK - 1)/VGRID_BRICK;
+    nby = (thee->ny + VGRID_BRICK - 1)/VGRID_BRICK;
+    nbz = (thee->nz + VGRID_BRICK - 1)/VGRID_BRICK;
+    nbrick = nbx*nby*nbz;
+    brick = (int *)Vmem_malloc(thee->mem, npts, sizeof(int));
+
+    sorted = 1;
+    cellsorted = 1;
+    lastcell = 0;
+    for (i=0; i<npts; i++) {
+        ifloat = floor((pts[3*(size_t)i] - thee->xmin)/thee->hx);
+        jfloat = floor((pts[3*(size_t)i+1] - thee->ymin)/thee->hy);
+        kfloat = floor((pts[3*(size_t)i+2] - thee->zmin)/thee->hzed);
+        if ((ifloat >= 0) && (ifloat < thee->nx) && (jfloat >= 0) &&
+          (jfloat < thee->ny) && (kfloat >= 0) && (kfloat < thee->nz)) {
+            brick[i] = (((int)kfloat/VGRID_BRICK)*nby
+              + (int)jfloat/VGRID_BRICK)*nbx + (int)ifloat/VGRID_BRICK;
+            cell = ((size_t)kfloat*thee->ny + (size_t)jfloat)*thee->nx
+              + (size_t)ifloat;
+        } else {
+            brick[i] = nbrick;
+            cell = (size_t)-1;
         }
+        if ((i > 0) && (brick[i] < brick[i-1])) sorted = 0;
+        if (cell < lastcell) cellsorted = 0;
+        lastcell = cell;
+    }
+    if (sorted || cellsorted) {
+        Vmem_free(thee->mem, npts, sizeof(int), (void **)&brick);
+        return VNULL;
+    }
 
-    thee->readdata = 1;
-    thee->ctordata = 0;
+    count = (int *)Vmem_malloc(thee->mem, nbrick+2, sizeof(int));
+    for (i=0; i<nbrick+2; i++) count[i] = 0;
+    for (i=0; i<npts; i++) count[brick[i]+1]++;
+    for (i=0; i<nbrick+1; i++) count[i+1] += count[i];
+    order = (int *)Vmem_malloc(thee->mem, npts, sizeof(int));
+    for (i=0; i<npts; i++) order[count[brick[i]]++] = i;
 
-    infile = gzopen(fname, "rb");
-    if (infile == Z_NULL) {
-        Vnm_print(2, "%s:  Problem opening compressed file %s\n", __func__, fname);
-        return VRC_FAILURE;
+    Vmem_free(thee->mem, nbrick+2, sizeof(int), (void **)&count);
+    Vmem_free(thee->mem, npts, sizeof(int), (void **)&brick);
+    return order;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_valueBatch
+//
+// Purpose:  VGRID_BATCHTILE points make up one thread task.  When
+//           gradients are wanted (seven interpolations per point) the
+//           points are visited brick by brick (see Vgrid_batchOrder) so the
+//           corner values of neighbouring queries are still in cache; for
+//           values alone the reordering costs more than it saves.
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vgrid_valueBatch(Vgrid *thee, int npts, double *pts,
+        double *values, double *grads, int *onGrid) {
+
+    int itile, ntile, non, *order;
+
+    if (thee == VNULL) {
+        Vnm_print(2, "Vgrid_valueBatch:  Error -- got VNULL thee!\n");
+        VASSERT(0);
+    }
+    if (!(thee->ctordata || thee->readdata)) {
+        Vnm_print(2, "Vgrid_valueBatch:  Error -- no data available!\n");
+        VASSERT(0);
     }
+    if (npts <= 0) return 0;
 
-    thee->hx = 0.0;
-    thee->hy = 0.0;
-    thee->hzed = 0.0;
+    order = VNULL;
+    if ((grads != VNULL) && (npts > VGRID_BATCHTILE)) {
+        order = Vgrid_batchOrder(thee, npts, pts);
+    }
 
-    //read data here
-    while (header < 7) {
-        if(gzgets(infile, line, VMAX_ARGLEN) == Z_NULL){
-            return VRC_FAILURE;
+    non = 0;
+    ntile = (npts + VGRID_BATCHTILE - 1)/VGRID_BATCHTILE;
+    #pragma omp parallel for schedule(dynamic,1) reduction(+:non)
+    for (itile=0; itile<ntile; itile++) {
+        int i, ip, iend, on;
+        double *pt;
+
+        iend = VMIN2(npts, (itile+1)*VGRID_BATCHTILE);
+        for (i=itile*VGRID_BATCHTILE; i<iend; i++) {
+            ip = (order == VNULL) ? i : order[i];
+            pt = pts + 3*(size_t)ip;
+            on = Vgrid_interp(thee, pt, &(values[ip]));
+            if (grads != VNULL) {
+                if (!on || !Vgrid_interpGradient(thee, pt, values[ip],
+                  grads + 3*(size_t)ip)) {
+                    grads[3*(size_t)ip] = 0.0;
+                    grads[3*(size_t)ip+1] = 0.0;
+                    grads[3*(size_t)ip+2] = 0.0;
+                    on = 0;
+                }
+            }
+            if (onGrid != VNULL) onGrid[ip] = on;
+            non += on;
         }
+    }
 
-        // Skip comments and newlines
-        if(strncmp(line, "#", 1) == 0) continue;
-        if(line[0] == '\n') continue;
+    if (order != VNULL) Vmem_free(thee->mem, npts, sizeof(int), (void **)&order);
+    return non;
+}
 
-        switch (header) {
-            case 0:
-                sscanf(line, "object 1 class gridpositions counts %d %d %d",
-                       &(thee->nx),&(thee->ny),&(thee->nz));
-                break;
-            case 1:
-                sscanf(line, "origin %lf %lf %lf",
-                       &(thee->xmin),&(thee->ymin),&(thee->zmin));
-                break;
-            case 2:
-            case 3:
-            case 4:
-                sscanf(line, "delta %lf %lf %lf",&dtmp1,&dtmp2,&dtmp3);
-                thee->hx += dtmp1;
-                thee->hy += dtmp2;
-                thee->hzed += dtmp3;
-                break;
-            default:
-                break;
-        }
+/** @brief  Nominal number of bytes of DX data parsed per thread task
+ *  @ingroup  Vgrid */
+#define VGRID_DXCHUNK (1<<22)
 
-        header++;
+/** @brief  Token separators recognized by the OpenDX readers (MCwhiteChars
+ *          plus carriage returns)
+ *  @ingroup  Vgrid */
+#define VGRID_DXWHITE(c) (((c) == ' ') || ((c) == '=') || ((c) == ',') || \
+  ((c) == ';') || ((c) == '\t') || ((c) == '\n') || ((c) == '\r'))
+
+/** @brief  Comment leaders recognized by the OpenDX readers (MCcommChars)
+ *  @ingroup  Vgrid */
+#define VGRID_DXCOMM(c) (((c) == '#') || ((c) == '%'))
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_dxSkip
+//
+// Purpose:  Skip separators and comments (to the end of the line)
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE const char *Vgrid_dxSkip(const char *p, const char *end) {
+
+    while (p < end) {
+        if (VGRID_DXWHITE(*p)) p++;
+        else if (VGRID_DXCOMM(*p)) {
+            while ((p < end) && (*p != '\n')) p++;
+        } else break;
     }
+    return p;
+}
 
-    /* Allocate space for the data */
-    Vnm_print(0, "%s:  allocating %d x %d x %d doubles for storage\n",
-        __func__, thee->nx, thee->ny, thee->nz);
-    len = thee->nx * thee->ny * thee->nz;
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_dxToken
+//
+// Purpose:  Copy the next token (truncated to len-1 characters) into tok
+//
+// Returns:  Pointer just past the token or VNULL at the end of the buffer
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE const char *Vgrid_dxToken(const char *p, const char *end,
+        char *tok, size_t len) {
 
-    thee->data = VNULL;
-    thee->data = Vmem_malloc(thee->mem, len, sizeof(double));
-    if (thee->data == VNULL) {
-        Vnm_print(2, "%s:  Unable to allocate space for data!\n", __func__);
-        return 0;
+    size_t n = 0;
+
+    p = Vgrid_dxSkip(p, end);
+    if (p >= end) return VNULL;
+    while ((p < end) && !VGRID_DXWHITE(*p) && !VGRID_DXCOMM(*p)) {
+        if (n < len - 1) tok[n++] = *p;
+        p++;
     }
+    tok[n] = '\0';
+    return p;
+}
 
-    /* Allocate a temporary buffer to store the compressed
-     * data into (column major order). Add 2 to ensure the buffer is
-     * big enough to take extra data on the final read loop.
-     */
-    temp = (double *)malloc(len * (2 * sizeof(double)));
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_dxLine
+//
+// Purpose:  Copy the next line (truncated to len-1 characters, newline
+//           kept) into tok
+//
+// Returns:  Pointer to the start of the following line or VNULL at the end
+//           of the buffer
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE const char *Vgrid_dxLine(const char *p, const char *end,
+        char *tok, size_t len) {
 
-    for (i = 0; i < len; i += 3){
-        memset(&line, 0, sizeof(line));
-        gzgets(infile, line, VMAX_ARGLEN);
-        sscanf(line, "%lf %lf %lf", &temp[i], &temp[i+1], &temp[i+2]);
+    size_t n = 0;
+
+    if (p >= end) return VNULL;
+    while (p < end) {
+        if (n < len - 1) tok[n++] = *p;
+        if (*(p++) == '\n') break;
     }
+    tok[n] = '\0';
+    return p;
+}
 
-    /* Now move the data to row major order */
-    incr = 0;
-    for (i=0; i<thee->nx; i++) {
-        for (j=0; j<thee->ny; j++) {
-            for (k=0; k<thee->nz; k++) {
-                u = k*(thee->nx)*(thee->ny)+j*(thee->nx)+i;
-                (thee->data)[u] = temp[incr++];
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_dxParse
+//
+// Purpose:  Convert the token at p as sscanf(tok, "%lf", val) would.  Up to
+//           15 significant digits with a decimal exponent of at most 22 in
+//           magnitude are converted with a single exact multiply or divide,
+//           which is correctly rounded; everything else (long mantissas,
+//           large exponents, nan/inf, hex) goes through strtod.
+//
+// Returns:  Pointer just past the token or VNULL if it is not a number
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE const char *Vgrid_dxParse(const char *p, const char *end,
+        double *val) {
+
+    static const double pow10[23] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    unsigned long long mant = 0;
+    const char *tbeg, *t;
+    char tok[VMAX_BUFSIZE], *stop;
+    int neg = 0, slow = 0, nsig = 0, ndig = 0, eneg, edig;
+    long expo = 0;
+    size_t len;
+
+    tbeg = p;
+    if ((p < end) && ((*p == '+') || (*p == '-'))) {
+        neg = (*p == '-');
+        p++;
+    }
+    for (; (p < end) && (*p >= '0') && (*p <= '9'); p++, ndig++) {
+        if ((mant == 0) && (*p == '0')) continue;
+        if (++nsig > 15) slow = 1;
+        else mant = 10*mant + (unsigned long long)(*p - '0');
+    }
+    if ((p < end) && (*p == '.')) {
+        for (p++; (p < end) && (*p >= '0') && (*p <= '9'); p++, ndig++) {
+            expo--;
+            if ((mant == 0) && (*p == '0')) continue;
+            if (++nsig > 15) slow = 1;
+            else mant = 10*mant + (unsigned long long)(*p - '0');
+        }
+    }
+    if ((ndig > 0) && (p < end) && ((*p == 'e') || (*p == 'E'))) {
+        t = p + 1;
+        eneg = 0;
+        if ((t < end) && ((*t == '+') || (*t == '-'))) {
+            eneg = (*t == '-');
+            t++;
+        }
+        if ((t < end) && (*t >= '0') && (*t <= '9')) {
+            for (edig = 0; (t < end) && (*t >= '0') && (*t <= '9'); t++) {
+                if (edig < 100000) edig = 10*edig + (*t - '0');
             }
+            expo += eneg ? -edig : edig;
+            p = t;
         }
     }
 
-    /* calculate grid maxima */
-    thee->xmax = thee->xmin + (thee->nx-1)*thee->hx;
-    thee->ymax = thee->ymin + (thee->ny-1)*thee->hy;
-    thee->zmax = thee->zmin + (thee->nz-1)*thee->hzed;
-
-    /* Close off the socket */
-    gzclose(infile);
-    free(temp);
-#else
+    /* Anything short of a fully consumed plain decimal token is left to
+     * the C library */
+    if ((ndig == 0) || ((p < end) && !VGRID_DXWHITE(*p) && !VGRID_DXCOMM(*p))) {
+        slow = 1;
+    }
+    if (!slow) {
+        if (mant == 0) {
+            *val = neg ? -0.0 : 0.0;
+        } else if ((expo >= -22) && (expo <= 22)) {
+            *val = (double)mant;
+            if (expo < 0) *val /= pow10[-expo];
+            else *val *= pow10[expo];
+            if (neg) *val = -(*val);
+        } else slow = 1;
+    }
+    if (slow) {
+        for (p = tbeg; (p < end) && !VGRID_DXWHITE(*p) && !VGRID_DXCOMM(*p);
+          p++);
+        len = VMIN2((size_t)(p - tbeg), sizeof(tok) - 1);
+        memcpy(tok, tbeg, len);
+        tok[len] = '\0';
+        *val = strtod(tok, &stop);
+        if (stop == tok) return VNULL;
+    }
 
-    Vnm_print(0, "WARNING\n");
-    Vnm_print(0, "Vgrid_readGZ:  gzip read/write support is disabled in this build\n");
-    Vnm_print(0, "Vgrid_readGZ:  configure and compile without the --disable-zlib flag.\n");
-    Vnm_print(0, "WARNING\n");
-#endif
-    return VRC_SUCCESS;
+    return p;
 }
 
-/**
- * Load grid from an input file using sockets.
- * @author Nathan Baker
- */
-VPUBLIC int Vgrid_readDX(Vgrid *thee,
-                         const char *iodev,
-                         const char *iofmt,
-                         const char *thost,
-                         const char *fname
-                        ) {
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_dxDataEnd
+//
+// Purpose:  Find the end of the DX data section by walking backwards over
+//           the trailing lines (attributes, field objects, comments) whose
+//           first token is not a number
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE const char *Vgrid_dxDataEnd(const char *beg, const char *end) {
 
-    size_t i, j, k, itmp, u;
+    const char *line, *t;
     double dtmp;
-    char tok[VMAX_BUFSIZE];
-    Vio *sock;
 
-    /* Check to see if the existing data is null and, if not, clear it out */
-    if (thee->data != VNULL) {
-        Vnm_print(1, "Vgrid_readDX:  destroying existing data!\n");
-    Vmem_free(thee->mem, (thee->nx*thee->ny*thee->nz), sizeof(double),
-          (void **)&(thee->data)); }
-    thee->readdata = 1;
-    thee->ctordata = 0;
+    while (end > beg) {
+        for (line = end; (line > beg) && (line[-1] != '\n'); line--);
+        t = Vgrid_dxSkip(line, end);
+        if ((t < end) && (Vgrid_dxParse(t, end, &dtmp) != VNULL)) return end;
+        end = (line > beg) ? (line - 1) : beg;
+    }
+    return beg;
+}
 
-    /* Set up the virtual socket */
-    sock = Vio_ctor(iodev,iofmt,thost,fname,"r");
-    if (sock == VNULL) {
-        Vnm_print(2, "Vgrid_readDX: Problem opening virtual socket %s\n",
-          fname);
-        return 0;
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_parseDXHeader
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vgrid_parseDXHeader(const char **pos, const char *end,
+        int dims[3], double origin[3], double spacing[3],
+        unsigned long *items) {
+
+    /* Header tokens:  "%d"/"%f" are stored, "0" must be zero, "%u" is the
+     * item count, "*" is ignored and "binary" may be left out */
+    static const char *header[] = {
+        "object", "*", "class", "gridpositions", "counts", "%d", "%d", "%d",
+        "origin", "%f", "%f", "%f",
+        "delta", "%f", "0", "0",
+        "delta", "0", "%f", "0",
+        "delta", "0", "0", "%f",
+        "object", "*", "class", "gridconnections", "counts", "*", "*", "*",
+        "object", "*", "class", "array", "type", "double", "rank", "*",
+        "items", "%u", "binary", "data", "follows", VNULL
+    };
+    char tok[VMAX_BUFSIZE];
+    const char *p;
+    int *ivals[3], ni, nd, ih;
+    double *dvals[6], dtmp;
+
+    ivals[0] = &(dims[0]);
+    ivals[1] = &(dims[1]);
+    ivals[2] = &(dims[2]);
+    dvals[0] = &(origin[0]);
+    dvals[1] = &(origin[1]);
+    dvals[2] = &(origin[2]);
+    dvals[3] = &(spacing[0]);
+    dvals[4] = &(spacing[1]);
+    dvals[5] = &(spacing[2]);
+    *items = 0;
+    ni = 0;
+    nd = 0;
+    p = *pos;
+    for (ih=0; header[ih] != VNULL; ih++) {
+        p = Vgrid_dxToken(p, end, tok, sizeof(tok));
+        if (p == VNULL) return -1;
+        if (!strcmp(header[ih], "binary") && strcmp(tok, "binary")) ih++;
+        if (!strcmp(header[ih], "%d")) {
+            if (1 != sscanf(tok, "%d", ivals[ni++])) return 0;
+        } else if (!strcmp(header[ih], "%f")) {
+            if (1 != sscanf(tok, "%lf", dvals[nd++])) return 0;
+        } else if (!strcmp(header[ih], "0")) {
+            if ((1 != sscanf(tok, "%lf", &dtmp)) || (dtmp != 0.0)) return 0;
+        } else if (!strcmp(header[ih], "%u")) {
+            if (1 != sscanf(tok, "%lu", items)) return 0;
+        } else if (strcmp(header[ih], "*")) {
+            if (strcmp(tok, header[ih])) return 0;
+        }
     }
-    if (Vio_accept(sock, 0) < 0) {
-        Vnm_print(2, "Vgrid_readDX: Problem accepting virtual socket %s\n",
-          fname);
+    *pos = p;
+
+    return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_dxHeader
+//
+// Purpose:  Parse the OpenDX header at *pos into the grid
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vgrid_dxHeader(Vgrid *thee, const char **pos, const char *end,
+        unsigned long *items) {
+
+    int dims[3], rc;
+    double origin[3], spacing[3];
+
+    rc = Vgrid_parseDXHeader(pos, end, dims, origin, spacing, items);
+    if (rc != 1) return rc;
+    thee->nx = dims[0];
+    thee->ny = dims[1];
+    thee->nz = dims[2];
+    thee->xmin = origin[0];
+    thee->ymin = origin[1];
+    thee->zmin = origin[2];
+    thee->hx = spacing[0];
+    thee->hy = spacing[1];
+    thee->hzed = spacing[2];
+
+    return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_readDXFile
+//
+// Purpose:  Read an OpenDX file from disk.  The file is mapped into memory,
+//           the header is tokenized once and the data section is split into
+//           line-aligned byte ranges that are counted and then converted in
+//           parallel; a prefix sum over the per-range counts gives every
+//           range the grid index of its first value.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vgrid_readDXFile(Vgrid *thee, const char *fname) {
+
+    char *buf;
+    const char *p, *end, *dbeg, *dend, **bound;
+    int ic, nchunk, nerr, rc;
+    double dtmp;
+    unsigned long items;
+    size_t size, n, total, *start;
+
+    buf = Vstring_mapFile(fname, &size, 0);
+    if (buf == VNULL) {
+        Vnm_print(2, "Vgrid_readDX: Problem opening file %s\n", fname);
         return 0;
     }
-
-    Vio_setWhiteChars(sock, MCwhiteChars);
-    Vio_setCommChars(sock, MCcommChars);
+    end = buf + size;
+    bound = VNULL;
+    start = VNULL;
+    nchunk = 0;
 
     /* Read in the DX regular positions */
-    /* Get "object" */
-    VJMPERR2(1 == Vio_scanf(sock, "%s", tok));
-    VJMPERR1(!strcmp(tok, "object"));
+    p = buf;
+    rc = Vgrid_dxHeader(thee, &p, end, &items);
+    VJMPERR2(rc >= 0);
+    VJMPERR1(rc == 1);
+    Vnm_print(0, "Vgrid_readDX:  Grid dimensions %d x %d x %d grid\n",
+     thee->nx, thee->ny, thee->nz);
+    Vnm_print(0, "Vgrid_readDX:  Grid origin = (%g, %g, %g)\n",
+      thee->xmin, thee->ymin, thee->zmin);
+    Vnm_print(0, "Vgrid_readDX:  Grid spacings = (%g, %g, %g)\n",
+      thee->hx, thee->hy, thee->hzed);
+    VJMPERR1((thee->nx > 0) && (thee->ny > 0) && (thee->nz > 0));
+    n = (size_t)thee->nx * thee->ny * thee->nz;
+    VJMPERR1(n == items);
+
+    /* Allocate space for the data */
+    Vnm_print(0, "Vgrid_readDX:  allocating %d x %d x %d doubles for storage\n",
+      thee->nx, thee->ny, thee->nz);
+    thee->data = VNULL;
+    thee->data = (double*)Vmem_malloc(thee->mem, n, sizeof(double));
+    if (thee->data == VNULL) {
+        Vnm_print(2, "Vgrid_readDX:  Unable to allocate space for data!\n");
+        Vstring_unmapFile(buf, size);
+        return 0;
+    }
+
+    /* Split the data section at line starts */
+    dbeg = p;
+    dend = Vgrid_dxDataEnd(dbeg, end);
+    nchunk = (int)((size_t)(dend - dbeg)/VGRID_DXCHUNK) + 1;
+    bound = (const char **)Vmem_malloc(VNULL, nchunk+1, sizeof(const char *));
+    start = (size_t *)Vmem_malloc(VNULL, nchunk+1, sizeof(size_t));
+    VJMPERR2((bound != VNULL) && (start != VNULL));
+    bound[0] = dbeg;
+    for (ic=1; ic<nchunk; ic++) {
+        p = VMAX2(dbeg + (size_t)ic*VGRID_DXCHUNK, bound[ic-1]);
+        while ((p < dend) && (*p != '\n')) p++;
+        bound[ic] = (p < dend) ? (p + 1) : dend;
+    }
+    bound[nchunk] = dend;
+
+    /* Count the values in each range */
+    #pragma omp parallel for schedule(dynamic) private(ic, p)
+    for (ic=0; ic<nchunk; ic++) {
+        size_t count = 0;
+        p = Vgrid_dxSkip(bound[ic], bound[ic+1]);
+        while (p < bound[ic+1]) {
+            count++;
+            while ((p < bound[ic+1]) && !VGRID_DXWHITE(*p) &&
+              !VGRID_DXCOMM(*p)) p++;
+            p = Vgrid_dxSkip(p, bound[ic+1]);
+        }
+        start[ic+1] = count;
+    }
+    start[0] = 0;
+    for (ic=0; ic<nchunk; ic++) start[ic+1] += start[ic];
+    total = start[nchunk];
+    VJMPERR1(total >= n);
+
+    /* Convert; the file is in i-j-k order with k fastest */
+    nerr = 0;
+    #pragma omp parallel for schedule(dynamic) private(ic, p, dtmp) \
+      reduction(+:nerr)
+    for (ic=0; ic<nchunk; ic++) {
+        size_t idx, i, j, k;
+        idx = start[ic];
+        k = idx % thee->nz;
+        j = (idx / thee->nz) % thee->ny;
+        i = idx / ((size_t)thee->nz * thee->ny);
+        p = Vgrid_dxSkip(bound[ic], bound[ic+1]);
+        while ((p < bound[ic+1]) && (idx < n)) {
+            p = Vgrid_dxParse(p, bound[ic+1], &dtmp);
+            if (p == VNULL) {
+                nerr++;
+                break;
+            }
+            (thee->data)[k*(thee->nx)*(thee->ny)+j*(thee->nx)+i] = dtmp;
+            idx++;
+            if (++k == (size_t)thee->nz) {
+                k = 0;
+                if (++j == (size_t)thee->ny) {
+                    j = 0;
+                    i++;
+                }
+            }
+            p = Vgrid_dxSkip(p, bound[ic+1]);
+        }
+    }
+    VJMPERR1(nerr == 0);
+
+    /* calculate grid maxima */
+    thee->xmax = thee->xmin + (thee->nx-1)*thee->hx;
+    thee->ymax = thee->ymin + (thee->ny-1)*thee->hy;
+    thee->zmax = thee->zmin + (thee->nz-1)*thee->hzed;
+
+    Vmem_free(VNULL, nchunk+1, sizeof(const char *), (void **)&bound);
+    Vmem_free(VNULL, nchunk+1, sizeof(size_t), (void **)&start);
+    Vstring_unmapFile(buf, size);
+
+    return 1;
+
+  VERROR1:
+    if (bound != VNULL)
+        Vmem_free(VNULL, nchunk+1, sizeof(const char *), (void **)&bound);
+    if (start != VNULL)
+        Vmem_free(VNULL, nchunk+1, sizeof(size_t), (void **)&start);
+    Vstring_unmapFile(buf, size);
+    Vnm_print(2, "Vgrid_readDX:  Format problem with input file <%s>\n",
+      fname);
+    return 0;
+
+  VERROR2:
+    if (bound != VNULL)
+        Vmem_free(VNULL, nchunk+1, sizeof(const char *), (void **)&bound);
+    if (start != VNULL)
+        Vmem_free(VNULL, nchunk+1, sizeof(size_t), (void **)&start);
+    Vstring_unmapFile(buf, size);
+    Vnm_print(2, "Vgrid_readDX:  I/O problem with input file <%s>\n",
+      fname);
+    return 0;
+}
+
+/**
+ * Load grid from an input file using sockets.
+ * @author Nathan Baker
+ */
+VPUBLIC int Vgrid_readDX(Vgrid *thee,
+                         const char *iodev,
+                         const char *iofmt,
+                         const char *thost,
+                         const char *fname
+                        ) {
+
+    size_t i, j, k, itmp, u;
+    double dtmp;
+    char tok[VMAX_BUFSIZE];
+    Vio *sock;
+
+    /* Check to see if the existing data is null and, if not, clear it out */
+    if (thee->data != VNULL) {
+        Vnm_print(1, "Vgrid_readDX:  destroying existing data!\n");
+        Vgrid_freeData(thee);
+    }
+    thee->readdata = 1;
+    thee->ctordata = 0;
+
+    /* Plain files are mapped and parsed in parallel */
+    if (!strcmp(iodev, "FILE") && !Vstring_strcasecmp(iofmt, "ASC")) {
+        return Vgrid_readDXFile(thee, fname);
+    }
+
+    /* Set up the virtual socket */
+    sock = Vio_ctor(iodev,iofmt,thost,fname,"r");
+    if (sock == VNULL) {
+        Vnm_print(2, "Vgrid_readDX: Problem opening virtual socket %s\n",
+          fname);
+        return 0;
+    }
+    if (Vio_accept(sock, 0) < 0) {
+        Vnm_print(2, "Vgrid_readDX: Problem accepting virtual socket %s\n",
+          fname);
+        return 0;
+    }
+
+    Vio_setWhiteChars(sock, MCwhiteChars);
+    Vio_setCommChars(sock, MCcommChars);
+
+    /* Read in the DX regular positions */
+    /* Get "object" */
+    VJMPERR2(1 == Vio_scanf(sock, "%s", tok));
+    VJMPERR1(!strcmp(tok, "object"));
     /* Get "1" */
     VJMPERR2(1 == Vio_scanf(sock, "%d", &itmp));
     /* Get "class" */
@@ -810,224 +1350,1088 @@ VPUBLIC int Vgrid_readDX(Vgrid *thee,
 VPUBLIC int Vgrid_readDXBIN(Vgrid *thee, const char *iodev, const char *iofmt,
                          const char *thost, const char *fname) {
 
-	size_t i, j, k, itmp, u;
+	size_t i, n, size;
 	double dtmp, dtmp2;
-	char tok[VMAX_BUFSIZE];
-	int isBinary = 0;
-	//Vio *sock;
+	char tok[VMAX_BUFSIZE], *buf;
+	const char *p, *end, *data;
 
 	/* Check to see if the existing data is null and, if not, clear it out */
 	if (thee->data != VNULL) {
 		Vnm_print(1, "Vgrid_readDXBIN: destroying existing data!\n");
-	Vmem_free(thee->mem, (thee->nx*thee->ny*thee->nz), sizeof(double),
-		  (void **)&(thee->data)); }
+		Vgrid_freeData(thee);
+	}
 	thee->readdata = 1;
 	thee->ctordata = 0;
 
-	/*Opend file fd for binary reading*/
-	FILE *fd = fopen(fname,"rb");
-	if(fd == NULL){
-		printf("Vgrid_readDXBIN: Problem opening file %s\n",fname);
-		fclose(fd);
+	/* Map the whole file; the header is parsed line by line from memory */
+	buf = Vstring_mapFile(fname, &size, 0);
+	if (buf == VNULL) {
+		Vnm_print(2, "Vgrid_readDXBIN: Problem opening file %s\n", fname);
 		return 0;
 	}
-
-	    /* Set up the virtual socket */
-//	    sock = Vio_ctor(iodev,iofmt,thost,fname,"r");
-//	    if (sock == VNULL) {
-//	        Vnm_print(2, "Vgrid_readDX: Problem opening virtual socket %s\n",
-//	          fname);
-//	        return 0;
-//	    }
-//	    if (Vio_accept(sock, 0) < 0) {
-//	        Vnm_print(2, "Vgrid_readDX: Problem accepting virtual socket %s\n",
-//	          fname);
-//	        return 0;
-//	    }
-//
-//	    Vio_setWhiteChars(sock, MCwhiteChars);
-//	    Vio_setCommChars(sock, MCcommChars);
-
-	//skip comments
-	do{
-		fgets(tok, VMAX_BUFSIZE, fd);
+	p = buf;
+	end = buf + size;
+
+	/* Skip comments */
+	do {
+		p = Vgrid_dxLine(p, end, tok, sizeof(tok));
+		VJMPERR2(p != VNULL);
+	} while (tok[0] == '#');
+
+	/* Get counts */
+	if (sscanf(tok, "object 1 class gridpositions counts %i %i %i\n",
+	  &(thee->nx), &(thee->ny), &(thee->nz)) != 3) {
+		Vnm_print(2, "Vgrid_readDXBIN: Failed to read dimensions.\n");
+		VJMPERR1(0);
 	}
-	while(tok[0]=='#');
-
-	//get counts
-	if(sscanf(tok,"object 1 class gridpositions counts %i %i %i\n",&(thee->nx),&(thee->ny),&(thee->nz))!= 3){
-		printf("Vgrid_readDXBIN: Failed to read dimensions.\n");
-		fclose(fd);
-		return 0;
-	}
-	printf("Vgrid_readDXBIN: Grid dimensions %d x %d x %d grid\n",thee->nx, thee->ny, thee->nz);
-
-	    /* Read in the DX regular positions */
-
-		/* Get "object" */
-//	    VJMPERR2(1 == Vio_scanf(sock, "%s", tok));
-//	    VJMPERR1(!strcmp(tok, "object"));
-//	    /* Get "1" */
-//	    VJMPERR2(1 == Vio_scanf(sock, "%d", &itmp));
-//	    /* Get "class" */
-//	    VJMPERR2(1 == Vio_scanf(sock, "%s", tok));
-//	    VJMPERR1(!strcmp(tok, "class"));
-//	    /* Get "gridpositions" */
-//	    VJMPERR2(1 == Vio_scanf(sock, "%s", tok));
-//	    VJMPERR1(!strcmp(tok, "gridpositions"));
-//	    /* Get "counts" */
-//	    VJMPERR2(1 == Vio_scanf(sock, "%s", tok));
-//	    VJMPERR1(!strcmp(tok, "counts"));
-//	    /* Get nx */
-//	    VJMPERR2(1 == Vio_scanf(sock, "%s", tok));
-//	    VJMPERR1(1 == sscanf(tok, "%d", &(thee->nx)));
-//	    /* Get ny */
-//	    VJMPERR2(1 == Vio_scanf(sock, "%s", tok));
-//	    VJMPERR1(1 == sscanf(tok, "%d", &(thee->ny)));
-//	    /* Get nz */
-//	    VJMPERR2(1 == Vio_scanf(sock, "%s", tok));
-//	    VJMPERR1(1 == sscanf(tok, "%d", &(thee->nz)));
-//	    Vnm_print(0, "Vgrid_readDX:  Grid dimensions %d x %d x %d grid\n",
-//	     thee->nx, thee->ny, thee->nz);
-
-	if(fgets(tok,VMAX_BUFSIZE, fd) == NULL){
-		printf("Vgrid_readDXBIN: unexpected end of file.\n");
-		fclose(fd);
-		return 0;
-	}
-	if(sscanf(tok,"origin %lf %lf %lf",&(thee->xmin),&(thee->ymin),&(thee->zmin))!=3){
-		printf("Vgrid_readDXBIN: Failed to read origin cell data.\n");
-		fclose(fd);
-		return 0;
-	}
-	printf("Vgrid_readDXBIN: Grid origin = (%g %g %g)\n",thee->xmin, thee->ymin, thee->zmin);
-
-	//get Delta x
-	if(fgets(tok,VMAX_BUFSIZE, fd) == NULL){
-		printf("Vgrid_readDXBIN: unexpected end of file.\n");
-		fclose(fd);
-		return 0;
-	}
-	if(sscanf(tok,"delta %lf %lf %lf",&(thee->hx),&dtmp,&dtmp2)!=3){
-		printf("Vgrid_readDXBIN: Failed to read delta x data.\n");
-		fclose(fd);
-		return 0;
+	Vnm_print(0, "Vgrid_readDXBIN: Grid dimensions %d x %d x %d grid\n",
+	  thee->nx, thee->ny, thee->nz);
+	VJMPERR1((thee->nx > 0) && (thee->ny > 0) && (thee->nz > 0));
+
+	/* Get origin */
+	p = Vgrid_dxLine(p, end, tok, sizeof(tok));
+	VJMPERR2(p != VNULL);
+	if (sscanf(tok, "origin %lf %lf %lf",
+	  &(thee->xmin), &(thee->ymin), &(thee->zmin)) != 3) {
+		Vnm_print(2, "Vgrid_readDXBIN: Failed to read origin cell data.\n");
+		VJMPERR1(0);
 	}
-	//get Delta y
-	if(fgets(tok,VMAX_BUFSIZE, fd) == NULL){
-		printf("Vgrid_readDXBIN: Unexpected end of file\n");
-		fclose(fd);
-		return 0;
+	Vnm_print(0, "Vgrid_readDXBIN: Grid origin = (%g %g %g)\n",
+	  thee->xmin, thee->ymin, thee->zmin);
+
+	/* Get delta x, y and z */
+	p = Vgrid_dxLine(p, end, tok, sizeof(tok));
+	VJMPERR2(p != VNULL);
+	if (sscanf(tok, "delta %lf %lf %lf", &(thee->hx), &dtmp, &dtmp2) != 3) {
+		Vnm_print(2, "Vgrid_readDXBIN: Failed to read delta x data.\n");
+		VJMPERR1(0);
 	}
-	if(sscanf(tok,"delta %lf %lf %lf",&dtmp,&(thee->hy),&dtmp2)!=3){
-		printf("Vgrid_readDXBIN: Failed to read delta y data.\n");
-		fclose(fd);
-		return 0;
+	p = Vgrid_dxLine(p, end, tok, sizeof(tok));
+	VJMPERR2(p != VNULL);
+	if (sscanf(tok, "delta %lf %lf %lf", &dtmp, &(thee->hy), &dtmp2) != 3) {
+		Vnm_print(2, "Vgrid_readDXBIN: Failed to read delta y data.\n");
+		VJMPERR1(0);
 	}
-	//get Delta z
-	if(fgets(tok,VMAX_BUFSIZE, fd) == NULL){
-		printf("Vgrid_readDXBIN: Unexpected end of file.\n");
-		fclose(fd);
-		return 0;
+	p = Vgrid_dxLine(p, end, tok, sizeof(tok));
+	VJMPERR2(p != VNULL);
+	if (sscanf(tok, "delta %lf %lf %lf", &dtmp, &dtmp2, &(thee->hzed)) != 3) {
+		Vnm_print(2, "Vgrid_readDXBIN: Failed to read delta z data.\n");
+		VJMPERR1(0);
 	}
-	if(sscanf(tok,"delta %lf %lf %lf",&dtmp,&dtmp2,&(thee->hzed))!=3){
-		printf("Vgrid_readDXBIN: Failed to read delta z data.\n");
-		fclose(fd);
-		return 0;
+	Vnm_print(0, "Vgrid_readDXBIN: Grid spacings = (%g, %g, %g)\n",
+	  thee->hx, thee->hy, thee->hzed);
+
+	/* Skip the connections line */
+	p = Vgrid_dxLine(p, end, tok, sizeof(tok));
+	VJMPERR2(p != VNULL);
+
+	/* Scan the array line for the word binary; the data start right after */
+	p = Vgrid_dxLine(p, end, tok, sizeof(tok));
+	VJMPERR2(p != VNULL);
+	if (!strstr(tok, "binary")) {
+		Vnm_print(1, "Vgrid_readDXBIN: Binary tag not found. Will continue \
+to try to read binary data.\n");
 	}
-	printf("Vgrid_readDXBIN: Grid spacings = (%g, %g, %g)\n",thee->hx, thee->hy, thee->hzed);
 
-	//skip a line
-	if(fgets(tok,VMAX_BUFSIZE, fd) == NULL){
-		printf("Vgrid_readDXBIN: Unexpected end of file.\n");
-		fclose(fd);
-		return 0;
+	n = (size_t)thee->nx * thee->ny * thee->nz;
+	if ((size_t)(end - p) < n*sizeof(double)) {
+		Vnm_print(2, "Vgrid_readDXBIN: Failed to read doubles.\n");
+		VJMPERR2(0);
 	}
-
-	//scan the buffer for the word binary
-	if(fgets(tok,VMAX_BUFSIZE, fd) == NULL){
-		printf("Vgrid_readDXBIN: Unexpected end of file.\n");
-		fclose(fd);
-		return 0;
-	}
-	if(strstr(tok,"binary")){
-		isBinary = 1;
-	}
-	else{
-		printf("Vgrid_readDXBIN: Binary tag not found. Will continue to try to read binary data.");
-	}
-
-	u = (size_t)thee->nx * thee->ny * thee->nz;
-	int tot = thee->nx * thee->ny * thee->nz;
-
-	/*Allocate space for the data*/
-	printf("Vgrid_readDXBIN: allocating %d x %d x %d doubled for storage\n", thee->nx, thee->ny, thee->nz);
-	thee->data = NULL;
-	thee->data = (double *)malloc(tot*sizeof(double));
-
-	if(thee->data == NULL){
-		printf("Vgrid_readDXBIN: Unable to allocate space for data!\n");
-		fclose(fd);
+	data = p;
+
+	/* Allocate space for the data */
+	Vnm_print(0, "Vgrid_readDXBIN: allocating %d x %d x %d doubles for \
+storage\n", thee->nx, thee->ny, thee->nz);
+	thee->data = VNULL;
+	thee->data = (double *)Vmem_malloc(thee->mem, n, sizeof(double));
+	if (thee->data == VNULL) {
+		Vnm_print(2, "Vgrid_readDXBIN: Unable to allocate space for data!\n");
+		Vstring_unmapFile(buf, size);
 		return 0;
 	}
 
-	int counter = 0, r;
-
+	/* The file holds the values in i-j-k order with k fastest; the mapped
+	 * data need not be aligned, so values are copied bytewise */
+	#pragma omp parallel for schedule(static)
 	for (i=0; i<thee->nx; i++) {
+		size_t j, k;
+		const char *src = data + i*thee->ny*thee->nz*sizeof(double);
 		for (j=0; j<thee->ny; j++) {
 			for (k=0; k<thee->nz; k++) {
-				u = k*(thee->nx)*(thee->ny)+j*(thee->nx)+i;
-				r = fread(&dtmp,sizeof(double),1,fd);
-				(thee->data)[u] = dtmp;
-				if(r!= 1){
-					printf("Vgrid_readDXBIN: Failed to read doubles.\n");
-					return 0;
-				}
-				counter++;
+				memcpy(&((thee->data)[k*(thee->nx)*(thee->ny)+j*(thee->nx)+i]),
+				  src, sizeof(double));
+				src += sizeof(double);
 			}
 		}
 	}
 
-	if(counter!=tot){
-		printf("Vgrid_readDXBIN: Read double = %d not equal to items = %d\n",counter, tot);
-	}
-
 	/* calculate grid maxima */
 	thee->xmax = thee->xmin + (thee->nx-1)*thee->hx;
 	thee->ymax = thee->ymin + (thee->ny-1)*thee->hy;
 	thee->zmax = thee->zmin + (thee->nz-1)*thee->hzed;
 
-	fclose(fd);
+	Vstring_unmapFile(buf, size);
+
+	return 1;
+
+  VERROR1:
+	Vstring_unmapFile(buf, size);
+	Vnm_print(2, "Vgrid_readDXBIN:  Format problem with input file <%s>\n",
+	  fname);
+	return 0;
+
+  VERROR2:
+	Vstring_unmapFile(buf, size);
+	Vnm_print(2, "Vgrid_readDXBIN:  I/O problem with input file <%s>\n",
+	  fname);
+	return 0;
+}
+
+
+/** @brief  Magic string at the start of raw grid files
+ *  @ingroup  Vgrid */
+#define VGRID_RAW_MAGIC "APBSGRID"
+
+/** @brief  Endianness marker as written by the producing machine
+ *  @ingroup  Vgrid */
+#define VGRID_RAW_ENDIAN 0x01020304U
+
+/** @brief  Raw grid file format version
+ *  @ingroup  Vgrid */
+#define VGRID_RAW_VERSION 1
+
+/**
+ * @brief  Header of a raw grid file; 80 bytes, so the data that follow a
+ *         page-aligned mapping are aligned for doubles
+ * @ingroup  Vgrid
+ */
+typedef struct sVgridRawHeader {
+    char magic[8];  /**< VGRID_RAW_MAGIC (not terminated) */
+    unsigned int endian;  /**< VGRID_RAW_ENDIAN in the writer's byte order */
+    int version;  /**< VGRID_RAW_VERSION */
+    int dtype;  /**< Bytes per value (VGRID_RAW_FLOAT64/VGRID_RAW_FLOAT32) */
+    int nx;  /**< Grid points in x */
+    int ny;  /**< Grid points in y */
+    int nz;  /**< Grid points in z */
+    double xmin;  /**< x coordinate of lower grid corner */
+    double ymin;  /**< y coordinate of lower grid corner */
+    double zmin;  /**< z coordinate of lower grid corner */
+    double hx;  /**< Grid spacing in x direction */
+    double hy;  /**< Grid spacing in y direction */
+    double hzed;  /**< Grid spacing in z direction */
+} VgridRawHeader;
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_swapBytes
+//
+// Purpose:  Reverse the byte order of n items of the given size in place
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void Vgrid_swapBytes(void *buf, size_t size, size_t n) {
+
+    unsigned char *p, tmp;
+    size_t i, j;
+
+    p = (unsigned char *)buf;
+    for (i=0; i<n; i++, p+=size) {
+        for (j=0; j<size/2; j++) {
+            tmp = p[j];
+            p[j] = p[size-1-j];
+            p[size-1-j] = tmp;
+        }
+    }
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_partBox
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vgrid_partBox(int nx, int ny, int nz, double *pvec, int lo[3],
+  int hi[3]) {
+
+    int i, j, k;
+
+    if (pvec == VNULL) {
+        lo[0] = 0; lo[1] = 0; lo[2] = 0;
+        hi[0] = nx-1; hi[1] = ny-1; hi[2] = nz-1;
+        return 1;
+    }
+    lo[0] = nx; lo[1] = ny; lo[2] = nz;
+    hi[0] = -1; hi[1] = -1; hi[2] = -1;
+    for (k=0; k<nz; k++) {
+        for (j=0; j<ny; j++) {
+            for (i=0; i<nx; i++) {
+                if (pvec[IJK(i,j,k)] > 0.0) {
+                    lo[0] = VMIN2(lo[0], i); hi[0] = VMAX2(hi[0], i);
+                    lo[1] = VMIN2(lo[1], j); hi[1] = VMAX2(hi[1], j);
+                    lo[2] = VMIN2(lo[2], k); hi[2] = VMAX2(hi[2], k);
+                }
+            }
+        }
+    }
+    return (hi[0] >= 0);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_writeRaw
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vgrid_writeRaw(Vgrid *thee, const char *fname, int dtype,
+        double *pvec) {
+
+    VgridRawHeader header;
+    int lo[3], hi[3], nx, ny, nz, i, j, k, nxPART;
+    float *frow;
+    FILE *fp;
+
+    if (thee == VNULL) {
+        Vnm_print(2, "Vgrid_writeRaw:  Error -- got VNULL thee!\n");
+        VASSERT(0);
+    }
+    if (!(thee->ctordata || thee->readdata)) {
+        Vnm_print(2, "Vgrid_writeRaw:  Error -- no data available!\n");
+        VASSERT(0);
+    }
+    if ((dtype != VGRID_RAW_FLOAT64) && (dtype != VGRID_RAW_FLOAT32)) {
+        Vnm_print(2, "Vgrid_writeRaw:  Invalid data type (%d)!\n", dtype);
+        return 0;
+    }
+
+    nx = thee->nx;
+    ny = thee->ny;
+    nz = thee->nz;
+    if (!Vgrid_partBox(thee->nx, thee->ny, thee->nz, pvec, lo, hi)) {
+        Vnm_print(2, "Vgrid_writeRaw:  Empty partition!\n");
+        return 0;
+    }
+    nxPART = hi[0] - lo[0] + 1;
+    if ((nxPART != nx) || (hi[1]-lo[1]+1 != ny) || (hi[2]-lo[2]+1 != nz)) {
+        Vnm_print(0, "Vgrid_writeRaw:  printing only subset of domain\n");
+    }
+
+    memset(&header, 0, sizeof(VgridRawHeader));
+    memcpy(header.magic, VGRID_RAW_MAGIC, 8);
+    header.endian = VGRID_RAW_ENDIAN;
+    header.version = VGRID_RAW_VERSION;
+    header.dtype = dtype;
+    header.nx = nxPART;
+    header.ny = hi[1] - lo[1] + 1;
+    header.nz = hi[2] - lo[2] + 1;
+    header.xmin = thee->xmin + lo[0]*thee->hx;
+    header.ymin = thee->ymin + lo[1]*thee->hy;
+    header.zmin = thee->zmin + lo[2]*thee->hzed;
+    header.hx = thee->hx;
+    header.hy = thee->hy;
+    header.hzed = thee->hzed;
+
+    frow = VNULL;
+    fp = fopen(fname, "wb");
+    if (fp == VNULL) {
+        Vnm_print(2, "Vgrid_writeRaw:  Problem opening file %s\n", fname);
+        return 0;
+    }
+    VJMPERR1(fwrite(&header, sizeof(VgridRawHeader), 1, fp) == 1);
+
+    if (dtype == VGRID_RAW_FLOAT32) {
+        frow = (float *)Vmem_malloc(VNULL, nxPART, sizeof(float));
+    }
+    if ((dtype == VGRID_RAW_FLOAT64) && (nxPART == nx) &&
+      (header.ny == ny) && (header.nz == nz)) {
+        /* Whole grid:  the data are already in file order */
+        VJMPERR1(fwrite(thee->data, sizeof(double), (size_t)nx*ny*nz, fp)
+          == (size_t)nx*ny*nz);
+    } else {
+        for (k=lo[2]; k<=hi[2]; k++) {
+            for (j=lo[1]; j<=hi[1]; j++) {
+                if (frow == VNULL) {
+                    VJMPERR1(fwrite(&(thee->data[IJK(lo[0],j,k)]),
+                      sizeof(double), nxPART, fp) == (size_t)nxPART);
+                } else {
+                    for (i=0; i<nxPART; i++) {
+                        frow[i] = (float)(thee->data[IJK(lo[0]+i,j,k)]);
+                    }
+                    VJMPERR1(fwrite(frow, sizeof(float), nxPART, fp)
+                      == (size_t)nxPART);
+                }
+            }
+        }
+    }
+    if (frow != VNULL) Vmem_free(VNULL, nxPART, sizeof(float), (void **)&frow);
+    VJMPERR1(fclose(fp) == 0);
+
+    return 1;
+
+  VERROR1:
+    if (frow != VNULL) Vmem_free(VNULL, nxPART, sizeof(float), (void **)&frow);
+    fclose(fp);
+    Vnm_print(2, "Vgrid_writeRaw:  I/O problem writing <%s>\n", fname);
+    return 0;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_readRaw
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vgrid_readRaw(Vgrid *thee, const char *fname) {
+
+    VgridRawHeader header;
+    char *buf;
+    const char *src;
+    size_t size, n, u;
+    int swap;
+    float ftmp;
+
+    /* Check to see if the existing data is null and, if not, clear it out */
+    if (thee->data != VNULL) {
+        Vnm_print(1, "Vgrid_readRaw:  destroying existing data!\n");
+        Vgrid_freeData(thee);
+    }
+    thee->readdata = 1;
+    thee->ctordata = 0;
+
+    buf = Vstring_mapFile(fname, &size, 0);
+    if (buf == VNULL) {
+        Vnm_print(2, "Vgrid_readRaw: Problem opening file %s\n", fname);
+        return 0;
+    }
+
+    /* Check the header; a byte-reversed marker means a foreign-endian
+     * producer */
+    VJMPERR1(size >= sizeof(VgridRawHeader));
+    memcpy(&header, buf, sizeof(VgridRawHeader));
+    VJMPERR1(memcmp(header.magic, VGRID_RAW_MAGIC, 8) == 0);
+    swap = (header.endian != VGRID_RAW_ENDIAN);
+    if (swap) {
+        Vgrid_swapBytes(&(header.endian), sizeof(unsigned int), 1);
+        VJMPERR1(header.endian == VGRID_RAW_ENDIAN);
+        Vgrid_swapBytes(&(header.version), sizeof(int), 1);
+        Vgrid_swapBytes(&(header.dtype), sizeof(int), 1);
+        Vgrid_swapBytes(&(header.nx), sizeof(int), 1);
+        Vgrid_swapBytes(&(header.ny), sizeof(int), 1);
+        Vgrid_swapBytes(&(header.nz), sizeof(int), 1);
+        Vgrid_swapBytes(&(header.xmin), sizeof(double), 1);
+        Vgrid_swapBytes(&(header.ymin), sizeof(double), 1);
+        Vgrid_swapBytes(&(header.zmin), sizeof(double), 1);
+        Vgrid_swapBytes(&(header.hx), sizeof(double), 1);
+        Vgrid_swapBytes(&(header.hy), sizeof(double), 1);
+        Vgrid_swapBytes(&(header.hzed), sizeof(double), 1);
+    }
+    VJMPERR1(header.version == VGRID_RAW_VERSION);
+    VJMPERR1((header.dtype == VGRID_RAW_FLOAT64) ||
+      (header.dtype == VGRID_RAW_FLOAT32));
+    VJMPERR1((header.nx > 0) && (header.ny > 0) && (header.nz > 0));
+    n = (size_t)header.nx * header.ny * header.nz;
+    VJMPERR1(size - sizeof(VgridRawHeader) >= n*header.dtype);
+
+    thee->nx = header.nx;
+    thee->ny = header.ny;
+    thee->nz = header.nz;
+    thee->xmin = header.xmin;
+    thee->ymin = header.ymin;
+    thee->zmin = header.zmin;
+    thee->hx = header.hx;
+    thee->hy = header.hy;
+    thee->hzed = header.hzed;
+    thee->xmax = thee->xmin + (thee->nx-1)*thee->hx;
+    thee->ymax = thee->ymin + (thee->ny-1)*thee->hy;
+    thee->zmax = thee->zmin + (thee->nz-1)*thee->hzed;
+    Vnm_print(0, "Vgrid_readRaw:  Grid dimensions %d x %d x %d grid\n",
+      thee->nx, thee->ny, thee->nz);
+    src = buf + sizeof(VgridRawHeader);
+
+    if (!swap && (header.dtype == VGRID_RAW_FLOAT64)) {
+        /* Zero copy:  the data stay in the (read-only) mapping */
+        thee->data = (double *)src;
+        thee->mapbase = buf;
+        thee->mapsize = size;
+        return 1;
+    }
+
+    thee->data = (double *)Vmem_malloc(thee->mem, n, sizeof(double));
+    if (thee->data == VNULL) {
+        Vnm_print(2, "Vgrid_readRaw:  Unable to allocate space for data!\n");
+        Vstring_unmapFile(buf, size);
+        return 0;
+    }
+    if (header.dtype == VGRID_RAW_FLOAT64) {
+        memcpy(thee->data, src, n*sizeof(double));
+        Vgrid_swapBytes(thee->data, sizeof(double), n);
+    } else {
+        #pragma omp parallel for private(u, ftmp)
+        for (u=0; u<n; u++) {
+            memcpy(&ftmp, src + u*sizeof(float), sizeof(float));
+            if (swap) Vgrid_swapBytes(&ftmp, sizeof(float), 1);
+            thee->data[u] = (double)ftmp;
+        }
+    }
+    Vstring_unmapFile(buf, size);
+
+    return 1;
+
+  VERROR1:
+    Vstring_unmapFile(buf, size);
+    Vnm_print(2, "Vgrid_readRaw:  Format problem with input file <%s>\n",
+      fname);
+    return 0;
+}
+
+/** @brief  Number of grid values formatted per batch by Vgrid_writeDXData
+ *  @ingroup  Vgrid */
+#define VGRID_DXBATCH (1<<22)
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_formatExp
+//
+// Purpose:  The value is scaled to a 7-digit integer mantissa; when the
+//           scaled value is too close to a rounding boundary to be sure of
+//           the correctly rounded result (or is not finite or has an
+//           exponent the exact power table cannot reach) sprintf is used
+//           instead.
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vgrid_formatExp(double val, char *buf) {
+
+    static const double pow10[23] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    double aval, scaled, frac;
+    long mant;
+    int exp10, exp2, shift, len, i, aexp;
+    char tmp[32];
+
+    len = 0;
+    if (!(val == val) || (val - val != 0.0)) {
+        /* NaN or infinity */
+        return sprintf(buf, "%12.6e ", val);
+    }
+    aval = VABS(val);
+    if (signbit(val)) buf[len++] = '-';
+    if (aval == 0.0) {
+        memcpy(buf + len, "0.000000e+00 ", 13);
+        return len + 13;
+    }
+
+    /* Decimal exponent estimate from the binary one; off by at most one */
+    frexp(aval, &exp2);
+    exp10 = (int)floor((exp2 - 1)*0.30102999566398120);
+    for (i=0; i<3; i++) {
+        shift = 6 - exp10;
+        if ((shift > 22) || (shift < -22)) {
+            return sprintf(buf, "%12.6e ", val);
+        }
+        if (shift >= 0) scaled = aval*pow10[shift];
+        else scaled = aval/pow10[-shift];
+        if (scaled < 1e6) exp10--;
+        else if (scaled >= 1e7) exp10++;
+        else break;
+    }
+    if ((scaled < 1e6) || (scaled >= 1e7)) {
+        return sprintf(buf, "%12.6e ", val);
+    }
+    mant = (long)scaled;
+    frac = scaled - (double)mant;
+    if (VABS(frac - 0.5) < 1e-6) {
+        return sprintf(buf, "%12.6e ", val);
+    }
+    if (frac > 0.5) mant++;
+    if (mant == 10000000) {
+        mant = 1000000;
+        exp10++;
+    }
+
+    /* Mantissa digits */
+    for (i=6; i>=0; i--) {
+        tmp[i] = (char)('0' + (mant % 10));
+        mant /= 10;
+    }
+    buf[len++] = tmp[0];
+    buf[len++] = '.';
+    for (i=1; i<7; i++) buf[len++] = tmp[i];
+
+    /* Exponent (at least two digits) */
+    buf[len++] = 'e';
+    buf[len++] = (exp10 < 0) ? '-' : '+';
+    aexp = (exp10 < 0) ? -exp10 : exp10;
+    if (aexp >= 100) buf[len++] = (char)('0' + aexp/100);
+    buf[len++] = (char)('0' + (aexp/10)%10);
+    buf[len++] = (char)('0' + aexp%10);
+    buf[len++] = ' ';
+
+    return len;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_formatDXHeader
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC size_t Vgrid_formatDXHeader(char *buf, size_t len, const char *title,
+  int nx, int ny, int nz, double xmin, double ymin, double zmin,
+  double hx, double hy, double hzed, int binary) {
+
+    int n;
+
+    n = snprintf(buf, len,
+            "# Data from %s\n"
+            "# \n"
+            "# %s\n"
+            "# \n"
+            "object 1 class gridpositions counts %d %d %d\n"
+            "origin %12.*e %12.*e %12.*e\n"
+            "delta %12.*e %12.*e %12.*e\n"
+            "delta %12.*e %12.*e %12.*e\n"
+            "delta %12.*e %12.*e %12.*e\n"
+            "object 2 class gridconnections counts %d %d %d\n"
+            "object 3 class array type double rank 0 items %lu %sdata follows\n",
+            PACKAGE_STRING, title, nx, ny, nz,
+            VGRID_DIGITS, xmin, VGRID_DIGITS, ymin, VGRID_DIGITS, zmin,
+            VGRID_DIGITS, hx, VGRID_DIGITS, 0.0, VGRID_DIGITS, 0.0,
+            VGRID_DIGITS, 0.0, VGRID_DIGITS, hy, VGRID_DIGITS, 0.0,
+            VGRID_DIGITS, 0.0, VGRID_DIGITS, 0.0, VGRID_DIGITS, hzed,
+            nx, ny, nz, (unsigned long)nx*ny*nz, binary ? "binary " : "");
+    if ((n < 0) || ((size_t)n >= len)) return 0;
+
+    return (size_t)n;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_formatDXTrailer
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC size_t Vgrid_formatDXTrailer(char *buf, size_t len, int newline) {
+
+    int n;
+
+    n = snprintf(buf, len, "%sattribute \"dep\" string \"positions\"\n"
+            "object \"regular positions regular connections\" class field\n"
+            "component \"positions\" value 1\n"
+            "component \"connections\" value 2\n"
+            "component \"data\" value 3\n", newline ? "\n" : "");
+    if ((n < 0) || ((size_t)n >= len)) return 0;
+
+    return (size_t)n;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_writeDXData
+//
+// Purpose:  Write the data section of an OpenDX file:  values in i-j-k
+//           order (k fastest), "%12.6e " each, three per line, restricted
+//           to points with pvec > 0 if pvec is given.  For ASCII sockets
+//           the x-slabs are formatted in parallel into memory and written
+//           in large blocks; the output is byte-for-byte the same as the
+//           value-by-value Vio_printf loop used for other formats.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void Vgrid_writeDXData(Vgrid *thee, Vio *sock, const char *iofmt,
+  double *pvec) {
+
+    int nx, ny, nz, i, j, k, ibeg, iend, nbatch;
+    size_t icol, u, ntot, *start, *offset, *length, nbuf, pos;
+    char *buf, *out;
+    int *count;
+
+    nx = thee->nx;
+    ny = thee->ny;
+    nz = thee->nz;
+
+    if (Vstring_strcasecmp(iofmt, "ASC") != 0) {
+        icol = 0;
+        for (i=0; i<nx; i++) {
+            for (j=0; j<ny; j++) {
+                for (k=0; k<nz; k++) {
+                    u = k*(nx)*(ny)+j*(nx)+i;
+                    if ((pvec != VNULL) && !(pvec[u] > 0.0)) continue;
+                    Vio_printf(sock, "%12.6e ", thee->data[u]);
+                    icol++;
+                    if (icol == 3) {
+                        icol = 0;
+                        Vio_printf(sock, "\n");
+                    }
+                }
+            }
+        }
+        if (icol != 0) Vio_printf(sock, "\n");
+        return;
+    }
+
+    /* Number of values written from each x-slab and the ordinal of the
+     * first one (which fixes where the line breaks fall) */
+    count = (int *)Vmem_malloc(thee->mem, nx, sizeof(int));
+    start = (size_t *)Vmem_malloc(thee->mem, nx+1, sizeof(size_t));
+    offset = (size_t *)Vmem_malloc(thee->mem, nx, sizeof(size_t));
+    length = (size_t *)Vmem_malloc(thee->mem, nx, sizeof(size_t));
+#pragma omp parallel for default(shared) private(i,j,k,u) schedule(static)
+    for (i=0; i<nx; i++) {
+        if (pvec == VNULL) {
+            count[i] = ny*nz;
+        } else {
+            count[i] = 0;
+            for (k=0; k<nz; k++) {
+                for (j=0; j<ny; j++) {
+                    u = k*(nx)*(ny)+j*(nx)+i;
+                    if (pvec[u] > 0.0) count[i]++;
+                }
+            }
+        }
+    }
+    start[0] = 0;
+    for (i=0; i<nx; i++) start[i+1] = start[i] + count[i];
+    ntot = start[nx];
+
+    /* Format batches of slabs in parallel, then write them in order */
+    nbatch = VMAX2(1, VGRID_DXBATCH/VMAX2(1, ny*nz));
+    nbatch = VMIN2(nbatch, nx);
+    nbuf = 0;
+    for (ibeg=0; ibeg<nx; ibeg+=nbatch) {
+        iend = VMIN2(ibeg + nbatch, nx);
+        nbuf = VMAX2(nbuf, (start[iend] - start[ibeg])*VGRID_DXVALLEN);
+    }
+    buf = (char *)Vmem_malloc(thee->mem, nbuf + 1, sizeof(char));
+
+    for (ibeg=0; ibeg<nx; ibeg+=nbatch) {
+        iend = VMIN2(ibeg + nbatch, nx);
+        for (i=ibeg; i<iend; i++) {
+            offset[i] = (start[i] - start[ibeg])*VGRID_DXVALLEN;
+        }
+#pragma omp parallel for default(shared) private(i,j,k,u,icol,out,pos) schedule(dynamic,1)
+        for (i=ibeg; i<iend; i++) {
+            out = buf + offset[i];
+            pos = 0;
+            icol = start[i];
+            for (j=0; j<ny; j++) {
+                for (k=0; k<nz; k++) {
+                    u = k*(nx)*(ny)+j*(nx)+i;
+                    if ((pvec != VNULL) && !(pvec[u] > 0.0)) continue;
+                    pos += Vgrid_formatExp(thee->data[u], out + pos);
+                    icol++;
+                    if ((icol % 3) == 0) out[pos++] = '\n';
+                }
+            }
+            length[i] = pos;
+        }
+        for (i=ibeg; i<iend; i++) {
+            if (length[i] > 0) Vio_write(sock, buf + offset[i], (int)length[i]);
+        }
+    }
+    if ((ntot % 3) != 0) Vio_printf(sock, "\n");
+
+    Vmem_free(thee->mem, nbuf + 1, sizeof(char), (void **)&buf);
+    Vmem_free(thee->mem, nx, sizeof(int), (void **)&count);
+    Vmem_free(thee->mem, nx+1, sizeof(size_t), (void **)&start);
+    Vmem_free(thee->mem, nx, sizeof(size_t), (void **)&offset);
+    Vmem_free(thee->mem, nx, sizeof(size_t), (void **)&length);
+}
+
+#ifdef HAVE_ZLIB
+#define off_t long
+#include "zlib.h"
+#endif
+
+/** @brief  Target number of values per gzip member written by Vgrid_writeGZ
+ *  @ingroup  Vgrid */
+#define VGRID_GZBLOCK (1<<17)
+
+/** @brief  Maximum number of data members; the member index has to fit in
+ *          the 64 kB extra field of the first gzip header
+ *  @ingroup  Vgrid */
+#define VGRID_GZMAXBLOCK 8000
+
+/** @brief  Number of gzip members compressed concurrently by Vgrid_writeGZ
+ *  @ingroup  Vgrid */
+#define VGRID_GZBATCH 32
+
+/** @brief  Version of the member index stored in the "AP" extra subfield
+ *  @ingroup  Vgrid */
+#define VGRID_GZINDEX_VERSION 1
+
+#ifdef HAVE_ZLIB
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_putU32, Vgrid_getU32
+//
+// Purpose:  Store and load little-endian 32-bit words (gzip byte order)
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void Vgrid_putU32(unsigned char *p, unsigned long val) {
+
+    p[0] = (unsigned char)(val & 0xff);
+    p[1] = (unsigned char)((val >> 8) & 0xff);
+    p[2] = (unsigned char)((val >> 16) & 0xff);
+    p[3] = (unsigned char)((val >> 24) & 0xff);
+}
+
+VPRIVATE unsigned long Vgrid_getU32(const unsigned char *p) {
+
+    return ((unsigned long)p[0]) | ((unsigned long)p[1] << 8) |
+      ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_gzDeflate
+//
+// Purpose:  Compress a buffer into one complete gzip member, optionally
+//           with a custom gzip header; on input *nout is the capacity of
+//           out, on output the member length
+//
+// Returns:  1 if successful, 0 otherwise
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vgrid_gzDeflate(const char *in, size_t nin, unsigned char *out,
+        size_t *nout, gz_header *head) {
+
+    z_stream strm;
+    int rc;
+
+    memset(&strm, 0, sizeof(z_stream));
+    if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15+16, 8,
+      Z_DEFAULT_STRATEGY) != Z_OK) return 0;
+    if ((head != VNULL) && (deflateSetHeader(&strm, head) != Z_OK)) {
+        deflateEnd(&strm);
+        return 0;
+    }
+    strm.next_in = (Bytef *)in;
+    strm.avail_in = (uInt)nin;
+    strm.next_out = out;
+    strm.avail_out = (uInt)(*nout);
+    rc = deflate(&strm, Z_FINISH);
+    *nout = strm.total_out;
+    deflateEnd(&strm);
+
+    return (rc == Z_STREAM_END);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_gzInflate
+//
+// Purpose:  Decompress one complete gzip member; on input *nout is the
+//           capacity of out, on output the decompressed length
+//
+// Returns:  1 if successful, 0 otherwise
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vgrid_gzInflate(const unsigned char *in, size_t nin, char *out,
+        size_t *nout) {
+
+    z_stream strm;
+    int rc;
+
+    memset(&strm, 0, sizeof(z_stream));
+    if (inflateInit2(&strm, 15+16) != Z_OK) return 0;
+    strm.next_in = (Bytef *)in;
+    strm.avail_in = (uInt)nin;
+    strm.next_out = (Bytef *)out;
+    strm.avail_out = (uInt)(*nout);
+    rc = inflate(&strm, Z_FINISH);
+    *nout = strm.total_out;
+    inflateEnd(&strm);
+
+    return (rc == Z_STREAM_END);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_readGZIndexed
+//
+// Purpose:  Read a file written by Vgrid_writeGZ using the member index in
+//           the extra field of its first gzip header (subfield "AP":
+//           version, number of data members, length of the header member,
+//           then the compressed length and value count of every data
+//           member).  The data members are inflated and parsed in parallel.
+//
+// Returns:  1 if successful, 0 on error, -1 if the file has no index
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vgrid_readGZIndexed(Vgrid *thee, const char *fname) {
+
+    char *buf, *text;
+    const unsigned char *ub, *index;
+    const char *p;
+    size_t size, xlen, pos, len, ntext, n, *cbeg, *vbeg;
+    unsigned long items;
+    int ib, nblock, nerr, rc;
+
+    buf = Vstring_mapFile(fname, &size, 0);
+    if (buf == VNULL) return -1;
+    ub = (const unsigned char *)buf;
+
+    /* Look for the index subfield */
+    index = VNULL;
+    len = 0;
+    if ((size >= 12) && (ub[0] == 0x1f) && (ub[1] == 0x8b) && (ub[2] == 8) &&
+      (ub[3] & 0x04)) {
+        xlen = (size_t)ub[10] | ((size_t)ub[11] << 8);
+        for (pos=12; (pos + 4 <= 12 + xlen) && (pos + 4 <= size); ) {
+            len = (size_t)ub[pos+2] | ((size_t)ub[pos+3] << 8);
+            if ((ub[pos] == 'A') && (ub[pos+1] == 'P') && (len >= 12) &&
+              (pos + 4 + len <= size)) {
+                index = ub + pos + 4;
+                break;
+            }
+            pos += 4 + len;
+        }
+    }
+    if ((index == VNULL) ||
+      (Vgrid_getU32(index) != VGRID_GZINDEX_VERSION)) {
+        Vstring_unmapFile(buf, size);
+        return -1;
+    }
+    nblock = (int)Vgrid_getU32(index + 4);
+    if ((nblock < 1) || (len < 12 + 8*(size_t)nblock)) {
+        Vstring_unmapFile(buf, size);
+        return -1;
+    }
+
+    /* Member offsets and the ordinal of the first value of each member */
+    cbeg = (size_t *)Vmem_malloc(VNULL, nblock+1, sizeof(size_t));
+    vbeg = (size_t *)Vmem_malloc(VNULL, nblock+1, sizeof(size_t));
+    cbeg[0] = Vgrid_getU32(index + 8);
+    vbeg[0] = 0;
+    for (ib=0; ib<nblock; ib++) {
+        cbeg[ib+1] = cbeg[ib] + Vgrid_getU32(index + 12 + 8*ib);
+        vbeg[ib+1] = vbeg[ib] + Vgrid_getU32(index + 16 + 8*ib);
+    }
+    VJMPERR2(cbeg[nblock] <= size);
+
+    /* The first member holds the DX header */
+    ntext = 1<<16;
+    text = (char *)Vmem_malloc(VNULL, ntext, sizeof(char));
+    len = ntext;
+    rc = Vgrid_gzInflate(ub, cbeg[0], text, &len);
+    if (rc) {
+        p = text;
+        rc = Vgrid_dxHeader(thee, &p, text + len, &items);
+    }
+    Vmem_free(VNULL, ntext, sizeof(char), (void **)&text);
+    VJMPERR1(rc == 1);
+    VJMPERR1((thee->nx > 0) && (thee->ny > 0) && (thee->nz > 0));
+    n = (size_t)thee->nx * thee->ny * thee->nz;
+    VJMPERR1((n == items) && (n == vbeg[nblock]));
+
+    Vnm_print(0, "Vgrid_readGZ:  allocating %d x %d x %d doubles for storage\n",
+      thee->nx, thee->ny, thee->nz);
+    thee->data = (double *)Vmem_malloc(thee->mem, n, sizeof(double));
+    if (thee->data == VNULL) {
+        Vnm_print(2, "Vgrid_readGZ:  Unable to allocate space for data!\n");
+        Vmem_free(VNULL, nblock+1, sizeof(size_t), (void **)&cbeg);
+        Vmem_free(VNULL, nblock+1, sizeof(size_t), (void **)&vbeg);
+        Vstring_unmapFile(buf, size);
+        return 0;
+    }
+
+    /* Inflate and convert the data members; values are in i-j-k order
+     * with k fastest */
+    nerr = 0;
+    #pragma omp parallel for schedule(dynamic,1) reduction(+:nerr)
+    for (ib=0; ib<nblock; ib++) {
+        size_t cap, nout, o, i, j, k;
+        const char *q, *qend;
+        char *block;
+        double dtmp;
+
+        cap = (vbeg[ib+1] - vbeg[ib])*VGRID_DXVALLEN + 2;
+        block = (char *)malloc(cap);
+        nout = cap;
+        if ((block == VNULL) || !Vgrid_gzInflate(ub + cbeg[ib],
+          cbeg[ib+1] - cbeg[ib], block, &nout)) {
+            nerr++;
+            if (block != VNULL) free(block);
+            continue;
+        }
+        qend = block + nout;
+        q = Vgrid_dxSkip(block, qend);
+        k = vbeg[ib] % thee->nz;
+        j = (vbeg[ib] / thee->nz) % thee->ny;
+        i = vbeg[ib] / ((size_t)thee->nz * thee->ny);
+        for (o=vbeg[ib]; o<vbeg[ib+1]; o++) {
+            q = (q < qend) ? Vgrid_dxParse(q, qend, &dtmp) : VNULL;
+            if (q == VNULL) {
+                nerr++;
+                break;
+            }
+            (thee->data)[k*(thee->nx)*(thee->ny)+j*(thee->nx)+i] = dtmp;
+            if (++k == (size_t)thee->nz) {
+                k = 0;
+                if (++j == (size_t)thee->ny) {
+                    j = 0;
+                    i++;
+                }
+            }
+            q = Vgrid_dxSkip(q, qend);
+        }
+        free(block);
+    }
+    VJMPERR1(nerr == 0);
+
+    /* calculate grid maxima */
+    thee->xmax = thee->xmin + (thee->nx-1)*thee->hx;
+    thee->ymax = thee->ymin + (thee->ny-1)*thee->hy;
+    thee->zmax = thee->zmin + (thee->nz-1)*thee->hzed;
+
+    Vmem_free(VNULL, nblock+1, sizeof(size_t), (void **)&cbeg);
+    Vmem_free(VNULL, nblock+1, sizeof(size_t), (void **)&vbeg);
+    Vstring_unmapFile(buf, size);
+
+    return 1;
+
+  VERROR1:
+    Vmem_free(VNULL, nblock+1, sizeof(size_t), (void **)&cbeg);
+    Vmem_free(VNULL, nblock+1, sizeof(size_t), (void **)&vbeg);
+    Vstring_unmapFile(buf, size);
+    Vnm_print(2, "Vgrid_readGZ:  Format problem with input file <%s>\n",
+      fname);
+    return 0;
+
+  VERROR2:
+    Vmem_free(VNULL, nblock+1, sizeof(size_t), (void **)&cbeg);
+    Vmem_free(VNULL, nblock+1, sizeof(size_t), (void **)&vbeg);
+    Vstring_unmapFile(buf, size);
+    Vnm_print(2, "Vgrid_readGZ:  I/O problem with input file <%s>\n",
+      fname);
+    return 0;
+}
+#endif
+
+/* ///////////////////////////////////////////////////////////////////////////
+ // Routine:  Vgrid_readGZ
+ //
+ // Author:   David Gohara
+ /////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vgrid_readGZ(Vgrid *thee, const char *fname) {
+
+#ifdef HAVE_ZLIB
+    size_t i, j, k, u;
+    size_t len; // Temporary counter variable for loop conditionals
+    size_t header, incr;
+    double *temp;
+    double dtmp1, dtmp2, dtmp3;
+    gzFile infile;
+    char line[VMAX_ARGLEN];
+    int rc;
+
+    header = 0;
+
+    /* Check to see if the existing data is null and, if not, clear it out */
+    if (thee->data != VNULL) {
+        Vnm_print(1, "%s:  destroying existing data!\n", __func__);
+        Vgrid_freeData(thee);
+        }
+
+    thee->readdata = 1;
+    thee->ctordata = 0;
+
+    /* Files from Vgrid_writeGZ index their members; inflate those in
+     * parallel */
+    rc = Vgrid_readGZIndexed(thee, fname);
+    if (rc >= 0) return (rc == 1) ? VRC_SUCCESS : VRC_FAILURE;
+
+    infile = gzopen(fname, "rb");
+    if (infile == Z_NULL) {
+        Vnm_print(2, "%s:  Problem opening compressed file %s\n", __func__, fname);
+        return VRC_FAILURE;
+    }
+
+    thee->hx = 0.0;
+    thee->hy = 0.0;
+    thee->hzed = 0.0;
+
+    //read data here
+    while (header < 7) {
+        if(gzgets(infile, line, VMAX_ARGLEN) == Z_NULL){
+            return VRC_FAILURE;
+        }
+
+        // Skip comments and newlines
+        if(strncmp(line, "#", 1) == 0) continue;
+        if(line[0] == '\n') continue;
+
+        switch (header) {
+            case 0:
+                sscanf(line, "object 1 class gridpositions counts %d %d %d",
+                       &(thee->nx),&(thee->ny),&(thee->nz));
+                break;
+            case 1:
+                sscanf(line, "origin %lf %lf %lf",
+                       &(thee->xmin),&(thee->ymin),&(thee->zmin));
+                break;
+            case 2:
+            case 3:
+            case 4:
+                sscanf(line, "delta %lf %lf %lf",&dtmp1,&dtmp2,&dtmp3);
+                thee->hx += dtmp1;
+                thee->hy += dtmp2;
+                thee->hzed += dtmp3;
+                break;
+            default:
+                break;
+        }
+
+        header++;
+    }
+
+    /* Allocate space for the data */
+    Vnm_print(0, "%s:  allocating %d x %d x %d doubles for storage\n",
+        __func__, thee->nx, thee->ny, thee->nz);
+    len = thee->nx * thee->ny * thee->nz;
+
+    thee->data = VNULL;
+    thee->data = Vmem_malloc(thee->mem, len, sizeof(double));
+    if (thee->data == VNULL) {
+        Vnm_print(2, "%s:  Unable to allocate space for data!\n", __func__);
+        return 0;
+    }
+
+    /* Allocate a temporary buffer to store the compressed
+     * data into (column major order). Add 2 to ensure the buffer is
+     * big enough to take extra data on the final read loop.
+     */
+    temp = (double *)malloc(len * (2 * sizeof(double)));
+
+    for (i = 0; i < len; i += 3){
+        memset(&line, 0, sizeof(line));
+        gzgets(infile, line, VMAX_ARGLEN);
+        sscanf(line, "%lf %lf %lf", &temp[i], &temp[i+1], &temp[i+2]);
+    }
+
+    /* Now move the data to row major order */
+    incr = 0;
+    for (i=0; i<thee->nx; i++) {
+        for (j=0; j<thee->ny; j++) {
+            for (k=0; k<thee->nz; k++) {
+                u = k*(thee->nx)*(thee->ny)+j*(thee->nx)+i;
+                (thee->data)[u] = temp[incr++];
+            }
+        }
+    }
+
+    /* calculate grid maxima */
+    thee->xmax = thee->xmin + (thee->nx-1)*thee->hx;
+    thee->ymax = thee->ymin + (thee->ny-1)*thee->hy;
+    thee->zmax = thee->zmin + (thee->nz-1)*thee->hzed;
+
+    /* Close off the socket */
+    gzclose(infile);
+    free(temp);
+#else
 
-	return 1;
+    Vnm_print(0, "WARNING\n");
+    Vnm_print(0, "Vgrid_readGZ:  gzip read/write support is disabled in this build\n");
+    Vnm_print(0, "Vgrid_readGZ:  configure and compile without the --disable-zlib flag.\n");
+    Vnm_print(0, "WARNING\n");
+#endif
+    return VRC_SUCCESS;
 }
 
-
 /* ///////////////////////////////////////////////////////////////////////////
  // Routine:  Vgrid_writeGZ
  //
+ // Purpose:  Write gzipped OpenDX.  The data are cut into blocks of whole
+ //           x-slabs which are formatted and compressed on all threads,
+ //           each into its own gzip member; concatenated members are a
+ //           valid gzip file.  The first member's header carries an index
+ //           of the member sizes so Vgrid_readGZ can inflate them in
+ //           parallel as well.
+ //
  // Author:   Nathan Baker
  /////////////////////////////////////////////////////////////////////////// */
-VPUBLIC void Vgrid_writeGZ(Vgrid *thee, const char *iodev, const char *iofmt,
+VPUBLIC int Vgrid_writeGZ(Vgrid *thee, const char *iodev, const char *iofmt,
                             const char *thost, const char *fname, char *title, double *pvec) {
 
 #ifdef HAVE_ZLIB
-    double xmin, ymin, zmin, hx, hy, hzed;
-
-    int nx, ny, nz, nxPART, nyPART, nzPART;
-    int usepart, gotit;
-    size_t icol, i, j, k, u;
-    double x, y, z, xminPART, yminPART, zminPART;
-
-    size_t txyz;
-    double txmin, tymin, tzmin;
-
-    char header[8196];
-    char footer[8196];
-    char line[80];
-    char newline[] = "\n";
-    gzFile outfile;
-    char precFormat[VMAX_BUFSIZE];
+    int nx, ny, nz, nxPART, nyPART, nzPART, lo[3], hi[3];
+    int i, j, k, ib, nblock, bbeg, bend, nerr, *slab;
+    size_t u, ntot, target, xlen, nout, *start, *blen;
+    char header[8196], footer[8196], tmpname[VMAX_ARGLEN];
+    unsigned char *extra, *member, *out[VGRID_GZBATCH];
+    gz_header head;
+    FILE *fp;
 
     if (thee == VNULL) {
         Vnm_print(2, "Vgrid_writeGZ:  Error -- got VNULL thee!\n");
@@ -1038,163 +2442,664 @@ VPUBLIC void Vgrid_writeGZ(Vgrid *thee, const char *iodev, const char *iofmt,
         VASSERT(0);
     }
 
-    hx = thee->hx;
-    hy = thee->hy;
-    hzed = thee->hzed;
     nx = thee->nx;
     ny = thee->ny;
     nz = thee->nz;
-    xmin = thee->xmin;
-    ymin = thee->ymin;
-    zmin = thee->zmin;
-
-    if (pvec == VNULL) usepart = 0;
-    else usepart = 1;
 
-    /* Set up the virtual socket */
-    Vnm_print(0, "Vgrid_writeGZ:  Opening file...\n");
-    outfile = gzopen(fname, "wb");
+    /* Get the lower corner and number of grid points for the local
+     * partition */
+    if (!Vgrid_partBox(thee->nx, thee->ny, thee->nz, pvec, lo, hi)) {
+        Vnm_print(2, "Vgrid_writeGZ:  Empty partition!\n");
+        return 0;
+    }
+    nxPART = hi[0] - lo[0] + 1;
+    nyPART = hi[1] - lo[1] + 1;
+    nzPART = hi[2] - lo[2] + 1;
+    if ((nxPART != nx) || (nyPART != ny) || (nzPART != nz)) {
+        Vnm_print(0, "Vgrid_writeGZ:  printing only subset of domain\n");
+    }
 
-    if (usepart) {
-        /* Get the lower corner and number of grid points for the local
-         * partition */
-        xminPART = VLARGE;
-        yminPART = VLARGE;
-        zminPART = VLARGE;
-        nxPART = 0;
-        nyPART = 0;
-        nzPART = 0;
-        /* First, search for the lower corner */
+    /* Number of values written from each x-slab and the ordinal of the
+     * first one */
+    slab = (int *)Vmem_malloc(thee->mem, nx+1, sizeof(int));
+    start = (size_t *)Vmem_malloc(thee->mem, nx+1, sizeof(size_t));
+    #pragma omp parallel for private(i, j, k, u) schedule(static)
+    for (i=0; i<nx; i++) {
+        size_t count = 0;
         for (k=0; k<nz; k++) {
-            z = k*hzed + zmin;
             for (j=0; j<ny; j++) {
-                y = j*hy + ymin;
-                for (i=0; i<nx; i++) {
-                    x = i*hx + xmin;
-                    if (pvec[IJK(i,j,k)] > 0.0) {
-                        if (x < xminPART) xminPART = x;
-                        if (y < yminPART) yminPART = y;
-                        if (z < zminPART) zminPART = z;
-                    }
-                }
+                u = k*(nx)*(ny)+j*(nx)+i;
+                if ((pvec == VNULL) || (pvec[u] > 0.0)) count++;
             }
         }
-        /* Now search for the number of grid points in the z direction */
-        for (k=0; k<nz; k++) {
-            gotit = 0;
-            for (j=0; j<ny; j++) {
-                for (i=0; i<nx; i++) {
-                    if (pvec[IJK(i,j,k)] > 0.0) {
-                        gotit = 1;
-                        break;
+        start[i+1] = count;
+    }
+    start[0] = 0;
+    for (i=0; i<nx; i++) start[i+1] += start[i];
+    ntot = start[nx];
+
+    /* Group slabs into blocks of at least target values */
+    target = VMAX2(VGRID_GZBLOCK, ntot/(VGRID_GZMAXBLOCK - 1) + 1);
+    nblock = 0;
+    slab[0] = 0;
+    for (i=0; i<nx; i++) {
+        if ((start[i+1] - start[slab[nblock]] >= target) || (i == nx-1)) {
+            slab[++nblock] = i + 1;
+        }
+    }
+    blen = (size_t *)Vmem_malloc(thee->mem, nblock, sizeof(size_t));
+
+    /* The index lives in an "AP" subfield of the first member's header;
+     * it is filled in once the member sizes are known */
+    xlen = 4 + 12 + 8*(size_t)nblock;
+    extra = (unsigned char *)Vmem_malloc(thee->mem, xlen, sizeof(char));
+    memset(extra, 0, xlen);
+    extra[0] = 'A';
+    extra[1] = 'P';
+    extra[2] = (unsigned char)((xlen - 4) & 0xff);
+    extra[3] = (unsigned char)(((xlen - 4) >> 8) & 0xff);
+    Vgrid_putU32(extra + 4, VGRID_GZINDEX_VERSION);
+    Vgrid_putU32(extra + 8, (unsigned long)nblock);
+    memset(&head, 0, sizeof(gz_header));
+    head.os = 255;
+    head.extra = extra;
+    head.extra_len = (uInt)xlen;
+
+    /* Write off the title */
+    Vgrid_formatDXHeader(header, sizeof(header), title, nxPART, nyPART,
+      nzPART, thee->xmin + lo[0]*thee->hx, thee->ymin + lo[1]*thee->hy,
+      thee->zmin + lo[2]*thee->hzed, thee->hx, thee->hy, thee->hzed, 0);
+    Vgrid_formatDXTrailer(footer, sizeof(footer), (ntot % 3) != 0);
+
+    /* Write under a temporary name and rename the file into place once
+     * it is complete, so a failed write never leaves a truncated file */
+    Vnm_print(0, "Vgrid_writeGZ:  Opening file...\n");
+    fp = VNULL;
+    if (snprintf(tmpname, VMAX_ARGLEN, "%s.%lx.tmp", fname,
+      (unsigned long)thee) < VMAX_ARGLEN) fp = fopen(tmpname, "wb");
+    if (fp == VNULL) {
+        Vnm_print(2, "Vgrid_writeGZ:  Problem opening file %s\n", fname);
+        Vmem_free(thee->mem, nx+1, sizeof(int), (void **)&slab);
+        Vmem_free(thee->mem, nx+1, sizeof(size_t), (void **)&start);
+        Vmem_free(thee->mem, nblock, sizeof(size_t), (void **)&blen);
+        Vmem_free(thee->mem, xlen, sizeof(char), (void **)&extra);
+        return 0;
+    }
+    nerr = 0;
+    nout = compressBound(sizeof(header)) + 64 + xlen;
+    member = (unsigned char *)Vmem_malloc(thee->mem, nout, sizeof(char));
+    if (Vgrid_gzDeflate(header, strlen(header), member, &nout, &head)) {
+        Vgrid_putU32(extra + 12, (unsigned long)nout);
+        if (fwrite(member, 1, nout, fp) != nout) nerr++;
+    } else nerr++;
+    Vmem_free(thee->mem, compressBound(sizeof(header)) + 64 + xlen,
+      sizeof(char), (void **)&member);
+
+    /* Now write the data, VGRID_GZBATCH members at a time */
+    for (bbeg=0; bbeg<nblock; bbeg+=VGRID_GZBATCH) {
+        bend = VMIN2(bbeg + VGRID_GZBATCH, nblock);
+        #pragma omp parallel for private(i, j, k, u) schedule(dynamic,1) \
+          reduction(+:nerr)
+        for (ib=bbeg; ib<bend; ib++) {
+            size_t pos, icol, cap;
+            char *text;
+            cap = (start[slab[ib+1]] - start[slab[ib]])*VGRID_DXVALLEN + 1;
+            text = (char *)malloc(cap);
+            out[ib-bbeg] = VNULL;
+            if (text == VNULL) {
+                nerr++;
+                continue;
+            }
+            pos = 0;
+            for (i=slab[ib]; i<slab[ib+1]; i++) {
+                icol = start[i];
+                for (j=0; j<ny; j++) {
+                    for (k=0; k<nz; k++) {
+                        u = k*(nx)*(ny)+j*(nx)+i;
+                        if ((pvec != VNULL) && !(pvec[u] > 0.0)) continue;
+                        pos += Vgrid_formatExp(thee->data[u], text + pos);
+                        icol++;
+                        if ((icol % 3) == 0) text[pos++] = '\n';
                     }
                 }
-                if (gotit) break;
             }
-            if (gotit) nzPART++;
+            blen[ib] = compressBound(pos) + 64;
+            out[ib-bbeg] = (unsigned char *)malloc(blen[ib]);
+            if ((out[ib-bbeg] == VNULL) ||
+              !Vgrid_gzDeflate(text, pos, out[ib-bbeg], &(blen[ib]), VNULL)) {
+                nerr++;
+            }
+            free(text);
         }
-        /* Now search for the number of grid points in the y direction */
-        for (j=0; j<ny; j++) {
-            gotit = 0;
-            for (k=0; k<nz; k++) {
-                for (i=0; i<nx; i++) {
-                    if (pvec[IJK(i,j,k)] > 0.0) {
-                        gotit = 1;
-                        break;
+        for (ib=bbeg; ib<bend; ib++) {
+            if (out[ib-bbeg] == VNULL) continue;
+            if ((nerr == 0) &&
+              (fwrite(out[ib-bbeg], 1, blen[ib], fp) != blen[ib])) nerr++;
+            free(out[ib-bbeg]);
+        }
+    }
+
+    /* Create the field */
+    nout = compressBound(sizeof(footer)) + 64;
+    member = (unsigned char *)Vmem_malloc(thee->mem, nout, sizeof(char));
+    if (Vgrid_gzDeflate(footer, strlen(footer), member, &nout, VNULL)) {
+        if (fwrite(member, 1, nout, fp) != nout) nerr++;
+    } else nerr++;
+    Vmem_free(thee->mem, compressBound(sizeof(footer)) + 64, sizeof(char),
+      (void **)&member);
+
+    /* Fill in the member index (the extra field starts at byte 12) */
+    for (ib=0; ib<nblock; ib++) {
+        Vgrid_putU32(extra + 16 + 8*ib, (unsigned long)blen[ib]);
+        Vgrid_putU32(extra + 20 + 8*ib,
+          (unsigned long)(start[slab[ib+1]] - start[slab[ib]]));
+    }
+    if ((fseek(fp, 12, SEEK_SET) != 0) ||
+      (fwrite(extra, 1, xlen, fp) != xlen)) nerr++;
+    if (fclose(fp) != 0) nerr++;
+    if ((nerr == 0) && (rename(tmpname, fname) != 0)) nerr++;
+    if (nerr != 0) {
+        Vnm_print(2, "Vgrid_writeGZ:  I/O problem writing <%s>\n", fname);
+        remove(tmpname);
+    }
+
+    Vmem_free(thee->mem, nx+1, sizeof(int), (void **)&slab);
+    Vmem_free(thee->mem, nx+1, sizeof(size_t), (void **)&start);
+    Vmem_free(thee->mem, nblock, sizeof(size_t), (void **)&blen);
+    Vmem_free(thee->mem, xlen, sizeof(char), (void **)&extra);
+
+    return (nerr == 0);
+#else
+
+    Vnm_print(0, "WARNING\n");
+    Vnm_print(0, "Vgrid_readGZ:  gzip read/write support is disabled in this build\n");
+    Vnm_print(0, "Vgrid_readGZ:  configure and compile without the --disable-zlib flag.\n");
+    Vnm_print(0, "WARNING\n");
+    return 0;
+#endif
+}
+
+/** @brief  Magic string at the start of lossy grid files
+ *  @ingroup  Vgrid */
+#define VGRID_LOSSY_MAGIC "APBSLGZD"
+
+/** @brief  Lossy grid file format version
+ *  @ingroup  Vgrid */
+#define VGRID_LOSSY_VERSION 1
+
+/** @brief  Target number of grid points per independently coded block
+ *  @ingroup  Vgrid */
+#define VGRID_LOSSY_BLOCK (1<<20)
+
+/** @brief  Largest quantized magnitude (2^40); values beyond it are stored
+ *          verbatim
+ *  @ingroup  Vgrid */
+#define VGRID_LOSSY_MAXQ 1099511627776.0
+
+/**
+ * @brief  Header of a lossy grid file (88 bytes); the raw grid endianness
+ *         marker is reused
+ * @ingroup  Vgrid
+ */
+typedef struct sVgridLossyHeader {
+    char magic[8];  /**< VGRID_LOSSY_MAGIC (not terminated) */
+    unsigned int endian;  /**< VGRID_RAW_ENDIAN in the writer's byte order */
+    int version;  /**< VGRID_LOSSY_VERSION */
+    int nx;  /**< Grid points in x */
+    int ny;  /**< Grid points in y */
+    int nz;  /**< Grid points in z */
+    int nblock;  /**< Number of z-slab blocks */
+    double xmin;  /**< x coordinate of lower grid corner */
+    double ymin;  /**< y coordinate of lower grid corner */
+    double zmin;  /**< z coordinate of lower grid corner */
+    double hx;  /**< Grid spacing in x direction */
+    double hy;  /**< Grid spacing in y direction */
+    double hzed;  /**< Grid spacing in z direction */
+    double tol;  /**< Absolute error bound */
+} VgridLossyHeader;
+
+/**
+ * @brief  Block table entry of a lossy grid file
+ * @ingroup  Vgrid
+ */
+typedef struct sVgridLossyBlock {
+    int kbeg;  /**< First z-plane of the block */
+    int nraw;  /**< Values stored verbatim in the block */
+    unsigned long long clen;  /**< Compressed bytes */
+    unsigned long long ulen;  /**< Uncompressed bytes */
+} VgridLossyBlock;
+
+#ifdef HAVE_ZLIB
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_lossyPredict
+//
+// Purpose:  Lorenzo prediction of the quantized value at (i,j,k) of a block
+//           of nx x ny x nk points from its already coded neighbours;
+//           neighbours outside the block count as zero
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE long long Vgrid_lossyPredict(const long long *m, int nx, int ny,
+        int i, int j, int k) {
+
+    long long pred;
+    size_t u, sx, sy, sz;
+
+    u = ((size_t)k*ny + j)*nx + i;
+    sx = 1;
+    sy = (size_t)nx;
+    sz = (size_t)nx*ny;
+    pred = 0;
+    if (i > 0) pred += m[u-sx];
+    if (j > 0) pred += m[u-sy];
+    if (k > 0) pred += m[u-sz];
+    if ((i > 0) && (j > 0)) pred -= m[u-sx-sy];
+    if ((i > 0) && (k > 0)) pred -= m[u-sx-sz];
+    if ((j > 0) && (k > 0)) pred -= m[u-sy-sz];
+    if ((i > 0) && (j > 0) && (k > 0)) pred += m[u-sx-sy-sz];
+    return pred;
+}
+#endif
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_writeLossy
+//
+// Purpose:  Each value v is quantized to m = round(v/(2 tol)), so that
+//           m*(2 tol) lies within tol of v; values for which that fails
+//           (huge or non-finite) are kept verbatim.  The prediction
+//           residuals of m are zigzag varint coded, one z-slab block per
+//           thread, and each block is deflated on its own.
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vgrid_writeLossy(Vgrid *thee, const char *fname, double tol,
+        double *pvec) {
+
+#ifdef HAVE_ZLIB
+    VgridLossyHeader header;
+    VgridLossyBlock *table;
+    unsigned char **out;
+    int lo[3], hi[3], nx, ny, nxPART, nyPART, nzPART, nk, ib, nblock, nerr;
+    double q;
+    size_t ntot, nraw;
+    FILE *fp;
+
+    if (thee == VNULL) {
+        Vnm_print(2, "Vgrid_writeLossy:  Error -- got VNULL thee!\n");
+        VASSERT(0);
+    }
+    if (!(thee->ctordata || thee->readdata)) {
+        Vnm_print(2, "Vgrid_writeLossy:  Error -- no data available!\n");
+        VASSERT(0);
+    }
+    if (!(tol > 0.0)) {
+        Vnm_print(2, "Vgrid_writeLossy:  Invalid error bound (%g)!\n", tol);
+        return 0;
+    }
+
+    nx = thee->nx;
+    ny = thee->ny;
+    if (!Vgrid_partBox(thee->nx, thee->ny, thee->nz, pvec, lo, hi)) {
+        Vnm_print(2, "Vgrid_writeLossy:  Empty partition!\n");
+        return 0;
+    }
+    nxPART = hi[0] - lo[0] + 1;
+    nyPART = hi[1] - lo[1] + 1;
+    nzPART = hi[2] - lo[2] + 1;
+    if ((nxPART != nx) || (nyPART != ny) || (nzPART != thee->nz)) {
+        Vnm_print(0, "Vgrid_writeLossy:  printing only subset of domain\n");
+    }
+
+    /* Cut the box into blocks of whole z-planes */
+    nk = VMAX2(1, VGRID_LOSSY_BLOCK/(nxPART*nyPART));
+    nblock = (nzPART + nk - 1)/nk;
+    q = 2.0*tol;
+
+    memset(&header, 0, sizeof(VgridLossyHeader));
+    memcpy(header.magic, VGRID_LOSSY_MAGIC, 8);
+    header.endian = VGRID_RAW_ENDIAN;
+    header.version = VGRID_LOSSY_VERSION;
+    header.nx = nxPART;
+    header.ny = nyPART;
+    header.nz = nzPART;
+    header.nblock = nblock;
+    header.xmin = thee->xmin + lo[0]*thee->hx;
+    header.ymin = thee->ymin + lo[1]*thee->hy;
+    header.zmin = thee->zmin + lo[2]*thee->hzed;
+    header.hx = thee->hx;
+    header.hy = thee->hy;
+    header.hzed = thee->hzed;
+    header.tol = tol;
+
+    table = (VgridLossyBlock *)Vmem_malloc(thee->mem, nblock,
+      sizeof(VgridLossyBlock));
+    out = (unsigned char **)Vmem_malloc(thee->mem, nblock,
+      sizeof(unsigned char *));
+
+    /* Encode and compress the blocks */
+    nerr = 0;
+    #pragma omp parallel for schedule(dynamic,1) reduction(+:nerr)
+    for (ib=0; ib<nblock; ib++) {
+        int i, j, k, kend;
+        long long *m, res;
+        unsigned long long zz;
+        unsigned char *code, *raw;
+        size_t n, u, ncode, nr;
+        uLongf clen;
+        double v, r;
+
+        table[ib].kbeg = ib*nk;
+        kend = VMIN2(nzPART, (ib+1)*nk);
+        n = (size_t)nxPART*nyPART*(kend - ib*nk);
+        out[ib] = VNULL;
+        m = (long long *)malloc(n*sizeof(long long));
+        code = (unsigned char *)malloc(n*10 + n*sizeof(double));
+        if ((m == VNULL) || (code == VNULL)) {
+            free(m);
+            free(code);
+            nerr++;
+            continue;
+        }
+        raw = code + n*10;
+        ncode = 0;
+        nr = 0;
+        u = 0;
+        for (k=0; k<kend-ib*nk; k++) {
+            for (j=0; j<nyPART; j++) {
+                for (i=0; i<nxPART; i++, u++) {
+                    v = thee->data[IJK(lo[0]+i, lo[1]+j, lo[2]+ib*nk+k)];
+                    r = v/q;
+                    m[u] = 0;
+                    if (fabs(r) < VGRID_LOSSY_MAXQ) {
+                        m[u] = (long long)floor(r + 0.5);
                     }
+                    if (!(fabs(r) < VGRID_LOSSY_MAXQ) ||
+                      !(fabs(v - m[u]*q) <= tol)) {
+                        /* Stored verbatim (symbol 0); predicts as zero */
+                        memcpy(raw + nr*sizeof(double), &v, sizeof(double));
+                        nr++;
+                        m[u] = 0;
+                        code[ncode++] = 0;
+                        continue;
+                    }
+                    res = m[u] - Vgrid_lossyPredict(m, nxPART, nyPART,
+                      i, j, k);
+                    zz = (res >= 0) ? 2*(unsigned long long)res + 1 :
+                      2*(unsigned long long)(-res);
+                    while (zz >= 0x80) {
+                        code[ncode++] = (unsigned char)(zz | 0x80);
+                        zz >>= 7;
+                    }
+                    code[ncode++] = (unsigned char)zz;
                 }
-                if (gotit) break;
             }
-            if (gotit) nyPART++;
         }
-        /* Now search for the number of grid points in the x direction */
-        for (i=0; i<nx; i++) {
-            gotit = 0;
-            for (k=0; k<nz; k++) {
-                for (j=0; j<ny; j++) {
-                    if (pvec[IJK(i,j,k)] > 0.0) {
-                        gotit = 1;
-                        break;
-                    }
-                }
-                if (gotit) break;
+        free(m);
+
+        /* Raw values follow the varints */
+        memmove(code + ncode, raw, nr*sizeof(double));
+        table[ib].nraw = (int)nr;
+        table[ib].ulen = ncode + nr*sizeof(double);
+        clen = compressBound((uLong)table[ib].ulen);
+        out[ib] = (unsigned char *)malloc(clen);
+        if ((out[ib] == VNULL) || (compress2(out[ib], &clen, code,
+          (uLong)table[ib].ulen, Z_DEFAULT_COMPRESSION) != Z_OK)) {
+            nerr++;
+        }
+        table[ib].clen = clen;
+        free(code);
+    }
+
+    ntot = 0;
+    nraw = 0;
+    if (nerr == 0) {
+        for (ib=0; ib<nblock; ib++) {
+            ntot += table[ib].clen;
+            nraw += table[ib].nraw;
+        }
+        Vnm_print(0, "Vgrid_writeLossy:  %lu bytes (%.1fx), %lu values \
+stored verbatim\n", (unsigned long)ntot,
+          ((double)nxPART*nyPART*nzPART*sizeof(double))/VMAX2(ntot, 1),
+          (unsigned long)nraw);
+        fp = fopen(fname, "wb");
+        if (fp == VNULL) {
+            Vnm_print(2, "Vgrid_writeLossy:  Problem opening file %s\n",
+              fname);
+            nerr++;
+        } else {
+            if (fwrite(&header, sizeof(VgridLossyHeader), 1, fp) != 1) nerr++;
+            if (fwrite(table, sizeof(VgridLossyBlock), nblock, fp)
+              != (size_t)nblock) nerr++;
+            for (ib=0; (ib<nblock) && (nerr==0); ib++) {
+                if (fwrite(out[ib], 1, (size_t)table[ib].clen, fp)
+                  != (size_t)table[ib].clen) nerr++;
+            }
+            if (fclose(fp) != 0) nerr++;
+            if (nerr != 0) {
+                Vnm_print(2, "Vgrid_writeLossy:  I/O problem writing <%s>\n",
+                  fname);
             }
-            if (gotit) nxPART++;
         }
+    } else {
+        Vnm_print(2, "Vgrid_writeLossy:  Unable to compress data!\n");
+    }
 
-        if ((nxPART != nx) || (nyPART != ny) || (nzPART != nz)) {
-            Vnm_print(0, "Vgrid_writeGZ:  printing only subset of domain\n");
+    for (ib=0; ib<nblock; ib++) free(out[ib]);
+    Vmem_free(thee->mem, nblock, sizeof(unsigned char *), (void **)&out);
+    Vmem_free(thee->mem, nblock, sizeof(VgridLossyBlock), (void **)&table);
+    return (nerr == 0);
+#else
+
+    Vnm_print(2, "Vgrid_writeLossy:  lossy output needs zlib; configure and \
+compile without the --disable-zlib flag.\n");
+    return 0;
+#endif
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vgrid_readLossy
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vgrid_readLossy(Vgrid *thee, const char *fname) {
+
+#ifdef HAVE_ZLIB
+    VgridLossyHeader header;
+    VgridLossyBlock *table;
+    char *buf;
+    size_t size, pos, *offset;
+    int swap, ib, nerr;
+    double q;
+
+    /* Check to see if the existing data is null and, if not, clear it out */
+    if (thee->data != VNULL) {
+        Vnm_print(1, "Vgrid_readLossy:  destroying existing data!\n");
+        Vgrid_freeData(thee);
+    }
+    thee->readdata = 1;
+    thee->ctordata = 0;
+
+    buf = Vstring_mapFile(fname, &size, 0);
+    if (buf == VNULL) {
+        Vnm_print(2, "Vgrid_readLossy: Problem opening file %s\n", fname);
+        return 0;
+    }
+    table = VNULL;
+    offset = VNULL;
+
+    /* Check the header */
+    VJMPERR1(size >= sizeof(VgridLossyHeader));
+    memcpy(&header, buf, sizeof(VgridLossyHeader));
+    VJMPERR1(memcmp(header.magic, VGRID_LOSSY_MAGIC, 8) == 0);
+    swap = (header.endian != VGRID_RAW_ENDIAN);
+    if (swap) {
+        Vgrid_swapBytes(&(header.endian), sizeof(unsigned int), 1);
+        VJMPERR1(header.endian == VGRID_RAW_ENDIAN);
+        Vgrid_swapBytes(&(header.version), sizeof(int), 1);
+        Vgrid_swapBytes(&(header.nx), sizeof(int), 1);
+        Vgrid_swapBytes(&(header.ny), sizeof(int), 1);
+        Vgrid_swapBytes(&(header.nz), sizeof(int), 1);
+        Vgrid_swapBytes(&(header.nblock), sizeof(int), 1);
+        Vgrid_swapBytes(&(header.xmin), sizeof(double), 1);
+        Vgrid_swapBytes(&(header.ymin), sizeof(double), 1);
+        Vgrid_swapBytes(&(header.zmin), sizeof(double), 1);
+        Vgrid_swapBytes(&(header.hx), sizeof(double), 1);
+        Vgrid_swapBytes(&(header.hy), sizeof(double), 1);
+        Vgrid_swapBytes(&(header.hzed), sizeof(double), 1);
+        Vgrid_swapBytes(&(header.tol), sizeof(double), 1);
+    }
+    VJMPERR1(header.version == VGRID_LOSSY_VERSION);
+    VJMPERR1((header.nx > 0) && (header.ny > 0) && (header.nz > 0));
+    VJMPERR1((header.nblock > 0) && (header.nblock <= header.nz));
+    VJMPERR1(header.tol > 0.0);
+    pos = sizeof(VgridLossyHeader)
+      + (size_t)header.nblock*sizeof(VgridLossyBlock);
+    VJMPERR1(size >= pos);
+
+    /* Read the block table and find where each block starts */
+    table = (VgridLossyBlock *)Vmem_malloc(thee->mem, header.nblock,
+      sizeof(VgridLossyBlock));
+    offset = (size_t *)Vmem_malloc(thee->mem, header.nblock + 1,
+      sizeof(size_t));
+    memcpy(table, buf + sizeof(VgridLossyHeader),
+      header.nblock*sizeof(VgridLossyBlock));
+    for (ib=0; ib<header.nblock; ib++) {
+        if (swap) {
+            Vgrid_swapBytes(&(table[ib].kbeg), sizeof(int), 1);
+            Vgrid_swapBytes(&(table[ib].nraw), sizeof(int), 1);
+            Vgrid_swapBytes(&(table[ib].clen), sizeof(unsigned long long), 1);
+            Vgrid_swapBytes(&(table[ib].ulen), sizeof(unsigned long long), 1);
         }
+        VJMPERR1((ib == 0) ? (table[ib].kbeg == 0) :
+          (table[ib].kbeg > table[ib-1].kbeg));
+        VJMPERR1(table[ib].kbeg < header.nz);
+        VJMPERR1(table[ib].clen <= size - pos);
+        offset[ib] = pos;
+        pos += (size_t)table[ib].clen;
+    }
+    offset[header.nblock] = pos;
+
+    thee->nx = header.nx;
+    thee->ny = header.ny;
+    thee->nz = header.nz;
+    thee->xmin = header.xmin;
+    thee->ymin = header.ymin;
+    thee->zmin = header.zmin;
+    thee->hx = header.hx;
+    thee->hy = header.hy;
+    thee->hzed = header.hzed;
+    thee->xmax = thee->xmin + (thee->nx-1)*thee->hx;
+    thee->ymax = thee->ymin + (thee->ny-1)*thee->hy;
+    thee->zmax = thee->zmin + (thee->nz-1)*thee->hzed;
+    Vnm_print(0, "Vgrid_readLossy:  Grid dimensions %d x %d x %d grid\n",
+      thee->nx, thee->ny, thee->nz);
+    thee->data = (double *)Vmem_malloc(thee->mem,
+      (size_t)thee->nx*thee->ny*thee->nz, sizeof(double));
+    if (thee->data == VNULL) {
+        Vnm_print(2, "Vgrid_readLossy:  Unable to allocate space for data!\n");
+        VJMPERR1(0);
+    }
 
-        txyz = (nxPART*nyPART*nzPART);
-        txmin = xminPART;
-        tymin = yminPART;
-        tzmin = zminPART;
-
-    }else {
-
-        txyz = (nx*ny*nz);
-        txmin = xmin;
-        tymin = ymin;
-        tzmin = zmin;
-
-    }
-
-    /* Write off the title (if we're not XDR) */
-    sprintf(header,
-            "# Data from %s\n"	\
-            "# \n"							\
-            "# %s\n"			\
-            "# \n"							\
-            "object 1 class gridpositions counts %i %i %i\n"	\
-            "origin %12.6e %12.6e %12.6e\n"	\
-            "delta %12.6e 0.000000e+00 0.000000e+00\n"		\
-            "delta 0.000000e+00 %12.6e 0.000000e+00\n"		\
-            "delta 0.000000e+00 0.000000e+00 %12.6e\n"		\
-            "object 2 class gridconnections counts %i %i %i\n"\
-            "object 3 class array type double rank 0 items %lu data follows\n",
-            PACKAGE_STRING,title,nx,ny,nz,txmin,tymin,tzmin,
-            hx,hy,hzed,nx,ny,nz,txyz);
-    gzwrite(outfile, header, strlen(header)*sizeof(char));
-
-    /* Now write the data */
-    icol = 0;
-    for (i=0; i<nx; i++) {
-        for (j=0; j<ny; j++) {
-            for (k=0; k<nz; k++) {
-                u = k*(nx)*(ny)+j*(nx)+i;
-                if (pvec[u] > 0.0) {
-                    sprintf(line, "%12.6e ", thee->data[u]);
-                    gzwrite(outfile, line, strlen(line)*sizeof(char));
-                    icol++;
-                    if (icol == 3) {
-                        icol = 0;
-                        gzwrite(outfile, newline, strlen(newline)*sizeof(char));
+    /* Decode the blocks */
+    q = 2.0*header.tol;
+    nerr = 0;
+    #pragma omp parallel for schedule(dynamic,1) reduction(+:nerr)
+    for (ib=0; ib<header.nblock; ib++) {
+        int i, j, k, nk, shift, bad;
+        long long *m;
+        unsigned long long zz;
+        unsigned char *code, *raw, c;
+        size_t n, u, pc, ncode, nr;
+        uLongf ulen;
+        double v, *data;
+
+        nk = ((ib+1 < header.nblock) ? table[ib+1].kbeg : header.nz)
+          - table[ib].kbeg;
+        n = (size_t)header.nx*header.ny*nk;
+        data = thee->data + (size_t)header.nx*header.ny*table[ib].kbeg;
+        if ((table[ib].nraw < 0) || ((size_t)table[ib].nraw > n) ||
+          (table[ib].ulen < (size_t)table[ib].nraw*sizeof(double)) ||
+          (table[ib].ulen > n*10 + n*sizeof(double))) {
+            nerr++;
+            continue;
+        }
+        m = (long long *)malloc(n*sizeof(long long));
+        code = (unsigned char *)malloc((size_t)table[ib].ulen + 1);
+        ulen = (uLongf)table[ib].ulen;
+        if ((m == VNULL) || (code == VNULL) ||
+          (uncompress(code, &ulen, (unsigned char *)buf + offset[ib],
+          (uLong)table[ib].clen) != Z_OK) || (ulen != table[ib].ulen)) {
+            free(m);
+            free(code);
+            nerr++;
+            continue;
+        }
+        ncode = (size_t)ulen - table[ib].nraw*sizeof(double);
+        raw = code + ncode;
+        bad = 0;
+        pc = 0;
+        nr = 0;
+        u = 0;
+        for (k=0; (k<nk) && !bad; k++) {
+            for (j=0; (j<header.ny) && !bad; j++) {
+                for (i=0; (i<header.nx) && !bad; i++, u++) {
+                    zz = 0;
+                    shift = 0;
+                    do {
+                        if ((pc >= ncode) || (shift > 63)) {
+                            bad = 1;
+                            break;
+                        }
+                        c = code[pc++];
+                        zz |= (unsigned long long)(c & 0x7f) << shift;
+                        shift += 7;
+                    } while (c & 0x80);
+                    if (bad) break;
+                    if (zz == 0) {
+                        if (nr >= (size_t)table[ib].nraw) {
+                            bad = 1;
+                            break;
+                        }
+                        memcpy(&v, raw + nr*sizeof(double), sizeof(double));
+                        if (swap) Vgrid_swapBytes(&v, sizeof(double), 1);
+                        nr++;
+                        m[u] = 0;
+                        data[u] = v;
+                        continue;
                     }
+                    m[u] = Vgrid_lossyPredict(m, header.nx, header.ny,
+                      i, j, k) + ((zz & 1) ? (long long)(zz >> 1) :
+                      -(long long)(zz >> 1));
+                    data[u] = m[u]*q;
                 }
             }
         }
+        if ((pc != ncode) || (nr != (size_t)table[ib].nraw)) bad = 1;
+        nerr += bad;
+        free(m);
+        free(code);
     }
-    if(icol < 3){
-        char newline[] = "\n";
-        gzwrite(outfile, newline, strlen(newline)*sizeof(char));
-    }
+    VJMPERR1(nerr == 0);
 
-    /* Create the field */
-    sprintf(footer, "attribute \"dep\" string \"positions\"\n" \
-            "object \"regular positions regular connections\" class field\n" \
-            "component \"positions\" value 1\n" \
-            "component \"connections\" value 2\n" \
-            "component \"data\" value 3\n");
-    gzwrite(outfile, footer, strlen(footer)*sizeof(char));
-
-    gzclose(outfile);
+    Vmem_free(thee->mem, header.nblock + 1, sizeof(size_t), (void **)&offset);
+    Vmem_free(thee->mem, header.nblock, sizeof(VgridLossyBlock),
+      (void **)&table);
+    Vstring_unmapFile(buf, size);
+
+    return 1;
+
+  VERROR1:
+    if (offset != VNULL) {
+        Vmem_free(thee->mem, header.nblock + 1, sizeof(size_t),
+          (void **)&offset);
+    }
+    if (table != VNULL) {
+        Vmem_free(thee->mem, header.nblock, sizeof(VgridLossyBlock),
+          (void **)&table);
+    }
+    Vstring_unmapFile(buf, size);
+    Vnm_print(2, "Vgrid_readLossy:  Format problem with input file <%s>\n",
+      fname);
+    return 0;
 #else
 
-    Vnm_print(0, "WARNING\n");
-    Vnm_print(0, "Vgrid_readGZ:  gzip read/write support is disabled in this build\n");
-    Vnm_print(0, "Vgrid_readGZ:  configure and compile without the --disable-zlib flag.\n");
-    Vnm_print(0, "WARNING\n");
+    Vnm_print(2, "Vgrid_readLossy:  lossy input needs zlib; configure and \
+compile without the --disable-zlib flag.\n");
+    return 0;
 #endif
 }
 
@@ -1209,7 +3114,7 @@ VPUBLIC void Vgrid_writeDX(Vgrid *thee, const char *iodev, const char *iofmt,
     double xmin, ymin, zmin, hx, hy, hzed;
     int nx, ny, nz, nxPART, nyPART, nzPART;
     int usepart, gotit;
-    size_t icol, i, j, k, u;
+    size_t i, j, k;
     double x, y, z, xminPART, yminPART, zminPART;
     Vio *sock;
     char precFormat[VMAX_BUFSIZE];
@@ -1359,24 +3264,7 @@ VPUBLIC void Vgrid_writeDX(Vgrid *thee, const char *iodev, const char *iofmt,
         /* Write off the DX data */
         Vio_printf(sock, "object 3 class array type double rank 0 items %lu \
 data follows\n", (nxPART*nyPART*nzPART));
-        icol = 0;
-        for (i=0; i<nx; i++) {
-            for (j=0; j<ny; j++) {
-                for (k=0; k<nz; k++) {
-                    u = k*(nx)*(ny)+j*(nx)+i;
-                    if (pvec[u] > 0.0) {
-                        Vio_printf(sock, "%12.6e ", thee->data[u]);
-                        icol++;
-                        if (icol == 3) {
-                            icol = 0;
-                            Vio_printf(sock, "\n");
-                        }
-                    }
-                }
-            }
-        }
-
-        if (icol != 0) Vio_printf(sock, "\n");
+        Vgrid_writeDXData(thee, sock, iofmt, pvec);
 
         /* Create the field */
         Vio_printf(sock, "attribute \"dep\" string \"positions\"\n");
@@ -1420,21 +3308,7 @@ class field\n");
         /* Write off the DX data */
         Vio_printf(sock, "object 3 class array type double rank 0 items %lu \
 data follows\n", (nx*ny*nz));
-        icol = 0;
-        for (i=0; i<nx; i++) {
-            for (j=0; j<ny; j++) {
-                for (k=0; k<nz; k++) {
-                    u = k*(nx)*(ny)+j*(nx)+i;
-                    Vio_printf(sock, "%12.6e ", thee->data[u]);
-                    icol++;
-                    if (icol == 3) {
-                        icol = 0;
-                        Vio_printf(sock, "\n");
-                    }
-                }
-            }
-        }
-        if (icol != 0) Vio_printf(sock, "\n");
+        Vgrid_writeDXData(thee, sock, iofmt, VNULL);
 
         /* Create the field */
         Vio_printf(sock, "attribute \"dep\" string \"positions\"\n");
@@ -73,6 +73,24 @@
  *  @ingroup Vgrid */
 #define VGRID_DIGITS 6
 
+/** @brief Raw grid files (Vgrid_writeRaw) holding 8-byte doubles
+ *  @ingroup Vgrid */
+#define VGRID_RAW_FLOAT64 8
+
+/** @brief Raw grid files (Vgrid_writeRaw) holding 4-byte floats
+ *  @ingroup Vgrid */
+#define VGRID_RAW_FLOAT32 4
+
+/** @brief Upper bound on the bytes needed for one value formatted by
+ *         Vgrid_formatExp ("-d.dddddde+ddd " plus a newline)
+ *  @ingroup Vgrid */
+#define VGRID_DXVALLEN 16
+
+/** @brief Number of points handled together by the batch interpolation
+ *         routines (Vgrid_valueBatch, Vmgrid_valueBatch)
+ *  @ingroup Vgrid */
+#define VGRID_BATCHTILE 1024
+
 /**
  *  @ingroup Vgrid
  *  @author  Nathan Baker
@@ -96,6 +114,9 @@ struct sVgrid {
     int readdata; /**< flag indicating whether data was read from file */
     int ctordata; /**< flag indicating whether data was included at
                    *   construction */
+    void *mapbase; /**< read-only file mapping that data points into
+                    *   (see Vgrid_readRaw), VNULL otherwise */
+    size_t mapsize; /**< size of mapbase in bytes */
     Vmem *mem;    /**< Memory manager object */
 };
 
@@ -224,6 +245,85 @@ VEXTERNC int Vgrid_curvature(Vgrid *thee, double pt[3], int cflag,
  */
 VEXTERNC int Vgrid_gradient(Vgrid *thee, double pt[3], double grad[3] );
 
+/** @brief   Get values (and optionally gradients) at many points at once
+ *  @details Gives the same results as calling Vgrid_value (and
+ *           Vgrid_gradient) for each point, but without the per-call
+ *           checks and diagnostics; queries are evaluated in parallel, and
+ *           gradient queries are grouped by mesh brick for locality.
+ *           Off-grid points get zero values and gradients.
+ *  @ingroup Vgrid
+ *  @param   thee    Vgrid object
+ *  @param   npts    Number of points
+ *  @param   pts     Point coordinates (x, y, z for each point; 3*npts)
+ *  @param   values  Set to the value at each point (npts)
+ *  @param   grads   If not VNULL, set to the gradient at each point (3*npts)
+ *  @param   onGrid  If not VNULL, set to 1 for each point whose value (and
+ *                   gradient, if requested) was found on the grid, 0
+ *                   otherwise (npts)
+ *  @return  Number of points found on the grid
+ */
+VEXTERNC int Vgrid_valueBatch(Vgrid *thee, int npts, double *pts,
+  double *values, double *grads, int *onGrid);
+
+/** @brief   Format a value as sprintf(buf, "%12.6e ", val) would
+ *  @details This is the formatting used for OpenDX data values; the common
+ *           case does not go through the C library.
+ *  @ingroup Vgrid
+ *  @param   val  Value to format
+ *  @param   buf  Output buffer of at least VGRID_DXVALLEN characters; it is
+ *                not terminated
+ *  @return  Number of characters written
+ */
+VEXTERNC int Vgrid_formatExp(double val, char *buf);
+
+/** @brief   Format the header of an OpenDX file, up to and including the
+ *           "data follows" line
+ *  @ingroup Vgrid
+ *  @param   buf     Output buffer
+ *  @param   len     Size of buf
+ *  @param   title   Title for the file comments
+ *  @param   nx      Number of x grid points
+ *  @param   ny      Number of y grid points
+ *  @param   nz      Number of z grid points
+ *  @param   xmin    x coordinate of lower grid corner
+ *  @param   ymin    y coordinate of lower grid corner
+ *  @param   zmin    z coordinate of lower grid corner
+ *  @param   hx      Grid spacing in x direction
+ *  @param   hy      Grid spacing in y direction
+ *  @param   hzed    Grid spacing in z direction
+ *  @param   binary  1 if the data block holds binary doubles
+ *  @return  Length of the header, or 0 if it does not fit in buf
+ */
+VEXTERNC size_t Vgrid_formatDXHeader(char *buf, size_t len,
+  const char *title, int nx, int ny, int nz, double xmin, double ymin,
+  double zmin, double hx, double hy, double hzed, int binary);
+
+/** @brief   Format the field definition that ends an OpenDX file
+ *  @ingroup Vgrid
+ *  @param   buf      Output buffer
+ *  @param   len      Size of buf
+ *  @param   newline  1 to end an unfinished data line first
+ *  @return  Length of the trailer, or 0 if it does not fit in buf
+ */
+VEXTERNC size_t Vgrid_formatDXTrailer(char *buf, size_t len, int newline);
+
+/** @brief   Parse an OpenDX header held in memory
+ *  @details Comments are skipped; the "binary" keyword of the data array
+ *           line is optional.
+ *  @ingroup Vgrid
+ *  @param   pos      Start of the header; on success, set to just past
+ *                    "data follows"
+ *  @param   end      End of the text
+ *  @param   dims     Set to the number of grid points in each direction
+ *  @param   origin   Set to the lower grid corner
+ *  @param   spacing  Set to the grid spacings
+ *  @param   items    Set to the number of data values
+ *  @return  1 if successful, 0 on a format problem, -1 if the text ends
+ *           before the header does
+ */
+VEXTERNC int Vgrid_parseDXHeader(const char **pos, const char *end,
+  int dims[3], double origin[3], double spacing[3], unsigned long *items);
+
 /** @brief	Read in OpenDX data in GZIP format
  *	@ingroup Vgrid
  *	@author Dave Gohara
@@ -234,9 +334,13 @@ VEXTERNC int Vgrid_readGZ(
                           );
 
 /** @brief	Write out OpenDX data in GZIP format
+ *	@ingroup Vgrid
  *	@author Dave Gohara
- */
-VEXTERNC void Vgrid_writeGZ(
+ *	@note  The file is written under a temporary name and renamed into
+ *	       place when complete, so a failed write leaves no file behind.
+ *	@return 1 if successful, 0 if the partition is empty or the file
+ *	        could not be written */
+VEXTERNC int Vgrid_writeGZ(
                             Vgrid *thee, /**< Object to hold new grid data */
                             const char *iodev, /**< I/O device */
                             const char *iofmt, /**< I/O format */
@@ -332,6 +436,84 @@ VEXTERNC void Vgrid_writeDXBIN(Vgrid *thee, const char *iodev,
 VEXTERNC int Vgrid_readDXBIN(Vgrid *thee, const char *iodev, const char *iofmt,
    const char *thost, const char *fname);
 
+/** @brief   Find the index box holding the points of a partition
+ *  @details This is the bounding box of the points with a positive
+ *           partition weight, i.e. the region a partition-aware writer
+ *           keeps.
+ *  @ingroup Vgrid
+ *  @param   nx    Number of grid points in x
+ *  @param   ny    Number of grid points in y
+ *  @param   nz    Number of grid points in z
+ *  @param   pvec  Partition weight, or VNULL for the whole grid
+ *  @param   lo    Set to the lowest owned (i,j,k)
+ *  @param   hi    Set to the highest owned (i,j,k)
+ *  @returns 1 if the partition owns any points, 0 otherwise
+ */
+VEXTERNC int Vgrid_partBox(int nx, int ny, int nz, double *pvec, int lo[3],
+  int hi[3]);
+
+/** @brief   Write data in the raw binary grid format
+ *  @details The file is an 80-byte header followed by the values in the
+ *           Vgrid memory order (x fastest, then y, then z).  The header
+ *           holds the magic "APBSGRID", an endianness marker (0x01020304 as
+ *           written by the producing machine), a version, the bytes per
+ *           value (VGRID_RAW_FLOAT64 or VGRID_RAW_FLOAT32), nx, ny, nz and
+ *           then the origin and the spacings as doubles.
+ *  @ingroup Vgrid
+ *  @param   thee   Grid object
+ *  @param   fname  Output file name
+ *  @param   dtype  VGRID_RAW_FLOAT64 or VGRID_RAW_FLOAT32
+ *  @param   pvec   Partition weight (
+ *                 if 1: point in current partition,
+ *                 if 0 point not in current partition
+ *                 if > 0 && < 1 point on/near boundary )
+ *  @returns 1 if sucessful, 0 otherwise
+ */
+VEXTERNC int Vgrid_writeRaw(Vgrid *thee, const char *fname, int dtype,
+  double *pvec);
+
+/** @brief   Read data in the raw binary grid format
+ *  @details Native-endian double files are mapped read-only and thee->data
+ *           points straight into the mapping, so loading takes constant
+ *           time; the mapping is released by Vgrid_dtor.  Float or
+ *           foreign-endian files are converted into a private copy.
+ *  @ingroup Vgrid
+ *  @param   thee   Vgrid object
+ *  @param   fname  Input file name
+ *  @returns 1 if sucessful, 0 otherwise
+ */
+VEXTERNC int Vgrid_readRaw(Vgrid *thee, const char *fname);
+
+/** @brief   Write data in the error-bounded lossy grid format
+ *  @details Every value is reproduced within tol by Vgrid_readLossy.
+ *           Values are quantized to multiples of 2*tol, predicted from
+ *           their already coded neighbours (3D Lorenzo predictor), and the
+ *           residuals are varint coded and deflated with zlib in
+ *           independent z-slab blocks.  Values that cannot be quantized
+ *           (non-finite or enormous) are stored verbatim.  Smooth
+ *           potentials typically shrink 10-50x at tol = 1e-3.
+ *  @ingroup Vgrid
+ *  @param   thee   Grid object
+ *  @param   fname  Output file name
+ *  @param   tol    Absolute error bound (> 0)
+ *  @param   pvec   Partition weight (
+ *                 if 1: point in current partition,
+ *                 if 0 point not in current partition
+ *                 if > 0 && < 1 point on/near boundary )
+ *  @returns 1 if sucessful, 0 otherwise
+ */
+VEXTERNC int Vgrid_writeLossy(Vgrid *thee, const char *fname, double tol,
+  double *pvec);
+
+/** @brief   Read data in the error-bounded lossy grid format
+ *  @details Blocks are decoded in parallel.
+ *  @ingroup Vgrid
+ *  @param   thee   Vgrid object
+ *  @param   fname  Input file name
+ *  @returns 1 if sucessful, 0 otherwise
+ */
+VEXTERNC int Vgrid_readLossy(Vgrid *thee, const char *fname);
+
 /**
  * @brief  Get the integral of the data
  * @ingroup  Vgrid
@@ -125,6 +125,92 @@ hiearchy!\n", pt[0], pt[1], pt[2]);
     return 0;
 }
 
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vmgrid_valueBatch
+//
+// Purpose:  Points are taken VGRID_BATCHTILE at a time.  Grids whose
+//           domain misses a tile's bounding box are skipped for the whole
+//           tile; the points still unresolved are handed to the others in
+//           hierarchy order.
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vmgrid_valueBatch(Vmgrid *thee, int npts, double *pts,
+        double *values, double *grads, int *onGrid) {
+
+    int itile, ntile, non;
+
+    VASSERT(thee != VNULL);
+    if (npts <= 0) return 0;
+
+    non = 0;
+    ntile = (npts + VGRID_BATCHTILE - 1)/VGRID_BATCHTILE;
+    #pragma omp parallel for schedule(dynamic,1) reduction(+:non)
+    for (itile=0; itile<ntile; itile++) {
+        double tpts[3*VGRID_BATCHTILE], tval[VGRID_BATCHTILE];
+        double tgrad[3*VGRID_BATCHTILE], lower[3], upper[3], *pt;
+        int todo[VGRID_BATCHTILE], ton[VGRID_BATCHTILE];
+        int i, j, ig, ip, n, nleft, beg;
+        Vgrid *grid;
+
+        beg = itile*VGRID_BATCHTILE;
+        n = VMIN2(VGRID_BATCHTILE, npts - beg);
+        for (j=0; j<3; j++) {
+            lower[j] = VLARGE;
+            upper[j] = -VLARGE;
+        }
+        for (i=0; i<n; i++) {
+            ip = beg + i;
+            pt = pts + 3*(size_t)ip;
+            for (j=0; j<3; j++) {
+                lower[j] = VMIN2(lower[j], pt[j]);
+                upper[j] = VMAX2(upper[j], pt[j]);
+            }
+            values[ip] = 0.0;
+            if (grads != VNULL) {
+                for (j=0; j<3; j++) grads[3*(size_t)ip+j] = 0.0;
+            }
+            if (onGrid != VNULL) onGrid[ip] = 0;
+            todo[i] = ip;
+        }
+        nleft = n;
+
+        for (ig=0; (ig<thee->ngrids) && (nleft>0); ig++) {
+            grid = thee->grids[ig];
+            if ((upper[0] < grid->xmin - grid->hx) ||
+              (lower[0] > grid->xmax + grid->hx) ||
+              (upper[1] < grid->ymin - grid->hy) ||
+              (lower[1] > grid->ymax + grid->hy) ||
+              (upper[2] < grid->zmin - grid->hzed) ||
+              (lower[2] > grid->zmax + grid->hzed)) continue;
+            for (i=0; i<nleft; i++) {
+                for (j=0; j<3; j++) {
+                    tpts[3*i+j] = pts[3*(size_t)todo[i]+j];
+                }
+            }
+            Vgrid_valueBatch(grid, nleft, tpts, tval,
+              (grads != VNULL) ? tgrad : VNULL, ton);
+
+            /* Keep the points this grid resolved, compact the rest */
+            n = nleft;
+            nleft = 0;
+            for (i=0; i<n; i++) {
+                ip = todo[i];
+                if (!ton[i]) {
+                    todo[nleft++] = ip;
+                    continue;
+                }
+                values[ip] = tval[i];
+                if (grads != VNULL) {
+                    for (j=0; j<3; j++) grads[3*(size_t)ip+j] = tgrad[3*i+j];
+                }
+                if (onGrid != VNULL) onGrid[ip] = 1;
+                non++;
+            }
+        }
+    }
+
+    return non;
+}
+
 /* ///////////////////////////////////////////////////////////////////////////
 // Routine:  Vmgrid_curvature
 //
@@ -122,6 +122,24 @@ VEXTERNC int Vmgrid_ctor2(Vmgrid *thee);
  */
 VEXTERNC int Vmgrid_value(Vmgrid *thee, double x[3], double *value);
 
+/** @brief   Get values (and optionally gradients) at many points at once
+ *  @details Each point is resolved on the first grid in the hierarchy that
+ *           contains it, as in Vmgrid_value; grids are only searched for
+ *           the points of a tile that overlaps them.  Off-grid points get
+ *           zero values and gradients and are not reported.
+ *  @ingroup Vmgrid
+ *  @param   thee    Vmgrid object
+ *  @param   npts    Number of points
+ *  @param   pts     Point coordinates (x, y, z for each point; 3*npts)
+ *  @param   values  Set to the value at each point (npts)
+ *  @param   grads   If not VNULL, set to the gradient at each point (3*npts)
+ *  @param   onGrid  If not VNULL, set to 1 for points found in the
+ *                   hierarchy and 0 otherwise (npts)
+ *  @return  Number of points found in the hierarchy
+ */
+VEXTERNC int Vmgrid_valueBatch(Vmgrid *thee, int npts, double *pts,
+  double *values, double *grads, int *onGrid);
+
 /** @brief   Object destructor
  *  @ingroup Vmgrid
  *  @author  Nathan Baker
@@ -199,6 +199,123 @@ VPUBLIC int Vopot_pot(Vopot *thee, double pt[3], double *value) {
 
 }
 
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vopot_potBatch
+//
+// Purpose:  Grid points go through Vmgrid_valueBatch; only the points off
+//           the hierarchy are collected and given the analytic boundary
+//           values, with the atoms copied into flat arrays so the inner
+//           loop over atoms streams through memory.
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vopot_potBatch(Vopot *thee, int npts, double *pts,
+        double *values) {
+
+    Vatom *atom;
+    int i, ioff, noff, natoms, *onGrid, *off;
+    double T, eps_w, xkappa, pre, size, charge, *position, *apos, *acharge;
+    Valist *alist;
+
+    VASSERT(thee != VNULL);
+    if (npts <= 0) return 1;
+
+    onGrid = (int *)Vmem_malloc(VNULL, npts, sizeof(int));
+    if (Vmgrid_valueBatch(thee->mgrid, npts, pts, values, VNULL, onGrid)
+      == npts) {
+        Vmem_free(VNULL, npts, sizeof(int), (void **)&onGrid);
+        return 1;
+    }
+
+    /* Gather the off-grid points */
+    noff = 0;
+    for (i=0; i<npts; i++) {
+        if (!onGrid[i]) onGrid[noff++] = i;
+    }
+    off = onGrid;
+
+    eps_w = Vpbe_getSolventDiel(thee->pbe);
+    xkappa = (1.0e10)*Vpbe_getXkappa(thee->pbe);
+    T = Vpbe_getTemperature(thee->pbe);
+    alist = Vpbe_getValist(thee->pbe);
+    pre = 1.0/(4*VPI*Vunit_eps0*eps_w)*Vunit_ec/(Vunit_kb*T);
+
+    switch (thee->bcfl) {
+
+        case BCFL_ZERO:
+            for (ioff=0; ioff<noff; ioff++) values[off[ioff]] = 0.0;
+            break;
+
+        case BCFL_SDH:
+            size = (1.0e-10)*Vpbe_getSoluteRadius(thee->pbe);
+            position = Vpbe_getSoluteCenter(thee->pbe);
+            charge = Vunit_ec*Vpbe_getSoluteCharge(thee->pbe);
+            #pragma omp parallel for
+            for (ioff=0; ioff<noff; ioff++) {
+                double *pt, dist, val;
+                pt = pts + 3*(size_t)off[ioff];
+                dist = (1.0e-10)*VSQRT(VSQR(position[0] - pt[0])
+                  + VSQR(position[1] - pt[1]) + VSQR(position[2] - pt[2]));
+                val = pre*charge/dist;
+                if (xkappa != 0.0)
+                  val = val*(exp(-xkappa*(dist-size))/(1+xkappa*size));
+                values[off[ioff]] = val;
+            }
+            break;
+
+        case BCFL_MDH:
+            natoms = Valist_getNumberAtoms(alist);
+            apos = (double *)Vmem_malloc(VNULL, 3*natoms, sizeof(double));
+            acharge = (double *)Vmem_malloc(VNULL, natoms, sizeof(double));
+            for (i=0; i<natoms; i++) {
+                atom = Valist_getAtom(alist, i);
+                position = Vatom_getPosition(atom);
+                apos[3*i] = position[0];
+                apos[3*i+1] = position[1];
+                apos[3*i+2] = position[2];
+                size = (1e-10)*Vatom_getRadius(atom);
+                /* Fold the size-dependent screening factor into the charge */
+                acharge[i] = pre*Vunit_ec*Vatom_getCharge(atom);
+                if (xkappa != 0.0) {
+                    acharge[i] = acharge[i]*exp(xkappa*size)/(1+xkappa*size);
+                }
+            }
+            #pragma omp parallel for schedule(dynamic,16)
+            for (ioff=0; ioff<noff; ioff++) {
+                double *pt, dist, u;
+                int iatom;
+                pt = pts + 3*(size_t)off[ioff];
+                u = 0;
+                for (iatom=0; iatom<natoms; iatom++) {
+                    dist = (1.0e-10)*VSQRT(VSQR(apos[3*iatom] - pt[0])
+                      + VSQR(apos[3*iatom+1] - pt[1])
+                      + VSQR(apos[3*iatom+2] - pt[2]));
+                    if (xkappa != 0.0) {
+                        u += acharge[iatom]*exp(-xkappa*dist)/dist;
+                    } else u += acharge[iatom]/dist;
+                }
+                values[off[ioff]] = u;
+            }
+            Vmem_free(VNULL, 3*natoms, sizeof(double), (void **)&apos);
+            Vmem_free(VNULL, natoms, sizeof(double), (void **)&acharge);
+            break;
+
+        case BCFL_UNUSED:
+        case BCFL_FOCUS:
+            Vnm_print(2, "Vopot_potBatch:  Invalid bcfl flag (%d)!\n",
+              thee->bcfl);
+            Vmem_free(VNULL, npts, sizeof(int), (void **)&onGrid);
+            return 0;
+
+        default:
+            Vnm_print(2, "Vopot_potBatch:  Bogus thee->bcfl flag (%d)!\n",
+              thee->bcfl);
+            Vmem_free(VNULL, npts, sizeof(int), (void **)&onGrid);
+            return 0;
+    }
+
+    Vmem_free(VNULL, npts, sizeof(int), (void **)&onGrid);
+    return 1;
+}
+
 /* ///////////////////////////////////////////////////////////////////////////
 // Routine:  Vopot_curvature
 //
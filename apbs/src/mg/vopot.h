@@ -130,6 +130,21 @@ VEXTERNC int Vopot_ctor2(Vopot *thee, Vmgrid *mgrid, Vpbe *pbe, Vbcfl bcfl);
  */
 VEXTERNC int Vopot_pot(Vopot *thee, double x[3], double *pot);
 
+/** @brief   Get potential values (from mesh or approximation) at many
+ *           points at once
+ *  @details Same results as Vopot_pot for each point, up to rounding in the
+ *           analytic boundary values; only points off the mesh hierarchy
+ *           are given the boundary approximation.
+ *  @ingroup Vopot
+ *  @param   thee    Vopot obejct
+ *  @param   npts    Number of points
+ *  @param   pts     Point coordinates (x, y, z for each point; 3*npts)
+ *  @param   values  Set to dimensionless potential (units kT/e) at each point
+ *  @returns 1 if successful, 0 otherwise
+ */
+VEXTERNC int Vopot_potBatch(Vopot *thee, int npts, double *pts,
+  double *values);
+
 /** @brief   Object destructor
  *  @ingroup Vopot
  *  @author  Nathan Baker
@@ -72,6 +72,12 @@
 
 #include "vpmg.h"
 
+#ifdef HAVE_MKSTEMP
+#  include <unistd.h>
+#else
+#  include <time.h>
+#endif
+
 VEMBED(rcsid="$Id$")
 
 #if !defined(VINLINE_VPMG)
@@ -153,9 +159,9 @@ VPUBLIC Vpmg* Vpmg_ctor(Vpmgp *pmgp, Vpbe *pbe, int focusFlag,
 VPUBLIC int Vpmg_ctor2(Vpmg *thee, Vpmgp *pmgp, Vpbe *pbe, int focusFlag,
                        Vpmg *pmgOLD, MGparm *mgparm, PBEparm_calcEnergy energyFlag) {
 
-    int i, j, nion;
+    int i, nion;
     double ionConc[MAXION], ionQ[MAXION], ionRadii[MAXION], zkappa2, zks2;
-    double ionstr, partMin[3], partMax[3];
+    double ionstr;
 	size_t size;
 
     /* Get the parameters */
@@ -241,40 +247,7 @@ VPUBLIC int Vpmg_ctor2(Vpmg *thee, Vpmgp *pmgp, Vpbe *pbe, int focusFlag,
 
     if (focusFlag) {
 
-        /* Overwrite any default or user-specified boundary condition
-        * arguments; we are now committed to a calculation via focusing */
-        if (thee->pmgp->bcfl != BCFL_FOCUS) {
-            Vnm_print(2,
-                      "Vpmg_ctor2: reset boundary condition flag to BCFL_FOCUS!\n");
-            thee->pmgp->bcfl = BCFL_FOCUS;
-        }
-
-        /* Fill boundaries */
-        Vnm_print(0, "Vpmg_ctor2:  Filling boundary with old solution!\n");
-        focusFillBound(thee, pmgOLD);
-
-        /* Calculate energetic contributions from region outside focusing
-            * domain */
-        if (energyFlag != PCE_NO) {
-
-            if (mgparm->type == MCT_PARALLEL) {
-
-                for (j=0; j<3; j++) {
-                    partMin[j] = mgparm->partDisjCenter[j]
-                    - 0.5*mgparm->partDisjLength[j];
-                    partMax[j] = mgparm->partDisjCenter[j]
-                        + 0.5*mgparm->partDisjLength[j];
-                }
-
-            } else {
-                for (j=0; j<3; j++) {
-                    partMin[j] = mgparm->center[j] - 0.5*mgparm->glen[j];
-                    partMax[j] = mgparm->center[j] + 0.5*mgparm->glen[j];
-                }
-            }
-            extEnergy(thee, pmgOLD, energyFlag, partMin, partMax,
-                      mgparm->partDisjOwnSide);
-        }
+        focusSetup(thee, pmgOLD, mgparm, energyFlag);
 
     } else {
 
@@ -385,6 +358,11 @@ VPUBLIC int Vpmg_ctor2(Vpmg *thee, Vpmgp *pmgp, Vpbe *pbe, int focusFlag,
 
     /* The coefficient arrays have not been filled */
     thee->filled = 0;
+    thee->useCoefCache = 0;
+    thee->coefCache[0] = '\0';
+    thee->coefMap = VNULL;
+    thee->coefMapSize = 0;
+    thee->pinned = 0;
 
 
     /*
@@ -392,8 +370,10 @@ VPUBLIC int Vpmg_ctor2(Vpmg *thee, Vpmgp *pmgp, Vpbe *pbe, int focusFlag,
      *       This was originally moved out to kill a memory leak. The dtor has
      *       has been removed from initMG and placed back here to keep memory
      *       usage low. killMG has been modified accordingly.
+     *       A pinned level is shared by several finer levels (threaded
+     *       mg-para) and is destroyed by its owner instead.
      */
-    Vpmg_dtor(&pmgOLD);
+    if ((pmgOLD == VNULL) || !pmgOLD->pinned) Vpmg_dtor(&pmgOLD);
 
     return 1;
 }
@@ -434,6 +414,10 @@ VPUBLIC int Vpmg_solve(Vpmg *thee) {
         thee->a3cf[i] = thee->epsz[i];
     }
 
+    /* Start from zero or from the current solution; the initial guess is
+     * not part of the parameters Vpackmg encodes at construction */
+    VAT(thee->iparm, 23) = thee->pmgp->istrt;
+
     /* Fill the nonlinear coefficient array by multiplying the kappa
      * accessibility array (containing values between 0 and 1) by zkappa2. */
     zkappa2 = Vpbe_getZkappa2(thee->pbe);
@@ -558,6 +542,45 @@ VPUBLIC int Vpmg_solve(Vpmg *thee) {
 }
 
 
+VPUBLIC int Vpmg_update(Vpmg *thee, Vpmg *pmgOLD, MGparm *mgparm,
+        PBEparm_calcEnergy energyFlag) {
+
+    if (thee == VNULL) {
+        Vnm_print(2, "Vpmg_update:  got NULL thee!\n");
+        return 0;
+    }
+    if (!(thee->filled)) {
+        Vnm_print(2, "Vpmg_update:  Need to call Vpmg_fillco()!\n");
+        return 0;
+    }
+
+    /* Focused boundaries come from the coarser solution of this step */
+    if (pmgOLD != VNULL) {
+        focusSetup(thee, pmgOLD, mgparm, energyFlag);
+    } else if (thee->pmgp->bcfl == BCFL_FOCUS) {
+        Vnm_print(2, "Vpmg_update:  focused calculation needs the coarser \
+Vpmg!\n");
+        return 0;
+    }
+
+    /* Refill the coefficients (and non-focused boundaries) for the new atom
+     * positions with the settings of the last Vpmg_fillco call */
+    if (!Vpmg_fillco(thee, thee->surfMeth, thee->splineWin, thee->chargeMeth,
+          thee->useDielXMap, thee->dielXMap, thee->useDielYMap,
+          thee->dielYMap, thee->useDielZMap, thee->dielZMap,
+          thee->useKappaMap, thee->kappaMap, thee->usePotMap, thee->potMap,
+          thee->useChargeMap, thee->chargeMap)) {
+        Vnm_print(2, "Vpmg_update:  failed to refill coefficients!\n");
+        return 0;
+    }
+
+    /* The last solution is a close initial guess for the next solve */
+    thee->pmgp->istrt = 1;
+
+    return 1;
+}
+
+
 VPUBLIC void Vpmg_dtor(Vpmg **thee) {
 
     if ((*thee) != VNULL) {
@@ -580,18 +603,24 @@ VPUBLIC void Vpmg_dtor2(Vpmg *thee) {
       (void **)&(thee->iwork));
     Vmem_free(thee->vmem, thee->pmgp->nrwk, sizeof(double),
       (void **)&(thee->rwork));
-    Vmem_free(thee->vmem, thee->pmgp->narr, sizeof(double),
-      (void **)&(thee->charge));
-    Vmem_free(thee->vmem, thee->pmgp->narr, sizeof(double),
-      (void **)&(thee->kappa));
+    if (thee->coefMap != VNULL) {
+        /* The coefficient arrays live in a cache file mapping */
+        Vstring_unmapFile(thee->coefMap, thee->coefMapSize);
+        thee->coefMap = VNULL;
+    } else {
+        Vmem_free(thee->vmem, thee->pmgp->narr, sizeof(double),
+          (void **)&(thee->charge));
+        Vmem_free(thee->vmem, thee->pmgp->narr, sizeof(double),
+          (void **)&(thee->kappa));
+        Vmem_free(thee->vmem, thee->pmgp->narr, sizeof(double),
+          (void **)&(thee->epsx));
+        Vmem_free(thee->vmem, thee->pmgp->narr, sizeof(double),
+          (void **)&(thee->epsy));
+        Vmem_free(thee->vmem, thee->pmgp->narr, sizeof(double),
+          (void **)&(thee->epsz));
+    }
     Vmem_free(thee->vmem, thee->pmgp->narr, sizeof(double),
               (void **)&(thee->pot));
-    Vmem_free(thee->vmem, thee->pmgp->narr, sizeof(double),
-      (void **)&(thee->epsx));
-    Vmem_free(thee->vmem, thee->pmgp->narr, sizeof(double),
-      (void **)&(thee->epsy));
-    Vmem_free(thee->vmem, thee->pmgp->narr, sizeof(double),
-      (void **)&(thee->epsz));
     Vmem_free(thee->vmem, thee->pmgp->narr, sizeof(double),
       (void **)&(thee->a1cf));
     Vmem_free(thee->vmem, thee->pmgp->narr, sizeof(double),
@@ -889,248 +918,307 @@ VPUBLIC void Vpmg_unsetPart(Vpmg *thee) {
     }
 }
 
-VPUBLIC int Vpmg_fillArray(Vpmg *thee, double *vec, Vdata_Type type,
-  double parm, Vhal_PBEType pbetype, PBEparm *pbeparm) {
+VPUBLIC double Vpmg_exchangeBound(Vpmg *thee, int npart, Vpmg *part[]) {
 
-    Vacc *acc = VNULL;
-    Vpbe *pbe = VNULL;
-    Vgrid *grid = VNULL;
-    Vatom *atoms = VNULL;
-    Valist *alist = VNULL;
-    double position[3], hx, hy, hzed, xmin, ymin, zmin;
-    double grad[3], eps, epsp, epss, zmagic, u;
-    int i, j, k, l, nx, ny, nz, ichop;
+    int i, j, k, di, ip, l, nx, ny, nz, n[3], ijk[3], depth, best, isrc = 0,
+        *off = VNULL;
+    double h[3], min[3], pmin[3], shift, value, change, scale, *src = VNULL;
+    Vpmg *other = VNULL;
+
+    VASSERT(thee != VNULL);
 
-    pbe = thee->pbe;
-    acc = Vpbe_getVacc(pbe);
     nx = thee->pmgp->nx;
     ny = thee->pmgp->ny;
     nz = thee->pmgp->nz;
-    hx = thee->pmgp->hx;
-    hy = thee->pmgp->hy;
-    hzed = thee->pmgp->hzed;
-    xmin = thee->pmgp->xmin;
-    ymin = thee->pmgp->ymin;
-    zmin = thee->pmgp->zmin;
-    epsp = Vpbe_getSoluteDiel(pbe);
-    epss = Vpbe_getSolventDiel(pbe);
-    zmagic = Vpbe_getZmagic(pbe);
-
-    if (!(thee->filled)) {
-        Vnm_print(2, "Vpmg_fillArray:  need to call Vpmg_fillco first!\n");
-        return 0;
+    h[0] = thee->pmgp->hx;
+    h[1] = thee->pmgp->hy;
+    h[2] = thee->pmgp->hzed;
+    min[0] = thee->pmgp->xmin;
+    min[1] = thee->pmgp->ymin;
+    min[2] = thee->pmgp->zmin;
+
+    /* Index offsets of this mesh in each other mesh; -1 marks meshes that
+     * don't line up with this one */
+    off = (int *)Vmem_malloc(thee->vmem, 4*npart, sizeof(int));
+    for (ip=0; ip<npart; ip++) {
+        other = part[ip];
+        off[4*ip+3] = -1;
+        if ((other == VNULL) || (other == thee)) continue;
+        pmin[0] = other->pmgp->xmin;
+        pmin[1] = other->pmgp->ymin;
+        pmin[2] = other->pmgp->zmin;
+        if ((VABS(other->pmgp->hx - h[0]) > 1e-6*h[0]) ||
+            (VABS(other->pmgp->hy - h[1]) > 1e-6*h[1]) ||
+            (VABS(other->pmgp->hzed - h[2]) > 1e-6*h[2])) continue;
+        for (l=0; l<3; l++) {
+            shift = (min[l] - pmin[l])/h[l];
+            off[4*ip+l] = (int)VFLOOR(shift + 0.5);
+            if (VABS(shift - off[4*ip+l]) > 1e-3) break;
+        }
+        if (l == 3) off[4*ip+3] = ip;
     }
 
-    switch (type) {
+    change = 0.0;
+    scale = 0.0;
+    for (k=0; k<nz; k++) {
+        for (j=0; j<ny; j++) {
+            /* Only the x faces are on the boundary inside the y-z box */
+            di = ((j == 0) || (j == ny-1) || (k == 0) || (k == nz-1)) ?
+                1 : VMAX2(nx-1, 1);
+            for (i=0; i<nx; i+=di) {
+
+                /* Find the mesh this point lies deepest in */
+                best = 0;
+                src = VNULL;
+                for (ip=0; ip<npart; ip++) {
+                    if (off[4*ip+3] < 0) continue;
+                    other = part[ip];
+                    n[0] = other->pmgp->nx;
+                    n[1] = other->pmgp->ny;
+                    n[2] = other->pmgp->nz;
+                    ijk[0] = i + off[4*ip];
+                    ijk[1] = j + off[4*ip+1];
+                    ijk[2] = k + off[4*ip+2];
+                    depth = n[0];
+                    for (l=0; l<3; l++) {
+                        depth = VMIN2(depth, ijk[l]);
+                        depth = VMIN2(depth, n[l]-1-ijk[l]);
+                    }
+                    if (depth > best) {
+                        best = depth;
+                        isrc = ijk[0] + n[0]*(ijk[1] + n[1]*ijk[2]);
+                        src = other->u;
+                    }
+                }
+                if (src == VNULL) continue;
 
-        case VDT_CHARGE:
+                value = src[isrc];
+                scale = VMAX2(scale, VABS(value));
+                if (i == 0) {
+                    change = VMAX2(change, VABS(value - thee->gxcf[IJKx(j,k,0)]));
+                    thee->gxcf[IJKx(j,k,0)] = value;
+                }
+                if (i == nx-1) {
+                    change = VMAX2(change, VABS(value - thee->gxcf[IJKx(j,k,1)]));
+                    thee->gxcf[IJKx(j,k,1)] = value;
+                }
+                if (j == 0) {
+                    change = VMAX2(change, VABS(value - thee->gycf[IJKy(i,k,0)]));
+                    thee->gycf[IJKy(i,k,0)] = value;
+                }
+                if (j == ny-1) {
+                    change = VMAX2(change, VABS(value - thee->gycf[IJKy(i,k,1)]));
+                    thee->gycf[IJKy(i,k,1)] = value;
+                }
+                if (k == 0) {
+                    change = VMAX2(change, VABS(value - thee->gzcf[IJKz(i,j,0)]));
+                    thee->gzcf[IJKz(i,j,0)] = value;
+                }
+                if (k == nz-1) {
+                    change = VMAX2(change, VABS(value - thee->gzcf[IJKz(i,j,1)]));
+                    thee->gzcf[IJKz(i,j,1)] = value;
+                }
+            }
+        }
+    }
 
-            for (i=0; i<nx*ny*nz; i++) vec[i] = thee->charge[i]/zmagic;
-            break;
+    Vmem_free(thee->vmem, 4*npart, sizeof(int), (void **)&off);
 
-        case VDT_DIELX:
+    /* The current solution is a close initial guess for the next solve */
+    thee->pmgp->istrt = 1;
 
-            for (i=0; i<nx*ny*nz; i++) vec[i] = thee->epsx[i];
-            break;
+    if (scale > 0.0) return change/scale;
+    return 0.0;
+}
 
-        case VDT_DIELY:
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vpmg_fillPoint
+//
+// Purpose:  Evaluate one grid point of a Vpmg_fillArray quantity
+//
+// Notes:    Called concurrently; grid wraps thee->u for the derivative
+//           quantities and marks is the calling thread's Vacc scratch.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE double Vpmg_fillPoint(Vpmg *thee, Vgrid *grid, int *marks,
+  Vdata_Type type, double parm, Vhal_PBEType pbetype, int i, int j, int k) {
 
-            for (i=0; i<nx*ny*nz; i++) vec[i] = thee->epsy[i];
-            break;
+    Vpbe *pbe;
+    Vacc *acc;
+    double position[3], grad[3], eps, epsp, epss, u, q, value;
+    int l, nx, ny, nz, ichop;
 
-        case VDT_DIELZ:
+    pbe = thee->pbe;
+    acc = Vpbe_getVacc(pbe);
+    nx = thee->pmgp->nx;
+    ny = thee->pmgp->ny;
+    nz = thee->pmgp->nz;
+    position[0] = i*thee->pmgp->hx + thee->pmgp->xmin;
+    position[1] = j*thee->pmgp->hy + thee->pmgp->ymin;
+    position[2] = k*thee->pmgp->hzed + thee->pmgp->zmin;
 
-            for (i=0; i<nx*ny*nz; i++) vec[i] = thee->epsz[i];
-            break;
+    switch (type) {
 
-        case VDT_KAPPA:
+        case VDT_CHARGE:
+            return thee->charge[IJK(i,j,k)]/Vpbe_getZmagic(pbe);
 
-            for (i=0; i<nx*ny*nz; i++) vec[i] = thee->kappa[i];
-            break;
+        case VDT_DIELX:
+            return thee->epsx[IJK(i,j,k)];
 
-        case VDT_POT:
+        case VDT_DIELY:
+            return thee->epsy[IJK(i,j,k)];
 
-            for (i=0; i<nx*ny*nz; i++) vec[i] = thee->u[i];
-            break;
+        case VDT_DIELZ:
+            return thee->epsz[IJK(i,j,k)];
 
-        case VDT_ATOMPOT:
-            alist = thee->pbe->alist;
-            atoms = alist[pbeparm->molid-1].atoms;
-            grid = Vgrid_ctor(nx, ny, nz, hx, hy,
-                              hzed, xmin, ymin, zmin,thee->u);
-            for (i=0; i<alist[pbeparm->molid-1].number;i++) {
-                position[0] = atoms[i].position[0];
-                position[1] = atoms[i].position[1];
-                position[2] = atoms[i].position[2];
+        case VDT_KAPPA:
+            return thee->kappa[IJK(i,j,k)];
 
-                Vgrid_value(grid, position, &vec[i]);
-            }
-            Vgrid_dtor(&grid);
-            break;
+        case VDT_POT:
+            return thee->u[IJK(i,j,k)];
 
         case VDT_SMOL:
-
-            for (k=0; k<nz; k++) {
-                for (j=0; j<ny; j++) {
-                    for (i=0; i<nx; i++) {
-
-                        position[0] = i*hx + xmin;
-                        position[1] = j*hy + ymin;
-                        position[2] = k*hzed + zmin;
-
-                        vec[IJK(i,j,k)] = (Vacc_molAcc(acc,position,parm));
-                    }
-                }
-            }
-            break;
+            return Vacc_molAcc(acc, position, parm);
 
         case VDT_SSPL:
-
-            for (k=0; k<nz; k++) {
-                for (j=0; j<ny; j++) {
-                    for (i=0; i<nx; i++) {
-
-                        position[0] = i*hx + xmin;
-                        position[1] = j*hy + ymin;
-                        position[2] = k*hzed + zmin;
-
-                        vec[IJK(i,j,k)] = Vacc_splineAcc(acc,position,parm,0);
-                    }
-                }
-            }
-            break;
+            return Vacc_splineAccMarks(acc, position, parm, 0, marks);
 
         case VDT_VDW:
+            return Vacc_vdwAcc(acc, position);
 
-            for (k=0; k<nz; k++) {
-                for (j=0; j<ny; j++) {
-                    for (i=0; i<nx; i++) {
+        case VDT_IVDW:
+            return Vacc_ivdwAcc(acc, position, parm);
 
-                        position[0] = i*hx + xmin;
-                        position[1] = j*hy + ymin;
-                        position[2] = k*hzed + zmin;
+        case VDT_LAP:
+            if ((k==0) || (k==(nz-1)) ||
+                (j==0) || (j==(ny-1)) ||
+                (i==0) || (i==(nx-1))) return 0;
+            VASSERT(Vgrid_curvature(grid, position, 1, &value));
+            return value;
+
+        case VDT_EDENS:
+            epsp = Vpbe_getSoluteDiel(pbe);
+            epss = Vpbe_getSolventDiel(pbe);
+            VASSERT(Vgrid_gradient(grid, position, grad));
+            eps = epsp + (epss-epsp)*Vacc_molAcc(acc, position,
+              pbe->solventRadius);
+            value = 0.0;
+            for (l=0; l<3; l++) value += eps*VSQR(grad[l]);
+            return value;
 
-                        vec[IJK(i,j,k)] = Vacc_vdwAcc(acc,position);
+        case VDT_NDENS:
+        case VDT_QDENS:
+            value = 0.0;
+            u = thee->u[IJK(i,j,k)];
+            if ( VABS(Vacc_ivdwAcc(acc,
+                    position, pbe->maxIonRadius) - 1.0) < VSMALL) {
+                for (l=0; l<pbe->numIon; l++) {
+                    q = pbe->ionQ[l];
+                    /*  SMPBE Added */
+                    if (pbetype == PBE_NPBE || pbetype == PBE_SMPBE) {
+                        if (type == VDT_QDENS) {
+                            value += pbe->ionConc[l]*q*Vcap_exp(-q*u, &ichop);
+                        } else {
+                            value += pbe->ionConc[l]*Vcap_exp(-q*u, &ichop);
+                        }
+                    } else if (pbetype == PBE_LPBE) {
+                        if (type == VDT_QDENS) {
+                            value += pbe->ionConc[l]*q*(1 - q*u + 0.5*q*q*u*u);
+                        } else {
+                            value += pbe->ionConc[l]*(1 - q*u + 0.5*q*q*u*u);
+                        }
                     }
                 }
             }
-            break;
+            return value;
 
-        case VDT_IVDW:
+        default:
+            return 0.0;
+    }
+}
 
-            for (k=0; k<nz; k++) {
-                for (j=0; j<ny; j++) {
-                    for (i=0; i<nx; i++) {
+VPUBLIC int Vpmg_fillArray(Vpmg *thee, double *vec, Vdata_Type type,
+  double parm, Vhal_PBEType pbetype, PBEparm *pbeparm) {
 
-                        position[0] = i*hx + xmin;
-                        position[1] = j*hy + ymin;
-                        position[2] = k*hzed + zmin;
+    return Vpmg_fillArrayBox(thee, vec, type, parm, pbetype, pbeparm,
+      VNULL, VNULL);
+}
 
-                        vec[IJK(i,j,k)] = Vacc_ivdwAcc(acc,position,parm);
-                    }
-                }
-            }
-            break;
+VPUBLIC int Vpmg_fillArrayBox(Vpmg *thee, double *vec, Vdata_Type type,
+  double parm, Vhal_PBEType pbetype, PBEparm *pbeparm, int lo[3],
+  int hi[3]) {
 
-        case VDT_LAP:
+    Vacc *acc = VNULL;
+    Vgrid *grid = VNULL;
+    Vatom *atoms = VNULL;
+    Valist *alist = VNULL;
+    double hx, hy, hzed, xmin, ymin, zmin, *apos;
+    int i, j, k, nx, ny, nz, natoms, ilo[3], ihi[3];
 
-            grid = Vgrid_ctor(nx, ny, nz, hx, hy, hzed, xmin, ymin, zmin,
-              thee->u);
-            for (k=0; k<nz; k++) {
-                for (j=0; j<ny; j++) {
-                    for (i=0; i<nx; i++) {
+    acc = Vpbe_getVacc(thee->pbe);
+    nx = thee->pmgp->nx;
+    ny = thee->pmgp->ny;
+    nz = thee->pmgp->nz;
+    hx = thee->pmgp->hx;
+    hy = thee->pmgp->hy;
+    hzed = thee->pmgp->hzed;
+    xmin = thee->pmgp->xmin;
+    ymin = thee->pmgp->ymin;
+    zmin = thee->pmgp->zmin;
 
-                        if ((k==0) || (k==(nz-1)) ||
-                            (j==0) || (j==(ny-1)) ||
-                            (i==0) || (i==(nx-1))) {
+    if (!(thee->filled)) {
+        Vnm_print(2, "Vpmg_fillArray:  need to call Vpmg_fillco first!\n");
+        return 0;
+    }
 
-                            vec[IJK(i,j,k)] = 0;
+    switch (type) {
 
-                        } else {
-                                position[0] = i*hx + xmin;
-                                position[1] = j*hy + ymin;
-                                position[2] = k*hzed + zmin;
-                                VASSERT(Vgrid_curvature(grid,position, 1,
-                                  &(vec[IJK(i,j,k)])));
-                        }
-                    }
-                }
+        /* Atom-based; the box does not apply */
+        case VDT_ATOMPOT:
+            alist = thee->pbe->alist;
+            atoms = alist[pbeparm->molid-1].atoms;
+            grid = Vgrid_ctor(nx, ny, nz, hx, hy,
+                              hzed, xmin, ymin, zmin,thee->u);
+            natoms = alist[pbeparm->molid-1].number;
+            apos = (double *)Vmem_malloc(thee->vmem, 3*natoms,
+              sizeof(double));
+            for (i=0; i<natoms;i++) {
+                apos[3*i] = atoms[i].position[0];
+                apos[3*i+1] = atoms[i].position[1];
+                apos[3*i+2] = atoms[i].position[2];
             }
+            Vgrid_valueBatch(grid, natoms, apos, vec, VNULL, VNULL);
+            Vmem_free(thee->vmem, 3*natoms, sizeof(double), (void **)&apos);
             Vgrid_dtor(&grid);
+            return 1;
+
+        case VDT_CHARGE:
+        case VDT_DIELX:
+        case VDT_DIELY:
+        case VDT_DIELZ:
+        case VDT_KAPPA:
+        case VDT_POT:
+        case VDT_SSPL:
+        case VDT_VDW:
+        case VDT_IVDW:
+        case VDT_NDENS:
+        case VDT_QDENS:
             break;
 
-        case VDT_EDENS:
+        /* Vacc_molAcc builds the SAS points on first use; do that here
+         * rather than racing to do it from several threads */
+        case VDT_SMOL:
+            if (acc->surf == VNULL) Vacc_SASA(acc, parm);
+            break;
 
+        case VDT_EDENS:
+            if (acc->surf == VNULL) Vacc_SASA(acc, thee->pbe->solventRadius);
             grid = Vgrid_ctor(nx, ny, nz, hx, hy, hzed, xmin, ymin, zmin,
               thee->u);
-            for (k=0; k<nz; k++) {
-                for (j=0; j<ny; j++) {
-                    for (i=0; i<nx; i++) {
-
-                        position[0] = i*hx + xmin;
-                        position[1] = j*hy + ymin;
-                        position[2] = k*hzed + zmin;
-                        VASSERT(Vgrid_gradient(grid, position, grad));
-                        eps = epsp + (epss-epsp)*Vacc_molAcc(acc, position,
-                          pbe->solventRadius);
-                        vec[IJK(i,j,k)] = 0.0;
-                        for (l=0; l<3; l++)
-                          vec[IJK(i,j,k)] += eps*VSQR(grad[l]);
-                    }
-                }
-            }
-            Vgrid_dtor(&grid);
-            break;
-
-        case VDT_NDENS:
-
-            for (k=0; k<nz; k++) {
-                for (j=0; j<ny; j++) {
-                    for (i=0; i<nx; i++) {
-
-                        position[0] = i*hx + xmin;
-                        position[1] = j*hy + ymin;
-                        position[2] = k*hzed + zmin;
-                        vec[IJK(i,j,k)] = 0.0;
-                        u = thee->u[IJK(i,j,k)];
-                        if ( VABS(Vacc_ivdwAcc(acc,
-                                position, pbe->maxIonRadius) - 1.0) < VSMALL) {
-                            for (l=0; l<pbe->numIon; l++) {
-                                double q = pbe->ionQ[l];
-                                if (pbetype == PBE_NPBE || pbetype == PBE_SMPBE /*  SMPBE Added */) {
-                                    vec[IJK(i,j,k)] += pbe->ionConc[l]*Vcap_exp(-q*u, &ichop);
-                                } else if (pbetype == PBE_LPBE){
-                                    vec[IJK(i,j,k)] += pbe->ionConc[l]*(1 - q*u + 0.5*q*q*u*u);
-                                }
-                            }
-                        }
-                    }
-                }
-            }
             break;
 
-        case VDT_QDENS:
-
-            for (k=0; k<nz; k++) {
-            for (j=0; j<ny; j++) {
-            for (i=0; i<nx; i++) {
-                position[0] = i*hx + xmin;
-                position[1] = j*hy + ymin;
-                position[2] = k*hzed + zmin;
-                vec[IJK(i,j,k)] = 0.0;
-                u = thee->u[IJK(i,j,k)];
-                if ( VABS(Vacc_ivdwAcc(acc,
-                                position, pbe->maxIonRadius) - 1.0) < VSMALL) {
-                    for (l=0; l<pbe->numIon; l++) {
-                        double q = pbe->ionQ[l];
-                        if (pbetype == PBE_NPBE || pbetype == PBE_SMPBE /*  SMPBE Added */) {
-                            vec[IJK(i,j,k)] += pbe->ionConc[l]*q*Vcap_exp(-q*u, &ichop);
-                        } else if (pbetype == PBE_LPBE) {
-                            vec[IJK(i,j,k)] += pbe->ionConc[l]*q*(1 - q*u + 0.5*q*q*u*u);
-                        }
-                    }
-                }
-            }}}
+        case VDT_LAP:
+            grid = Vgrid_ctor(nx, ny, nz, hx, hy, hzed, xmin, ymin, zmin,
+              thee->u);
             break;
 
         default:
@@ -1141,6 +1229,42 @@ VPUBLIC int Vpmg_fillArray(Vpmg *thee, double *vec, Vdata_Type type,
 
     }
 
+    /* Clip the requested box to the grid; points outside it are zeroed */
+    ilo[0] = 0; ilo[1] = 0; ilo[2] = 0;
+    ihi[0] = nx-1; ihi[1] = ny-1; ihi[2] = nz-1;
+    if ((lo != VNULL) && (hi != VNULL)) {
+        for (i=0; i<3; i++) {
+            ilo[i] = VMAX2(ilo[i], lo[i]);
+            ihi[i] = VMIN2(ihi[i], hi[i]);
+        }
+        for (i=0; i<nx*ny*nz; i++) vec[i] = 0.0;
+    }
+
+    /* Planes are independent; the Vacc-based quantities cost very different
+     * amounts inside and outside the molecule, so hand them out one by
+     * one */
+#pragma omp parallel default(shared) private(i,j,k)
+    {
+        int *marks = VNULL;
+        if (type == VDT_SSPL) {
+            marks = (int*)calloc(Valist_getNumberAtoms(acc->alist),
+              sizeof(int));
+            VASSERT(marks != VNULL);
+        }
+#pragma omp for schedule(dynamic, 1)
+        for (k=ilo[2]; k<=ihi[2]; k++) {
+            for (j=ilo[1]; j<=ihi[1]; j++) {
+                for (i=ilo[0]; i<=ihi[0]; i++) {
+                    vec[IJK(i,j,k)] = Vpmg_fillPoint(thee, grid, marks, type,
+                      parm, pbetype, i, j, k);
+                }
+            }
+        }
+        if (marks != VNULL) free(marks);
+    }
+
+    if (grid != VNULL) Vgrid_dtor(&grid);
+
     return 1;
 
 }
@@ -1911,6 +2035,51 @@ VPRIVATE void Vpmg_splineSelect(int srfm,Vacc *acc,double *gpos,double win,
     return;
 }
 
+VPRIVATE void focusSetup(Vpmg *thee,
+                         Vpmg *pmgOLD,
+                         MGparm *mgparm,
+                         PBEparm_calcEnergy energyFlag
+                        ) {
+
+    int j;
+    double partMin[3], partMax[3];
+
+    /* Overwrite any default or user-specified boundary condition
+    * arguments; we are now committed to a calculation via focusing */
+    if (thee->pmgp->bcfl != BCFL_FOCUS) {
+        Vnm_print(2,
+                  "focusSetup:  reset boundary condition flag to BCFL_FOCUS!\n");
+        thee->pmgp->bcfl = BCFL_FOCUS;
+    }
+
+    /* Fill boundaries */
+    Vnm_print(0, "focusSetup:  Filling boundary with old solution!\n");
+    focusFillBound(thee, pmgOLD);
+
+    /* Calculate energetic contributions from region outside focusing
+        * domain */
+    if (energyFlag != PCE_NO) {
+
+        if (mgparm->type == MCT_PARALLEL) {
+
+            for (j=0; j<3; j++) {
+                partMin[j] = mgparm->partDisjCenter[j]
+                - 0.5*mgparm->partDisjLength[j];
+                partMax[j] = mgparm->partDisjCenter[j]
+                    + 0.5*mgparm->partDisjLength[j];
+            }
+
+        } else {
+            for (j=0; j<3; j++) {
+                partMin[j] = mgparm->center[j] - 0.5*mgparm->glen[j];
+                partMax[j] = mgparm->center[j] + 0.5*mgparm->glen[j];
+            }
+        }
+        extEnergy(thee, pmgOLD, energyFlag, partMin, partMax,
+                  mgparm->partDisjOwnSide);
+    }
+}
+
 VPRIVATE void focusFillBound(Vpmg *thee,
                              Vpmg *pmgOLD
                             ) {
@@ -4174,8 +4343,8 @@ VPRIVATE void bcfl_mem(double zmem, double L, double eps_m, double eps_w,
 VPRIVATE void bcfl_map(Vpmg *thee){
 
     Vpbe *pbe;
-    double position[3], pot, hx, hy, hzed;
-    int i, j, k, nx, ny, nz, rc;
+    double hx, hy, hzed, *pts;
+    int i, j, k, nx, ny, nz, *onGrid;
 
 
     VASSERT(thee != VNULL);
@@ -4191,24 +4360,28 @@ VPRIVATE void bcfl_map(Vpmg *thee){
     /* Reset the potential array */
     for (i=0; i<(nx*ny*nz); i++) thee->pot[i] = 0.0;
 
-    /* Fill in the source term (atomic potentials) */
+    /* Fill in the source term (atomic potentials), one z-plane at a time */
     Vnm_print(0, "Vpmg_fillco:  filling in source term.\n");
+    pts = (double *)Vmem_malloc(thee->vmem, 3*nx*ny, sizeof(double));
+    onGrid = (int *)Vmem_malloc(thee->vmem, nx*ny, sizeof(int));
     for (k=0; k<nz; k++) {
         for (j=0; j<ny; j++) {
             for (i=0; i<nx; i++) {
-                position[0] = thee->xf[i];
-                position[1] = thee->yf[j];
-                position[2] = thee->zf[k];
-                rc = Vgrid_value(thee->potMap, position, &pot);
-                if (!rc) {
-                    Vnm_print(2, "fillcoChargeMap:  Error -- fell off of potential map at (%g, %g, %g)!\n",
-                              position[0], position[1], position[2]);
-                    VASSERT(0);
-                }
-                thee->pot[IJK(i,j,k)] = pot;
+                pts[3*(j*nx+i)] = thee->xf[i];
+                pts[3*(j*nx+i)+1] = thee->yf[j];
+                pts[3*(j*nx+i)+2] = thee->zf[k];
             }
         }
+        if (Vgrid_valueBatch(thee->potMap, nx*ny, pts,
+          &(thee->pot[IJK(0,0,k)]), VNULL, onGrid) != nx*ny) {
+            for (i=0; onGrid[i]; i++);
+            Vnm_print(2, "fillcoChargeMap:  Error -- fell off of potential map at (%g, %g, %g)!\n",
+                      pts[3*i], pts[3*i+1], pts[3*i+2]);
+            VASSERT(0);
+        }
     }
+    Vmem_free(thee->vmem, 3*nx*ny, sizeof(double), (void **)&pts);
+    Vmem_free(thee->vmem, nx*ny, sizeof(int), (void **)&onGrid);
 
 }
 
@@ -5652,6 +5825,291 @@ VPRIVATE void fillcoChargeSpline2(Vpmg *thee) {
     } /* endfor (each atom) */
 }
 
+/** @brief  Magic string at the start of coefficient cache files
+ *  @ingroup  Vpmg */
+#define VPMG_COEFCACHE_MAGIC "APBSCOEF"
+/** @brief  Coefficient cache file format version
+ *  @ingroup  Vpmg */
+#define VPMG_COEFCACHE_VERSION 1
+
+/**
+ * @brief  Header of a coefficient cache file; it is followed by the charge,
+ *         kappa, epsx, epsy and epsz arrays (nx*ny*nz doubles each)
+ * @ingroup  Vpmg
+ */
+typedef struct sVpmgCoefHeader {
+    char magic[8];  /**< VPMG_COEFCACHE_MAGIC (not terminated) */
+    int version;  /**< VPMG_COEFCACHE_VERSION */
+    int nx;  /**< Grid points in x */
+    int ny;  /**< Grid points in y */
+    int nz;  /**< Grid points in z */
+    unsigned long long key;  /**< Content hash (see fillcoCacheKey) */
+} VpmgCoefHeader;
+
+/**
+ * @brief  Fold bytes into a 64-bit FNV-1a hash
+ * @ingroup  Vpmg
+ * @returns  Updated hash
+ */
+VPRIVATE unsigned long long fillcoCacheHash(unsigned long long hash,
+        const void *data, size_t len) {
+
+    const unsigned char *byte = (const unsigned char *)data;
+    size_t i;
+
+    for (i=0; i<len; i++) {
+        hash ^= (unsigned long long)byte[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief  Hash everything the fillco charge, kappa and dielectric maps
+ *         depend on
+ * @ingroup  Vpmg
+ * @returns  Cache key
+ */
+VPRIVATE unsigned long long fillcoCacheKey(Vpmg *thee) {
+
+    unsigned long long key = 14695981039346656037ULL;
+    Vpbe *pbe;
+    Valist *alist;
+    Vatom *atom;
+    double dval[32], *pos;
+    int ival[16], i, n;
+
+    pbe = thee->pbe;
+    alist = pbe->alist;
+
+    n = 0;
+    ival[n++] = VPMG_COEFCACHE_VERSION;
+    ival[n++] = thee->pmgp->nx;
+    ival[n++] = thee->pmgp->ny;
+    ival[n++] = thee->pmgp->nz;
+    ival[n++] = (int)thee->surfMeth;
+    ival[n++] = (int)thee->chargeMeth;
+    ival[n++] = (int)thee->chargeSrc;
+    ival[n++] = pbe->numIon;
+    ival[n++] = pbe->ipkey;
+    ival[n++] = pbe->param2Flag;
+    ival[n++] = Valist_getNumberAtoms(alist);
+    key = fillcoCacheHash(key, ival, n*sizeof(int));
+
+    n = 0;
+    dval[n++] = thee->pmgp->hx;
+    dval[n++] = thee->pmgp->hy;
+    dval[n++] = thee->pmgp->hzed;
+    dval[n++] = thee->pmgp->xmin;
+    dval[n++] = thee->pmgp->ymin;
+    dval[n++] = thee->pmgp->zmin;
+    dval[n++] = thee->splineWin;
+    dval[n++] = pbe->solventRadius;
+    dval[n++] = pbe->soluteDiel;
+    dval[n++] = pbe->solventDiel;
+    dval[n++] = pbe->bulkIonicStrength;
+    dval[n++] = pbe->maxIonRadius;
+    dval[n++] = pbe->T;
+    dval[n++] = pbe->smvolume;
+    dval[n++] = pbe->smsize;
+    dval[n++] = pbe->z_mem;
+    dval[n++] = pbe->L;
+    dval[n++] = pbe->membraneDiel;
+    dval[n++] = pbe->V;
+    dval[n++] = pbe->xkappa;
+    dval[n++] = pbe->zkappa2;
+    dval[n++] = pbe->zmagic;
+    dval[n++] = pbe->acc->surf_density;
+    key = fillcoCacheHash(key, dval, n*sizeof(double));
+    for (i=0; i<pbe->numIon; i++) {
+        dval[0] = pbe->ionConc[i];
+        dval[1] = pbe->ionRadii[i];
+        dval[2] = pbe->ionQ[i];
+        key = fillcoCacheHash(key, dval, 3*sizeof(double));
+    }
+
+    for (i=0; i<Valist_getNumberAtoms(alist); i++) {
+        atom = Valist_getAtom(alist, i);
+        pos = Vatom_getPosition(atom);
+        dval[0] = pos[0];
+        dval[1] = pos[1];
+        dval[2] = pos[2];
+        dval[3] = Vatom_getRadius(atom);
+        dval[4] = Vatom_getCharge(atom);
+        key = fillcoCacheHash(key, dval, 5*sizeof(double));
+#if defined(WITH_TINKER)
+        /* The multipole charge sources are spread from these */
+        key = fillcoCacheHash(key, atom->dipole, 3*sizeof(double));
+        key = fillcoCacheHash(key, atom->quadrupole, 9*sizeof(double));
+        key = fillcoCacheHash(key, atom->inducedDipole, 3*sizeof(double));
+        key = fillcoCacheHash(key, atom->nlInducedDipole, 3*sizeof(double));
+#endif /* if defined(WITH_TINKER) */
+    }
+
+    return key;
+}
+
+/**
+ * @brief  Load the coefficient maps from the cache
+ * @ingroup  Vpmg
+ * @note  The charge, kappa and eps arrays are pointed straight into a
+ *        private copy-on-write mapping of the file rather than copied out
+ *        of it, so pages are only read when the solver touches them and
+ *        later writes to the arrays never reach the file
+ * @returns  1 on a cache hit, 0 otherwise
+ */
+VPRIVATE int fillcoCacheRead(Vpmg *thee, const char *path,
+        unsigned long long key) {
+
+    VpmgCoefHeader header;
+    size_t n, size, mapSize;
+    double **arrays[5];
+    char *map;
+    int i;
+
+    n = (size_t)(thee->pmgp->nx)*(thee->pmgp->ny)*(thee->pmgp->nz);
+    size = sizeof(VpmgCoefHeader) + 5*n*sizeof(double);
+    arrays[0] = &(thee->charge);
+    arrays[1] = &(thee->kappa);
+    arrays[2] = &(thee->epsx);
+    arrays[3] = &(thee->epsy);
+    arrays[4] = &(thee->epsz);
+
+    map = Vstring_mapFile(path, &mapSize, 1);
+    if (map == VNULL) return 0;
+    if (mapSize != size) {
+        Vstring_unmapFile(map, mapSize);
+        return 0;
+    }
+    memcpy(&header, map, sizeof(VpmgCoefHeader));
+    if ((memcmp(header.magic, VPMG_COEFCACHE_MAGIC, 8) != 0) ||
+      (header.version != VPMG_COEFCACHE_VERSION) ||
+      (header.nx != thee->pmgp->nx) || (header.ny != thee->pmgp->ny) ||
+      (header.nz != thee->pmgp->nz) || (header.key != key)) {
+        Vstring_unmapFile(map, mapSize);
+        return 0;
+    }
+
+    /* Give up the arrays (or an earlier mapping) and point into this one */
+    if (thee->coefMap != VNULL) {
+        Vstring_unmapFile(thee->coefMap, thee->coefMapSize);
+    }
+    for (i=0; i<5; i++) {
+        if (thee->coefMap == VNULL) {
+            Vmem_free(thee->vmem, thee->pmgp->narr, sizeof(double),
+              (void **)arrays[i]);
+        }
+        *(arrays[i]) = (double *)(map + sizeof(VpmgCoefHeader) +
+          i*n*sizeof(double));
+    }
+    thee->coefMap = map;
+    thee->coefMapSize = mapSize;
+
+    return 1;
+}
+
+/**
+ * @brief  Store the coefficient maps in the cache
+ * @ingroup  Vpmg
+ * @note  The file is written under a unique temporary name and renamed
+ *        into place, so concurrent readers never see a partial file and
+ *        concurrent writers of the same key never share a temporary file
+ * @returns  1 if successful, 0 otherwise
+ */
+VPRIVATE int fillcoCacheWrite(Vpmg *thee, const char *path,
+        unsigned long long key) {
+
+    VpmgCoefHeader header;
+    char tmppath[VMAX_ARGLEN+64];
+    double *arrays[5];
+    size_t n;
+    FILE *fp;
+    int i;
+#ifdef HAVE_MKSTEMP
+    int fd;
+#endif
+
+    n = (size_t)(thee->pmgp->nx)*(thee->pmgp->ny)*(thee->pmgp->nz);
+    arrays[0] = thee->charge;
+    arrays[1] = thee->kappa;
+    arrays[2] = thee->epsx;
+    arrays[3] = thee->epsy;
+    arrays[4] = thee->epsz;
+
+    memset(&header, 0, sizeof(VpmgCoefHeader));
+    memcpy(header.magic, VPMG_COEFCACHE_MAGIC, 8);
+    header.version = VPMG_COEFCACHE_VERSION;
+    header.nx = thee->pmgp->nx;
+    header.ny = thee->pmgp->ny;
+    header.nz = thee->pmgp->nz;
+    header.key = key;
+
+#ifdef HAVE_MKSTEMP
+    if (snprintf(tmppath, sizeof(tmppath), "%s.XXXXXX", path) >=
+      (int)sizeof(tmppath)) return 0;
+    fd = mkstemp(tmppath);
+    if (fd < 0) return 0;
+    fp = fdopen(fd, "wb");
+    if (fp == VNULL) {
+        close(fd);
+        remove(tmppath);
+        return 0;
+    }
+#else
+    /* Without mkstemp, tell writers apart by the time and the address of
+     * the calculation */
+    if (snprintf(tmppath, sizeof(tmppath), "%s.%lx-%lx.tmp", path,
+      (unsigned long)time(VNULL), (unsigned long)thee) >=
+      (int)sizeof(tmppath)) return 0;
+    fp = fopen(tmppath, "wb");
+    if (fp == VNULL) return 0;
+#endif
+    if (fwrite(&header, sizeof(VpmgCoefHeader), 1, fp) != 1) {
+        fclose(fp);
+        remove(tmppath);
+        return 0;
+    }
+    for (i=0; i<5; i++) {
+        if (fwrite(arrays[i], sizeof(double), n, fp) != n) {
+            fclose(fp);
+            remove(tmppath);
+            return 0;
+        }
+    }
+    if (fclose(fp) != 0) {
+        remove(tmppath);
+        return 0;
+    }
+    if (rename(tmppath, path) != 0) {
+        remove(tmppath);
+        return 0;
+    }
+
+    return 1;
+}
+
+VPUBLIC int Vpmg_setCoefCache(Vpmg *thee, const char *dir) {
+
+    if (thee == VNULL) {
+        Vnm_print(2, "Vpmg_setCoefCache:  got NULL thee!\n");
+        return 0;
+    }
+
+    if ((dir == VNULL) || (dir[0] == '\0')) {
+        thee->useCoefCache = 0;
+        thee->coefCache[0] = '\0';
+        return 1;
+    }
+    if (strlen(dir) >= VMAX_ARGLEN) {
+        Vnm_print(2, "Vpmg_setCoefCache:  cache path too long!\n");
+        return 0;
+    }
+    strcpy(thee->coefCache, dir);
+    thee->useCoefCache = 1;
+
+    return 1;
+}
+
 VPUBLIC int Vpmg_fillco(Vpmg *thee,
                         Vsurf_Meth surfMeth,
                         double splineWin,
@@ -5690,7 +6148,11 @@ VPUBLIC int Vpmg_fillco(Vpmg *thee,
         nx,
         ny,
         nz,
-        islap;
+        islap,
+        useCache,
+        cached;
+    unsigned long long key;
+    char cachePath[VMAX_ARGLEN+64];
     Vrc_Codes rc;
 
     if (thee == VNULL) {
@@ -5773,38 +6235,70 @@ VPUBLIC int Vpmg_fillco(Vpmg *thee,
     /* Reset the tcf array */
     for (i=0; i<(nx*ny*nz); i++) thee->tcf[i] = 0.0;
 
-    /* Fill in the source term (atomic charges) */
-    Vnm_print(0, "Vpmg_fillco:  filling in source term.\n");
-    rc = fillcoCharge(thee);
-    switch(rc) {
-        case VRC_SUCCESS:
-            break;
-        case VRC_WARNING:
-            Vnm_print(2, "Vpmg_fillco:  non-fatal errors while filling charge map!\n");
-            break;
-        case VRC_FAILURE:
-            Vnm_print(2, "Vpmg_fillco:  fatal errors while filling charge map!\n");
-            return 0;
-            break;
+    /* Look for the coefficient maps in the cache; maps read from external
+     * files are not hashed, so those calculations bypass the cache */
+    useCache = thee->useCoefCache && !(thee->useDielXMap ||
+      thee->useDielYMap || thee->useDielZMap || thee->useKappaMap ||
+      thee->usePotMap || thee->useChargeMap);
+    cached = 0;
+    key = 0;
+    if (useCache) {
+        key = fillcoCacheKey(thee);
+        snprintf(cachePath, sizeof(cachePath), "%s/coef-%016llx.bin",
+          thee->coefCache, key);
+        cached = fillcoCacheRead(thee, cachePath, key);
+        if (cached) {
+            Vnm_print(0, "Vpmg_fillco:  read coefficient maps from %s\n",
+              cachePath);
+        }
     }
 
-    /* THE FOLLOWING NEEDS TO BE DONE IF WE'RE NOT USING A SIMPLE LAPLACIAN
-     * OPERATOR */
-    if (!islap) {
-        Vnm_print(0, "Vpmg_fillco:  marking ion and solvent accessibility.\n");
-        fillcoCoef(thee);
-        Vnm_print(0, "Vpmg_fillco:  done filling coefficient arrays\n");
+    if (!cached) {
+
+        /* Fill in the source term (atomic charges) */
+        Vnm_print(0, "Vpmg_fillco:  filling in source term.\n");
+        rc = fillcoCharge(thee);
+        switch(rc) {
+            case VRC_SUCCESS:
+                break;
+            case VRC_WARNING:
+                Vnm_print(2, "Vpmg_fillco:  non-fatal errors while filling charge map!\n");
+                break;
+            case VRC_FAILURE:
+                Vnm_print(2, "Vpmg_fillco:  fatal errors while filling charge map!\n");
+                return 0;
+                break;
+        }
+
+        /* THE FOLLOWING NEEDS TO BE DONE IF WE'RE NOT USING A SIMPLE LAPLACIAN
+         * OPERATOR */
+        if (!islap) {
+            Vnm_print(0, "Vpmg_fillco:  marking ion and solvent accessibility.\n");
+            fillcoCoef(thee);
+            Vnm_print(0, "Vpmg_fillco:  done filling coefficient arrays\n");
 
-    } else { /* else (!islap) ==> It's a Laplacian operator! */
+        } else { /* else (!islap) ==> It's a Laplacian operator! */
 
-        for (i=0; i<(nx*ny*nz); i++) {
-            thee->kappa[i] = 0.0;
-            thee->epsx[i] = epsp;
-            thee->epsy[i] = epsp;
-            thee->epsz[i] = epsp;
+            for (i=0; i<(nx*ny*nz); i++) {
+                thee->kappa[i] = 0.0;
+                thee->epsx[i] = epsp;
+                thee->epsy[i] = epsp;
+                thee->epsz[i] = epsp;
+            }
+
+        } /* endif (!islap) */
+
+        if (useCache) {
+            if (fillcoCacheWrite(thee, cachePath, key)) {
+                Vnm_print(0, "Vpmg_fillco:  wrote coefficient maps to %s\n",
+                  cachePath);
+            } else {
+                Vnm_print(2, "Vpmg_fillco:  unable to write coefficient cache \
+%s!\n", cachePath);
+            }
         }
 
-    } /* endif (!islap) */
+    } /* endif (!cached) */
 
     /* Fill the boundary arrays (except when focusing, bcfl = 4) */
     if (thee->pmgp->bcfl != BCFL_FOCUS) {
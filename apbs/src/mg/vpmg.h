@@ -186,6 +186,18 @@ struct sVpmg {
   int useChargeMap;  /**< Indicates whether Vpmg_fillco was called with an
                       * external charge distribution map */
   Vgrid *chargeMap;  /**< External charge distribution map */
+
+  int useCoefCache;  /**< Indicates whether Vpmg_fillco should look up and
+                      * store its coefficient maps in an on-disk cache */
+  char coefCache[VMAX_ARGLEN];  /**< Directory holding the coefficient map
+                                 * cache (see Vpmg_setCoefCache) */
+  char *coefMap;  /**< Private mapping of the cache file the charge, kappa
+                   * and eps arrays point into after a cache hit (VNULL if
+                   * the arrays were allocated here) */
+  size_t coefMapSize;  /**< Size of coefMap in bytes */
+
+  int pinned;  /**< Set to keep this object when a finer level focuses from
+                * it; Vpmg_ctor2 otherwise destroys the old level */
 };
 
 /**
@@ -298,6 +310,27 @@ VEXTERNC int Vpmg_fillco(
         Vgrid *chargeMap  /**< External charge map */
         );
 
+/** @brief   Enable the on-disk coefficient map cache for Vpmg_fillco
+ *
+ *           When enabled, Vpmg_fillco hashes everything its charge,
+ *           dielectric and ion-accessibility maps depend on (atom positions,
+ *           radii and charges, grid geometry, surface and charge
+ *           discretization, solvent radius, spline window, dielectric
+ *           constants and ion parameters) and looks for a file named
+ *           coef-<hash>.bin in the cache directory.  On a hit the charge,
+ *           kappa and epsx/epsy/epsz arrays are loaded from the
+ *           (memory-mapped) file instead of being recomputed; on a miss
+ *           they are computed and written to the cache.  The cache is not
+ *           used when any of the maps are read from external files.
+ *  @ingroup Vpmg
+ *  @returns  1 if successful, 0 otherwise
+ */
+VEXTERNC int Vpmg_setCoefCache(
+        Vpmg *thee,  /**< Vpmg object */
+        const char *dir  /**< Existing cache directory; VNULL or an empty
+                          * string disables the cache */
+        );
+
 /** @brief   Solve the PBE using PMG
  *  @ingroup Vpmg
  *  @author  Nathan Baker
@@ -307,6 +340,26 @@ VEXTERNC int Vpmg_solve(
         Vpmg *thee  /**< Vpmg object */
         );
 
+/** @brief   Bring a solved Vpmg object up to date after the atoms of its
+ *           Vpbe object have moved or changed charge
+ *
+ *           The grid and all work arrays are kept: the focused boundary is
+ *           refilled from pmgOLD (if given), the coefficient maps are
+ *           refilled with the arguments of the last Vpmg_fillco call, and the
+ *           next Vpmg_solve starts from the current solution instead of
+ *           zero.  Call Vpbe_updateAtoms first.
+ *  @ingroup Vpmg
+ *  @returns  1 if successful, 0 otherwise
+ */
+VEXTERNC int Vpmg_update(
+        Vpmg *thee,  /**< Vpmg object, filled at least once */
+        Vpmg *pmgOLD,  /**< Already solved coarser Vpmg this object focuses
+                        * from, or VNULL if it is not focused */
+        MGparm *mgparm,  /**< Multigrid parameters of thee */
+        PBEparm_calcEnergy energyFlag  /**< Energies to compute outside the
+                                        * focused domain (see Vpmg_ctor) */
+        );
+
 /** @brief   Solve Poisson's equation with a homogeneous Laplacian operator
  *           using the solvent dielectric constant.  This solution is
  *           performed by a sine wave decomposition.
@@ -583,6 +636,45 @@ VEXTERNC int Vpmg_fillArray(
         PBEparm * pbeparm /**< Pass in the PBE parameters (if needed) */
         );
 
+/** @brief  Fill part of the specified array with accessibility values
+ *  @details Only the grid points in the index box [lo, hi] are computed;
+ *           the rest of the array is set to zero.  The points are evaluated
+ *           in parallel.  VDT_ATOMPOT is atom-based and ignores the box.
+ *  @ingroup  Vpmg
+ *  @returns  1 if successful, 0 otherwise
+ */
+VEXTERNC int Vpmg_fillArrayBox(
+        Vpmg *thee,  /**< Vpmg object */
+        double *vec,  /**< A nx*ny*nz*sizeof(double) array to contain the
+                        values to be written */
+        Vdata_Type type,  /**< What to write */
+        double parm,  /**< Parameter for data type definition (if needed) */
+        Vhal_PBEType pbetype, /**< Parameter for PBE type (if needed) */
+        PBEparm * pbeparm, /**< Pass in the PBE parameters (if needed) */
+        int lo[3],  /**< Lowest (i,j,k) to compute, or VNULL for the whole
+                      grid */
+        int hi[3]  /**< Highest (i,j,k) to compute, or VNULL for the whole
+                     grid */
+        );
+
+/** @brief  Refill the Dirichlet boundary values of a partition from the
+ *          solutions of the partitions that overlap it
+ *  @details Each boundary point that lies strictly inside another mesh of
+ *           the same spacing takes that mesh's potential; where several
+ *           meshes hold the point, the one it lies deepest in wins.  Points
+ *           on the outer boundary keep their focused values.  Call this for
+ *           every partition before solving any of them again (additive
+ *           Schwarz).  The next solve starts from the current solution.
+ *  @ingroup  Vpmg
+ *  @returns  The largest change of an exchanged boundary value, relative to
+ *            the largest exchanged value (0 if nothing was exchanged)
+ */
+VEXTERNC double Vpmg_exchangeBound(
+        Vpmg *thee,  /**< Vpmg object to refill */
+        int npart,  /**< Number of partitions */
+        Vpmg *part[]  /**< Solved partitions (may include thee) */
+        );
+
 /** @brief   Computes the field at an atomic center using a stencil based
  *           on the first derivative of a 5th order B-spline
  *  @ingroup Vpmg
@@ -1049,6 +1141,17 @@ VPRIVATE void focusFillBound(
         Vpmg *pmg  /** Old PMG object */
         );
 
+/**
+ * @brief  For focusing, switch to focused boundary conditions, fill the
+ * boundary from the old mesh and compute the energy outside the new mesh
+ */
+VPRIVATE void focusSetup(
+        Vpmg *thee,  /** New PMG object */
+        Vpmg *pmgOLD,  /** Old PMG object */
+        MGparm *mgparm,  /** Multigrid parameters of the new object */
+        PBEparm_calcEnergy energyFlag  /** Energy calculation flag */
+        );
+
 /**
  * @brief  Increment all boundary points by
  *         pre1*(charge/d)*(exp(-xkappa*(d-size))/(1+xkappa*size) to add the
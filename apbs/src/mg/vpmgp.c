@@ -130,6 +130,7 @@ value: %g \n", thee->errtol);
         * accelerated PBE (for dynamics, etc.) */
     thee->itmax = 200;
     thee->istop = 1;
+    thee->istrt = 0;
     thee->iinfo = 1;         /* I'd recommend either 1 (for debugging LPBE) or 2 (for debugging NPBE), higher values give too much output */
 
     thee->bcfl = BCFL_SDH;
@@ -127,6 +127,9 @@ struct sVpmgp {
                  * \li 3: errc
                  * \li 4: errd
                  * \li 5: aerrd */
+    int istrt;  /**< Initial guess for the solver [default = 0]
+                 * \li 0: zero
+                 * \li 1: current solution (warm start) */
     int iinfo;  /**< Runtime status messages [default = 1]
                  * \li 0: none
                  * \li 1: some
@@ -0,0 +1,497 @@
+/**
+ *  @file    vslab.c
+ *  @brief   Class Vslab methods
+ *  @ingroup Vslab
+ *  @version $Id$
+ *  @attention
+ *  @verbatim
+ *
+ * APBS -- Adaptive Poisson-Boltzmann Solver
+ *
+ *  Nathan A. Baker (nathan.baker@pnnl.gov)
+ *  Pacific Northwest National Laboratory
+ *
+ *  Additional contributing authors listed in the code documentation.
+ *
+ * Copyright (c) 2010-2020 Battelle Memorial Institute. Developed at the
+ * Pacific Northwest National Laboratory, operated by Battelle Memorial
+ * Institute, Pacific Northwest Division for the U.S. Department of Energy.
+ *
+ * Portions Copyright (c) 2002-2010, Washington University in St. Louis.
+ * Portions Copyright (c) 2002-2020, Nathan A. Baker.
+ * Portions Copyright (c) 1999-2002, The Regents of the University of
+ * California.
+ * Portions Copyright (c) 1995, Michael Holst.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the developer nor the names of its contributors may be
+ * used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @endverbatim
+ */
+
+#include "vopot.h"
+
+#include "vslab.h"
+
+#include <ctype.h>
+#include <limits.h>
+#ifdef HAVE_FSEEKO
+#  include <sys/types.h>
+#endif
+
+VEMBED(rcsid="$Id$")
+
+/** @brief  Size of the text read buffer (bytes)
+ *  @ingroup  Vslab */
+#define VSLAB_BUFSIZE (1<<20)
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vslab_refill
+//
+// Purpose:  Keep the unparsed tail of the text buffer and append the next
+//           chunk of the file after it
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void Vslab_refill(Vslab *thee) {
+
+    size_t n;
+
+    n = thee->buflen - thee->bufpos;
+    if ((n > 0) && (thee->bufpos > 0)) {
+        memmove(thee->buf, thee->buf + thee->bufpos, n);
+    }
+    thee->buflen = n;
+    thee->bufpos = 0;
+    n = fread(thee->buf + thee->buflen, 1, thee->bufsize - thee->buflen,
+      thee->fp);
+    if (n == 0) thee->eof = 1;
+    thee->buflen += n;
+    thee->buf[thee->buflen] = '\0';
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vslab_ctorRead
+//
+// Purpose:  Parse the OpenDX header from the first buffer of the file with
+//           Vgrid_parseDXHeader, leaving the file at the data block
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC Vslab* Vslab_ctorRead(const char *fname, Vdata_Format format) {
+
+    Vslab *thee = VNULL;
+    const char *p;
+    double origin[3], spacing[3];
+    int dims[3], rc;
+    unsigned long items;
+
+    if ((format != VDF_DX) && (format != VDF_DXBIN)) {
+        Vnm_print(2, "Vslab_ctorRead:  Unsupported format (%d)!\n", format);
+        return VNULL;
+    }
+
+    thee = (Vslab *)Vmem_malloc(VNULL, 1, sizeof(Vslab));
+    VASSERT(thee != VNULL);
+    thee->format = format;
+    thee->write = 0;
+    thee->iplane = 0;
+    thee->rowlen = VNULL;
+    thee->bufsize = VSLAB_BUFSIZE;
+    thee->bufpos = 0;
+    thee->buflen = 0;
+    thee->eof = 0;
+    thee->buf = (char *)Vmem_malloc(VNULL, thee->bufsize+1, sizeof(char));
+    thee->buf[0] = '\0';
+
+    thee->fp = fopen(fname, (format == VDF_DXBIN) ? "rb" : "r");
+    if (thee->fp == VNULL) {
+        Vnm_print(2, "Vslab_ctorRead:  Problem opening %s!\n", fname);
+        goto VERROR1;
+    }
+
+    Vslab_refill(thee);
+    p = thee->buf;
+    rc = Vgrid_parseDXHeader(&p, thee->buf + thee->buflen, dims, origin,
+      spacing, &items);
+    if ((rc != 1) || (dims[0] < 1) || (dims[1] < 1) || (dims[2] < 1) ||
+      (items != (unsigned long)dims[0]*dims[1]*dims[2])) {
+        Vnm_print(2, "Vslab_ctorRead:  Format problem with input file <%s>\n",
+          fname);
+        goto VERROR2;
+    }
+    thee->nx = dims[0];
+    thee->ny = dims[1];
+    thee->nz = dims[2];
+    thee->xmin = origin[0];
+    thee->ymin = origin[1];
+    thee->zmin = origin[2];
+    thee->hx = spacing[0];
+    thee->hy = spacing[1];
+    thee->hzed = spacing[2];
+    thee->xmax = thee->xmin + (thee->nx-1)*thee->hx;
+    thee->ymax = thee->ymin + (thee->ny-1)*thee->hy;
+    thee->zmax = thee->zmin + (thee->nz-1)*thee->hzed;
+
+    if (format == VDF_DX) {
+        /* The rest of the buffer is the start of the data block */
+        thee->bufpos = (size_t)(p - thee->buf);
+    } else {
+        /* Binary doubles start on the line after "data follows" */
+        while ((p < thee->buf + thee->buflen) && (*p != '\n')) p++;
+        if ((p == thee->buf + thee->buflen) ||
+          (fseek(thee->fp, (long)(p + 1 - thee->buf), SEEK_SET) != 0)) {
+            Vnm_print(2, "Vslab_ctorRead:  Format problem with input file \
+<%s>\n", fname);
+            goto VERROR2;
+        }
+        Vmem_free(VNULL, thee->bufsize+1, sizeof(char), (void **)&(thee->buf));
+        thee->bufsize = 0;
+        thee->buflen = 0;
+    }
+
+    return thee;
+
+VERROR2:
+    fclose(thee->fp);
+VERROR1:
+    Vmem_free(VNULL, thee->bufsize+1, sizeof(char), (void **)&(thee->buf));
+    Vmem_free(VNULL, 1, sizeof(Vslab), (void **)&thee);
+    return VNULL;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vslab_ctorWrite
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC Vslab* Vslab_ctorWrite(const char *fname, Vdata_Format format,
+  int nx, int ny, int nz, double xmin, double ymin, double zmin,
+  double hx, double hy, double hzed, const char *title) {
+
+    Vslab *thee = VNULL;
+    char header[2*VMAX_BUFSIZE];
+    size_t len;
+
+    if ((format != VDF_DX) && (format != VDF_DXBIN)) {
+        Vnm_print(2, "Vslab_ctorWrite:  Unsupported format (%d)!\n", format);
+        return VNULL;
+    }
+
+    thee = (Vslab *)Vmem_malloc(VNULL, 1, sizeof(Vslab));
+    VASSERT(thee != VNULL);
+    thee->format = format;
+    thee->write = 1;
+    thee->iplane = 0;
+    thee->nx = nx;
+    thee->ny = ny;
+    thee->nz = nz;
+    thee->xmin = xmin;
+    thee->ymin = ymin;
+    thee->zmin = zmin;
+    thee->hx = hx;
+    thee->hy = hy;
+    thee->hzed = hzed;
+    thee->xmax = xmin + (nx-1)*hx;
+    thee->ymax = ymin + (ny-1)*hy;
+    thee->zmax = zmin + (nz-1)*hzed;
+    thee->buf = VNULL;
+    thee->rowlen = VNULL;
+    thee->bufsize = 0;
+    thee->bufpos = 0;
+    thee->buflen = 0;
+    thee->eof = 0;
+
+    thee->fp = fopen(fname, (format == VDF_DXBIN) ? "wb" : "w");
+    if (thee->fp == VNULL) {
+        Vnm_print(2, "Vslab_ctorWrite:  Problem opening %s for writing!\n",
+          fname);
+        Vmem_free(VNULL, 1, sizeof(Vslab), (void **)&thee);
+        return VNULL;
+    }
+
+    len = Vgrid_formatDXHeader(header, sizeof(header), title, nx, ny, nz,
+      xmin, ymin, zmin, hx, hy, hzed, (format == VDF_DXBIN));
+    if ((len == 0) || (fwrite(header, 1, len, thee->fp) != len)) {
+        Vnm_print(2, "Vslab_ctorWrite:  Problem writing header to %s!\n",
+          fname);
+        fclose(thee->fp);
+        Vmem_free(VNULL, 1, sizeof(Vslab), (void **)&thee);
+        return VNULL;
+    }
+
+    if (format == VDF_DX) {
+        thee->bufsize = (size_t)ny*(VGRID_DXVALLEN*(size_t)nz + 2);
+        thee->buf = (char *)Vmem_malloc(VNULL, thee->bufsize, sizeof(char));
+        thee->rowlen = (size_t *)Vmem_malloc(VNULL, ny, sizeof(size_t));
+    }
+
+    return thee;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vslab_dtor
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC void Vslab_dtor(Vslab **thee) {
+
+    if ((*thee) != VNULL) {
+        if ((*thee)->fp != VNULL) fclose((*thee)->fp);
+        if ((*thee)->buf != VNULL) {
+            Vmem_free(VNULL, (*thee)->bufsize + ((*thee)->write ? 0 : 1),
+              sizeof(char), (void **)&((*thee)->buf));
+        }
+        if ((*thee)->rowlen != VNULL) {
+            Vmem_free(VNULL, (*thee)->ny, sizeof(size_t),
+              (void **)&((*thee)->rowlen));
+        }
+        Vmem_free(VNULL, 1, sizeof(Vslab), (void **)thee);
+        (*thee) = VNULL;
+    }
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vslab_parse
+//
+// Purpose:  Parse the next whitespace-separated value of a text data block
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vslab_parse(Vslab *thee, double *value) {
+
+    char *p, *q, *end, *e;
+
+    while (1) {
+        p = thee->buf + thee->bufpos;
+        end = thee->buf + thee->buflen;
+        while ((p < end) && isspace((unsigned char)*p)) p++;
+        for (q = p; (q < end) && !isspace((unsigned char)*q); q++);
+        if ((q == end) && !thee->eof &&
+          ((p > thee->buf) || (thee->buflen < thee->bufsize))) {
+            /* The token may continue in the next chunk */
+            thee->bufpos = (size_t)(p - thee->buf);
+            Vslab_refill(thee);
+            continue;
+        }
+        if (p == q) return 0;
+        *value = strtod(p, &e);
+        if (e != q) return 0;
+        thee->bufpos = (size_t)(q - thee->buf);
+        return 1;
+    }
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vslab_read
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vslab_read(Vslab *thee, int nplanes, double *data) {
+
+    size_t n, u;
+
+    VASSERT(thee != VNULL);
+    VASSERT(!thee->write);
+    if (thee->iplane + nplanes > thee->nx) return 0;
+
+    n = (size_t)nplanes*thee->ny*thee->nz;
+    if (thee->format == VDF_DXBIN) {
+        if (fread(data, sizeof(double), n, thee->fp) != n) return 0;
+    } else {
+        for (u=0; u<n; u++) {
+            if (!Vslab_parse(thee, &(data[u]))) return 0;
+        }
+    }
+    thee->iplane += nplanes;
+
+    return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vslab_skip
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vslab_skip(Vslab *thee, int nplanes) {
+
+    size_t n, u;
+    double dtmp;
+#ifndef HAVE_FSEEKO
+    size_t len;
+#endif
+
+    VASSERT(thee != VNULL);
+    VASSERT(!thee->write);
+    if (thee->iplane + nplanes > thee->nx) return 0;
+
+    n = (size_t)nplanes*thee->ny*thee->nz;
+    if (thee->format == VDF_DXBIN) {
+#ifdef HAVE_FSEEKO
+        if (fseeko(thee->fp, (off_t)(n*sizeof(double)), SEEK_CUR) != 0) {
+            return 0;
+        }
+#else
+        /* Seek in steps that fit in a long */
+        for (u=n*sizeof(double); u>0; u-=len) {
+            len = VMIN2(u, (size_t)LONG_MAX);
+            if (fseek(thee->fp, (long)len, SEEK_CUR) != 0) return 0;
+        }
+#endif
+    } else {
+        for (u=0; u<n; u++) {
+            if (!Vslab_parse(thee, &dtmp)) return 0;
+        }
+    }
+    thee->iplane += nplanes;
+
+    return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vslab_readWindow
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vslab_readWindow(Vslab *thee, int i, double *win,
+  double **left, double **cur, double **right) {
+
+    size_t n;
+
+    VASSERT(thee != VNULL);
+    n = (size_t)thee->ny*thee->nz;
+
+    if (i == 0) {
+        if (!Vslab_read(thee, VMIN2(thee->nx, 2), win)) return 0;
+    } else if (i+1 < thee->nx) {
+        if (!Vslab_read(thee, 1, &(win[((i+1)%3)*n]))) return 0;
+    }
+    *cur = &(win[(i%3)*n]);
+    *left = (i > 0) ? &(win[((i+2)%3)*n]) : VNULL;
+    *right = (i+1 < thee->nx) ? &(win[((i+1)%3)*n]) : VNULL;
+
+    return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vslab_gradient
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vslab_gradient(Vslab *thee, double *left, double *cur,
+  double *right, int j, int k, double grad[3]) {
+
+    int ny, nz;
+    size_t u;
+
+    ny = thee->ny;
+    nz = thee->nz;
+    if ((thee->nx < 2) || (ny < 2) || (nz < 2)) return 0;
+    u = (size_t)j*nz + k;
+
+    if (left && right) grad[0] = (right[u] - left[u])/(2*thee->hx);
+    else if (right) grad[0] = (right[u] - cur[u])/thee->hx;
+    else grad[0] = (cur[u] - left[u])/thee->hx;
+
+    if ((j > 0) && (j < ny-1)) grad[1] = (cur[u+nz] - cur[u-nz])/(2*thee->hy);
+    else if (j < ny-1) grad[1] = (cur[u+nz] - cur[u])/thee->hy;
+    else grad[1] = (cur[u] - cur[u-nz])/thee->hy;
+
+    if ((k > 0) && (k < nz-1)) grad[2] = (cur[u+1] - cur[u-1])/(2*thee->hzed);
+    else if (k < nz-1) grad[2] = (cur[u+1] - cur[u])/thee->hzed;
+    else grad[2] = (cur[u] - cur[u-1])/thee->hzed;
+
+    return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vslab_write
+//
+// Purpose:  Write x-planes in the layout of Vgrid_writeDX: values
+//           formatted by Vgrid_formatExp, three to a line, counting across
+//           planes
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vslab_write(Vslab *thee, int nplanes, double *data) {
+
+    int p, j, k, ny, nz;
+    size_t n, g, rowcap, len;
+    char *s, *row, trailer[VMAX_BUFSIZE];
+    FILE *fp;
+
+    VASSERT(thee != VNULL);
+    VASSERT(thee->write);
+    if (thee->iplane + nplanes > thee->nx) return 0;
+
+    fp = thee->fp;
+    ny = thee->ny;
+    nz = thee->nz;
+    n = (size_t)ny*nz;
+    if (thee->format == VDF_DXBIN) {
+        if (fwrite(data, sizeof(double), n*nplanes, fp) != n*nplanes) {
+            return 0;
+        }
+        thee->iplane += nplanes;
+    } else {
+        rowcap = VGRID_DXVALLEN*(size_t)nz + 2;
+        for (p=0; p<nplanes; p++) {
+            #pragma omp parallel for private(k, g, s, row)
+            for (j=0; j<ny; j++) {
+                row = &(thee->buf[(size_t)j*rowcap]);
+                s = row;
+                g = ((size_t)thee->iplane*ny + j)*nz;
+                for (k=0; k<nz; k++, g++) {
+                    s += Vgrid_formatExp(data[(size_t)p*n + (size_t)j*nz + k],
+                      s);
+                    if ((g % 3) == 2) *(s++) = '\n';
+                }
+                thee->rowlen[j] = (size_t)(s - row);
+            }
+            for (j=0; j<ny; j++) {
+                row = &(thee->buf[(size_t)j*rowcap]);
+                len = thee->rowlen[j];
+                if (fwrite(row, 1, len, fp) != len) return 0;
+            }
+            (thee->iplane)++;
+        }
+    }
+
+    /* Close off the data block and create the field */
+    if (thee->iplane == thee->nx) {
+        len = Vgrid_formatDXTrailer(trailer, sizeof(trailer),
+          (thee->format == VDF_DXBIN) || (((size_t)thee->nx*n) % 3 != 0));
+        if (fwrite(trailer, 1, len, fp) != len) return 0;
+        if (fflush(fp) != 0) return 0;
+        if (ferror(fp)) return 0;
+    }
+
+    return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vslab_congruent
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vslab_congruent(Vslab *thee, Vslab *other) {
+
+    double tol;
+
+    VASSERT(thee != VNULL);
+    VASSERT(other != VNULL);
+
+    if ((thee->nx != other->nx) || (thee->ny != other->ny) ||
+      (thee->nz != other->nz)) return 0;
+    tol = 1e-3*VMIN2(VMIN2(thee->hx, thee->hy), thee->hzed);
+    if ((VABS(thee->xmin - other->xmin) > tol) ||
+      (VABS(thee->ymin - other->ymin) > tol) ||
+      (VABS(thee->zmin - other->zmin) > tol) ||
+      (VABS(thee->xmax - other->xmax) > tol) ||
+      (VABS(thee->ymax - other->ymax) > tol) ||
+      (VABS(thee->zmax - other->zmax) > tol)) return 0;
+
+    return 1;
+}
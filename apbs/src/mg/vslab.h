@@ -0,0 +1,224 @@
+/** @defgroup Vslab Vslab class
+ *  @brief  Streaming, plane-by-plane access to OpenDX grid files
+ */
+
+/**
+ *  @file    vslab.h
+ *  @ingroup Vslab
+ *  @brief   Streaming, plane-by-plane access to OpenDX grid files
+ *  @version $Id$
+ *
+ *  @attention
+ *  @verbatim
+ *
+ * APBS -- Adaptive Poisson-Boltzmann Solver
+ *
+ *  Nathan A. Baker (nathan.baker@pnnl.gov)
+ *  Pacific Northwest National Laboratory
+ *
+ *  Additional contributing authors listed in the code documentation.
+ *
+ * Copyright (c) 2010-2020 Battelle Memorial Institute. Developed at the
+ * Pacific Northwest National Laboratory, operated by Battelle Memorial
+ * Institute, Pacific Northwest Division for the U.S. Department of Energy.
+ *
+ * Portions Copyright (c) 2002-2010, Washington University in St. Louis.
+ * Portions Copyright (c) 2002-2010, Nathan A. Baker.
+ * Portions Copyright (c) 1999-2002, The Regents of the University of
+ * California.
+ * Portions Copyright (c) 1995, Michael Holst.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the developer nor the names of its contributors may be
+ * used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @endverbatim
+ */
+
+#ifndef _VSLAB_H_
+#define _VSLAB_H_
+
+#include "apbscfg.h"
+
+#include "maloc/maloc.h"
+
+#include "generic/vhal.h"
+
+/**
+ *  @ingroup Vslab
+ *  @brief   Open OpenDX grid file that is read or written one x-plane at
+ *           a time
+ *  @details An OpenDX file stores its data with x varying slowest and z
+ *           fastest, so each x-plane is a contiguous run of ny*nz values.
+ *           A Vslab exposes exactly that: planes are read or written in
+ *           order as arrays indexed by (j*nz + k), which lets grid tools
+ *           work on maps much larger than memory.  Note that this is the
+ *           transpose of the Vgrid data layout.
+ */
+struct sVslab {
+
+    FILE *fp;  /**< Open file */
+    Vdata_Format format;  /**< VDF_DX or VDF_DXBIN */
+    int write;  /**< 1 if the file is being written, 0 if read */
+    int nx;  /**< Number of x grid points (planes) */
+    int ny;  /**< Number of y grid points */
+    int nz;  /**< Number of z grid points */
+    double hx;  /**< Grid spacing in x direction */
+    double hy;  /**< Grid spacing in y direction */
+    double hzed;  /**< Grid spacing in z direction */
+    double xmin;  /**< x coordinate of lower grid corner */
+    double ymin;  /**< y coordinate of lower grid corner */
+    double zmin;  /**< z coordinate of lower grid corner */
+    double xmax;  /**< x coordinate of upper grid corner */
+    double ymax;  /**< y coordinate of upper grid corner */
+    double zmax;  /**< z coordinate of upper grid corner */
+    int iplane;  /**< Number of planes read or written so far */
+    char *buf;  /**< Text buffer (parsing or formatting) */
+    size_t *rowlen;  /**< Formatted length of each row (text writes) */
+    size_t bufsize;  /**< Capacity of buf */
+    size_t bufpos;  /**< Parse position in buf */
+    size_t buflen;  /**< Valid bytes in buf */
+    int eof;  /**< Set when the read side has reached end of file */
+};
+
+/**
+ *  @ingroup Vslab
+ *  @brief   Declaration of the Vslab class as the Vslab structure
+ */
+typedef struct sVslab Vslab;
+
+/** @brief   Open an OpenDX file for streaming reads
+ *  @details The header is parsed and the file is left positioned at the
+ *           first x-plane.
+ *  @ingroup Vslab
+ *  @param   fname   Path to the file
+ *  @param   format  VDF_DX or VDF_DXBIN
+ *  @returns Newly allocated object, or VNULL if the file could not be opened
+ *           or its header is not a regular OpenDX grid
+ */
+VEXTERNC Vslab* Vslab_ctorRead(const char *fname, Vdata_Format format);
+
+/** @brief   Open an OpenDX file for streaming writes
+ *  @details The header is written immediately; the data block and field
+ *           trailer are completed by the Vslab_write call that supplies the
+ *           last plane.  The header and trailer are formatted by
+ *           Vgrid_formatDXHeader and Vgrid_formatDXTrailer.
+ *  @ingroup Vslab
+ *  @param   fname   Path to the file
+ *  @param   format  VDF_DX or VDF_DXBIN
+ *  @param   nx      Number of x grid points
+ *  @param   ny      Number of y grid points
+ *  @param   nz      Number of z grid points
+ *  @param   xmin    x coordinate of lower grid corner
+ *  @param   ymin    y coordinate of lower grid corner
+ *  @param   zmin    z coordinate of lower grid corner
+ *  @param   hx      Grid spacing in x direction
+ *  @param   hy      Grid spacing in y direction
+ *  @param   hzed    Grid spacing in z direction
+ *  @param   title   Title for the file comments
+ *  @returns Newly allocated object, or VNULL if the file could not be
+ *           created
+ */
+VEXTERNC Vslab* Vslab_ctorWrite(const char *fname, Vdata_Format format,
+  int nx, int ny, int nz, double xmin, double ymin, double zmin,
+  double hx, double hy, double hzed, const char *title);
+
+/** @brief   Object destructor; closes the file
+ *  @ingroup Vslab
+ *  @param   thee  Pointer to memory location of object
+ */
+VEXTERNC void Vslab_dtor(Vslab **thee);
+
+/** @brief   Read the next x-planes
+ *  @ingroup Vslab
+ *  @param   thee     Vslab object opened with Vslab_ctorRead
+ *  @param   nplanes  Number of planes to read
+ *  @param   data     Set to the plane values; plane p, point (j,k) is at
+ *                    data[(p*ny + j)*nz + k] (nplanes*ny*nz)
+ *  @returns 1 if successful, 0 on a short or malformed file
+ */
+VEXTERNC int Vslab_read(Vslab *thee, int nplanes, double *data);
+
+/** @brief   Skip the next x-planes without returning them
+ *  @ingroup Vslab
+ *  @param   thee     Vslab object opened with Vslab_ctorRead
+ *  @param   nplanes  Number of planes to skip
+ *  @returns 1 if successful, 0 on a short or malformed file
+ */
+VEXTERNC int Vslab_skip(Vslab *thee, int nplanes);
+
+/** @brief   Advance a three-plane window to x-plane i
+ *  @details Calls must be made for i = 0, 1, ..., nx-1 in turn on a freshly
+ *           opened file; each call reads at most one plane.
+ *  @ingroup Vslab
+ *  @param   thee   Vslab object opened with Vslab_ctorRead
+ *  @param   i      Plane to center the window on
+ *  @param   win    Ring buffer of 3*ny*nz values owned by the caller
+ *  @param   left   Set to plane i-1, or VNULL if i is the first plane
+ *  @param   cur    Set to plane i
+ *  @param   right  Set to plane i+1, or VNULL if i is the last plane
+ *  @returns 1 if successful, 0 on a short or malformed file
+ */
+VEXTERNC int Vslab_readWindow(Vslab *thee, int i, double *win,
+  double **left, double **cur, double **right);
+
+/** @brief   Gradient at a grid node from a three-plane window
+ *  @details Centered differences in the interior and one-sided differences
+ *           on the boundary; this is what Vgrid_gradient returns at a grid
+ *           node.
+ *  @ingroup Vslab
+ *  @param   thee   Grid the planes belong to
+ *  @param   left   Plane i-1, or VNULL at the lower x boundary
+ *  @param   cur    Plane i
+ *  @param   right  Plane i+1, or VNULL at the upper x boundary
+ *  @param   j      y index of the node
+ *  @param   k      z index of the node
+ *  @param   grad   Set to the gradient
+ *  @returns 1 if successful, 0 if the grid is flat along some axis
+ */
+VEXTERNC int Vslab_gradient(Vslab *thee, double *left, double *cur,
+  double *right, int j, int k, double grad[3]);
+
+/** @brief   Write the next x-planes
+ *  @details Text rows are formatted concurrently; the trailer is written
+ *           and the file flushed once the last plane has been supplied.
+ *  @ingroup Vslab
+ *  @param   thee     Vslab object opened with Vslab_ctorWrite
+ *  @param   nplanes  Number of planes to write
+ *  @param   data     Plane values, laid out as for Vslab_read
+ *  @returns 1 if successful, 0 on an I/O error
+ */
+VEXTERNC int Vslab_write(Vslab *thee, int nplanes, double *data);
+
+/** @brief   Check whether two grids have the same points
+ *  @ingroup Vslab
+ *  @param   thee   First grid
+ *  @param   other  Second grid
+ *  @returns 1 if dimensions, origins and spacings agree, 0 otherwise
+ */
+VEXTERNC int Vslab_congruent(Vslab *thee, Vslab *other);
+
+#endif
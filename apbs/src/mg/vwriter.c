@@ -0,0 +1,517 @@
+/**
+ *  @file    vwriter.c
+ *  @brief   Class Vwriter methods
+ *  @ingroup Vwriter
+ *  @version $Id$
+ *  @attention
+ *  @verbatim
+ *
+ * APBS -- Adaptive Poisson-Boltzmann Solver
+ *
+ *  Nathan A. Baker (nathan.baker@pnnl.gov)
+ *  Pacific Northwest National Laboratory
+ *
+ *  Additional contributing authors listed in the code documentation.
+ *
+ * Copyright (c) 2010-2020 Battelle Memorial Institute. Developed at the
+ * Pacific Northwest National Laboratory, operated by Battelle Memorial
+ * Institute, Pacific Northwest Division for the U.S. Department of Energy.
+ *
+ * Portions Copyright (c) 2002-2010, Washington University in St. Louis.
+ * Portions Copyright (c) 2002-2020, Nathan A. Baker.
+ * Portions Copyright (c) 1999-2002, The Regents of the University of
+ * California.
+ * Portions Copyright (c) 1995, Michael Holst.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the developer nor the names of its contributors may be
+ * used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @endverbatim
+ */
+
+#include "vwriter.h"
+
+#include <errno.h>
+
+VEMBED(rcsid="$Id$")
+
+#if !defined(HAVE_PTHREAD)
+#   define pthread_mutex_lock(lock)
+#   define pthread_mutex_unlock(lock)
+#endif
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vwriter_unchecked
+//
+// Purpose:  Whether the Vgrid writer for a format reports problems only on
+//           the console.  Their targets are removed before the write is
+//           queued, so Vwriter_exists cannot mistake a stale file for
+//           this write's output.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vwriter_unchecked(Vdata_Format format) {
+
+    return ((format == VDF_DX) || (format == VDF_DXBIN) ||
+      (format == VDF_UHBD));
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vwriter_exists
+//
+// Purpose:  Check that a write left a non-empty file behind
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vwriter_exists(const char *fname) {
+
+    FILE *fp;
+    long size;
+
+    fp = fopen(fname, "rb");
+    if (fp == VNULL) return 0;
+    size = 0;
+    if (fseek(fp, 0, SEEK_END) == 0) size = ftell(fp);
+    fclose(fp);
+
+    return (size > 0);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vwriter_writeFlat
+//
+// Purpose:  Write per-atom values as a flat text file
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vwriter_writeFlat(const char *fname, const char *title,
+  int ndata, double *data) {
+
+    Vio *sock;
+    int i;
+
+    Vnm_print(0, "Vwriter_writeFlat:  Opening virtual socket...\n");
+    sock = Vio_ctor("FILE", "ASC", VNULL, fname, "w");
+    if (sock == VNULL) {
+        Vnm_print(2, "Vwriter_writeFlat:  Problem opening virtual socket %s\n",
+          fname);
+        return 0;
+    }
+    if (Vio_connect(sock, 0) < 0) {
+        Vnm_print(2, "Vwriter_writeFlat:  Problem connecting virtual socket \
+%s\n", fname);
+        Vio_dtor(&sock);
+        return 0;
+    }
+    Vio_printf(sock, "# Data from %s\n", PACKAGE_STRING);
+    Vio_printf(sock, "# \n");
+    Vio_printf(sock, "# %s\n", title);
+    Vio_printf(sock, "# \n");
+    for (i=0; i<ndata; i++) Vio_printf(sock, "%12.6e\n", data[i]);
+    Vio_connectFree(sock);
+    Vio_dtor(&sock);
+
+    return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vwriter_write
+//
+// Purpose:  Write one grid in the requested format
+//
+// Notes:    Runs on the writer threads, in the apbs_vmem critical
+//           section, so it must not allocate through the caller's Vmem.
+//           The Vgrid writers take their scratch space from grid->mem,
+//           which belongs to the job (see Vwriter_submit).
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int Vwriter_write(Vdata_Format format, const char *fname,
+  const char *title, Vgrid *grid, int ndata, double *data, double *pvec,
+  double tol) {
+
+    switch (format) {
+        case VDF_DX:
+            Vgrid_writeDX(grid, "FILE", "ASC", VNULL, fname, (char *)title,
+              pvec);
+            return Vwriter_exists(fname);
+        case VDF_DXBIN:
+            Vgrid_writeDXBIN(grid, "FILE", "ASC", VNULL, fname,
+              (char *)title, pvec);
+            return Vwriter_exists(fname);
+        case VDF_UHBD:
+            Vgrid_writeUHBD(grid, "FILE", "ASC", VNULL, fname,
+              (char *)title, pvec);
+            return Vwriter_exists(fname);
+        case VDF_GZ:
+            return Vgrid_writeGZ(grid, "FILE", "ASC", VNULL, fname,
+              (char *)title, pvec);
+        case VDF_RAW:
+            return Vgrid_writeRaw(grid, fname, VGRID_RAW_FLOAT64, pvec);
+        case VDF_LOSSY:
+            return Vgrid_writeLossy(grid, fname, tol, pvec);
+        case VDF_FLAT:
+            return Vwriter_writeFlat(fname, title, ndata, data);
+        default:
+            Vnm_print(2, "Vwriter_write:  Bogus data format (%d)!\n", format);
+            return 0;
+    }
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vwriter_reclaim
+//
+// Purpose:  Free finished jobs; must be called with the lock held, where
+//           the caller may use Vmem (see Vwriter_open)
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void Vwriter_reclaim(Vwriter *thee) {
+
+    VwriterJob *job;
+
+    while (thee->done != VNULL) {
+        job = thee->done;
+        thee->done = job->next;
+        thee->inflight -= job->bytes;
+        if (job->grid != VNULL) Vgrid_dtor(&(job->grid));
+        Vmem_free(VNULL, job->ndata, sizeof(double), (void **)&(job->data));
+        if (job->pvec != VNULL) {
+            Vmem_free(VNULL, job->npvec, sizeof(double),
+              (void **)&(job->pvec));
+        }
+        Vmem_free(VNULL, 1, sizeof(VwriterJob), (void **)&job);
+    }
+}
+
+#if defined(HAVE_PTHREAD) && defined(_OPENMP)
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vwriter_thread
+//
+// Purpose:  Writer thread main loop; jobs are taken only while the writer
+//           is open and written in the apbs_vmem critical section
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void *Vwriter_thread(void *arg) {
+
+    Vwriter *thee = (Vwriter *)arg;
+    VwriterJob *job;
+    int ok;
+
+    pthread_mutex_lock(&(thee->lock));
+    while (1) {
+        while (((thee->head == VNULL) || (thee->nopen == 0)) &&
+          !thee->shutdown) {
+            pthread_cond_wait(&(thee->work), &(thee->lock));
+        }
+        if (thee->head == VNULL) break;
+        job = thee->head;
+        thee->head = job->next;
+        if (thee->head == VNULL) thee->tail = VNULL;
+        (thee->nbusy)++;
+        pthread_mutex_unlock(&(thee->lock));
+
+#pragma omp critical (apbs_vmem)
+        ok = Vwriter_write(job->format, job->fname, job->title, job->grid,
+          job->ndata, job->data, job->pvec, job->tol);
+        if (!ok) {
+            Vnm_print(2, "Vwriter:  Error writing %s!\n", job->fname);
+        }
+
+        pthread_mutex_lock(&(thee->lock));
+        job->status = ok ? 1 : -1;
+        if (!ok) (thee->nerror)++;
+        (thee->npending)--;
+        (thee->nbusy)--;
+        job->next = thee->done;
+        thee->done = job;
+        pthread_cond_broadcast(&(thee->idle));
+    }
+    pthread_mutex_unlock(&(thee->lock));
+
+    return VNULL;
+}
+#endif
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vwriter_ctor
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC Vwriter* Vwriter_ctor(int nthreads, size_t maxbytes) {
+
+    Vwriter *thee = VNULL;
+
+    thee = (Vwriter *)Vmem_malloc(VNULL, 1, sizeof(Vwriter));
+    VASSERT(thee != VNULL);
+    VASSERT(Vwriter_ctor2(thee, nthreads, maxbytes));
+
+    return thee;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vwriter_ctor2
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vwriter_ctor2(Vwriter *thee, int nthreads, size_t maxbytes) {
+
+#if defined(HAVE_PTHREAD) && defined(_OPENMP)
+    int i;
+#endif
+
+    if (thee == VNULL) return 0;
+
+    thee->nthreads = 0;
+    thee->maxbytes = maxbytes;
+    thee->inflight = 0;
+    thee->npending = 0;
+    thee->nbusy = 0;
+    thee->nopen = 0;
+    thee->nerror = 0;
+    thee->shutdown = 0;
+    thee->head = VNULL;
+    thee->tail = VNULL;
+    thee->done = VNULL;
+
+#if defined(HAVE_PTHREAD)
+    pthread_mutex_init(&(thee->lock), VNULL);
+    pthread_cond_init(&(thee->work), VNULL);
+    pthread_cond_init(&(thee->idle), VNULL);
+#endif
+
+#if defined(HAVE_PTHREAD) && defined(_OPENMP)
+    if (maxbytes == 0) return 1;
+    if (nthreads > VWRITER_MAXTHREADS) nthreads = VWRITER_MAXTHREADS;
+    for (i=0; i<nthreads; i++) {
+        if (pthread_create(&(thee->threads[i]), VNULL, Vwriter_thread,
+          (void *)thee) != 0) {
+            Vnm_print(2, "Vwriter_ctor2:  Could only start %d of %d writer \
+threads.\n", i, nthreads);
+            break;
+        }
+        (thee->nthreads)++;
+    }
+#else
+    if (nthreads > 0) {
+        Vnm_print(0, "Vwriter_ctor2:  No thread or OpenMP support; writes \
+will be synchronous.\n");
+    }
+#endif
+
+    return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vwriter_submit
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vwriter_submit(Vwriter *thee, Vdata_Format format,
+  const char *fname, const char *title, int nx, int ny, int nz,
+  double hx, double hy, double hzed, double xmin, double ymin, double zmin,
+  int ndata, double *data, double *pvec, double tol) {
+
+    VwriterJob *job;
+    Vgrid *grid = VNULL;
+    size_t bytes;
+    int ok, npvec, sync;
+
+    if ((format == VDF_AVS) || (format == VDF_MCSF)) {
+        Vnm_print(2, "Vwriter_submit:  Format %d carries no grid data!\n",
+          format);
+        return 0;
+    }
+    npvec = (pvec == VNULL) ? 0 : nx*ny*nz;
+
+    /* Clear the target so an old file cannot pass for this write */
+    if (Vwriter_unchecked(format) && (remove(fname) != 0) &&
+      (errno != ENOENT)) {
+        Vnm_print(2, "Vwriter_submit:  Can't replace %s!\n", fname);
+        if (thee != VNULL) {
+            pthread_mutex_lock(&(thee->lock));
+            (thee->nerror)++;
+            pthread_mutex_unlock(&(thee->lock));
+        }
+        return 0;
+    }
+
+    /* Reserve room under the memory cap.  Waiting for it could deadlock,
+     * as the threads need the apbs_vmem critical section the caller may
+     * hold, so a job that doesn't fit while others are queued is written
+     * synchronously instead. */
+    bytes = ((size_t)ndata + (size_t)npvec)*sizeof(double);
+    sync = ((thee == VNULL) || (thee->nthreads == 0));
+    if (!sync) {
+        pthread_mutex_lock(&(thee->lock));
+        Vwriter_reclaim(thee);
+        sync = ((thee->inflight > 0) &&
+          (thee->inflight + bytes > thee->maxbytes));
+        if (!sync) thee->inflight += bytes;
+        pthread_mutex_unlock(&(thee->lock));
+    }
+
+    /* Synchronous write straight from the caller's arrays */
+    if (sync) {
+        if (format != VDF_FLAT) {
+            grid = Vgrid_ctor(nx, ny, nz, hx, hy, hzed, xmin, ymin, zmin,
+              data);
+        }
+        ok = Vwriter_write(format, fname, title, grid, ndata, data, pvec,
+          tol);
+        if (grid != VNULL) Vgrid_dtor(&grid);
+        if (!ok) {
+            Vnm_print(2, "Vwriter:  Error writing %s!\n", fname);
+            if (thee != VNULL) {
+                pthread_mutex_lock(&(thee->lock));
+                (thee->nerror)++;
+                pthread_mutex_unlock(&(thee->lock));
+            }
+        }
+        return ok;
+    }
+
+    /* Snapshot the arrays into the job */
+    job = (VwriterJob *)Vmem_malloc(VNULL, 1, sizeof(VwriterJob));
+    VASSERT(job != VNULL);
+    job->format = format;
+    strncpy(job->fname, fname, VMAX_ARGLEN-1);
+    job->fname[VMAX_ARGLEN-1] = '\0';
+    strncpy(job->title, title, 71);
+    job->title[71] = '\0';
+    job->ndata = ndata;
+    job->npvec = npvec;
+    job->tol = tol;
+    job->bytes = bytes;
+    job->status = 0;
+    job->next = VNULL;
+    job->data = (double *)Vmem_malloc(VNULL, ndata, sizeof(double));
+    VASSERT(job->data != VNULL);
+    memcpy(job->data, data, ndata*sizeof(double));
+    job->pvec = VNULL;
+    if (npvec > 0) {
+        job->pvec = (double *)Vmem_malloc(VNULL, npvec, sizeof(double));
+        VASSERT(job->pvec != VNULL);
+        memcpy(job->pvec, pvec, npvec*sizeof(double));
+    }
+    /* The grid, and with it the Vmem its writer allocates from, is built
+     * here on the submitting thread and owned by this job alone */
+    job->grid = VNULL;
+    if (format != VDF_FLAT) {
+        job->grid = Vgrid_ctor(nx, ny, nz, hx, hy, hzed, xmin, ymin, zmin,
+          job->data);
+    }
+
+    /* Hand it to the pool */
+    pthread_mutex_lock(&(thee->lock));
+    if (thee->tail == VNULL) thee->head = job;
+    else thee->tail->next = job;
+    thee->tail = job;
+    (thee->npending)++;
+#if defined(HAVE_PTHREAD)
+    pthread_cond_signal(&(thee->work));
+#endif
+    pthread_mutex_unlock(&(thee->lock));
+
+    return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vwriter_open
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC void Vwriter_open(Vwriter *thee) {
+
+    if (thee == VNULL) return;
+
+    pthread_mutex_lock(&(thee->lock));
+    (thee->nopen)++;
+#if defined(HAVE_PTHREAD)
+    pthread_cond_broadcast(&(thee->work));
+#endif
+    pthread_mutex_unlock(&(thee->lock));
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vwriter_close
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC void Vwriter_close(Vwriter *thee) {
+
+    if (thee == VNULL) return;
+
+    pthread_mutex_lock(&(thee->lock));
+    (thee->nopen)--;
+#if defined(HAVE_PTHREAD)
+    while ((thee->nopen == 0) && (thee->nbusy > 0)) {
+        pthread_cond_wait(&(thee->idle), &(thee->lock));
+    }
+#endif
+    pthread_mutex_unlock(&(thee->lock));
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vwriter_flush
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC int Vwriter_flush(Vwriter *thee) {
+
+    int nerror;
+
+    if (thee == VNULL) return 0;
+
+    pthread_mutex_lock(&(thee->lock));
+#if defined(HAVE_PTHREAD)
+    (thee->nopen)++;
+    pthread_cond_broadcast(&(thee->work));
+    while (thee->npending > 0) {
+        pthread_cond_wait(&(thee->idle), &(thee->lock));
+    }
+    (thee->nopen)--;
+#endif
+    Vwriter_reclaim(thee);
+    nerror = thee->nerror;
+    pthread_mutex_unlock(&(thee->lock));
+
+    return nerror;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vwriter_dtor
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC void Vwriter_dtor(Vwriter **thee) {
+
+    if ((*thee) != VNULL) {
+        Vwriter_dtor2(*thee);
+        Vmem_free(VNULL, 1, sizeof(Vwriter), (void **)thee);
+        (*thee) = VNULL;
+    }
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  Vwriter_dtor2
+/////////////////////////////////////////////////////////////////////////// */
+VPUBLIC void Vwriter_dtor2(Vwriter *thee) {
+
+#if defined(HAVE_PTHREAD)
+    int i;
+#endif
+
+    Vwriter_flush(thee);
+
+#if defined(HAVE_PTHREAD)
+    pthread_mutex_lock(&(thee->lock));
+    thee->shutdown = 1;
+    pthread_cond_broadcast(&(thee->work));
+    pthread_mutex_unlock(&(thee->lock));
+    for (i=0; i<thee->nthreads; i++) pthread_join(thee->threads[i], VNULL);
+    thee->nthreads = 0;
+    pthread_cond_destroy(&(thee->idle));
+    pthread_cond_destroy(&(thee->work));
+    pthread_mutex_destroy(&(thee->lock));
+#endif
+}
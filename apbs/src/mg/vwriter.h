@@ -0,0 +1,242 @@
+/** @defgroup Vwriter Vwriter class
+ *  @brief  Background writer for grid data files
+ */
+
+/**
+ *  @file    vwriter.h
+ *  @ingroup Vwriter
+ *  @brief   Background writer for grid data files
+ *  @version $Id$
+ *
+ *  @attention
+ *  @verbatim
+ *
+ * APBS -- Adaptive Poisson-Boltzmann Solver
+ *
+ *  Nathan A. Baker (nathan.baker@pnnl.gov)
+ *  Pacific Northwest National Laboratory
+ *
+ *  Additional contributing authors listed in the code documentation.
+ *
+ * Copyright (c) 2010-2020 Battelle Memorial Institute. Developed at the
+ * Pacific Northwest National Laboratory, operated by Battelle Memorial
+ * Institute, Pacific Northwest Division for the U.S. Department of Energy.
+ *
+ * Portions Copyright (c) 2002-2010, Washington University in St. Louis.
+ * Portions Copyright (c) 2002-2010, Nathan A. Baker.
+ * Portions Copyright (c) 1999-2002, The Regents of the University of
+ * California.
+ * Portions Copyright (c) 1995, Michael Holst.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Neither the name of the developer nor the names of its contributors may be
+ * used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @endverbatim
+ */
+
+#ifndef _VWRITER_H_
+#define _VWRITER_H_
+
+#include "apbscfg.h"
+
+#include "maloc/maloc.h"
+
+#include "generic/vhal.h"
+#include "mg/vgrid.h"
+
+#if defined(HAVE_PTHREAD)
+#   include <pthread.h>
+#endif
+
+/** @brief   Default number of background writer threads
+ *  @ingroup Vwriter */
+#define VWRITER_NTHREADS 2
+
+/** @brief   Largest number of background writer threads
+ *  @ingroup Vwriter */
+#define VWRITER_MAXTHREADS 32
+
+/** @brief   Default cap on snapshot memory held by queued writes (MB)
+ *  @ingroup Vwriter */
+#define VWRITER_MAXMB 1024
+
+/**
+ *  @ingroup Vwriter
+ *  @brief   One queued grid write
+ *  @details The job owns copies of the data and partition arrays, so the
+ *           caller may reuse its own arrays as soon as Vwriter_submit
+ *           returns.
+ */
+struct sVwriterJob {
+
+    Vdata_Format format;  /**< Output format */
+    char fname[VMAX_ARGLEN];  /**< Output path */
+    char title[72];  /**< Title for the file comments */
+    Vgrid *grid;  /**< Grid wrapped around data */
+    double *data;  /**< Owned copy of the values */
+    double *pvec;  /**< Owned copy of the partition mask, or VNULL */
+    int ndata;  /**< Length of data */
+    int npvec;  /**< Length of pvec */
+    double tol;  /**< Error bound for VDF_LOSSY */
+    size_t bytes;  /**< Snapshot memory held by this job */
+    int status;  /**< 0 while pending, 1 when written, -1 on failure */
+    struct sVwriterJob *next;  /**< Next job in the queue */
+};
+
+/**
+ *  @ingroup Vwriter
+ *  @brief   Declaration of the VwriterJob class as the sVwriterJob structure
+ */
+typedef struct sVwriterJob VwriterJob;
+
+/**
+ *  @ingroup Vwriter
+ *  @brief   Bounded pool of threads that write grid files in the background
+ *  @details Vwriter_submit snapshots a filled data array and returns; the
+ *           pool formats and writes it while the caller moves on.  The
+ *           Vgrid writers allocate through Vmem, whose bookkeeping isn't
+ *           thread-safe, so the threads write in the apbs_vmem critical
+ *           section and only between Vwriter_open and Vwriter_close, while
+ *           every other Vmem call is in that section too.  The snapshots
+ *           held at any time are capped at maxbytes; a write that doesn't
+ *           fit is done synchronously inside Vwriter_submit, as are all
+ *           writes without pthreads or OpenMP, or with no threads or no
+ *           memory budget.
+ */
+struct sVwriter {
+
+    int nthreads;  /**< Number of writer threads (0 = synchronous) */
+    size_t maxbytes;  /**< Cap on snapshot memory held by queued jobs */
+    size_t inflight;  /**< Snapshot memory currently held */
+    int npending;  /**< Jobs queued or being written */
+    int nbusy;  /**< Jobs being written */
+    int nopen;  /**< Number of Vwriter_open calls not yet closed */
+    int nerror;  /**< Number of writes that have failed */
+    int shutdown;  /**< Set to stop the threads */
+    VwriterJob *head;  /**< First job waiting to be written */
+    VwriterJob *tail;  /**< Last job waiting to be written */
+    VwriterJob *done;  /**< Finished jobs waiting to be freed */
+#if defined(HAVE_PTHREAD)
+    pthread_t threads[VWRITER_MAXTHREADS];  /**< Writer threads */
+    pthread_mutex_t lock;  /**< Guards the queues and counters */
+    pthread_cond_t work;  /**< Signalled when a job is queued */
+    pthread_cond_t idle;  /**< Signalled when a job finishes */
+#endif
+};
+
+/**
+ *  @ingroup Vwriter
+ *  @brief   Declaration of the Vwriter class as the Vwriter structure
+ */
+typedef struct sVwriter Vwriter;
+
+/** @brief   Construct the writer and start its threads
+ *  @ingroup Vwriter
+ *  @param   nthreads  Number of writer threads (at most VWRITER_MAXTHREADS);
+ *                     0 writes synchronously
+ *  @param   maxbytes  Cap on snapshot memory held by queued writes; 0
+ *                     writes synchronously
+ *  @returns Newly allocated Vwriter object
+ */
+VEXTERNC Vwriter* Vwriter_ctor(int nthreads, size_t maxbytes);
+
+/** @brief   FORTRAN stub to construct the writer and start its threads
+ *  @ingroup Vwriter
+ *  @param   thee      Pointer to memory allocated for the Vwriter object
+ *  @param   nthreads  Number of writer threads; 0 writes synchronously
+ *  @param   maxbytes  Cap on snapshot memory held by queued writes
+ *  @returns 1 if successful, 0 otherwise
+ */
+VEXTERNC int Vwriter_ctor2(Vwriter *thee, int nthreads, size_t maxbytes);
+
+/** @brief   Queue a grid for writing
+ *  @details data and pvec are copied before this returns unless the write
+ *           happens synchronously.  Formats that carry no grid data
+ *           (VDF_AVS, VDF_MCSF) are rejected.  Never waits for the
+ *           threads, so it may be called in the apbs_vmem critical section.
+ *  @ingroup Vwriter
+ *  @param   thee    Vwriter object (VNULL writes synchronously)
+ *  @param   format  Output format
+ *  @param   fname   Output path
+ *  @param   title   Title for the file comments
+ *  @param   nx      Number of x grid points
+ *  @param   ny      Number of y grid points
+ *  @param   nz      Number of z grid points
+ *  @param   hx      Grid spacing in x direction
+ *  @param   hy      Grid spacing in y direction
+ *  @param   hzed    Grid spacing in z direction
+ *  @param   xmin    x coordinate of lower grid corner
+ *  @param   ymin    y coordinate of lower grid corner
+ *  @param   zmin    z coordinate of lower grid corner
+ *  @param   ndata   Number of values to write: nx*ny*nz, or the number of
+ *                   atoms for VDF_FLAT
+ *  @param   data    Values to write
+ *  @param   pvec    Partition mask (nx*ny*nz), or VNULL
+ *  @param   tol     Error bound for VDF_LOSSY
+ *  @returns 1 if the write was queued or succeeded, 0 otherwise
+ */
+VEXTERNC int Vwriter_submit(Vwriter *thee, Vdata_Format format,
+  const char *fname, const char *title, int nx, int ny, int nz,
+  double hx, double hy, double hzed, double xmin, double ymin, double zmin,
+  int ndata, double *data, double *pvec, double tol);
+
+/** @brief   Let the threads write until the matching Vwriter_close
+ *  @ingroup Vwriter
+ *  @note    Until then every Vmem call of the calling program must be in
+ *           the apbs_vmem critical section.  Calls nest.
+ *  @param   thee  Vwriter object (may be VNULL)
+ */
+VEXTERNC void Vwriter_open(Vwriter *thee);
+
+/** @brief   Close a Vwriter_open window; the last one waits for the writes
+ *           in progress
+ *  @ingroup Vwriter
+ *  @note    Must not be called in the apbs_vmem critical section.
+ *  @param   thee  Vwriter object (may be VNULL)
+ */
+VEXTERNC void Vwriter_close(Vwriter *thee);
+
+/** @brief   Wait until every queued write has finished
+ *  @ingroup Vwriter
+ *  @param   thee  Vwriter object
+ *  @returns Number of writes that have failed since construction
+ */
+VEXTERNC int Vwriter_flush(Vwriter *thee);
+
+/** @brief   Flush, stop the threads and destroy the object
+ *  @ingroup Vwriter
+ *  @param   thee  Pointer to memory location of object
+ */
+VEXTERNC void Vwriter_dtor(Vwriter **thee);
+
+/** @brief   FORTRAN stub to flush and stop the threads
+ *  @ingroup Vwriter
+ *  @param   thee  Vwriter object
+ */
+VEXTERNC void Vwriter_dtor2(Vwriter *thee);
+
+#endif
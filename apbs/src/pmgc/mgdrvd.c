@@ -205,6 +205,7 @@ VPUBLIC void Vmgdriv2(int *iparm, double *rparm,
     int iok       = 0;
     int iinfo     = 0;
     int istop     = 0;
+    int istrt     = 0;
     int ipkey     = 0;
     int nu1       = 0;
     int nu2       = 0;
@@ -272,6 +273,7 @@ VPUBLIC void Vmgdriv2(int *iparm, double *rparm,
     mgkey  = VAT(iparm,  9);
     itmax  = VAT(iparm, 10);
     istop  = VAT(iparm, 11);
+    istrt  = VAT(iparm, 23);
     iinfo  = VAT(iparm, 12);
     ipkey  = VAT(iparm, 14);
     mode   = VAT(iparm, 16);
@@ -458,7 +460,8 @@ VPUBLIC void Vmgdriv2(int *iparm, double *rparm,
         // Next grid
     }
 
-    // Reinitialize the solution function
+    // Reinitialize the solution function unless it is the initial guess
+    if (istrt == 0)
         Vazeros(nx, ny, nz, u);
 
     /*******************************************************************
@@ -198,6 +198,7 @@ VPUBLIC void Vnewdriv2(int *iparm, double *rparm,
     int mgdisc;     /// @todo:  Doc
     int mgsmoo;     /// @todo:  Doc
     int mode;       /// @todo:  Doc
+    int istrt;      /// Start from u (1) or from zero (0)
     double epsiln;  /// @todo:  Doc
     double epsmac;  /// @todo:  Doc
     double errtol;  /// @todo:  Doc
@@ -238,6 +239,7 @@ VPUBLIC void Vnewdriv2(int *iparm, double *rparm,
     mgdisc = VAT(iparm, 19);
     mgsmoo = VAT(iparm, 20);
     mgsolv = VAT(iparm, 21);
+    istrt  = VAT(iparm, 23);
 
     errtol = VAT(rparm,  1);
     omegal = VAT(rparm,  9);
@@ -304,6 +306,10 @@ VPUBLIC void Vnewdriv2(int *iparm, double *rparm,
     // Determine machine epsilon
     epsiln = Vnm_epsmac();
 
+    // Reinitialize the solution function unless it is the initial guess
+    if (istrt == 0)
+        Vazeros(nx, ny, nz, u);
+
     // Impose zero dirichlet boundary conditions (now in source fcn)
     VfboundPMG00(nx, ny, nz, u);
 
@@ -344,6 +350,9 @@ VPUBLIC void Vnewdriv2(int *iparm, double *rparm,
     // Stop the timer
     Vnm_tstop(30, "Vnewdrv2: solve");
 
+    if (iinfo > 0)
+        Vnm_print(0, "Vnewdrv2:  %d Newton iterations\n", iters);
+
     // Restore boundary conditions
     ibound = 1;
     VfboundPMG(&ibound, nx, ny, nz, u, gxcf, gycf, gzcf);
@@ -53,10 +53,256 @@
 
 #include "routines.h"
 
+#if defined(HAVE_FORK) && defined(HAVE_SYS_UN_H)
+#  define APBS_SERVER
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/time.h>
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#  include <sys/wait.h>
+#  include <dirent.h>
+#  include <errno.h>
+#  include <fcntl.h>
+#  include <limits.h>
+#  include <poll.h>
+#  include <signal.h>
+#  include <unistd.h>
+#  include <utime.h>
+#endif
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
 VEMBED(rcsid="$Id$")
 
 VPUBLIC void startVio() { Vio_start(); }
 
+/* Molecules kept between inputs as binary snapshots; see setInputCache */
+VPRIVATE int cacheMax = 0;
+VPRIVATE char cacheScratch[VMAX_ARGLEN] = "";
+VPRIVATE char cacheDir[VMAX_ARGLEN] = "";
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  inputKey
+//
+// Purpose:  Build the cache key of an input file: its type, real path,
+//           inode, size and modification time, followed by the key of the
+//           parameter file it is read with (if any).  Returns VNULL if the
+//           cache is off or the file can't (or shouldn't) be cached.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE char* inputKey(char type, int fmt, const char *path,
+  const char *extra) {
+
+#ifdef APBS_SERVER
+    char real[PATH_MAX];
+    struct stat st;
+    char *key;
+    size_t len;
+    int n;
+
+    if (cacheMax <= 0) return VNULL;
+    if (realpath(path, real) == VNULL) return VNULL;
+    len = strlen(cacheScratch);
+    if ((len > 0) && (strncmp(real, cacheScratch, len) == 0) &&
+      (real[len] == '/')) return VNULL;
+    if (stat(real, &st) != 0) return VNULL;
+
+    if (extra == VNULL) extra = "";
+    n = snprintf(VNULL, 0, "%c%d:%lu:%lu:%ld:%ld:%s|%s", type, fmt,
+      (unsigned long)st.st_dev, (unsigned long)st.st_ino, (long)st.st_size,
+      (long)st.st_mtime, real, extra);
+    key = (char *)Vmem_malloc(VNULL, n+1, sizeof(char));
+    snprintf(key, n+1, "%c%d:%lu:%lu:%ld:%ld:%s|%s", type, fmt,
+      (unsigned long)st.st_dev, (unsigned long)st.st_ino, (long)st.st_size,
+      (long)st.st_mtime, real, extra);
+    return key;
+#else
+    return VNULL;
+#endif
+
+}
+
+VPRIVATE void freeKey(char **key) {
+    if (*key != VNULL) Vmem_free(VNULL, strlen(*key)+1, sizeof(char),
+      (void **)key);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  cachePath
+//
+// Purpose:  Name a snapshot file of a cache key: the 64-bit FNV-1a hash of
+//           the key with the extension "key" (the key itself, to rule out
+//           hash collisions) or "bin" (the molecule).  Returns 1 on
+//           success.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int cachePath(const char *key, const char *ext, char *path) {
+
+    unsigned long long hash = 14695981039346656037ULL;
+    const char *c;
+    int n;
+
+    for (c=key; *c != '\0'; c++) {
+        hash ^= (unsigned char)(*c);
+        hash *= 1099511628211ULL;
+    }
+    n = snprintf(path, VMAX_ARGLEN, "%s/%016llx.%s", cacheDir, hash, ext);
+    return ((n > 0) && (n < VMAX_ARGLEN));
+
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  trimInputCache
+//
+// Purpose:  Remove the least recently used snapshots until at most the
+//           number given to setInputCache are left.  A request that has
+//           already mapped a removed snapshot keeps its copy.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void trimInputCache() {
+
+#ifdef APBS_SERVER
+    char path[VMAX_ARGLEN], old[VMAX_ARGLEN];
+    struct dirent *ent;
+    struct stat st;
+    time_t oldest;
+    size_t len;
+    DIR *d;
+    int num, n;
+
+    while (1) {
+        d = opendir(cacheDir);
+        if (d == VNULL) return;
+        num = 0;
+        oldest = 0;
+        old[0] = '\0';
+        while ((ent = readdir(d)) != VNULL) {
+            len = strlen(ent->d_name);
+            if ((len < 5) || (strcmp(ent->d_name+len-4, ".bin") != 0))
+                continue;
+            n = snprintf(path, VMAX_ARGLEN, "%s/%s", cacheDir, ent->d_name);
+            if ((n <= 0) || (n >= VMAX_ARGLEN) || (stat(path, &st) != 0))
+                continue;
+            num++;
+            if ((old[0] == '\0') || (st.st_mtime < oldest)) {
+                oldest = st.st_mtime;
+                strcpy(old, path);
+            }
+        }
+        closedir(d);
+        if (num <= cacheMax) return;
+        if (unlink(old) != 0) return;
+        len = strlen(old);
+        strcpy(old+len-3, "key");
+        unlink(old);
+    }
+#endif
+
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  cachedMolecule
+//
+// Purpose:  Map the snapshot of a molecule file.  Returns VNULL if there
+//           is none.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE Valist* cachedMolecule(const char *key) {
+
+#ifdef APBS_SERVER
+    Valist *alist;
+    char path[VMAX_ARGLEN], *text;
+    size_t len;
+    ssize_t n;
+    int fd, same;
+
+    if (!cachePath(key, "key", path)) return VNULL;
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return VNULL;
+    len = strlen(key);
+    text = (char *)Vmem_malloc(VNULL, len+1, sizeof(char));
+    n = read(fd, text, len+1);
+    close(fd);
+    same = ((n == (ssize_t)len) && (memcmp(text, key, len) == 0));
+    Vmem_free(VNULL, len+1, sizeof(char), (void **)&text);
+    if (!same || !cachePath(key, "bin", path)) return VNULL;
+    if (access(path, R_OK) != 0) return VNULL;
+    alist = Valist_ctor();
+    if (Valist_readBinary(alist, path) != VRC_SUCCESS) {
+        Valist_dtor(&alist);
+        return VNULL;
+    }
+
+    /* Mark it as recently used */
+    utime(path, VNULL);
+    return alist;
+#else
+    return VNULL;
+#endif
+
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  cacheMolecule
+//
+// Purpose:  Save the snapshot of a molecule that was just read.  Both
+//           files are written under temporary names and renamed into
+//           place, so requests running at the same time only ever see
+//           complete snapshots.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void cacheMolecule(const char *key, Valist *alist) {
+
+#ifdef APBS_SERVER
+    char path[VMAX_ARGLEN], tmp[VMAX_ARGLEN];
+    int fd, ok, n;
+
+    if (!cachePath(key, "key", path)) return;
+    n = snprintf(tmp, VMAX_ARGLEN, "%s.%ld", path, (long)getpid());
+    if ((n <= 0) || (n >= VMAX_ARGLEN)) return;
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) return;
+    ok = (write(fd, key, strlen(key)) == (ssize_t)strlen(key));
+    if (close(fd) != 0) ok = 0;
+    if (!ok || (rename(tmp, path) != 0)) {
+        unlink(tmp);
+        return;
+    }
+
+    if (!cachePath(key, "bin", path)) return;
+    n = snprintf(tmp, VMAX_ARGLEN, "%s.%ld", path, (long)getpid());
+    if ((n <= 0) || (n >= VMAX_ARGLEN)) return;
+    if ((Valist_writeBinary(alist, tmp) != VRC_SUCCESS) ||
+      (rename(tmp, path) != 0)) {
+        unlink(tmp);
+        return;
+    }
+    trimInputCache();
+#endif
+
+}
+
+VPUBLIC void setInputCache(int nmax, const char *scratch) {
+
+    cacheMax = VMAX2(nmax, 0);
+    cacheScratch[0] = '\0';
+    cacheDir[0] = '\0';
+#ifdef APBS_SERVER
+    if ((cacheMax > 0) && (scratch != VNULL)) {
+        if (realpath(scratch, cacheScratch) == VNULL) {
+            strncpy(cacheScratch, scratch, VMAX_ARGLEN-1);
+            cacheScratch[VMAX_ARGLEN-1] = '\0';
+        }
+        snprintf(cacheDir, VMAX_ARGLEN, "%s/cache", cacheScratch);
+        if ((mkdir(cacheDir, 0700) != 0) && (errno != EEXIST)) {
+            Vnm_tprint(2, "Can't create the molecule cache %s; caching is \
+off!\n", cacheDir);
+            cacheMax = 0;
+        }
+    }
+#else
+    cacheMax = 0;
+#endif
+
+}
+
 VPUBLIC Vparam* loadParameter(NOsh *nosh) {
 
     Vparam *param = VNULL;
@@ -96,9 +342,12 @@ VPUBLIC int loadMolecules(NOsh *nosh, Vparam *param, Valist *alist[NOSH_MAXMOL])
 
     int i;
     int use_params = 0;
+    int use_cache = 0;
+    int status = 1;
     Vrc_Codes rc;
-
-    Vio *sock = VNULL;
+    int cached;
+    char *parmkey = VNULL,
+         *molkey = VNULL;
 
     Vnm_tprint( 1, "Got paths for %d molecules\n", nosh->nmol);
     if (nosh->nmol <= 0) {
@@ -115,107 +364,97 @@ VPUBLIC int loadMolecules(NOsh *nosh, Vparam *param, Valist *alist[NOSH_MAXMOL])
         use_params = 1;
     }
 
+    /* Check the formats first... */
     for (i=0; i<nosh->nmol; i++) {
-        if(alist[i] == VNULL){
-            alist[i] = Valist_ctor();
-        }else{
-            alist[i] = VNULL;
-            alist[i] = Valist_ctor();
-        }
-
         switch (nosh->molfmt[i]) {
             case NMF_PQR:
-                    /* Print out a warning to the user letting them know that we are overriding PQR
-                    values for charge, radius and epsilon */
-                    if (use_params) {
-                        Vnm_print(2, "\nWARNING!!  Radius/charge information from PQR file %s\n", nosh->molpath[i]);
-                        Vnm_print(2, "will be replaced with data from parameter file (%s)!\n", nosh->parmpath);
-                    }
-                    Vnm_tprint( 1, "Reading PQR-format atom data from %s.\n",
-                            nosh->molpath[i]);
-                    sock = Vio_ctor("FILE", "ASC", VNULL, nosh->molpath[i], "r");
-                    if (sock == VNULL) {
-                        Vnm_print(2, "Problem opening virtual socket %s!\n",
-                              nosh->molpath[i]);
-                        return 0;
-                    }
-                    if (Vio_accept(sock, 0) < 0) {
-                        Vnm_print(2, "Problem accepting virtual socket %s!\n",
-                                  nosh->molpath[i]);
-                        return 0;
-                    }
-                    if(use_params){
-                        rc = Valist_readPQR(alist[i], param, sock);
-                    }else{
-                        rc = Valist_readPQR(alist[i], VNULL, sock);
-                    }
-                    if(rc == 0) return 0;
-
-                    Vio_acceptFree(sock);
-                    Vio_dtor(&sock);
-                    break;
-            case NMF_PDB:
-                    /* Load parameters */
-                    if (!nosh->gotparm) {
-                        Vnm_tprint(2, "NOsh:  Error!  Can't read PDB without specifying PARM file!\n");
-                        return 0;
-                    }
-                    Vnm_tprint( 1, "Reading PDB-format atom data from %s.\n",
-                            nosh->molpath[i]);
-                    sock = Vio_ctor("FILE", "ASC", VNULL, nosh->molpath[i], "r");
-                    if (sock == VNULL) {
-                        Vnm_print(2, "Problem opening virtual socket %s!\n",
-                              nosh->molpath[i]);
-                        return 0;
-                    }
-                    if (Vio_accept(sock, 0) < 0) {
-                        Vnm_print(2, "Problem accepting virtual socket %s!\n", nosh->molpath[i]);
-                        return 0;
-                    }
-                    rc = Valist_readPDB(alist[i], param, sock);
-                    /* If we are looking for an atom/residue that does not exist
-                     * then abort and return 0 */
-                    if(rc == 0)
-                        return 0;
-
-                    Vio_acceptFree(sock);
-                    Vio_dtor(&sock);
-                    break;
             case NMF_XML:
-                Vnm_tprint( 1, "Reading XML-format atom data from %s.\n",
-                            nosh->molpath[i]);
-                sock = Vio_ctor("FILE", "ASC", VNULL, nosh->molpath[i], "r");
-                if (sock == VNULL) {
-                    Vnm_print(2, "Problem opening virtual socket %s!\n",
-                              nosh->molpath[i]);
+            case NMF_BIN:
+                break;
+            case NMF_PDB:
+                /* Load parameters */
+                if (!nosh->gotparm) {
+                    Vnm_tprint(2, "NOsh:  Error!  Can't read PDB without specifying PARM file!\n");
                     return 0;
                 }
-                    if (Vio_accept(sock, 0) < 0) {
-                        Vnm_print(2, "Problem accepting virtual socket %s!\n",
-                                  nosh->molpath[i]);
-                        return 0;
-                    }
-                    if(use_params){
-                        rc = Valist_readXML(alist[i], param, sock);
-                    }else{
-                        rc = Valist_readXML(alist[i], VNULL, sock);
-                    }
-                    if(rc == 0)
-                        return 0;
-
-                Vio_acceptFree(sock);
-                Vio_dtor(&sock);
                 break;
             default:
                 Vnm_tprint(2, "NOsh:  Error!  Undefined molecule file type \
 (%d)!\n", nosh->molfmt[i]);
                 return 0;
         } /* switch molfmt */
+    }
 
-        if (rc != 1) {
+    /* ...then read the molecules in input order, so each one's log follows
+     * its "Reading" line; the readers split each file across threads.
+     * Molecules read earlier from the same files with the same parameters
+     * are mapped from their snapshots instead. */
+    if (use_params) {
+        parmkey = inputKey('P', nosh->parmfmt, nosh->parmpath, VNULL);
+        use_cache = (parmkey != VNULL);
+    } else use_cache = (cacheMax > 0);
+    for (i=0; i<nosh->nmol; i++) {
+        rc = VRC_SUCCESS;
+        molkey = VNULL;
+        if (use_cache && (nosh->molfmt[i] != NMF_BIN)) molkey = inputKey('M',
+          nosh->molfmt[i], nosh->molpath[i], parmkey);
+        alist[i] = VNULL;
+        if (molkey != VNULL) alist[i] = cachedMolecule(molkey);
+        cached = (alist[i] != VNULL);
+        if (!cached) alist[i] = Valist_ctor();
+        if (cached) Vnm_tprint( 1, "Using cached atom data from %s.\n",
+          nosh->molpath[i]);
+        else switch (nosh->molfmt[i]) {
+            case NMF_PQR:
+                /* Print out a warning to the user letting them know that we are overriding PQR
+                values for charge, radius and epsilon */
+                if (use_params) {
+                    Vnm_print(2, "\nWARNING!!  Radius/charge information from PQR file %s\n", nosh->molpath[i]);
+                    Vnm_print(2, "will be replaced with data from parameter file (%s)!\n", nosh->parmpath);
+                }
+                Vnm_tprint( 1, "Reading PQR-format atom data from %s.\n",
+                        nosh->molpath[i]);
+                rc = Valist_readPQRFile(alist[i],
+                  use_params ? param : VNULL, nosh->molpath[i]);
+                break;
+            case NMF_PDB:
+                Vnm_tprint( 1, "Reading PDB-format atom data from %s.\n",
+                        nosh->molpath[i]);
+                rc = Valist_readPDBFile(alist[i], param, nosh->molpath[i]);
+                break;
+            case NMF_BIN:
+                /* Binary molecules carry the charges and radii they were
+                written with */
+                if (use_params) {
+                    Vnm_print(2, "\nWARNING!!  Parameter file (%s) is not applied\n", nosh->parmpath);
+                    Vnm_print(2, "to binary molecule file %s!\n", nosh->molpath[i]);
+                }
+                Vnm_tprint( 1, "Mapping binary atom data from %s.\n",
+                        nosh->molpath[i]);
+                rc = Valist_readBinary(alist[i], nosh->molpath[i]);
+                break;
+            default:
+                Vnm_tprint( 1, "Reading XML-format atom data from %s.\n",
+                        nosh->molpath[i]);
+                rc = Valist_readXMLFile(alist[i],
+                  use_params ? param : VNULL, nosh->molpath[i]);
+                break;
+        }
+
+        /* If we are looking for an atom/residue that does not exist
+         * then abort and return 0 */
+        if (rc == VRC_FAILURE) {
+            freeKey(&molkey);
+            status = 0;
+            break;
+        }
+
+        if (rc != VRC_SUCCESS) {
             Vnm_tprint( 2, "Error while reading molecule from %s\n",
                         nosh->molpath[i]);
-            return 0;
+            freeKey(&molkey);
+            status = 0;
+            break;
         }
 
         Vnm_tprint( 1, "  %d atoms\n", Valist_getNumberAtoms(alist[i]));
@@ -224,9 +463,14 @@ VPUBLIC int loadMolecules(NOsh *nosh, Vparam *param, Valist *alist[NOSH_MAXMOL])
                     alist[i]->center[2]);
         Vnm_tprint( 1, "  Net charge %3.2e e\n", alist[i]->charge);
 
+        if ((molkey != VNULL) && !cached) cacheMolecule(molkey, alist[i]);
+        freeKey(&molkey);
+
     }
 
-    return 1;
+    freeKey(&parmkey);
+
+    return status;
 
 }
 
@@ -352,6 +596,38 @@ VPUBLIC int loadDielMaps(NOsh *nosh,Vgrid *dielXMap[NOSH_MAXMOL], Vgrid *dielYMa
                 hy = dielXMap[i]->hy;
                 hzed = dielXMap[i]->hzed;
 
+                // Set minimum lower corner
+                xmin = dielXMap[i]->xmin;
+                ymin = dielXMap[i]->ymin;
+                zmin = dielXMap[i]->zmin;
+                Vnm_tprint(1, "  %d x %d x %d grid\n", nx, ny, nz);
+                Vnm_tprint(1, "  (%g, %g, %g) A spacings\n", hx, hy, hzed);
+                Vnm_tprint(1, "  (%g, %g, %g) A lower corner\n",
+                           xmin, ymin, zmin);
+                sum = 0;
+                for (ii=0; ii<(nx*ny*nz); ii++)
+                    sum += (dielXMap[i]->data[ii]);
+                sum = sum*hx*hy*hzed;
+                Vnm_tprint(1, "  Volume integral = %3.2e A^3\n", sum);
+                break;
+            // Raw binary grid format
+            case VDF_RAW:
+                if (Vgrid_readRaw(dielXMap[i], nosh->dielXpath[i]) != 1) {
+                    Vnm_tprint( 2, "Fatal error while reading from %s\n",
+                               nosh->dielXpath[i]);
+                    return 0;
+                }
+
+                // Set grid sizes
+                nx = dielXMap[i]->nx;
+                ny = dielXMap[i]->ny;
+                nz = dielXMap[i]->nz;
+
+                // Set spacings
+                hx = dielXMap[i]->hx;
+                hy = dielXMap[i]->hy;
+                hzed = dielXMap[i]->hzed;
+
                 // Set minimum lower corner
                 xmin = dielXMap[i]->xmin;
                 ymin = dielXMap[i]->ymin;
@@ -474,6 +750,38 @@ VPUBLIC int loadDielMaps(NOsh *nosh,Vgrid *dielXMap[NOSH_MAXMOL], Vgrid *dielYMa
                 hy = dielYMap[i]->hy;
                 hzed = dielYMap[i]->hzed;
 
+                // Read minimum lower corner
+                xmin = dielYMap[i]->xmin;
+                ymin = dielYMap[i]->ymin;
+                zmin = dielYMap[i]->zmin;
+                Vnm_tprint(1, "  %d x %d x %d grid\n", nx, ny, nz);
+                Vnm_tprint(1, "  (%g, %g, %g) A spacings\n", hx, hy, hzed);
+                Vnm_tprint(1, "  (%g, %g, %g) A lower corner\n",
+                           xmin, ymin, zmin);
+                sum = 0;
+                for (ii=0; ii<(nx*ny*nz); ii++)
+                    sum += (dielYMap[i]->data[ii]);
+                sum = sum*hx*hy*hzed;
+                Vnm_tprint(1, "  Volume integral = %3.2e A^3\n", sum);
+                break;
+            // Raw binary grid format
+            case VDF_RAW:
+                if (Vgrid_readRaw(dielYMap[i], nosh->dielYpath[i]) != 1) {
+                    Vnm_tprint( 2, "Fatal error while reading from %s\n",
+                               nosh->dielYpath[i]);
+                    return 0;
+                }
+
+                // Read grid
+                nx = dielYMap[i]->nx;
+                ny = dielYMap[i]->ny;
+                nz = dielYMap[i]->nz;
+
+                // Read spacings
+                hx = dielYMap[i]->hx;
+                hy = dielYMap[i]->hy;
+                hzed = dielYMap[i]->hzed;
+
                 // Read minimum lower corner
                 xmin = dielYMap[i]->xmin;
                 ymin = dielYMap[i]->ymin;
@@ -599,6 +907,39 @@ VPUBLIC int loadDielMaps(NOsh *nosh,Vgrid *dielXMap[NOSH_MAXMOL], Vgrid *dielYMa
                 hy = dielZMap[i]->hy;
                 hzed = dielZMap[i]->hzed;
 
+                // Read minimum lower corner
+                xmin = dielZMap[i]->xmin;
+                ymin = dielZMap[i]->ymin;
+                zmin = dielZMap[i]->zmin;
+                Vnm_tprint(1, "  %d x %d x %d grid\n",
+                           nx, ny, nz);
+                Vnm_tprint(1, "  (%g, %g, %g) A spacings\n",
+                           hx, hy, hzed);
+                Vnm_tprint(1, "  (%g, %g, %g) A lower corner\n",
+                           xmin, ymin, zmin);
+                sum = 0;
+                for (ii=0; ii<(nx*ny*nz); ii++) sum += (dielZMap[i]->data[ii]);
+                sum = sum*hx*hy*hzed;
+                Vnm_tprint(1, "  Volume integral = %3.2e A^3\n", sum);
+                break;
+            // Raw binary grid format
+            case VDF_RAW:
+                if (Vgrid_readRaw(dielZMap[i], nosh->dielZpath[i]) != 1) {
+                    Vnm_tprint( 2, "Fatal error while reading from %s\n",
+                               nosh->dielZpath[i]);
+                    return 0;
+                }
+
+                // Read grid
+                nx = dielZMap[i]->nx;
+                ny = dielZMap[i]->ny;
+                nz = dielZMap[i]->nz;
+
+                // Read spacings
+                hx = dielZMap[i]->hx;
+                hy = dielZMap[i]->hy;
+                hzed = dielZMap[i]->hzed;
+
                 // Read minimum lower corner
                 xmin = dielZMap[i]->xmin;
                 ymin = dielZMap[i]->ymin;
@@ -762,6 +1103,26 @@ VPUBLIC int loadKappaMaps(NOsh *nosh,
                 sum = sum*map[i]->hx*map[i]->hy*map[i]->hzed;
                 Vnm_tprint(1, "  Volume integral = %3.2e A^3\n", sum);
                 break;
+            // Raw binary grid format
+            case VDF_RAW:
+                if (Vgrid_readRaw(map[i], nosh->kappapath[i]) != 1) {
+                    Vnm_tprint( 2, "Fatal error while reading from %s\n",
+                               nosh->kappapath[i]);
+                    return 0;
+                }
+                Vnm_tprint(1, "  %d x %d x %d grid\n",
+                           map[i]->nx, map[i]->ny, map[i]->nz);
+                Vnm_tprint(1, "  (%g, %g, %g) A spacings\n",
+                           map[i]->hx, map[i]->hy, map[i]->hzed);
+                Vnm_tprint(1, "  (%g, %g, %g) A lower corner\n",
+                           map[i]->xmin, map[i]->ymin, map[i]->zmin);
+                sum = 0;
+                for (ii=0, len=map[i]->nx*map[i]->ny*map[i]->nz; ii<len; ii++) {
+                    sum += (map[i]->data[ii]);
+                }
+                sum = sum*map[i]->hx*map[i]->hy*map[i]->hzed;
+                Vnm_tprint(1, "  Volume integral = %3.2e A^3\n", sum);
+                break;
             default:
                 Vnm_tprint( 2, "Invalid data format (%d)!\n",
                             nosh->kappafmt[i]);
@@ -812,6 +1173,10 @@ VPUBLIC int loadPotMaps(NOsh *nosh,
             case VDF_DX:
             // Binary file (GZip) format
             case VDF_GZ:
+            // Raw binary grid format
+            case VDF_RAW:
+            // Error-bounded lossy grid format
+            case VDF_LOSSY:
                 if (nosh->potfmt[i] == VDF_DX) {
                     if (Vgrid_readDX(map[i], "FILE", "ASC", VNULL,
                                      nosh->potpath[i]) != 1) {
@@ -819,6 +1184,18 @@ VPUBLIC int loadPotMaps(NOsh *nosh,
                                    nosh->potpath[i]);
                         return 0;
                     }
+                } else if (nosh->potfmt[i] == VDF_RAW) {
+                    if (Vgrid_readRaw(map[i], nosh->potpath[i]) != 1) {
+                        Vnm_tprint( 2, "Fatal error while reading from %s\n",
+                                   nosh->potpath[i]);
+                        return 0;
+                    }
+                } else if (nosh->potfmt[i] == VDF_LOSSY) {
+                    if (Vgrid_readLossy(map[i], nosh->potpath[i]) != 1) {
+                        Vnm_tprint( 2, "Fatal error while reading from %s\n",
+                                   nosh->potpath[i]);
+                        return 0;
+                    }
                 }else {
                     if (Vgrid_readGZ(map[i], nosh->potpath[i]) != 1) {
                         Vnm_tprint( 2, "Fatal error while reading from %s\n",
@@ -970,6 +1347,26 @@ VPUBLIC int loadChargeMaps(NOsh *nosh,
                 sum = sum*map[i]->hx*map[i]->hy*map[i]->hzed;
                 Vnm_tprint(1, "  Charge map integral = %3.2e e\n", sum);
                 break;
+            // Raw binary grid format
+            case VDF_RAW:
+                if (Vgrid_readRaw(map[i], nosh->chargepath[i]) != 1) {
+                    Vnm_tprint( 2, "Fatal error while reading from %s\n",
+                               nosh->chargepath[i]);
+                    return 0;
+                }
+                Vnm_tprint(1, "  %d x %d x %d grid\n",
+                           map[i]->nx, map[i]->ny, map[i]->nz);
+                Vnm_tprint(1, "  (%g, %g, %g) A spacings\n",
+                           map[i]->hx, map[i]->hy, map[i]->hzed);
+                Vnm_tprint(1, "  (%g, %g, %g) A lower corner\n",
+                           map[i]->xmin, map[i]->ymin, map[i]->zmin);
+                sum = 0;
+                for (ii=0,len=map[i]->nx*map[i]->ny*map[i]->nz; ii<len; ii++) {
+                    sum += (map[i]->data[ii]);
+                }
+                sum = sum*map[i]->hx*map[i]->hy*map[i]->hzed;
+                Vnm_tprint(1, "  Charge map integral = %3.2e e\n", sum);
+                break;
             default:
                 Vnm_tprint( 2, "Invalid data format (%d)!\n",
                             nosh->kappafmt[i]);
@@ -1167,6 +1564,12 @@ to ");
             case VDF_FLAT:
                 Vnm_tprint(1, "%s.%s\n", pbeparm->writestem[i], "txt");
                 break;
+            case VDF_RAW:
+                Vnm_tprint(1, "%s.%s\n", pbeparm->writestem[i], "raw");
+                break;
+            case VDF_LOSSY:
+                Vnm_tprint(1, "%s.%s\n", pbeparm->writestem[i], "lgz");
+                break;
             default:
                 Vnm_tprint(2, "  Invalid format for writing!\n");
                 break;
@@ -1423,6 +1826,14 @@ VPUBLIC int initMG(int icalc,
         return 0;
     }
 
+    /* Reuse cached coefficient maps if requested */
+    if (pbeparm->setcoefcache) {
+        if (!Vpmg_setCoefCache(pmg[icalc], pbeparm->coefcache)) {
+            Vnm_tprint(2, "initMG:  problems setting coefficient cache!\n");
+            return 0;
+        }
+    }
+
     // Initialize calculation coefficients
     if (!Vpmg_fillco(pmg[icalc],
                      pbeparm->srfm, pbeparm->swin, mgparm->chgm,
@@ -1475,11 +1886,14 @@ VPUBLIC void killMG(NOsh *nosh, Vpbe *pbe[NOSH_MAXCALC],
        bug some of the time when freeing Vpmg objects below. Therefore it
        appears to be important to release the Vpmg structs BEFORE the Vpmgp structs .
     */
-    Vpmg_dtor(&(pmg[nosh->ncalc-1]));
+#pragma omp critical(apbs_vmem)
+    {
+        if (nosh->ncalc > 0) Vpmg_dtor(&(pmg[nosh->ncalc-1]));
 
-    for(i=0;i<nosh->ncalc;i++){
-        Vpbe_dtor(&(pbe[i]));
-        Vpmgp_dtor(&(pmgp[i]));
+        for(i=0;i<nosh->ncalc;i++){
+            Vpbe_dtor(&(pbe[i]));
+            Vpmgp_dtor(&(pmgp[i]));
+        }
     }
 
 }
@@ -1579,8 +1993,11 @@ VPUBLIC int energyMG(NOsh *nosh,
     Valist *alist;
     Vatom *atom;
     int i,
+        natoms,
         extEnergy;
-    double tenergy;
+    double tenergy,
+           error,
+           *coulEnergy;
     MGparm *mgparm;
     PBEparm *pbeparm;
 
@@ -1626,6 +2043,26 @@ kJ/mol\n", Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na*(*totEnergy));
                         0.5*Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na*tenergy);
 #endif
         }
+        /* Homogeneous-dielectric reference for the per-atom energies above */
+        natoms = Valist_getNumberAtoms(alist);
+        coulEnergy = (double *)Vmem_malloc(pmg->vmem, natoms, sizeof(double));
+        if (Vpbe_getCoulombEnergyComps(pmg->pbe, &tenergy, coulEnergy,
+                    &error)) {
+#ifndef VAPBSQUIET
+            Vnm_tprint( 1, "  Coulomb energy (solute dielectric) = %1.12E \
+kJ/mol (error bound %g kJ/mol)\n",
+                        Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na*tenergy,
+                        Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na*error);
+            Vnm_tprint( 1, "  Per-atom Coulomb energies:\n");
+            for (i=0; i<natoms; i++) {
+                Vnm_tprint( 1, "      Atom %d:  %1.12E kJ/mol\n", i,
+                        Vunit_kb*pbeparm->temp*(1e-3)*Vunit_Na*coulEnergy[i]);
+            }
+#endif
+        } else {
+            Vnm_tprint( 2, "  Coulomb energy decomposition failed!\n");
+        }
+        Vmem_free(pmg->vmem, natoms, sizeof(double), (void **)&coulEnergy);
     } else *nenergy = 0;
 
     Vnm_tstop(APBS_TIMER_ENERGY, "Energy timer");
@@ -2386,14 +2823,23 @@ VPUBLIC int writedataMG(int rank,
                         Vpmg *pmg
                        ) {
 
-    char writestem[VMAX_ARGLEN];
-    char outpath[VMAX_ARGLEN];
-    char title[72];
-    int i,
-        nx,
+    return writedataMGAsync(rank, nosh, pbeparm, pmg, VNULL);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  fillWriteMG
+//
+// Purpose:  Fill pmg->rwork with the data of WRITE statement iwrite (only
+//           the points plo..phi if they are given) and set its description,
+//           the title and the lower corner of the map.  Returns 0 for an
+//           invalid data type.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int fillWriteMG(PBEparm *pbeparm, Vpmg *pmg, int iwrite, int *plo,
+  int *phi, const char **what, char title[72], double min[3]) {
+
+    int nx,
         ny,
-        nz,
-        natoms;
+        nz;
     double hx,
            hy,
            hzed,
@@ -2404,251 +2850,368 @@ VPUBLIC int writedataMG(int rank,
            ymin,
            zmin;
 
-    Vgrid *grid;
-    Vio *sock;
+    nx = pmg->pmgp->nx;
+    ny = pmg->pmgp->ny;
+    nz = pmg->pmgp->nz;
+    hx = pmg->pmgp->hx;
+    hy = pmg->pmgp->hy;
+    hzed = pmg->pmgp->hzed;
+
+    switch (pbeparm->writetype[iwrite]) {
+
+        case VDT_CHARGE:
+
+            *what = "charge distribution";
+            xcent = pmg->pmgp->xcent;
+            ycent = pmg->pmgp->ycent;
+            zcent = pmg->pmgp->zcent;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_CHARGE, 0.0,
+                                   pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title, "CHARGE DISTRIBUTION (e)");
+            break;
 
-    if (nosh->bogus) return 1;
+        case VDT_POT:
+
+            *what = "potential";
+            xcent = pmg->pmgp->xcent;
+            ycent = pmg->pmgp->ycent;
+            zcent = pmg->pmgp->zcent;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_POT, 0.0,
+                                   pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title, "POTENTIAL (kT/e)");
+            break;
 
-    for (i=0; i<pbeparm->numwrite; i++) {
+        case VDT_SMOL:
+
+            *what = "molecular accessibility";
+            xcent = pmg->pmgp->xcent;
+            ycent = pmg->pmgp->ycent;
+            zcent = pmg->pmgp->zcent;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_SMOL,
+                                   pbeparm->srad, pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title,
+                    "SOLVENT ACCESSIBILITY -- MOLECULAR (%4.3f PROBE)",
+                    pbeparm->srad);
+            break;
 
-        nx = pmg->pmgp->nx;
-        ny = pmg->pmgp->ny;
-        nz = pmg->pmgp->nz;
-        hx = pmg->pmgp->hx;
-        hy = pmg->pmgp->hy;
-        hzed = pmg->pmgp->hzed;
+        case VDT_SSPL:
+
+            *what = "spline-based accessibility";
+            xcent = pmg->pmgp->xcent;
+            ycent = pmg->pmgp->ycent;
+            zcent = pmg->pmgp->zcent;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_SSPL,
+                                   pbeparm->swin, pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title,
+                    "SOLVENT ACCESSIBILITY -- SPLINE (%4.3f WINDOW)",
+                    pbeparm->swin);
+            break;
 
-        switch (pbeparm->writetype[i]) {
+        case VDT_VDW:
+
+            *what = "van der Waals accessibility";
+            xcent = pmg->pmgp->xcent;
+            ycent = pmg->pmgp->ycent;
+            zcent = pmg->pmgp->zcent;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_VDW, 0.0,
+                                   pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title, "SOLVENT ACCESSIBILITY -- VAN DER WAALS");
+            break;
 
-            case VDT_CHARGE:
+        case VDT_IVDW:
+
+            *what = "ion accessibility";
+            xcent = pmg->pmgp->xcent;
+            ycent = pmg->pmgp->ycent;
+            zcent = pmg->pmgp->zcent;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_IVDW,
+                                   pmg->pbe->maxIonRadius, pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title,
+                    "ION ACCESSIBILITY -- SPLINE (%4.3f RADIUS)",
+                    pmg->pbe->maxIonRadius);
+            break;
 
-                Vnm_tprint(1, "  Writing charge distribution to ");
-                xcent = pmg->pmgp->xcent;
-                ycent = pmg->pmgp->ycent;
-                zcent = pmg->pmgp->zcent;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_CHARGE, 0.0,
-                                       pbeparm->pbetype, pbeparm));
-                sprintf(title, "CHARGE DISTRIBUTION (e)");
-                break;
+        case VDT_LAP:
+
+            *what = "potential Laplacian";
+            xcent = pmg->pmgp->xcent;
+            ycent = pmg->pmgp->ycent;
+            zcent = pmg->pmgp->zcent;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_LAP, 0.0,
+                                   pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title,
+                    "POTENTIAL LAPLACIAN (kT/e/A^2)");
+            break;
 
-            case VDT_POT:
+        case VDT_EDENS:
+
+            *what = "energy density";
+            xcent = pmg->pmgp->xcent;
+            ycent = pmg->pmgp->ycent;
+            zcent = pmg->pmgp->zcent;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_EDENS, 0.0,
+                                   pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title, "ENERGY DENSITY (kT/e/A)^2");
+            break;
 
-                Vnm_tprint(1, "  Writing potential to ");
-                xcent = pmg->pmgp->xcent;
-                ycent = pmg->pmgp->ycent;
-                zcent = pmg->pmgp->zcent;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_POT, 0.0,
-                                       pbeparm->pbetype, pbeparm));
-                sprintf(title, "POTENTIAL (kT/e)");
-                break;
+        case VDT_NDENS:
+
+            *what = "number density";
+            xcent = pmg->pmgp->xcent;
+            ycent = pmg->pmgp->ycent;
+            zcent = pmg->pmgp->zcent;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_NDENS, 0.0,
+                                   pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title,
+                    "ION NUMBER DENSITY (M)");
+            break;
 
-            case VDT_SMOL:
+        case VDT_QDENS:
+
+            *what = "charge density";
+            xcent = pmg->pmgp->xcent;
+            ycent = pmg->pmgp->ycent;
+            zcent = pmg->pmgp->zcent;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_QDENS, 0.0,
+                                   pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title,
+                    "ION CHARGE DENSITY (e_c * M)");
+            break;
 
-                Vnm_tprint(1, "  Writing molecular accessibility to ");
-                xcent = pmg->pmgp->xcent;
-                ycent = pmg->pmgp->ycent;
-                zcent = pmg->pmgp->zcent;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_SMOL,
-                                       pbeparm->srad, pbeparm->pbetype, pbeparm));
-                sprintf(title,
-                        "SOLVENT ACCESSIBILITY -- MOLECULAR (%4.3f PROBE)",
-                        pbeparm->srad);
-                break;
+        case VDT_DIELX:
+
+            *what = "x-shifted dielectric map";
+            xcent = pmg->pmgp->xcent + 0.5*hx;
+            ycent = pmg->pmgp->ycent;
+            zcent = pmg->pmgp->zcent;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_DIELX, 0.0,
+                                   pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title,
+                    "X-SHIFTED DIELECTRIC MAP");
+            break;
 
-            case VDT_SSPL:
+        case VDT_DIELY:
+
+            *what = "y-shifted dielectric map";
+            xcent = pmg->pmgp->xcent;
+            ycent = pmg->pmgp->ycent + 0.5*hy;
+            zcent = pmg->pmgp->zcent;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_DIELY, 0.0,
+                                   pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title,
+                    "Y-SHIFTED DIELECTRIC MAP");
+            break;
 
-                Vnm_tprint(1, "  Writing spline-based accessibility to ");
-                xcent = pmg->pmgp->xcent;
-                ycent = pmg->pmgp->ycent;
-                zcent = pmg->pmgp->zcent;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_SSPL,
-                                       pbeparm->swin, pbeparm->pbetype, pbeparm));
-                sprintf(title,
-                        "SOLVENT ACCESSIBILITY -- SPLINE (%4.3f WINDOW)",
-                        pbeparm->swin);
-                break;
+        case VDT_DIELZ:
+
+            *what = "z-shifted dielectric map";
+            xcent = pmg->pmgp->xcent;
+            ycent = pmg->pmgp->ycent;
+            zcent = pmg->pmgp->zcent + 0.5*hzed;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_DIELZ, 0.0,
+                                   pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title,
+                    "Z-SHIFTED DIELECTRIC MAP");
+            break;
 
-            case VDT_VDW:
+        case VDT_KAPPA:
+
+            *what = "kappa map";
+            xcent = pmg->pmgp->xcent;
+            ycent = pmg->pmgp->ycent;
+            zcent = pmg->pmgp->zcent;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_KAPPA, 0.0,
+                                   pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title,
+                    "KAPPA MAP");
+            break;
+
+        case VDT_ATOMPOT:
+
+            *what = "atom potentials";
+            xcent = pmg->pmgp->xcent;
+            ycent = pmg->pmgp->ycent;
+            zcent = pmg->pmgp->zcent;
+            xmin = xcent - 0.5*(nx-1)*hx;
+            ymin = ycent - 0.5*(ny-1)*hy;
+            zmin = zcent - 0.5*(nz-1)*hzed;
+            VASSERT(Vpmg_fillArrayBox(pmg, pmg->rwork, VDT_ATOMPOT, 0.0,
+                                   pbeparm->pbetype, pbeparm, plo, phi));
+            sprintf(title,
+                    "ATOM POTENTIALS");
+            break;
+        default:
+
+            Vnm_tprint(2, "Invalid data type for writing!\n");
+            return 0;
+    }
 
-                Vnm_tprint(1, "  Writing van der Waals accessibility to ");
-                xcent = pmg->pmgp->xcent;
-                ycent = pmg->pmgp->ycent;
-                zcent = pmg->pmgp->zcent;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_VDW, 0.0,
-                                       pbeparm->pbetype, pbeparm));
-                sprintf(title, "SOLVENT ACCESSIBILITY -- VAN DER WAALS");
-                break;
 
-            case VDT_IVDW:
+    min[0] = xmin;
+    min[1] = ymin;
+    min[2] = zmin;
 
-                Vnm_tprint(1, "  Writing ion accessibility to ");
-                xcent = pmg->pmgp->xcent;
-                ycent = pmg->pmgp->ycent;
-                zcent = pmg->pmgp->zcent;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_IVDW,
-                                       pmg->pbe->maxIonRadius, pbeparm->pbetype, pbeparm));
-                sprintf(title,
-                        "ION ACCESSIBILITY -- SPLINE (%4.3f RADIUS)",
-                        pmg->pbe->maxIonRadius);
-                break;
+    return 1;
+}
 
-            case VDT_LAP:
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  pathWriteMG
+//
+// Purpose:  Build the path of WRITE statement iwrite from its stem and
+//           format.  Returns 0 for a format that can't be written.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int pathWriteMG(PBEparm *pbeparm, int iwrite, const char *writestem,
+  char *outpath) {
 
-                Vnm_tprint(1, "  Writing potential Laplacian to ");
-                xcent = pmg->pmgp->xcent;
-                ycent = pmg->pmgp->ycent;
-                zcent = pmg->pmgp->zcent;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_LAP, 0.0,
-                                       pbeparm->pbetype, pbeparm));
-                sprintf(title,
-                        "POTENTIAL LAPLACIAN (kT/e/A^2)");
-                break;
+    switch (pbeparm->writefmt[iwrite]) {
 
-            case VDT_EDENS:
+        case VDF_DX:
+            sprintf(outpath, "%s.%s", writestem, "dx");
+            break;
 
-                Vnm_tprint(1, "  Writing energy density to ");
-                xcent = pmg->pmgp->xcent;
-                ycent = pmg->pmgp->ycent;
-                zcent = pmg->pmgp->zcent;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_EDENS, 0.0,
-                                       pbeparm->pbetype, pbeparm));
-                sprintf(title, "ENERGY DENSITY (kT/e/A)^2");
-                break;
+        case VDF_DXBIN:
+            sprintf(outpath, "%s.%s", writestem, "dxbin");
+            break;
 
-            case VDT_NDENS:
+        case VDF_AVS:
+            sprintf(outpath, "%s.%s", writestem, "ucd");
+            Vnm_tprint(1, "%s\n", outpath);
+            Vnm_tprint(2, "Sorry, AVS format isn't supported for \
+uniform meshes yet!\n");
+            return 0;
 
-                Vnm_tprint(1, "  Writing number density to ");
-                xcent = pmg->pmgp->xcent;
-                ycent = pmg->pmgp->ycent;
-                zcent = pmg->pmgp->zcent;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_NDENS, 0.0,
-                                       pbeparm->pbetype, pbeparm));
-                sprintf(title,
-                        "ION NUMBER DENSITY (M)");
-                break;
+        case VDF_MCSF:
+            sprintf(outpath, "%s.%s", writestem, "mcsf");
+            Vnm_tprint(1, "%s\n", outpath);
+            Vnm_tprint(2, "Sorry, MCSF format isn't supported for \
+                       uniform meshes yet!\n");
+            return 0;
 
-            case VDT_QDENS:
+        case VDF_UHBD:
+            sprintf(outpath, "%s.%s", writestem, "grd");
+            break;
 
-                Vnm_tprint(1, "  Writing charge density to ");
-                xcent = pmg->pmgp->xcent;
-                ycent = pmg->pmgp->ycent;
-                zcent = pmg->pmgp->zcent;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_QDENS, 0.0,
-                                       pbeparm->pbetype, pbeparm));
-                sprintf(title,
-                        "ION CHARGE DENSITY (e_c * M)");
-                break;
+        case VDF_GZ:
+            sprintf(outpath, "%s.%s", writestem, "dx.gz");
+            break;
 
-            case VDT_DIELX:
+        case VDF_RAW:
+            sprintf(outpath, "%s.%s", writestem, "raw");
+            break;
 
-                Vnm_tprint(1, "  Writing x-shifted dielectric map to ");
-                xcent = pmg->pmgp->xcent + 0.5*hx;
-                ycent = pmg->pmgp->ycent;
-                zcent = pmg->pmgp->zcent;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_DIELX, 0.0,
-                                       pbeparm->pbetype, pbeparm));
-                sprintf(title,
-                        "X-SHIFTED DIELECTRIC MAP");
-                break;
+        case VDF_LOSSY:
+            sprintf(outpath, "%s.%s", writestem, "lgz");
+            break;
 
-            case VDT_DIELY:
+        case VDF_FLAT:
+            sprintf(outpath, "%s.%s", writestem, "txt");
+            break;
 
-                Vnm_tprint(1, "  Writing y-shifted dielectric map to ");
-                xcent = pmg->pmgp->xcent;
-                ycent = pmg->pmgp->ycent + 0.5*hy;
-                zcent = pmg->pmgp->zcent;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_DIELY, 0.0,
-                                       pbeparm->pbetype, pbeparm));
-                sprintf(title,
-                        "Y-SHIFTED DIELECTRIC MAP");
-                break;
+        default:
+            Vnm_tprint(2, "Bogus data format (%d)!\n",
+                       pbeparm->writefmt[iwrite]);
+            return 0;
+    }
+    Vnm_tprint(1, "%s\n", outpath);
 
-            case VDT_DIELZ:
+    return 1;
+}
 
-                Vnm_tprint(1, "  Writing z-shifted dielectric map to ");
-                xcent = pmg->pmgp->xcent;
-                ycent = pmg->pmgp->ycent;
-                zcent = pmg->pmgp->zcent + 0.5*hzed;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_DIELZ, 0.0,
-                                       pbeparm->pbetype, pbeparm));
-                sprintf(title,
-                        "Z-SHIFTED DIELECTRIC MAP");
-                break;
+VPUBLIC int writedataMGAsync(int rank,
+                             NOsh *nosh,
+                             PBEparm *pbeparm,
+                             Vpmg *pmg,
+                             Vwriter *writer
+                            ) {
 
-            case VDT_KAPPA:
+    char writestem[VMAX_ARGLEN];
+    char outpath[VMAX_ARGLEN];
+    char title[72];
+    const char *what = VNULL;
+    int i,
+        nx,
+        ny,
+        nz,
+        ndata,
+        havebox,
+        lo[3],
+        hi[3],
+        *plo,
+        *phi;
+    double hx,
+           hy,
+           hzed,
+           min[3];
 
-                Vnm_tprint(1, "  Writing kappa map to ");
-                xcent = pmg->pmgp->xcent;
-                ycent = pmg->pmgp->ycent;
-                zcent = pmg->pmgp->zcent;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_KAPPA, 0.0,
-                                       pbeparm->pbetype, pbeparm));
-                sprintf(title,
-                        "KAPPA MAP");
-                break;
+    if (nosh->bogus) return 1;
 
-            case VDT_ATOMPOT:
+    /* Only the points this partition owns are written, so only those need
+     * to be computed */
+    havebox = Vgrid_partBox(pmg->pmgp->nx, pmg->pmgp->ny, pmg->pmgp->nz,
+      pmg->pvec, lo, hi);
 
-                Vnm_tprint(1, "  Writing atom potentials to ");
-                xcent = pmg->pmgp->xcent;
-                ycent = pmg->pmgp->ycent;
-                zcent = pmg->pmgp->zcent;
-                xmin = xcent - 0.5*(nx-1)*hx;
-                ymin = ycent - 0.5*(ny-1)*hy;
-                zmin = zcent - 0.5*(nz-1)*hzed;
-                VASSERT(Vpmg_fillArray(pmg, pmg->rwork, VDT_ATOMPOT, 0.0,
-                                       pbeparm->pbetype, pbeparm));
-                sprintf(title,
-                        "ATOM POTENTIALS");
-                break;
-            default:
+    for (i=0; i<pbeparm->numwrite; i++) {
 
-                Vnm_tprint(2, "Invalid data type for writing!\n");
-                return 0;
+        /* UHBD output ignores the partition and writes every point */
+        plo = VNULL;
+        phi = VNULL;
+        if (havebox && (pbeparm->writefmt[i] != VDF_UHBD)) {
+            plo = lo;
+            phi = hi;
         }
 
+        nx = pmg->pmgp->nx;
+        ny = pmg->pmgp->ny;
+        nz = pmg->pmgp->nz;
+        hx = pmg->pmgp->hx;
+        hy = pmg->pmgp->hy;
+        hzed = pmg->pmgp->hzed;
+        if (!fillWriteMG(pbeparm, pmg, i, plo, phi, &what, title, min)) {
+            return 0;
+        }
+        Vnm_tprint(1, "  Writing %s to ", what);
 
 #ifdef HAVE_MPI_H
         sprintf(writestem, "%s-PE%d", pbeparm->writestem[i], rank);
@@ -2660,91 +3223,191 @@ VPUBLIC int writedataMG(int rank,
         }
 #endif
 
-        switch (pbeparm->writefmt[i]) {
+        if (!pathWriteMG(pbeparm, i, writestem, outpath)) continue;
 
-            case VDF_DX:
-                sprintf(outpath, "%s.%s", writestem, "dx");
-                Vnm_tprint(1, "%s\n", outpath);
-                grid = Vgrid_ctor(nx, ny, nz, hx, hy, hzed, xmin, ymin, zmin,
-                                  pmg->rwork);
-                Vgrid_writeDX(grid, "FILE", "ASC", VNULL, outpath, title,
-                              pmg->pvec);
-                Vgrid_dtor(&grid);
-                break;
+        /* The values are snapshotted (or written) before this returns, so
+         * pmg->rwork is free for the next request */
+        ndata = nx*ny*nz;
+        if (pbeparm->writefmt[i] == VDF_FLAT) {
+            ndata = pmg->pbe->alist[pbeparm->molid-1].number;
+        }
+        if (!Vwriter_submit(writer, pbeparm->writefmt[i], outpath, title,
+                            nx, ny, nz, hx, hy, hzed, min[0], min[1], min[2],
+                            ndata, pmg->rwork, pmg->pvec,
+                            pbeparm->writetol[i])) {
+            return 0;
+        }
 
-            case VDF_DXBIN:
-        sprintf(outpath, "%s.%s", writestem, "dxbin");
-        Vnm_tprint(1, "%s\n", outpath);
-        grid = Vgrid_ctor(nx, ny, nz, hx, hy, hzed, xmin, ymin, zmin,
-                  pmg->rwork);
-        //TODO: write Vgrid_writeDXBIN method
-        Vgrid_writeDXBIN(grid, "FILE", "ASC", VNULL, outpath, title,
-                pmg->pvec);
-        Vgrid_dtor(&grid);
-        break;
+    }
 
-            case VDF_AVS:
-                sprintf(outpath, "%s.%s", writestem, "ucd");
-                Vnm_tprint(1, "%s\n", outpath);
-                Vnm_tprint(2, "Sorry, AVS format isn't supported for \
-uniform meshes yet!\n");
-                break;
+    return 1;
+}
 
-            case VDF_MCSF:
-                sprintf(outpath, "%s.%s", writestem, "mcsf");
-                Vnm_tprint(1, "%s\n", outpath);
-                Vnm_tprint(2, "Sorry, MCSF format isn't supported for \
-                           uniform meshes yet!\n");
-                break;
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  partCorner
+//
+// Purpose:  Get the grid size and lower corner of a partition's mesh
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void partCorner(Vpmg *pmg, int n[3], double min[3]) {
+
+    n[0] = pmg->pmgp->nx;
+    n[1] = pmg->pmgp->ny;
+    n[2] = pmg->pmgp->nz;
+    min[0] = pmg->pmgp->xcent - 0.5*pmg->pmgp->hx*(n[0]-1);
+    min[1] = pmg->pmgp->ycent - 0.5*pmg->pmgp->hy*(n[1]-1);
+    min[2] = pmg->pmgp->zcent - 0.5*pmg->pmgp->hzed*(n[2]-1);
+}
 
-            case VDF_UHBD:
-                sprintf(outpath, "%s.%s", writestem, "grd");
-                Vnm_tprint(1, "%s\n", outpath);
-                grid = Vgrid_ctor(nx, ny, nz, hx, hy, hzed, xmin, ymin, zmin,
-                                  pmg->rwork);
-                Vgrid_writeUHBD(grid, "FILE", "ASC", VNULL, outpath, title,
-                                pmg->pvec);
-                Vgrid_dtor(&grid);
-                break;
+VPUBLIC int writedataMGPart(int rank,
+                            NOsh *nosh,
+                            PBEparm *pbeparm,
+                            int npart,
+                            Vpmg *pmg[],
+                            Vwriter *writer
+                           ) {
 
-            case VDF_GZ:
-                sprintf(outpath, "%s.%s", writestem, "dx.gz");
-                Vnm_tprint(1, "%s\n", outpath);
-                grid = Vgrid_ctor(nx, ny, nz, hx, hy, hzed, xmin, ymin, zmin,
-                                  pmg->rwork);
-                Vgrid_writeGZ(grid, "FILE", "ASC", VNULL, outpath, title,
-                              pmg->pvec);
-                Vgrid_dtor(&grid);
-                break;
-            case VDF_FLAT:
-                sprintf(outpath, "%s.%s", writestem, "txt");
-                Vnm_tprint(1, "%s\n", outpath);
-                Vnm_print(0, "routines:  Opening virtual socket...\n");
-                sock = Vio_ctor("FILE","ASC",VNULL,outpath,"w");
-                if (sock == VNULL) {
-                    Vnm_print(2, "routines:  Problem opening virtual socket %s\n",
-                              outpath);
+    char writestem[VMAX_ARGLEN];
+    char outpath[VMAX_ARGLEN];
+    char title[72];
+    const char *what = VNULL;
+    int i,
+        ip,
+        j,
+        ii,
+        jj,
+        kk,
+        nx,
+        ny,
+        ndata,
+        gnx,
+        gny,
+        gnz,
+        ngrid,
+        n[3],
+        lo[3],
+        hi[3],
+        off[3];
+    double h[3],
+           min[3],
+           pmin[3],
+           pmax,
+           gmin[3],
+           gmax[3],
+           gorig[3],
+           w,
+           *data = VNULL,
+           *weight = VNULL;
+    Vpmg *part = VNULL;
+
+    if (nosh->bogus || (npart < 1) || (pbeparm->numwrite < 1)) return 1;
+
+    /* The partitions are windows of one global fine grid with a common
+     * spacing; find its extent */
+    h[0] = pmg[0]->pmgp->hx;
+    h[1] = pmg[0]->pmgp->hy;
+    h[2] = pmg[0]->pmgp->hzed;
+    for (ip=0; ip<npart; ip++) {
+        partCorner(pmg[ip], n, pmin);
+        for (j=0; j<3; j++) {
+            pmax = pmin[j] + h[j]*(n[j]-1);
+            if ((ip == 0) || (pmin[j] < gmin[j])) gmin[j] = pmin[j];
+            if ((ip == 0) || (pmax > gmax[j])) gmax[j] = pmax;
+        }
+    }
+    gnx = (int)VFLOOR((gmax[0] - gmin[0])/h[0] + 0.5) + 1;
+    gny = (int)VFLOOR((gmax[1] - gmin[1])/h[1] + 0.5) + 1;
+    gnz = (int)VFLOOR((gmax[2] - gmin[2])/h[2] + 0.5) + 1;
+    ngrid = gnx*gny*gnz;
+
+    for (i=0; i<pbeparm->numwrite; i++) {
+
+        /* Atom data isn't a grid, so each partition writes its own file */
+        if (pbeparm->writefmt[i] == VDF_FLAT) {
+            for (ip=0; ip<npart; ip++) {
+                part = pmg[ip];
+                if (!fillWriteMG(pbeparm, part, i, VNULL, VNULL, &what, title,
+                                 min)) {
                     return 0;
                 }
-                if (Vio_connect(sock, 0) < 0) {
-                    Vnm_print(2, "routines: Problem connecting virtual socket %s\n",
-                              outpath);
+                Vnm_tprint(1, "  Writing %s to ", what);
+                sprintf(writestem, "%s-PE%d", pbeparm->writestem[i], ip);
+                if (!pathWriteMG(pbeparm, i, writestem, outpath)) continue;
+                ndata = Valist_getNumberAtoms(part->pbe->alist);
+                if (!Vwriter_submit(writer, pbeparm->writefmt[i], outpath,
+                                    title, part->pmgp->nx, part->pmgp->ny,
+                                    part->pmgp->nz, h[0], h[1], h[2],
+                                    min[0], min[1], min[2], ndata,
+                                    part->rwork, part->pvec,
+                                    pbeparm->writetol[i])) {
                     return 0;
                 }
-                Vio_printf(sock, "# Data from %s\n", PACKAGE_STRING);
-                Vio_printf(sock, "# \n");
-                Vio_printf(sock, "# %s\n", title);
-                Vio_printf(sock, "# \n");
-                natoms = pmg->pbe->alist[pbeparm->molid-1].number;
-                for(i=0;i<natoms;i++)
-                    Vio_printf(sock, "%12.6e\n", pmg->rwork[i]);
-                break;
-            default:
-                Vnm_tprint(2, "Bogus data format (%d)!\n",
-                           pbeparm->writefmt[i]);
-                break;
+            }
+            continue;
+        }
+
+        /* Blend the points each partition owns by their partition weights,
+         * which add up to one where partitions meet */
+        data = (double *)Vmem_malloc(VNULL, ngrid, sizeof(double));
+        weight = (double *)Vmem_malloc(VNULL, ngrid, sizeof(double));
+        VASSERT((data != VNULL) && (weight != VNULL));
+        for (j=0; j<ngrid; j++) {
+            data[j] = 0.0;
+            weight[j] = 0.0;
+        }
+        what = VNULL;
+        for (ip=0; ip<npart; ip++) {
+            part = pmg[ip];
+            if (!Vgrid_partBox(part->pmgp->nx, part->pmgp->ny, part->pmgp->nz,
+              part->pvec, lo, hi)) continue;
+            if (!fillWriteMG(pbeparm, part, i, lo, hi, &what, title, min)) {
+                Vmem_free(VNULL, ngrid, sizeof(double), (void **)&data);
+                Vmem_free(VNULL, ngrid, sizeof(double), (void **)&weight);
+                return 0;
+            }
+            partCorner(part, n, pmin);
+            nx = n[0];
+            ny = n[1];
+            for (j=0; j<3; j++) {
+                off[j] = (int)VFLOOR((pmin[j] - gmin[j])/h[j] + 0.5);
+                /* The origin of the map follows its data type (shifted
+                 * dielectric maps) */
+                gorig[j] = min[j] - off[j]*h[j];
+            }
+            for (kk=lo[2]; kk<=hi[2]; kk++) {
+                for (jj=lo[1]; jj<=hi[1]; jj++) {
+                    for (ii=lo[0]; ii<=hi[0]; ii++) {
+                        w = part->pvec[ii + nx*jj + nx*ny*kk];
+                        if (w <= 0.0) continue;
+                        j = (ii+off[0]) + gnx*((jj+off[1]) + gny*(kk+off[2]));
+                        data[j] += w*part->rwork[ii + nx*jj + nx*ny*kk];
+                        weight[j] += w;
+                    }
+                }
+            }
+        }
+        for (j=0; j<ngrid; j++) {
+            if (weight[j] > 0.0) data[j] /= weight[j];
         }
 
+        if (what == VNULL) {
+            Vmem_free(VNULL, ngrid, sizeof(double), (void **)&data);
+            Vmem_free(VNULL, ngrid, sizeof(double), (void **)&weight);
+            continue;
+        }
+        Vnm_tprint(1, "  Writing merged %s of %d partitions to ", what,
+                   npart);
+        sprintf(writestem, "%s", pbeparm->writestem[i]);
+        if (pathWriteMG(pbeparm, i, writestem, outpath) &&
+            !Vwriter_submit(writer, pbeparm->writefmt[i], outpath, title,
+                            gnx, gny, gnz, h[0], h[1], h[2],
+                            gorig[0], gorig[1], gorig[2], ngrid, data, VNULL,
+                            pbeparm->writetol[i])) {
+            Vmem_free(VNULL, ngrid, sizeof(double), (void **)&data);
+            Vmem_free(VNULL, ngrid, sizeof(double), (void **)&weight);
+            return 0;
+        }
+        Vmem_free(VNULL, ngrid, sizeof(double), (void **)&data);
+        Vmem_free(VNULL, ngrid, sizeof(double), (void **)&weight);
     }
 
     return 1;
@@ -4503,7 +5166,7 @@ VPUBLIC int initAPOL(NOsh *nosh, /**< Input parameter object */
            srad,        /**< @todo document */
            *atomsasa,   /**< @todo document */
            *atomwcaEnergy,  /**< @todo document */
-           energy = 0.0,    /**< WCA energy per atom */
+           *wcaEnergy = VNULL,  /**< WCA energy per atom (owned by acc) */
            dist,        /**< @todo document */
            charge,      /**< @todo document */
            xmin,        /**< @todo document */
@@ -4642,15 +5305,13 @@ VPUBLIC int initAPOL(NOsh *nosh, /**< Input parameter object */
 
         /* wcaEnergy integral code */
         if (VABS(apolparm->bconc) > VSMALL) {
-            /* wcaEnergy for each atom */
-            for (i = 0; i < len; i++) {
-                rc = Vacc_wcaEnergyAtom(acc, apolparm, alist, clist, i, &energy);
-                if (rc == 0)  {
-                    Vnm_print(2, "Error in apolar energy calculation!\n");
-                    return 0;
-                }
-                atomwcaEnergy[i] = energy;
+            /* wcaEnergy for each atom (shared with the force calculation) */
+            rc = Vacc_wcaAtoms(acc, apolparm, alist, clist, &wcaEnergy, VNULL);
+            if (rc == 0)  {
+                Vnm_print(2, "Error in apolar energy calculation!\n");
+                return 0;
             }
+            for (i = 0; i < len; i++) atomwcaEnergy[i] = wcaEnergy[i];
             /* Total WCA Energy */
             rc = Vacc_wcaEnergy(acc, apolparm, alist, clist);
             if (rc == 0) {
@@ -4745,38 +5406,43 @@ VPUBLIC int forceAPOL(Vacc *acc,
            zF,  /* Individual forces */
            press,
            gamma,
-           offset,
            bconc,
            dSASA[3],
            dSAV[3],
            force[3],
-           *apos;
+           *allSASA = VNULL,
+           *allSAV = VNULL,
+           *allWCA = VNULL;
 
-    Vatom *atom = VNULL;
     ts_main = clock();
 
     srad = apolparm->srad;
     press = apolparm->press;
     gamma = apolparm->gamma;
-    offset = apolparm->dpos;
     bconc = apolparm->bconc;
 
     natom = Valist_getNumberAtoms(alist);
 
-    /* Check to see if we need to build the surface */
-    Vnm_print(0, "forceAPOL: Trying atom surf...\n");
+    /* Get the surface, volume and WCA derivatives for all atoms in one sweep */
+    Vnm_print(0, "forceAPOL: Computing surface derivatives...\n");
     ts = clock();
-    if (acc->surf == VNULL) {
-        acc->surf = (VaccSurf**)Vmem_malloc(acc->mem, natom, sizeof(VaccSurf *));
-        for (i=0; i<natom; i++) {
-            atom = Valist_getAtom(acc->alist, i);
-            //apos = Vatom_getPosition(atom); // apos never referenced? - Peter
-            /* NOTE:  RIGHT NOW WE DO THIS FOR THE ENTIRE MOLECULE WHICH IS
-             * INCREDIBLY INEFFICIENT, PARTICULARLY DURING FOCUSING!!! */
-            acc->surf[i] = Vacc_atomSurf(acc, atom, acc->refSphere, srad);
+    if ((apolparm->calcforce == ACF_TOTAL) || (apolparm->calcforce == ACF_COMPS)) {
+        if (VABS(gamma) > VSMALL) {
+            allSASA = (double *)Vmem_malloc(mem, 3*natom, sizeof(double));
+            Vacc_allAtomdSASA(acc, srad, allSASA, VNULL);
+        }
+        if (VABS(press) > VSMALL) {
+            allSAV = (double *)Vmem_malloc(mem, 3*natom, sizeof(double));
+            Vacc_allAtomdSAV(acc, srad, allSAV);
+        }
+        if (VABS(bconc) > VSMALL) {
+            if (Vacc_wcaAtoms(acc, apolparm, alist, clist, VNULL, &allWCA)
+                    != VRC_SUCCESS) {
+                return VRC_FAILURE;
+            }
         }
     }
-    Vnm_print(0, "forceAPOL: atom surf: Time elapsed: %f\n", ((double)clock() - ts) / CLOCKS_PER_SEC);
+    Vnm_print(0, "forceAPOL: surface derivatives: Time elapsed: %f\n", ((double)clock() - ts) / CLOCKS_PER_SEC);
 
     if(apolparm->calcforce == ACF_TOTAL){
         Vnm_print(0, "forceAPOL: calcforce == ACF_TOTAL\n");
@@ -4799,22 +5465,20 @@ VPUBLIC int forceAPOL(Vacc *acc,
 
         // problem block
         for (i=0; i<natom; i++) {
-            atom = Valist_getAtom(alist, i);
-
             for(j=0;j<3;j++){
                 dSASA[j] = 0.0;
                 dSAV[j] = 0.0;
                 force[j] = 0.0;
             }
 
-            if(VABS(gamma) > VSMALL) {
-                Vacc_atomdSASA(acc, offset, srad, atom, dSASA);
+            if(allSASA != VNULL) {
+                for(j=0;j<3;j++) dSASA[j] = allSASA[3*i+j];
             }
-            if(VABS(press) > VSMALL) {
-                Vacc_atomdSAV(acc, srad, atom, dSAV);
+            if(allSAV != VNULL) {
+                for(j=0;j<3;j++) dSAV[j] = allSAV[3*i+j];
             }
-            if(VABS(bconc) > VSMALL) {
-                Vacc_wcaForceAtom(acc, apolparm, clist, atom, force);
+            if(allWCA != VNULL) {
+                for(j=0;j<3;j++) force[j] = allWCA[3*i+j];
             }
 
             for(j=0;j<3;j++){
@@ -4871,8 +5535,6 @@ VPUBLIC int forceAPOL(Vacc *acc,
 #endif
 
         for (i=0; i<natom; i++) {
-            atom = Valist_getAtom(alist, i);
-
             for(j=0;j<3;j++){
                 dSASA[j] = 0.0;
                 dSAV[j] = 0.0;
@@ -4886,9 +5548,9 @@ VPUBLIC int forceAPOL(Vacc *acc,
                 (*atomForce)[i].wcaForce[j] = 0.0;
             }
 
-            if(VABS(gamma) > VSMALL) Vacc_atomdSASA(acc, offset, srad, atom, dSASA);
-            if(VABS(press) > VSMALL) Vacc_atomdSAV(acc, srad, atom, dSAV);
-            if(VABS(bconc) > VSMALL) Vacc_wcaForceAtom(acc,apolparm,clist,atom,force);
+            if(allSASA != VNULL) for(j=0;j<3;j++) dSASA[j] = allSASA[3*i+j];
+            if(allSAV != VNULL) for(j=0;j<3;j++) dSAV[j] = allSAV[3*i+j];
+            if(allWCA != VNULL) for(j=0;j<3;j++) force[j] = allWCA[3*i+j];
 
             xF = -((gamma*dSASA[0]) + (press*dSAV[0]) + (bconc*force[0]));
             yF = -((gamma*dSASA[1]) + (press*dSAV[1]) + (bconc*force[1]));
@@ -4930,6 +5592,9 @@ VPUBLIC int forceAPOL(Vacc *acc,
     Vnm_print(1,"\n");
 #endif
 
+    if (allSASA != VNULL) Vmem_free(mem, 3*natom, sizeof(double), (void **)&allSASA);
+    if (allSAV != VNULL) Vmem_free(mem, 3*natom, sizeof(double), (void **)&allSAV);
+
     Vnm_print(0, "forceAPOL: Time elapsed: %f\n", ((double)clock() - ts_main) / CLOCKS_PER_SEC);
     return VRC_SUCCESS;
 }
@@ -5618,3 +6283,581 @@ VPUBLIC int solvePBSAM( Valist* molecules[NOSH_MAXMOL],
 }
 
 #endif
+
+#ifdef APBS_SERVER
+
+/* Names the server reserves in a request directory */
+#define SERVER_INPUT "apbs.in"
+#define SERVER_LOG "apbs.log"
+
+/* How long the server sleeps (ms) before it looks for finished requests
+ * even without a SIGCHLD */
+#define SERVER_WAKE 1000
+
+/* A request being run by a child of the server */
+typedef struct sServerJob {
+    pid_t pid;  /* Child serving the request */
+    char dir[VMAX_ARGLEN];  /* Request directory */
+} ServerJob;
+
+/* Set by SIGINT and SIGTERM to shut the server down */
+VPRIVATE volatile sig_atomic_t serverStop = 0;
+
+/* The request run by this process (request jobs only) */
+VPRIVATE int serverConn = -1;
+VPRIVATE char serverDir[VMAX_ARGLEN];
+VPRIVATE char (*serverNames)[VMAX_ARGLEN] = VNULL;
+VPRIVATE int serverNum = 0;
+VPRIVATE int serverLen = 0;
+
+VPRIVATE void serverSignal(int sig) { serverStop = 1; }
+
+/* SIGCHLD only has to interrupt poll so finished requests are reaped */
+VPRIVATE void serverWake(int sig) { }
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  serverWrite
+//
+// Purpose:  Write all of a buffer to a socket.  Returns 1 on success.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int serverWrite(int fd, const char *buf, size_t len) {
+
+    ssize_t n;
+
+    while (len > 0) {
+        n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 1;
+
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  serverReadLine
+//
+// Purpose:  Read one header line (without the newline) from a socket.
+//           Returns 1 on success, 0 on end of file, error or overflow.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int serverReadLine(int fd, char *line, int len) {
+
+    ssize_t n;
+    int i = 0;
+    char c;
+
+    while (i < len-1) {
+        n = read(fd, &c, 1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        if (n == 0) return 0;
+        if (c == '\n') {
+            line[i] = '\0';
+            return 1;
+        }
+        line[i++] = c;
+    }
+    return 0;
+
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  serverReceive
+//
+// Purpose:  Copy the next len bytes from a socket to a new file.  Returns
+//           1 on success.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int serverReceive(int fd, const char *path, long len) {
+
+    char buf[VMAX_BUFSIZE];
+    ssize_t n;
+    int out, status = 1;
+
+    out = open(path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (out < 0) return 0;
+    while (len > 0) {
+        n = read(fd, buf, (size_t)VMIN2(len, (long)VMAX_BUFSIZE));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            status = 0;
+            break;
+        }
+        if (n == 0) {
+            status = 0;
+            break;
+        }
+        if (!serverWrite(out, buf, (size_t)n)) {
+            status = 0;
+            break;
+        }
+        len -= (long)n;
+    }
+    if (close(out) != 0) status = 0;
+    return status;
+
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  serverSend
+//
+// Purpose:  Send a file as a "<tag> [<name> ]<size>" frame.  Returns 1 on
+//           success.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int serverSend(int fd, const char *tag, const char *name,
+  const char *path) {
+
+    char buf[VMAX_BUFSIZE];
+    struct stat st;
+    ssize_t n;
+    long len;
+    int in, status = 1;
+
+    in = open(path, O_RDONLY);
+    if (in < 0) return 0;
+    if (fstat(in, &st) != 0) {
+        close(in);
+        return 0;
+    }
+    len = (long)st.st_size;
+    if (name != VNULL) snprintf(buf, VMAX_BUFSIZE, "%s %s %ld\n", tag, name,
+      len);
+    else snprintf(buf, VMAX_BUFSIZE, "%s %ld\n", tag, len);
+    status = serverWrite(fd, buf, strlen(buf));
+    while (status && (len > 0)) {
+        n = read(in, buf, (size_t)VMIN2(len, (long)VMAX_BUFSIZE));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            status = 0;
+            break;
+        }
+        /* Pad a file that shrank under us so the frame stays intact */
+        if (n == 0) {
+            memset(buf, 0, VMAX_BUFSIZE);
+            n = (ssize_t)VMIN2(len, (long)VMAX_BUFSIZE);
+        }
+        status = serverWrite(fd, buf, (size_t)n);
+        len -= (long)n;
+    }
+    close(in);
+    return status;
+
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  serverError
+//
+// Purpose:  Answer a request that could not be run.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void serverError(int fd, const char *msg) {
+
+    char buf[VMAX_BUFSIZE];
+
+    Vnm_tprint(2, "APBS server:  %s\n", msg);
+    snprintf(buf, VMAX_BUFSIZE, "OUTPUT %ld\n%s\nSTATUS %d\n",
+      (long)strlen(msg)+1, msg, APBSRC);
+    serverWrite(fd, buf, strlen(buf));
+
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  serverClean
+//
+// Purpose:  Remove a request directory, or the spool directory and the
+//           request directories left in it.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void serverClean(const char *dir) {
+
+    char path[VMAX_ARGLEN];
+    struct dirent *ent;
+    struct stat st;
+    DIR *d;
+
+    d = opendir(dir);
+    if (d != VNULL) {
+        while ((ent = readdir(d)) != VNULL) {
+            if ((strcmp(ent->d_name, ".") == 0) ||
+              (strcmp(ent->d_name, "..") == 0)) continue;
+            snprintf(path, VMAX_ARGLEN, "%s/%s", dir, ent->d_name);
+            if ((lstat(path, &st) == 0) && S_ISDIR(st.st_mode))
+                serverClean(path);
+            else unlink(path);
+        }
+        closedir(d);
+    }
+    rmdir(dir);
+
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  serverRead
+//
+// Purpose:  Read a request into a directory.  A request is any number of
+//           "FILE <name> <size>" frames followed by one "INPUT <size>"
+//           frame with the input file itself.  Returns 1 on success.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int serverRead(int fd, const char *dir) {
+
+    char line[VMAX_ARGLEN], name[VMAX_ARGLEN], path[VMAX_ARGLEN];
+    char (*names)[VMAX_ARGLEN];
+    long len;
+
+    serverNum = 0;
+    while (serverReadLine(fd, line, VMAX_ARGLEN)) {
+        if (sscanf(line, "INPUT %ld", &len) == 1) {
+            if (len < 0) return 0;
+            snprintf(path, VMAX_ARGLEN, "%s/%s", dir, SERVER_INPUT);
+            return serverReceive(fd, path, len);
+        }
+        if ((sscanf(line, "FILE %1023s %ld", name, &len) != 2) || (len < 0))
+            return 0;
+        if ((name[0] == '.') || (strchr(name, '/') != VNULL) ||
+          (strcmp(name, SERVER_INPUT) == 0) ||
+          (strcmp(name, SERVER_LOG) == 0) ||
+          (strcmp(name, "io.mc") == 0)) return 0;
+        snprintf(path, VMAX_ARGLEN, "%s/%s", dir, name);
+        if (!serverReceive(fd, path, len)) return 0;
+
+        /* Remember the inputs so they aren't sent back */
+        if (serverNum == serverLen) {
+            names = Vmem_malloc(VNULL, 2*serverLen+8, sizeof(*names));
+            if (serverNum > 0) memcpy(names, serverNames,
+              serverNum*sizeof(*names));
+            if (serverNames != VNULL) Vmem_free(VNULL, serverLen,
+              sizeof(*names), (void **)&serverNames);
+            serverNames = names;
+            serverLen = 2*serverLen+8;
+        }
+        strcpy(serverNames[serverNum], name);
+        serverNum++;
+    }
+    return 0;
+
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  serverReap
+//
+// Purpose:  Collect finished request children, optionally waiting for the
+//           first one.  A request child removes its request directory
+//           before it exits, so a directory that is still there means the
+//           child itself was killed; it is removed here.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void serverReap(ServerJob *jobs, int *running, int block) {
+
+    struct stat st;
+    pid_t pid;
+    int i, status;
+
+    while ((pid = waitpid(-1, &status, block ? 0 : WNOHANG)) > 0) {
+        block = 0;
+        for (i=0; i<*running; i++) {
+            if (jobs[i].pid == pid) break;
+        }
+        if (i == *running) continue;
+        if (lstat(jobs[i].dir, &st) == 0) {
+            Vnm_tprint(2, "APBS server:  Request child %d was killed!\n",
+              (int)pid);
+            serverClean(jobs[i].dir);
+        }
+        (*running)--;
+        jobs[i] = jobs[*running];
+    }
+
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  serverRequest
+//
+// Purpose:  Serve one connection in a child of the server: read the
+//           request and fork the process that runs it.  That process
+//           returns 1 from here; the child itself waits for it, answers
+//           the client if it died before replying (on a failed assertion,
+//           say) and exits.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int serverRequest(int conn, const char *dir, int nthreads,
+  char **input_path) {
+
+    static char input[] = SERVER_INPUT;
+    char path[VMAX_ARGLEN];
+    struct timeval tv;
+    struct stat st;
+    pid_t pid;
+    int fd, flags, status = 0, rc;
+
+    /* SIGPIPE stays ignored, so a client that hangs up can't keep the
+     * request directory from being removed */
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+
+    /* Don't let a stalled client hold up the request forever */
+    flags = fcntl(conn, F_GETFL);
+    if (flags >= 0) fcntl(conn, F_SETFL, flags & ~O_NONBLOCK);
+    tv.tv_sec = 60;
+    tv.tv_usec = 0;
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    if (!serverRead(conn, dir)) {
+        serverError(conn, "Malformed request!");
+        close(conn);
+        serverClean(dir);
+        _exit(APBSRC);
+    }
+
+#ifdef _OPENMP
+    omp_set_num_threads(nthreads);
+#endif
+    Vnm_flush(1);
+    Vnm_flush(2);
+    fflush(VNULL);
+    pid = fork();
+    if (pid == 0) {
+
+        /* Run the input in its directory with the console going to a log
+         * for the reply */
+        if (chdir(dir) != 0) _exit(APBSRC);
+        fd = open(SERVER_LOG, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0) _exit(APBSRC);
+        dup2(fd, 1);
+        dup2(fd, 2);
+        close(fd);
+        serverConn = conn;
+        strcpy(serverDir, dir);
+        *input_path = input;
+        return 1;
+    }
+    if (pid < 0) {
+        serverError(conn, "Can't start a job for the request!");
+        close(conn);
+        serverClean(dir);
+        _exit(APBSRC);
+    }
+
+    /* finishInput removes the request directory once it has replied, so a
+     * directory that is still there means the job died first */
+    while ((waitpid(pid, &status, 0) < 0) && (errno == EINTR));
+    if (lstat(dir, &st) == 0) {
+        rc = APBSRC;
+        if (WIFEXITED(status) && (WEXITSTATUS(status) != 0))
+            rc = WEXITSTATUS(status);
+        Vnm_tprint(2, "APBS server:  Job %d ended without replying!\n",
+          (int)pid);
+        snprintf(path, VMAX_ARGLEN, "%s/%s", dir, SERVER_LOG);
+        if (!serverSend(conn, "OUTPUT", VNULL, path))
+            serverWrite(conn, "OUTPUT 0\n", 9);
+        snprintf(path, VMAX_ARGLEN, "STATUS %d\n", rc);
+        serverWrite(conn, path, strlen(path));
+        serverClean(dir);
+    }
+    close(conn);
+    _exit(0);
+
+}
+
+VPUBLIC int serveInputs(const char *path, int njobs, int ncache,
+  char **input_path) {
+
+    struct sockaddr_un addr;
+    struct sigaction sa;
+    struct pollfd pfd;
+    struct stat st;
+    char spool[VMAX_ARGLEN], dir[VMAX_ARGLEN];
+    const char *tmp;
+    ServerJob *jobs;
+    int lsock = -1, conn, n;
+    int running = 0, nreq = 0, nthreads = 1, rc = 0;
+    pid_t pid;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        Vnm_tprint(2, "APBS server:  Socket path %s is too long!\n", path);
+        return -1;
+    }
+    if (njobs <= 0) njobs = VMAX2((int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+
+    /* Requests are unpacked and run in a private spool directory */
+    tmp = getenv("TMPDIR");
+    if ((tmp == VNULL) || (tmp[0] == '\0')) tmp = "/tmp";
+    snprintf(spool, VMAX_ARGLEN, "%s/apbs-server-XXXXXX", tmp);
+    if (mkdtemp(spool) == VNULL) {
+        Vnm_tprint(2, "APBS server:  Can't create a spool directory in %s!\n",
+          tmp);
+        return -1;
+    }
+    if (realpath(spool, dir) != VNULL) strcpy(spool, dir);
+
+    /* Replace a stale socket, but never any other kind of file */
+    if ((lstat(path, &st) == 0) && S_ISSOCK(st.st_mode)) unlink(path);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    lsock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((lsock < 0) ||
+      (bind(lsock, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+      (listen(lsock, 64) != 0)) {
+        Vnm_tprint(2, "APBS server:  Can't listen on %s (%s)!\n", path,
+          strerror(errno));
+        if (lsock >= 0) close(lsock);
+        serverClean(spool);
+        return -1;
+    }
+
+    /* A client that gives up between poll and accept mustn't block us */
+    n = fcntl(lsock, F_GETFL);
+    if (n >= 0) fcntl(lsock, F_SETFL, n | O_NONBLOCK);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = serverSignal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, VNULL);
+    sigaction(SIGTERM, &sa, VNULL);
+    sa.sa_handler = serverWake;
+    sa.sa_flags = SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, VNULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    /* The server itself never starts an OpenMP thread team, since the
+     * teams don't survive fork; requests share the threads instead */
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+
+    jobs = (ServerJob *)Vmem_malloc(VNULL, njobs, sizeof(ServerJob));
+    setInputCache(ncache, spool);
+    Vnm_tprint(1, "Serving inputs on %s with up to %d at once.\n", path,
+      njobs);
+    Vnm_flush(1);
+
+    while (!serverStop) {
+
+        /* Reap finished requests on every wake-up */
+        serverReap(jobs, &running, 0);
+
+        /* Wait for a connection while a slot is free, and otherwise just
+         * for SIGCHLD or the timeout */
+        pfd.fd = lsock;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        n = poll(&pfd, (running < njobs) ? 1 : 0, SERVER_WAKE);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            Vnm_tprint(2, "APBS server:  poll failed (%s)!\n",
+              strerror(errno));
+            rc = -1;
+            break;
+        }
+        if ((n == 0) || !(pfd.revents & POLLIN)) continue;
+
+        conn = accept(lsock, VNULL, VNULL);
+        if (conn < 0) {
+            if ((errno == EINTR) || (errno == ECONNABORTED) ||
+              (errno == EAGAIN) || (errno == EWOULDBLOCK)) continue;
+            Vnm_tprint(2, "APBS server:  accept failed (%s)!\n",
+              strerror(errno));
+            rc = -1;
+            break;
+        }
+
+        snprintf(dir, VMAX_ARGLEN, "%s/%d", spool, ++nreq);
+        if (mkdir(dir, 0700) != 0) {
+            serverError(conn, "Can't create a request directory!");
+            close(conn);
+            continue;
+        }
+
+        /* The child reads, runs and answers the request */
+        Vnm_flush(1);
+        Vnm_flush(2);
+        fflush(VNULL);
+        pid = fork();
+        if (pid == 0) {
+            close(lsock);
+            Vmem_free(VNULL, njobs, sizeof(ServerJob), (void **)&jobs);
+            return serverRequest(conn, dir, VMAX2(nthreads/(running+1), 1),
+              input_path);
+        }
+        if (pid < 0) {
+            serverError(conn, "Can't start a job for the request!");
+            serverClean(dir);
+        } else {
+            jobs[running].pid = pid;
+            strcpy(jobs[running].dir, dir);
+            running++;
+        }
+        close(conn);
+
+    }
+
+    Vnm_tprint(1, "Shutting down the server; waiting for %d job(s)...\n",
+      running);
+    while (running > 0) serverReap(jobs, &running, 1);
+    Vmem_free(VNULL, njobs, sizeof(ServerJob), (void **)&jobs);
+    close(lsock);
+    unlink(path);
+    serverClean(spool);
+    setInputCache(0, VNULL);
+#ifdef _OPENMP
+    omp_set_num_threads(nthreads);
+#endif
+
+    return rc;
+
+}
+
+VPUBLIC int finishInput(int rc) {
+
+    char buf[VMAX_ARGLEN];
+    struct dirent *ent;
+    struct stat st;
+    DIR *d;
+    int i, skip;
+
+    if (serverConn < 0) return rc;
+
+    /* The console output first, then everything else the input wrote */
+    fflush(VNULL);
+    serverSend(serverConn, "OUTPUT", VNULL, SERVER_LOG);
+    d = opendir(".");
+    if (d != VNULL) {
+        while ((ent = readdir(d)) != VNULL) {
+            if ((ent->d_name[0] == '.') ||
+              (strcmp(ent->d_name, SERVER_INPUT) == 0) ||
+              (strcmp(ent->d_name, SERVER_LOG) == 0) ||
+              (strcmp(ent->d_name, "io.mc") == 0)) continue;
+            skip = 0;
+            for (i=0; i<serverNum; i++) {
+                if (strcmp(ent->d_name, serverNames[i]) == 0) skip = 1;
+            }
+            if (skip || (stat(ent->d_name, &st) != 0) ||
+              !S_ISREG(st.st_mode)) continue;
+            serverSend(serverConn, "FILE", ent->d_name, ent->d_name);
+        }
+        closedir(d);
+    }
+    snprintf(buf, VMAX_ARGLEN, "STATUS %d\n", rc);
+    serverWrite(serverConn, buf, strlen(buf));
+    close(serverConn);
+
+    if (chdir("/") == 0) serverClean(serverDir);
+    _exit(rc);
+
+}
+
+#else /* if !defined(APBS_SERVER) */
+
+VPUBLIC int serveInputs(const char *path, int njobs, int ncache,
+  char **input_path) {
+
+    Vnm_tprint(2, "This build of APBS can't run as a server!\n");
+    return -1;
+
+}
+
+VPUBLIC int finishInput(int rc) { return rc; }
+
+#endif /* if defined(APBS_SERVER) */
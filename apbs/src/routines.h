@@ -141,6 +141,53 @@ VEXTERNC int loadMolecules(
  * @param  alist  List of atom list objects */
 VEXTERNC void killMolecules(NOsh *nosh, Valist *alist[NOSH_MAXMOL]);
 
+/**
+ * @brief  Keep molecules between inputs as binary snapshots
+ * @ingroup  Frontend
+ * @note  While the cache is on, loadMolecules saves each molecule it reads
+ *        from a file outside the scratch directory with Valist_writeBinary
+ *        and later maps the snapshot instead of reading the same unchanged
+ *        file with the same parameters again.  Files are identified by
+ *        their real path, inode, size and modification time.  Snapshots
+ *        live in the "cache" subdirectory of the scratch directory and are
+ *        shared by every process that uses it.
+ * @param  nmax  Number of snapshots kept (least recently used go first); 0
+ *               turns the cache off
+ * @param  scratch  Directory whose files are never cached and that holds
+ *                  the snapshots, or VNULL to turn the cache off */
+VEXTERNC void setInputCache(int nmax, const char *scratch);
+
+/**
+ * @brief  Serve APBS input files over a local Unix-domain socket
+ * @ingroup  Frontend
+ * @note  The server only accepts connections and forks a child for
+ *        each; the child reads the request into a private directory and
+ *        forks again to run it.  That grandchild returns from this
+ *        function with the input path set, runs the input like any other
+ *        (loading molecules through the input cache) and hands its exit
+ *        code to finishInput, which sends the reply; if it dies first, the
+ *        child replies with its console output.  The server returns when
+ *        it receives SIGINT or SIGTERM.
+ * @param  path  Path of the socket to create
+ * @param  njobs  Maximum number of inputs run at once (0 for one per core)
+ * @param  ncache  Number of molecule snapshots kept (see setInputCache)
+ * @param  input_path  Set to the input file in the request child
+ * @returns  1 in a request child, 0 when the server was shut down, -1 on
+ *           error */
+VEXTERNC int serveInputs(const char *path, int njobs, int ncache,
+                         char **input_path);
+
+/**
+ * @brief  Finish the input run by this process
+ * @ingroup  Frontend
+ * @note  In a request process of serveInputs this sends the console output,
+ *        the files written by the input and the exit code to the client,
+ *        removes the request directory and exits; otherwise it just
+ *        returns the exit code.
+ * @param  rc  Exit code of the run
+ * @returns  rc */
+VEXTERNC int finishInput(int rc);
+
 /**
  * @brief  Load the dielectric maps given in NOsh into grid objects
  * @ingroup  Frontend
@@ -404,6 +451,39 @@ VEXTERNC int writedataXML(NOsh *nosh, Vcom *com, const char *fname,
  * @return  1 if successful, 0 otherwise */
 VEXTERNC int writedataMG(int rank, NOsh *nosh, PBEparm *pbeparm, Vpmg *pmg);
 
+/**
+ * @brief  Write out observables from MG calculation through a background
+ *         writer
+ * @ingroup  Frontend
+ * @note  Each requested array is filled into pmg->rwork and handed to the
+ *        writer, which snapshots it; the files may still be incomplete when
+ *        this returns, until Vwriter_flush is called.
+ * @param  rank  Processor rank (if parallel calculation)
+ * @param  nosh  Parameters from input file
+ * @param  pbeparm  Generic PBE parameters
+ * @param pmg  MG object
+ * @param writer  Background writer, or VNULL to write synchronously
+ * @return  1 if successful, 0 otherwise */
+VEXTERNC int writedataMGAsync(int rank, NOsh *nosh, PBEparm *pbeparm,
+                              Vpmg *pmg, Vwriter *writer);
+
+/**
+ * @brief  Write out the finest levels of the partitions of a threaded
+ *         parallel focusing calculation as single maps
+ * @ingroup  Frontend
+ * @note  The points each partition owns are blended by its partition weights
+ *        (Vpmg::pvec) into one map of the global fine grid, written without
+ *        the -PE suffix.  Atom data (flat format) is written per partition.
+ * @param  rank  Processor rank (if parallel calculation)
+ * @param  nosh  Parameters from input file
+ * @param  pbeparm  Generic PBE parameters
+ * @param  npart  Number of partitions
+ * @param  pmg  Finest MG object of each partition
+ * @param  writer  Background writer, or VNULL to write synchronously
+ * @return  1 if successful, 0 otherwise */
+VEXTERNC int writedataMGPart(int rank, NOsh *nosh, PBEparm *pbeparm,
+                             int npart, Vpmg *pmg[], Vwriter *writer);
+
 /**
  * @brief  Write out operator matrix from MG calculation to file
  * @ingroup  Frontend
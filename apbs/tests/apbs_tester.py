@@ -7,6 +7,8 @@ Provides utility for testing apbs against examples and known results
 import sys
 import os
 import re
+import time
+import socket
 import datetime
 import subprocess
 import operator
@@ -53,9 +55,46 @@ def test_binary(binary_name):
 
 
 
-def process_serial(binary, input_file):
+def server_request(server_socket, input_file):
     """
-    Runs the apbs binary on a given input file
+    Sends an input file, and the files in its directory that it names, to
+    an apbs server and returns the console output of the run
+    """
+
+    with open(input_file, 'rb') as temp:
+        input_data = temp.read()
+    file_names = sorted(set(name for name in input_data.decode().split()
+                            if '/' not in name and os.path.isfile(name)))
+
+    client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    client.connect(server_socket)
+    for file_name in file_names:
+        with open(file_name, 'rb') as temp:
+            file_data = temp.read()
+        client.sendall(b'FILE %s %d\n' % (file_name.encode(), len(file_data)) + file_data)
+    client.sendall(b'INPUT %d\n' % len(input_data) + input_data)
+
+    # The reply is the console output and the files written by the run,
+    # followed by the exit status
+    output = b''
+    reply = client.makefile('rb')
+    while True:
+        fields = reply.readline().split()
+        if not fields or fields[0] == b'STATUS':
+            break
+        data = reply.read(int(fields[-1]))
+        if fields[0] == b'OUTPUT':
+            output += data
+    reply.close()
+    client.close()
+
+    return str(output, 'utf-8')
+
+
+def process_serial(binary, input_file, options=None, server_socket=None):
+    """
+    Runs the apbs binary on a given input file, or sends the input file to
+    an apbs server if a server socket is given
     """
 
     # First extract the name of the input file's base name
@@ -68,7 +107,7 @@ def process_serial(binary, input_file):
     output_file = open(output_name, 'w')
 
     # Construct the system command and make the call
-    command = [binary, input_file]
+    command = [binary] + (options.split() if options else []) + [input_file]
     print("BINARY: %s" % binary)
     print("INPUT:  %s" % input_file)
     #proc = subprocess.Popen(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
@@ -76,11 +115,18 @@ def process_serial(binary, input_file):
     #    sys.stdout.write(line)
     #    output_file.write(line)
     #proc.wait()
-    with subprocess.Popen(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT) as proc:
-        line = str(proc.stdout.read(), 'utf-8')
-        # print(line)
+    if server_socket:
+        print("SERVER: %s" % server_socket)
+        line = server_request(server_socket, input_file)
         sys.stdout.write(line)
         output_file.write(line)
+    else:
+        with subprocess.Popen(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT) as proc:
+            line = str(proc.stdout.read(), 'utf-8')
+            # print(line)
+            sys.stdout.write(line)
+            output_file.write(line)
+    output_file.close()
 
     # Look for the results in the output file
     output_file = open(output_name, 'r')
@@ -99,7 +145,7 @@ def process_serial(binary, input_file):
     return output_results
 
 
-def process_parallel(binary, input_file, procs, logger):
+def process_parallel(binary, input_file, procs, logger, options=None, server_socket=None):
     """
     Performs parallel apbs runs of the input file
     """
@@ -115,7 +161,7 @@ def process_parallel(binary, input_file, procs, logger):
 
         # Process each paralle input file and capture the results from each
         proc_input_file = '%s-PE%d.in' % (base_name, proc)
-        proc_results = process_serial(binary, proc_input_file)
+        proc_results = process_serial(binary, proc_input_file, options, server_socket)
 
         # Log the results from each parallel run
         logger.message("Processor %d results:\n" % proc)
@@ -133,7 +179,7 @@ def process_parallel(binary, input_file, procs, logger):
     return results
 
 
-def run_test(binary, test_files, test_name, test_directory, setup, logger, ocd):
+def run_test(binary, test_files, test_name, test_directory, setup, logger, ocd, options=None):
     """
     Runs a given test from the test cases file
     """
@@ -142,6 +188,8 @@ def run_test(binary, test_files, test_name, test_directory, setup, logger, ocd):
     logger.log("Test Timestamp: %s\n" % str(datetime.datetime.now()))
     logger.log("Test Name:      %s\n" % test_name)
     logger.log("Test Directory: %s\n" % test_directory)
+    if options:
+        logger.log("Test Options:   %s\n" % options)
 
     # The net time is initially zero
     net_time = datetime.timedelta(0)
@@ -149,9 +197,29 @@ def run_test(binary, test_files, test_name, test_directory, setup, logger, ocd):
     # Change the current working directory to the test directory
     os.chdir(test_directory)
 
-    # Run the setup, if any
+    # Run the setup, if any, with the directory of the apbs binary (where
+    # the tools are built as well) first in the path
     if setup:
-        subprocess.call(setup.split())
+        setup_env = dict(os.environ)
+        if os.path.dirname(binary):
+            setup_env['PATH'] = os.path.dirname(binary) + os.pathsep + setup_env.get('PATH', '')
+        status = subprocess.call(setup.split(), env=setup_env)
+        if status != 0:
+            logger.message("*** Setup %s FAILED ***\n" % setup)
+            logger.log("FAILED setup %s (exit status %d)\n" % (setup, status))
+
+    # If the options start a server, the test cases are sent to it instead of
+    # running apbs on each of them
+    server = None
+    server_socket = None
+    match = re.search(r'--server=(\S+)', options or '')
+    if match:
+        server_socket = match.group(1)
+        if os.path.exists(server_socket):
+            os.remove(server_socket)
+        server = subprocess.Popen([binary] + options.split(), stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        while not os.path.exists(server_socket) and server.poll() is None:
+            time.sleep(0.1)
 
     for (base_name, expected_results) in test_files:
 
@@ -175,16 +243,20 @@ def run_test(binary, test_files, test_name, test_directory, setup, logger, ocd):
 
             computed_results = None
 
-            # Determine if this is a parallel run
-            match = re.search(r'\s*pdime((\s+\d+)+)', open(input_file, 'r').read())
+            # Determine if this is a parallel run; threaded parallel
+            # calculations run all of their partitions in one apbs run
+            input_text = open(input_file, 'r').read()
+            match = re.search(r'\s*pdime((\s+\d+)+)', input_text)
+            if re.search(r'^\s*threaded\s*$', input_text, re.MULTILINE):
+                match = None
 
             # If it is parallel, get the number of procs and do a parallel run
             if match:
                 procs = reduce(operator.mul, [int(p) for p in match.group(1).split()])
-                computed_results = process_parallel(binary, input_file, procs, logger)
+                computed_results = process_parallel(binary, input_file, procs, logger, options, server_socket)
             # Otherwise, just do a serial run
             else:
-                computed_results = process_serial(binary, input_file)
+                computed_results = process_serial(binary, input_file, options, server_socket)
 
             # Split the expected results into a list of text values
             print("EXPECTED COMPUTED: %i" % (len(computed_results)))
@@ -218,6 +290,11 @@ def run_test(binary, test_files, test_name, test_directory, setup, logger, ocd):
         logger.message("Elapsed time: %f seconds\n" % stopwatch)
         logger.message('-' * 80 + "\n")
 
+    # The server finishes running requests and cleans up when it is terminated
+    if server:
+        server.terminate()
+        server.wait()
+
     stopwatch = net_time.seconds + net_time.microseconds / 1e6
 
     # Log the elapsed time for all tests that were run
@@ -331,8 +408,16 @@ def main():
         except NoOptionError:
             pass
 
+        # Check if there are command line options for apbs.
+        test_options = None
+        try:
+            test_options = config.get(test_name, 'options')
+            config.remove_option(test_name, 'options')
+        except NoOptionError:
+            pass
+
         # Run the test!
-        run_test(binary, config.items(test_name), test_name, test_directory, test_setup, logger, options.ocd)
+        run_test(binary, config.items(test_name), test_name, test_directory, test_setup, logger, options.ocd, test_options)
 
     return 0
 
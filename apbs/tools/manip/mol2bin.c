@@ -0,0 +1,108 @@
+/**
+ *  @file    mol2bin.c
+ *  @brief   Small program to write binary molecule files
+ *  @version $Id$
+ */
+
+#include "apbs.h"
+
+int main(int argc, char **argv) {
+
+    /* OBJECTS */
+    Valist *alist = VNULL;
+    Vparam *param = VNULL;
+
+    Vrc_Codes rc;
+    int i;
+
+    /* SYSTEM PARAMETERS */
+    char *format, *inpath, *outpath;
+    char *parmpath = VNULL;
+
+    char *usage = "\n\n\
+This program reads a molecule and writes it as a binary molecule file\n\
+that APBS maps directly into memory with READ mol bin.  The binary file\n\
+stores the atoms exactly as this build of APBS lays them out in memory,\n\
+so it must be regenerated after upgrading or rebuilding APBS with\n\
+different options.\n\n\
+Usage: mol2bin [-p <parm>] <format> <input> <output>\n\n\
+   where <format> is pqr, pdb or xml, <input> is the path to the\n\
+   molecule in that format and <output> is the path to the binary\n\
+   molecule file to write.  The following option is supported:\n\
+       -p      parameter file (flat format, or XML if the name ends\n\
+               in .xml); required for pdb and replaces PQR charges\n\
+               and radii\n\n";
+
+    Vio_start();
+
+    if ((argc != 4) && (argc != 6)) {
+        Vnm_print(2, "\n*** Syntax error: got %d arguments, expected 4 or 6.\n",
+           argc);
+        Vnm_print(2, "%s", usage);
+        exit(666);
+    };
+    i = 1;
+    if (argc == 6) {
+        if (strcmp("-p", argv[1]) != 0) {
+            Vnm_print(2, "\n*** Syntax error: unknown option %s.\n", argv[1]);
+            Vnm_print(2, "%s", usage);
+            exit(666);
+        }
+        parmpath = argv[2];
+        i = 3;
+    }
+    format = argv[i];
+    inpath = argv[i+1];
+    outpath = argv[i+2];
+
+    if (parmpath != VNULL) {
+        Vnm_print(1, "Reading parameters from %s.\n", parmpath);
+        param = Vparam_ctor();
+        i = (int)strlen(parmpath);
+        if ((i > 4) && (Vstring_strcasecmp(parmpath+i-4, ".xml") == 0)) {
+            rc = (Vrc_Codes)Vparam_readXMLFile(param, "FILE", "ASC", VNULL,
+              parmpath);
+        } else {
+            rc = (Vrc_Codes)Vparam_readFlatFile(param, "FILE", "ASC", VNULL,
+              parmpath);
+        }
+        if (rc != VRC_SUCCESS) {
+            Vnm_print(2, "Error reading parameter file %s!\n", parmpath);
+            return 1;
+        }
+    }
+
+    Vnm_print(1, "Setting up atom list from %s.\n", inpath);
+    alist = Valist_ctor();
+    if (Vstring_strcasecmp(format, "pqr") == 0) {
+        rc = Valist_readPQRFile(alist, param, inpath);
+    } else if (Vstring_strcasecmp(format, "pdb") == 0) {
+        if (param == VNULL) {
+            Vnm_print(2, "Can't read PDB without a parameter file (-p)!\n");
+            return 1;
+        }
+        rc = Valist_readPDBFile(alist, param, inpath);
+    } else if (Vstring_strcasecmp(format, "xml") == 0) {
+        rc = Valist_readXMLFile(alist, param, inpath);
+    } else {
+        Vnm_print(2, "\n*** Unknown molecule format %s.\n", format);
+        Vnm_print(2, "%s", usage);
+        exit(666);
+    }
+    if (rc != VRC_SUCCESS) {
+        Vnm_print(2, "Error reading molecule from %s!\n", inpath);
+        return 1;
+    }
+    Vnm_print(1, "Read %d atoms\n", Valist_getNumberAtoms(alist));
+
+    Vnm_print(1, "Writing binary molecule file %s.\n", outpath);
+    if (Valist_writeBinary(alist, outpath) != VRC_SUCCESS) {
+        Vnm_print(2, "Error writing %s!\n", outpath);
+        return 1;
+    }
+
+    Valist_dtor(&alist);
+    if (param != VNULL) Vparam_dtor(&param);
+
+    return 0;
+}
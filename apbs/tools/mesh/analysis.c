@@ -76,6 +76,155 @@ int readGrid(Vgrid **grid, char *path, Vdata_Format format) {
     return 1;
 }
 
+/**
+ * @brief  Sums and extrema accumulated by streamMetrics
+ */
+typedef struct AnalysisSums {
+    double norm_L1;  /**< Sum of |s*m| */
+    double norm_L2;  /**< Sum of (s*m)^2 */
+    double snorm_H1;  /**< Sum of (m*|grad s|^2)^2 */
+    size_t nsval;  /**< Number of points in the L1/L2 sums */
+    size_t ngval;  /**< Number of points in the H1 sum */
+    double ext[4];  /**< Max scalar, min scalar, max and min |grad s|^2 */
+    size_t extAt[4];  /**< File-order index of each extremum */
+} AnalysisSums;
+
+/** @brief  Marks an extremum that was never set */
+#define ANALYSIS_NONE ((size_t)-1)
+
+/**
+ * @brief  Fold a candidate extremum into a running one.  Ties go to the
+ *         earlier point so the result does not depend on the thread count.
+ * @param  ext  Running extremum
+ * @param  extAt  Index of running extremum (ANALYSIS_NONE if unset)
+ * @param  val  Candidate value
+ * @param  at  Candidate index
+ * @param  max  1 for a maximum, 0 for a minimum */
+void foldExtremum(double *ext, size_t *extAt, double val, size_t at,
+        int max) {
+    if ((*extAt == ANALYSIS_NONE) ||
+            (max && (val > *ext)) || (!max && (val < *ext)) ||
+            ((val == *ext) && (at < *extAt))) {
+        *ext = val;
+        *extAt = at;
+    }
+}
+
+/**
+ * @brief  Compute the metrics in a single pass over the files, holding only
+ *         three x-planes of the scalar data (and one of the mask).  Grid
+ *         nodes are addressed directly, so the values and gradients are the
+ *         ones Vgrid_value and Vgrid_gradient return there.
+ * @param  scalar  Scalar data set, positioned at its first plane
+ * @param  mask  Mask on the same grid, or VNULL
+ * @param  sums  Set to the accumulated sums and extrema
+ * @return 1 if successful, 0 otherwise */
+int streamMetrics(Vslab *scalar, Vslab *mask, AnalysisSums *sums) {
+
+    int i, j, k, l, nx, ny, nz, onGridV;
+    size_t n, u, at, nsval, ngval;
+    double sval, mval, val, gval2, gval[3];
+    double norm_L1, norm_L2, snorm_H1;
+    double *win, *mplane, *cur, *left, *right;
+    double ext[4];
+    size_t extAt[4];
+
+    nx = scalar->nx; ny = scalar->ny; nz = scalar->nz;
+    n = (size_t)ny*nz;
+
+    sums->norm_L1 = 0; sums->norm_L2 = 0; sums->snorm_H1 = 0;
+    sums->nsval = 0; sums->ngval = 0;
+    for (l=0; l<4; l++) {
+        sums->ext[l] = 0;
+        sums->extAt[l] = ANALYSIS_NONE;
+    }
+
+    win = (double *)Vmem_malloc(VNULL, 3*n, sizeof(double));
+    mplane = VNULL;
+    if (mask != VNULL) mplane = (double *)Vmem_malloc(VNULL, n, sizeof(double));
+
+    for (i=0; i<nx; i++) {
+        if (!Vslab_readWindow(scalar, i, win, &left, &cur, &right)) goto VERROR1;
+        if ((mask != VNULL) && !Vslab_read(mask, 1, mplane)) goto VERROR1;
+
+        #pragma omp parallel private(j, k, l, u, at, onGridV, sval, mval, val, gval2, gval, norm_L1, norm_L2, snorm_H1, nsval, ngval, ext, extAt)
+        {
+            norm_L1 = 0; norm_L2 = 0; snorm_H1 = 0; nsval = 0; ngval = 0;
+            for (l=0; l<4; l++) {
+                ext[l] = 0;
+                extAt[l] = ANALYSIS_NONE;
+            }
+            #pragma omp for schedule(static)
+            for (j=0; j<ny; j++) {
+                for (k=0; k<nz; k++) {
+                    u = (size_t)j*nz + k;
+                    at = (size_t)i*n + u;
+                    sval = cur[u];
+                    mval = (mplane != VNULL) ? mplane[u] : 1.0;
+                    onGridV = Vslab_gradient(scalar, left, cur, right, j, k,
+                            gval);
+                    if (onGridV) {
+                        gval2 = VSQR(gval[0]) + VSQR(gval[1]) + VSQR(gval[2]);
+                    } else gval2 = 0.0;
+
+                    /* Max/min */
+                    if (mval > 0) {
+                        foldExtremum(&(ext[0]), &(extAt[0]), sval, at, 1);
+                        foldExtremum(&(ext[1]), &(extAt[1]), sval, at, 0);
+                        foldExtremum(&(ext[2]), &(extAt[2]), gval2, at, 1);
+                        foldExtremum(&(ext[3]), &(extAt[3]), gval2, at, 0);
+                    }
+
+                    val = sval*mval;
+                    norm_L2 += VSQR(val);
+                    norm_L1 += VABS(val);
+                    nsval++;
+
+                    if (onGridV) {
+                        val = mval*gval2;
+                        snorm_H1 += VSQR(val);
+                        ngval++;
+                    }
+                }
+            }
+            #pragma omp critical
+            {
+                sums->norm_L1 += norm_L1;
+                sums->norm_L2 += norm_L2;
+                sums->snorm_H1 += snorm_H1;
+                sums->nsval += nsval;
+                sums->ngval += ngval;
+                for (l=0; l<4; l++) {
+                    if (extAt[l] != ANALYSIS_NONE) {
+                        foldExtremum(&(sums->ext[l]), &(sums->extAt[l]),
+                                ext[l], extAt[l], !(l%2));
+                    }
+                }
+            }
+        }
+    }
+
+    Vmem_free(VNULL, 3*n, sizeof(double), (void **)&win);
+    if (mplane != VNULL) Vmem_free(VNULL, n, sizeof(double), (void **)&mplane);
+    return 1;
+
+VERROR1:
+    Vmem_free(VNULL, 3*n, sizeof(double), (void **)&win);
+    if (mplane != VNULL) Vmem_free(VNULL, n, sizeof(double), (void **)&mplane);
+    return 0;
+}
+
+/**
+ * @brief  Coordinates of a grid point from its file-order index
+ * @param  slab  Grid
+ * @param  at  Index of the point (x slowest, z fastest)
+ * @param  pt  Set to the coordinates of the point */
+void indexPoint(Vslab *slab, size_t at, double pt[3]) {
+    pt[0] = (at/((size_t)slab->ny*slab->nz))*slab->hx + slab->xmin;
+    pt[1] = ((at/slab->nz)%slab->ny)*slab->hy + slab->ymin;
+    pt[2] = (at%slab->nz)*slab->hzed + slab->zmin;
+}
+
 int main(int argc, char **argv) {
 
     /* *************** VARIABLES ******************* */
@@ -88,6 +237,10 @@ int main(int argc, char **argv) {
     double val, sval, mval, pt[3];
     double gval2, gval[3];
     Vgrid *scalar, *mask;
+    Vslab *sslab = VNULL;
+    Vslab *mslab = VNULL;
+    AnalysisSums sums;
+    int stream;
     char scalarPath[VMAX_ARGLEN];
     int gotScalar = 0;
     char maskPath[VMAX_ARGLEN];
@@ -167,104 +320,155 @@ int main(int argc, char **argv) {
         Vnm_print(1, "Mask:  %s\n", maskPath);
     }
 
-    /* Read scalar set */
-    Vnm_print(1, "Reading scalar data set from %s...\n", scalarPath);
-    if (!readGrid(&scalar, scalarPath, format)) {
+    /* Open the data sets for streaming.  A mask on a different grid has to
+     * be interpolated, which needs both grids in memory. */
+    sslab = Vslab_ctorRead(scalarPath, format);
+    if (sslab == VNULL) {
         Vnm_print(2, "Error reading scalar data set!\n");
         return 2;
     }
-    Vnm_print(1, "Read %d x %d x %d grid.\n",
-            scalar->nx, scalar->ny, scalar->nz);
-
-    /* Read mask */
+    stream = 1;
     if (gotMask) {
-        Vnm_print(1, "Reading mask data set from %s...\n", maskPath);
-        if (!readGrid(&mask, maskPath, format)) {
+        mslab = Vslab_ctorRead(maskPath, format);
+        if (mslab == VNULL) {
             Vnm_print(2, "Error reading mask data set!\n");
             return 2;
         }
-        Vnm_print(1, "Read %d x %d x %d grid.\n",
-                mask->nx, mask->ny, mask->nz);
+        if (!Vslab_congruent(sslab, mslab)) {
+            Vnm_print(1, "Mask grid differs from scalar grid; interpolating.\n");
+            stream = 0;
+        }
     }
 
-    /* Calculate relative L2 norm of difference */
-    Vnm_print(1, "Calculating metrics...\n");
-    nx = scalar->nx; ny = scalar->ny; nz = scalar->nz;
-    hx = scalar->hx; hy = scalar->hy; hzed = scalar->hzed;
-    dvol = (hx*hy*hzed);
-    xmin = scalar->xmin; ymin = scalar->ymin; zmin = scalar->zmin;
-    norm_L1 = 0; norm_L2 = 0; snorm_H1 = 0; norm_H1 = 0;
-    haveMaxS = 0; haveMinS = 0; haveMaxG2 = 0; haveMinG2 = 0;
-    svol = 0; gvol = 0;
-    for (i=0; i<nx; i++) {
-        pt[0] = i*hx + xmin;
-        for (j=0; j<ny; j++) {
-            pt[1] = j*hy + ymin;
-            for (k=0; k<nz; k++) {
-
-                /* Grid value */
-                pt[2] = k*hzed + zmin;
-                onGridS = Vgrid_value(scalar, pt, &sval);
-                onGridV = Vgrid_gradient(scalar, pt, gval);
-                if (onGridV) {
-                    gval2 = 0.0;
-                    gval2 = VSQR(gval[0]) + VSQR(gval[1]) + VSQR(gval[2]);
-                } else gval2 = 0.0;
-                if (gotMask) onGridS = Vgrid_value(mask, pt, &mval);
-                else mval = 1.0;
-
-                /* Max/min */
-                if (mval > 0) {
-                    if ((!haveMaxS) || (sval > maxS) ) {
-                        haveMaxS = 1;
-                        maxS = sval;
-                        maxSpt[0] = pt[0];
-                        maxSpt[1] = pt[1];
-                        maxSpt[2] = pt[2];
-                    }
-                    if ((!haveMinS) || (sval < minS) ) {
-                        haveMinS = 1;
-                        minS = sval;
-                        minSpt[0] = pt[0];
-                        minSpt[1] = pt[1];
-                        minSpt[2] = pt[2];
-                    }
-                    if ((!haveMaxG2) || (gval2 > maxG2) ) {
-                        haveMaxG2 = 1;
-                        maxG2 = gval2;
-                        maxG2pt[0] = pt[0];
-                        maxG2pt[1] = pt[1];
-                        maxG2pt[2] = pt[2];
-                    }
-                    if ((!haveMinG2) || (gval2 < minG2) ) {
-                        haveMinG2 = 1;
-                        minG2 = gval2;
-                        minG2pt[0] = pt[0];
-                        minG2pt[1] = pt[1];
-                        minG2pt[2] = pt[2];
+    if (stream) {
+        /* Stream both data sets plane by plane */
+        Vnm_print(1, "Streaming %d x %d x %d grid from %s...\n",
+                sslab->nx, sslab->ny, sslab->nz, scalarPath);
+        Vnm_print(1, "Calculating metrics...\n");
+        if (!streamMetrics(sslab, mslab, &sums)) {
+            Vnm_print(2, "Error reading scalar or mask data set!\n");
+            return 2;
+        }
+        dvol = (sslab->hx*sslab->hy*sslab->hzed);
+        norm_L1 = sums.norm_L1;
+        norm_L2 = sums.norm_L2;
+        snorm_H1 = sums.snorm_H1;
+        svol = sums.nsval*dvol;
+        gvol = sums.ngval*dvol;
+        maxS = sums.ext[0]; minS = sums.ext[1];
+        maxG2 = sums.ext[2]; minG2 = sums.ext[3];
+        if (sums.extAt[0] != ANALYSIS_NONE) {
+            indexPoint(sslab, sums.extAt[0], maxSpt);
+            indexPoint(sslab, sums.extAt[1], minSpt);
+            indexPoint(sslab, sums.extAt[2], maxG2pt);
+            indexPoint(sslab, sums.extAt[3], minG2pt);
+        }
+        Vslab_dtor(&sslab);
+        Vslab_dtor(&mslab);
+    } else {
+        Vslab_dtor(&sslab);
+        Vslab_dtor(&mslab);
+
+        /* Read scalar set */
+        Vnm_print(1, "Reading scalar data set from %s...\n", scalarPath);
+        if (!readGrid(&scalar, scalarPath, format)) {
+            Vnm_print(2, "Error reading scalar data set!\n");
+            return 2;
+        }
+        Vnm_print(1, "Read %d x %d x %d grid.\n",
+                scalar->nx, scalar->ny, scalar->nz);
+
+        /* Read mask */
+        if (gotMask) {
+            Vnm_print(1, "Reading mask data set from %s...\n", maskPath);
+            if (!readGrid(&mask, maskPath, format)) {
+                Vnm_print(2, "Error reading mask data set!\n");
+                return 2;
+            }
+            Vnm_print(1, "Read %d x %d x %d grid.\n",
+                    mask->nx, mask->ny, mask->nz);
+        }
+
+        /* Calculate relative L2 norm of difference */
+        Vnm_print(1, "Calculating metrics...\n");
+        nx = scalar->nx; ny = scalar->ny; nz = scalar->nz;
+        hx = scalar->hx; hy = scalar->hy; hzed = scalar->hzed;
+        dvol = (hx*hy*hzed);
+        xmin = scalar->xmin; ymin = scalar->ymin; zmin = scalar->zmin;
+        norm_L1 = 0; norm_L2 = 0; snorm_H1 = 0; norm_H1 = 0;
+        haveMaxS = 0; haveMinS = 0; haveMaxG2 = 0; haveMinG2 = 0;
+        svol = 0; gvol = 0;
+        for (i=0; i<nx; i++) {
+            pt[0] = i*hx + xmin;
+            for (j=0; j<ny; j++) {
+                pt[1] = j*hy + ymin;
+                for (k=0; k<nz; k++) {
+
+                    /* Grid value */
+                    pt[2] = k*hzed + zmin;
+                    onGridS = Vgrid_value(scalar, pt, &sval);
+                    onGridV = Vgrid_gradient(scalar, pt, gval);
+                    if (onGridV) {
+                        gval2 = 0.0;
+                        gval2 = VSQR(gval[0]) + VSQR(gval[1]) + VSQR(gval[2]);
+                    } else gval2 = 0.0;
+                    if (gotMask) onGridS = Vgrid_value(mask, pt, &mval);
+                    else mval = 1.0;
+
+                    /* Max/min */
+                    if (mval > 0) {
+                        if ((!haveMaxS) || (sval > maxS) ) {
+                            haveMaxS = 1;
+                            maxS = sval;
+                            maxSpt[0] = pt[0];
+                            maxSpt[1] = pt[1];
+                            maxSpt[2] = pt[2];
+                        }
+                        if ((!haveMinS) || (sval < minS) ) {
+                            haveMinS = 1;
+                            minS = sval;
+                            minSpt[0] = pt[0];
+                            minSpt[1] = pt[1];
+                            minSpt[2] = pt[2];
+                        }
+                        if ((!haveMaxG2) || (gval2 > maxG2) ) {
+                            haveMaxG2 = 1;
+                            maxG2 = gval2;
+                            maxG2pt[0] = pt[0];
+                            maxG2pt[1] = pt[1];
+                            maxG2pt[2] = pt[2];
+                        }
+                        if ((!haveMinG2) || (gval2 < minG2) ) {
+                            haveMinG2 = 1;
+                            minG2 = gval2;
+                            minG2pt[0] = pt[0];
+                            minG2pt[1] = pt[1];
+                            minG2pt[2] = pt[2];
+                        }
                     }
-                }
 
-                if (onGridS) {
-                    val = sval*mval;
+                    if (onGridS) {
+                        val = sval*mval;
 
-                    /* L2 */
-                    norm_L2 += VSQR(val);
-                    /* L1 */
-                    norm_L1 += VABS(val);
-                    /* Volume */
-                    svol += dvol;
+                        /* L2 */
+                        norm_L2 += VSQR(val);
+                        /* L1 */
+                        norm_L1 += VABS(val);
+                        /* Volume */
+                        svol += dvol;
 
-                }
+                    }
 
-                if (onGridV && onGridS) {
-                    val = mval*(VSQR(gval[0]) + VSQR(gval[1]) + VSQR(gval[2]));
-                    snorm_H1 += VSQR(val);
-                    gvol += dvol;
+                    if (onGridV && onGridS) {
+                        val = mval*(VSQR(gval[0]) + VSQR(gval[1]) + VSQR(gval[2]));
+                        snorm_H1 += VSQR(val);
+                        gvol += dvol;
+                    }
                 }
             }
         }
     }
+
     norm_Linf = VMAX2(VABS(maxS), VABS(minS));
     norm_L2 = VSQRT(norm_L2*dvol);
     norm_L1 = (norm_L1*dvol);
@@ -43,11 +43,13 @@ int main(int argc, char **argv) {
     double scalar[DXM_MAXOP+1];
     int obType[DXM_MAXOP+1];
     int iop, numop;
-    int i, nx, ny, nz, len;
+    char tmpPath[VMAX_BUFSIZE+4];
+    int i, ix, nx, ny, nz, len;
     Dxmath_Opcode op[DXM_MAXOP];
     Vio *sock = VNULL;
-    Vgrid *grid1 = VNULL;
-    Vgrid *grid2 = VNULL;
+    Vslab *slab[DXM_MAXOP+1];
+    Vslab *out = VNULL;
+    double *result, *operand;
 
     char *header = "\n\n\
     ----------------------------------------------------------------------\n\
@@ -104,6 +106,8 @@ int main(int argc, char **argv) {
     Vio_setWhiteChars(sock, MCwhiteChars);
     Vio_setCommChars(sock, MCcommChars);
 
+    for (iop=0; iop<=DXM_MAXOP; iop++) slab[iop] = VNULL;
+
     /* *************** PARSE INPUT FILE ******************* */
     /* After reading in the first arg, we should alternate between objects and
      * operations, starting with the objects.  For each opject, we assign a
@@ -203,140 +207,116 @@ int main(int argc, char **argv) {
         }
     }
 
-    /* *************** PARSE INPUT FILE ******************* */
-    Vnm_print(1, "main:  Reading grid from %s...\n", gridPath[0]);
-    grid1 = Vgrid_ctor(0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, VNULL);
-    if (obType[0] == DXM_ISGRID) {
-        if (!Vgrid_readDX(grid1, "FILE", "ASC", VNULL, gridPath[0])) {
-            Vnm_print(2, "main:  Problem reading OpenDX-format grid from %s\n",
-                      gridPath[0]);
+    /* *************** OPEN GRIDS ******************* */
+    /* Every grid is streamed one x-plane at a time; the result is written as
+     * it is computed, so no grid is ever held in memory */
+    if (obType[0] == DXM_ISSCALAR) {
+        Vnm_print(2, "main:  First argument must be a grid\n");
+        return ERRRC;
+    }
+    if (obType[numop] == DXM_ISSCALAR) {
+        Vnm_print(2, "main:  Last object must be output grid\n");
+        return ERRRC;
+    }
+    for (iop=0; iop<numop; iop++) {
+        if (obType[iop] == DXM_ISSCALAR) continue;
+        Vnm_print(1, "main:  Opening grid %s...\n", gridPath[iop]);
+        slab[iop] = Vslab_ctorRead(gridPath[iop],
+          (obType[iop] == DXM_ISGRIDBIN) ? VDF_DXBIN : VDF_DX);
+        if (slab[iop] == VNULL) {
+            Vnm_print(2, "main:  Problem reading %s-format grid from %s\n",
+              (obType[iop] == DXM_ISGRIDBIN) ? "OpenDX binary" : "OpenDX",
+              gridPath[iop]);
             return ERRRC;
         }
-    } else if (obType[0] == DXM_ISGRIDBIN) {
-        if (!Vgrid_readDXBIN(grid1, "FILE", "ASC", VNULL, gridPath[0])) {
-            Vnm_print(2, "main:  Problem reading OpenDX binary-format grid from %s\n",
-                      gridPath[0]);
+        if (iop == 0) continue;
+        if ((slab[iop]->nx != slab[0]->nx) || (slab[iop]->ny != slab[0]->ny) ||
+          (slab[iop]->nz != slab[0]->nz)) {
+            Vnm_print(2, "main:  Grid dimension mis-match!\n");
+            Vnm_print(2, "main:  Grid 1 is %d x %d x %d\n",
+              slab[0]->nx, slab[0]->ny, slab[0]->nz);
+            Vnm_print(2, "main:  Grid 2 is %d x %d x %d\n",
+              slab[iop]->nx, slab[iop]->ny, slab[iop]->nz);
             return ERRRC;
         }
-    } else {
-            Vnm_print(2, "main:  First argument must be a grid\n");
-            return ERRRC;
     }
 
-    nx = grid1->nx;
-    ny = grid1->ny;
-    nz = grid1->nz;
-    len = nx * ny * nz;
+    nx = slab[0]->nx;
+    ny = slab[0]->ny;
+    nz = slab[0]->nz;
+    len = ny * nz;
 
-    for (iop=0; iop<numop-1; iop++) {
-        if (obType[iop+1] == DXM_ISGRID || obType[iop+1] == DXM_ISGRIDBIN) {
-            Vnm_print(1, "main:  Reading grid from %s...\n", gridPath[iop+1]);
-            grid2 = Vgrid_ctor(0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, VNULL);
+    /* The output may overwrite one of the inputs, so it is written to a
+     * scratch file that replaces it at the end */
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", gridPath[numop]);
+    out = Vslab_ctorWrite(tmpPath,
+      (obType[numop] == DXM_ISGRIDBIN) ? VDF_DXBIN : VDF_DX,
+      nx, ny, nz, slab[0]->xmin, slab[0]->ymin, slab[0]->zmin,
+      slab[0]->hx, slab[0]->hy, slab[0]->hzed, "DXMATH RESULTS");
+    if (out == VNULL) return ERRRC;
 
-            if (obType[iop+1] == DXM_ISGRID) {
-                if (!Vgrid_readDX(grid2, "FILE", "ASC", VNULL, gridPath[iop+1])) {
-                    Vnm_print(2, "main:  Problem reading OpenDX-format grid from %s\n",
-                          gridPath[iop+1]);
-                    return ERRRC;
-                }
-            } else if (obType[iop+1] == DXM_ISGRIDBIN) {
-                if (!Vgrid_readDXBIN(grid2, "FILE", "ASC", VNULL, gridPath[iop+1])) {
-                    Vnm_print(2, "main:  Problem reading OpenDX binary-format grid \
-                          from %s\n",
-                          gridPath[iop+1]);
-                    return ERRRC;
-                }
-            } 
-
-            if ((grid2->nx != nx) || (grid2->ny != ny) || (grid2->nz != nz)) {
-                Vnm_print(2, "main:  Grid dimension mis-match!\n");
-                Vnm_print(2, "main:  Grid 1 is %d x %d x %d\n", nx, ny, nz);
-                Vnm_print(2, "main:  Grid 2 is %d x %d x %d\n",
-                  grid2->nx, grid2->ny, grid2->nz);
+    /* *************** EVALUATE ******************* */
+    Vnm_print(1, "main:  Evaluating %d x %d x %d grid plane by plane...\n",
+      nx, ny, nz);
+    result = (double *)Vmem_malloc(VNULL, len, sizeof(double));
+    operand = (double *)Vmem_malloc(VNULL, len, sizeof(double));
+    for (ix=0; ix<nx; ix++) {
+        if (!Vslab_read(slab[0], 1, result)) {
+            Vnm_print(2, "main:  Problem reading grid from %s\n", gridPath[0]);
+            return ERRRC;
+        }
+        for (iop=0; iop<numop-1; iop++) {
+            if (obType[iop+1] == DXM_ISSCALAR) {
+                #pragma omp parallel for
+                for (i=0; i<len; i++) operand[i] = scalar[iop+1];
+            } else if (!Vslab_read(slab[iop+1], 1, operand)) {
+                Vnm_print(2, "main:  Problem reading grid from %s\n",
+                  gridPath[iop+1]);
                 return ERRRC;
             }
-
             switch (op[iop]) {
                 case DXM_ADD:
-                    Vnm_print(1, "main:  Adding...\n");
-                    for (i=0; i<len; i++)
-                      grid1->data[i] = grid1->data[i] + grid2->data[i];
+                    #pragma omp parallel for
+                    for (i=0; i<len; i++) result[i] = result[i] + operand[i];
                     break;
                 case DXM_MUL:
-                    Vnm_print(1, "main:  Multiplying...\n");
-                    for (i=0; i<len; i++)
-                      grid1->data[i] = grid1->data[i] * grid2->data[i];
+                    #pragma omp parallel for
+                    for (i=0; i<len; i++) result[i] = result[i] * operand[i];
                     break;
                 case DXM_SUB:
-                    Vnm_print(1, "main:  Subtracting...\n");
-                    for (i=0; i<len; i++)
-                      grid1->data[i] = grid1->data[i] - grid2->data[i];
+                    #pragma omp parallel for
+                    for (i=0; i<len; i++) result[i] = result[i] - operand[i];
                     break;
                 case DXM_DIV:
-                    Vnm_print(1, "main:  Dividing...\n");
-                    for (i=0; i<len; i++)
-                      grid1->data[i] = grid1->data[i] / grid2->data[i];
+                    #pragma omp parallel for
+                    for (i=0; i<len; i++) result[i] = result[i] / operand[i];
                     break;
                 case DXM_EXP:
-                    Vnm_print(1, "main:  Applying exponents...\n");
-                    for(i = 0; i < grid2->data[i]; i++) {
-                        grid1->data[i] *= grid1->data[i];
-                    }
+                    #pragma omp parallel for
+                    for (i=0; i<len; i++) result[i] = VPOW(result[i], operand[i]);
                     break;
                 default:
                     Vnm_print(2, "main:  Unexpected operation (%d)!\n",
                       op[iop]);
                     break;
             }
-            Vgrid_dtor(&grid2);
-        } else { /* if (obType[iop+1] == DXM_ISGRID) */
-            Vnm_print(1, "main:  Loading scalar %g...\n", scalar[iop+1]);
-            switch (op[iop]) {
-                case DXM_ADD:
-                    Vnm_print(1, "main:  Adding...\n");
-                    for (i=0; i<len; i++)
-                      grid1->data[i] = grid1->data[i] + scalar[iop+1];
-                    break;
-                case DXM_MUL:
-                    Vnm_print(1, "main:  Multiplying...\n");
-                    for (i=0; i<len; i++)
-                      grid1->data[i] = grid1->data[i] * scalar[iop+1];
-                    break;
-                case DXM_SUB:
-                    Vnm_print(1, "main:  Subtracting...\n");
-                    for (i=0; i<len; i++)
-                      grid1->data[i] = grid1->data[i] - scalar[iop+1];
-                    break;
-                case DXM_DIV:
-                    Vnm_print(1, "main:  Dividing...\n");
-                    for (i=0; i<len; i++)
-                      grid1->data[i] = grid1->data[i] / scalar[iop+1];
-                    break;
-                case DXM_EXP:
-                    Vnm_print(1, "main:  Applying exponents...\n");
-                    for(i = 0; i < scalar[iop+1]; i++) {
-                        grid1->data[i] *= grid1->data[i];
-                    }
-                    break;
-                default:
-                    Vnm_print(2, "main:  Unexpected operation (%d)!\n",
-                      op[iop]);
-                    break;
-            }
-        } /* if (obType[iop+1] == DXM_ISGRID) */
-    } /* for (iop=0; iop<numop-1; iop++) */
+        }
+        if (!Vslab_write(out, 1, result)) {
+            Vnm_print(2, "main:  Problem writing results to %s\n", tmpPath);
+            return ERRRC;
+        }
+    }
+    Vmem_free(VNULL, len, sizeof(double), (void **)&result);
+    Vmem_free(VNULL, len, sizeof(double), (void **)&operand);
+    for (iop=0; iop<numop; iop++) Vslab_dtor(&(slab[iop]));
+    Vslab_dtor(&out);
 
     /* The last operation is the = sign, implying that we write out the grid */
     Vnm_print(1, "main:  Writing results to %s...\n", gridPath[numop]);
-
-    if (obType[numop] == DXM_ISGRID) {
-        Vgrid_writeDX(grid1, "FILE", "ASC", VNULL, gridPath[numop],
-                      "DXMATH RESULTS", VNULL);
-    } else if (obType[numop] == DXM_ISGRIDBIN) {
-        Vgrid_writeDXBIN(grid1, "FILE", "ASC", VNULL, gridPath[numop],
-                         "DXMATH RESULTS", VNULL);
-    } else {
-        Vnm_print(2, "main:  Last object must be output grid\n");
+    remove(gridPath[numop]);
+    if (rename(tmpPath, gridPath[numop]) != 0) {
+        Vnm_print(2, "main:  Problem renaming %s to %s\n", tmpPath,
+          gridPath[numop]);
         return ERRRC;
     }
 
@@ -21,8 +21,30 @@ VPRIVATE int Char_parseARGV(int argc, char **argv,
   double *res1, double *res2, double *res3, 
   double *xmin, double *ymin, double *zmin,
   double *xmax, double *ymax, double *zmax,
-  int *spec, char *outname, char fnams[MAX_INPUT_2][MAX_INPUT_PATH], int *numfnams,
-  Vdata_Format *formatin, Vdata_Format *formatout);
+  int *spec, int *stream, char *outname, char fnams[MAX_INPUT_2][MAX_INPUT_PATH],
+  int *numfnams, Vdata_Format *formatin, Vdata_Format *formatout);
+
+/**
+ * @brief  One input partition of an out-of-core (-p) merge
+ *
+ * The partition is streamed one x-plane at a time; only the two planes
+ * bracketing the current output plane are held in memory.
+ */
+typedef struct sMergePart {
+	const char *fname;       /**< Input file */
+	int nx, ny, nz;          /**< Partition grid dimensions */
+	double xmin, ymin, zmin; /**< Partition origin */
+	double hx, hy, hzed;     /**< Partition spacings */
+	int lay[3];              /**< Position in the processor grid */
+	Vslab *slab;             /**< Open stream (active partitions only) */
+	int nread;               /**< Number of x-planes consumed so far */
+	double *plane[2];        /**< Two-plane window, indexed by plane&1 */
+} MergePart;
+
+VPRIVATE int MergePart_layout(MergePart *parts, int nparts,
+  int npart[3], double *cuts[3], MergePart ***slot);
+VPRIVATE int MergePart_stream(Vgrid *mgrid, MergePart *parts, int nparts,
+  Vdata_Format formatin, Vdata_Format formatout, const char *outname);
 
 VPRIVATE char *MCwhiteChars = " =,;\t\n";
 VPRIVATE char *MCcommChars  = "#%";
@@ -46,6 +68,7 @@ void usage(){
 				"							(default: calculates full map)\n"
 				"	-s		Print bounds of merged input dx files. Doesn't generate a merged map.\n"
 				"							(-s is exclusive of the other FLAGS)\n"
+				"	-p		Out-of-core merge of mg-para partition maps (see below)\n"
 				"	-h		Print this message\n"
 				"\n"
 				"All FLAGS are optional. Flags must be set prior to listing input files. You must provide at least one\n"
@@ -75,6 +98,12 @@ void usage(){
 				"Specifying -t will specify the type of the OpenDX file to be output, either dx for a standard OpenDX format\n"
 				"file or dxbin for a binary OpenDX format files. The default type is dx, or standard OpenDX.\n"
 				"\n"
+				"Specifying -p merges the maps of an mg-para calculation by ownership instead of by averaging. The\n"
+				"processor grid is inferred from the file headers and each output point is taken from the partition\n"
+				"that owns it. Partitions are streamed one x-plane at a time and the merged map is written as it is\n"
+				"assembled, so memory use is bounded by a few grid planes rather than by the size of the merged map.\n"
+				"If the input files do not tile a regular processor grid the standard merge is used instead.\n"
+				"\n"
 				"Examples:\n"
 				"\n"
 				"	./mergedx2 -r 0.5 0.5 0.5 file1.dx file2.dx\n"
@@ -83,6 +112,8 @@ void usage(){
 				"\n"
 				"	./mergedx2 -o myfile.dx -r 0.5 0.5 0.5 -b -3.13 -2.0 -2.14 31.0 25.4 22.1 file1.dx file2.dx\n"
 				"\n"
+				"	./mergedx2 -p -r 0.5 0.5 0.5 -o pot.dx pot-PE0.dx pot-PE1.dx pot-PE2.dx pot-PE3.dx\n"
+				"\n"
 				"	./mergedx2 -s\n"
 				"\n"
 		   );
@@ -93,7 +124,7 @@ int main(int argc, char **argv) {
 
 	/* *************** VARIABLES ******************* */
 	size_t i, j, k, mem_size;
-	int spec,warn;
+	int spec,warn,stream;
 	int nx, ny, nz, count, numfnams;
 
 	double pt[3],value, res1, res2, res3, resx, resy, resz;
@@ -106,6 +137,7 @@ int main(int argc, char **argv) {
 
 	char fnams[MAX_INPUT_2][MAX_INPUT_PATH];
 	short *carray = VNULL;
+	MergePart *parts = VNULL;
 
 	char *snam = "# main:  ";
 	char outname[MAX_INPUT_PATH];
@@ -117,6 +149,7 @@ int main(int argc, char **argv) {
 
 	/* Set the default values */
 	spec = 0;
+	stream = 0;
 	warn = 0;
 	res1 = 1.0;
 	res2 = 1.0;
@@ -133,7 +166,7 @@ int main(int argc, char **argv) {
 	if(argc <= 1){ usage(); return 1; }
 
 	if(Char_parseARGV(argc, argv, &res1, &res2, &res3, &xmin, &ymin, &zmin,
-					  &xmax, &ymax, &zmax, &spec, outname, fnams,
+					  &xmax, &ymax, &zmax, &spec, &stream, outname, fnams,
                                           &numfnams, &formatin, &formatout))
 	{
 		usage();
@@ -157,10 +190,27 @@ int main(int argc, char **argv) {
 	/* *************** GET FILE HEADERS ******************* */
 	Vnm_print(1, "%s Reading Headers...\n",snam);
 	grid = Vgrid_ctor(0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, VNULL);
+	if (stream) {
+		parts = (MergePart *) Vmem_malloc(VNULL, numfnams, sizeof(MergePart));
+	}
 	for(count=0; count<numfnams; count++) {
 		Vnm_print(0, "%s  Reading header from %s...\n",snam, fnams[count]);
 		Vgrid_readDXhead(grid, "FILE", "ASC", VNULL, fnams[count]);
 
+		if (stream) {
+			parts[count].fname = fnams[count];
+			parts[count].slab = VNULL;
+			parts[count].nx = grid->nx;
+			parts[count].ny = grid->ny;
+			parts[count].nz = grid->nz;
+			parts[count].xmin = grid->xmin;
+			parts[count].ymin = grid->ymin;
+			parts[count].zmin = grid->zmin;
+			parts[count].hx = grid->hx;
+			parts[count].hy = grid->hy;
+			parts[count].hzed = grid->hzed;
+		}
+
 		/* set the merged grid bounds to include all the subgrids */
 		if( grid->xmin < mgrid->xmin ) mgrid->xmin = grid->xmin;
 		if( grid->xmax > mgrid->xmax ) mgrid->xmax = grid->xmax;
@@ -206,6 +256,9 @@ int main(int argc, char **argv) {
 					mgrid->xmin,mgrid->ymin,mgrid->zmin,mgrid->xmax,mgrid->ymax,mgrid->zmax,
 					xminb,yminb,zminb,xmaxb,ymaxb,zmaxb
 				  );
+		if (parts != VNULL) {
+			Vmem_free(VNULL, numfnams, sizeof(MergePart), (void **)&parts);
+		}
 		return 1;
 	}
 
@@ -229,7 +282,29 @@ int main(int argc, char **argv) {
 	Vnm_print(1, "%s xmax = %lf, ymax = %lf, zmax = %lf\n",snam,
 			  mgrid->xmax, mgrid-> ymax, mgrid->zmax);
 
-	if(spec) return 0;
+	if(spec) {
+		if (parts != VNULL) {
+			Vmem_free(VNULL, numfnams, sizeof(MergePart), (void **)&parts);
+		}
+		Vgrid_dtor( &grid );
+		Vgrid_dtor( &mgrid );
+		return 0;
+	}
+
+	/* ********** OUT-OF-CORE MERGE BY OWNERSHIP *********** */
+	if (stream) {
+		Vgrid_dtor( &grid );
+		count = MergePart_stream(mgrid, parts, numfnams, formatin,
+								 formatout, outname);
+		Vmem_free(VNULL, numfnams, sizeof(MergePart), (void **)&parts);
+		if (count >= 0) {
+			Vgrid_dtor( &mgrid );
+			return (count ? 0 : 1);
+		}
+		Vnm_print(1, "%s Input files do not tile a processor grid; "
+				  "using the standard merge\n", snam);
+		grid = Vgrid_ctor(0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, VNULL);
+	}
 
 	mem_size = (size_t)mgrid->nx * mgrid->ny * mgrid->nz;
 	mgrid->data = (double *) Vmem_malloc(mgrid->mem, mem_size, sizeof(double));
@@ -329,6 +404,361 @@ int main(int argc, char **argv) {
 	return 0;
 }
 
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  MergePart_layout
+//
+// Purpose:  Infer the processor grid of a set of mg-para partition maps from
+//           their headers.  Along each axis the distinct partition extents
+//           are sorted and the disjoint partitions are rebuilt the way
+//           NOsh_setupMGPART lays them out:  the global lattice spanning all
+//           partitions is split into equal runs of points and ownership
+//           changes half a spacing before the first point of each run.
+//           Returns 0 unless every cell of the processor grid is covered by
+//           exactly one file and the lattice splits evenly.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int MergePart_layout(MergePart *parts, int nparts,
+  int npart[3], double *cuts[3], MergePart ***slot) {
+
+	int d, i, l, m, n, u, neff, disj;
+	double lo, hi, h, tlo, thi;
+	double *los, *his;
+	MergePart *p;
+
+	for (d=0; d<3; d++) cuts[d] = VNULL;
+	*slot = VNULL;
+
+	los = (double *) Vmem_malloc(VNULL, nparts, sizeof(double));
+	his = (double *) Vmem_malloc(VNULL, nparts, sizeof(double));
+
+	for (d=0; d<3; d++) {
+		/* Collect the distinct extents along this axis in sorted order */
+		n = 0;
+		for (i=0; i<nparts; i++) {
+			p = &(parts[i]);
+			lo = (d == 0) ? p->xmin : ((d == 1) ? p->ymin : p->zmin);
+			h = (d == 0) ? p->hx : ((d == 1) ? p->hy : p->hzed);
+			hi = lo + (((d == 0) ? p->nx : ((d == 1) ? p->ny : p->nz)) - 1)*h;
+			for (l=0; l<n; l++) {
+				if (VABS(los[l] - lo) <= 0.5*h) break;
+			}
+			if (l < n) {
+				if (VABS(his[l] - hi) > 0.5*h) goto VERROR1;
+				continue;
+			}
+			for (l=n; (l>0) && (los[l-1] > lo); l--) {
+				los[l] = los[l-1];
+				his[l] = his[l-1];
+			}
+			los[l] = lo;
+			his[l] = hi;
+			n++;
+		}
+		npart[d] = n;
+
+		/* Each partition owns disj consecutive points of the global
+		 * lattice, plus half a spacing on either side */
+		h = (d == 0) ? parts[0].hx : ((d == 1) ? parts[0].hy : parts[0].hzed);
+		neff = (int)VFLOOR((his[n-1] - los[0])/h + 0.5) + 1;
+		if (neff % n) goto VERROR1;
+		disj = neff/n;
+		cuts[d] = (double *) Vmem_malloc(VNULL, n+1, sizeof(double));
+		cuts[d][0] = -VLARGE;
+		for (l=1; l<n; l++) cuts[d][l] = los[0] + h*(l*disj - 0.5);
+		cuts[d][n] = VLARGE;
+
+		for (i=0; i<nparts; i++) {
+			p = &(parts[i]);
+			lo = (d == 0) ? p->xmin : ((d == 1) ? p->ymin : p->zmin);
+			h = (d == 0) ? p->hx : ((d == 1) ? p->hy : p->hzed);
+			for (l=0; l<n; l++) {
+				if (VABS(los[l] - lo) <= 0.5*h) break;
+			}
+			p->lay[d] = l;
+		}
+	}
+
+	/* Every processor grid cell must be covered exactly once */
+	m = npart[0]*npart[1]*npart[2];
+	if (m != nparts) goto VERROR1;
+	*slot = (MergePart **) Vmem_malloc(VNULL, m, sizeof(MergePart *));
+	for (u=0; u<m; u++) (*slot)[u] = VNULL;
+	for (i=0; i<nparts; i++) {
+		p = &(parts[i]);
+		u = (p->lay[0]*npart[1] + p->lay[1])*npart[2] + p->lay[2];
+		if ((*slot)[u] != VNULL) goto VERROR1;
+		(*slot)[u] = p;
+	}
+
+	/* Neighbouring extents must not be disjoint by more than a grid cell */
+	for (i=0; i<nparts; i++) {
+		p = &(parts[i]);
+		for (d=0; d<3; d++) {
+			tlo = (d == 0) ? p->xmin : ((d == 1) ? p->ymin : p->zmin);
+			h = (d == 0) ? p->hx : ((d == 1) ? p->hy : p->hzed);
+			thi = tlo + (((d == 0) ? p->nx : ((d == 1) ? p->ny : p->nz)) - 1)*h;
+			l = p->lay[d];
+			if ((l > 0) && (tlo - cuts[d][l] > h + VSMALL)) goto VERROR1;
+			if ((l < npart[d]-1) && (cuts[d][l+1] - thi > h + VSMALL))
+				goto VERROR1;
+		}
+	}
+
+	Vmem_free(VNULL, nparts, sizeof(double), (void **)&los);
+	Vmem_free(VNULL, nparts, sizeof(double), (void **)&his);
+	return 1;
+
+VERROR1:
+	for (d=0; d<3; d++) {
+		if (cuts[d] != VNULL) {
+			Vmem_free(VNULL, npart[d]+1, sizeof(double), (void **)&(cuts[d]));
+		}
+	}
+	if (*slot != VNULL) {
+		Vmem_free(VNULL, nparts, sizeof(MergePart *), (void **)slot);
+	}
+	Vmem_free(VNULL, nparts, sizeof(double), (void **)&los);
+	Vmem_free(VNULL, nparts, sizeof(double), (void **)&his);
+	return 0;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  MergePart_open
+//
+// Purpose:  Open a partition map and position it at the start of its data
+//           block
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int MergePart_open(MergePart *p, Vdata_Format formatin) {
+
+	size_t n;
+
+	p->slab = Vslab_ctorRead(p->fname, formatin);
+	if (p->slab == VNULL) return 0;
+	n = (size_t)p->ny*p->nz;
+	p->plane[0] = (double *) Vmem_malloc(VNULL, n, sizeof(double));
+	p->plane[1] = (double *) Vmem_malloc(VNULL, n, sizeof(double));
+	p->nread = 0;
+	return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  MergePart_close
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE void MergePart_close(MergePart *p) {
+
+	size_t n;
+
+	if (p->slab == VNULL) return;
+	Vslab_dtor(&(p->slab));
+	n = (size_t)p->ny*p->nz;
+	Vmem_free(VNULL, n, sizeof(double), (void **)&(p->plane[0]));
+	Vmem_free(VNULL, n, sizeof(double), (void **)&(p->plane[1]));
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  MergePart_advance
+//
+// Purpose:  Read x-planes from a partition until plane ihi is in its window
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int MergePart_advance(MergePart *p, int ihi) {
+
+	while (p->nread <= ihi) {
+		if (!Vslab_read(p->slab, 1, p->plane[p->nread & 1])) return 0;
+		(p->nread)++;
+	}
+	return 1;
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  MergePart_index
+//
+// Purpose:  Locate coordinate x on a partition axis of n points, clamping to
+//           the partition like Vgrid_value2.  Returns the interpolation
+//           weight of point *lo+1; coordinates within round-off of a grid
+//           point are snapped to it so that aligned lattices are copied
+//           exactly.  *out is set when x lies more than one spacing outside
+//           the partition.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE double MergePart_index(double x, double min, double h, int n,
+  int *lo, int *out) {
+
+	double f, r;
+
+	f = (x - min)/h;
+	r = VFLOOR(f + 0.5);
+	if (VABS(f - r) < VSMALL*1000.0) f = r;
+	*out = ((f < -1.0) || (f > (double)n));
+	if (f < 0.0) f = 0.0;
+	if (f > (double)(n-1)) f = (double)(n-1);
+	*lo = (int)f;
+	if (*lo > n-2) *lo = (n > 1) ? n-2 : 0;
+	return f - (double)(*lo);
+}
+
+/* ///////////////////////////////////////////////////////////////////////////
+// Routine:  MergePart_stream
+//
+// Purpose:  Out-of-core merge of mg-para partition maps.  The merged map is
+//           assembled one x-plane at a time from the partitions that own it;
+//           the partitions of the current x-layer are read concurrently and
+//           each output plane is written as soon as it is complete.
+//           Returns 1 on success, 0 on an I/O error and -1 if the input files
+//           do not tile a processor grid.
+/////////////////////////////////////////////////////////////////////////// */
+VPRIVATE int MergePart_stream(Vgrid *mgrid, MergePart *parts, int nparts,
+  Vdata_Format formatin, Vdata_Format formatout, const char *outname) {
+
+	int npart[3], nact, nx, ny, nz, i, j, k, a, d, ix, curx, rc;
+	int bad, nout, out, jlo, klo, jhi, khi, *ilo, *ihi;
+	int *jlay, *klay;
+	size_t n;
+	double *cuts[3], *vplane, *wx, x, y, z, wy, wz, v0, v1;
+	double *p0, *p1;
+	char *snam = "# MergePart_stream:  ";
+	MergePart **slot, **act, *p;
+	Vslab *fd;
+
+	if (!MergePart_layout(parts, nparts, npart, cuts, &slot)) return -1;
+
+	nx = mgrid->nx;
+	ny = mgrid->ny;
+	nz = mgrid->nz;
+	n = (size_t)ny*nz;
+	nact = npart[1]*npart[2];
+	Vnm_print(1, "%s Processor grid %d x %d x %d; streaming %d planes\n",
+			  snam, npart[0], npart[1], npart[2], nx);
+
+	/* Owner layers along the in-plane axes are the same for every plane */
+	jlay = (int *) Vmem_malloc(VNULL, ny, sizeof(int));
+	klay = (int *) Vmem_malloc(VNULL, nz, sizeof(int));
+	for (j=0, d=0; j<ny; j++) {
+		y = mgrid->ymin + j*mgrid->hy;
+		while ((d < npart[1]-1) && (y >= cuts[1][d+1])) d++;
+		jlay[j] = d;
+	}
+	for (k=0, d=0; k<nz; k++) {
+		z = mgrid->zmin + k*mgrid->hzed;
+		while ((d < npart[2]-1) && (z >= cuts[2][d+1])) d++;
+		klay[k] = d;
+	}
+
+	ilo = (int *) Vmem_malloc(VNULL, nact, sizeof(int));
+	ihi = (int *) Vmem_malloc(VNULL, nact, sizeof(int));
+	wx = (double *) Vmem_malloc(VNULL, nact, sizeof(double));
+	vplane = (double *) Vmem_malloc(VNULL, n, sizeof(double));
+
+	/* The header goes out now, the trailer with the last plane */
+	rc = 0;
+	fd = Vslab_ctorWrite(outname, formatout, nx, ny, nz, mgrid->xmin,
+	  mgrid->ymin, mgrid->zmin, mgrid->hx, mgrid->hy, mgrid->hzed, "mergedx");
+	if (fd == VNULL) {
+		Vnm_print(2, "%s Problem opening file %s for writing\n", snam, outname);
+		goto VERROR1;
+	}
+
+	nout = 0;
+	curx = -1;
+	act = VNULL;
+	for (i=0, ix=0; i<nx; i++) {
+		x = mgrid->xmin + i*mgrid->hx;
+		while ((ix < npart[0]-1) && (x >= cuts[0][ix+1])) ix++;
+
+		/* Retire the previous x-layer and open the one that owns this plane */
+		if (ix != curx) {
+			if (act != VNULL) {
+				for (a=0; a<nact; a++) MergePart_close(act[a]);
+			}
+			act = &(slot[ix*nact]);
+			bad = 0;
+			for (a=0; a<nact; a++) {
+				if (!MergePart_open(act[a], formatin)) bad++;
+			}
+			if (bad) {
+				for (a=0; a<nact; a++) {
+					if (act[a]->slab == VNULL) {
+						Vnm_print(2, "%s Problem reading %s\n", snam,
+								  act[a]->fname);
+					}
+				}
+				goto VERROR1;
+			}
+			curx = ix;
+		}
+
+		/* Pull the bracketing planes of every active partition forward */
+		for (a=0; a<nact; a++) {
+			p = act[a];
+			wx[a] = MergePart_index(x, p->xmin, p->hx, p->nx, &(ilo[a]), &out);
+			ihi[a] = ilo[a] + ((p->nx > 1) ? 1 : 0);
+			nout += out;
+		}
+		bad = 0;
+		#pragma omp parallel for reduction(+:bad) schedule(dynamic,1)
+		for (a=0; a<nact; a++) {
+			if (!MergePart_advance(act[a], ihi[a])) bad++;
+		}
+		if (bad) {
+			Vnm_print(2, "%s Premature end of data in x-layer %d\n", snam, ix);
+			goto VERROR1;
+		}
+
+		/* Interpolate the output plane from the owning partitions */
+		#pragma omp parallel for private(k, a, p, y, z, wy, wz, jlo, klo, jhi, khi, out, p0, p1, v0, v1) reduction(+:nout)
+		for (j=0; j<ny; j++) {
+			y = mgrid->ymin + j*mgrid->hy;
+			for (k=0; k<nz; k++) {
+				z = mgrid->zmin + k*mgrid->hzed;
+				a = jlay[j]*npart[2] + klay[k];
+				p = act[a];
+				wy = MergePart_index(y, p->ymin, p->hy, p->ny, &jlo, &out);
+				nout += out;
+				wz = MergePart_index(z, p->zmin, p->hzed, p->nz, &klo, &out);
+				nout += out;
+				jhi = jlo + ((p->ny > 1) ? 1 : 0);
+				khi = klo + ((p->nz > 1) ? 1 : 0);
+				p0 = p->plane[ilo[a] & 1];
+				p1 = p->plane[ihi[a] & 1];
+				v0 = (1.0-wy)*((1.0-wz)*p0[jlo*p->nz+klo] + wz*p0[jlo*p->nz+khi])
+				   + wy      *((1.0-wz)*p0[jhi*p->nz+klo] + wz*p0[jhi*p->nz+khi]);
+				v1 = (1.0-wy)*((1.0-wz)*p1[jlo*p->nz+klo] + wz*p1[jlo*p->nz+khi])
+				   + wy      *((1.0-wz)*p1[jhi*p->nz+klo] + wz*p1[jhi*p->nz+khi]);
+				vplane[(size_t)j*nz+k] = (1.0-wx[a])*v0 + wx[a]*v1;
+			}
+		}
+
+		/* Write the plane */
+		if (!Vslab_write(fd, 1, vplane)) goto VERROR2;
+	}
+	for (a=0; a<nact; a++) MergePart_close(act[a]);
+	Vslab_dtor(&fd);
+
+	if (nout > 0) {
+		Vnm_print(2, "%s Warning: %d output coordinates lie more than one "
+				  "spacing outside their owning partition\n", snam, nout);
+	}
+	rc = 1;
+	goto VERROR1;
+
+VERROR2:
+	Vnm_print(2, "%s Problem writing %s\n", snam, outname);
+
+VERROR1:
+	if (!rc) {
+		for (a=0; a<nparts; a++) MergePart_close(&(parts[a]));
+	}
+	if (fd != VNULL) Vslab_dtor(&fd);
+	Vmem_free(VNULL, n, sizeof(double), (void **)&vplane);
+	Vmem_free(VNULL, nact, sizeof(double), (void **)&wx);
+	Vmem_free(VNULL, nact, sizeof(int), (void **)&ihi);
+	Vmem_free(VNULL, nact, sizeof(int), (void **)&ilo);
+	Vmem_free(VNULL, nz, sizeof(int), (void **)&klay);
+	Vmem_free(VNULL, ny, sizeof(int), (void **)&jlay);
+	Vmem_free(VNULL, nparts, sizeof(MergePart *), (void **)&slot);
+	for (d=0; d<3; d++) {
+		Vmem_free(VNULL, npart[d]+1, sizeof(double), (void **)&(cuts[d]));
+	}
+	return rc;
+}
+
 /* ///////////////////////////////////////////////////////////////////////////
 // Routine:  Vgrid_value2
 //
@@ -565,8 +995,8 @@ VPRIVATE int Char_parseARGV(int argc, char **argv,
   double *res1, double *res2, double *res3, 
   double *xmin, double *ymin, double *zmin, 
   double *xmax, double *ymax, double *zmax, 
-  int* spec, char *outname, char fnams[MAX_INPUT_2][MAX_INPUT_PATH], int *numfnams,
-  Vdata_Format *formatin, Vdata_Format *formatout)
+  int* spec, int *stream, char *outname, char fnams[MAX_INPUT_2][MAX_INPUT_PATH],
+  int *numfnams, Vdata_Format *formatin, Vdata_Format *formatout)
 {
 	int i;
 	i = 1;
@@ -610,6 +1040,8 @@ VPRIVATE int Char_parseARGV(int argc, char **argv,
                                 i++;
 			} else if (!strcmp(opt,"-s")) {
 				*spec = 1;
+			} else if (!strcmp(opt,"-p")) {
+				*stream = 1;
 			} else if (!strcmp(opt,"-h")) {
 				return 1;
 			} else {
@@ -19,6 +19,9 @@
 *
 * Usage:		> multivalue csvCoordinatesFile dxFormattedFile outputFile
 *
+*			dxFormattedFile may list several grids separated by commas, finest first (e.g. the
+*			levels of a focusing run); each point takes its value from the first grid containing it.
+*
 *			Example of input file contents:	123.234,23.8E03,9.6e-4
 *								5.9,6.2,0.3
 *								-7e3,91,0.6
@@ -50,7 +53,9 @@ void multivalue_usage(void) {
     Vnm_print(1,"Usage: multivalue <csvCoordinatesFile> <dxFormattedFile> <outputFile>"
                 " [outputformat]\n\n");
     Vnm_print(1,"csvCoordinatesFile is the input CSV file containing 3D coordinates\n");
-    Vnm_print(1,"dxFormattedFile is the input DX grid on which coords are evaluated\n\n");
+    Vnm_print(1,"dxFormattedFile is the input DX grid on which coords are evaluated\n");
+    Vnm_print(1,"Several grids may be given separated by commas, finest first;\n");
+    Vnm_print(1,"each point takes its value from the first grid that contains it.\n\n");
     Vnm_print(1,"The optional argument outputformat specifies output OpenDX type.\n");
     Vnm_print(1,"Acceptable values include\n\
        dx:  standard OpenDX format\n\
@@ -68,12 +73,13 @@ void multivalue_usage(void) {
 }
 
 int main(int argc, char *argv[]) {
-    char *inputFileName, *dxFileName, *outputFileName;
-    int scanNum = 0;
-    double pt[3], val;
+    char *inputFileName, *dxFileName, *outputFileName, *tok;
+    int scanNum = 0, npts, maxpts, i, ngrids, *onGrid;
+    double pt[3], val, *pts, *vals;
     FILE *inputFileStream, *outputFileStream;
     Vdata_Format format;
-    Vgrid *grid;
+    Vgrid *grid[VMGRIDMAX];
+    Vmgrid *mgrid;
 
     /* *************** CHECK INVOCATION ******************* */
     Vio_start();
@@ -105,23 +111,33 @@ int main(int argc, char *argv[]) {
     Vnm_print(1,"Input file:\t%s\ndx file:\t%s\nOutput file:\t%s\n", inputFileName, dxFileName, outputFileName);
 
     /* *************** READ DATA ******************* */
-    Vnm_print(1, "main:  Reading data from %s...\n", dxFileName);
-    grid = Vgrid_ctor(0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, VNULL);
-    if (format == VDF_DX) {
-        if (!Vgrid_readDX(grid, "FILE", "ASC", VNULL, dxFileName)) {
-            Vnm_print(2, "main:  Problem reading standard OpenDX-format grid from %s\n",
-              dxFileName);
+    mgrid = Vmgrid_ctor();
+    ngrids = 0;
+    for (tok = strtok(dxFileName, ","); tok != VNULL; tok = strtok(VNULL, ",")) {
+        if (ngrids == VMGRIDMAX) {
+            Vnm_print(2, "main:  Too many grids (max = %d)\n", VMGRIDMAX);
             exit(1);
         }
-    } else if (format == VDF_DXBIN) {
-        if (!Vgrid_readDXBIN(grid, "FILE", "ASC", VNULL, dxFileName)) {
-            Vnm_print(2, "main:  Problem reading binary OpenDX-format grid from %s\n",
-              dxFileName);
+        Vnm_print(1, "main:  Reading data from %s...\n", tok);
+        grid[ngrids] = Vgrid_ctor(0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, VNULL);
+        if (format == VDF_DX) {
+            if (!Vgrid_readDX(grid[ngrids], "FILE", "ASC", VNULL, tok)) {
+                Vnm_print(2, "main:  Problem reading standard OpenDX-format grid from %s\n",
+                  tok);
+                exit(1);
+            }
+        } else if (format == VDF_DXBIN) {
+            if (!Vgrid_readDXBIN(grid[ngrids], "FILE", "ASC", VNULL, tok)) {
+                Vnm_print(2, "main:  Problem reading binary OpenDX-format grid from %s\n",
+                  tok);
+                exit(1);
+            }
+        } else {
+            Vnm_print(2, "main:  Format not properly specified. \n");
             exit(1);
         }
-    } else {
-        Vnm_print(2, "main:  Format not properly specified. \n");
-        exit(1);
+        Vmgrid_addGrid(mgrid, grid[ngrids]);
+        ngrids++;
     }
 
     /*
@@ -165,13 +181,51 @@ int main(int argc, char *argv[]) {
         Vnm_print(1,"Getting values...\n");
         Vnm_print(1,"Displayed and written to output file as x,y,z,value\n");
     }
+    /*
+    read all the points first so they can be evaluated in one batch
+    */
+    npts = 0;
+    maxpts = 1024;
+    pts = (double *)malloc(3*maxpts*sizeof(double));
     while(scanNum != EOF){
+        if(npts == maxpts){
+            maxpts = 2*maxpts;
+            pts = (double *)realloc(pts, 3*maxpts*sizeof(double));
+        }
+        if(pts == NULL){
+            Vnm_print(2,"Unable to allocate space for %d points\n",maxpts);
+            exit(1);
+        }
+        pts[3*npts] = pt[0];
+        pts[3*npts+1] = pt[1];
+        pts[3*npts+2] = pt[2];
+        npts++;
+
         /*
-        perform Vgrid_value --> 1) check if point is within mesh bounds, if not set value to 0 and return;
-        2) if point is actually on a mesh point, give mesh pt value; 3) otherwise use trilinear interpolation
-        to get value
+        scan in next line of input file
         */
-        if(Vgrid_value(grid, pt, &val)){
+        scanNum = fscanf(inputFileStream,"%lg%*c%lg%*c%lg",&pt[0],&pt[1],&pt[2]);
+    }
+
+    /*
+    perform Vmgrid_valueBatch --> for each point 1) find the first grid whose mesh bounds
+    contain it, if none flag it as off the grid; 2) if point is actually on a mesh point, give
+    mesh pt value; 3) otherwise use trilinear interpolation to get value
+    */
+    vals = (double *)malloc(npts*sizeof(double));
+    onGrid = (int *)malloc(npts*sizeof(int));
+    if((vals == NULL) || (onGrid == NULL)){
+        Vnm_print(2,"Unable to allocate space for %d values\n",npts);
+        exit(1);
+    }
+    Vmgrid_valueBatch(mgrid, npts, pts, vals, VNULL, onGrid);
+
+    for(i=0; i<npts; i++){
+        pt[0] = pts[3*i];
+        pt[1] = pts[3*i+1];
+        pt[2] = pts[3*i+2];
+        val = vals[i];
+        if(onGrid[i]){
             Vnm_print(1,"%e,%e,%e,%e\n",pt[0],pt[1],pt[2],val);
             /*
             write line of output file (maybe should implement error checking on fprintf,
@@ -187,12 +241,14 @@ int main(int argc, char *argv[]) {
             */
             fprintf(outputFileStream,"%e,%e,%e,%s\n",pt[0],pt[1],pt[2],"NaN");
         }
-
-        /*
-        scan in next line of input file
-        */
-        scanNum = fscanf(inputFileStream,"%lg%*c%lg%*c%lg",&pt[0],&pt[1],&pt[2]);
     }
+    free(pts);
+    free(vals);
+    free(onGrid);
+    for(i=0; i<ngrids; i++){
+        Vgrid_dtor(&grid[i]);
+    }
+    Vmgrid_dtor(&mgrid);
 
     /*
     close input file
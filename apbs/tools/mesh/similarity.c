@@ -243,6 +243,140 @@ int readGrid(Vgrid **grid, char *path, Vdata_Format format) {
     return 1;
 }
 
+/**
+ * @brief  Sums accumulated by streamSimilarity
+ */
+typedef struct SimilaritySums {
+    double norm1_L1;  /**< Sum of |s1*m1| */
+    double norm1_L2;  /**< Sum of (s1*m1)^2 */
+    double norm2_L1;  /**< Sum of |s2*m2| */
+    double norm2_L2;  /**< Sum of (s2*m2)^2 */
+    double normDiff_L1;  /**< Sum of |m1*m2*(s1-s2)| */
+    double normDiff_L2;  /**< Sum of (m1*m2*(s1-s2))^2 */
+    double ip_L2;  /**< Sum of (s1*m1)*(s2*m2) */
+    double snorm1_H1;  /**< H1 semi-norm sum for set 1 */
+    double snorm2_H1;  /**< H1 semi-norm sum for set 2 */
+    double snormDiff_H1;  /**< H1 semi-norm sum for the difference */
+    double ip_H1;  /**< H1 inner product sum */
+    size_t nsval;  /**< Number of points in the L1/L2 sums */
+    size_t ngval;  /**< Number of points in the H1 sums */
+} SimilaritySums;
+
+/**
+ * @brief  Compute the similarity sums of two data sets on the same grid in
+ *         a single pass over the files, holding three x-planes of each set
+ *         (and one of each mask).  Grid nodes are addressed directly, so the
+ *         values and gradients are the ones Vgrid_value and Vgrid_gradient
+ *         return there.
+ * @param  scalar1  Data set 1, positioned at its first plane
+ * @param  scalar2  Data set 2 on the same grid
+ * @param  mask1  Mask for set 1 on the same grid, or VNULL
+ * @param  mask2  Mask for set 2 on the same grid, or VNULL
+ * @param  sums  Set to the accumulated sums
+ * @return 1 if successful, 0 otherwise */
+int streamSimilarity(Vslab *scalar1, Vslab *scalar2, Vslab *mask1,
+        Vslab *mask2, SimilaritySums *sums) {
+
+    int i, j, k, nx, ny, nz, onGridV1, onGridV2, rc;
+    size_t n, u, nsval, ngval;
+    double sval1, sval2, mval1, mval2, val1, val2, dval, gval1[3], gval2[3];
+    double norm1_L1, norm1_L2, norm2_L1, norm2_L2, normDiff_L1, normDiff_L2;
+    double ip_L2, snorm1_H1, snorm2_H1, snormDiff_H1, ip_H1;
+    double *win1, *win2, *mplane1, *mplane2;
+    double *left1, *cur1, *right1, *left2, *cur2, *right2;
+
+    nx = scalar1->nx; ny = scalar1->ny; nz = scalar1->nz;
+    n = (size_t)ny*nz;
+
+    norm1_L1 = 0; norm1_L2 = 0; norm2_L1 = 0; norm2_L2 = 0;
+    normDiff_L1 = 0; normDiff_L2 = 0; ip_L2 = 0;
+    snorm1_H1 = 0; snorm2_H1 = 0; snormDiff_H1 = 0; ip_H1 = 0;
+    nsval = 0; ngval = 0;
+
+    win1 = (double *)Vmem_malloc(VNULL, 3*n, sizeof(double));
+    win2 = (double *)Vmem_malloc(VNULL, 3*n, sizeof(double));
+    mplane1 = VNULL;
+    mplane2 = VNULL;
+    if (mask1 != VNULL) mplane1 = (double *)Vmem_malloc(VNULL, n, sizeof(double));
+    if (mask2 != VNULL) mplane2 = (double *)Vmem_malloc(VNULL, n, sizeof(double));
+
+    rc = 1;
+    for (i=0; i<nx; i++) {
+        if (!Vslab_readWindow(scalar1, i, win1, &left1, &cur1, &right1) ||
+                !Vslab_readWindow(scalar2, i, win2, &left2, &cur2, &right2) ||
+                ((mask1 != VNULL) && !Vslab_read(mask1, 1, mplane1)) ||
+                ((mask2 != VNULL) && !Vslab_read(mask2, 1, mplane2))) {
+            rc = 0;
+            break;
+        }
+
+        #pragma omp parallel for private(k, u, onGridV1, onGridV2, sval1, sval2, mval1, mval2, val1, val2, dval, gval1, gval2) reduction(+:norm1_L1, norm1_L2, norm2_L1, norm2_L2, normDiff_L1, normDiff_L2, ip_L2, snorm1_H1, snorm2_H1, snormDiff_H1, ip_H1, nsval, ngval)
+        for (j=0; j<ny; j++) {
+            for (k=0; k<nz; k++) {
+                u = (size_t)j*nz + k;
+                sval1 = cur1[u];
+                sval2 = cur2[u];
+                mval1 = (mplane1 != VNULL) ? mplane1[u] : 1.0;
+                mval2 = (mplane2 != VNULL) ? mplane2[u] : 1.0;
+
+                /* Measures based on scalars */
+                val1 = sval1*mval1;
+                val2 = sval2*mval2;
+                dval = mval1*mval2*(sval1 - sval2);
+                norm1_L2 += VSQR(val1);
+                norm2_L2 += VSQR(val2);
+                normDiff_L2 += VSQR(dval);
+                ip_L2 += (val2*val1);
+                norm1_L1 += VABS(val1);
+                norm2_L1 += VABS(val2);
+                normDiff_L1 += VABS(dval);
+                nsval++;
+
+                /* Measures based on gradients */
+                onGridV1 = Vslab_gradient(scalar1, left1, cur1, right1, j, k,
+                        gval1);
+                onGridV2 = Vslab_gradient(scalar2, left2, cur2, right2, j, k,
+                        gval2);
+                if (onGridV1 && onGridV2) {
+                    val1 = mval1*(VSQR(gval1[0]) + VSQR(gval1[1]) \
+                            + VSQR(gval1[2]));
+                    val2 = mval2*(VSQR(gval2[0]) + VSQR(gval2[1]) \
+                            + VSQR(gval2[2]));
+                    dval = mval1*mval2*(VSQR(gval1[0]-gval2[0]) \
+                            + VSQR(gval1[1]-gval2[1]) \
+                            + VSQR(gval1[2]-gval2[2]));
+                    snorm1_H1 += VSQR(val1);
+                    snorm2_H1 += VSQR(val2);
+                    snormDiff_H1 += VSQR(dval);
+                    ip_H1 += (val1*val2);
+                    ngval++;
+                }
+            }
+        }
+
+        if (isnan(norm1_L2) || isnan(norm2_L2)) {
+            Vnm_print(2, "ERROR!  Got NaN in x-plane %d (x = %1.12E)!\n",
+                    i, scalar1->xmin + i*scalar1->hx);
+            VASSERT(0);
+        }
+    }
+
+    sums->norm1_L1 = norm1_L1; sums->norm1_L2 = norm1_L2;
+    sums->norm2_L1 = norm2_L1; sums->norm2_L2 = norm2_L2;
+    sums->normDiff_L1 = normDiff_L1; sums->normDiff_L2 = normDiff_L2;
+    sums->ip_L2 = ip_L2;
+    sums->snorm1_H1 = snorm1_H1; sums->snorm2_H1 = snorm2_H1;
+    sums->snormDiff_H1 = snormDiff_H1; sums->ip_H1 = ip_H1;
+    sums->nsval = nsval; sums->ngval = ngval;
+
+    Vmem_free(VNULL, 3*n, sizeof(double), (void **)&win1);
+    Vmem_free(VNULL, 3*n, sizeof(double), (void **)&win2);
+    if (mplane1 != VNULL) Vmem_free(VNULL, n, sizeof(double), (void **)&mplane1);
+    if (mplane2 != VNULL) Vmem_free(VNULL, n, sizeof(double), (void **)&mplane2);
+
+    return rc;
+}
+
 int main(int argc, char **argv) {
 
     /* *************** VARIABLES ******************* */
@@ -255,6 +389,12 @@ int main(int argc, char **argv) {
     double val1, val2, sval1, sval2, mval1, mval2, p1[3], p2[3];
     double dval, gval1[3], gval2[3];
     Vgrid *scalar1, *scalar2, *mask1, *mask2;
+    Vslab *slab1 = VNULL;
+    Vslab *slab2 = VNULL;
+    Vslab *mslab1 = VNULL;
+    Vslab *mslab2 = VNULL;
+    SimilaritySums sums;
+    int stream;
     double rotMat2to1[3][3], dispVec2to1[3];
     double rotMat1to2[3][3], dispVec1to2[3];
     char scalar1Path[VMAX_ARGLEN];
@@ -417,135 +557,189 @@ int main(int argc, char **argv) {
             dispVec1to2[0], dispVec1to2[1], dispVec1to2[2]);
 
 
-    /* Read scalar set 1 */
-    Vnm_print(1, "Reading scalar data set 1 from %s...\n", scalar1Path);
-    if (!readGrid(&scalar1, scalar1Path, format)) {
-        Vnm_print(2, "Error reading scalar data set 1!\n");
-        return 2;
+    /* Open the data sets for streaming.  Sets on different grids, or related
+     * by a coordinate transform, have to be interpolated, which needs the
+     * grids in memory. */
+    stream = 1;
+    for (i=0; i<3; i++) {
+        for (j=0; j<3; j++) {
+            if (rotMat1to2[i][j] != ((i == j) ? 1.0 : 0.0)) stream = 0;
+        }
+        if (dispVec1to2[i] != 0.0) stream = 0;
     }
-    Vnm_print(1, "Read %d x %d x %d grid.\n",
-            scalar1->nx, scalar1->ny, scalar1->nz);
-
-    /* Read scalar set 2 */
-    Vnm_print(1, "Reading scalar data set 2 from %s...\n", scalar2Path);
-    if (!readGrid(&scalar2, scalar2Path, format)) {
-        Vnm_print(2, "Error reading scalar data set 2!\n");
-        return 2;
+    if (stream) {
+        slab1 = Vslab_ctorRead(scalar1Path, format);
+        slab2 = Vslab_ctorRead(scalar2Path, format);
+        if (gotMask1) mslab1 = Vslab_ctorRead(mask1Path, format);
+        if (gotMask2) mslab2 = Vslab_ctorRead(mask2Path, format);
+        if ((slab1 == VNULL) || (slab2 == VNULL) ||
+                (gotMask1 && (mslab1 == VNULL)) ||
+                (gotMask2 && (mslab2 == VNULL))) {
+            Vnm_print(2, "Error reading data sets!\n");
+            return 2;
+        }
+        if (!Vslab_congruent(slab1, slab2) ||
+                (gotMask1 && !Vslab_congruent(slab1, mslab1)) ||
+                (gotMask2 && !Vslab_congruent(slab1, mslab2))) {
+            Vnm_print(1, "Data sets are on different grids; interpolating.\n");
+            stream = 0;
+        }
     }
-    Vnm_print(1, "Read %d x %d x %d grid.\n",
-            scalar2->nx, scalar2->ny, scalar2->nz);
 
-    /* Read mask 1 */
-    if (gotMask1) {
-        Vnm_print(1, "Reading mask data set 1 from %s...\n", mask1Path);
-        if (!readGrid(&mask1, mask1Path, format)) {
-            Vnm_print(2, "Error reading mask data set 1!\n");
+    if (stream) {
+        /* Stream all data sets plane by plane */
+        Vnm_print(1, "Streaming %d x %d x %d grids...\n",
+                slab1->nx, slab1->ny, slab1->nz);
+        Vnm_print(1, "Calculating similarity measures...\n");
+        if (!streamSimilarity(slab1, slab2, mslab1, mslab2, &sums)) {
+            Vnm_print(2, "Error reading data sets!\n");
             return 2;
         }
-        Vnm_print(1, "Read %d x %d x %d grid.\n",
-                mask1->nx, mask1->ny, mask1->nz);
-    }
+        dvol = (slab1->hx*slab1->hy*slab1->hzed);
+        norm1_L1 = sums.norm1_L1; norm1_L2 = sums.norm1_L2;
+        norm2_L1 = sums.norm2_L1; norm2_L2 = sums.norm2_L2;
+        normDiff_L1 = sums.normDiff_L1; normDiff_L2 = sums.normDiff_L2;
+        ip_L2 = sums.ip_L2;
+        snorm1_H1 = sums.snorm1_H1; snorm2_H1 = sums.snorm2_H1;
+        snormDiff_H1 = sums.snormDiff_H1; ip_H1 = sums.ip_H1;
+        svol = sums.nsval*dvol;
+        gvol = sums.ngval*dvol;
+    } else {
 
-    /* Read mask 2 */
-    if (gotMask2) {
-        Vnm_print(1, "Reading mask data set 2 from %s...\n", mask2Path);
-        if (!readGrid(&mask2, mask2Path, format)) {
-            Vnm_print(2, "Error reading mask data set 2!\n");
+        /* Read scalar set 1 */
+        Vnm_print(1, "Reading scalar data set 1 from %s...\n", scalar1Path);
+        if (!readGrid(&scalar1, scalar1Path, format)) {
+            Vnm_print(2, "Error reading scalar data set 1!\n");
             return 2;
         }
         Vnm_print(1, "Read %d x %d x %d grid.\n",
-                mask2->nx, mask2->ny, mask2->nz);
-    }
+                scalar1->nx, scalar1->ny, scalar1->nz);
 
-    /* Calculate relative L2 norm of difference */
-    Vnm_print(1, "Calculating similarity measures...\n");
-    nx = scalar1->nx; ny = scalar1->ny; nz = scalar1->nz;
-    hx = scalar1->hx; hy = scalar1->hy; hzed = scalar1->hzed;
-    dvol = (hx*hy*hzed);
-    xmin = scalar1->xmin; ymin = scalar1->ymin; zmin = scalar1->zmin;
-    norm1_L1 = 0; norm1_L2 = 0; snorm1_H1 = 0; norm1_H1 = 0;
-    norm2_L1 = 0; norm2_L2 = 0; snorm2_H1 = 0; norm2_H1 = 0;
-    normDiff_L1 = 0; normDiff_L2 = 0; snormDiff_H1 = 0; normDiff_H1 = 0;
-    ip_L2 = 0; ip_H1 = 0;
-    svol = 0; gvol = 0;
-    for (i=0; i<nx; i++) {
-        p1[0] = i*hx + xmin;
-        for (j=0; j<ny; j++) {
-            p1[1] = j*hy + ymin;
-            for (k=0; k<nz; k++) {
+        /* Read scalar set 2 */
+        Vnm_print(1, "Reading scalar data set 2 from %s...\n", scalar2Path);
+        if (!readGrid(&scalar2, scalar2Path, format)) {
+            Vnm_print(2, "Error reading scalar data set 2!\n");
+            return 2;
+        }
+        Vnm_print(1, "Read %d x %d x %d grid.\n",
+                scalar2->nx, scalar2->ny, scalar2->nz);
+
+        /* Read mask 1 */
+        if (gotMask1) {
+            Vnm_print(1, "Reading mask data set 1 from %s...\n", mask1Path);
+            if (!readGrid(&mask1, mask1Path, format)) {
+                Vnm_print(2, "Error reading mask data set 1!\n");
+                return 2;
+            }
+            Vnm_print(1, "Read %d x %d x %d grid.\n",
+                    mask1->nx, mask1->ny, mask1->nz);
+        }
 
-                /* Grid 1 values */
-                p1[2] = k*hzed + zmin;
-                onGridS1 = Vgrid_value(scalar1, p1, &sval1);
-                onGridV1 = Vgrid_gradient(scalar1, p1, gval1);
-                if (gotMask1) onGridS1 = Vgrid_value(mask1, p1, &mval1);
-                else mval1 = 1.0;
-
-                /* Grid 2 values */
-                p2[0] = rotMat1to2[0][0]*p1[0] + rotMat1to2[0][1]*p1[1] \
-                    + rotMat1to2[0][2]*p1[2] + dispVec1to2[0];
-                p2[1] = rotMat1to2[1][0]*p1[0] + rotMat1to2[1][1]*p1[1] \
-                    + rotMat1to2[1][2]*p1[2] + dispVec1to2[1];
-                p2[2] = rotMat1to2[2][0]*p1[0] + rotMat1to2[2][1]*p1[1] \
-                    + rotMat1to2[2][2]*p1[2] + dispVec1to2[2];
-                onGridS2 = Vgrid_value(scalar2, p2, &sval2);
-                onGridV2 = Vgrid_gradient(scalar2, p2, gval2);
-                if (gotMask2) onGridS2 = Vgrid_value(mask2, p2, &mval2);
-                else mval2 = 1.0;
+        /* Read mask 2 */
+        if (gotMask2) {
+            Vnm_print(1, "Reading mask data set 2 from %s...\n", mask2Path);
+            if (!readGrid(&mask2, mask2Path, format)) {
+                Vnm_print(2, "Error reading mask data set 2!\n");
+                return 2;
+            }
+            Vnm_print(1, "Read %d x %d x %d grid.\n",
+                    mask2->nx, mask2->ny, mask2->nz);
+        }
 
-                /* Measures based on scalars */
-                if (onGridS1 && onGridS2) {
-                    val1 = sval1*mval1;
-                    val2 = sval2*mval2;
-                    dval = mval1*mval2*(sval1 - sval2);
-
-                    /* L2 */
-                    norm1_L2 += VSQR(val1);
-                    norm2_L2 += VSQR(val2);
-                    normDiff_L2 += VSQR(dval);
-                    ip_L2 += (val2*val1);
-                    /* L1 */
-                    norm1_L1 += VABS(val1);
-                    norm2_L1 += VABS(val2);
-                    normDiff_L1 += VABS(dval);
-                    /* Volume */
-                    svol += dvol;
-
-                    if (isnan(norm1_L2) || isnan(norm2_L2)) {
-                        Vnm_print(2, "ERROR!  Got NaN!\n");
-                        Vnm_print(2, "p1 = (%1.12E, %1.12E, %1.12E)\n",
-                                p1[0], p1[1], p1[2]);
-                        Vnm_print(2, "p2 = (%1.12E, %1.12E, %1.12E)\n",
-                                p2[0], p2[1], p2[2]);
-                        Vnm_print(2, "mval1 = %1.12E\n", mval1);
-                        Vnm_print(2, "mval2 = %1.12E\n", mval2);
-                        Vnm_print(2, "sval1 = %1.12E\n", sval1);
-                        Vnm_print(2, "sval2 = %1.12E\n", sval2);
-                        Vnm_print(2, "val1 = %1.12E\n", val1);
-                        Vnm_print(2, "val2 = %1.12E\n", val2);
-                        Vnm_print(2, "dval = %1.12E\n", dval);
-                        VASSERT(0);
+        /* Calculate relative L2 norm of difference */
+        Vnm_print(1, "Calculating similarity measures...\n");
+        nx = scalar1->nx; ny = scalar1->ny; nz = scalar1->nz;
+        hx = scalar1->hx; hy = scalar1->hy; hzed = scalar1->hzed;
+        dvol = (hx*hy*hzed);
+        xmin = scalar1->xmin; ymin = scalar1->ymin; zmin = scalar1->zmin;
+        norm1_L1 = 0; norm1_L2 = 0; snorm1_H1 = 0; norm1_H1 = 0;
+        norm2_L1 = 0; norm2_L2 = 0; snorm2_H1 = 0; norm2_H1 = 0;
+        normDiff_L1 = 0; normDiff_L2 = 0; snormDiff_H1 = 0; normDiff_H1 = 0;
+        ip_L2 = 0; ip_H1 = 0;
+        svol = 0; gvol = 0;
+        for (i=0; i<nx; i++) {
+            p1[0] = i*hx + xmin;
+            for (j=0; j<ny; j++) {
+                p1[1] = j*hy + ymin;
+                for (k=0; k<nz; k++) {
+
+                    /* Grid 1 values */
+                    p1[2] = k*hzed + zmin;
+                    onGridS1 = Vgrid_value(scalar1, p1, &sval1);
+                    onGridV1 = Vgrid_gradient(scalar1, p1, gval1);
+                    if (gotMask1) onGridS1 = Vgrid_value(mask1, p1, &mval1);
+                    else mval1 = 1.0;
+
+                    /* Grid 2 values */
+                    p2[0] = rotMat1to2[0][0]*p1[0] + rotMat1to2[0][1]*p1[1] \
+                        + rotMat1to2[0][2]*p1[2] + dispVec1to2[0];
+                    p2[1] = rotMat1to2[1][0]*p1[0] + rotMat1to2[1][1]*p1[1] \
+                        + rotMat1to2[1][2]*p1[2] + dispVec1to2[1];
+                    p2[2] = rotMat1to2[2][0]*p1[0] + rotMat1to2[2][1]*p1[1] \
+                        + rotMat1to2[2][2]*p1[2] + dispVec1to2[2];
+                    onGridS2 = Vgrid_value(scalar2, p2, &sval2);
+                    onGridV2 = Vgrid_gradient(scalar2, p2, gval2);
+                    if (gotMask2) onGridS2 = Vgrid_value(mask2, p2, &mval2);
+                    else mval2 = 1.0;
+
+                    /* Measures based on scalars */
+                    if (onGridS1 && onGridS2) {
+                        val1 = sval1*mval1;
+                        val2 = sval2*mval2;
+                        dval = mval1*mval2*(sval1 - sval2);
+
+                        /* L2 */
+                        norm1_L2 += VSQR(val1);
+                        norm2_L2 += VSQR(val2);
+                        normDiff_L2 += VSQR(dval);
+                        ip_L2 += (val2*val1);
+                        /* L1 */
+                        norm1_L1 += VABS(val1);
+                        norm2_L1 += VABS(val2);
+                        normDiff_L1 += VABS(dval);
+                        /* Volume */
+                        svol += dvol;
+
+                        if (isnan(norm1_L2) || isnan(norm2_L2)) {
+                            Vnm_print(2, "ERROR!  Got NaN!\n");
+                            Vnm_print(2, "p1 = (%1.12E, %1.12E, %1.12E)\n",
+                                    p1[0], p1[1], p1[2]);
+                            Vnm_print(2, "p2 = (%1.12E, %1.12E, %1.12E)\n",
+                                    p2[0], p2[1], p2[2]);
+                            Vnm_print(2, "mval1 = %1.12E\n", mval1);
+                            Vnm_print(2, "mval2 = %1.12E\n", mval2);
+                            Vnm_print(2, "sval1 = %1.12E\n", sval1);
+                            Vnm_print(2, "sval2 = %1.12E\n", sval2);
+                            Vnm_print(2, "val1 = %1.12E\n", val1);
+                            Vnm_print(2, "val2 = %1.12E\n", val2);
+                            Vnm_print(2, "dval = %1.12E\n", dval);
+                            VASSERT(0);
+                        }
                     }
-                }
 
-                /* Measures based on gradients */
-                if (onGridV1 && onGridV2 && onGridS1 && onGridS2) {
-                    val1 = mval1*(VSQR(gval1[0]) + VSQR(gval1[1]) \
-                            + VSQR(gval1[2]));
-                    val2 = mval2*(VSQR(gval2[0]) + VSQR(gval2[1]) \
-                            + VSQR(gval2[2]));
-                    dval = mval1*mval2*(VSQR(gval1[0]-gval2[0]) \
-                            + VSQR(gval1[1]-gval2[1]) \
-                            + VSQR(gval1[2]-gval2[2]));
-                    snorm1_H1 += VSQR(val1);
-                    snorm2_H1 += VSQR(val2);
-                    snormDiff_H1 += VSQR(dval);
-                    ip_H1 += (val1*val2);
-                    gvol += dvol;
+                    /* Measures based on gradients */
+                    if (onGridV1 && onGridV2 && onGridS1 && onGridS2) {
+                        val1 = mval1*(VSQR(gval1[0]) + VSQR(gval1[1]) \
+                                + VSQR(gval1[2]));
+                        val2 = mval2*(VSQR(gval2[0]) + VSQR(gval2[1]) \
+                                + VSQR(gval2[2]));
+                        dval = mval1*mval2*(VSQR(gval1[0]-gval2[0]) \
+                                + VSQR(gval1[1]-gval2[1]) \
+                                + VSQR(gval1[2]-gval2[2]));
+                        snorm1_H1 += VSQR(val1);
+                        snorm2_H1 += VSQR(val2);
+                        snormDiff_H1 += VSQR(dval);
+                        ip_H1 += (val1*val2);
+                        gvol += dvol;
+                    }
                 }
             }
         }
     }
+    Vslab_dtor(&slab1);
+    Vslab_dtor(&slab2);
+    Vslab_dtor(&mslab1);
+    Vslab_dtor(&mslab2);
     /* Volumes */
     Vnm_print(1, "Volume used to calculate L2 and L1 measures = %1.12E\n",
             svol);
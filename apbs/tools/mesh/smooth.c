@@ -12,17 +12,18 @@
 
 #include "apbs.h"
 
-#define IJK(i,j,k)  (((k)*(nx)*(ny))+((j)*(nx))+(i))
 #define ERRRC 2
 
 typedef enum Smooth_Filter {
-    SM_GAUSSIAN  /**< Gaussian filter */
+    SM_GAUSSIAN,  /**< Gaussian filter */
+    SM_BOX  /**< Box (moving average) filter */
 } Smooth_Filter;
 
 
 VEMBED(rcsid="$Id$")
 
-int gaussian(Vgrid *grid, double stddev, double bandwidth);
+int smooth(Vslab *in, Vslab *out, Smooth_Filter filter, double stddev,
+  double bandwidth);
 
 int usage(int rc) {
 
@@ -44,10 +45,15 @@ int usage(int rc) {
       --filter=<filter>  where <filter> is the filter with which the data\n\
                          will be convolved and is one of the following:\n\
                          gaussian (Gaussian filter)\n\
+                         box (moving average)\n\
       REQUIRED FILTER-SPECIFIC ARGUMENTS:\n\
         Gaussian filter:\n\
         --stddev=<n>     the standard deviation of the filter (in A)\n\
         --bandwidth=<n>  the bandwith of the filter (in units of stddev)\n\
+        Box filter:\n\
+        --bandwidth=<n>  the half-width of the filter (in A)\n\
+    The data are streamed through the filter a few planes at a time, so\n\
+    grids larger than memory can be smoothed.\n\
     ----------------------------------------------------------------------\n\n";
 
     Vnm_print(2, usage);
@@ -61,7 +67,8 @@ int main(int argc, char **argv) {
 
     /* *************** VARIABLES ******************* */
     int i;
-    Vgrid *grid = VNULL;
+    Vslab *in = VNULL;
+    Vslab *out = VNULL;
     /* Input parameters */
     Vdata_Format format; int gotFormat = 0;
     char inPath[VMAX_BUFSIZE]; int gotInPath = 0;
@@ -108,6 +115,9 @@ int main(int argc, char **argv) {
             if (strstr(argv[i], "gaussian") != NULL) {
                 gotFilter = 1;
                 filter = SM_GAUSSIAN;
+            } else if (strstr(argv[i], "box") != NULL) {
+                gotFilter = 1;
+                filter = SM_BOX;
             } else {
                 Vnm_print(2, "Error:  %s\n", argv[i]);
                 usage(2);
@@ -156,68 +166,122 @@ int main(int argc, char **argv) {
             usage(2);
         }
     }
+    if ((filter == SM_BOX) && !gotBandwidth) {
+        Vnm_print(2, "Error:  --bandwidth not specified!\n");
+        usage(2);
+    }
 
-    /* *************** READ DATA ******************* */
+    /* *************** OPEN DATA ******************* */
     Vnm_print(1, "main:  Reading data from %s...\n", inPath);
-    grid = Vgrid_ctor(0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, VNULL);
-    if (format == VDF_DX) {
-        if (!Vgrid_readDX(grid, "FILE", "ASC", VNULL, inPath)) {
-            Vnm_print(2, "main:  Problem reading standard OpenDX-format grid from %s\n",
-              inPath);
-            return ERRRC;
-        }
-    } else if (format == VDF_DXBIN) {
-        if (!Vgrid_readDXBIN(grid, "FILE", "ASC", VNULL, inPath)) {
-            Vnm_print(2, "main:  Problem reading binary OpenDX-format grid from %s\n",
-              inPath);
-            return ERRRC;
-        }
+    in = Vslab_ctorRead(inPath, format);
+    if (in == VNULL) {
+        Vnm_print(2, "main:  Problem reading %s OpenDX-format grid from %s\n",
+          (format == VDF_DXBIN) ? "binary" : "standard", inPath);
+        return ERRRC;
     }
+    Vnm_print(1, "main:  Writing data to %s...\n", outPath);
+    out = Vslab_ctorWrite(outPath, format, in->nx, in->ny, in->nz,
+      in->xmin, in->ymin, in->zmin, in->hx, in->hy, in->hzed,
+      "Smoothed data");
+    if (out == VNULL) return ERRRC;
 
     /* *************** SMOOTH ******************* */
     switch(filter) {
         case SM_GAUSSIAN:
            Vnm_print(1, "Smoothing data with Gaussian filter...\n");
-           gaussian(grid, stddev, bandwidth);
+           break;
+        case SM_BOX:
+           Vnm_print(1, "Smoothing data with box filter...\n");
            break;
         default:
            Vnm_print(2, "Invalid format (%d)!\n", format);
            usage(2);
     }
-
-    /* *************** READ DATA ******************* */
-    Vnm_print(1, "main:  Writing data to %s...\n", outPath);
-    if (format == VDF_DX)
-      Vgrid_writeDX(grid, "FILE", "ASC", VNULL, outPath, "Smoothed data",
-        VNULL);
-    else if (format == VDF_DXBIN)
-      Vgrid_writeDXBIN(grid, "FILE", "ASC", VNULL, outPath, "Smoothed data",
-        VNULL);
+    if (!smooth(in, out, filter, stddev, bandwidth)) {
+        Vnm_print(2, "main:  Problem smoothing %s into %s\n", inPath,
+          outPath);
+        return ERRRC;
+    }
+    Vslab_dtor(&in);
+    Vslab_dtor(&out);
 
     return 0;
 }
 
-int gaussian(Vgrid *grid, double stddev, double bandwidth) {
+/* Weights and normalization of the filter along one axis.  Point i
+ * (1 <= i <= n-2) is averaged over the interior points ii with
+ * max(1, i-band) <= ii < min(n-1, i+band); weight[band+d] is the weight of
+ * offset d = i-ii. */
+typedef struct Smooth_Axis {
+    int n;  /**< Number of points */
+    int band;  /**< Half bandwidth in grid units */
+    double *weight;  /**< Weights for offsets -band..band */
+    double *norm;  /**< Sum of the weights in the window of each point */
+} Smooth_Axis;
+
+void axisCtor(Smooth_Axis *axis, Smooth_Filter filter, int n, double h,
+  int band, double scal) {
+
+    int i, ii, d;
+
+    axis->n = n;
+    axis->band = band;
+    axis->weight = Vmem_malloc(VNULL, 2*band+1, sizeof(double));
+    axis->norm = Vmem_malloc(VNULL, n, sizeof(double));
+    for (d=-band; d<=band; d++) {
+        if (filter == SM_BOX) axis->weight[band+d] = 1.0;
+        else axis->weight[band+d] = VEXP(-VSQR(h*d)*scal);
+    }
+    for (i=0; i<n; i++) {
+        axis->norm[i] = 0;
+        for (ii=VMAX2(1, i-band); ii<VMIN2(n-1, i+band); ii++) {
+            axis->norm[i] += axis->weight[band+i-ii];
+        }
+    }
+}
+
+void axisDtor(Smooth_Axis *axis) {
+    Vmem_free(VNULL, 2*axis->band+1, sizeof(double), (void **)&(axis->weight));
+    Vmem_free(VNULL, axis->n, sizeof(double), (void **)&(axis->norm));
+}
 
-    int nx, ny, nz, iband, jband, kband, i, j, k, ii, jj, kk;
-    int kkmin, jjmin, iimin, kkmax, jjmax, iimax;
-    double hx, hy, hzed, xmin, ymin, zmin, *newData, *oldData, scal, norm;
-    double u, ga, dist2;
+/* The filter kernel is a product of per-axis weights over a box, so the
+ * convolution is done one axis at a time: each plane is filtered in y and z
+ * as it is read, and the x pass combines the planes of a ring of 2*band
+ * planes.  Boundary points keep their values, as before. */
+int smooth(Vslab *in, Vslab *out, Smooth_Filter filter, double stddev,
+  double bandwidth) {
 
-    Vnm_print(1, "Gaussian filter:  std. dev. = %g A, bandwidth = %g A.\n",
-      stddev, bandwidth*stddev);
+    int nx, ny, nz, iband, jband, kband, i, j, k, ii, jj, kk, iplane, nring;
+    double scal, u, *ring, *plane, *tmp, *res, *src, w;
+    size_t n;
+    Smooth_Axis ax, ay, az;
 
-    nx = grid->nx; ny = grid->ny; nz = grid->nz;
-    hx = grid->hx; hy = grid->hy; hzed = grid->hzed;
-    xmin = grid->xmin; ymin = grid->ymin; zmin = grid->zmin;
+    nx = in->nx; ny = in->ny; nz = in->nz;
+    n = (size_t)ny*nz;
     Vnm_print(1, "Grid:  %d x %d x %d points\n", nx, ny, nz);
-    Vnm_print(1, "Grid:  %g, %g, %g A spacing\n", hx, hy, hzed);
-    Vnm_print(1, "Grid:  (%g, %g, %g) A origin\n", xmin, ymin, zmin);
+    Vnm_print(1, "Grid:  %g, %g, %g A spacing\n", in->hx, in->hy, in->hzed);
+    Vnm_print(1, "Grid:  (%g, %g, %g) A origin\n", in->xmin, in->ymin,
+      in->zmin);
 
-    /* Convert HALF bandwidth to grid units */
-    iband = (int)(stddev*bandwidth/hx);
-    jband = (int)(stddev*bandwidth/hy);
-    kband = (int)(stddev*bandwidth/hzed);
+    if (filter == SM_GAUSSIAN) {
+        Vnm_print(1, "Gaussian filter:  std. dev. = %g A, bandwidth = %g A.\n",
+          stddev, bandwidth*stddev);
+        /* Convert HALF bandwidth to grid units */
+        iband = (int)(stddev*bandwidth/in->hx);
+        jband = (int)(stddev*bandwidth/in->hy);
+        kband = (int)(stddev*bandwidth/in->hzed);
+        /* Get exponent scaling factor */
+        scal = 2.0 * stddev * stddev;
+        VASSERT(scal > 0);
+        scal = 1.0/scal;
+    } else {
+        Vnm_print(1, "Box filter:  half-width = %g A.\n", bandwidth);
+        iband = (int)(bandwidth/in->hx);
+        jband = (int)(bandwidth/in->hy);
+        kband = (int)(bandwidth/in->hzed);
+        scal = 0.0;
+    }
     /* Special handling for iband, jband and kband, they are non-zero positive integers */
     if (iband == 0) iband = 1;
     if (jband == 0) jband = 1;
@@ -225,55 +289,102 @@ int gaussian(Vgrid *grid, double stddev, double bandwidth) {
     Vnm_print(1, "Bandwidth converted to %d x %d x %d grid units.\n",
       iband, jband, kband);
     Vnm_print(1, "This means any non-zero data within (%g, %g, %g) of the\n",
-      (iband+1)*hx, (jband+1)*hy, (kband+1)*hzed);
+      (iband+1)*in->hx, (jband+1)*in->hy, (kband+1)*in->hzed);
     Vnm_print(1, "domain boundary will be convolved differently.\n");
 
-    /* Get exponent scaling factor */
-    scal = 2.0 * stddev * stddev;
-    VASSERT(scal > 0);
-    scal = 1.0/scal;
-
-    /* Get data */
-    oldData = grid->data;
-    newData = Vmem_malloc(VNULL, (nx*ny*nz), sizeof(double));
-
-    /* Copy over old data.  All but the boundary values will be replaced in the next step so this is more copying than is strictly
-       necessary... */
-    for (i=0; i<(nx*ny*nz); i++) newData[i] = oldData[i];
-
-    /* Apply filter */
-    for (k=1; k<(nz-1); k++) {
-        kkmin = VMAX2(1, (k - kband));
-        kkmax = VMIN2((nz-1), (k + kband));
-        for (j=1; j<(ny-1); j++) {
-            jjmin = VMAX2(1, (j - jband));
-            jjmax = VMIN2((ny-1), (j + jband));
-            for (i=1; i<(nx-1); i++) {
-                iimin = VMAX2(1, (i - iband));
-                iimax = VMIN2((nx-1), (i + iband));
+    axisCtor(&ax, filter, nx, in->hx, iband, scal);
+    axisCtor(&ay, filter, ny, in->hy, jband, scal);
+    axisCtor(&az, filter, nz, in->hzed, kband, scal);
+
+    nring = 2*iband;
+    ring = Vmem_malloc(VNULL, nring*n, sizeof(double));
+    plane = Vmem_malloc(VNULL, n, sizeof(double));
+    tmp = Vmem_malloc(VNULL, n, sizeof(double));
+    res = Vmem_malloc(VNULL, n, sizeof(double));
+
+    /* The first plane is boundary */
+    VJMPERR1(Vslab_read(in, 1, plane));
+    VJMPERR1(Vslab_write(out, 1, plane));
+
+    iplane = 1;
+    for (i=1; i<(nx-1); i++) {
+        /* Bring in (and filter in y and z) the planes of this window */
+        while (iplane < VMIN2(nx-1, i+iband)) {
+            VJMPERR1(Vslab_read(in, 1, plane));
+            src = &(ring[(size_t)(iplane%nring)*n]);
+            #pragma omp parallel for private(k, kk, u)
+            for (j=0; j<ny; j++) {
+                for (k=0; k<nz; k++) {
+                    if ((k == 0) || (k == nz-1)) {
+                        tmp[(size_t)j*nz+k] = plane[(size_t)j*nz+k];
+                        continue;
+                    }
+                    u = 0;
+                    for (kk=VMAX2(1, k-kband); kk<VMIN2(nz-1, k+kband); kk++) {
+                        u += az.weight[kband+k-kk]*plane[(size_t)j*nz+kk];
+                    }
+                    tmp[(size_t)j*nz+k] = u/az.norm[k];
+                }
+            }
+            #pragma omp parallel for private(k, jj, u)
+            for (j=0; j<ny; j++) {
+                for (k=0; k<nz; k++) {
+                    if ((j == 0) || (j == ny-1) || (k == 0) || (k == nz-1)) {
+                        src[(size_t)j*nz+k] = plane[(size_t)j*nz+k];
+                        continue;
+                    }
+                    u = 0;
+                    for (jj=VMAX2(1, j-jband); jj<VMIN2(ny-1, j+jband); jj++) {
+                        u += ay.weight[jband+j-jj]*tmp[(size_t)jj*nz+k];
+                    }
+                    src[(size_t)j*nz+k] = u/ay.norm[j];
+                }
+            }
+            iplane++;
+        }
+
+        /* Combine the window in x */
+        #pragma omp parallel for private(k, ii, u, w)
+        for (j=0; j<ny; j++) {
+            for (k=0; k<nz; k++) {
+                if ((j == 0) || (j == ny-1) || (k == 0) || (k == nz-1)) {
+                    res[(size_t)j*nz+k] =
+                      ring[(size_t)(i%nring)*n + (size_t)j*nz+k];
+                    continue;
+                }
                 u = 0;
-                /* We normalize within the loop to conserve densities */
-                norm = 0;
-                for (kk=kkmin; kk<kkmax; kk++) {
-                    for (jj=jjmin; jj<jjmax; jj++) {
-                        for (ii=iimin; ii<iimax; ii++) {
-                            dist2 = VSQR(hx*(i-ii)) + VSQR(hy*(j-jj)) +
-                              VSQR(hzed*(k-kk));
-                            ga = VEXP(-dist2*scal);
-                            u += (ga*oldData[IJK(ii,jj,kk)]);
-                            norm += ga;
-                        } /* ii loop */
-                    } /* jj loop */
-                } /* kk loop */
-                if (norm > 0) newData[IJK(i,j,k)] = u/norm;
-                else newData[IJK(i,j,k)] = 0;
-            } /* i loop */
-        } /* j loop */
-    } /* k loop */
-
-    /* Replace data */
-    for (i=0; i<(nx*ny*nz); i++) grid->data[i] = newData[i];
-    Vmem_free(VNULL, (nx*ny*nz), sizeof(double), (void **)&newData);
+                for (ii=VMAX2(1, i-iband); ii<VMIN2(nx-1, i+iband); ii++) {
+                    w = ax.weight[iband+i-ii];
+                    u += w*ring[(size_t)(ii%nring)*n + (size_t)j*nz+k];
+                }
+                res[(size_t)j*nz+k] = u/ax.norm[i];
+            }
+        }
+        VJMPERR1(Vslab_write(out, 1, res));
+    }
+
+    /* The last plane is boundary */
+    if (nx > 1) {
+        VJMPERR1(Vslab_read(in, 1, plane));
+        VJMPERR1(Vslab_write(out, 1, plane));
+    }
+
+    Vmem_free(VNULL, nring*n, sizeof(double), (void **)&ring);
+    Vmem_free(VNULL, n, sizeof(double), (void **)&plane);
+    Vmem_free(VNULL, n, sizeof(double), (void **)&tmp);
+    Vmem_free(VNULL, n, sizeof(double), (void **)&res);
+    axisDtor(&ax);
+    axisDtor(&ay);
+    axisDtor(&az);
+    return 1;
 
+    VERROR1:
+    Vmem_free(VNULL, nring*n, sizeof(double), (void **)&ring);
+    Vmem_free(VNULL, n, sizeof(double), (void **)&plane);
+    Vmem_free(VNULL, n, sizeof(double), (void **)&tmp);
+    Vmem_free(VNULL, n, sizeof(double), (void **)&res);
+    axisDtor(&ax);
+    axisDtor(&ay);
+    axisDtor(&az);
     return 0;
 }
@@ -34,10 +34,13 @@ int usage(int rc) {
 int main(int argc, char **argv) {
 
     Vgrid *grid;
-    int inorm;
+    Vslab *slab;
+    int inorm, i, j, k, i0, i1, nsub;
+    size_t n;
     char *path;
     Vdata_Format format;
-    double pt[3], val, grad[3];
+    double pt[3], val, grad[3], ifloat;
+    double *planes, *data;
 
     /* *************** CHECK INVOCATION ******************* */
     Vio_start();
@@ -66,24 +69,37 @@ int main(int argc, char **argv) {
     }
 
     /* *************** READ DATA ******************* */
+    /* Only the x-planes that the value and gradient stencils touch are
+     * kept: planes before them are skipped and the rest are never read */
     Vnm_print(1, "main:  Reading data from %s...\n", path);
-    grid = Vgrid_ctor(0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, VNULL);
-    if (format == VDF_DX) {
-        if (!Vgrid_readDX(grid, "FILE", "ASC", VNULL, path)) {
-            Vnm_print(2, "main:  Problem reading standard OpenDX-format grid from %s\n",
-              path);
-            return 2;
-        }
-    } else if (format == VDF_DXBIN) {
-        if (!Vgrid_readDXBIN(grid, "FILE", "ASC", VNULL, path)) {
-            Vnm_print(2, "main:  Problem reading binary OpenDX-format grid from %s\n",
-              path);
-            return 2;
+    slab = Vslab_ctorRead(path, format);
+    if (slab == VNULL) {
+        Vnm_print(2, "main:  Problem reading %s OpenDX-format grid from %s\n",
+          (format == VDF_DXBIN) ? "binary" : "standard", path);
+        return 2;
+    }
+    ifloat = (pt[0] - slab->xmin)/slab->hx;
+    i0 = (int)VMAX2(0.0, VMIN2(floor(ifloat) - 1.0, (double)(slab->nx-1)));
+    i1 = (int)VMIN2((double)(slab->nx-1), VMAX2(ceil(ifloat) + 1.0, 0.0));
+    if (i1 < i0) i1 = i0;
+    nsub = i1 - i0 + 1;
+    n = (size_t)slab->ny*slab->nz;
+    planes = (double *)Vmem_malloc(VNULL, nsub*n, sizeof(double));
+    data = (double *)Vmem_malloc(VNULL, nsub*n, sizeof(double));
+    if (!Vslab_skip(slab, i0) || !Vslab_read(slab, nsub, planes)) {
+        Vnm_print(2, "main:  Problem reading grid data from %s\n", path);
+        return 2;
+    }
+    for (i=0; i<nsub; i++) {
+        for (j=0; j<slab->ny; j++) {
+            for (k=0; k<slab->nz; k++) {
+                data[((size_t)k*slab->ny + j)*nsub + i] =
+                  planes[(size_t)i*n + (size_t)j*slab->nz + k];
+            }
         }
-    } else {
-        Vnm_print(2, "main:  Format not properly specified. \n");
-        return EXIT_FAILURE;
     }
+    grid = Vgrid_ctor(nsub, slab->ny, slab->nz, slab->hx, slab->hy,
+      slab->hzed, slab->xmin + i0*slab->hx, slab->ymin, slab->zmin, data);
 
     /* *************** READ DATA ******************* */
     Vnm_print(1, "\nData at (%g, %g, %g):\n", pt[0], pt[1], pt[2]);
@@ -110,6 +126,10 @@ int main(int argc, char **argv) {
     */
 
     Vnm_print(1, "\n");
+    Vgrid_dtor(&grid);
+    Vmem_free(VNULL, nsub*n, sizeof(double), (void **)&data);
+    Vmem_free(VNULL, nsub*n, sizeof(double), (void **)&planes);
+    Vslab_dtor(&slab);
     return 0;
 
 }
@@ -122,7 +122,7 @@ typedef struct {
 	int nprint;
     	int nelec;
 	int nmol;
-    NOsh_PrintType printwhat[NOSH_MAXPRINT];
+    NOsh_PrintType *printwhat;
 } NOsh;
 
 enum MGparm_CalcType {